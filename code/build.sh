@@ -0,0 +1,18 @@
+#!/bin/sh
+# Headless Linux build of the CPU side, see s_main_linux.c, the mesh tool, see s_mesh_tool_linux.c,
+# and the tests, see s_test_linux.c, which run after every build. "./build.sh bench [name]" also
+# runs the benchmarks.
+set -e
+
+cd "$(dirname "$0")"
+mkdir -p ../build
+cc -std=gnu11 -g -O2 -Wall -Wextra -Wno-unused-function \
+   s_main_linux.c -o ../build/s_headless -lm -lpthread
+cc -std=gnu11 -g -O2 -Wall -Wextra -Wno-unused-function \
+   s_mesh_tool_linux.c -o ../build/s_mesh_tool -lm -lpthread
+cc -std=gnu11 -g -O2 -Wall -Wextra -Wno-unused-function \
+   s_test_linux.c -o ../build/s_test -lm -lpthread
+../build/s_test
+if [ "$1" = "bench" ]; then
+    ../build/s_test bench $2
+fi
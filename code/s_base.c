@@ -6,3 +6,64 @@ str8_make(char *c, u64 length) {
 	result.char_capacity = length;
 	return(result);
 }
+
+function Arena
+arena_reserve(u64 reserve_size) {
+	Arena result = { 0 };
+	result.reserved = align_pow2(reserve_size, arena_commit_granularity);
+	result.base = (u8 *)os_memory_reserve(result.reserved);
+	if (!result.base) {
+		result.reserved = 0;
+	}
+	return(result);
+}
+
+function void *
+arena_push(Arena *arena, u64 size, u64 align) {
+	void *result = null;
+	
+	u64 start = align_pow2(arena->pos, align);
+	u64 end = start + size;
+	if (end <= arena->reserved) {
+		if (end > arena->committed) {
+			u64 commit_end = align_pow2(end, arena_commit_granularity);
+			if (commit_end > arena->reserved) {
+				commit_end = arena->reserved;
+			}
+			
+			if (os_memory_commit(arena->base + arena->committed, commit_end - arena->committed)) {
+				arena->committed = commit_end;
+			}
+		}
+		
+		if (end <= arena->committed) {
+			result = arena->base + start;
+			arena->pos = end;
+			memset(result, 0, size);
+		}
+	}
+	
+	return(result);
+}
+
+function void
+arena_pop_to(Arena *arena, u64 pos) {
+	if (pos < arena->pos) {
+		arena->pos = pos;
+	}
+}
+
+function void
+arena_clear(Arena *arena) {
+	arena->pos = 0;
+}
+
+function void
+arena_release(Arena *arena) {
+	if (arena->base) {
+		os_memory_release(arena->base, arena->reserved);
+	}
+	
+	Arena zero = { 0 };
+	*arena = zero;
+}
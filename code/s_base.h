@@ -24,16 +24,25 @@ enum {
 #define global static
 #define local static
 
+#if defined(_MSC_VER)
+#define per_thread __declspec(thread)
+#define align_16 __declspec(align(16))
+#define debug_break() __debugbreak()
+#else
+#define per_thread __thread
+#define align_16 __attribute__((aligned(16)))
+#define debug_break() __builtin_trap()
+#endif
+
 #define unused(var) (void)var
 #define null 0
 #define array_count(a) (sizeof(a)/(sizeof((a)[0])))
 #define memory_copy(dst,src,sz) memcpy(dst,src,sz)
+#define memory_compare(a,b,sz) memcmp(a,b,sz)
 
 #define _stringify(s) #s
 #define stringify(s) _stringify(s)
 
-#define debug_break() __debugbreak()
-
 #if defined(S_DEBUG)
 #define s_assert(cond,msg) \
 	if (!(cond)) {\
@@ -45,6 +54,34 @@ enum {
 
 #define assert_true(c) s_assert((c)==True)
 
+// Atomics. add returns the new value, cas returns what was there before.
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define atomic_add_u64(ptr,v) ((u64)_InterlockedExchangeAdd64((volatile long long *)(ptr), (long long)(v)) + (u64)(v))
+#define atomic_cas_u64(ptr,new_value,expected) ((u64)_InterlockedCompareExchange64((volatile long long *)(ptr), (long long)(new_value), (long long)(expected)))
+#define atomic_load_u64(ptr) ((u64)_InterlockedOr64((volatile long long *)(ptr), 0))
+#define atomic_store_u64(ptr,v) _InterlockedExchange64((volatile long long *)(ptr), (long long)(v))
+#define memory_fence() _mm_mfence()
+#define cpu_pause() _mm_pause()
+#else
+#define atomic_add_u64(ptr,v) __atomic_add_fetch((volatile u64 *)(ptr), (u64)(v), __ATOMIC_SEQ_CST)
+#define atomic_cas_u64(ptr,new_value,expected) atomic_cas_u64_(ptr, new_value, expected)
+#define atomic_load_u64(ptr) __atomic_load_n((volatile u64 *)(ptr), __ATOMIC_SEQ_CST)
+#define atomic_store_u64(ptr,v) __atomic_store_n((volatile u64 *)(ptr), (u64)(v), __ATOMIC_SEQ_CST)
+#define memory_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_pause() __builtin_ia32_pause()
+#else
+#define cpu_pause() ((void)0)
+#endif
+
+function u64
+atomic_cas_u64_(volatile u64 *ptr, u64 new_value, u64 expected) {
+	__atomic_compare_exchange_n(ptr, &expected, new_value, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return(expected);
+}
+#endif
+
 typedef struct {
 	u8 *str;
 	u64 char_count;
@@ -58,4 +95,29 @@ str8_make(char *c, u64 length);
 
 #define str8(s) str8_make(s,sizeof(s)-1)
 
+#define kilobytes(n) ((u64)(n) << 10)
+#define megabytes(n) ((u64)(n) << 20)
+#define gigabytes(n) ((u64)(n) << 30)
+#define align_pow2(x,a) (((x) + ((a) - 1)) & ~((u64)(a) - 1))
+
+// Linear allocator over one virtual memory reservation (see s_os.h). Pages are committed
+// as the position moves forward, so the base never moves and pointers stay valid while it grows.
+typedef struct {
+	u8 *base;
+	u64 reserved;
+	u64 committed;
+	u64 pos;
+} Arena;
+
+#define arena_commit_granularity kilobytes(64)
+
+function Arena arena_reserve(u64 reserve_size);
+// Zeroed. Returns null once the reservation is used up, callers decide whether that is fatal.
+function void *arena_push(Arena *arena, u64 size, u64 align);
+function void arena_pop_to(Arena *arena, u64 pos);
+function void arena_clear(Arena *arena);
+function void arena_release(Arena *arena);
+
+#define arena_push_array(arena,type,count) (type *)arena_push((arena), sizeof(type)*(count), 16)
+
 #endif
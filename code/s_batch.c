@@ -0,0 +1,205 @@
+function u64
+batch_key(R3D_Tag tag, u32 level, f32 depth) {
+    // a non-negative float's bits order the same as its value, the low mantissa bits go
+    u32 depth_bits = 0;
+    if (depth > 0.0f) {
+        memory_copy(&depth_bits, &depth, sizeof(f32));
+        depth_bits >>= 31 - batch_key_depth_bits;
+    }
+    u64 result = ((u64)tag.shader << batch_key_shader_shift) | ((u64)tag.material << batch_key_material_shift) |
+        ((u64)tag.mesh << batch_key_mesh_shift) | ((u64)level << batch_key_level_shift) |
+        ((u64)depth_bits << batch_key_depth_shift);
+    return(result);
+}
+
+typedef struct {
+    R3D_Buffer *buffer;
+    Mesh_LOD_Chain *chains;
+    Mesh_LOD_View *view;
+    u32 *visible;
+    u64 *keys;
+} Batch_Key_Job;
+
+function void
+batch_key_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Batch_Key_Job *job = (Batch_Key_Job *)data;
+    v4f plane = job->view->depth_plane;
+    for (u64 index = begin; index < end; ++index) {
+        u32 slot = job->visible[index];
+        Model_Instance instance = r3d_get_instance(job->buffer, slot);
+        R3D_Tag tag = job->buffer->tags[slot];
+        Mesh_LOD_Chain *chain = job->chains + tag.mesh;
+        f32 scale = fabsf(instance.scale.x);
+        scale = fabsf(instance.scale.y) > scale ? fabsf(instance.scale.y) : scale;
+        scale = fabsf(instance.scale.z) > scale ? fabsf(instance.scale.z) : scale;
+        u32 level = mesh_lod_select(chain, job->view, instance.position, chain->combined.radius * scale, scale);
+        f32 depth = v3f_dot(plane.xyz, instance.position) + plane.w;
+        job->keys[index] = batch_key(tag, level, depth);
+    }
+}
+
+function void
+batch_keys_parallel(Job_System *jobs, R3D_Buffer *buffer, Mesh_LOD_Chain *chains, Mesh_LOD_View *view,
+                    u32 *visible, u64 count, u64 *keys) {
+    Batch_Key_Job job;
+    job.buffer = buffer;
+    job.chains = chains;
+    job.view = view;
+    job.visible = visible;
+    job.keys = keys;
+    Job_Fence fence = {0};
+    job_parallel_for(jobs, &fence, count, batch_sort_chunk_size, batch_key_job, &job);
+    job_wait(jobs, &fence);
+}
+
+typedef struct {
+    u64 *keys;
+    u32 *values;
+    u64 *keys_out;
+    u32 *values_out;
+    u32 shift;
+    // [chunk * 8 * 256 + byte * 256 + digit], every byte of every key counted by the first read
+    u32 *byte_counts;
+    // [chunk * 256 + digit]: the chunk's count of the pass's digit, then its write cursors
+    u64 *cursor;
+} Batch_Sort_Job;
+
+function void
+batch_count_bytes_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Batch_Sort_Job *job = (Batch_Sort_Job *)data;
+    u32 *counts = job->byte_counts + (begin / batch_sort_chunk_size) * 8 * 256;
+    for (u64 index = begin; index < end; ++index) {
+        u64 key = job->keys[index];
+        for (u32 byte = 0; byte < 8; ++byte) {
+            ++counts[byte * 256 + ((key >> (byte * 8)) & 255)];
+        }
+    }
+}
+
+function void
+batch_count_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Batch_Sort_Job *job = (Batch_Sort_Job *)data;
+    u64 *counts = job->cursor + (begin / batch_sort_chunk_size) * 256;
+    memset(counts, 0, 256 * sizeof(u64));
+    for (u64 index = begin; index < end; ++index) {
+        ++counts[(job->keys[index] >> job->shift) & 255];
+    }
+}
+
+function void
+batch_scatter_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Batch_Sort_Job *job = (Batch_Sort_Job *)data;
+    u64 *cursor = job->cursor + (begin / batch_sort_chunk_size) * 256;
+    for (u64 index = begin; index < end; ++index) {
+        u64 key = job->keys[index];
+        u64 out = cursor[(key >> job->shift) & 255]++;
+        job->keys_out[out] = key;
+        job->values_out[out] = job->values[index];
+    }
+}
+
+function void
+batch_sort_parallel(Job_System *jobs, Arena *scratch, u64 *keys, u32 *values, u64 count) {
+    if (count < 2) {
+        return;
+    }
+    u64 scratch_pos = scratch->pos;
+    u64 chunk_count = (count + batch_sort_chunk_size - 1) / batch_sort_chunk_size;
+    Batch_Sort_Job job;
+    job.keys = keys;
+    job.values = values;
+    job.keys_out = arena_push_array(scratch, u64, count);
+    job.values_out = arena_push_array(scratch, u32, count);
+    job.byte_counts = arena_push_array(scratch, u32, chunk_count * 8 * 256);
+    job.cursor = arena_push_array(scratch, u64, chunk_count * 256);
+
+    Job_Fence fence = {0};
+    job_parallel_for(jobs, &fence, count, batch_sort_chunk_size, batch_count_bytes_job, &job);
+    job_wait(jobs, &fence);
+
+    b32 moved = False;
+    for (u32 byte = 0; byte < 8; ++byte) {
+        // a byte every key agrees on would scatter everything to where it already is
+        b32 constant = False;
+        for (u32 digit = 0; digit < 256 && !constant; ++digit) {
+            u64 total = 0;
+            for (u64 chunk = 0; chunk < chunk_count; ++chunk) {
+                total += job.byte_counts[chunk * 8 * 256 + byte * 256 + digit];
+            }
+            constant = total == count;
+        }
+        if (constant) {
+            continue;
+        }
+
+        job.shift = byte * 8;
+        if (moved) {
+            job_parallel_for(jobs, &fence, count, batch_sort_chunk_size, batch_count_job, &job);
+            job_wait(jobs, &fence);
+        } else {
+            // nothing has moved yet, so the first read's counts still hold per chunk
+            for (u64 chunk = 0; chunk < chunk_count; ++chunk) {
+                for (u32 digit = 0; digit < 256; ++digit) {
+                    job.cursor[chunk * 256 + digit] = job.byte_counts[chunk * 8 * 256 + byte * 256 + digit];
+                }
+            }
+        }
+        // digit major, chunk minor, so equal digits keep their order
+        u64 offset = 0;
+        for (u32 digit = 0; digit < 256; ++digit) {
+            for (u64 chunk = 0; chunk < chunk_count; ++chunk) {
+                u64 digit_count = job.cursor[chunk * 256 + digit];
+                job.cursor[chunk * 256 + digit] = offset;
+                offset += digit_count;
+            }
+        }
+        job_parallel_for(jobs, &fence, count, batch_sort_chunk_size, batch_scatter_job, &job);
+        job_wait(jobs, &fence);
+
+        u64 *swap_keys = job.keys;
+        u32 *swap_values = job.values;
+        job.keys = job.keys_out;
+        job.values = job.values_out;
+        job.keys_out = swap_keys;
+        job.values_out = swap_values;
+        moved = True;
+    }
+
+    if (job.keys != keys) {
+        memory_copy(keys, job.keys, count * sizeof(u64));
+        memory_copy(values, job.values, count * sizeof(u32));
+    }
+    arena_pop_to(scratch, scratch_pos);
+}
+
+function Batch *
+batch_build(Arena *arena, u64 *keys, u64 count, u32 *batch_count) {
+    *batch_count = 0;
+    for (u64 index = 0; index < count; ++index) {
+        if ((index == 0) || ((keys[index] >> batch_key_level_shift) != (keys[index - 1] >> batch_key_level_shift))) {
+            ++*batch_count;
+        }
+    }
+
+    Batch *result = arena_push_array(arena, Batch, *batch_count);
+    Batch *batch = null;
+    for (u64 index = 0; index < count; ++index) {
+        u64 state = keys[index] >> batch_key_level_shift;
+        if ((index == 0) || (state != (keys[index - 1] >> batch_key_level_shift))) {
+            batch = batch ? batch + 1 : result;
+            batch->key = state << batch_key_level_shift;
+            batch->shader = (u32)(keys[index] >> batch_key_shader_shift);
+            batch->material = (u32)(keys[index] >> batch_key_material_shift) & 0xFFF;
+            batch->mesh = (u32)(keys[index] >> batch_key_mesh_shift) & 0xFFF;
+            batch->level = (u32)(keys[index] >> batch_key_level_shift) & 0xF;
+            batch->first = index;
+            batch->count = 0;
+        }
+        ++batch->count;
+    }
+    return(result);
+}
@@ -0,0 +1,56 @@
+#if !defined(S_BATCH_H)
+#define S_BATCH_H
+
+// Turns the visible list into as few draws as possible. Every visible instance gets a 64-bit key,
+// most significant first:
+//   shader   8 bits  R3D_Tag.shader
+//   material 12 bits R3D_Tag.material
+//   mesh     12 bits R3D_Tag.mesh
+//   level    4 bits  the LOD level mesh_lod_select picks
+//   depth    12 bits view depth, near first, so each draw is roughly front to back for early z
+//   unused   16 bits zero
+// Sorting the keys with the slot indices alongside groups instances that can share a draw, and
+// orders the groups so the costliest state (shader) changes least. A batch is a run of equal
+// state, the key above the depth bits: one DrawIndexedInstanced over its range of the list.
+//
+// The sort is a stable LSD radix sort, 8 bits a pass, split into chunks across the job system:
+// each chunk counts its digits, a prefix over (digit, chunk) gives every chunk its write cursors,
+// then each chunk scatters in order. A first read counts all eight digits at once, and a digit
+// that is the same for every key (an unused shader or material field) costs no pass. Depth is
+// the float's exponent and top 4 mantissa bits, steps of about 6%: plenty for early z, and it
+// leaves the low two bytes to be skipped.
+
+#define batch_key_depth_bits 12
+#define batch_key_depth_shift 16
+#define batch_key_level_shift 28
+#define batch_key_mesh_shift 32
+#define batch_key_material_shift 44
+#define batch_key_shader_shift 56
+
+#define batch_sort_chunk_size 16384
+
+typedef struct {
+    // the keys of its range with the depth bits clear
+    u64 key;
+    u32 shader;
+    u32 material;
+    u32 mesh;
+    u32 level;
+    // a range of the sorted list
+    u64 first;
+    u64 count;
+} Batch;
+
+// depth below 0 sorts as 0. tag.mesh and tag.material must fit in 12 bits, tag.shader in 8.
+function u64 batch_key(R3D_Tag tag, u32 level, f32 depth);
+
+// keys[i] for visible[i], picking the level from chains[tag.mesh] with that mesh's radius.
+function void batch_keys_parallel(Job_System *jobs, R3D_Buffer *buffer, Mesh_LOD_Chain *chains,
+                                  Mesh_LOD_View *view, u32 *visible, u64 count, u64 *keys);
+// Sorts keys ascending and moves values with them, equal keys keep their order. scratch is
+// restored before returning.
+function void batch_sort_parallel(Job_System *jobs, Arena *scratch, u64 *keys, u32 *values, u64 count);
+// Runs of equal state in sorted keys, pushed to arena.
+function Batch *batch_build(Arena *arena, u64 *keys, u64 count, u32 *batch_count);
+
+#endif
@@ -0,0 +1,221 @@
+// Batch sorting: batch_sort_parallel against qsort on (key, original index), which is what a
+// stable sort of keys has to come out as, over key distributions that take different passes and
+// counts around the chunk size. The benchmark sorts a million batch keys both ways.
+
+typedef struct {
+    u64 key;
+    u32 value;
+} Batch_Test_Pair;
+
+function int
+batch_test_compare_pairs(const void *a, const void *b) {
+    const Batch_Test_Pair *x = (const Batch_Test_Pair *)a;
+    const Batch_Test_Pair *y = (const Batch_Test_Pair *)b;
+    int result = (x->key > y->key) - (x->key < y->key);
+    if (!result) {
+        result = (x->value > y->value) - (x->value < y->value);
+    }
+    return(result);
+}
+
+enum {
+    BatchTestKeys_Batch,
+    BatchTestKeys_Random,
+    BatchTestKeys_FewDistinct,
+    BatchTestKeys_Equal,
+    BatchTestKeys_Ascending,
+    BatchTestKeys_Descending,
+    BatchTestKeys_Count
+};
+
+global char *batch_test_key_names[BatchTestKeys_Count] = {
+    "batch keys", "random", "few distinct", "all equal", "ascending", "descending",
+};
+
+function void
+batch_test_keys(u64 *keys, u64 count, u32 kind, u64 seed) {
+    Test_Random random = test_random_make(seed);
+    for (u64 index = 0; index < count; ++index) {
+        u64 key = 0;
+        switch (kind) {
+            // what the renderer sorts: a few shaders, more materials and meshes, depth spread out
+            case BatchTestKeys_Batch: {
+                R3D_Tag tag = { 0 };
+                tag.shader = (u16)(test_random_u32(&random) % 4);
+                tag.material = (u16)(test_random_u32(&random) % 100);
+                tag.mesh = (u16)(test_random_u32(&random) % 500);
+                u32 level = test_random_u32(&random) % 6;
+                f32 depth = test_random_f32(&random, 0.1f, 500.0f);
+                key = batch_key(tag, level, depth);
+            } break;
+
+            case BatchTestKeys_Random: {
+                u64 high = test_random_u32(&random);
+                key = (high << 32) | test_random_u32(&random);
+            } break;
+
+            case BatchTestKeys_FewDistinct: {
+                key = (u64)(test_random_u32(&random) % 7) << 40;
+            } break;
+
+            case BatchTestKeys_Equal: {
+                key = 0x0123456789ABCDEFull;
+            } break;
+
+            case BatchTestKeys_Ascending: {
+                key = index * 3;
+            } break;
+
+            case BatchTestKeys_Descending: {
+                key = (count - index) << 20;
+            } break;
+        }
+        keys[index] = key;
+    }
+}
+
+function void
+test_batch(void) {
+    u64 max_count = 1000000;
+    u64 *keys = (u64 *)malloc(max_count * sizeof(u64));
+    u32 *values = (u32 *)malloc(max_count * sizeof(u32));
+    Batch_Test_Pair *pairs = (Batch_Test_Pair *)malloc(max_count * sizeof(Batch_Test_Pair));
+    Arena scratch = arena_reserve(megabytes(256));
+    Job_System jobs_1, jobs_4;
+    job_system_init(&jobs_1, 1);
+    job_system_init(&jobs_4, 4);
+
+    u64 counts[] = {
+        0, 1, 2, 3, 1000, batch_sort_chunk_size - 1, batch_sort_chunk_size, batch_sort_chunk_size + 1,
+        3 * batch_sort_chunk_size + 17, max_count,
+    };
+    for (u32 kind = 0; kind < BatchTestKeys_Count; ++kind) {
+        for (u32 count_index = 0; count_index < array_count(counts); ++count_index) {
+            u64 count = counts[count_index];
+            batch_test_keys(keys, count, kind, 21 + count_index);
+            for (u64 index = 0; index < count; ++index) {
+                pairs[index].key = keys[index];
+                pairs[index].value = (u32)index;
+            }
+            qsort(pairs, count, sizeof(Batch_Test_Pair), batch_test_compare_pairs);
+
+            for (u32 jobs_index = 0; jobs_index < 2; ++jobs_index) {
+                Job_System *jobs = jobs_index ? &jobs_4 : &jobs_1;
+                batch_test_keys(keys, count, kind, 21 + count_index);
+                for (u64 index = 0; index < count; ++index) {
+                    values[index] = (u32)index;
+                }
+                batch_sort_parallel(jobs, &scratch, keys, values, count);
+                u64 wrong = 0;
+                for (u64 index = 0; index < count; ++index) {
+                    wrong += (keys[index] != pairs[index].key) || (values[index] != pairs[index].value);
+                }
+                test_check(!wrong, "%s, %llu keys, %u workers: %llu entries differ from qsort", batch_test_key_names[kind],
+                           (unsigned long long)count, jobs_index ? 4 : 1, (unsigned long long)wrong);
+                test_check(scratch.pos == 0, "%s: scratch not restored", batch_test_key_names[kind]);
+            }
+        }
+    }
+
+    // batches cover the sorted list in runs of one state each
+    {
+        u64 count = 100000;
+        batch_test_keys(keys, count, BatchTestKeys_Batch, 5);
+        for (u64 index = 0; index < count; ++index) {
+            values[index] = (u32)index;
+        }
+        batch_sort_parallel(&jobs_4, &scratch, keys, values, count);
+        u32 batch_count = 0;
+        Batch *batches = batch_build(&scratch, keys, count, &batch_count);
+        u64 next = 0;
+        u64 wrong = 0;
+        for (u32 batch_index = 0; batch_index < batch_count; ++batch_index) {
+            Batch *batch = batches + batch_index;
+            wrong += batch->first != next;
+            for (u64 index = batch->first; index < batch->first + batch->count; ++index) {
+                wrong += (keys[index] >> batch_key_level_shift) != (batch->key >> batch_key_level_shift);
+            }
+            // neighbours differ, or they'd be one batch
+            wrong += batch_index && (batches[batch_index - 1].key == batch->key);
+            wrong += (batch->shader != (u32)(batch->key >> batch_key_shader_shift)) ||
+                (batch->mesh != ((u32)(batch->key >> batch_key_mesh_shift) & 0xFFF));
+            next = batch->first + batch->count;
+        }
+        test_check(!wrong && (next == count), "batch_build: %llu wrong, covers %llu of %llu",
+                   (unsigned long long)wrong, (unsigned long long)next, (unsigned long long)count);
+        arena_clear(&scratch);
+    }
+
+    job_system_release(&jobs_1);
+    job_system_release(&jobs_4);
+    arena_release(&scratch);
+    free(pairs);
+    free(values);
+    free(keys);
+}
+
+function void
+bench_batch(void) {
+    u64 count = 1000000;
+    u64 *source = (u64 *)malloc(count * sizeof(u64));
+    u64 *keys = (u64 *)malloc(count * sizeof(u64));
+    u32 *values = (u32 *)malloc(count * sizeof(u32));
+    Batch_Test_Pair *pairs = (Batch_Test_Pair *)malloc(count * sizeof(Batch_Test_Pair));
+    Arena scratch = arena_reserve(megabytes(256));
+
+    u32 kinds[] = { BatchTestKeys_Batch, BatchTestKeys_Random };
+    u32 cpu_count = os_cpu_count();
+    printf("  %u cores\n", cpu_count);
+    for (u32 kind_index = 0; kind_index < array_count(kinds); ++kind_index) {
+        u32 kind = kinds[kind_index];
+        batch_test_keys(source, count, kind, 99);
+
+        u64 best = ~0ull;
+        for (u32 round = 0; round < 5; ++round) {
+            for (u64 index = 0; index < count; ++index) {
+                pairs[index].key = source[index];
+                pairs[index].value = (u32)index;
+            }
+            u64 begin = os_time_ticks();
+            qsort(pairs, count, sizeof(Batch_Test_Pair), batch_test_compare_pairs);
+            u64 ticks = os_time_ticks() - begin;
+            best = ticks < best ? ticks : best;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "%s, qsort", batch_test_key_names[kind]);
+        bench_report(name, count, best);
+        f64 qsort_ms = (f64)best * 1000.0 / (f64)os_time_ticks_per_second();
+
+        // doubling up to every core, and every core when that isn't a power of two
+        for (u32 worker_count = 1; ; worker_count = (worker_count * 2 < cpu_count) ? worker_count * 2 : cpu_count) {
+            Job_System jobs;
+            job_system_init(&jobs, worker_count);
+            best = ~0ull;
+            for (u32 round = 0; round < 5; ++round) {
+                memory_copy(keys, source, count * sizeof(u64));
+                for (u64 index = 0; index < count; ++index) {
+                    values[index] = (u32)index;
+                }
+                u64 begin = os_time_ticks();
+                batch_sort_parallel(&jobs, &scratch, keys, values, count);
+                u64 ticks = os_time_ticks() - begin;
+                best = ticks < best ? ticks : best;
+            }
+            job_system_release(&jobs);
+
+            snprintf(name, sizeof(name), "%s, radix, %u workers", batch_test_key_names[kind], worker_count);
+            bench_report(name, count, best);
+            f64 ms = (f64)best * 1000.0 / (f64)os_time_ticks_per_second();
+            printf("  %-40s %10.2fx of qsort\n", "", qsort_ms / ms);
+            if (worker_count >= cpu_count) {
+                break;
+            }
+        }
+    }
+
+    arena_release(&scratch);
+    free(pairs);
+    free(values);
+    free(keys);
+    free(source);
+}
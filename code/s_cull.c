@@ -0,0 +1,173 @@
+function Frustum
+frustum_from_view_projection(m44 view_projection) {
+	// clip = v * m, so every clip coordinate is a dot with one column
+	v4f column[4];
+	for (u32 c = 0; c < 4; ++c) {
+		column[c] = v4f_make(view_projection.m[0][c], view_projection.m[1][c],
+							 view_projection.m[2][c], view_projection.m[3][c]);
+	}
+	
+	Frustum result;
+	result.planes[0] = v4f_add(column[3], column[0]); // left,   -w <= x
+	result.planes[1] = v4f_sub(column[3], column[0]); // right,   x <= w
+	result.planes[2] = v4f_add(column[3], column[1]); // bottom, -w <= y
+	result.planes[3] = v4f_sub(column[3], column[1]); // top,     y <= w
+	result.planes[4] = column[2];                     // near,    0 <= z
+	result.planes[5] = v4f_sub(column[3], column[2]); // far,     z <= w
+	
+	for (u32 plane_index = 0; plane_index < array_count(result.planes); ++plane_index) {
+		v4f *plane = result.planes + plane_index;
+		f32 inv_length = 1.0f / sqrtf(v3f_dot(plane->xyz, plane->xyz));
+		*plane = v4f_scale(*plane, inv_length);
+	}
+	return(result);
+}
+
+function b32
+frustum_test_sphere(Frustum *frustum, v3f center, f32 radius) {
+	b32 result = True;
+	for (u32 plane_index = 0; plane_index < array_count(frustum->planes); ++plane_index) {
+		v4f plane = frustum->planes[plane_index];
+		if (v3f_dot(plane.xyz, center) + plane.w < -radius) {
+			result = False;
+			break;
+		}
+	}
+	return(result);
+}
+
+function u32
+frustum_test_spheres_x4(Frustum *frustum, v3f_x4 center, f32x4 radius) {
+	f32x4 neg_radius = f32x4_sub(f32x4_zero(), radius);
+	u32 result = 0xf;
+	for (u32 plane_index = 0; plane_index < array_count(frustum->planes) && result; ++plane_index) {
+		v4f plane = frustum->planes[plane_index];
+		f32x4 distance = f32x4_madd(f32x4_set1(plane.x), center.x, f32x4_set1(plane.w));
+		distance = f32x4_madd(f32x4_set1(plane.y), center.y, distance);
+		distance = f32x4_madd(f32x4_set1(plane.z), center.z, distance);
+		result &= f32x4_mask(f32x4_cmp_le(neg_radius, distance));
+	}
+	return(result);
+}
+
+function u64
+r3d_cull_range(R3D_Buffer *buffer, Frustum *frustum, f32 local_radius, u64 first, u64 count, u32 *visible) {
+	u64 visible_count = 0;
+	
+	// capacity is a multiple of four, so the last group may read committed slots past the range;
+	// those lanes are masked off below.
+	f32x4 local_radius_x4 = f32x4_set1(local_radius);
+	f32x4 zero = f32x4_zero();
+	for (u64 offset = 0; offset < count; offset += 4) {
+		u64 index = first + offset;
+		v3f_x4 position, scale;
+		quat_x4 orient;
+		r3d_load_instances_x4(buffer, index, &position, &orient, &scale);
+		
+		f32x4 abs_x = f32x4_max(scale.x, f32x4_sub(zero, scale.x));
+		f32x4 abs_y = f32x4_max(scale.y, f32x4_sub(zero, scale.y));
+		f32x4 abs_z = f32x4_max(scale.z, f32x4_sub(zero, scale.z));
+		f32x4 radius = f32x4_mul(local_radius_x4, f32x4_max(abs_x, f32x4_max(abs_y, abs_z)));
+		
+		u32 mask = frustum_test_spheres_x4(frustum, position, radius);
+		u64 remaining = count - offset;
+		if (remaining < 4) {
+			mask &= (1u << remaining) - 1;
+		}
+		
+		for (u32 lane = 0; lane < 4; ++lane) {
+			if (mask & (1u << lane)) {
+				visible[visible_count++] = (u32)(index + lane);
+			}
+		}
+	}
+	
+	return(visible_count);
+}
+
+function u64
+r3d_cull(R3D_Buffer *buffer, Frustum *frustum, f32 local_radius, u32 *visible, Cull_Stats *stats) {
+	u64 visible_count = r3d_cull_range(buffer, frustum, local_radius, 0, buffer->count, visible);
+	
+	if (stats) {
+		stats->tested = buffer->count;
+		stats->visible = visible_count;
+		stats->culled = buffer->count - visible_count;
+	}
+	return(visible_count);
+}
+
+typedef struct {
+	R3D_Buffer *buffer;
+	Frustum *frustum;
+	f32 local_radius;
+	u64 chunk_size;
+	
+	// chunk k culls into scratch[k * chunk_size, ...) and copies out to visible[chunk_offset[k], ...)
+	u32 *scratch;
+	u64 *chunk_visible;
+	u64 *chunk_offset;
+	u32 *visible;
+} R3D_Cull_Job;
+
+function void
+r3d_cull_job(void *data, u64 begin, u64 end, u32 worker_index) {
+	unused(worker_index);
+	R3D_Cull_Job *job = (R3D_Cull_Job *)data;
+	u64 chunk = begin / job->chunk_size;
+	job->chunk_visible[chunk] = r3d_cull_range(job->buffer, job->frustum, job->local_radius,
+	                                           begin, end - begin, job->scratch + begin);
+}
+
+function void
+r3d_compact_job(void *data, u64 begin, u64 end, u32 worker_index) {
+	unused(worker_index);
+	unused(end);
+	R3D_Cull_Job *job = (R3D_Cull_Job *)data;
+	u64 chunk = begin / job->chunk_size;
+	memory_copy(job->visible + job->chunk_offset[chunk], job->scratch + begin,
+	            job->chunk_visible[chunk] * sizeof(u32));
+}
+
+function u64
+r3d_cull_parallel(Job_System *jobs, Arena *scratch, R3D_Buffer *buffer, Frustum *frustum, f32 local_radius,
+                  u32 *visible, Cull_Stats *stats) {
+	u64 chunk_size = r3d_cull_chunk_size;
+	u64 chunk_count = (buffer->count + chunk_size - 1) / chunk_size;
+	u64 scratch_pos = scratch->pos;
+	
+	R3D_Cull_Job job;
+	job.buffer = buffer;
+	job.frustum = frustum;
+	job.local_radius = local_radius;
+	job.chunk_size = chunk_size;
+	job.scratch = arena_push_array(scratch, u32, buffer->count);
+	job.chunk_visible = arena_push_array(scratch, u64, chunk_count);
+	job.chunk_offset = arena_push_array(scratch, u64, chunk_count);
+	job.visible = visible;
+	
+	u64 visible_count = 0;
+	if (!job.scratch || !job.chunk_visible || !job.chunk_offset) {
+		visible_count = r3d_cull_range(buffer, frustum, local_radius, 0, buffer->count, visible);
+	} else {
+		Job_Fence fence = {0};
+		job_parallel_for(jobs, &fence, buffer->count, chunk_size, r3d_cull_job, &job);
+		job_wait(jobs, &fence);
+		
+		for (u64 chunk = 0; chunk < chunk_count; ++chunk) {
+			job.chunk_offset[chunk] = visible_count;
+			visible_count += job.chunk_visible[chunk];
+		}
+		
+		job_parallel_for(jobs, &fence, buffer->count, chunk_size, r3d_compact_job, &job);
+		job_wait(jobs, &fence);
+	}
+	arena_pop_to(scratch, scratch_pos);
+	
+	if (stats) {
+		stats->tested = buffer->count;
+		stats->visible = visible_count;
+		stats->culled = buffer->count - visible_count;
+	}
+	return(visible_count);
+}
@@ -0,0 +1,36 @@
+#if !defined(S_CULL_H)
+#define S_CULL_H
+
+// Planes are (n, d) with n unit length; a point p is inside when dot(n, p) + d >= 0.
+typedef struct {
+	v4f planes[6];
+} Frustum;
+
+typedef struct {
+	u64 tested;
+	u64 visible;
+	u64 culled;
+} Cull_Stats;
+
+// Expects the same row-vector world_to_camera * perspective we upload, with D3D's 0..w clip depth.
+function Frustum frustum_from_view_projection(m44 view_projection);
+function b32 frustum_test_sphere(Frustum *frustum, v3f center, f32 radius);
+// Four spheres at once, bit i of the result set when sphere i is at least partly inside.
+function u32 frustum_test_spheres_x4(Frustum *frustum, v3f_x4 center, f32x4 radius);
+
+// Tests [0, buffer->count) with bounding spheres of local_radius scaled by each instance's largest
+// scale axis. Indices of the survivors go to visible (room for buffer->count), in order.
+// Returns the visible count; stats may be null.
+function u64 r3d_cull(R3D_Buffer *buffer, Frustum *frustum, f32 local_radius, u32 *visible, Cull_Stats *stats);
+
+// Same result as r3d_cull over [first, first + count), visible needs room for count.
+function u64 r3d_cull_range(R3D_Buffer *buffer, Frustum *frustum, f32 local_radius, u64 first, u64 count, u32 *visible);
+
+// Instances per cull job, a multiple of four so every job starts on a lane group.
+#define r3d_cull_chunk_size 16384
+// r3d_cull split across the job system. Chunks cull into scratch, then get compacted into visible
+// in order, so the output matches r3d_cull exactly. scratch is restored before returning.
+function u64 r3d_cull_parallel(Job_System *jobs, Arena *scratch, R3D_Buffer *buffer, Frustum *frustum, f32 local_radius,
+                               u32 *visible, Cull_Stats *stats);
+
+#endif
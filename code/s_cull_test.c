@@ -0,0 +1,137 @@
+// Culling: the four-wide sphere test against frustum_test_sphere one instance at a time, and both
+// against a brute force that puts points of every sphere through the view projection and checks
+// them against D3D's clip volume.
+
+// Clip position of p under view_projection, in double so the brute force isn't itself rounding
+// near the planes.
+function b32
+cull_test_point_in_clip(m44 view_projection, v3f p) {
+    f64 clip[4];
+    for (u32 c = 0; c < 4; ++c) {
+        clip[c] = (f64)p.x * view_projection.m[0][c] + (f64)p.y * view_projection.m[1][c] +
+            (f64)p.z * view_projection.m[2][c] + (f64)view_projection.m[3][c];
+    }
+    b32 result = (-clip[3] <= clip[0]) && (clip[0] <= clip[3]) && (-clip[3] <= clip[1]) && (clip[1] <= clip[3]) &&
+        (0.0 <= clip[2]) && (clip[2] <= clip[3]);
+    return(result);
+}
+
+// Signed distance of the sphere's nearest point past the plane it fails worst, in double: negative
+// when the sphere is outside by that much.
+function f64
+cull_test_margin(Frustum *frustum, v3f center, f32 radius) {
+    f64 result = 1e30;
+    for (u32 plane_index = 0; plane_index < array_count(frustum->planes); ++plane_index) {
+        v4f plane = frustum->planes[plane_index];
+        f64 distance = (f64)plane.x * center.x + (f64)plane.y * center.y + (f64)plane.z * center.z + plane.w + radius;
+        result = distance < result ? distance : result;
+    }
+    return(result);
+}
+
+function void
+test_cull(void) {
+    char *layout_names[] = { "AoS", "SoA" };
+    Job_System job_system;
+    job_system_init(&job_system, 4);
+    Arena scratch = arena_reserve(megabytes(64));
+    f32 local_radius = 1.5f;
+    u64 instance_count = 50003;
+
+    for (R3D_Layout layout = R3D_Layout_AoS; layout <= R3D_Layout_SoA; ++layout) {
+        Test_Random random = test_random_make(9);
+        R3D_Buffer buffer;
+        r3d_init(&buffer, instance_count, layout);
+        for (u64 index = 0; index < instance_count; ++index) {
+            v3f p = test_random_v3f(&random, -200.0f, 200.0f);
+            quat orient = test_random_quat(&random);
+            v3f scale = test_random_v3f(&random, -3.0f, 3.0f);
+            r3d_add_instance(&buffer, p, orient, scale, v4f_make(1.0f, 1.0f, 1.0f, 1.0f));
+        }
+        u32 *visible = (u32 *)malloc(instance_count * sizeof(u32));
+        u32 *visible_parallel = (u32 *)malloc(instance_count * sizeof(u32));
+        u8 *kept = (u8 *)malloc(instance_count * sizeof(u8));
+
+        u64 mismatches = 0;
+        u64 near_plane_mismatches = 0;
+        u64 missed = 0;
+        u64 loose = 0;
+        u64 visible_total = 0;
+        for (u32 pose = 0; pose < 16; ++pose) {
+            v3f eye = test_random_v3f(&random, -150.0f, 150.0f);
+            v3f target = test_random_v3f(&random, -50.0f, 50.0f);
+            m44 view_projection = m44_mul(m44_look_at_lh(eye, target, v3f_make(0.0f, 1.0f, 0.0f)),
+                                          m44_perspective_lh_z01(radians(test_random_f32(&random, 40.0f, 100.0f)),
+                                                                 test_random_f32(&random, 0.5f, 1.0f), 0.5f, 300.0f));
+            Frustum frustum = frustum_from_view_projection(view_projection);
+
+            Cull_Stats stats;
+            u64 visible_count = r3d_cull(&buffer, &frustum, local_radius, visible, &stats);
+            test_check(stats.tested == instance_count && stats.visible == visible_count &&
+                       stats.culled == instance_count - visible_count, "%s r3d_cull: stats don't add up", layout_names[layout]);
+            visible_total += visible_count;
+
+            Cull_Stats parallel_stats;
+            u64 parallel_count = r3d_cull_parallel(&job_system, &scratch, &buffer, &frustum, local_radius,
+                                                   visible_parallel, &parallel_stats);
+            test_check((parallel_count == visible_count) &&
+                       (memory_compare(visible, visible_parallel, visible_count * sizeof(u32)) == 0) &&
+                       (memory_compare(&stats, &parallel_stats, sizeof(stats)) == 0),
+                       "%s r3d_cull_parallel: differs from r3d_cull", layout_names[layout]);
+            test_check(scratch.pos == 0, "%s r3d_cull_parallel: scratch not restored", layout_names[layout]);
+
+            memset(kept, 0, instance_count * sizeof(u8));
+            b32 in_order = True;
+            for (u64 index = 0; index < visible_count; ++index) {
+                kept[visible[index]] = True;
+                in_order = in_order && ((index == 0) || (visible[index - 1] < visible[index]));
+            }
+            test_check(in_order, "%s r3d_cull: survivors out of order", layout_names[layout]);
+
+            for (u64 index = 0; index < instance_count; ++index) {
+                Model_Instance instance = r3d_get_instance(&buffer, index);
+                f32 scale = fmaxf(fabsf(instance.scale.x), fmaxf(fabsf(instance.scale.y), fabsf(instance.scale.z)));
+                f32 radius = local_radius * scale;
+
+                // The lanes sum the plane distance in another order, so only spheres touching a
+                // plane to within its rounding may come out differently.
+                if (frustum_test_sphere(&frustum, instance.position, radius) != kept[index]) {
+                    ++mismatches;
+                    near_plane_mismatches += fabs(cull_test_margin(&frustum, instance.position, radius)) <= 1e-3;
+                }
+
+                // The center, and the corners and face centers of the cube inscribed in the sphere:
+                // all inside it, so one of them in the clip volume means the sphere is on screen.
+                b32 on_screen = cull_test_point_in_clip(view_projection, instance.position);
+                f32 half = radius * 0.57735f;
+                for (u32 corner = 0; corner < 8 && !on_screen; ++corner) {
+                    v3f offset = v3f_make((corner & 1) ? half : -half, (corner & 2) ? half : -half, (corner & 4) ? half : -half);
+                    on_screen = cull_test_point_in_clip(view_projection, v3f_add(instance.position, offset));
+                }
+                for (u32 axis = 0; axis < 6 && !on_screen; ++axis) {
+                    v3f offset = v3f_make(0.0f, 0.0f, 0.0f);
+                    offset.v[axis / 2] = (axis & 1) ? radius : -radius;
+                    on_screen = cull_test_point_in_clip(view_projection, v3f_add(instance.position, offset));
+                }
+                missed += on_screen && !kept[index];
+                loose += !on_screen && kept[index];
+            }
+        }
+
+        test_check(mismatches == near_plane_mismatches, "%s r3d_cull: %llu disagree with frustum_test_sphere away from a plane",
+                   layout_names[layout], (unsigned long long)(mismatches - near_plane_mismatches));
+        test_check(!missed, "%s r3d_cull: culled %llu spheres with points in the clip volume",
+                   layout_names[layout], (unsigned long long)missed);
+        // spheres test conservatively, so some kept ones are only near a corner of the frustum
+        printf("  %s: %llu kept over 16 poses, %llu of them with no sampled point on screen, %llu at a plane\n",
+               layout_names[layout], (unsigned long long)visible_total, (unsigned long long)loose,
+               (unsigned long long)mismatches);
+
+        free(visible);
+        free(visible_parallel);
+        free(kept);
+        r3d_release(&buffer);
+    }
+    arena_release(&scratch);
+    job_system_release(&job_system);
+}
@@ -0,0 +1,211 @@
+// indexed by filter, the values match the enum
+
+global Shader_Define downsample_filter_defines[DownsampleFilter_Count][2] = {
+    { { "DOWNSAMPLE_FILTER", "0" }, { 0, 0 } },
+    { { "DOWNSAMPLE_FILTER", "1" }, { 0, 0 } },
+    { { "DOWNSAMPLE_FILTER", "2" }, { 0, 0 } },
+};
+
+global char *downsample_filter_names[DownsampleFilter_Count] = {
+    "box", "tent", "lanczos",
+};
+
+function f32
+downsample_kernel(u32 filter, f32 x) {
+    f32 result = 0.0f;
+    f32 distance = x < 0.0f ? -x : x;
+    switch (filter) {
+        case DownsampleFilter_Box: {
+            // half a texel on the edge so the kernel stays symmetric
+            result = distance < 1.0f ? 1.0f : (distance == 1.0f ? 0.5f : 0.0f);
+        } break;
+
+        case DownsampleFilter_Tent: {
+            result = distance < 2.0f ? 1.0f - 0.5f * distance : 0.0f;
+        } break;
+
+        // https://en.wikipedia.org/wiki/Lanczos_resampling, a = 2
+        case DownsampleFilter_Lanczos: {
+            if (distance < 1e-5f) {
+                result = 1.0f;
+            } else if (distance < 2.0f) {
+                f32 pi_x = pi_f32 * distance;
+                result = 2.0f * sinf(pi_x) * sinf(0.5f * pi_x) / (pi_x * pi_x);
+            }
+        } break;
+    }
+    return(result);
+}
+
+function Downsample_Axis
+downsample_axis(u32 filter, f32 ratio, u32 destination_index) {
+    Downsample_Axis result;
+    f32 centre = ((f32)destination_index + 0.5f) * ratio;
+    f32 kernel_scale = 0.5f * (ratio > 1.0f ? ratio : 1.0f);
+    result.first = (s32)floorf(centre - 0.5f) - 1;
+
+    f32 sum = 0.0f;
+    for (u32 tap = 0; tap < downsample_taps; ++tap) {
+        f32 distance = ((f32)(result.first + (s32)tap) + 0.5f) - centre;
+        result.weights[tap] = downsample_kernel(filter, distance / kernel_scale);
+        sum += result.weights[tap];
+    }
+
+    f32 inv_sum = sum != 0.0f ? 1.0f / sum : 0.0f;
+    for (u32 tap = 0; tap < downsample_taps; ++tap) {
+        result.weights[tap] *= inv_sum;
+    }
+    return(result);
+}
+
+// https://en.wikipedia.org/wiki/SRGB#Transformation
+function f32
+downsample_srgb_decode(f32 value) {
+    f32 result = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+    return(result);
+}
+
+function f32
+downsample_srgb_encode(f32 value) {
+    value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    f32 result = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+    return(result);
+}
+
+// linear rgb and alpha of every 8 bit value, alpha isn't sRGB encoded
+typedef struct {
+    f32 linear[256];
+    f32 unorm[256];
+} Downsample_Tables;
+
+function void
+downsample_tables(Downsample_Tables *tables) {
+    for (u32 value = 0; value < 256; ++value) {
+        tables->unorm[value] = (f32)value / 255.0f;
+        tables->linear[value] = downsample_srgb_decode(tables->unorm[value]);
+    }
+}
+
+function void
+downsample_texel(Downsample_Tables *tables, Downsample_Image *source, s32 x, s32 y, f32 *out) {
+    x = x < 0 ? 0 : (x >= (s32)source->width ? (s32)source->width - 1 : x);
+    y = y < 0 ? 0 : (y >= (s32)source->height ? (s32)source->height - 1 : y);
+    u32 texel = source->pixels[(u64)y * source->pitch + (u32)x];
+    out[0] = tables->linear[texel & 255];
+    out[1] = tables->linear[(texel >> 8) & 255];
+    out[2] = tables->linear[(texel >> 16) & 255];
+    out[3] = tables->unorm[texel >> 24];
+}
+
+function u32
+downsample_pack(f32 *colour) {
+    u32 result = 0;
+    for (u32 c = 0; c < 4; ++c) {
+        f32 value = c < 3 ? downsample_srgb_encode(colour[c]) : colour[c];
+        value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+        result |= (u32)(value * 255.0f + 0.5f) << (c * 8);
+    }
+    return(result);
+}
+
+function u64
+downsample_reference(u32 filter, Downsample_Image *source, Downsample_Image *destination) {
+    Downsample_Tables tables;
+    downsample_tables(&tables);
+    f32 ratio_x = (f32)source->width / (f32)destination->width;
+    f32 ratio_y = (f32)source->height / (f32)destination->height;
+
+    for (u32 y = 0; y < destination->height; ++y) {
+        Downsample_Axis axis_y = downsample_axis(filter, ratio_y, y);
+        for (u32 x = 0; x < destination->width; ++x) {
+            Downsample_Axis axis_x = downsample_axis(filter, ratio_x, x);
+            f32 colour[4] = { 0 };
+            for (u32 tap_y = 0; tap_y < downsample_taps; ++tap_y) {
+                for (u32 tap_x = 0; tap_x < downsample_taps; ++tap_x) {
+                    f32 texel[4];
+                    downsample_texel(&tables, source, axis_x.first + (s32)tap_x, axis_y.first + (s32)tap_y, texel);
+                    f32 weight = axis_x.weights[tap_x] * axis_y.weights[tap_y];
+                    for (u32 c = 0; c < 4; ++c) {
+                        colour[c] += weight * texel[c];
+                    }
+                }
+            }
+            destination->pixels[(u64)y * destination->pitch + x] = downsample_pack(colour);
+        }
+    }
+
+    u64 result = (u64)destination->width * destination->height * downsample_taps * downsample_taps;
+    return(result);
+}
+
+// Where a pair of taps collapses to: texel-space position (texel i's centre is i + 0.5) and weight.
+function void
+downsample_pair(Downsample_Axis *axis, u32 pair, f32 source_size, f32 *position, f32 *weight) {
+    f32 w0 = axis->weights[2 * pair];
+    f32 w1 = axis->weights[2 * pair + 1];
+    *weight = w0 + w1;
+    *position = (f32)(axis->first + 2 * (s32)pair) + 0.5f + (*weight > 0.0f ? w1 / *weight : 0.0f);
+    // same as the shader clamping uv to source_uv_max
+    if (*position > source_size - 0.5f) {
+        *position = source_size - 0.5f;
+    }
+}
+
+// A bilinear fetch at a texel-space position, the way the sampler filters: after decoding.
+function void
+downsample_bilinear(Downsample_Tables *tables, Downsample_Image *source, f32 x, f32 y, f32 *out) {
+    f32 fx = x - 0.5f;
+    f32 fy = y - 0.5f;
+    s32 x0 = (s32)floorf(fx);
+    s32 y0 = (s32)floorf(fy);
+    f32 ax = fx - (f32)x0;
+    f32 ay = fy - (f32)y0;
+
+    f32 t00[4], t10[4], t01[4], t11[4];
+    downsample_texel(tables, source, x0, y0, t00);
+    downsample_texel(tables, source, x0 + 1, y0, t10);
+    downsample_texel(tables, source, x0, y0 + 1, t01);
+    downsample_texel(tables, source, x0 + 1, y0 + 1, t11);
+    for (u32 c = 0; c < 4; ++c) {
+        f32 top = t00[c] + (t10[c] - t00[c]) * ax;
+        f32 bottom = t01[c] + (t11[c] - t01[c]) * ax;
+        out[c] = top + (bottom - top) * ay;
+    }
+}
+
+function u64
+downsample_fetches(u32 filter, Downsample_Image *source, Downsample_Image *destination) {
+    if (filter == DownsampleFilter_Lanczos) {
+        return(downsample_reference(filter, source, destination));
+    }
+
+    Downsample_Tables tables;
+    downsample_tables(&tables);
+    f32 ratio_x = (f32)source->width / (f32)destination->width;
+    f32 ratio_y = (f32)source->height / (f32)destination->height;
+
+    for (u32 y = 0; y < destination->height; ++y) {
+        Downsample_Axis axis_y = downsample_axis(filter, ratio_y, y);
+        for (u32 x = 0; x < destination->width; ++x) {
+            Downsample_Axis axis_x = downsample_axis(filter, ratio_x, x);
+            f32 colour[4] = { 0 };
+            for (u32 pair_y = 0; pair_y < 2; ++pair_y) {
+                f32 position_y, weight_y;
+                downsample_pair(&axis_y, pair_y, (f32)source->height, &position_y, &weight_y);
+                for (u32 pair_x = 0; pair_x < 2; ++pair_x) {
+                    f32 position_x, weight_x;
+                    downsample_pair(&axis_x, pair_x, (f32)source->width, &position_x, &weight_x);
+                    f32 sample[4];
+                    downsample_bilinear(&tables, source, position_x, position_y, sample);
+                    for (u32 c = 0; c < 4; ++c) {
+                        colour[c] += weight_x * weight_y * sample[c];
+                    }
+                }
+            }
+            destination->pixels[(u64)y * destination->pitch + x] = downsample_pack(colour);
+        }
+    }
+
+    u64 result = (u64)destination->width * destination->height * 4;
+    return(result);
+}
@@ -0,0 +1,57 @@
+#if !defined(S_DOWNSAMPLE_H)
+#define S_DOWNSAMPLE_H
+
+// Resolve of the dynamic resolution target down (or up) to the window, and the CPU reference of
+// the same filters as downsample_ps / downsample_cs.
+//
+// Every destination pixel centre p lands in the source at (dst + 0.5) * ratio. Each axis looks at
+// the 4 source texels around it, weighted by the filter's kernel at distance d / s, where
+// s = max(ratio, 1) / 2. So at 2x the kernels span exactly the 4x4 texels, at 1x they reduce
+// to a copy, and upscaling interpolates. Weights are normalized per axis and the filter is
+// separable, weight(x, y) = wx * wy.
+//
+// Filtering happens in linear light: texels are decoded from sRGB first (the GPU does it in the
+// sampler by reading through an _SRGB view) and the result is encoded again on the way out.
+//
+// Box and tent never have negative weights, so each pair of texels along an axis collapses into
+// one bilinear fetch between them; 2 x 2 fetches cover the 4x4 texels. Lanczos' negative lobe
+// breaks that (the blend point would fall outside the pair), it loads all 16.
+enum {
+    DownsampleFilter_Box,
+    DownsampleFilter_Tent,
+    DownsampleFilter_Lanczos,
+    DownsampleFilter_Count
+};
+
+#define downsample_taps 4
+
+typedef struct {
+    // first of the downsample_taps texels, before clamping to the image
+    s32 first;
+    f32 weights[downsample_taps];
+} Downsample_Axis;
+
+typedef struct {
+    u32 *pixels;
+    u32 width;
+    u32 height;
+    // in pixels
+    u32 pitch;
+} Downsample_Image;
+
+// The DOWNSAMPLE_FILTER define each shader variant is compiled with, null-terminated.
+global Shader_Define downsample_filter_defines[DownsampleFilter_Count][2];
+global char *downsample_filter_names[DownsampleFilter_Count];
+
+function f32 downsample_kernel(u32 filter, f32 x);
+function Downsample_Axis downsample_axis(u32 filter, f32 ratio, u32 destination_index);
+function f32 downsample_srgb_decode(f32 value);
+function f32 downsample_srgb_encode(f32 value);
+
+// Exact, every pixel reads its 16 texels. Returns the texel fetch count.
+function u64 downsample_reference(u32 filter, Downsample_Image *source, Downsample_Image *destination);
+// What the shaders do, bilinear fetches emulated texel by texel for box and tent, loads for
+// Lanczos. Returns the fetch count the GPU would issue.
+function u64 downsample_fetches(u32 filter, Downsample_Image *source, Downsample_Image *destination);
+
+#endif
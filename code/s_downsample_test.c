@@ -0,0 +1,212 @@
+// Downsampling: what the shaders do, emulated fetch by fetch in downsample_fetches, against the
+// exact downsample_reference over test images and ratios, plus known answers: a 1:1 resolve gives
+// back the source bit for bit, and flat or two-tone sources come out at the values worked out by hand.
+
+enum {
+    DownsampleTestImage_Noise,
+    DownsampleTestImage_Gradient,
+    DownsampleTestImage_Checker,
+    DownsampleTestImage_Edge,
+    DownsampleTestImage_Count
+};
+
+global char *downsample_test_image_names[DownsampleTestImage_Count] = {
+    "noise", "gradient", "checker", "edge",
+};
+
+function void
+downsample_test_image(Downsample_Image *image, u32 kind, u64 seed) {
+    Test_Random random = test_random_make(seed);
+    for (u32 y = 0; y < image->height; ++y) {
+        for (u32 x = 0; x < image->width; ++x) {
+            u32 texel = 0;
+            switch (kind) {
+                case DownsampleTestImage_Noise: {
+                    texel = test_random_u32(&random);
+                } break;
+
+                case DownsampleTestImage_Gradient: {
+                    u32 r = x * 255 / (image->width - 1);
+                    u32 g = y * 255 / (image->height - 1);
+                    u32 b = (x + y) * 255 / (image->width + image->height - 2);
+                    texel = r | (g << 8) | (b << 16) | (255u << 24);
+                } break;
+
+                case DownsampleTestImage_Checker: {
+                    texel = ((x ^ y) & 1) ? 0xFFFFFFFF : 0xFF000000;
+                } break;
+
+                case DownsampleTestImage_Edge: {
+                    texel = (x < image->width / 3) ? 0xFF2040E0 : 0x80F0C010;
+                } break;
+            }
+            image->pixels[(u64)y * image->pitch + x] = texel;
+        }
+    }
+}
+
+// Largest difference of any channel, in 8 bit steps, and how many pixels differ at all.
+function u32
+downsample_test_compare(Downsample_Image *a, Downsample_Image *b, u64 *differing) {
+    u32 result = 0;
+    *differing = 0;
+    for (u32 y = 0; y < a->height; ++y) {
+        for (u32 x = 0; x < a->width; ++x) {
+            u32 pa = a->pixels[(u64)y * a->pitch + x];
+            u32 pb = b->pixels[(u64)y * b->pitch + x];
+            *differing += pa != pb;
+            for (u32 c = 0; c < 4; ++c) {
+                s32 difference = (s32)((pa >> (c * 8)) & 255) - (s32)((pb >> (c * 8)) & 255);
+                u32 magnitude = (u32)(difference < 0 ? -difference : difference);
+                result = magnitude > result ? magnitude : result;
+            }
+        }
+    }
+    return(result);
+}
+
+function void
+test_downsample(void) {
+    // the defines the pixel shader is compiled with
+    for (u32 filter = 0; filter < DownsampleFilter_Count; ++filter) {
+        char value[16];
+        snprintf(value, sizeof(value), "%u", filter);
+        Shader_Define *define = downsample_filter_defines[filter];
+        test_check((strcmp(define[0].name, "DOWNSAMPLE_FILTER") == 0) && (strcmp(define[0].value, value) == 0) &&
+                   !define[1].name && !define[1].value, "%s is compiled with %s=%s", downsample_filter_names[filter],
+                   define[0].name, define[0].value);
+    }
+
+    // weights are normalized and at 1:1 every filter is a copy
+    for (u32 filter = 0; filter < DownsampleFilter_Count; ++filter) {
+        f32 ratios[] = { 2.0f, 1.5f, 1.0f, 0.75f, 0.5f, 1.9999f };
+        for (u32 ratio_index = 0; ratio_index < array_count(ratios); ++ratio_index) {
+            for (u32 index = 0; index < 64; ++index) {
+                Downsample_Axis axis = downsample_axis(filter, ratios[ratio_index], index);
+                f32 sum = axis.weights[0] + axis.weights[1] + axis.weights[2] + axis.weights[3];
+                test_check(fabsf(sum - 1.0f) < 1e-5f, "%s at %f: weights of %u sum to %f",
+                           downsample_filter_names[filter], ratios[ratio_index], index, sum);
+                if (ratios[ratio_index] == 1.0f) {
+                    test_check((axis.first + 1 == (s32)index) && (axis.weights[1] == 1.0f),
+                               "%s at 1:1: pixel %u isn't a copy of its texel", downsample_filter_names[filter], index);
+                }
+            }
+        }
+    }
+
+    // sRGB round trips every 8 bit value
+    for (u32 value = 0; value < 256; ++value) {
+        f32 unorm = (f32)value / 255.0f;
+        u32 back = (u32)(downsample_srgb_encode(downsample_srgb_decode(unorm)) * 255.0f + 0.5f);
+        test_check(back == value, "sRGB %u comes back as %u", value, back);
+    }
+
+    u32 source_width = 97;
+    u32 source_height = 61;
+    Downsample_Image source = { 0 };
+    source.width = source_width;
+    source.height = source_height;
+    source.pitch = source_width + 3;
+    source.pixels = (u32 *)calloc((u64)source.pitch * source.height, sizeof(u32));
+
+    u32 sizes[][2] = {
+        { 49, 31 },   // about 2x, the resolve at the top scale
+        { 65, 41 },   // 1.5x
+        { 73, 46 },   // 1.33x
+        { 97, 61 },   // 1:1
+        { 130, 80 },  // upscaling, the bottom of the scale range
+        { 48, 61 },   // different ratios in x and y
+        { 1, 1 },
+    };
+    Downsample_Image reference = { 0 };
+    Downsample_Image fetched = { 0 };
+    reference.pixels = (u32 *)calloc(256 * 256, sizeof(u32));
+    fetched.pixels = (u32 *)calloc(256 * 256, sizeof(u32));
+
+    u32 worst[DownsampleFilter_Count] = { 0 };
+    u64 differing_total[DownsampleFilter_Count] = { 0 };
+    u64 pixel_total = 0;
+    for (u32 kind = 0; kind < DownsampleTestImage_Count; ++kind) {
+        downsample_test_image(&source, kind, 16 + kind);
+        for (u32 size_index = 0; size_index < array_count(sizes); ++size_index) {
+            reference.width = fetched.width = sizes[size_index][0];
+            reference.height = fetched.height = sizes[size_index][1];
+            reference.pitch = fetched.pitch = reference.width;
+            pixel_total += (u64)reference.width * reference.height;
+
+            for (u32 filter = 0; filter < DownsampleFilter_Count; ++filter) {
+                u64 reference_fetches = downsample_reference(filter, &source, &reference);
+                u64 gpu_fetches = downsample_fetches(filter, &source, &fetched);
+                u64 pixels = (u64)reference.width * reference.height;
+                test_check(reference_fetches == pixels * 16, "reference should read 16 texels a pixel");
+                test_check(gpu_fetches == pixels * ((filter == DownsampleFilter_Lanczos) ? 16 : 4),
+                           "%s: %llu fetches for %llu pixels", downsample_filter_names[filter],
+                           (unsigned long long)gpu_fetches, (unsigned long long)pixels);
+
+                u64 differing;
+                u32 difference = downsample_test_compare(&reference, &fetched, &differing);
+                worst[filter] = difference > worst[filter] ? difference : worst[filter];
+                differing_total[filter] += differing;
+
+                if ((reference.width == source.width) && (reference.height == source.height)) {
+                    u64 changed = 0;
+                    for (u32 y = 0; y < source.height; ++y) {
+                        changed += memory_compare(fetched.pixels + (u64)y * fetched.pitch,
+                                                  source.pixels + (u64)y * source.pitch, source.width * sizeof(u32)) != 0;
+                        changed += memory_compare(reference.pixels + (u64)y * reference.pitch,
+                                                  source.pixels + (u64)y * source.pitch, source.width * sizeof(u32)) != 0;
+                    }
+                    test_check(!changed, "%s %s: 1:1 changes %llu rows", downsample_filter_names[filter],
+                               downsample_test_image_names[kind], (unsigned long long)changed);
+                }
+            }
+        }
+    }
+
+    // Bilinear fetches only round differently from summing the texels, so box and tent may be one
+    // step off; Lanczos loads texels just like the reference.
+    test_check(worst[DownsampleFilter_Box] <= 1, "box fetches are %u steps off the reference", worst[DownsampleFilter_Box]);
+    test_check(worst[DownsampleFilter_Tent] <= 1, "tent fetches are %u steps off the reference", worst[DownsampleFilter_Tent]);
+    test_check(!worst[DownsampleFilter_Lanczos], "lanczos loads are %u steps off the reference", worst[DownsampleFilter_Lanczos]);
+    printf("  fetches against the reference over %llu pixels: box %llu off by up to %u, tent %llu by up to %u, lanczos %llu\n",
+           (unsigned long long)pixel_total, (unsigned long long)differing_total[DownsampleFilter_Box], worst[DownsampleFilter_Box],
+           (unsigned long long)differing_total[DownsampleFilter_Tent], worst[DownsampleFilter_Tent],
+           (unsigned long long)differing_total[DownsampleFilter_Lanczos]);
+
+    // Known answers. A flat image stays flat at any ratio, and black next to white averages in
+    // linear light: 0.5 linear is 188 in sRGB, not 128.
+    {
+        u32 flat = 0x80C04020;
+        for (u64 index = 0; index < (u64)source.pitch * source.height; ++index) {
+            source.pixels[index] = flat;
+        }
+        for (u32 filter = 0; filter < DownsampleFilter_Count; ++filter) {
+            for (u32 size_index = 0; size_index < array_count(sizes); ++size_index) {
+                fetched.width = sizes[size_index][0];
+                fetched.height = sizes[size_index][1];
+                fetched.pitch = fetched.width;
+                downsample_fetches(filter, &source, &fetched);
+                u64 wrong = 0;
+                for (u64 index = 0; index < (u64)fetched.width * fetched.height; ++index) {
+                    wrong += fetched.pixels[index] != flat;
+                }
+                test_check(!wrong, "%s to %ux%u: %llu pixels of a flat image changed", downsample_filter_names[filter],
+                           fetched.width, fetched.height, (unsigned long long)wrong);
+            }
+        }
+
+        u32 two_tone[2 * 2] = { 0xFF000000, 0xFFFFFFFF, 0xFF000000, 0xFFFFFFFF };
+        Downsample_Image pair = { two_tone, 2, 2, 2 };
+        u32 out = 0;
+        Downsample_Image one = { &out, 1, 1, 1 };
+        for (u32 filter = 0; filter < DownsampleFilter_Count; ++filter) {
+            downsample_fetches(filter, &pair, &one);
+            test_check(out == 0xFFBCBCBC, "%s: black and white resolve to %08x, expected FFBCBCBC",
+                       downsample_filter_names[filter], out);
+        }
+    }
+
+    free(reference.pixels);
+    free(fetched.pixels);
+    free(source.pixels);
+}
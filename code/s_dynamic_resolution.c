@@ -0,0 +1,78 @@
+function f32
+dynamic_resolution_budget_ms(f32 refresh_hz) {
+    f32 result = dynamic_resolution_budget_fraction * 1000.0f / refresh_hz;
+    return(result);
+}
+
+function void
+dynamic_resolution_init(Dynamic_Resolution *controller, f32 target_ms, f32 min_scale, f32 max_scale) {
+    Dynamic_Resolution zero = { 0 };
+    *controller = zero;
+    controller->target_ms = target_ms;
+    controller->min_scale = min_scale;
+    controller->max_scale = max_scale;
+    controller->kp = 0.12f;
+    controller->ki = 0.15f;
+    controller->kd = 0.04f;
+    controller->max_step = 0.1f;
+    controller->scale = max_scale;
+}
+
+function f32
+dynamic_resolution_update(Dynamic_Resolution *controller, f32 gpu_ms) {
+    // a measurement that's gone wrong shouldn't move anything
+    if (!(gpu_ms > 0.0f) || !(gpu_ms < FLT_MAX)) {
+        return(controller->scale);
+    }
+
+    f32 error = (controller->target_ms - gpu_ms) / controller->target_ms;
+    // past twice the budget the error says nothing more useful, and it would swamp the others
+    if (error < -1.0f) {
+        error = -1.0f;
+    }
+
+    // the first updates have no history, treat it as if the error had always been this
+    f32 previous = controller->update_count > 0 ? controller->error[0] : error;
+    f32 before_previous = controller->update_count > 1 ? controller->error[1] : previous;
+
+    f32 change = controller->kp * (error - previous) +
+        controller->ki * error +
+        controller->kd * (error - 2.0f * previous + before_previous);
+
+    // area can at most halve per update
+    f32 area_ratio = 1.0f + change;
+    if (area_ratio < 0.5f) {
+        area_ratio = 0.5f;
+    }
+
+    f32 scale = controller->scale * sqrtf(area_ratio);
+    if (scale > controller->scale + controller->max_step) {
+        scale = controller->scale + controller->max_step;
+    }
+    if (scale < controller->scale - controller->max_step) {
+        scale = controller->scale - controller->max_step;
+    }
+    if (scale > controller->max_scale) {
+        scale = controller->max_scale;
+    }
+    if (scale < controller->min_scale) {
+        scale = controller->min_scale;
+    }
+
+    controller->scale = scale;
+    controller->error[1] = previous;
+    controller->error[0] = error;
+    ++controller->update_count;
+    return(scale);
+}
+
+function void
+dynamic_resolution_size(f32 scale, u32 width, u32 height, u32 max_width, u32 max_height,
+                        u32 *scaled_width, u32 *scaled_height) {
+    u32 w = (u32)((f32)width * scale + 0.5f);
+    u32 h = (u32)((f32)height * scale + 0.5f);
+    w = w < 1 ? 1 : (w > max_width ? max_width : w);
+    h = h < 1 ? 1 : (h > max_height ? max_height : h);
+    *scaled_width = w;
+    *scaled_height = h;
+}
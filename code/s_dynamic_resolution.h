@@ -0,0 +1,46 @@
+#if !defined(S_DYNAMIC_RESOLUTION_H)
+#define S_DYNAMIC_RESOLUTION_H
+
+// Picks the render scale from measured GPU frame times so the frame stays inside a budget.
+// The scene is drawn into a sub-rectangle of a target allocated at max_scale, so changing the
+// scale never reallocates anything.
+//
+// GPU time goes roughly with the pixel count, i.e. scale^2, so the controller works on the
+// area rather than the scale. It is an incremental (velocity form) PID on the relative error
+// e = (target - measured) / target:
+//   area *= 1 + kp * (e_k - e_k-1) + ki * e_k + kd * (e_k - 2 e_k-1 + e_k-2)
+// The integral lives in the area itself, so clamping the scale is all the anti-windup it needs.
+// Pure arithmetic on what it's fed, so the same measurements always give the same scales.
+
+// Share of one refresh interval the GPU frame is budgeted, the rest is headroom for timing noise
+// and the CPU side of presenting. 14.2ms at 60Hz, 5.9ms at 144Hz.
+#define dynamic_resolution_budget_fraction 0.85f
+
+typedef struct {
+    f32 target_ms;
+    f32 min_scale;
+    f32 max_scale;
+    f32 kp;
+    f32 ki;
+    f32 kd;
+    // the most the scale moves in one update, either way
+    f32 max_step;
+
+    f32 scale;
+    f32 error[2];
+    u32 update_count;
+} Dynamic_Resolution;
+
+// The target_ms for a display refreshing at refresh_hz.
+function f32 dynamic_resolution_budget_ms(f32 refresh_hz);
+// Starts at max_scale. With the three frames of latency GPU timestamps come back with, the gains
+// bring a step in per-pixel cost back within 5% of the budget in about 20 updates and overshoot
+// by under 1%; faster gains ring. See s_dynamic_resolution_test.c.
+function void dynamic_resolution_init(Dynamic_Resolution *controller, f32 target_ms, f32 min_scale, f32 max_scale);
+// Feed one measured GPU frame time, get the scale to render the next frame at.
+function f32 dynamic_resolution_update(Dynamic_Resolution *controller, f32 gpu_ms);
+// Pixel size of the sub-rectangle for scale, at least 1x1 and never past max_width/max_height.
+function void dynamic_resolution_size(f32 scale, u32 width, u32 height, u32 max_width, u32 max_height,
+                                      u32 *scaled_width, u32 *scaled_height);
+
+#endif
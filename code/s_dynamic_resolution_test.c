@@ -0,0 +1,198 @@
+// Dynamic resolution: the controller against a simulated GPU whose frame time is a fixed part plus
+// a per-pixel part going with scale^2, measured d3d11_gpu_timer_frames - 1 frames late the way the
+// timestamp queries come back. It has to settle on the budget, hold still there, sit at a clamp
+// when the budget can't be met, and give the same scales for the same measurements.
+
+#define dynamic_resolution_test_latency 3
+
+typedef struct {
+    f32 fixed_ms;
+    // frame time of the per-pixel part at scale 1
+    f32 pixel_ms;
+    // relative noise on every measurement, 0 for none
+    f32 noise;
+    Test_Random random;
+    // scales of the frames still in flight, oldest first
+    f32 in_flight[dynamic_resolution_test_latency];
+} Dynamic_Resolution_Plant;
+
+function void
+dynamic_resolution_test_plant_init(Dynamic_Resolution_Plant *plant, f32 fixed_ms, f32 pixel_ms, f32 noise, f32 scale, u64 seed) {
+    plant->fixed_ms = fixed_ms;
+    plant->pixel_ms = pixel_ms;
+    plant->noise = noise;
+    plant->random = test_random_make(seed);
+    for (u32 frame = 0; frame < dynamic_resolution_test_latency; ++frame) {
+        plant->in_flight[frame] = scale;
+    }
+}
+
+// Renders a frame at scale and returns the time of the oldest frame in flight.
+function f32
+dynamic_resolution_test_frame(Dynamic_Resolution_Plant *plant, f32 scale) {
+    f32 oldest = plant->in_flight[0];
+    for (u32 frame = 1; frame < dynamic_resolution_test_latency; ++frame) {
+        plant->in_flight[frame - 1] = plant->in_flight[frame];
+    }
+    plant->in_flight[dynamic_resolution_test_latency - 1] = scale;
+
+    f32 result = plant->fixed_ms + plant->pixel_ms * oldest * oldest;
+    if (plant->noise > 0.0f) {
+        result *= 1.0f + test_random_f32(&plant->random, -plant->noise, plant->noise);
+    }
+    return(result);
+}
+
+// Scale at which the plant takes exactly target_ms.
+function f32
+dynamic_resolution_test_settled_scale(Dynamic_Resolution_Plant *plant, f32 target_ms) {
+    f32 result = sqrtf((target_ms - plant->fixed_ms) / plant->pixel_ms);
+    return(result);
+}
+
+function void
+test_dynamic_resolution(void) {
+    f32 target_ms = dynamic_resolution_budget_ms(60.0f);
+    test_check(fabsf(target_ms - 0.85f * 1000.0f / 60.0f) < 1e-4f, "60Hz budget is %f ms", target_ms);
+    test_check(dynamic_resolution_budget_ms(144.0f) < dynamic_resolution_budget_ms(60.0f), "faster displays get less time");
+
+    // Convergence from the max_scale start, over per-pixel costs that put the settled scale
+    // anywhere in [min_scale, max_scale]. Settled means within 2% of the budget from then on.
+    u32 worst_settle = 0;
+    f32 worst_overshoot = 0.0f;
+    for (u32 cost_index = 0; cost_index < 64; ++cost_index) {
+        f32 settled_scale = 0.55f + 1.4f * (f32)cost_index / 63.0f;
+        f32 fixed_ms = 2.0f;
+        f32 pixel_ms = (target_ms - fixed_ms) / (settled_scale * settled_scale);
+
+        Dynamic_Resolution controller;
+        dynamic_resolution_init(&controller, target_ms, 0.5f, 2.0f);
+        Dynamic_Resolution_Plant plant;
+        dynamic_resolution_test_plant_init(&plant, fixed_ms, pixel_ms, 0.0f, controller.scale, 1);
+
+        u32 settle = 0;
+        f32 overshoot = 0.0f;
+        for (u32 frame = 0; frame < 200; ++frame) {
+            f32 gpu_ms = dynamic_resolution_test_frame(&plant, controller.scale);
+            dynamic_resolution_update(&controller, gpu_ms);
+            if (fabsf(gpu_ms - target_ms) > 0.02f * target_ms) {
+                settle = frame + 1;
+            }
+            // it comes down from max_scale, so dropping under the settled scale is ringing
+            f32 under = (settled_scale - controller.scale) / settled_scale;
+            overshoot = under > overshoot ? under : overshoot;
+        }
+        test_check(fabsf(controller.scale - settled_scale) <= 0.002f * settled_scale,
+                   "settled at scale %f, the budget is met at %f", controller.scale, settled_scale);
+        worst_settle = settle > worst_settle ? settle : worst_settle;
+        worst_overshoot = overshoot > worst_overshoot ? overshoot : worst_overshoot;
+    }
+    test_check(worst_settle <= 30, "took %u frames to settle on the budget", worst_settle);
+    test_check(worst_overshoot <= 0.01f, "overshot the settled scale by %f", worst_overshoot);
+
+    // A step in per-pixel cost once settled, e.g. the camera turning towards heavy shading, and
+    // back. Counted in frames until the measurements are back within 5% of the budget.
+    u32 worst_step = 0;
+    f32 steps[] = { 1.5f, 2.0f, 0.5f, 0.75f };
+    for (u32 step_index = 0; step_index < array_count(steps); ++step_index) {
+        f32 pixel_ms = (target_ms - 2.0f) / (1.2f * 1.2f);
+        Dynamic_Resolution controller;
+        dynamic_resolution_init(&controller, target_ms, 0.5f, 2.0f);
+        Dynamic_Resolution_Plant plant;
+        dynamic_resolution_test_plant_init(&plant, 2.0f, pixel_ms, 0.0f, controller.scale, 1);
+        for (u32 frame = 0; frame < 200; ++frame) {
+            dynamic_resolution_update(&controller, dynamic_resolution_test_frame(&plant, controller.scale));
+        }
+
+        plant.pixel_ms *= steps[step_index];
+        u32 settle = 0;
+        for (u32 frame = 0; frame < 200; ++frame) {
+            f32 gpu_ms = dynamic_resolution_test_frame(&plant, controller.scale);
+            dynamic_resolution_update(&controller, gpu_ms);
+            if (fabsf(gpu_ms - target_ms) > 0.05f * target_ms) {
+                settle = frame + 1;
+            }
+        }
+        test_check(fabsf(controller.scale - dynamic_resolution_test_settled_scale(&plant, target_ms)) <= 0.002f,
+                   "cost step x%.2f settled at scale %f", steps[step_index], controller.scale);
+        worst_step = settle > worst_step ? settle : worst_step;
+    }
+    test_check(worst_step <= 25, "took %u frames to recover from a cost step", worst_step);
+
+    // Budgets that can't be met, or are met with room to spare, sit at the clamp, and leaving the
+    // clamp doesn't wait for a wound up integral.
+    {
+        Dynamic_Resolution controller;
+        dynamic_resolution_init(&controller, target_ms, 0.5f, 2.0f);
+        Dynamic_Resolution_Plant plant;
+        dynamic_resolution_test_plant_init(&plant, 2.0f, 200.0f, 0.0f, controller.scale, 1);
+        for (u32 frame = 0; frame < 500; ++frame) {
+            dynamic_resolution_update(&controller, dynamic_resolution_test_frame(&plant, controller.scale));
+        }
+        test_check(controller.scale == 0.5f, "an impossible budget left scale at %f", controller.scale);
+
+        plant.pixel_ms = 0.5f;
+        u32 frames_to_max = 0;
+        for (u32 frame = 0; (frame < 200) && (controller.scale < 2.0f); ++frame) {
+            dynamic_resolution_update(&controller, dynamic_resolution_test_frame(&plant, controller.scale));
+            frames_to_max = frame + 1;
+        }
+        test_check(controller.scale == 2.0f, "a cheap frame left scale at %f", controller.scale);
+        test_check(frames_to_max <= 30, "took %u frames to leave the bottom clamp", frames_to_max);
+    }
+
+    // Noisy measurements hold the scale near the settled one, and the same measurements always
+    // give the same scales.
+    {
+        f32 settled_scale = 1.3f;
+        f32 pixel_ms = (target_ms - 2.0f) / (settled_scale * settled_scale);
+        Dynamic_Resolution a, b;
+        dynamic_resolution_init(&a, target_ms, 0.5f, 2.0f);
+        dynamic_resolution_init(&b, target_ms, 0.5f, 2.0f);
+        Dynamic_Resolution_Plant plant_a, plant_b;
+        dynamic_resolution_test_plant_init(&plant_a, 2.0f, pixel_ms, 0.1f, a.scale, 23);
+        dynamic_resolution_test_plant_init(&plant_b, 2.0f, pixel_ms, 0.1f, b.scale, 23);
+
+        b32 same = True;
+        f32 worst_wander = 0.0f;
+        for (u32 frame = 0; frame < 5000; ++frame) {
+            f32 scale_a = dynamic_resolution_update(&a, dynamic_resolution_test_frame(&plant_a, a.scale));
+            f32 scale_b = dynamic_resolution_update(&b, dynamic_resolution_test_frame(&plant_b, b.scale));
+            same = same && (memory_compare(&scale_a, &scale_b, sizeof(f32)) == 0);
+            if (frame >= 100) {
+                f32 wander = fabsf(scale_a - settled_scale) / settled_scale;
+                worst_wander = wander > worst_wander ? wander : worst_wander;
+            }
+        }
+        test_check(same, "the same measurements gave different scales");
+        test_check(worst_wander <= 0.1f, "10%% noise moved the scale %f from where it settles", worst_wander);
+        printf("  settles in %u frames, overshoot %.4f, cost steps in %u, 10%% noise wanders %.3f\n",
+               worst_settle, worst_overshoot, worst_step, worst_wander);
+    }
+
+    // measurements that have gone wrong don't move anything
+    {
+        Dynamic_Resolution controller;
+        dynamic_resolution_init(&controller, target_ms, 0.5f, 2.0f);
+        dynamic_resolution_update(&controller, 30.0f);
+        Dynamic_Resolution before = controller;
+        f32 bad[] = { 0.0f, -1.0f, NAN, INFINITY, -INFINITY };
+        for (u32 bad_index = 0; bad_index < array_count(bad); ++bad_index) {
+            dynamic_resolution_update(&controller, bad[bad_index]);
+        }
+        test_check(memory_compare(&before, &controller, sizeof(controller)) == 0, "a bad measurement changed the controller");
+    }
+
+    // sizes stay inside the target and never reach zero
+    {
+        u32 w, h;
+        dynamic_resolution_size(2.0f, 1280, 720, 2560, 1440, &w, &h);
+        test_check((w == 2560) && (h == 1440), "2x of 1280x720 is %ux%u", w, h);
+        dynamic_resolution_size(0.5f, 1281, 721, 2562, 1442, &w, &h);
+        test_check((w == 641) && (h == 361), "0.5x of 1281x721 is %ux%u", w, h);
+        dynamic_resolution_size(2.01f, 1280, 720, 2560, 1440, &w, &h);
+        test_check((w == 2560) && (h == 1440), "past max_scale gave %ux%u", w, h);
+        dynamic_resolution_size(0.0001f, 100, 100, 200, 200, &w, &h);
+        test_check((w == 1) && (h == 1), "tiny scale gave %ux%u", w, h);
+    }
+}
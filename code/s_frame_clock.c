@@ -0,0 +1,36 @@
+function void
+frame_clock_init(Frame_Clock *clock, u64 ticks_per_second, u32 update_hz, u32 max_steps) {
+    Frame_Clock zero = { 0 };
+    *clock = zero;
+    clock->ticks_per_second = ticks_per_second;
+    clock->update_hz = update_hz;
+    clock->max_steps = max_steps ? max_steps : 1;
+}
+
+function u32
+frame_clock_advance(Frame_Clock *clock, u64 elapsed_ticks) {
+    // a second is past any backlog worth keeping, and keeps the product below overflow
+    if (elapsed_ticks > clock->ticks_per_second) {
+        elapsed_ticks = clock->ticks_per_second;
+    }
+    clock->accumulator += elapsed_ticks * clock->update_hz;
+
+    u64 steps = clock->accumulator / clock->ticks_per_second;
+    if (steps > clock->max_steps) {
+        clock->dropped_steps += steps - clock->max_steps;
+        steps = clock->max_steps;
+        clock->accumulator %= clock->ticks_per_second;
+    } else {
+        clock->accumulator -= steps * clock->ticks_per_second;
+    }
+    clock->step_count += steps;
+
+    u32 result = (u32)steps;
+    return(result);
+}
+
+function f32
+frame_clock_alpha(Frame_Clock *clock) {
+    f32 result = (f32)((f64)clock->accumulator / (f64)clock->ticks_per_second);
+    return(result);
+}
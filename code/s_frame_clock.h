@@ -0,0 +1,30 @@
+#if !defined(S_FRAME_CLOCK_H)
+#define S_FRAME_CLOCK_H
+
+// Fixed simulation steps under a variable frame rate. Every frame feeds in the time since the
+// last one and gets back how many fixed steps to run; what's left over is how far the frame sits
+// between the last two steps, the alpha the renderer blends them with.
+//
+// The accumulator counts in 1 / (ticks_per_second * update_hz) seconds, so a step is exactly
+// ticks_per_second of them and nothing drifts however long it runs. Pure arithmetic on what it's
+// fed, so the same frame times always give the same steps.
+
+typedef struct {
+    u64 ticks_per_second;
+    u64 update_hz;
+    // past this many steps in one frame the backlog is dropped, the game slows down rather than
+    // spending the next frame catching up on the last
+    u32 max_steps;
+
+    u64 accumulator;
+    u64 step_count;
+    u64 dropped_steps;
+} Frame_Clock;
+
+function void frame_clock_init(Frame_Clock *clock, u64 ticks_per_second, u32 update_hz, u32 max_steps);
+// elapsed_ticks since the last call. Returns the number of steps to run this frame.
+function u32 frame_clock_advance(Frame_Clock *clock, u64 elapsed_ticks);
+// How far into the next step the frame is, in [0, 1].
+function f32 frame_clock_alpha(Frame_Clock *clock);
+
+#endif
@@ -0,0 +1,169 @@
+// Frame clock: an hour of frames at display rates from 24 to 1000Hz has to come out at exactly
+// an hour of game steps, jittered frame times at exactly what their sum is worth, and hitches
+// past max_steps drop the backlog instead of carrying it. Checked against the invariant
+// step_count * ticks_per_second + accumulator == elapsed * update_hz, with nothing dropped.
+
+// Ticks of frame frame_index at frames_num / frames_den Hz, so that the first n frames add up to
+// exactly floor(n * ticks_per_second * frames_den / frames_num).
+function u64
+frame_clock_test_frame_ticks(u64 ticks_per_second, u64 frames_num, u64 frames_den, u64 frame_index) {
+    u64 begin = (frame_index * ticks_per_second * frames_den) / frames_num;
+    u64 end = ((frame_index + 1) * ticks_per_second * frames_den) / frames_num;
+    u64 result = end - begin;
+    return(result);
+}
+
+function void
+test_frame_clock(void) {
+    // Linux's clock_gettime, a typical QueryPerformanceFrequency, and the ACPI timer's odd one
+    u64 tick_rates[] = { 1000000000, 10000000, 3579545 };
+    // display rates as num / den Hz, NTSC's 59.94 included
+    u64 display_rates[][2] = {
+        { 24, 1 }, { 30, 1 }, { 60000, 1001 }, { 60, 1 }, { 75, 1 }, { 120, 1 }, { 144, 1 }, { 165, 1 },
+        { 240, 1 }, { 1000, 1 },
+    };
+
+    // an hour at every display rate
+    for (u32 tick_index = 0; tick_index < array_count(tick_rates); ++tick_index) {
+        u64 ticks_per_second = tick_rates[tick_index];
+        for (u32 rate_index = 0; rate_index < array_count(display_rates); ++rate_index) {
+            u64 frames_num = display_rates[rate_index][0];
+            u64 frames_den = display_rates[rate_index][1];
+            // whole frames in an hour, and the ticks they cover
+            u64 frame_count = (3600 * frames_num) / frames_den;
+            u64 elapsed = (frame_count * ticks_per_second * frames_den) / frames_num;
+
+            // Half a step in first. Frames that start on a step boundary land a tick either side
+            // of the next ones, and would run 0 then 2 steps where the display runs 1.
+            Frame_Clock clock;
+            frame_clock_init(&clock, ticks_per_second, game_update_hz, game_max_steps_per_frame);
+            u64 phase = ticks_per_second / (2 * game_update_hz);
+            frame_clock_advance(&clock, phase);
+            elapsed += phase;
+            // a frame runs floor or ceil of update_hz / display rate steps, never anything else
+            u64 min_steps = (game_update_hz * frames_den) / frames_num;
+            u64 max_steps = (game_update_hz * frames_den + frames_num - 1) / frames_num;
+            u64 odd_frames = 0;
+            u64 bad_alpha = 0;
+            for (u64 frame = 0; frame < frame_count; ++frame) {
+                u32 steps = frame_clock_advance(&clock, frame_clock_test_frame_ticks(ticks_per_second, frames_num, frames_den, frame));
+                odd_frames += (steps < min_steps) || (steps > max_steps);
+                // a tick short of a step rounds to 1 in f32, which the header allows
+                f32 alpha = frame_clock_alpha(&clock);
+                bad_alpha += !(alpha >= 0.0f) || !(alpha <= 1.0f);
+            }
+
+            char *rate_name = (frames_den == 1) ? "" : " (59.94)";
+            test_check((clock.step_count * ticks_per_second + clock.accumulator == elapsed * game_update_hz) &&
+                       !clock.dropped_steps, "%llu ticks/s, %llu/%llu Hz%s: %llu steps and %llu dropped for %llu ticks",
+                       (unsigned long long)ticks_per_second, (unsigned long long)frames_num, (unsigned long long)frames_den,
+                       rate_name, (unsigned long long)clock.step_count, (unsigned long long)clock.dropped_steps,
+                       (unsigned long long)elapsed);
+            if (frames_den == 1) {
+                // whole Hz rates cover the hour exactly
+                test_check(clock.step_count == 3600 * game_update_hz, "%llu Hz: %llu steps in an hour",
+                           (unsigned long long)frames_num, (unsigned long long)clock.step_count);
+            }
+            test_check(!odd_frames, "%llu/%llu Hz: %llu frames ran other than %llu or %llu steps", (unsigned long long)frames_num,
+                       (unsigned long long)frames_den, (unsigned long long)odd_frames,
+                       (unsigned long long)min_steps, (unsigned long long)max_steps);
+            test_check(!bad_alpha, "%llu/%llu Hz: %llu alphas outside [0, 1]", (unsigned long long)frames_num,
+                       (unsigned long long)frames_den, (unsigned long long)bad_alpha);
+        }
+    }
+
+    // Jittered frame times, up to half a frame either way around 60Hz and with the odd 0 tick
+    // frame: every frame has run exactly the steps the time so far is worth.
+    for (u32 tick_index = 0; tick_index < array_count(tick_rates); ++tick_index) {
+        u64 ticks_per_second = tick_rates[tick_index];
+        Test_Random random = test_random_make(23 + tick_index);
+        Frame_Clock clock;
+        frame_clock_init(&clock, ticks_per_second, game_update_hz, game_max_steps_per_frame);
+        u64 elapsed = 0;
+        u64 broken = 0;
+        f64 worst_alpha_error = 0.0;
+        for (u32 frame = 0; frame < 1000000; ++frame) {
+            u64 frame_ticks = ticks_per_second / 60;
+            u64 jitter = test_random_u32(&random) % frame_ticks;
+            frame_ticks = frame_ticks / 2 + jitter;
+            if ((test_random_u32(&random) & 255) == 0) {
+                frame_ticks = 0;
+            }
+            elapsed += frame_ticks;
+
+            u64 steps_before = clock.step_count;
+            u32 steps = frame_clock_advance(&clock, frame_ticks);
+            broken += (clock.step_count != steps_before + steps);
+            broken += (clock.step_count != (elapsed * game_update_hz) / ticks_per_second);
+            broken += (clock.accumulator != (elapsed * game_update_hz) % ticks_per_second);
+
+            f64 alpha = (f64)((elapsed * game_update_hz) % ticks_per_second) / (f64)ticks_per_second;
+            f64 alpha_error = fabs((f64)frame_clock_alpha(&clock) - alpha);
+            worst_alpha_error = alpha_error > worst_alpha_error ? alpha_error : worst_alpha_error;
+        }
+        test_check(!broken && !clock.dropped_steps, "%llu ticks/s jittered: %llu frames off the exact step count, %llu dropped",
+                   (unsigned long long)ticks_per_second, (unsigned long long)broken, (unsigned long long)clock.dropped_steps);
+        test_check(worst_alpha_error < 1e-7, "%llu ticks/s jittered: alpha off by %g", (unsigned long long)ticks_per_second,
+                   worst_alpha_error);
+    }
+
+    // Hitches. Anything past max_steps is dropped, and a second is as long as a frame counts for.
+    for (u32 tick_index = 0; tick_index < array_count(tick_rates); ++tick_index) {
+        u64 ticks_per_second = tick_rates[tick_index];
+        struct {
+            // in milliseconds
+            u64 hitch_ms;
+            u32 steps;
+            u64 dropped;
+        } hitches[] = {
+            { 3000, game_max_steps_per_frame, 60 - game_max_steps_per_frame },
+            { 1000, game_max_steps_per_frame, 60 - game_max_steps_per_frame },
+            { 200, game_max_steps_per_frame, 12 - game_max_steps_per_frame },
+            // exactly max_steps runs them all
+            { 1000 * game_max_steps_per_frame / game_update_hz, game_max_steps_per_frame, 0 },
+            { 100, 6, 0 },
+        };
+        for (u32 hitch_index = 0; hitch_index < array_count(hitches); ++hitch_index) {
+            Frame_Clock clock;
+            frame_clock_init(&clock, ticks_per_second, game_update_hz, game_max_steps_per_frame);
+            // settle into 60Hz frames a quarter step out of phase
+            frame_clock_advance(&clock, ticks_per_second / (4 * game_update_hz));
+            for (u32 frame = 0; frame < 100; ++frame) {
+                frame_clock_advance(&clock, ticks_per_second / game_update_hz);
+            }
+            u64 steps_before = clock.step_count;
+            u64 accumulator_before = clock.accumulator;
+
+            u32 steps = frame_clock_advance(&clock, hitches[hitch_index].hitch_ms * ticks_per_second / 1000);
+            test_check((steps == hitches[hitch_index].steps) && (clock.dropped_steps == hitches[hitch_index].dropped) &&
+                       (clock.step_count == steps_before + steps),
+                       "%llu ticks/s, %llu ms hitch: %u steps and %llu dropped, expected %u and %llu",
+                       (unsigned long long)ticks_per_second, (unsigned long long)hitches[hitch_index].hitch_ms, steps,
+                       (unsigned long long)clock.dropped_steps, hitches[hitch_index].steps,
+                       (unsigned long long)hitches[hitch_index].dropped);
+            // the part of a step that was already under way carries over, the backlog doesn't
+            test_check(clock.accumulator < ticks_per_second, "%llu ms hitch: a step or more left over",
+                       (unsigned long long)hitches[hitch_index].hitch_ms);
+            if (hitches[hitch_index].dropped) {
+                test_check(clock.accumulator == accumulator_before, "%llu ms hitch: the step under way moved from %llu to %llu",
+                           (unsigned long long)hitches[hitch_index].hitch_ms, (unsigned long long)accumulator_before,
+                           (unsigned long long)clock.accumulator);
+            }
+
+            // and the frames after it are back to one step each
+            u64 odd = 0;
+            for (u32 frame = 0; frame < 10; ++frame) {
+                odd += frame_clock_advance(&clock, ticks_per_second / game_update_hz) != 1;
+            }
+            test_check(!odd, "%llu ms hitch: %llu frames after it didn't run one step",
+                       (unsigned long long)hitches[hitch_index].hitch_ms, (unsigned long long)odd);
+        }
+    }
+
+    // nothing elapsed, nothing runs
+    {
+        Frame_Clock clock;
+        frame_clock_init(&clock, 1000000000, game_update_hz, game_max_steps_per_frame);
+        test_check((frame_clock_advance(&clock, 0) == 0) && (frame_clock_alpha(&clock) == 0.0f), "a zero tick frame ran a step");
+    }
+}
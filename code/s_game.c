@@ -0,0 +1,407 @@
+global f32 game_cube_vertices[game_cube_vertex_count * 6] = {
+	// FRONT			
+	-0.5f, -0.5f, -0.5f, 	0.0f, 0.0f, -1.0f,
+	-0.5f,  0.5f, -0.5f,	0.0f, 0.0f, -1.0f,
+    0.5f,  0.5f, -0.5f,	0.0f, 0.0f, -1.0f,
+    
+    0.5f,  0.5f, -0.5f,	0.0f, 0.0f, -1.0f,
+    0.5f, -0.5f, -0.5f,	0.0f, 0.0f, -1.0f,
+	-0.5f, -0.5f, -0.5f,	0.0f, 0.0f, -1.0f,
+    
+	// LEFT
+	-0.5f, -0.5f,  0.5f,	-1.0f, 0.0f, 0.0f,
+	-0.5f,  0.5f,  0.5f,	-1.0f, 0.0f, 0.0f,
+	-0.5f,  0.5f, -0.5f,	-1.0f, 0.0f, 0.0f,
+    
+	-0.5f,  0.5f, -0.5f,	-1.0f, 0.0f, 0.0f,
+	-0.5f, -0.5f, -0.5f,	-1.0f, 0.0f, 0.0f,
+	-0.5f, -0.5f,  0.5f,	-1.0f, 0.0f, 0.0f,
+    
+	// BACK
+    0.5f, -0.5f,  0.5f,		0.0f, 0.0f, 1.0f,
+    0.5f,  0.5f,  0.5f,	0.0f, 0.0f, 1.0f,
+	-0.5f,  0.5f,  0.5f,	0.0f, 0.0f, 1.0f,
+    
+	-0.5f,  0.5f,  0.5f,	0.0f, 0.0f, 1.0f,
+	-0.5f, -0.5f,  0.5f,	0.0f, 0.0f, 1.0f,
+    0.5f, -0.5f,  0.5f,	0.0f, 0.0f, 1.0f,
+    
+	// RIGHT
+    0.5f, -0.5f, -0.5f,		1.0f, 0.0f, 0.0f,
+    0.5f,  0.5f, -0.5f,		1.0f, 0.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,		1.0f, 0.0f, 0.0f,
+    
+    0.5f,  0.5f,  0.5f,		1.0f, 0.0f, 0.0f,
+    0.5f, -0.5f,  0.5f,		1.0f, 0.0f, 0.0f,
+    0.5f, -0.5f, -0.5f,		1.0f, 0.0f, 0.0f,
+    
+	// Top
+	-0.5f,  0.5f, -0.5f,	0.0f, 1.0f, 0.0f,
+	-0.5f,  0.5f,  0.5f,	0.0f, 1.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,		0.0f, 1.0f, 0.0f,
+    
+    0.5f,  0.5f,  0.5f,		0.0f, 1.0f, 0.0f,
+    0.5f,  0.5f, -0.5f,		0.0f, 1.0f, 0.0f,
+	-0.5f,  0.5f, -0.5f,	0.0f, 1.0f, 0.0f,
+    
+	// Bottom
+	-0.5f, -0.5f,  0.5f,	0.0f, -1.0f, 0.0f,
+	-0.5f, -0.5f, -0.5f,	0.0f, -1.0f, 0.0f,
+    0.5f, -0.5f, -0.5f,		0.0f, -1.0f, 0.0f,
+    
+    0.5f, -0.5f, -0.5f,		0.0f, -1.0f, 0.0f,
+    0.5f, -0.5f,  0.5f,		0.0f, -1.0f, 0.0f,
+	-0.5f, -0.5f,  0.5f,	0.0f, -1.0f, 0.0f,
+};
+
+function void
+game_init(Game_State *game) {
+    Game_State zero = { 0 };
+    *game = zero;
+    
+	// Ok, so rotations in R^3 (esp. camera)
+	// We discuss Euler Angles, namely, pitch, yaw, and roll.
+	// Euler angles are a mechanism for creating a rotation through a sequence
+	// of three simpler rotations called pitch, yaw, and roll. 
+	// Pitching rotates an object around the x-axis.
+	// 	- pointing up or down (yes guesture)
+	// Yawing rotates an object around the xz-plane or around the y-axis.
+	// 	- turning left or right (no guesture)
+	// Rolling rotates an object around the xy-plane or around the z-axis.
+	//	- tilting your head left and right.
+	//
+	//	Rotation matrices are orthonormal. Thus its inverse is its transpose.
+	//
+	//	We now derive the camera basis. We use pitch and yaw and radius r (sphere coords).
+	//	1. Suppose you're at the origin. Look straight ahead towards the x-axis.
+	//	2. The y-axis points from your feet to your head. Point your right-arm up the y-axis.
+	//	3. Rotate your body counterclockwise by the angle yaw (azimuth).
+	//	4. Rotate your right-arm downward by angle pitch (zenith)
+	//	5. Displace by the distance r.
+	//	Now we convert from sphere coords to cartesian coords.
+	game->camera_p = v3f_make(0.0f, 0.0f, 0.0f);
+	game->camera_theta = 90.0f; // nod yes; Rotate around x.
+	game->camera_phi = 90.0f; // no; rotate around y
+    
+    game->dt_step = 1.0f / (f32)game_update_hz;
+    game->rot_accum = 0.0f;
+    game->previous_camera_p = game->camera_p;
+    game->previous_rot_accum = game->rot_accum;
+    
+    // Retained: instances persist across frames and only what changed is uploaded.
+    r3d_scene_init(&game->scene, 1 << 24, R3D_Layout_SoA);
+    game->big_cube = r3d_scene_add(&game->scene, v3f_make(0.0f, 0.0f, 8.0f), quat_identity(),
+                                   v3f_make(6.0f, 6.0f, 6.0f), v4f_make(0.0f, 0.5f, 0.8f, 1.0f));
+    game->small_cube = r3d_scene_add(&game->scene, v3f_make(6.0f, 0.0f, 4.0f), quat_identity(),
+                                     v3f_make(1.0f, 1.0f, 1.0f), v4f_make(0.6f, 0.5f, 0.0f, 1.0f));
+    for (u32 light_index = 0; light_index < array_count(game->light_gizmos); ++light_index) {
+        game->light_gizmos[light_index] = r3d_scene_add(&game->scene, v3f_make(0.0f, 0.0f, 0.0f), quat_identity(),
+                                                        v3f_make(0.2f, 0.2f, 0.2f), v4f_make(1.0f, 1.0f, 1.0f, 1.0f));
+    }
+    
+    game->mesh_arena = arena_reserve(megabytes(1));
+    Arena scratch = arena_reserve(megabytes(1));
+    Mesh cube = mesh_build(&game->mesh_arena, &scratch, (Mesh_Vertex *)game_cube_vertices, game_cube_vertex_count);
+    game->constants.position_scale = v3f_make(1.0f, 1.0f, 1.0f);
+    arena_release(&scratch);
+    // address space only, pages are committed as meshes come in
+    game->lod_arena = arena_reserve(gigabytes(8));
+    game->geometry_arena = arena_reserve(gigabytes(8));
+    game_add_mesh(game, cube);
+    
+    // the gizmos mark lights rather than take them
+    R3D_Tag gizmo_tag = { 0 };
+    gizmo_tag.shader = GameShader_Gooch;
+    for (u32 light_index = 0; light_index < array_count(game->light_gizmos); ++light_index) {
+        r3d_scene_set_tag(&game->scene, game->light_gizmos[light_index], gizmo_tag);
+    }
+    
+    game->light_arena = arena_reserve(game_light_max * sizeof(Light));
+    game->light_count = array_count(game->light_gizmos);
+    game->lights = arena_push_array(&game->light_arena, Light, game->light_count);
+}
+
+function u32
+game_add_mesh(Game_State *game, Mesh mesh) {
+    if (game->mesh_count == game_mesh_max) {
+        os_fatal_error(str8("Too many meshes"));
+    }
+    u32 result = game->mesh_count++;
+    game->meshes[result] = mesh;
+    game->mesh_radius = mesh.radius > game->mesh_radius ? mesh.radius : game->mesh_radius;
+    // the simplifier's scratch is a few times the mesh
+    u64 mesh_size = (u64)mesh.vertex_count * sizeof(Mesh_Vertex) + (u64)mesh.index_count * sizeof(u32);
+    Arena scratch = arena_reserve(mesh_size * 16 + megabytes(1));
+    game->mesh_lods[result] = mesh_lod_build(&game->lod_arena, &scratch, game->meshes + result);
+    arena_release(&scratch);
+    
+    // every chain again, back to back
+    u32 vertex_count = 0;
+    u32 index_count = 0;
+    for (u32 mesh_index = 0; mesh_index < game->mesh_count; ++mesh_index) {
+        game->geometry_base_vertex[mesh_index] = vertex_count;
+        game->geometry_first_index[mesh_index] = index_count;
+        vertex_count += game->mesh_lods[mesh_index].combined.vertex_count;
+        index_count += game->mesh_lods[mesh_index].combined.index_count;
+    }
+    arena_clear(&game->geometry_arena);
+    game->geometry.vertices = arena_push_array(&game->geometry_arena, Mesh_Vertex, vertex_count);
+    game->geometry.vertex_count = vertex_count;
+    game->geometry.indices = arena_push_array(&game->geometry_arena, u32, index_count);
+    game->geometry.index_count = index_count;
+    game->geometry.radius = game->mesh_radius;
+    if (!game->geometry.vertices || !game->geometry.indices) {
+        os_fatal_error(str8("Out of mesh memory"));
+    }
+    for (u32 mesh_index = 0; mesh_index < game->mesh_count; ++mesh_index) {
+        Mesh *combined = &game->mesh_lods[mesh_index].combined;
+        memory_copy(game->geometry.vertices + game->geometry_base_vertex[mesh_index], combined->vertices,
+                    combined->vertex_count * sizeof(Mesh_Vertex));
+        memory_copy(game->geometry.indices + game->geometry_first_index[mesh_index], combined->indices,
+                    combined->index_count * sizeof(u32));
+    }
+    return(result);
+}
+
+function void
+game_add_mesh_pack(Game_State *game, Mesh_Pack *pack) {
+    R3D_Tag tag = { 0 };
+    for (u32 mesh_index = 0; mesh_index < pack->mesh_count; ++mesh_index) {
+        u32 mesh = game_add_mesh(game, mesh_pack_get(pack, mesh_index));
+        if (mesh_index == 0) {
+            tag.mesh = (u16)mesh;
+        }
+    }
+    if (pack->mesh_count) {
+        r3d_scene_set_tag(&game->scene, game->big_cube, tag);
+        r3d_scene_set_tag(&game->scene, game->small_cube, tag);
+    }
+}
+
+function Mesh
+game_mesh_level(Game_State *game, u32 mesh, u32 level) {
+    Mesh_LOD_Chain *chain = game->mesh_lods + mesh;
+    Mesh result;
+    result.vertices = game->geometry.vertices + game->geometry_base_vertex[mesh] + chain->base_vertex[level];
+    result.vertex_count = chain->vertex_count[level];
+    result.indices = game->geometry.indices + game->geometry_first_index[mesh] + chain->first_index[level];
+    result.index_count = chain->index_count[level];
+    result.radius = chain->combined.radius;
+    return(result);
+}
+
+function void
+game_add_scatter(Game_State *game, u64 count, f32 extent, u32 seed) {
+    // xorshift, the same scene for the same seed on every platform
+    u32 state = seed ? seed : 1;
+    f32 inv = 1.0f / 4294967296.0f;
+    for (u64 index = 0; index < count; ++index) {
+        f32 r[8];
+        for (u32 i = 0; i < array_count(r); ++i) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            r[i] = (f32)state * inv;
+        }
+        
+        v3f p = v3f_make((r[0] * 2.0f - 1.0f) * extent, (r[1] * 2.0f - 1.0f) * extent, (r[2] * 2.0f - 1.0f) * extent);
+        quat orient = quat_make_rotate_around_axis(r[3] * 6.2831853f, v3f_make(r[4] - 0.5f, r[5] - 0.5f, 0.25f));
+        f32 size = 0.25f + r[6];
+        R3D_Handle handle = r3d_scene_add(&game->scene, p, orient, v3f_make(size, size, size),
+                                          v4f_make(r[7], 0.5f, 1.0f - r[7], 1.0f));
+        if (game->mesh_count > 1) {
+            R3D_Tag tag = { 0 };
+            tag.mesh = (u16)(1 + index % (game->mesh_count - 1));
+            r3d_scene_set_tag(&game->scene, handle, tag);
+        }
+    }
+}
+
+function void
+game_add_light_scatter(Game_State *game, u32 count, f32 extent, u32 seed) {
+    if (game->light_count + count > game_light_max) {
+        count = game_light_max - game->light_count;
+    }
+    // pushes are contiguous, so lights stays one array
+    arena_push(&game->light_arena, count * sizeof(Light), 16);
+    
+    u32 state = seed ? seed : 1;
+    f32 inv = 1.0f / 4294967296.0f;
+    for (u32 index = 0; index < count; ++index) {
+        f32 r[10];
+        for (u32 i = 0; i < array_count(r); ++i) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            r[i] = (f32)state * inv;
+        }
+        
+        Light light = { 0 };
+        light.type = r[0] < 0.5f ? LightType_Point : LightType_Spotlight;
+        light.p = v3f_make((r[1] * 2.0f - 1.0f) * extent, (r[2] * 2.0f - 1.0f) * extent, (r[3] * 2.0f - 1.0f) * extent);
+        light.reference_distance = 1.0f + r[4] * 3.0f;
+        light.max_distance = 4.0f + r[4] * 8.0f;
+        light.min_distance = 1.0f;
+        light.direction = v3f_make(r[5] - 0.5f, r[6] - 0.5f, r[7] - 0.5f);
+        light.inner_angle = 10.0f + r[8] * 20.0f;
+        light.max_angle = light.inner_angle + 10.0f;
+        light.colour = v4f_make(r[9], 1.0f - r[9], 0.5f, 1.0f);
+        light.enabled = True;
+        game->lights[game->light_count++] = light;
+    }
+}
+
+function void
+game_camera_basis(Game_State *game, v3f *forward, v3f *right, v3f *up) {
+    f32 theta = radians(game->camera_theta);
+    f32 phi = radians(game->camera_phi);
+    f32 cosine_theta = cosf(theta);
+    f32 cosine_phi = cosf(phi);
+    f32 sine_theta = sinf(theta);
+    f32 sine_phi = sinf(phi);
+    
+    v3f camera_forward;
+    camera_forward.x = cosine_phi * sine_theta;
+    camera_forward.y = cosine_theta;
+    camera_forward.z = sine_theta * sine_phi;
+    v3f_norm(&camera_forward);
+    
+    v3f temp_up = v3f_make(0.0f, 1.0f, 0.0f);
+    v3f camera_right = v3f_cross(temp_up, camera_forward);
+    v3f_norm(&camera_right);
+    v3f camera_up = v3f_cross(camera_forward, camera_right);
+    v3f_norm(&camera_up);
+    
+    *forward = camera_forward;
+    *right = camera_right;
+    *up = camera_up;
+}
+
+// One fixed step: movement from the held keys and the animation clock.
+function void
+game_step(Game_State *game, OS_Input *input) {
+    game->previous_camera_p = game->camera_p;
+    game->previous_rot_accum = game->rot_accum;
+    
+    v3f camera_forward, camera_right, camera_up;
+    game_camera_basis(game, &camera_forward, &camera_right, &camera_up);
+    
+    f32 move_speed = 0.1f;
+    if (os_input_held(input, OSInput_Key_W)) {
+        game->camera_p = v3f_add(v3f_scale(camera_forward, move_speed), game->camera_p);
+    }
+    
+    if (os_input_held(input, OSInput_Key_S)) {
+        game->camera_p = v3f_sub(game->camera_p, v3f_scale(camera_forward, move_speed));
+    }
+    
+    if (os_input_held(input, OSInput_Key_A)) {
+        game->camera_p = v3f_sub(game->camera_p, v3f_scale(camera_right, move_speed));
+    }
+    
+    if (os_input_held(input, OSInput_Key_D)) {
+        game->camera_p = v3f_add(game->camera_p, v3f_scale(camera_right, move_speed));
+    }
+    
+    if (os_input_held(input, OSInput_Key_Shift)) {
+        game->camera_p = v3f_sub(game->camera_p, v3f_scale(camera_up, move_speed));
+    }
+    
+    if (os_input_held(input, OSInput_Key_Space)) {
+        game->camera_p = v3f_add(game->camera_p, v3f_scale(camera_up, move_speed));
+    }
+    
+    game->rot_accum += game->dt_step;
+}
+
+function void
+game_update(Game_State *game, OS_Input *input, u32 step_count, f32 alpha, f32 aspect) {
+    // the look follows the mouse every frame rather than every step, it's what latency is felt on
+    f32 mouse_sensitivity = 0.1f;
+    game->camera_theta += input->mouse_displace_y * mouse_sensitivity;
+    game->camera_phi -= input->mouse_displace_x * mouse_sensitivity;
+    
+    if (game->camera_theta > 145.0f) {
+        game->camera_theta = 145.0f;
+    } else if (game->camera_theta < 45.0f) {
+        game->camera_theta = 45.0f;
+    }
+    
+    if (game->camera_phi >= 360.0f) {
+        game->camera_phi = 0.0f;
+    } else if (game->camera_phi <= -360.0f) {
+        game->camera_phi = 0.0f;
+    }
+    
+    for (u32 step = 0; step < step_count; ++step) {
+        game_step(game, input);
+    }
+    
+    // drawn between the last two steps, so motion is as smooth as the frame rate allows
+    v3f camera_p = v3f_add(game->previous_camera_p, v3f_scale(v3f_sub(game->camera_p, game->previous_camera_p), alpha));
+    f32 rot_accum = game->previous_rot_accum + (game->rot_accum - game->previous_rot_accum) * alpha;
+    
+    v3f camera_forward, camera_right, camera_up;
+    game_camera_basis(game, &camera_forward, &camera_right, &camera_up);
+    v3f temp_up = v3f_make(0.0f, 1.0f, 0.0f);
+    
+    R3D_Scene *scene = &game->scene;
+    Model_Instance instance = r3d_scene_get(scene, game->big_cube);
+    instance.orient = quat_make_rotate_around_axis(rot_accum, v3f_make(1.0f, 0.0f, 0.0f));
+    r3d_scene_set(scene, game->big_cube, &instance);
+    
+    instance = r3d_scene_get(scene, game->small_cube);
+    instance.orient = quat_make_rotate_around_axis(rot_accum * -1.0f, v3f_make(0.0f, 0.5f, 1.0f));
+    r3d_scene_set(scene, game->small_cube, &instance);
+    
+    f32 near_plane = 1.0f;
+    f32 far_plane = 100.0f;
+    m44 pers = m44_perspective_lh_z01(radians(66.2f), aspect, near_plane, far_plane);
+    m44 world_to_camera = m44_look_at_lh(camera_p, v3f_add(camera_p, camera_forward), temp_up);
+    game->view_projection = m44_mul(world_to_camera, pers);
+    game->constants.view_projection = game->view_projection;
+    game->constants.camera_p = camera_p;
+    
+    Light_View *light_view = &game->light_view;
+    light_view->camera_p = camera_p;
+    light_view->camera_forward = camera_forward;
+    light_view->world_to_camera = world_to_camera;
+    light_view->projection_x = pers.m[0][0];
+    light_view->projection_y = pers.m[1][1];
+    light_view->near_plane = near_plane;
+    light_view->far_plane = far_plane;
+    
+    Light light = { 0 };
+    light.type = LightType_Spotlight;
+    light.p = v3f_make(0.0f, 0.0f, -1.0f);
+    light.reference_distance = 8.0f;
+    light.max_distance = 50.0f;
+    light.min_distance = 1.0f;
+    light.direction = v3f_make(0.0f, 0.0f, 1.0f);
+    light.colour = v4f_make(0.5f, 0.3f, 1.0f, 1.0f);
+    light.inner_angle = 15.0f;
+    light.max_angle = 35.0f;
+    light.enabled = True;
+    game->lights[0] = light;
+    
+    light.p = v3f_make(16.0f, 4.0f, -4.0f);
+    light.reference_distance = 24.0f;
+    light.max_distance = 100.0f;
+    light.direction = v3f_make(-1.0f, 0.0f, 1.0f);
+    light.colour = v4f_make(1.0f, 1.0f, 1.0f, 1.0f);
+    game->lights[1] = light;
+    
+    light.type = LightType_Point;
+    light.p = v3f_make(sinf(rot_accum) * 10.0f, cosf(rot_accum) * 10.0f, 0.0f);
+    light.reference_distance = 16.0f;
+    light.max_distance = 100.0f;
+    light.colour = v4f_make(0.0f, 1.0f, 0.0f, 1.0f);
+    game->lights[2] = light;
+    
+    // a small cube marks each light
+    for (u32 light_index = 0; light_index < array_count(game->light_gizmos); ++light_index) {
+        Model_Instance gizmo = r3d_scene_get(scene, game->light_gizmos[light_index]);
+        gizmo.position = game->lights[light_index].p;
+        r3d_scene_set(scene, game->light_gizmos[light_index], &gizmo);
+    }
+}
@@ -0,0 +1,99 @@
+#if !defined(S_GAME_H)
+#define S_GAME_H
+
+// Everything the frame computes before a backend gets involved: camera, instances and lights.
+// The constant layouts match the HLSL cbuffers, so backends copy them as they are.
+
+align_16 typedef struct {
+    // world_to_camera * perspective, built once per frame on the CPU
+	m44 view_projection;
+    v3f camera_p;
+    f32 __unused_a;
+    // vs_main's position decode, from the Vertex_Stream being drawn. Identity for VertexFormat_Float.
+    v3f position_scale;
+    f32 __unused_b;
+    v3f position_offset;
+    f32 __unused_c;
+} D3D11_Constants;
+
+#define game_light_max (1 << 20)
+
+// fixed steps a second, see s_frame_clock.h
+#define game_update_hz 60
+// past this many steps in one frame the game slows down instead
+#define game_max_steps_per_frame 8
+
+// game_cube_vertices in s_game.c: a triangle soup, 6 floats per vertex, position then normal.
+// game_init builds mesh 0 from it.
+#define game_cube_vertex_count 36
+
+// R3D_Tag.mesh is 12 bits in the sort key, see s_batch.h
+#define game_mesh_max 64
+
+// What R3D_Tag.shader picks. The software rasterizer shades everything as GameShader_Lit.
+enum {
+    GameShader_Lit,
+    GameShader_Gooch,
+    GameShader_Count
+};
+
+typedef struct {
+    // Ok, so rotations in R^3 (esp. camera): see game_init.
+    v3f camera_p;
+    f32 camera_theta; // nod yes; Rotate around x.
+    f32 camera_phi; // no; rotate around y
+
+    f32 dt_step;
+    f32 rot_accum;
+    // as of the step before the last, what a frame blends from
+    v3f previous_camera_p;
+    f32 previous_rot_accum;
+
+    R3D_Scene scene;
+    R3D_Handle big_cube;
+    R3D_Handle small_cube;
+    R3D_Handle light_gizmos[3];
+    
+    // R3D_Tag.mesh indexes these, mesh 0 is the cube. game_add_mesh builds each one's LOD chain
+    // and appends every level to geometry, the one vertex and index buffer backends draw from.
+    Arena mesh_arena;
+    Arena lod_arena;
+    Mesh meshes[game_mesh_max];
+    Mesh_LOD_Chain mesh_lods[game_mesh_max];
+    u32 mesh_count;
+    // the largest radius of any mesh, what culling tests every instance against
+    f32 mesh_radius;
+    Arena geometry_arena;
+    Mesh geometry;
+    u32 geometry_base_vertex[game_mesh_max];
+    u32 geometry_first_index[game_mesh_max];
+
+    // [0, 3) are the lights game_update moves, each with a gizmo; scattered lights come after
+    Arena light_arena;
+    Light *lights;
+    u32 light_count;
+
+    // written by game_update
+    m44 view_projection;
+    D3D11_Constants constants;
+    Light_View light_view;
+} Game_State;
+
+function void game_init(Game_State *game);
+// Builds mesh's LOD chain and returns its R3D_Tag.mesh. mesh has to outlive the game.
+function u32 game_add_mesh(Game_State *game, Mesh mesh);
+// Adds every mesh of a pack written by s_mesh_tool; the big and small cube draw its first one.
+function void game_add_mesh_pack(Game_State *game, Mesh_Pack *pack);
+// A level of a mesh as a view into geometry.
+function Mesh game_mesh_level(Game_State *game, u32 mesh, u32 level);
+// Scatters count static instances through a box of half-size extent around the origin, for load
+// testing. They take turns drawing every mesh but the cube, or the cube when it's the only one.
+function void game_add_scatter(Game_State *game, u64 count, f32 extent, u32 seed);
+// Scatters count point and spot lights through the same kind of box, for load testing the clusters.
+function void game_add_light_scatter(Game_State *game, u32 count, f32 extent, u32 seed);
+// Once a frame: turns the camera with this frame's mouse, runs step_count fixed steps of
+// dt_step, then builds what backends read between the last two steps, alpha of the way (see
+// frame_clock_alpha). aspect is height / width of the target.
+function void game_update(Game_State *game, OS_Input *input, u32 step_count, f32 alpha, f32 aspect);
+
+#endif
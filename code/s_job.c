@@ -0,0 +1,220 @@
+// Which deque the current thread owns. Threads outside the system (there are none yet) would
+// share worker 0's, which is only safe from the thread that created the system.
+global per_thread u32 job_thread_index;
+
+function b32
+job_deque_push(Job_Deque *deque, Job *job) {
+	b32 result = False;
+	u64 bottom = deque->bottom;
+	u64 top = atomic_load_u64(&deque->top);
+	if ((s64)(bottom - top) < job_deque_capacity) {
+		deque->jobs[bottom & (job_deque_capacity - 1)] = *job;
+		memory_fence();
+		atomic_store_u64(&deque->bottom, bottom + 1);
+		result = True;
+	}
+	return(result);
+}
+
+// Owner only.
+function b32
+job_deque_pop(Job_Deque *deque, Job *job) {
+	b32 result = False;
+	u64 bottom = deque->bottom - 1;
+	atomic_store_u64(&deque->bottom, bottom);
+	memory_fence();
+	u64 top = atomic_load_u64(&deque->top);
+
+	if ((s64)(bottom - top) >= 0) {
+		*job = deque->jobs[bottom & (job_deque_capacity - 1)];
+		result = True;
+		if (bottom == top) {
+			// last one, race the thieves for it
+			if (atomic_cas_u64(&deque->top, top + 1, top) != top) {
+				result = False;
+			}
+			atomic_store_u64(&deque->bottom, bottom + 1);
+		}
+	} else {
+		atomic_store_u64(&deque->bottom, bottom + 1);
+	}
+	return(result);
+}
+
+// Any thread. The copy may be torn if the owner wrapped around onto that slot, but then top has
+// moved on and the cas fails, so the copy is thrown away.
+function b32
+job_deque_steal(Job_Deque *deque, Job *job) {
+	b32 result = False;
+	u64 top = atomic_load_u64(&deque->top);
+	memory_fence();
+	u64 bottom = atomic_load_u64(&deque->bottom);
+	if ((s64)(bottom - top) > 0) {
+		*job = deque->jobs[top & (job_deque_capacity - 1)];
+		if (atomic_cas_u64(&deque->top, top + 1, top) == top) {
+			result = True;
+		}
+	}
+	return(result);
+}
+
+function void
+job_run(Job *job, u32 worker_index) {
+	job->func(job->data, job->begin, job->end, worker_index);
+	atomic_add_u64(&job->fence->pending, (u64)-1);
+}
+
+function b32
+job_try_run(Job_System *system, u32 worker_index) {
+	Job job;
+	b32 result = job_deque_pop(system->deques + worker_index, &job);
+	if (!result && (system->worker_count > 1)) {
+		// xorshift, only to spread the thieves out
+		Job_Worker *worker = system->workers + worker_index;
+		worker->rng ^= worker->rng << 13;
+		worker->rng ^= worker->rng >> 17;
+		worker->rng ^= worker->rng << 5;
+
+		u32 start = worker->rng % system->worker_count;
+		for (u32 offset = 0; offset < system->worker_count; ++offset) {
+			u32 victim = (start + offset) % system->worker_count;
+			if ((victim != worker_index) && job_deque_steal(system->deques + victim, &job)) {
+				result = True;
+				break;
+			}
+		}
+	}
+
+	if (result) {
+		job_run(&job, worker_index);
+	}
+	return(result);
+}
+
+function b32
+job_any_queued(Job_System *system) {
+	b32 result = False;
+	for (u32 index = 0; index < system->worker_count; ++index) {
+		Job_Deque *deque = system->deques + index;
+		if ((s64)(atomic_load_u64(&deque->bottom) - atomic_load_u64(&deque->top)) > 0) {
+			result = True;
+			break;
+		}
+	}
+	return(result);
+}
+
+function void
+job_worker_proc(void *data) {
+	Job_Worker *worker = (Job_Worker *)data;
+	Job_System *system = worker->system;
+	job_thread_index = worker->index;
+
+	u32 idle_spins = 0;
+	while (!atomic_load_u64(&system->quit)) {
+		if (job_try_run(system, worker->index)) {
+			idle_spins = 0;
+		} else if (idle_spins < 64) {
+			++idle_spins;
+			cpu_pause();
+		} else {
+			// Announce ourselves before the last look so a submit either sees us sleeping or we
+			// see its job.
+			atomic_add_u64(&system->sleeping, 1);
+			if (!job_any_queued(system) && !atomic_load_u64(&system->quit)) {
+				os_semaphore_wait(system->wake);
+			}
+			atomic_add_u64(&system->sleeping, (u64)-1);
+			idle_spins = 0;
+		}
+	}
+}
+
+function void
+job_system_init(Job_System *system, u32 worker_count) {
+	if (worker_count == 0) {
+		worker_count = 1;
+	}
+
+	system->worker_count = worker_count;
+	system->sleeping = 0;
+	system->quit = 0;
+	system->arena = arena_reserve(megabytes(64));
+	system->deques = (Job_Deque *)arena_push(&system->arena, sizeof(Job_Deque) * worker_count, 64);
+	system->workers = (Job_Worker *)arena_push(&system->arena, sizeof(Job_Worker) * worker_count, 64);
+	if (!system->deques || !system->workers) {
+		os_fatal_error(str8("Out of memory for the job system"));
+	}
+	system->wake = os_semaphore_create(0);
+
+	job_thread_index = 0;
+	for (u32 index = 0; index < worker_count; ++index) {
+		Job_Worker *worker = system->workers + index;
+		worker->system = system;
+		worker->index = index;
+		worker->rng = 0x9e3779b9u * (index + 1);
+		if (index > 0) {
+			worker->thread = os_thread_create(job_worker_proc, worker);
+		}
+	}
+}
+
+function void
+job_system_release(Job_System *system) {
+	atomic_store_u64(&system->quit, 1);
+	os_semaphore_signal(system->wake, system->worker_count);
+	for (u32 index = 1; index < system->worker_count; ++index) {
+		os_thread_join(system->workers[index].thread);
+	}
+	os_semaphore_destroy(system->wake);
+	arena_release(&system->arena);
+}
+
+function void
+job_submit(Job_System *system, Job_Fence *fence, Job_Func *func, void *data, u64 begin, u64 end) {
+	u32 worker_index = job_thread_index;
+
+	Job job;
+	job.func = func;
+	job.data = data;
+	job.begin = begin;
+	job.end = end;
+	job.fence = fence;
+	atomic_add_u64(&fence->pending, 1);
+
+	if (job_deque_push(system->deques + worker_index, &job)) {
+		memory_fence();
+		if (atomic_load_u64(&system->sleeping) > 0) {
+			os_semaphore_signal(system->wake, 1);
+		}
+	} else {
+		// Full: job_deque_capacity jobs already wait here for the others to steal, so this one can
+		// only add to a backlog. Running it now is the backpressure, the submitter slows to the pace
+		// the workers drain at, and the ring never needs to grow under the thieves.
+		job_run(&job, worker_index);
+	}
+}
+
+function void
+job_parallel_for(Job_System *system, Job_Fence *fence, u64 count, u64 batch_size, Job_Func *func, void *data) {
+	if (batch_size == 0) {
+		batch_size = 1;
+	}
+	for (u64 begin = 0; begin < count; begin += batch_size) {
+		u64 end = begin + batch_size;
+		if (end > count) {
+			end = count;
+		}
+		job_submit(system, fence, func, data, begin, end);
+	}
+}
+
+function void
+job_wait(Job_System *system, Job_Fence *fence) {
+	u32 worker_index = job_thread_index;
+	while (atomic_load_u64(&fence->pending) != 0) {
+		if (!job_try_run(system, worker_index)) {
+			cpu_pause();
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#if !defined(S_JOB_H)
+#define S_JOB_H
+
+// Work-stealing job system. Every thread owns a deque: it pushes and pops its own work at the
+// bottom, idle threads steal from the top of someone else's. The thread that calls
+// job_system_init is worker 0 and only runs jobs while it waits on a fence.
+
+// A job runs over [begin, end). worker_index is in [0, worker_count), handy for per-thread scratch.
+typedef void Job_Func(void *data, u64 begin, u64 end, u32 worker_index);
+
+// Counts jobs still in flight.
+typedef struct {
+	u64 pending;
+} Job_Fence;
+
+typedef struct {
+	Job_Func *func;
+	void *data;
+	u64 begin;
+	u64 end;
+	Job_Fence *fence;
+} Job;
+
+// power of two. A submit to a full deque runs the job inline instead of queueing it.
+#define job_deque_capacity 4096
+
+// Chase-Lev deque over a fixed ring. top and bottom only ever grow, so they are compared as s64.
+typedef struct {
+	volatile u64 top;
+	u8 __pad_a[56];
+	volatile u64 bottom;
+	u8 __pad_b[56];
+	Job jobs[job_deque_capacity];
+} Job_Deque;
+
+typedef struct Job_System Job_System;
+
+typedef struct {
+	Job_System *system;
+	u32 index;
+	u32 rng;
+	OS_Thread thread;
+} Job_Worker;
+
+struct Job_System {
+	u32 worker_count;
+	Job_Deque *deques;
+	Job_Worker *workers;
+
+	OS_Semaphore wake;
+	volatile u64 sleeping;
+	volatile u64 quit;
+
+	Arena arena;
+};
+
+// worker_count includes the calling thread; 1 runs everything inline on it.
+function void job_system_init(Job_System *system, u32 worker_count);
+function void job_system_release(Job_System *system);
+
+// Queues the job on the calling thread's deque, or runs it right away when that is full.
+function void job_submit(Job_System *system, Job_Fence *fence, Job_Func *func, void *data, u64 begin, u64 end);
+// Splits [0, count) into jobs of batch_size, the last one possibly shorter.
+function void job_parallel_for(Job_System *system, Job_Fence *fence, u64 count, u64 batch_size, Job_Func *func, void *data);
+// Helps out with queued work until every job on fence has finished.
+function void job_wait(Job_System *system, Job_Fence *fence);
+
+#endif
@@ -0,0 +1,158 @@
+// Job system: every index of a parallel_for runs exactly once, through a full deque and from jobs
+// that submit jobs of their own; and how throughput scales from 1 worker to every core.
+
+typedef struct {
+    u64 *runs;
+    Job_System *system;
+    u64 nested_count;
+} Job_Test;
+
+function void
+job_test_count(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Job_Test *test = (Job_Test *)data;
+    for (u64 index = begin; index < end; ++index) {
+        atomic_add_u64(test->runs + index, 1);
+    }
+}
+
+// Each job fans its range out again from whichever worker runs it, and waits on it there.
+function void
+job_test_nested(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Job_Test *test = (Job_Test *)data;
+    Job_Fence fence = { 0 };
+    for (u64 index = begin; index < end; ++index) {
+        job_submit(test->system, &fence, job_test_count, test, index * test->nested_count,
+                   (index + 1) * test->nested_count);
+    }
+    job_wait(test->system, &fence);
+}
+
+function b32
+job_test_ran_once(u64 *runs, u64 count) {
+    b32 result = True;
+    for (u64 index = 0; index < count; ++index) {
+        result = result && (runs[index] == 1);
+    }
+    return(result);
+}
+
+function void
+test_job(void) {
+    u32 worker_counts[] = { 1, 2, 4, 8 };
+    for (u32 config = 0; config < array_count(worker_counts); ++config) {
+        Job_System system;
+        job_system_init(&system, worker_counts[config]);
+        Job_Test test = { 0 };
+        test.system = &system;
+
+        // batches that don't divide the count, and far more jobs than a deque holds, so the inline
+        // fallback in job_submit runs too
+        u64 count = 100003;
+        u64 batch_sizes[] = { 1, 7, 1000, count };
+        test.runs = (u64 *)calloc(count, sizeof(u64));
+        for (u32 batch = 0; batch < array_count(batch_sizes); ++batch) {
+            memset(test.runs, 0, count * sizeof(u64));
+            Job_Fence fence = { 0 };
+            job_parallel_for(&system, &fence, count, batch_sizes[batch], job_test_count, &test);
+            job_wait(&system, &fence);
+            test_check(fence.pending == 0 && job_test_ran_once(test.runs, count),
+                       "%u workers, batch %llu: not every index ran once", worker_counts[config],
+                       (unsigned long long)batch_sizes[batch]);
+        }
+
+        // 64 jobs that submit 64 each, on whichever thread they land
+        test.nested_count = 64;
+        memset(test.runs, 0, count * sizeof(u64));
+        Job_Fence fence = { 0 };
+        job_parallel_for(&system, &fence, 64, 1, job_test_nested, &test);
+        job_wait(&system, &fence);
+        test_check(job_test_ran_once(test.runs, 64 * 64), "%u workers: nested jobs didn't each run once",
+                   worker_counts[config]);
+
+        free(test.runs);
+        job_system_release(&system);
+    }
+}
+
+#define job_bench_count (1 << 22)
+#define job_bench_batch 4096
+
+typedef struct {
+    v3f *points;
+    f32 *sums;
+} Job_Bench;
+
+// Compute bound: a chain of rotations per point.
+function void
+job_bench_rotate(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Job_Bench *bench = (Job_Bench *)data;
+    quat orient = quat_make_rotate_around_axis(0.1f, v3f_make(0.0f, 1.0f, 0.0f));
+    for (u64 index = begin; index < end; ++index) {
+        v3f p = bench->points[index];
+        for (u32 step = 0; step < 16; ++step) {
+            p = quat_rot_v3f(orient, p);
+        }
+        bench->points[index] = p;
+    }
+}
+
+// Bandwidth bound: one pass over the points.
+function void
+job_bench_sum(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Job_Bench *bench = (Job_Bench *)data;
+    f32 sum = 0.0f;
+    for (u64 index = begin; index < end; ++index) {
+        sum += bench->points[index].x + bench->points[index].y + bench->points[index].z;
+    }
+    bench->sums[begin / job_bench_batch] = sum;
+}
+
+function void
+bench_job(void) {
+    Job_Bench bench;
+    bench.points = (v3f *)malloc(job_bench_count * sizeof(v3f));
+    bench.sums = (f32 *)malloc((job_bench_count / job_bench_batch) * sizeof(f32));
+    Test_Random random = test_random_make(10);
+    for (u64 index = 0; index < job_bench_count; ++index) {
+        bench.points[index] = test_random_v3f(&random, -1.0f, 1.0f);
+    }
+
+    Job_Func *funcs[] = { job_bench_rotate, job_bench_sum };
+    char *func_names[] = { "rotate", "sum" };
+    u32 cpu_count = os_cpu_count();
+    printf("  %u cores\n", cpu_count);
+    for (u32 func = 0; func < array_count(funcs); ++func) {
+        f64 one_worker_ms = 0.0;
+        // doubling up to every core, and every core when that isn't a power of two
+        for (u32 worker_count = 1; ; worker_count = (worker_count * 2 < cpu_count) ? worker_count * 2 : cpu_count) {
+            Job_System system;
+            job_system_init(&system, worker_count);
+            u64 best = ~0ull;
+            for (u32 round = 0; round < 5; ++round) {
+                Job_Fence fence = { 0 };
+                u64 begin = os_time_ticks();
+                job_parallel_for(&system, &fence, job_bench_count, job_bench_batch, funcs[func], &bench);
+                job_wait(&system, &fence);
+                u64 ticks = os_time_ticks() - begin;
+                best = ticks < best ? ticks : best;
+            }
+            job_system_release(&system);
+
+            char name[64];
+            snprintf(name, sizeof(name), "%s, %u workers", func_names[func], worker_count);
+            bench_report(name, job_bench_count, best);
+            f64 ms = (f64)best * 1000.0 / (f64)os_time_ticks_per_second();
+            one_worker_ms = (worker_count == 1) ? ms : one_worker_ms;
+            printf("  %-40s %10.2fx of 1 worker\n", "", one_worker_ms / ms);
+            if (worker_count >= cpu_count) {
+                break;
+            }
+        }
+    }
+    free(bench.points);
+    free(bench.sums);
+}
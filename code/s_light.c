@@ -0,0 +1,346 @@
+typedef struct {
+    Light_Clusters *clusters;
+    // null while counting, then every cluster's next free slot in indices
+    u32 *cursor;
+} Light_Bin_Job;
+
+function u32
+light_cluster_slice(Light_Clusters *clusters, f32 view_z) {
+    f32 slice = log2f(view_z) * clusters->z_scale + clusters->z_bias;
+    if (!(slice > 0.0f)) {
+        slice = 0.0f;
+    } else if (slice > (f32)(light_cluster_grid_z - 1)) {
+        slice = (f32)(light_cluster_grid_z - 1);
+    }
+    return (u32)slice;
+}
+
+// Four consecutive clusters of a row against one light, bit i set when cluster first + i may be lit.
+function u32
+light_bounds_test_x4(Light_Clusters *clusters, Light_Bounds *bounds, u32 first) {
+    f32x4 zero = f32x4_zero();
+    f32x4 cx = f32x4_set1(bounds->centre.x);
+    f32x4 cy = f32x4_set1(bounds->centre.y);
+    f32x4 cz = f32x4_set1(bounds->centre.z);
+
+    // sphere against the cluster's AABB
+    f32x4 dx = f32x4_max(f32x4_max(f32x4_sub(f32x4_load(clusters->min_x + first), cx),
+                                   f32x4_sub(cx, f32x4_load(clusters->max_x + first))), zero);
+    f32x4 dy = f32x4_max(f32x4_max(f32x4_sub(f32x4_load(clusters->min_y + first), cy),
+                                   f32x4_sub(cy, f32x4_load(clusters->max_y + first))), zero);
+    f32x4 dz = f32x4_max(f32x4_max(f32x4_sub(f32x4_load(clusters->min_z + first), cz),
+                                   f32x4_sub(cz, f32x4_load(clusters->max_z + first))), zero);
+    f32x4 distance_sq = f32x4_add(f32x4_add(f32x4_mul(dx, dx), f32x4_mul(dy, dy)), f32x4_mul(dz, dz));
+    f32x4 hit = f32x4_cmp_le(distance_sq, f32x4_set1(bounds->radius * bounds->radius));
+
+    if (bounds->cone) {
+        // cone against the cluster's bounding sphere, from Wronski's "Cull that cone!"
+        f32x4 vx = f32x4_sub(f32x4_load(clusters->centre_x + first), f32x4_set1(bounds->apex.x));
+        f32x4 vy = f32x4_sub(f32x4_load(clusters->centre_y + first), f32x4_set1(bounds->apex.y));
+        f32x4 vz = f32x4_sub(f32x4_load(clusters->centre_z + first), f32x4_set1(bounds->apex.z));
+        f32x4 length_sq = f32x4_add(f32x4_add(f32x4_mul(vx, vx), f32x4_mul(vy, vy)), f32x4_mul(vz, vz));
+        f32x4 along = f32x4_add(f32x4_add(f32x4_mul(vx, f32x4_set1(bounds->direction.x)),
+                                          f32x4_mul(vy, f32x4_set1(bounds->direction.y))),
+                                f32x4_mul(vz, f32x4_set1(bounds->direction.z)));
+        f32x4 across = f32x4_sqrt(f32x4_max(f32x4_sub(length_sq, f32x4_mul(along, along)), zero));
+        f32x4 closest = f32x4_sub(f32x4_mul(f32x4_set1(bounds->cos_angle), across),
+                                  f32x4_mul(along, f32x4_set1(bounds->sin_angle)));
+        f32x4 radius = f32x4_load(clusters->radius + first);
+
+        f32x4 outside_angle = f32x4_cmp_lt(radius, closest);
+        f32x4 past_range = f32x4_cmp_lt(f32x4_add(radius, f32x4_set1(bounds->range)), along);
+        f32x4 behind = f32x4_cmp_lt(along, f32x4_sub(zero, radius));
+        f32x4 culled = f32x4_or(f32x4_or(outside_angle, past_range), behind);
+        hit = f32x4_select(culled, zero, hit);
+    }
+
+    u32 result = f32x4_mask(hit);
+    return(result);
+}
+
+function b32
+light_cluster_test(Light_Clusters *clusters, u32 light_index, u32 cluster_index) {
+    Light_Bounds *bounds = clusters->bounds + light_index;
+    b32 result = False;
+    Light *light = clusters->lights + light_index;
+    if (light->enabled && (light->type != LightType_Directional)) {
+        u32 mask = light_bounds_test_x4(clusters, bounds, cluster_index & ~3u);
+        result = (mask >> (cluster_index & 3)) & 1;
+    }
+    return(result);
+}
+
+function Light_Packed
+light_pack(Light *light) {
+    Light_Packed result = { 0 };
+    result.p = light->p;
+    result.type = light->type;
+    result.direction = light->direction;
+    result.colour = light->colour.xyz;
+
+    f32 max_distance_sq = light->max_distance * light->max_distance;
+    result.inv_max_distance4 = (max_distance_sq > 0.0f) ? 1.0f / (max_distance_sq * max_distance_sq) : FLT_MAX;
+    result.reference_distance_sq = light->reference_distance * light->reference_distance;
+    f32 min_distance_sq = light->min_distance * light->min_distance;
+    result.inv_min_distance_sq = (min_distance_sq > 0.0f) ? 1.0f / min_distance_sq : FLT_MAX;
+
+    if (light->type == LightType_Spotlight) {
+        v3f_norm(&result.direction);
+        f32 cos_max = cosf(radians(light->max_angle));
+        f32 cos_inner = cosf(radians(light->inner_angle));
+        // With no penumbra (inner == max) the scale is clamped to 1e6, so the cone steps from 0 to
+        // 1 within 1e-6 of cos_max instead of dividing by zero.
+        f32 cos_range = cos_inner - cos_max;
+        result.spot_scale = (cos_range > 1e-6f) ? 1.0f / cos_range : 1e6f;
+        result.spot_offset = -cos_max * result.spot_scale;
+    } else {
+        result.spot_scale = 0.0f;
+        result.spot_offset = 1.0f;
+    }
+
+    return(result);
+}
+
+function void
+light_bounds_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Light_Clusters *clusters = (Light_Clusters *)data;
+    Light_View *view = &clusters->view;
+
+    for (u64 light_index = begin; light_index < end; ++light_index) {
+        Light *light = clusters->lights + light_index;
+        Light_Bounds *bounds = clusters->bounds + light_index;
+        Light_Bounds zero = { 0 };
+        *bounds = zero;
+        clusters->packed[light_index] = light_pack(light);
+        if (!light->enabled || (light->type == LightType_Directional)) {
+            continue;
+        }
+
+        v4f apex = m44_mul_v4f(view->world_to_camera, v4f_make(light->p.x, light->p.y, light->p.z, 1.0f));
+        bounds->centre = apex.xyz;
+        bounds->radius = light->max_distance;
+
+        f32 angle = radians(light->max_angle);
+        if ((light->type == LightType_Spotlight) && (angle < pi_half_f32)) {
+            v3f direction = light->direction;
+            v3f_norm(&direction);
+            v4f view_direction = m44_mul_v4f(view->world_to_camera, v4f_make(direction.x, direction.y, direction.z, 0.0f));
+
+            bounds->cone = True;
+            bounds->apex = apex.xyz;
+            bounds->range = light->max_distance;
+            bounds->direction = view_direction.xyz;
+            bounds->cos_angle = cosf(angle);
+            bounds->sin_angle = sinf(angle);
+
+            // smallest sphere around the cone
+            if (angle > pi_half_f32 * 0.5f) {
+                bounds->centre = v3f_add(apex.xyz, v3f_scale(bounds->direction, bounds->cos_angle * bounds->range));
+                bounds->radius = bounds->sin_angle * bounds->range;
+            } else {
+                bounds->radius = bounds->range / (2.0f * bounds->cos_angle);
+                bounds->centre = v3f_add(apex.xyz, v3f_scale(bounds->direction, bounds->radius));
+            }
+        }
+
+        // slices whose (padded) depth range the sphere reaches
+        f32 near_z = bounds->centre.z - bounds->radius;
+        f32 far_z = bounds->centre.z + bounds->radius;
+        for (u32 slice = 0; slice < light_cluster_grid_z; ++slice) {
+            u32 first = slice * light_cluster_grid_y * light_cluster_grid_x;
+            if ((clusters->max_z[first] >= near_z) && (clusters->min_z[first] <= far_z)) {
+                if (!bounds->binned) {
+                    bounds->binned = True;
+                    bounds->min_z = slice;
+                }
+                bounds->max_z = slice;
+            }
+        }
+    }
+}
+
+// One job per slice, so every cluster is only ever touched by one worker and lists come out in
+// light order without sorting. Run twice: once counting, once writing.
+function void
+light_bin_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Light_Bin_Job *job = (Light_Bin_Job *)data;
+    Light_Clusters *clusters = job->clusters;
+
+    for (u64 slice = begin; slice < end; ++slice) {
+        for (u32 light_index = 0; light_index < clusters->light_count; ++light_index) {
+            Light_Bounds *bounds = clusters->bounds + light_index;
+            if (!bounds->binned || (slice < bounds->min_z) || (slice > bounds->max_z)) {
+                continue;
+            }
+
+            // Columns and rows whose AABB extents overlap the sphere's. Within a slice every row
+            // shares x extents and every column shares y extents.
+            u32 slice_first = (u32)slice * light_cluster_grid_y * light_cluster_grid_x;
+            f32 r = bounds->radius;
+            u32 min_x = light_cluster_grid_x, max_x = 0;
+            for (u32 x = 0; x < light_cluster_grid_x; ++x) {
+                if ((clusters->max_x[slice_first + x] >= bounds->centre.x - r) &&
+                    (clusters->min_x[slice_first + x] <= bounds->centre.x + r)) {
+                    min_x = x < min_x ? x : min_x;
+                    max_x = x;
+                }
+            }
+            u32 min_y = light_cluster_grid_y, max_y = 0;
+            for (u32 y = 0; y < light_cluster_grid_y; ++y) {
+                u32 first = slice_first + y * light_cluster_grid_x;
+                if ((clusters->max_y[first] >= bounds->centre.y - r) && (clusters->min_y[first] <= bounds->centre.y + r)) {
+                    min_y = y < min_y ? y : min_y;
+                    max_y = y;
+                }
+            }
+
+            for (u32 y = min_y; y <= max_y; ++y) {
+                u32 row = slice_first + y * light_cluster_grid_x;
+                for (u32 x = min_x & ~3u; x <= max_x; x += 4) {
+                    u32 mask = light_bounds_test_x4(clusters, bounds, row + x);
+                    for (u32 lane = 0; lane < 4; ++lane) {
+                        u32 tile_x = x + lane;
+                        if (!(mask & (1u << lane)) || (tile_x < min_x) || (tile_x > max_x)) {
+                            continue;
+                        }
+
+                        u32 cluster_index = row + tile_x;
+                        if (job->cursor) {
+                            clusters->indices[job->cursor[cluster_index]++] = light_index;
+                        } else {
+                            ++clusters->clusters[cluster_index].count;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+function void
+light_clusters_build(Light_Clusters *clusters, Job_System *jobs, Arena *arena, Light_View *view,
+                     Light *lights, u32 light_count) {
+    clusters->view = *view;
+    clusters->lights = lights;
+    clusters->light_count = light_count;
+
+    f32 near_plane = view->near_plane;
+    f32 far_plane = view->far_plane;
+    f32 log_depth_range = log2f(far_plane / near_plane);
+    clusters->z_scale = (f32)light_cluster_grid_z / log_depth_range;
+    clusters->z_bias = -(f32)light_cluster_grid_z * log2f(near_plane) / log_depth_range;
+
+    f32 **streams[] = {
+        &clusters->min_x, &clusters->min_y, &clusters->min_z,
+        &clusters->max_x, &clusters->max_y, &clusters->max_z,
+        &clusters->centre_x, &clusters->centre_y, &clusters->centre_z, &clusters->radius,
+    };
+    for (u32 stream = 0; stream < array_count(streams); ++stream) {
+        *streams[stream] = arena_push_array(arena, f32, light_cluster_count);
+    }
+    clusters->bounds = arena_push_array(arena, Light_Bounds, light_count);
+    clusters->packed = arena_push_array(arena, Light_Packed, light_count);
+    clusters->clusters = arena_push_array(arena, Light_Cluster, light_cluster_count);
+    u32 *cursor = arena_push_array(arena, u32, light_cluster_count);
+    if (!clusters->radius || !clusters->bounds || !clusters->packed || !clusters->clusters || !cursor) {
+        os_fatal_error(str8("Out of light cluster memory"));
+    }
+
+    // Froxel bounds only depend on the projection, but they're cheap enough to redo every frame.
+    // Padded a little so a pixel whose depth rounds into the neighbouring slice still finds its lights.
+    for (u32 z = 0; z < light_cluster_grid_z; ++z) {
+        f32 z0 = near_plane * powf(far_plane / near_plane, (f32)z / (f32)light_cluster_grid_z);
+        f32 z1 = near_plane * powf(far_plane / near_plane, (f32)(z + 1) / (f32)light_cluster_grid_z);
+        f32 pad = z1 * 1e-3f;
+        for (u32 y = 0; y < light_cluster_grid_y; ++y) {
+            f32 ndc_top = 1.0f - 2.0f * (f32)y / (f32)light_cluster_grid_y;
+            f32 ndc_bottom = 1.0f - 2.0f * (f32)(y + 1) / (f32)light_cluster_grid_y;
+            for (u32 x = 0; x < light_cluster_grid_x; ++x) {
+                f32 ndc_left = -1.0f + 2.0f * (f32)x / (f32)light_cluster_grid_x;
+                f32 ndc_right = -1.0f + 2.0f * (f32)(x + 1) / (f32)light_cluster_grid_x;
+                u32 index = (z * light_cluster_grid_y + y) * light_cluster_grid_x + x;
+
+                f32 min_x = (ndc_left < 0.0f ? ndc_left * z1 : ndc_left * z0) / view->projection_x;
+                f32 max_x = (ndc_right > 0.0f ? ndc_right * z1 : ndc_right * z0) / view->projection_x;
+                f32 min_y = (ndc_bottom < 0.0f ? ndc_bottom * z1 : ndc_bottom * z0) / view->projection_y;
+                f32 max_y = (ndc_top > 0.0f ? ndc_top * z1 : ndc_top * z0) / view->projection_y;
+
+                clusters->min_x[index] = min_x - pad;
+                clusters->max_x[index] = max_x + pad;
+                clusters->min_y[index] = min_y - pad;
+                clusters->max_y[index] = max_y + pad;
+                clusters->min_z[index] = z0 - pad;
+                clusters->max_z[index] = z1 + pad;
+
+                v3f half = v3f_make(0.5f * (max_x - min_x) + pad, 0.5f * (max_y - min_y) + pad, 0.5f * (z1 - z0) + pad);
+                clusters->centre_x[index] = 0.5f * (min_x + max_x);
+                clusters->centre_y[index] = 0.5f * (min_y + max_y);
+                clusters->centre_z[index] = 0.5f * (z0 + z1);
+                clusters->radius[index] = sqrtf(v3f_dot(half, half));
+            }
+        }
+    }
+
+    Job_Fence fence = { 0 };
+    job_parallel_for(jobs, &fence, light_count, light_bounds_per_job, light_bounds_job, clusters);
+    job_wait(jobs, &fence);
+
+    clusters->directional_count = 0;
+    clusters->point_count = 0;
+    clusters->spot_count = 0;
+    for (u32 light_index = 0; light_index < light_count; ++light_index) {
+        if (lights[light_index].enabled && (lights[light_index].type == LightType_Directional)) {
+            ++clusters->directional_count;
+        } else if (clusters->bounds[light_index].binned) {
+            if (lights[light_index].type == LightType_Point) {
+                ++clusters->point_count;
+            } else {
+                ++clusters->spot_count;
+            }
+        }
+    }
+
+    Light_Bin_Job job;
+    job.clusters = clusters;
+    job.cursor = null;
+    job_parallel_for(jobs, &fence, light_cluster_grid_z, 1, light_bin_job, &job);
+    job_wait(jobs, &fence);
+
+    u64 running = clusters->directional_count;
+    for (u32 cluster_index = 0; cluster_index < light_cluster_count; ++cluster_index) {
+        clusters->clusters[cluster_index].offset = (u32)running;
+        cursor[cluster_index] = (u32)running;
+        running += clusters->clusters[cluster_index].count;
+    }
+    clusters->index_count = running;
+    clusters->indices = arena_push_array(arena, u32, running);
+    if (running && !clusters->indices) {
+        os_fatal_error(str8("Out of light cluster memory"));
+    }
+
+    u32 directional_index = 0;
+    for (u32 light_index = 0; light_index < light_count; ++light_index) {
+        if (lights[light_index].enabled && (lights[light_index].type == LightType_Directional)) {
+            clusters->indices[directional_index++] = light_index;
+        }
+    }
+
+    job.cursor = cursor;
+    job_parallel_for(jobs, &fence, light_cluster_grid_z, 1, light_bin_job, &job);
+    job_wait(jobs, &fence);
+}
+
+function void
+light_clusters_constants(Light_Clusters *clusters, Light_Constants *constants, u32 target_width, u32 target_height) {
+    Light_Constants zero = { 0 };
+    *constants = zero;
+    constants->camera_p = clusters->view.camera_p;
+    constants->directional_count = clusters->directional_count;
+    constants->camera_forward = clusters->view.camera_forward;
+    constants->cluster_z_scale = clusters->z_scale;
+    constants->cluster_z_bias = clusters->z_bias;
+    constants->cluster_x_scale = (f32)light_cluster_grid_x / (f32)target_width;
+    constants->cluster_y_scale = (f32)light_cluster_grid_y / (f32)target_height;
+}
@@ -0,0 +1,155 @@
+#if !defined(S_LIGHT_H)
+#define S_LIGHT_H
+
+enum {
+    LightType_Directional,
+    LightType_Point,
+    LightType_Spotlight,
+    LightType_Count
+};
+
+// A light as the game sets it up. light_pack turns it into the Light_Packed the shaders read.
+typedef struct {
+    v3f p;
+    u32 type;
+
+    f32 reference_distance;
+    f32 max_distance;
+    f32 min_distance;
+    f32 __unused_a;
+
+    v3f direction;
+    u32 enabled;
+
+    f32 inner_angle;
+    f32 max_angle;
+    f32 __unused_c[2];
+
+    v4f colour;
+} Light;
+
+// What the shaders read per light, matches struct Light in the HLSL. Everything that only
+// depends on the light is worked out once per frame by light_pack instead of per pixel:
+//   attenuation = (reference_distance / max(d, min_distance))^2 * saturate(1 - (d / max_distance)^4)^2
+//               = reference_distance_sq * min(1 / d^2, inv_min_distance_sq) * saturate(1 - d^2 * d^2 * inv_max_distance4)^2
+//   spotlight   = smoothstep of saturate(cos_to_pixel * spot_scale + spot_offset)
+// Point lights get spot_scale 0 and spot_offset 1, so the cone term is 1 for them.
+typedef struct {
+    v3f p;
+    u32 type;
+
+    // unit for spotlights, as given for directional lights
+    v3f direction;
+    f32 inv_max_distance4;
+
+    v3f colour;
+    f32 reference_distance_sq;
+
+    f32 inv_min_distance_sq;
+    f32 spot_scale;
+    f32 spot_offset;
+    f32 __unused_a;
+} Light_Packed;
+
+// Everything the pixel shader needs to find its cluster. See light_clusters_constants.
+align_16 typedef struct {
+    v3f camera_p;
+    u32 directional_count;
+    v3f camera_forward;
+    f32 cluster_z_scale;
+    f32 cluster_z_bias;
+    f32 cluster_x_scale;
+    f32 cluster_y_scale;
+    f32 __unused_a;
+} Light_Constants;
+
+// The camera as the clusters see it. world_to_camera is the same row-vector look-at we upload,
+// projection_x and projection_y are m[0][0] and m[1][1] of the perspective.
+typedef struct {
+    v3f camera_p;
+    v3f camera_forward;
+    m44 world_to_camera;
+    f32 projection_x;
+    f32 projection_y;
+    f32 near_plane;
+    f32 far_plane;
+} Light_View;
+
+// Clustered forward shading: the view frustum is cut into a grid of froxels, screen tiles in x
+// and y and exponential slices of view depth in z. Every point and spot light is binned into
+// the clusters its max_distance (and cone) reaches, and a pixel only walks its own cluster's list.
+// Outside max_distance windowing() is exactly zero, and outside max_angle so is spotlight(), so
+// leaving a light out of a cluster it can't reach doesn't change the shading.
+//
+// Clusters are indexed (z * grid_y + y) * grid_x + x, with y = 0 at the top of the screen.
+#define light_cluster_grid_x 16
+#define light_cluster_grid_y 9
+#define light_cluster_grid_z 24
+#define light_cluster_count (light_cluster_grid_x * light_cluster_grid_y * light_cluster_grid_z)
+#define light_bounds_per_job 256
+
+// uint2 in the HLSL
+typedef struct {
+    u32 offset;
+    u32 count;
+} Light_Cluster;
+
+// A light's reach in view space, worked out once per frame before binning.
+typedef struct {
+    // sphere around everything the light can reach
+    v3f centre;
+    f32 radius;
+    // cone for spotlights, in view space
+    v3f apex;
+    f32 range;
+    v3f direction;
+    f32 cos_angle;
+    f32 sin_angle;
+    b32 cone;
+    // slices the sphere reaches, inclusive; binned is False for lights outside all of them
+    b32 binned;
+    u32 min_z, max_z;
+} Light_Bounds;
+
+typedef struct {
+    Light_View view;
+    Light *lights;
+    u32 light_count;
+    // one per light, disabled ones included so indices match
+    Light_Packed *packed;
+
+    // View-space AABB and bounding sphere of every cluster, SoA so that four clusters of a row
+    // load straight into f32x4 lanes.
+    f32 *min_x, *min_y, *min_z;
+    f32 *max_x, *max_y, *max_z;
+    f32 *centre_x, *centre_y, *centre_z, *radius;
+
+    Light_Bounds *bounds;
+
+    // indices[0, directional_count) are the directional lights, every pixel gets those. After
+    // that come the clusters' lists, clusters[c] pointing into indices. Lists are in light order.
+    Light_Cluster *clusters;
+    u32 *indices;
+    u64 index_count;
+    u32 directional_count;
+    // point and spot lights that reach at least one slice, i.e. that can show up in a list
+    u32 point_count;
+    u32 spot_count;
+
+    // slice = log2(view_z) * z_scale + z_bias
+    f32 z_scale;
+    f32 z_bias;
+} Light_Clusters;
+
+// Packs the lights and bins them into clusters. Everything is allocated from arena and lives as
+// long as it does. Disabled lights are skipped.
+function void light_clusters_build(Light_Clusters *clusters, Job_System *jobs, Arena *arena, Light_View *view,
+                                   Light *lights, u32 light_count);
+function Light_Packed light_pack(Light *light);
+// The scalar test binning does, one light against one cluster. For checking the binned lists.
+function b32 light_cluster_test(Light_Clusters *clusters, u32 light_index, u32 cluster_index);
+// Slice of a view-space depth, the same way the pixel shader finds it.
+function u32 light_cluster_slice(Light_Clusters *clusters, f32 view_z);
+function void light_clusters_constants(Light_Clusters *clusters, Light_Constants *constants, u32 target_width, u32 target_height);
+
+#endif
@@ -0,0 +1,299 @@
+// light_pack against the per-pixel formulas it replaced. Then light binning: every cluster's list
+// against light_cluster_test over every light and cluster, and against a brute force that puts
+// sample points of the frustum through the pixel shader's cluster lookup and checks every light
+// that actually reaches them is in that cluster's list.
+
+// Mix of everything binning sees: points, narrow and wide spots (past 90 degrees they get no cone),
+// directional and disabled lights, some of them around or behind the camera.
+function void
+light_test_scatter(Test_Random *random, Light *lights, u32 light_count, f32 extent) {
+    for (u32 light_index = 0; light_index < light_count; ++light_index) {
+        u32 kind = test_random_u32(random) % 20;
+        Light light = { 0 };
+        light.type = (kind < 9) ? LightType_Point : (kind < 18) ? LightType_Spotlight : LightType_Directional;
+        light.p = test_random_v3f(random, -extent, extent);
+        light.reference_distance = test_random_f32(random, 1.0f, 4.0f);
+        light.max_distance = test_random_f32(random, 0.5f, 16.0f);
+        light.min_distance = 1.0f;
+        light.direction = test_random_v3f(random, -1.0f, 1.0f);
+        light.max_angle = test_random_f32(random, 2.0f, 120.0f);
+        light.inner_angle = light.max_angle * 0.5f;
+        light.colour = v4f_make(1.0f, 1.0f, 1.0f, 1.0f);
+        light.enabled = (test_random_u32(random) % 16) != 0;
+        lights[light_index] = light;
+    }
+}
+
+// True when light contributes at p, pulled in a little from max_distance and max_angle so float
+// rounding right at the edge doesn't count.
+function b32
+light_test_reaches(Light *light, v3f p) {
+    v3f to_p = v3f_sub(p, light->p);
+    f32 distance = sqrtf(v3f_dot(to_p, to_p));
+    b32 result = distance < light->max_distance * 0.999f;
+    if (result && (light->type == LightType_Spotlight) && (distance > 0.0f)) {
+        v3f direction = light->direction;
+        v3f_norm(&direction);
+        f32 cos_to_p = v3f_dot(direction, to_p) / distance;
+        result = cos_to_p > cosf(radians(light->max_angle - 0.05f));
+    }
+    return(result);
+}
+
+// The per-pixel terms as ps_test_shading_model worked them out before light_pack, straight from
+// the Light.
+function f32
+light_test_old_attenuation(Light *light, f32 distance) {
+    f32 window = powf(fmaxf(1.0f - powf(distance / light->max_distance, 4.0f), 0.0f), 2.0f);
+    f32 result = powf(light->reference_distance / fmaxf(distance, light->min_distance), 2.0f) * window;
+    return(result);
+}
+
+function f32
+light_test_old_cone(Light *light, f32 cos_to_pixel) {
+    f32 cos_max = cosf(radians(light->max_angle));
+    f32 t = (cos_to_pixel - cos_max) / (cosf(radians(light->inner_angle)) - cos_max);
+    t = fminf(fmaxf(t, 0.0f), 1.0f);
+    f32 result = t * t * (3.0f - 2.0f * t);
+    return(result);
+}
+
+// And what shade_local does now with the packed light.
+function f32
+light_test_new_attenuation(Light_Packed *packed, f32 distance) {
+    f32 distance_sq = distance * distance;
+    f32 inv_distance = 1.0f / sqrtf(distance_sq);
+    f32 window = fminf(fmaxf(1.0f - distance_sq * distance_sq * packed->inv_max_distance4, 0.0f), 1.0f);
+    f32 result = packed->reference_distance_sq * fminf(inv_distance * inv_distance, packed->inv_min_distance_sq) * window * window;
+    return(result);
+}
+
+function f32
+light_test_new_cone(Light_Packed *packed, f32 cos_to_pixel) {
+    f32 t = fminf(fmaxf(cos_to_pixel * packed->spot_scale + packed->spot_offset, 0.0f), 1.0f);
+    f32 result = t * t * (3.0f - 2.0f * t);
+    return(result);
+}
+
+// light_pack against the formulas it replaced, over random lights and pixels. Attenuation is
+// compared relative to the light's peak, ref^2 / min_distance^2, since the windowing cancels to
+// nothing at max_distance either way. The cone divides by cos_inner - cos_max, so its difference is
+// measured in float epsilons over that range: a narrow penumbra is ill-conditioned in both.
+function void
+light_test_pack(void) {
+    u32 light_count = 2000000;
+    Test_Random random = test_random_make(14);
+    f64 worst_attenuation = 0.0;
+    f64 worst_cone = 0.0;
+    f64 worst_cone_absolute = 0.0;
+    u64 hard_edge_mismatches = 0;
+    u64 point_cones = 0;
+    for (u32 light_index = 0; light_index < light_count; ++light_index) {
+        Light light = { 0 };
+        light.type = (light_index & 1) ? LightType_Spotlight : LightType_Point;
+        light.reference_distance = test_random_f32(&random, 0.5f, 20.0f);
+        light.min_distance = test_random_f32(&random, 0.1f, 4.0f);
+        light.max_distance = test_random_f32(&random, 1.0f, 200.0f);
+        light.direction = v3f_make(0.0f, 0.0f, 1.0f);
+        light.max_angle = test_random_f32(&random, 1.0f, 89.0f);
+        light.inner_angle = test_random_f32(&random, 0.0f, light.max_angle);
+        // every 16th spot has no penumbra at all
+        b32 hard_edge = (light_index & 31) == 1;
+        if (hard_edge) {
+            light.inner_angle = light.max_angle;
+        }
+        Light_Packed packed = light_pack(&light);
+
+        f32 distance = test_random_f32(&random, 0.01f, light.max_distance * 1.2f);
+        f32 peak = (light.reference_distance * light.reference_distance) / (light.min_distance * light.min_distance);
+        f64 attenuation_error = fabs((f64)light_test_new_attenuation(&packed, distance) -
+                                     (f64)light_test_old_attenuation(&light, distance)) / peak;
+        worst_attenuation = attenuation_error > worst_attenuation ? attenuation_error : worst_attenuation;
+
+        if (light.type == LightType_Spotlight) {
+            f32 cos_max = cosf(radians(light.max_angle));
+            f32 cos_range = cosf(radians(light.inner_angle)) - cos_max;
+            f32 cos_to_pixel = test_random_f32(&random, cos_max - 2.0f * cos_range - 0.01f, 1.0f);
+            f32 new_cone = light_test_new_cone(&packed, cos_to_pixel);
+            if (hard_edge) {
+                // a step at cos_max instead of the old divide by zero, same either side of it
+                f32 expected = (cos_to_pixel > cos_max) ? 1.0f : 0.0f;
+                if (fabsf(cos_to_pixel - cos_max) > 2e-6f) {
+                    hard_edge_mismatches += new_cone != expected;
+                }
+            } else {
+                f64 cone_error = fabs((f64)new_cone - (f64)light_test_old_cone(&light, cos_to_pixel));
+                f64 cone_epsilons = cone_error * cos_range / FLT_EPSILON;
+                worst_cone = cone_epsilons > worst_cone ? cone_epsilons : worst_cone;
+                worst_cone_absolute = cone_error > worst_cone_absolute ? cone_error : worst_cone_absolute;
+            }
+        } else {
+            point_cones += (packed.spot_scale != 0.0f) || (packed.spot_offset != 1.0f) || (light_test_new_cone(&packed, -1.0f) != 1.0f);
+        }
+    }
+
+    test_check(worst_attenuation <= 4e-6, "attenuation differs by %g of its peak", worst_attenuation);
+    test_check(worst_cone <= 8.0, "cone differs by %g epsilons over its range", worst_cone);
+    test_check(!point_cones, "%llu point lights pack a cone", (unsigned long long)point_cones);
+    test_check(!hard_edge_mismatches, "%llu hard edged cones aren't a step at max_angle", (unsigned long long)hard_edge_mismatches);
+    printf("  pack: attenuation within %.2g of peak, cone within %.2g epsilons over its range (%.2g absolute)\n",
+           worst_attenuation, worst_cone, worst_cone_absolute);
+}
+
+function void
+test_light(void) {
+    light_test_pack();
+
+    u32 light_count = 1500;
+    u32 pose_count = 8;
+    u32 sample_count = 20000;
+    Test_Random random = test_random_make(11);
+    Light *lights = (Light *)malloc(light_count * sizeof(Light));
+    light_test_scatter(&random, lights, light_count, 40.0f);
+
+    Job_System jobs_1, jobs_4;
+    job_system_init(&jobs_1, 1);
+    job_system_init(&jobs_4, 4);
+    Arena arena_1 = arena_reserve(megabytes(64));
+    Arena arena_4 = arena_reserve(megabytes(64));
+    u8 *listed = (u8 *)malloc((u64)light_cluster_count * light_count);
+
+    u64 listed_total = 0;
+    u64 sampled_total = 0;
+    u64 lit_total = 0;
+    for (u32 pose = 0; pose < pose_count; ++pose) {
+        arena_clear(&arena_1);
+        arena_clear(&arena_4);
+
+        f32 aspect = (pose & 1) ? (9.0f / 16.0f) : (3.0f / 4.0f);
+        f32 near_plane = test_random_f32(&random, 0.1f, 2.0f);
+        f32 far_plane = near_plane * test_random_f32(&random, 20.0f, 500.0f);
+        v3f camera_p = test_random_v3f(&random, -30.0f, 30.0f);
+        v3f camera_forward = test_random_v3f(&random, -1.0f, 1.0f);
+        v3f_norm(&camera_forward);
+        f32 fov = radians(test_random_f32(&random, 40.0f, 100.0f));
+        m44 pers = m44_perspective_lh_z01(fov, aspect, near_plane, far_plane);
+        m44 world_to_camera = m44_look_at_lh(camera_p, v3f_add(camera_p, camera_forward), v3f_make(0.0f, 1.0f, 0.0f));
+
+        Light_View view;
+        view.camera_p = camera_p;
+        view.camera_forward = camera_forward;
+        view.world_to_camera = world_to_camera;
+        view.projection_x = pers.m[0][0];
+        view.projection_y = pers.m[1][1];
+        view.near_plane = near_plane;
+        view.far_plane = far_plane;
+
+        Light_Clusters clusters_1, clusters_4;
+        light_clusters_build(&clusters_1, &jobs_1, &arena_1, &view, lights, light_count);
+        light_clusters_build(&clusters_4, &jobs_4, &arena_4, &view, lights, light_count);
+        Light_Clusters *clusters = &clusters_4;
+
+        // lists don't depend on the worker count
+        b32 same = (clusters_1.index_count == clusters_4.index_count) &&
+            (memory_compare(clusters_1.clusters, clusters_4.clusters, light_cluster_count * sizeof(Light_Cluster)) == 0) &&
+            (memory_compare(clusters_1.indices, clusters_4.indices, clusters_4.index_count * sizeof(u32)) == 0);
+        test_check(same, "pose %u: 1 and 4 workers bin differently", pose);
+
+        // directional lights first, in light order
+        u32 directional_count = 0;
+        u32 point_count = 0;
+        u32 spot_count = 0;
+        for (u32 light_index = 0; light_index < light_count; ++light_index) {
+            Light *light = lights + light_index;
+            if (light->enabled && (light->type == LightType_Directional)) {
+                test_check(clusters->indices[directional_count] == light_index,
+                           "pose %u: directional %u not at the front", pose, light_index);
+                ++directional_count;
+            } else if (clusters->bounds[light_index].binned) {
+                test_check(light->enabled, "pose %u: disabled light %u binned", pose, light_index);
+                point_count += light->type == LightType_Point;
+                spot_count += light->type == LightType_Spotlight;
+            }
+        }
+        test_check((clusters->directional_count == directional_count) && (clusters->point_count == point_count) &&
+                   (clusters->spot_count == spot_count), "pose %u: light counts differ", pose);
+
+        // every list is ascending, inside indices and right after the one before it
+        memset(listed, 0, (u64)light_cluster_count * light_count);
+        u64 expected_offset = clusters->directional_count;
+        for (u32 cluster_index = 0; cluster_index < light_cluster_count; ++cluster_index) {
+            Light_Cluster *cluster = clusters->clusters + cluster_index;
+            if (!test_check((cluster->offset == expected_offset) && (cluster->offset + cluster->count <= clusters->index_count),
+                            "pose %u cluster %u: list [%u, +%u) out of place", pose, cluster_index, cluster->offset, cluster->count)) {
+                break;
+            }
+            expected_offset += cluster->count;
+            for (u32 entry = 0; entry < cluster->count; ++entry) {
+                u32 light_index = clusters->indices[cluster->offset + entry];
+                test_check((entry == 0) || (clusters->indices[cluster->offset + entry - 1] < light_index),
+                           "pose %u cluster %u: list out of light order", pose, cluster_index);
+                if (light_index < light_count) {
+                    listed[(u64)cluster_index * light_count + light_index] = True;
+                }
+            }
+            listed_total += cluster->count;
+        }
+        test_check(expected_offset == clusters->index_count, "pose %u: index_count doesn't cover the lists", pose);
+
+        // The lists are exactly what the scalar test says: the row and column pre-pass only skips
+        // clusters the test would reject anyway.
+        u64 missing = 0;
+        u64 extra = 0;
+        for (u32 cluster_index = 0; cluster_index < light_cluster_count; ++cluster_index) {
+            for (u32 light_index = 0; light_index < light_count; ++light_index) {
+                b32 expected = light_cluster_test(clusters, light_index, cluster_index);
+                u8 got = listed[(u64)cluster_index * light_count + light_index];
+                missing += expected && !got;
+                extra += !expected && got;
+            }
+        }
+        test_check(!missing && !extra, "pose %u: lists differ from light_cluster_test, %llu missing, %llu extra",
+                   pose, (unsigned long long)missing, (unsigned long long)extra);
+
+        // Points spread over the frustum, found the way ps_test_shading_model finds its cluster:
+        // tile from the screen position, slice from view depth.
+        m44 camera_to_world = m44_inverse_affine(world_to_camera);
+        u64 unlit = 0;
+        for (u32 sample = 0; sample < sample_count; ++sample) {
+            f32 ndc_x = test_random_f32(&random, -1.0f, 1.0f);
+            f32 ndc_y = test_random_f32(&random, -1.0f, 1.0f);
+            f32 view_z = near_plane * powf(far_plane / near_plane, test_random_f32(&random, 0.0f, 1.0f));
+            v4f view_p = v4f_make(ndc_x * view_z / view.projection_x, ndc_y * view_z / view.projection_y, view_z, 1.0f);
+            v3f p = m44_mul_v4f(camera_to_world, view_p).xyz;
+
+            u32 tile_x = (u32)((ndc_x * 0.5f + 0.5f) * (f32)light_cluster_grid_x);
+            u32 tile_y = (u32)((0.5f - ndc_y * 0.5f) * (f32)light_cluster_grid_y);
+            tile_x = tile_x < light_cluster_grid_x ? tile_x : light_cluster_grid_x - 1;
+            tile_y = tile_y < light_cluster_grid_y ? tile_y : light_cluster_grid_y - 1;
+            u32 slice = light_cluster_slice(clusters, view_z);
+            u32 cluster_index = (slice * light_cluster_grid_y + tile_y) * light_cluster_grid_x + tile_x;
+
+            for (u32 light_index = 0; light_index < light_count; ++light_index) {
+                Light *light = lights + light_index;
+                if (!light->enabled || (light->type == LightType_Directional) || !light_test_reaches(light, p)) {
+                    continue;
+                }
+                ++lit_total;
+                if (!listed[(u64)cluster_index * light_count + light_index]) {
+                    if (unlit++ < 4) {
+                        printf("  pose %u: light %u reaches (%f, %f, %f) but isn't in cluster %u\n",
+                               pose, light_index, p.x, p.y, p.z, cluster_index);
+                    }
+                }
+            }
+        }
+        sampled_total += sample_count;
+        test_check(!unlit, "pose %u: %llu sampled points miss a light that reaches them", pose, (unsigned long long)unlit);
+    }
+
+    printf("  %u poses, %llu list entries, %llu light hits over %llu sampled points\n", pose_count,
+           (unsigned long long)listed_total, (unsigned long long)lit_total, (unsigned long long)sampled_total);
+
+    free(listed);
+    arena_release(&arena_1);
+    arena_release(&arena_4);
+    job_system_release(&jobs_1);
+    job_system_release(&jobs_4);
+    free(lights);
+}
@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define WIN32_LEAN_AND_MEAN
 #define COBJMACROS
@@ -10,284 +12,72 @@
 #include <d3dcompiler.h>
 #include <dxgi.h>
 #include <dxgi1_2.h>
+#include <dxgi1_3.h>
 
 #include <float.h>
 #include <math.h>
 
 #include "s_base.h"
+#include "s_os.h"
+#include "s_profile.h"
+#include "s_simd.h"
 #include "s_math.h"
+#include "s_job.h"
+#include "s_r3d.h"
+#include "s_cull.h"
+#include "s_light.h"
+#include "s_mesh.h"
+#include "s_mesh_lod.h"
+#include "s_mesh_pack.h"
+#include "s_batch.h"
+#include "s_frame_clock.h"
+#include "s_game.h"
+#include "s_state_cache.h"
+#include "s_render_command.h"
+#include "s_shader_cache.h"
+#include "s_shading_permutation.h"
+#include "s_dynamic_resolution.h"
+#include "s_downsample.h"
+#include "s_vertex_format.h"
 
 #include "s_base.c"
+#include "s_os.c"
+#include "s_os_win32.c"
+#include "s_profile.c"
+#include "s_simd.c"
 #include "s_math.c"
-
-typedef struct {
-	u32 client_width;
-	u32 client_height;
-	b32 resized_this_frame;
-	HWND handle;
-    b32 is_focus;
-} OS_Window;
-
-typedef u8 OS_Input_Flags;
-enum {
-	OSInput_Flag_Quit = (1 << 0),
-};
-
-typedef u16 OS_Input_Interact_Flags;
-enum {
-	OSInput_Interact_Pressed = (1 << 1),
-	OSInput_Interact_Released = (1 << 2),
-	OSInput_Interact_Held = (1 << 3),
-};
-
-typedef u16 OS_Input_Key;
-enum {
-	OSInput_Key_Shift,
-	OSInput_Key_Space,
-	OSInput_Key_Escape,
-	OSInput_Key_W,
-	OSInput_Key_A,
-	OSInput_Key_S,
-	OSInput_Key_D,
-	OSInput_Key_Up,
-	OSInput_Key_Down,
-	OSInput_Key_Left,
-	OSInput_Key_Right,
-	OSInput_Key_Count,
-};
-
-typedef struct {
-	OS_Input_Flags flags;
-	OS_Input_Interact_Flags key_input[OSInput_Key_Count];
-    
-	s32 mouse_displace_x, mouse_displace_y;
-} OS_Input;
-
-function s32
-os_message_box(String_Const_U8 title, String_Const_U8 message) {
-	s32 result = MessageBoxA(null, (char *)(message.str),
-							 (char *)(title.str),
-							 MB_OK);
-	return(result);
-}
-
-function OS_Window
-os_create_window(String_Const_U8 name, u32 width, u32 height) {
-	OS_Window result;
-    
-	RECT window_rect;
-	window_rect.left = 0;
-	window_rect.top = 0;
-	window_rect.right = width;
-	window_rect.bottom = height;
-	AdjustWindowRect(&window_rect, WS_OVERLAPPEDWINDOW, FALSE);
-    
-	HWND window_handle = CreateWindowA("my_window_class",
-									   (char *)name.str, WS_OVERLAPPEDWINDOW,
-                                       0, 0, window_rect.right - window_rect.left,
-                                       window_rect.bottom - window_rect.top, null,
-                                       null, GetModuleHandleA(null), null);
-    
-	if (!IsWindow(window_handle)) {
-		os_message_box(str8("Error"), str8("Failed To Create Window"));
-		ExitProcess(1);
-	}
-    
-	ShowWindow(window_handle, SW_SHOW);
-    
-	result.client_width = width;
-	result.client_height = height;
-	result.resized_this_frame = False;
-	result.handle = window_handle;
-	return(result);
-}
-
-function LRESULT __stdcall
-w32_window_proc(HWND window, UINT message, 
-				WPARAM wparam, LPARAM lparam) {
-	LRESULT result = 0;
-    
-	OS_Window *os_window = (OS_Window *)GetWindowLongPtrA(window, GWLP_USERDATA);
-	switch (message) {
-		case WM_CLOSE: {
-			DestroyWindow(window);
-		} break;
-        
-		case WM_SIZE: {
-			if (os_window) {
-				u32 new_width = (u32)LOWORD(lparam);
-				u32 new_height = (u32)HIWORD(lparam);
-                
-				os_window->client_width = new_width;
-				os_window->client_height = new_height;
-				os_window->resized_this_frame = False;
-			}
-		} break;
-        
-        case WM_KILLFOCUS: {
-            if (os_window) {
-                os_window->is_focus = False;
-            }
-        } break;
-        
-        case WM_SETFOCUS: {
-            if (os_window) {
-                os_window->is_focus = True;
-            }
-        } break;
-        
-		case WM_DESTROY: {
-			PostQuitMessage(0);
-		} break;
-        
-		default: {
-			return DefWindowProc(window, message, wparam, lparam);
-		} break;
-	}
-    
-	return(result);
-}
-
-function OS_Input_Key
-w32_map_wparam_to_input_key(WPARAM wparam) {
-	OS_Input_Key result;
-    
-	switch (wparam) {
-		case VK_SHIFT: {
-			result = OSInput_Key_Shift;
-		} break;
-        
-		case VK_SPACE: {
-			result = OSInput_Key_Space;
-		} break;
-        
-		case VK_ESCAPE: {
-			result = OSInput_Key_Escape;
-		} break;
-        
-		case 'W': {
-			result = OSInput_Key_W;
-		} break;
-		
-		case 'A': {
-			result = OSInput_Key_A;
-		} break;
-        
-		case 'S': {
-			result = OSInput_Key_S;
-		} break;
-		
-		case 'D': {
-			result = OSInput_Key_D;
-		} break;
-        
-		case VK_UP: {
-			result = OSInput_Key_Up;
-		} break;
-		
-		case VK_DOWN: {
-			result = OSInput_Key_Down;
-		} break;
-		
-		case VK_LEFT: {
-			result = OSInput_Key_Left;
-		} break;
-        
-		case VK_RIGHT: {
-			result = OSInput_Key_Right;
-		} break;
-		
-		default: {
-			result = OSInput_Key_Count;
-		} break;
-	}
-    
-	return(result);
-}
-
-function void
-os_fill_events(OS_Input *input, OS_Window *window) {
-	for (u64 key_index = 0; key_index < array_count(input->key_input); ++key_index) {
-		input->key_input[key_index] &= ~(OSInput_Interact_Pressed | OSInput_Interact_Released);
-	}
-    
-	window->resized_this_frame = False;
-	SetWindowLongPtrA(window->handle, GWLP_USERDATA, (LONG_PTR)window);
-    
-	MSG message;
-	while (PeekMessageA(&message, null, 0, 0, PM_REMOVE) != 0) {
-		switch (message.message) {
-			case WM_QUIT: {
-				input->flags |= OSInput_Flag_Quit;
-			} break;
-			
-			case WM_KEYDOWN: {
-				OS_Input_Key key = w32_map_wparam_to_input_key(message.wParam);
-				if (key != OSInput_Key_Count) {
-					input->key_input[key] |= (OSInput_Interact_Pressed | OSInput_Interact_Held);
-				}
-			} break;
-			
-			case WM_KEYUP: {
-				OS_Input_Key key = w32_map_wparam_to_input_key(message.wParam);
-				if (key != OSInput_Key_Count) {
-					input->key_input[key] |= (OSInput_Interact_Released);
-					input->key_input[key] &= ~(OSInput_Interact_Held);
-				}
-			} break;
-            
-			default: {
-				TranslateMessage(&message);
-				DispatchMessage(&message);
-			} break;
-		}
-	}
-    
-    if (window->is_focus) {
-        POINT cursor_p;
-        GetCursorPos(&cursor_p);
-        ScreenToClient(window->handle, &cursor_p);
-        
-        input->mouse_displace_x = cursor_p.x - (window->client_width / 2);
-        input->mouse_displace_y = cursor_p.y - (window->client_height / 2);
-        
-        POINT new_cursor;
-        new_cursor.x = window->client_width / 2;
-        new_cursor.y = window->client_height / 2;
-        ClientToScreen(window->handle, &new_cursor);
-        SetCursorPos(new_cursor.x, new_cursor.y);
-        
-        SetCursor(null);
-    }
-}
-
-function b32
-os_input_pressed(OS_Input *input, OS_Input_Key key) {
-	b32 result = (input->key_input[key] & OSInput_Interact_Pressed) != 0;
-	return(result);
-}
-
-function b32
-os_input_released(OS_Input *input, OS_Input_Key key) {
-	b32 result = (input->key_input[key] & OSInput_Interact_Released) != 0;
-	return(result);
-}
-
-function b32
-os_input_held(OS_Input *input, OS_Input_Key key) {
-	b32 result = (input->key_input[key] & OSInput_Interact_Held) != 0;
-	return(result);
-}
+#include "s_job.c"
+#include "s_r3d.c"
+#include "s_cull.c"
+#include "s_light.c"
+#include "s_mesh.c"
+#include "s_mesh_lod.c"
+#include "s_mesh_pack.c"
+#include "s_batch.c"
+#include "s_frame_clock.c"
+#include "s_game.c"
+#include "s_state_cache.c"
+#include "s_render_command.c"
+#include "s_shader_cache.c"
+#include "s_shading_permutation.c"
+#include "s_dynamic_resolution.c"
+#include "s_downsample.c"
+#include "s_vertex_format.c"
 
 typedef struct {
 	ID3D11Device *base_device;
 	ID3D11Device1 *main_device;
 	ID3D11DeviceContext *base_device_context;
 	IDXGISwapChain1 *swap_chain;
+    // signalled when the swap chain can take another frame, see the top of the frame loop
+    HANDLE frame_latency_waitable;
 	ID3D11Texture2D *back_buffer;
     ID3D11Texture2D *offscreen_back_buffer;
     ID3D11RenderTargetView *offscreen_back_buffer_rtv;
     ID3D11ShaderResourceView *offscreen_back_buffer_srv;
+    // what downsample_cs writes, copied to back_buffer afterwards
+    ID3D11Texture2D *resolve_texture;
+    ID3D11UnorderedAccessView *resolve_uav;
 	ID3D11RenderTargetView *back_buffer_as_rtv;
 	ID3D11RasterizerState1 *fill_cull_raster;
 	ID3D11RasterizerState1 *wire_nocull_raster;
@@ -300,55 +90,44 @@ typedef struct {
     ID3D11SamplerState *sampler_for_high_res_buffer;
 } D3D11_State;
 
-enum {
-    LightType_Directional,
-    LightType_Point,
-    LightType_Spotlight,
-    LightType_Count
-};
-
 typedef struct {
-    v3f p;
-    u32 type;
-    
-    f32 reference_distance;
-    f32 max_distance;
-    f32 min_distance;
-    f32 __unused_a;
-    
-    v3f direction;
-    u32 enabled;
-    
-    f32 inner_angle;
-    f32 max_angle;
-    f32 __unused_c[2];
-    
     v4f colour;
-} Light;
+} Material;
 
-__declspec(align(16)) typedef struct {
-	m44 perspective;
-	m44 world_to_camera;
-    v3f camera_p;
-    f32 __unused_a;
-} D3D11_Constants;
+// Matches cbuffer Downsample_Constants.
+align_16 typedef struct {
+    f32 source_texel_size[2];
+    f32 source_ratio[2];
+    f32 source_uv_max[2];
+    u32 source_max_texel[2];
+    u32 destination_size[2];
+    f32 __unused_a[2];
+} D3D11_Downsample_Constants;
 
-__declspec(align(16)) typedef struct {
-    Light light[8];
-    v3f camera_p;
-    f32 __unused_a;
-} Light_Constants;
+// Matches cbuffer Draw_Constants. SV_InstanceID starts at 0 whatever StartInstanceLocation is,
+// so each batch's draw says where its run of visible_instances begins.
+align_16 typedef struct {
+    u32 instance_base;
+    u32 __unused_a[3];
+} D3D11_Draw_Constants;
 
-typedef struct {
-    v4f colour;
-} Material;
+// GPU time of a whole frame, and of named zones in it, from timestamp queries. A frame's result is
+// read back when its slot comes round again, d3d11_gpu_timer_frames - 1 frames later, so the CPU
+// never waits on the GPU.
+#define d3d11_gpu_timer_frames 4
+#define d3d11_gpu_timer_zone_max 8
 
 typedef struct {
-	v3f position;
-	quat orient;
-	v3f scale;
-	v4f colour;
-} Model_Instance;
+    ID3D11Query *disjoint[d3d11_gpu_timer_frames];
+    // [slot][0] when the frame began, [slot][zone + 1] when the zone ended; a zone starts where
+    // the one before it ended
+    ID3D11Query *timestamps[d3d11_gpu_timer_frames][d3d11_gpu_timer_zone_max + 1];
+    char *zone_names[d3d11_gpu_timer_frames][d3d11_gpu_timer_zone_max];
+    u32 zone_count[d3d11_gpu_timer_frames];
+    // os_time_ticks when the frame began, where its zones are put on the profiler's GPU track
+    u64 cpu_begin[d3d11_gpu_timer_frames];
+    u64 frame_index;
+} D3D11_GPU_Timer;
 
 #define multisample_count 4
 #define multisample_quality D3D11_STANDARD_MULTISAMPLE_PATTERN
@@ -391,17 +170,30 @@ d3d11_create_swap_chain(D3D11_State *state, OS_Window *os_window) {
 	swap_chain_desc1.Scaling = DXGI_SCALING_STRETCH;
 	swap_chain_desc1.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
 	swap_chain_desc1.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
-	swap_chain_desc1.Flags = 0;
+	swap_chain_desc1.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
     
 	result = IDXGIFactory2_CreateSwapChainForHwnd(dxgi_factory, (IUnknown *)state->base_device,
-												  os_window->handle, &swap_chain_desc1,
+												  (HWND)os_window->handle, &swap_chain_desc1,
 												  null, null, &(state->swap_chain));
 	if (result != S_OK) {
 		// TODO(christian): Log
 		ExitProcess(0);
 	}
 	
-	result = IDXGIFactory2_MakeWindowAssociation(dxgi_factory, os_window->handle, DXGI_MWA_NO_ALT_ENTER);
+	// https://learn.microsoft.com/en-us/windows/uwp/gaming/reduce-latency-with-dxgi-1-3-swap-chains
+	// One frame queued at most: the CPU waits before it starts a frame instead of in Present, so
+	// input is read as late as it can be.
+	IDXGISwapChain2 *swap_chain2 = null;
+	result = IDXGISwapChain1_QueryInterface(state->swap_chain, &IID_IDXGISwapChain2, &swap_chain2);
+	if (result != S_OK) {
+		// TODO(christian): Log
+		ExitProcess(0);
+	}
+	IDXGISwapChain2_SetMaximumFrameLatency(swap_chain2, 1);
+	state->frame_latency_waitable = IDXGISwapChain2_GetFrameLatencyWaitableObject(swap_chain2);
+	IDXGISwapChain2_Release(swap_chain2);
+	
+	result = IDXGIFactory2_MakeWindowAssociation(dxgi_factory, (HWND)os_window->handle, DXGI_MWA_NO_ALT_ENTER);
 	
 	if (result != S_OK) {
 		// TODO(christian): Log
@@ -431,12 +223,14 @@ d3d11_create_swap_chain(D3D11_State *state, OS_Window *os_window) {
     
     D3D11_TEXTURE2D_DESC backbuffer_desc = { 0 };
     ID3D11Texture2D_GetDesc(state->back_buffer, &backbuffer_desc);
+    // sized for dynamic resolution's largest scale, frames are drawn into a sub-rectangle of it
     D3D11_TEXTURE2D_DESC multisampled_offscreen_desc = {0};
     multisampled_offscreen_desc.Width = swap_chain_desc1.Width * 2;
     multisampled_offscreen_desc.Height = swap_chain_desc1.Height * 2;
     multisampled_offscreen_desc.MipLevels = 1;
     multisampled_offscreen_desc.ArraySize = 1;
-    multisampled_offscreen_desc.Format = backbuffer_desc.Format;
+    // written as UNORM, read through an _SRGB view so the downsample filters in linear light
+    multisampled_offscreen_desc.Format = DXGI_FORMAT_R8G8B8A8_TYPELESS;
     
     // https://learn.microsoft.com/en-us/windows/win32/api/dxgicommon/ns-dxgicommon-dxgi_sample_desc
     multisampled_offscreen_desc.SampleDesc.Count = 1;
@@ -451,7 +245,7 @@ d3d11_create_swap_chain(D3D11_State *state, OS_Window *os_window) {
 	}
     
     D3D11_SHADER_RESOURCE_VIEW_DESC offscreen_back_buffer_srv_desc = { 0 }; 
-    offscreen_back_buffer_srv_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    offscreen_back_buffer_srv_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
     offscreen_back_buffer_srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
     offscreen_back_buffer_srv_desc.Texture2D.MipLevels = 1;
     result = ID3D11Device1_CreateShaderResourceView(state->main_device,
@@ -468,6 +262,25 @@ d3d11_create_swap_chain(D3D11_State *state, OS_Window *os_window) {
     offscreen_back_buffer_view_desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
     result = ID3D11Device1_CreateRenderTargetView(state->main_device, (ID3D11Resource *)state->offscreen_back_buffer,
                                                   &offscreen_back_buffer_view_desc, &(state->offscreen_back_buffer_rtv));
+    if (result != S_OK) {
+		// TODO(christian): Log
+		ExitProcess(0);
+	}
+    
+    D3D11_TEXTURE2D_DESC resolve_desc = backbuffer_desc;
+    resolve_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    resolve_desc.Usage = D3D11_USAGE_DEFAULT;
+    resolve_desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+    resolve_desc.CPUAccessFlags = 0;
+    resolve_desc.MiscFlags = 0;
+    result = ID3D11Device1_CreateTexture2D(state->main_device, &resolve_desc, null, &(state->resolve_texture));
+    if (result != S_OK) {
+		// TODO(christian): Log
+		ExitProcess(0);
+	}
+    
+    result = ID3D11Device1_CreateUnorderedAccessView(state->main_device, (ID3D11Resource *)state->resolve_texture,
+                                                     null, &(state->resolve_uav));
     if (result != S_OK) {
 		// TODO(christian): Log
 		ExitProcess(0);
@@ -477,11 +290,33 @@ d3d11_create_swap_chain(D3D11_State *state, OS_Window *os_window) {
 	IDXGIFactory2_Release(dxgi_factory);
 }
 
+// Refresh rate of the display the swap chain is on, 60 when DXGI or the display settings won't say.
+function f32
+d3d11_refresh_hz(D3D11_State *state) {
+    f32 result = 60.0f;
+    IDXGIOutput *output = null;
+    if (IDXGISwapChain1_GetContainingOutput(state->swap_chain, &output) == S_OK) {
+        DXGI_OUTPUT_DESC output_desc;
+        if (IDXGIOutput_GetDesc(output, &output_desc) == S_OK) {
+            DEVMODEW mode = { 0 };
+            mode.dmSize = sizeof(mode);
+            // 0 and 1 mean the hardware default, which says nothing
+            if (EnumDisplaySettingsW(output_desc.DeviceName, ENUM_CURRENT_SETTINGS, &mode) &&
+                (mode.dmDisplayFrequency > 1)) {
+                result = (f32)mode.dmDisplayFrequency;
+            }
+        }
+        IDXGIOutput_Release(output);
+    }
+    return(result);
+}
+
 function void
 d3d11_initialize(D3D11_State *d3d11_state, OS_Window *os_window) {
 	D3D_FEATURE_LEVEL feature_level = D3D_FEATURE_LEVEL_11_0;
+    // not SINGLETHREADED, deferred contexts record on the job workers and need the device's locking
 	HRESULT result = D3D11CreateDevice(null, D3D_DRIVER_TYPE_HARDWARE, null,
-                                       D3D11_CREATE_DEVICE_SINGLETHREADED | D3D11_CREATE_DEVICE_DEBUG |
+                                       D3D11_CREATE_DEVICE_DEBUG |
                                        D3D11_CREATE_DEVICE_BGRA_SUPPORT,
 									   &feature_level, 1, D3D11_SDK_VERSION,
 									   &(d3d11_state->base_device), null, 
@@ -602,7 +437,8 @@ d3d11_initialize(D3D11_State *d3d11_state, OS_Window *os_window) {
 	}
     
     D3D11_SAMPLER_DESC sampler_desc = { 0 };
-    sampler_desc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+    // downsample's bilinear taps
+    sampler_desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
     sampler_desc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
     sampler_desc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
     sampler_desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
@@ -619,38 +455,545 @@ d3d11_initialize(D3D11_State *d3d11_state, OS_Window *os_window) {
     ID3D11Device1_CreateSamplerState(d3d11_state->main_device, &sampler_desc, &d3d11_state->sampler_for_high_res_buffer);
 }
 
-typedef struct {
-    Model_Instance *instances;
-    u64 capacity;
-    u64 count;
-} R3D_Buffer;
+function void
+d3d11_gpu_timer_init(D3D11_State *state, D3D11_GPU_Timer *timer) {
+    D3D11_GPU_Timer zero = { 0 };
+    *timer = zero;
+    
+    D3D11_QUERY_DESC disjoint_desc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+    D3D11_QUERY_DESC timestamp_desc = { D3D11_QUERY_TIMESTAMP, 0 };
+    for (u32 slot = 0; slot < d3d11_gpu_timer_frames; ++slot) {
+        b32 created = ID3D11Device1_CreateQuery(state->main_device, &disjoint_desc, &timer->disjoint[slot]) == S_OK;
+        for (u32 timestamp = 0; timestamp <= d3d11_gpu_timer_zone_max; ++timestamp) {
+            created = created && (ID3D11Device1_CreateQuery(state->main_device, &timestamp_desc,
+                                                             &timer->timestamps[slot][timestamp]) == S_OK);
+        }
+        if (!created) {
+            os_message_box(str8("Error"), str8("Failed to create GPU Timer Queries"));
+            ExitProcess(1);
+        }
+    }
+}
+
+// The frame this slot timed d3d11_gpu_timer_frames frames ago, if the GPU is done with it, and its
+// zones handed to profile_gpu_zone. Call before d3d11_gpu_timer_begin reuses the slot.
+function b32
+d3d11_gpu_timer_read(D3D11_State *state, D3D11_GPU_Timer *timer, f32 *milliseconds) {
+    if (timer->frame_index < d3d11_gpu_timer_frames) {
+        return(False);
+    }
+    
+    u32 slot = (u32)(timer->frame_index % d3d11_gpu_timer_frames);
+    u32 zone_count = timer->zone_count[slot];
+    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+    u64 timestamps[d3d11_gpu_timer_zone_max + 1];
+    ID3D11DeviceContext *context = state->base_device_context;
+    if (ID3D11DeviceContext_GetData(context, (ID3D11Asynchronous *)timer->disjoint[slot], &disjoint, sizeof(disjoint),
+                                    D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+        return(False);
+    }
+    for (u32 timestamp = 0; timestamp <= zone_count; ++timestamp) {
+        if (ID3D11DeviceContext_GetData(context, (ID3D11Asynchronous *)timer->timestamps[slot][timestamp],
+                                        &timestamps[timestamp], sizeof(u64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+            return(False);
+        }
+    }
+    
+    // the clock changed frequency somewhere in the frame, the timestamps mean nothing
+    if (disjoint.Disjoint || !disjoint.Frequency || !zone_count || (timestamps[zone_count] < timestamps[0])) {
+        return(False);
+    }
+    
+    // GPU and CPU clocks aren't related, the zones are laid out from when the CPU began the frame
+    u64 ticks_per_second = os_time_ticks_per_second();
+    for (u32 zone = 0; zone < zone_count; ++zone) {
+        u64 begin = timestamps[zone] - timestamps[0];
+        u64 end = timestamps[zone + 1] - timestamps[0];
+        profile_gpu_zone(timer->zone_names[slot][zone],
+                         timer->cpu_begin[slot] + (u64)((f64)begin * (f64)ticks_per_second / (f64)disjoint.Frequency),
+                         timer->cpu_begin[slot] + (u64)((f64)end * (f64)ticks_per_second / (f64)disjoint.Frequency));
+    }
+    
+    *milliseconds = (f32)((f64)(timestamps[zone_count] - timestamps[0]) * 1000.0 / (f64)disjoint.Frequency);
+    return(True);
+}
+
+function void
+d3d11_gpu_timer_begin(D3D11_State *state, D3D11_GPU_Timer *timer) {
+    u32 slot = (u32)(timer->frame_index % d3d11_gpu_timer_frames);
+    timer->zone_count[slot] = 0;
+    timer->cpu_begin[slot] = os_time_ticks();
+    ID3D11DeviceContext_Begin(state->base_device_context, (ID3D11Asynchronous *)timer->disjoint[slot]);
+    ID3D11DeviceContext_End(state->base_device_context, (ID3D11Asynchronous *)timer->timestamps[slot][0]);
+}
+
+// Ends a zone that started at the end of the last one, or at d3d11_gpu_timer_begin. name goes to
+// the profiler, so it is a string literal.
+function void
+d3d11_gpu_timer_zone(D3D11_State *state, D3D11_GPU_Timer *timer, char *name) {
+    u32 slot = (u32)(timer->frame_index % d3d11_gpu_timer_frames);
+    u32 zone = timer->zone_count[slot];
+    if (zone < d3d11_gpu_timer_zone_max) {
+        timer->zone_names[slot][zone] = name;
+        ID3D11DeviceContext_End(state->base_device_context, (ID3D11Asynchronous *)timer->timestamps[slot][zone + 1]);
+        ++timer->zone_count[slot];
+    }
+}
+
+function void
+d3d11_gpu_timer_end(D3D11_State *state, D3D11_GPU_Timer *timer) {
+    u32 slot = (u32)(timer->frame_index % d3d11_gpu_timer_frames);
+    ID3D11DeviceContext_End(state->base_device_context, (ID3D11Asynchronous *)timer->disjoint[slot]);
+    ++timer->frame_index;
+}
+
+typedef struct {
+    ID3D11Buffer *buffer;
+    ID3D11ShaderResourceView *srv;
+    u64 capacity;
+    u32 stride;
+    // dynamic buffers are rewritten whole with Map(WRITE_DISCARD), the others take partial
+    // UpdateSubresource uploads
+    b32 dynamic;
+} D3D11_Structured_Buffer;
+
+// Recreates the structured buffer and its SRV when count no longer fits, doubling so that
+// a growing scene reallocates O(log n) times. True when the buffer was recreated, i.e. its
+// old contents are gone and need uploading again.
+function b32
+d3d11_reserve_structured_buffer(D3D11_State *state, D3D11_Structured_Buffer *structured_buffer, u64 count) {
+    if (count <= structured_buffer->capacity) {
+        return(False);
+    }
+    
+    u64 new_capacity = structured_buffer->capacity ? structured_buffer->capacity * 2 : r3d_initial_capacity;
+    while (new_capacity < count) {
+        new_capacity *= 2;
+    }
+    
+    if (structured_buffer->srv) {
+        ID3D11ShaderResourceView_Release(structured_buffer->srv);
+        structured_buffer->srv = null;
+    }
+    
+    if (structured_buffer->buffer) {
+        ID3D11Buffer_Release(structured_buffer->buffer);
+        structured_buffer->buffer = null;
+    }
+    
+    D3D11_BUFFER_DESC structured_desc = { 0 };
+    structured_desc.ByteWidth = (UINT)(new_capacity * structured_buffer->stride);
+    structured_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    structured_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    structured_desc.StructureByteStride = structured_buffer->stride;
+    if (structured_buffer->dynamic) {
+        structured_desc.Usage = D3D11_USAGE_DYNAMIC;
+        structured_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    } else {
+        structured_desc.Usage = D3D11_USAGE_DEFAULT;
+    }
+    
+    HRESULT h_result = ID3D11Device1_CreateBuffer(state->main_device, &structured_desc,
+                                                  null, &structured_buffer->buffer);
+    
+    if (h_result != S_OK) {
+        os_message_box(str8("Error"), str8("Failed to create Structured Buffer"));
+        ExitProcess(1);
+    }
+    
+    D3D11_SHADER_RESOURCE_VIEW_DESC structured_srv_desc = { 0 };
+    structured_srv_desc.Format = DXGI_FORMAT_UNKNOWN;
+    structured_srv_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    structured_srv_desc.Buffer.NumElements = (UINT)new_capacity;
+    h_result = ID3D11Device1_CreateShaderResourceView(state->main_device,
+                                                      (ID3D11Resource *)structured_buffer->buffer,
+                                                      &structured_srv_desc,
+                                                      &structured_buffer->srv);
+    if (h_result != S_OK) {
+        os_message_box(str8("Error"), str8("Failed to create Structured Buffer SRV"));
+        ExitProcess(1);
+    }
+    
+    structured_buffer->capacity = new_capacity;
+    return(True);
+}
+
+// Replaces a dynamic structured buffer's contents with count elements of data.
+function void
+d3d11_upload_structured_buffer(D3D11_State *state, D3D11_Structured_Buffer *structured_buffer, void *data, u64 count) {
+    // an empty list still needs a buffer to bind
+    d3d11_reserve_structured_buffer(state, structured_buffer, count ? count : 1);
+    
+    D3D11_MAPPED_SUBRESOURCE mapped_subresource;
+    switch (ID3D11DeviceContext_Map(state->base_device_context,
+                                    (ID3D11Resource *)structured_buffer->buffer, 0, D3D11_MAP_WRITE_DISCARD,
+                                    0, &mapped_subresource)) {
+        case S_OK: {
+            memory_copy(mapped_subresource.pData, data, count * structured_buffer->stride);
+            ID3D11DeviceContext_Unmap(state->base_device_context, (ID3D11Resource *)structured_buffer->buffer, 0);
+        } break;
+    }
+}
+
+// A context and what's bound on it. The binds below go through cache and reach the context only
+// when they change something. Anything else that changes the context's state has to tell the
+// cache, see s_state_cache.h, and that includes the runtime unbinding a resource on its own when
+// it's bound as an output while still bound as an input, so inputs are unbound before that.
+// Values are kept as u64s rather than structs, so no padding gets compared.
+typedef struct {
+    ID3D11DeviceContext *context;
+    State_Cache cache;
+} D3D11_Context;
+
+function void
+d3d11_set_input_layout(D3D11_Context *context, ID3D11InputLayout *input_layout) {
+    if (state_cache_bind(&context->cache, StateSlot_InputLayout, &input_layout, sizeof(input_layout))) {
+        ID3D11DeviceContext_IASetInputLayout(context->context, input_layout);
+    }
+}
+
+function void
+d3d11_set_topology(D3D11_Context *context, D3D11_PRIMITIVE_TOPOLOGY topology) {
+    if (state_cache_bind(&context->cache, StateSlot_Topology, &topology, sizeof(topology))) {
+        ID3D11DeviceContext_IASetPrimitiveTopology(context->context, topology);
+    }
+}
+
+function void
+d3d11_set_vertex_buffer(D3D11_Context *context, ID3D11Buffer *buffer, UINT stride, UINT offset) {
+    u64 value[3] = { (u64)buffer, stride, offset };
+    if (state_cache_bind(&context->cache, StateSlot_VertexBuffer, &value, sizeof(value))) {
+        ID3D11DeviceContext_IASetVertexBuffers(context->context, 0, 1, &buffer, &stride, &offset);
+    }
+}
+
+function void
+d3d11_set_index_buffer(D3D11_Context *context, ID3D11Buffer *buffer, DXGI_FORMAT format, UINT offset) {
+    u64 value[3] = { (u64)buffer, format, offset };
+    if (state_cache_bind(&context->cache, StateSlot_IndexBuffer, &value, sizeof(value))) {
+        ID3D11DeviceContext_IASetIndexBuffer(context->context, buffer, format, offset);
+    }
+}
+
+function void
+d3d11_set_vertex_shader(D3D11_Context *context, ID3D11VertexShader *shader) {
+    if (state_cache_bind(&context->cache, StateSlot_VertexShader, &shader, sizeof(shader))) {
+        ID3D11DeviceContext_VSSetShader(context->context, shader, null, 0);
+    }
+}
+
+function void
+d3d11_set_pixel_shader(D3D11_Context *context, ID3D11PixelShader *shader) {
+    if (state_cache_bind(&context->cache, StateSlot_PixelShader, &shader, sizeof(shader))) {
+        ID3D11DeviceContext_PSSetShader(context->context, shader, null, 0);
+    }
+}
+
+function void
+d3d11_set_compute_shader(D3D11_Context *context, ID3D11ComputeShader *shader) {
+    if (state_cache_bind(&context->cache, StateSlot_ComputeShader, &shader, sizeof(shader))) {
+        ID3D11DeviceContext_CSSetShader(context->context, shader, null, 0);
+    }
+}
+
+function void
+d3d11_set_rasterizer(D3D11_Context *context, ID3D11RasterizerState *raster) {
+    if (state_cache_bind(&context->cache, StateSlot_Rasterizer, &raster, sizeof(raster))) {
+        ID3D11DeviceContext_RSSetState(context->context, raster);
+    }
+}
+
+function void
+d3d11_set_depth_stencil(D3D11_Context *context, ID3D11DepthStencilState *depth_state, UINT stencil_ref) {
+    u64 value[2] = { (u64)depth_state, stencil_ref };
+    if (state_cache_bind(&context->cache, StateSlot_DepthStencil, &value, sizeof(value))) {
+        ID3D11DeviceContext_OMSetDepthStencilState(context->context, depth_state, stencil_ref);
+    }
+}
+
+// No blend factor, every blend state here leaves it unused.
+function void
+d3d11_set_blend(D3D11_Context *context, ID3D11BlendState *blend, UINT sample_mask) {
+    u64 value[2] = { (u64)blend, sample_mask };
+    if (state_cache_bind(&context->cache, StateSlot_Blend, &value, sizeof(value))) {
+        ID3D11DeviceContext_OMSetBlendState(context->context, blend, null, sample_mask);
+    }
+}
+
+function void
+d3d11_set_viewport(D3D11_Context *context, D3D11_VIEWPORT *viewport) {
+    if (state_cache_bind(&context->cache, StateSlot_Viewport, viewport, sizeof(*viewport))) {
+        ID3D11DeviceContext_RSSetViewports(context->context, 1, viewport);
+    }
+}
+
+// rtv null unbinds every target.
+function void
+d3d11_set_render_target(D3D11_Context *context, ID3D11RenderTargetView *rtv, ID3D11DepthStencilView *dsv) {
+    u64 value[2] = { (u64)rtv, (u64)dsv };
+    if (state_cache_bind(&context->cache, StateSlot_RenderTargets, &value, sizeof(value))) {
+        ID3D11DeviceContext_OMSetRenderTargets(context->context, rtv ? 1 : 0, rtv ? &rtv : null, dsv);
+    }
+}
+
+// For the wrappers of the calls that set a range of registers: [first, first + count) of a run of
+// slot_count cache slots from first_slot. A range past the run always goes through, and whatever
+// part of it the run covers is forgotten.
+function b32
+d3d11_bind_objects(D3D11_Context *context, u32 first_slot, u32 slot_count, UINT first, UINT count, void **objects) {
+    b32 result = True;
+    if (first + count <= slot_count) {
+        result = state_cache_bind_objects(&context->cache, first_slot + first, count, objects);
+    } else if (first < slot_count) {
+        state_cache_forget(&context->cache, first_slot + first, slot_count - first);
+    }
+    return(result);
+}
+
+function void
+d3d11_set_vs_constant_buffers(D3D11_Context *context, UINT first, UINT count, ID3D11Buffer **buffers) {
+    if (d3d11_bind_objects(context, StateSlot_VSConstantBuffer, state_cache_constant_buffer_count, first, count,
+                           (void **)buffers)) {
+        ID3D11DeviceContext_VSSetConstantBuffers(context->context, first, count, buffers);
+    }
+}
+
+function void
+d3d11_set_ps_constant_buffers(D3D11_Context *context, UINT first, UINT count, ID3D11Buffer **buffers) {
+    if (d3d11_bind_objects(context, StateSlot_PSConstantBuffer, state_cache_constant_buffer_count, first, count,
+                           (void **)buffers)) {
+        ID3D11DeviceContext_PSSetConstantBuffers(context->context, first, count, buffers);
+    }
+}
+
+function void
+d3d11_set_cs_constant_buffers(D3D11_Context *context, UINT first, UINT count, ID3D11Buffer **buffers) {
+    if (d3d11_bind_objects(context, StateSlot_CSConstantBuffer, state_cache_constant_buffer_count, first, count,
+                           (void **)buffers)) {
+        ID3D11DeviceContext_CSSetConstantBuffers(context->context, first, count, buffers);
+    }
+}
+
+function void
+d3d11_set_vs_resources(D3D11_Context *context, UINT first, UINT count, ID3D11ShaderResourceView **srvs) {
+    if (d3d11_bind_objects(context, StateSlot_VSResource, state_cache_resource_count, first, count, (void **)srvs)) {
+        ID3D11DeviceContext_VSSetShaderResources(context->context, first, count, srvs);
+    }
+}
+
+function void
+d3d11_set_ps_resources(D3D11_Context *context, UINT first, UINT count, ID3D11ShaderResourceView **srvs) {
+    if (d3d11_bind_objects(context, StateSlot_PSResource, state_cache_resource_count, first, count, (void **)srvs)) {
+        ID3D11DeviceContext_PSSetShaderResources(context->context, first, count, srvs);
+    }
+}
+
+function void
+d3d11_set_cs_resources(D3D11_Context *context, UINT first, UINT count, ID3D11ShaderResourceView **srvs) {
+    if (d3d11_bind_objects(context, StateSlot_CSResource, state_cache_resource_count, first, count, (void **)srvs)) {
+        ID3D11DeviceContext_CSSetShaderResources(context->context, first, count, srvs);
+    }
+}
+
+function void
+d3d11_set_ps_samplers(D3D11_Context *context, UINT first, UINT count, ID3D11SamplerState **samplers) {
+    if (d3d11_bind_objects(context, StateSlot_PSSampler, state_cache_sampler_count, first, count, (void **)samplers)) {
+        ID3D11DeviceContext_PSSetSamplers(context->context, first, count, samplers);
+    }
+}
+
+function void
+d3d11_set_cs_samplers(D3D11_Context *context, UINT first, UINT count, ID3D11SamplerState **samplers) {
+    if (d3d11_bind_objects(context, StateSlot_CSSampler, state_cache_sampler_count, first, count, (void **)samplers)) {
+        ID3D11DeviceContext_CSSetSamplers(context->context, first, count, samplers);
+    }
+}
+
+// No initial counts, none of the UAVs here are append or counter buffers.
+function void
+d3d11_set_cs_unordered_access(D3D11_Context *context, UINT first, UINT count, ID3D11UnorderedAccessView **uavs) {
+    if (d3d11_bind_objects(context, StateSlot_CSUnorderedAccess, state_cache_unordered_access_count, first, count,
+                           (void **)uavs)) {
+        ID3D11DeviceContext_CSSetUnorderedAccessViews(context->context, first, count, uavs, null);
+    }
+}
+
+// Everything the scene pass binds before its draws, gathered once a frame so that any context can
+// set it up, the immediate one or a deferred one recording a slice of the commands.
+typedef struct {
+    ID3D11RenderTargetView *rtv;
+    ID3D11DepthStencilView *dsv;
+    ID3D11DepthStencilState *depth_state;
+    ID3D11RasterizerState *raster;
+    D3D11_VIEWPORT viewport;
+    ID3D11Buffer *vertex_buffer;
+    UINT stride;
+    ID3D11Buffer *index_buffer;
+    ID3D11InputLayout *input_layout;
+    ID3D11VertexShader *vertex_shader;
+    ID3D11ShaderResourceView *instance_srv;
+    ID3D11ShaderResourceView *visible_srv;
+    ID3D11Buffer *constant_buffer;
+    ID3D11Buffer *light_constant_buffer;
+    ID3D11Buffer *draw_constant_buffer;
+    ID3D11ShaderResourceView *light_srvs[3];
+    // indexed by Render_Command.shader
+    ID3D11PixelShader *pixel_shaders[GameShader_Count];
+} D3D11_Scene_Pass;
+
+// A Render_Backend onto one context. A deferred one leaves its slice in command_list, for the
+// caller to execute on the immediate context and release.
+typedef struct {
+    D3D11_Context *context;
+    b32 deferred;
+    D3D11_Scene_Pass *pass;
+    ID3D11CommandList *command_list;
+} D3D11_Render_Backend;
+
+// Below this many commands one thread on the immediate context beats paying for command lists.
+#define d3d11_deferred_min_commands 256
+
+function void
+d3d11_render_begin(void *data) {
+    D3D11_Render_Backend *backend = (D3D11_Render_Backend *)data;
+    D3D11_Context *context = backend->context;
+    D3D11_Scene_Pass *pass = backend->pass;
+    if (backend->deferred) {
+        // a deferred context starts every command list from the default state
+        state_cache_invalidate(&context->cache);
+    }
+    
+    d3d11_set_render_target(context, pass->rtv, pass->dsv);
+    d3d11_set_depth_stencil(context, pass->depth_state, 0);
+    d3d11_set_blend(context, null, 0xffffffff);
+    d3d11_set_viewport(context, &pass->viewport);
+    d3d11_set_rasterizer(context, pass->raster);
+    
+    d3d11_set_topology(context, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    d3d11_set_vertex_buffer(context, pass->vertex_buffer, pass->stride, 0);
+    d3d11_set_index_buffer(context, pass->index_buffer, DXGI_FORMAT_R32_UINT, 0);
+    d3d11_set_input_layout(context, pass->input_layout);
+    
+    d3d11_set_vertex_shader(context, pass->vertex_shader);
+    d3d11_set_vs_resources(context, 0, 1, &pass->instance_srv);
+    d3d11_set_vs_resources(context, 2, 1, &pass->visible_srv);
+    d3d11_set_vs_constant_buffers(context, 0, 1, &pass->constant_buffer);
+    d3d11_set_vs_constant_buffers(context, 3, 1, &pass->draw_constant_buffer);
+    
+    // ps_gooch_main reads camera_p
+    d3d11_set_ps_constant_buffers(context, 0, 1, &pass->constant_buffer);
+    d3d11_set_ps_constant_buffers(context, 1, 1, &pass->light_constant_buffer);
+    d3d11_set_ps_resources(context, 3, array_count(pass->light_srvs), pass->light_srvs);
+}
+
+function void
+d3d11_render_set_shader(void *data, u32 shader) {
+    D3D11_Render_Backend *backend = (D3D11_Render_Backend *)data;
+    d3d11_set_pixel_shader(backend->context, backend->pass->pixel_shaders[shader]);
+}
+
+function void
+d3d11_render_set_instance_base(void *data, u32 instance_base) {
+    D3D11_Render_Backend *backend = (D3D11_Render_Backend *)data;
+    ID3D11DeviceContext *context = backend->context->context;
+    // a deferred context's first map of a dynamic buffer has to discard, so every one does
+    D3D11_MAPPED_SUBRESOURCE mapped_subresource;
+    switch (ID3D11DeviceContext_Map(context, (ID3D11Resource *)backend->pass->draw_constant_buffer, 0,
+                                    D3D11_MAP_WRITE_DISCARD, 0, &mapped_subresource)) {
+        case S_OK: {
+            D3D11_Draw_Constants *draw_constants = (D3D11_Draw_Constants *)mapped_subresource.pData;
+            draw_constants->instance_base = instance_base;
+            ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)backend->pass->draw_constant_buffer, 0);
+        } break;
+    }
+}
+
+function void
+d3d11_render_draw(void *data, u32 index_count, u32 instance_count, u32 first_index, s32 base_vertex) {
+    D3D11_Render_Backend *backend = (D3D11_Render_Backend *)data;
+    ID3D11DeviceContext_DrawIndexedInstanced(backend->context->context, index_count, instance_count, first_index,
+                                             base_vertex, 0);
+}
 
 function void
-r3d_init(R3D_Buffer *buffer, u64 capacity) {
-    buffer->count = 0;
-    buffer->capacity = capacity;
-    buffer->instances = HeapAlloc(GetProcessHeap(),
-                                  HEAP_GENERATE_EXCEPTIONS |
-                                  HEAP_ZERO_MEMORY,
-                                  capacity * sizeof(Model_Instance));
+d3d11_render_end(void *data) {
+    D3D11_Render_Backend *backend = (D3D11_Render_Backend *)data;
+    d3d11_set_render_target(backend->context, null, null);
+    if (backend->deferred) {
+        backend->command_list = null;
+        if (ID3D11DeviceContext_FinishCommandList(backend->context->context, FALSE,
+                                                  &backend->command_list) != S_OK) {
+            os_fatal_error(str8("Failed to finish a command list"));
+        }
+    }
 }
 
-function Model_Instance *
-r3d_acquire(R3D_Buffer *buffer) {
-    s_assert(buffer->count < buffer->capacity, "Must be less than capacity");
-    
-    Model_Instance *result = buffer->instances + buffer->count++;
+function Render_Backend
+d3d11_render_backend(D3D11_Render_Backend *d3d11_backend) {
+    Render_Backend result;
+    result.data = d3d11_backend;
+    result.begin = d3d11_render_begin;
+    result.set_shader = d3d11_render_set_shader;
+    result.set_instance_base = d3d11_render_set_instance_base;
+    result.draw = d3d11_render_draw;
+    result.end = d3d11_render_end;
     return(result);
 }
 
-function Model_Instance *
-r3d_add_instance(R3D_Buffer *buffer, v3f p, quat orient, v3f scale, v4f colour) {
-    Model_Instance *model = r3d_acquire(buffer);
-    model->position = p;
-    model->orient = orient;
-    model->scale = scale;
-    model->colour = colour;
-    return(model);
+// Debug builds keep the shaders debuggable, everything else gets the optimizer.
+#if defined(S_DEBUG)
+#define d3d11_shader_flags (D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION | \
+                            D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR | D3DCOMPILE_ENABLE_STRICTNESS | \
+                            D3DCOMPILE_WARNINGS_ARE_ERRORS)
+#else
+#define d3d11_shader_flags (D3DCOMPILE_OPTIMIZATION_LEVEL3 | \
+                            D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR | D3DCOMPILE_ENABLE_STRICTNESS | \
+                            D3DCOMPILE_WARNINGS_ARE_ERRORS)
+#endif
+
+// Bytecode for entry_point, from the cache when this exact source, defines and flags were compiled before.
+// A miss compiles and adds the result. Compile errors are fatal. The blob lives until the cache
+// is written or closed.
+function Shader_Blob
+d3d11_compile_shader(Shader_Cache *cache, String_Const_U8 source, char *entry_point, char *profile,
+                     Shader_Define *defines, u32 flags) {
+    u64 key = shader_cache_key(source, entry_point, profile, defines, flags);
+    Shader_Blob result = shader_cache_find(cache, key);
+    if (!result.size) {
+        ID3DBlob *d3d_bytecode = null;
+        ID3DBlob *d3d_error = null;
+        HRESULT h_result = D3DCompile(source.str, source.char_count, null, (D3D_SHADER_MACRO *)defines,
+                                      D3D_COMPILE_STANDARD_FILE_INCLUDE, entry_point, profile,
+                                      flags, 0, &d3d_bytecode, &d3d_error);
+        
+        if (h_result != S_OK) {
+            String_Const_U8 title = str8("Pixel Shader Compilation Error");
+            if (profile[0] == 'v') {
+                title = str8("Vertex Shader Compilation Error");
+            } else if (profile[0] == 'c') {
+                title = str8("Compute Shader Compilation Error");
+            }
+            if (d3d_error) {
+                os_message_box(title, str8_make(ID3D10Blob_GetBufferPointer(d3d_error),
+                                                ID3D10Blob_GetBufferSize(d3d_error)));
+            } else {
+                os_message_box(title, str8("D3DCompile failed"));
+            }
+            ExitProcess(1);
+        }
+        
+        if (d3d_error) {
+            ID3D10Blob_Release(d3d_error);
+        }
+        
+        result = shader_cache_add(cache, key, ID3D10Blob_GetBufferPointer(d3d_bytecode), ID3D10Blob_GetBufferSize(d3d_bytecode));
+        ID3D10Blob_Release(d3d_bytecode);
+        if (!result.size) {
+            os_fatal_error(str8("Out of shader cache memory"));
+        }
+    }
+    
+    return(result);
 }
 
 // https://en.wikipedia.org/wiki/Anti-aliasing
@@ -682,106 +1025,142 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     window_class.lpszClassName = "my_window_class";
     
 	if (RegisterClassA(&window_class)) {
+        // before the job system, so this thread is the profiler's main track
+        profile_init();
+        
 		OS_Window os_window = os_create_window(str8("RTR"), 1280, 720);
 		OS_Input os_input = { 0 };
-        os_window.is_focus = True;
 		
 		D3D11_State d3d11_state;
 		d3d11_initialize(&d3d11_state, &os_window);
         
-        R3D_Buffer r3d_buffer;
-        r3d_init(&r3d_buffer, 1024);
+        Game_State game;
+        game_init(&game);
+        // a pack written by s_mesh_tool adds its meshes; the LOD chains are built from the mapping
+        Mesh_Pack mesh_pack;
+        if (mesh_pack_open(&mesh_pack, str8("meshes.pack"))) {
+            game_add_mesh_pack(&game, &mesh_pack);
+        }
+        R3D_Scene *scene = &game.scene;
+        
+        // last visible list sent to the GPU, so an unchanged cull result isn't sent again
+        Arena uploaded_visible_arena = arena_reserve(scene->buffer.max_capacity * sizeof(u32));
+        u32 *uploaded_visible = (u32 *)uploaded_visible_arena.base;
+        u64 uploaded_visible_count = 0;
+        
+        // per-frame scratch, cleared at the top of every frame
+        Arena frame_arena = arena_reserve(gigabytes(1));
+        Cull_Stats cull_stats = { 0 };
+        
+        // cull and pack fan out over every core, this thread included
+        Job_System job_system;
+        job_system_init(&job_system, os_cpu_count());
         
-		ID3D11VertexShader *my_vertex_shader = null;
+        // draws are recorded as commands into a stream per worker, see s_render_command.h, and
+        // replayed onto the immediate context or, when there are enough, a deferred context per worker
+        Render_Queue render_queue;
+        render_queue_init(&render_queue, job_system.worker_count);
+        // every bind on the immediate context goes through its state cache, see D3D11_Context
+        D3D11_Context immediate_context;
+        immediate_context.context = d3d11_state.base_device_context;
+        state_cache_init(&immediate_context.cache);
+        D3D11_Render_Backend immediate_state = { 0 };
+        immediate_state.context = &immediate_context;
+        Render_Backend immediate_backend = d3d11_render_backend(&immediate_state);
+        
+        u32 deferred_count = job_system.worker_count > 1 ? job_system.worker_count : 0;
+        Arena deferred_arena = arena_reserve(deferred_count * (sizeof(Render_Backend) + sizeof(D3D11_Render_Backend) +
+                                                               sizeof(D3D11_Context)) + kilobytes(4));
+        Render_Backend *deferred_backends = arena_push_array(&deferred_arena, Render_Backend, deferred_count);
+        D3D11_Render_Backend *deferred_states = arena_push_array(&deferred_arena, D3D11_Render_Backend, deferred_count);
+        D3D11_Context *deferred_contexts = arena_push_array(&deferred_arena, D3D11_Context, deferred_count);
+        for (u32 worker = 0; worker < deferred_count; ++worker) {
+            if (ID3D11Device1_CreateDeferredContext(d3d11_state.main_device, 0,
+                                                    &deferred_contexts[worker].context) != S_OK) {
+                os_message_box(str8("Error"), str8("Failed to create Deferred Context"));
+                ExitProcess(1);
+            }
+            state_cache_init(&deferred_contexts[worker].cache);
+            deferred_states[worker].context = deferred_contexts + worker;
+            deferred_states[worker].deferred = True;
+            deferred_backends[worker] = d3d11_render_backend(deferred_states + worker);
+        }
+        
+		// one per vertex format, see s_vertex_format.h
+		ID3D11VertexShader *my_vertex_shaders[VertexFormat_Count] = { 0 };
 		ID3D11PixelShader *my_gooch_pixel_shader = null;
-		ID3D11PixelShader *my_test_pixel_shader = null;
+		// one per shading permutation, see s_shading_permutation.h
+		ID3D11PixelShader *my_test_pixel_shaders[shading_permutation_count] = { 0 };
         
         // https://learn.microsoft.com/en-us/windows/win32/direct3d11/vertex-shader-stage
         // "The vertex-shader stage must always be active for the pipeline to execute.
         // If no vertex modification or transformation is required, a pass-through vertex
         // shader must be created and set to the pipeline."
         ID3D11VertexShader *downsample_vertex_shader = null;
-        ID3D11PixelShader *downsample_pixel_shader = null;
+        // one per DownsampleFilter, the pixel shader and the compute version
+        ID3D11PixelShader *downsample_pixel_shaders[DownsampleFilter_Count] = { 0 };
+        ID3D11ComputeShader *downsample_compute_shaders[DownsampleFilter_Count] = { 0 };
         
-		ID3D11InputLayout *per_vertex_input_layout = null;
-		ID3D11Buffer *cube_vertex_buffer = null;
+		ID3D11InputLayout *per_vertex_input_layouts[VertexFormat_Count] = { 0 };
+		ID3D11Buffer *instance_vertex_buffers[VertexFormat_Count] = { 0 };
+        // V cycles through the formats, every one is kept on the GPU so switching is free
+        Vertex_Stream instance_vertex_streams[VertexFormat_Count];
+        u32 vertex_format = VertexFormat_Oct16;
+        Arena vertex_arena = arena_reserve((u64)game.geometry.vertex_count *
+                                           (sizeof(Mesh_Vertex) + sizeof(Vertex_Oct16) + sizeof(Vertex_Oct8)) + 256);
+		ID3D11Buffer *instance_index_buffer = null;
 		ID3D11Buffer *constant_buffer = null;
 		ID3D11Buffer *light_constant_buffer = null;
-		ID3D11Buffer *model_instance_buffer = null;
-		ID3D11ShaderResourceView *model_instance_srv = null;
+		ID3D11Buffer *downsample_constant_buffer = null;
+		ID3D11Buffer *draw_constant_buffer = null;
+		D3D11_Structured_Buffer instance_buffer = { 0 };
+		D3D11_Structured_Buffer visible_buffer = { 0 };
+        instance_buffer.stride = sizeof(R3D_Packed_Instance);
+        visible_buffer.stride = sizeof(u32);
+        visible_buffer.dynamic = True;
         
-        // Vertices <-> Normal
-		f32 cube_model_vertices[] = {
-			// FRONT			
-			-0.5f, -0.5f, -0.5f, 	0.0f, 0.0f, -1.0f,
-			-0.5f,  0.5f, -0.5f,	0.0f, 0.0f, -1.0f,
-            0.5f,  0.5f, -0.5f,	0.0f, 0.0f, -1.0f,
-            
-            0.5f,  0.5f, -0.5f,	0.0f, 0.0f, -1.0f,
-            0.5f, -0.5f, -0.5f,	0.0f, 0.0f, -1.0f,
-			-0.5f, -0.5f, -0.5f,	0.0f, 0.0f, -1.0f,
-            
-			// LEFT
-			-0.5f, -0.5f,  0.5f,	-1.0f, 0.0f, 0.0f,
-			-0.5f,  0.5f,  0.5f,	-1.0f, 0.0f, 0.0f,
-			-0.5f,  0.5f, -0.5f,	-1.0f, 0.0f, 0.0f,
-            
-			-0.5f,  0.5f, -0.5f,	-1.0f, 0.0f, 0.0f,
-			-0.5f, -0.5f, -0.5f,	-1.0f, 0.0f, 0.0f,
-			-0.5f, -0.5f,  0.5f,	-1.0f, 0.0f, 0.0f,
-            
-			// BACK
-            0.5f, -0.5f,  0.5f,		0.0f, 0.0f, 1.0f,
-            0.5f,  0.5f,  0.5f,	0.0f, 0.0f, 1.0f,
-			-0.5f,  0.5f,  0.5f,	0.0f, 0.0f, 1.0f,
-            
-			-0.5f,  0.5f,  0.5f,	0.0f, 0.0f, 1.0f,
-			-0.5f, -0.5f,  0.5f,	0.0f, 0.0f, 1.0f,
-            0.5f, -0.5f,  0.5f,	0.0f, 0.0f, 1.0f,
-            
-			// RIGHT
-            0.5f, -0.5f, -0.5f,		1.0f, 0.0f, 0.0f,
-            0.5f,  0.5f, -0.5f,		1.0f, 0.0f, 0.0f,
-            0.5f,  0.5f,  0.5f,		1.0f, 0.0f, 0.0f,
-            
-            0.5f,  0.5f,  0.5f,		1.0f, 0.0f, 0.0f,
-            0.5f, -0.5f,  0.5f,		1.0f, 0.0f, 0.0f,
-            0.5f, -0.5f, -0.5f,		1.0f, 0.0f, 0.0f,
-            
-			// Top
-			-0.5f,  0.5f, -0.5f,	0.0f, 1.0f, 0.0f,
-			-0.5f,  0.5f,  0.5f,	0.0f, 1.0f, 0.0f,
-            0.5f,  0.5f,  0.5f,		0.0f, 1.0f, 0.0f,
-            
-            0.5f,  0.5f,  0.5f,		0.0f, 1.0f, 0.0f,
-            0.5f,  0.5f, -0.5f,		0.0f, 1.0f, 0.0f,
-			-0.5f,  0.5f, -0.5f,	0.0f, 1.0f, 0.0f,
-            
-			// Bottom
-			-0.5f, -0.5f,  0.5f,	0.0f, -1.0f, 0.0f,
-			-0.5f, -0.5f, -0.5f,	0.0f, -1.0f, 0.0f,
-            0.5f, -0.5f, -0.5f,		0.0f, -1.0f, 0.0f,
-            
-            0.5f, -0.5f, -0.5f,		0.0f, -1.0f, 0.0f,
-            0.5f, -0.5f,  0.5f,		0.0f, -1.0f, 0.0f,
-			-0.5f, -0.5f,  0.5f,	0.0f, -1.0f, 0.0f,
-		};
+        // clustered lights, rebuilt and sent whole every frame
+        D3D11_Structured_Buffer light_buffer = { 0 };
+        D3D11_Structured_Buffer light_cluster_buffer = { 0 };
+        D3D11_Structured_Buffer light_index_buffer = { 0 };
+        light_buffer.stride = sizeof(Light_Packed);
+        light_cluster_buffer.stride = sizeof(Light_Cluster);
+        light_index_buffer.stride = sizeof(u32);
+        light_buffer.dynamic = True;
+        light_cluster_buffer.dynamic = True;
+        light_index_buffer.dynamic = True;
         
 		{
-			D3D11_BUFFER_DESC cube_mesh_desc = { 0 };
-			cube_mesh_desc.ByteWidth = sizeof(cube_model_vertices);
-            cube_mesh_desc.Usage = D3D11_USAGE_IMMUTABLE;
-            cube_mesh_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-            cube_mesh_desc.CPUAccessFlags = 0;
-            cube_mesh_desc.MiscFlags = 0;
-            cube_mesh_desc.StructureByteStride = 0;
+			D3D11_BUFFER_DESC instance_mesh_desc = { 0 };
+            instance_mesh_desc.Usage = D3D11_USAGE_IMMUTABLE;
+            instance_mesh_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+            instance_mesh_desc.CPUAccessFlags = 0;
+            instance_mesh_desc.MiscFlags = 0;
+            instance_mesh_desc.StructureByteStride = 0;
 			
-			D3D11_SUBRESOURCE_DATA cube_mesh_data = { 0 };
-			cube_mesh_data.pSysMem = cube_model_vertices;
-			cube_mesh_data.SysMemPitch = sizeof(f32) * 6;
+			D3D11_SUBRESOURCE_DATA instance_mesh_data = { 0 };
+			HRESULT h_result = S_OK;
+            for (u32 format = 0; format < VertexFormat_Count; ++format) {
+                Vertex_Stream *stream = instance_vertex_streams + format;
+                // every level of every mesh, the batches pick their ranges
+                *stream = vertex_encode(&vertex_arena, &game.geometry, format);
+                instance_mesh_desc.ByteWidth = stream->vertex_count * stream->stride;
+                instance_mesh_data.pSysMem = stream->vertices;
+                instance_mesh_data.SysMemPitch = stream->stride;
+                h_result =  ID3D11Device1_CreateBuffer(d3d11_state.main_device, &instance_mesh_desc,
+                                                       &instance_mesh_data, &instance_vertex_buffers[format]);
+                
+                if (h_result != S_OK) {
+                    ExitProcess(0);
+                }
+            }
             
-			HRESULT h_result =  ID3D11Device1_CreateBuffer(d3d11_state.main_device, &cube_mesh_desc,
-														   &cube_mesh_data, &cube_vertex_buffer);
+			instance_mesh_desc.ByteWidth = game.geometry.index_count * sizeof(u32);
+			instance_mesh_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+			instance_mesh_data.pSysMem = game.geometry.indices;
+			instance_mesh_data.SysMemPitch = 0;
+			h_result =  ID3D11Device1_CreateBuffer(d3d11_state.main_device, &instance_mesh_desc,
+												   &instance_mesh_data, &instance_index_buffer);
 			
 			if (h_result != S_OK) {
 				ExitProcess(0);
@@ -800,50 +1179,84 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
                 "#define LightType_Directional 0\n"
                 "#define LightType_Point 1\n"
                 "#define LightType_Spotlight 2\n"
-                "#define Total_Lights 8\n"
+                "#define Cluster_Grid_X " stringify(light_cluster_grid_x) "\n"
+                "#define Cluster_Grid_Y " stringify(light_cluster_grid_y) "\n"
+                "#define Cluster_Grid_Z " stringify(light_cluster_grid_z) "\n"
+                "// see s_shading_permutation.h; without them every light type is handled\n"
+                "#if !defined(NUM_DIRECTIONAL)\n"
+                "#define NUM_DIRECTIONAL -1\n"
+                "#define HAS_POINT 1\n"
+                "#define HAS_SPOT 1\n"
+                "#endif\n"
+                "// Light_Packed, see light_pack\n"
                 "struct Light {\n"
-                "   float3 p : Position;\n" // 12
-                "   uint type : Light_Type;\n" // 4
-                "   // ------ 16 ------ \n"
-                "   float reference_distance : Reference_Distance;\n" // 4
-                "   float max_distance : Max_Distance;\n" // 4 
-                "   float min_distance : Min_Distance;\n" // 4
-                "   float __unused_a;\n" // 4
-                "   // ------ 16 ------ \n"
-                "   float3 direction : Direction;\n" // 12
-                "   uint enabled;\n" // 4
-                "   // ------ 16 ------ \n"
-                "   float inner_angle : InnerAngle;\n"
-                "   float max_angle : MaxAngle;\n"
-                "   float2 __unused_c;\n"
-                "   // ------ 16 ------ \n"
-                "   float4 colour : Colour;\n" // 16
+                "   float3 p;\n"
+                "   uint type;\n"
+                "   float3 direction;\n"
+                "   float inv_max_distance4;\n"
+                "   float3 colour;\n"
+                "   float reference_distance_sq;\n"
+                "   float inv_min_distance_sq;\n"
+                "   float spot_scale;\n"
+                "   float spot_offset;\n"
+                "   float __unused_a;\n"
                 "};\n"
                 "\n"
 				"cbuffer Constants : register(b0) {\n"
-				"	float4x4 perspective;\n"
-				"	float4x4 world_to_camera;\n"
+				"	float4x4 view_projection;\n"
                 "   float3 camera_p;\n"
                 "   float __unused_a;\n"
+                "   // padding names are global across cbuffers, _b and _c are taken\n"
+                "   float3 position_scale;\n"
+                "   float __unused_d;\n"
+                "   float3 position_offset;\n"
+                "   float __unused_e;\n"
 				"};\n"
                 "\n"
+                "// Light_Constants, see light_clusters_constants\n"
                 "cbuffer Light_Constants : register(b1) {\n"
-                "   Light lights[Total_Lights];\n"
                 "   float3 lcamera_p;\n"
+                "   uint directional_count;\n"
+                "   float3 camera_forward;\n"
+                "   float cluster_z_scale;\n"
+                "   float cluster_z_bias;\n"
+                "   float cluster_x_scale;\n"
+                "   float cluster_y_scale;\n"
                 "   float __unused_b;\n"
                 "};\n"
                 "\n"
+                "// D3D11_Draw_Constants, one batch's run of visible_instances\n"
+                "cbuffer Draw_Constants : register(b3) {\n"
+                "   uint instance_base;\n"
+                "   uint3 __unused_f;\n"
+                "};\n"
+                "\n"
+                "// VERTEX_FORMAT is the VertexFormat_ enum, see s_vertex_format.h\n"
+                "#if VERTEX_FORMAT == 0\n"
 				"struct Per_Vertex {\n"
 				"	float3 vertex : Vertex;\n"
 				"	// this normal is allowed to not be unit. The vertex shader will normalize this.\n"
 				"	float3 normal : Normal;\n"
 				"};\n"
+                "#elif VERTEX_FORMAT == 1\n"
+                "// Vertex_Oct16: R16G16B16A16_SNORM and R16G16_SNORM\n"
+				"struct Per_Vertex {\n"
+				"	float4 vertex : Vertex;\n"
+				"	float2 normal : Normal;\n"
+				"};\n"
+                "#else\n"
+                "// Vertex_Oct8: R16G16B16A16_SINT, the octahedral normal's two bytes in w\n"
+				"struct Per_Vertex {\n"
+				"	int4 vertex : Vertex;\n"
+				"};\n"
+                "#endif\n"
 				"\n"
+				"// R3D_Packed_Instance\n"
 				"struct Model_Per_Instance {\n"
 				"	float3 w_p : World_Position;\n"
-				"	float4 orient : Quat_Orient;\n"
+				"	uint orient : Quat_Orient;\n"
 				"	float3 scale : Scale;\n"
-				"	float4 colour : Colour;\n"
+				"	uint colour : Colour;\n"
 				"};\n"
 				"\n"
 				"struct VS_Out {\n"
@@ -854,7 +1267,13 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 				"};\n"
 				"\n"
 				"StructuredBuffer<Model_Per_Instance> model_instances : register(t0);\n"
+				"StructuredBuffer<uint> visible_instances : register(t2);\n"
                 "Texture2D<float4> high_res_texture : register(t1);\n"
+                "StructuredBuffer<Light> lights : register(t3);\n"
+                "// Light_Cluster: offset and count into light_indices\n"
+                "StructuredBuffer<uint2> light_clusters : register(t4);\n"
+                "// directional lights first, then every cluster's list\n"
+                "StructuredBuffer<uint> light_indices : register(t5);\n"
                 "SamplerState high_res_sampler : register(s0);\n"
 				"\n"
 				"float4 quat_mul(float4 a, float4 b) {\n"
@@ -871,22 +1290,62 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 				"	return(result);\n"
 				"}\n"
 				"\n"
+				"// smallest-three, see r3d_unpack_quat\n"
+				"float4 unpack_quat(uint packed) {\n"
+				"	uint largest = packed >> 30;\n"
+				"	float3 small = (float3(uint3(packed >> 20, packed >> 10, packed) & 1023) * (2.0f / 1023.0f) - 1.0f) * 0.70710678f;\n"
+				"	float dropped = sqrt(saturate(1.0f - dot(small, small)));\n"
+				"	if (largest == 0) return float4(dropped, small);\n"
+				"	if (largest == 1) return float4(small.x, dropped, small.yz);\n"
+				"	if (largest == 2) return float4(small.xy, dropped, small.z);\n"
+				"	return float4(small, dropped);\n"
+				"}\n"
+				"\n"
+				"float4 unpack_colour(uint packed) {\n"
+				"	return float4(uint4(packed, packed >> 8, packed >> 16, packed >> 24) & 255) * (1.0f / 255.0f);\n"
+				"}\n"
+				"\n"
 				"// assumes unit quaternion!\n"
 				"float3 quat_rot_v3f(float4 orient, float3 v) {\n"
 				"	return quat_mul(quat_mul(orient, float4(1.0f, v)), quat_conj(orient)).yzw;\n"
 				"}\n"
 				"\n"
+                "// vertex_oct_decode, not normalized\n"
+                "float3 oct_decode(float2 e) {\n"
+                "   float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));\n"
+                "   float t = saturate(-n.z);\n"
+                "   n.xy += (n.xy >= 0.0f) ? -t : t;\n"
+                "   return(n);\n"
+                "}\n"
+                "\n"
+                "void decode_vertex(Per_Vertex vertex, out float3 p, out float3 normal) {\n"
+                "#if VERTEX_FORMAT == 0\n"
+                "   p = vertex.vertex;\n"
+                "   normal = vertex.normal;\n"
+                "#elif VERTEX_FORMAT == 1\n"
+                "   p = vertex.vertex.xyz * position_scale + position_offset;\n"
+                "   normal = oct_decode(vertex.normal);\n"
+                "#else\n"
+                "   // by hand what SNORM would do, -32768 and -128 are -1 too\n"
+                "   p = max(float3(vertex.vertex.xyz) * (1.0f / 32767.0f), -1.0f) * position_scale + position_offset;\n"
+                "   int2 e = int2(vertex.vertex.w >> 8, (vertex.vertex.w << 24) >> 24);\n"
+                "   normal = oct_decode(max(float2(e) * (1.0f / 127.0f), -1.0f));\n"
+                "#endif\n"
+                "}\n"
+                "\n"
 				"VS_Out vs_main(Per_Vertex vertex, uint iid : SV_InstanceID) {\n"
 				"	VS_Out output = (VS_Out)0;\n"
-				"	Model_Per_Instance instance = model_instances[iid];\n"
-				"	float3 vert = quat_rot_v3f(instance.orient, vertex.vertex) * instance.scale;\n"
+				"	Model_Per_Instance instance = model_instances[visible_instances[instance_base + iid]];\n"
+				"	float4 orient = unpack_quat(instance.orient);\n"
+                "   float3 local_p, local_normal;\n"
+                "   decode_vertex(vertex, local_p, local_normal);\n"
+				"	float3 vert = quat_rot_v3f(orient, local_p) * instance.scale;\n"
 				"	vert += instance.w_p;\n"
                 "   output.pos_world = vert;\n"
-				"	vert = mul(world_to_camera, float4(vert, 1.0f)).xyz;\n"
-				"	output.pos = mul(perspective, float4(vert, 1.0f));\n"
-				"	output.colour = instance.colour;\n"
+				"	output.pos = mul(view_projection, float4(vert, 1.0f));\n"
+				"	output.colour = unpack_colour(instance.colour);\n"
                 "\n"
-                "   float3 normal = quat_rot_v3f(instance.orient, vertex.normal) * instance.scale;\n"
+                "   float3 normal = quat_rot_v3f(orient, local_normal) * instance.scale;\n"
                 "   output.normal = normalize(normal);\n"
 				"	return(output);\n"
 				"}\n"
@@ -907,16 +1366,30 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 				"	return float4(pow(shaded, 2.2f), vs.colour.w);\n"
 				"}\n"
                 "\n"
-                "float windowing(float r, float rmax) {\n"
-                "   float result = pow(max(1.0f - pow(r / rmax, 4.0f), 0.0f), 2.0f);\n"
-                "   return(result);\n"
+                "float3 shade_directional(Light light, VS_Out vs, float3 lit_colour) {\n"
+                "   float cosine = max(dot(-light.direction, vs.normal), 0.0f);\n"
+                "   return(cosine * light.colour * lit_colour);\n"
                 "}\n"
                 "\n"
-                "float spotlight(float3 light_dir, float3 spot_dir, float inner_circle_angle, float max_angle) {\n"
-                "   float c = dot(spot_dir, light_dir);\n"
-                "   float result = clamp((c - cos(max_angle)) / (cos(inner_circle_angle) - cos(max_angle)), 0.0f, 1.0f);\n"
-                "   //return(result * result);\n"
-                "   return result * result * (3.0f - 2.0f * result);\n"
+                "// point and spot share everything but the cone\n"
+                "float3 shade_local(Light light, VS_Out vs, float3 lit_colour, bool spot) {\n"
+                "   float3 to_light = light.p - vs.pos_world;\n"
+                "   float distance_sq = dot(to_light, to_light);\n"
+                "   float inv_distance = rsqrt(distance_sq);\n"
+                "   to_light *= inv_distance;\n"
+                "\n"
+                "   // unreal engine's attenuation\n"
+                "   //float attenuation = ((r0 * r0) / (1.0f + distance_to_light * distance_to_light));\n"
+                "   // CryEngine's attenuation, (r0 / max(d, dmin))^2, times the windowing (1 - (d / dmax)^4)^2\n"
+                "   float wnd = saturate(1.0f - distance_sq * distance_sq * light.inv_max_distance4);\n"
+                "   float attenuation = light.reference_distance_sq * min(inv_distance * inv_distance, light.inv_min_distance_sq) * wnd * wnd;\n"
+                "   float cosine = max(dot(to_light, vs.normal), 0.0f);\n"
+                "   float3 result = cosine * light.colour * lit_colour * attenuation;\n"
+                "   if (spot) {\n"
+                "       float t = saturate(dot(light.direction, -to_light) * light.spot_scale + light.spot_offset);\n"
+                "       result *= t * t * (3.0f - 2.0f * t);\n"
+                "   }\n"
+                "   return(result);\n"
                 "}\n"
                 "\n"
                 "float4 ps_test_shading_model(VS_Out vs) : SV_Target {\n"
@@ -924,34 +1397,31 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
                 "   float3 lit_colour = vs.colour.xyz;\n"
                 "\n"
                 "   float3 shaded = (float3)0;\n"
-                "   for (uint light_idx = 0; light_idx < Total_Lights; ++light_idx) {\n"
-                "       Light light = lights[light_idx];\n"
-                "       if (!light.enabled) continue;\n"
-                "       float3 light_colour = light.colour.xyz;\n"
-                "\n"
-                "       if (light.type == LightType_Directional) {\n"
-                "           float cosine = max(dot(-light.direction, vs.normal), 0.0f);\n"
-                "           shaded += cosine * light_colour * lit_colour;\n"
-                "       } else {\n"
-                "           float3 to_light = light.p - vs.pos_world;\n"
-                "           float distance_to_light = length(to_light);\n"
-                "           to_light /= distance_to_light;\n"
+                "#if NUM_DIRECTIONAL >= 0\n"
+                "   [unroll] for (uint index = 0; index < NUM_DIRECTIONAL; ++index) {\n"
+                "#else\n"
+                "   for (uint index = 0; index < directional_count; ++index) {\n"
+                "#endif\n"
+                "       shaded = saturate(shaded + shade_directional(lights[light_indices[index]], vs, lit_colour));\n"
+                "   }\n"
                 "\n"
-                "           // unreal engine's attenuation\n"
-                "           //float attenuation = ((r0 * r0) / (1.0f + distance_to_light * distance_to_light));\n"
-                "           //CryEngine's attenuation\n"
-                "           float wnd = windowing(distance_to_light, light.max_distance);\n"
-                "           float attenuation = pow(light.reference_distance / max(distance_to_light, light.min_distance), 2.0f) * wnd;\n"
-                "           //float attenuation = windowing(distance_to_light, 50.0f);\n"
-                "           float cosine = max(dot(to_light, vs.normal), 0.0f);\n"
-                "           if (light.type == LightType_Point) {\n"
-                "               shaded += cosine * light_colour * lit_colour * attenuation;\n"
-                "           } else {\n"
-                "               shaded += cosine * light_colour * lit_colour * attenuation * spotlight(-to_light, normalize(light.direction), radians(light.inner_angle), radians(light.max_angle));\n"
-                "           }\n"
-                "       }\n"
-                "       shaded = saturate(shaded);\n"
+                "#if HAS_POINT || HAS_SPOT\n"
+                "   // froxel: screen tile, then exponential slice of view depth\n"
+                "   uint cluster_x = min((uint)(vs.pos.x * cluster_x_scale), Cluster_Grid_X - 1);\n"
+                "   uint cluster_y = min((uint)(vs.pos.y * cluster_y_scale), Cluster_Grid_Y - 1);\n"
+                "   float view_z = dot(vs.pos_world - lcamera_p, camera_forward);\n"
+                "   uint cluster_z = (uint)clamp(log2(view_z) * cluster_z_scale + cluster_z_bias, 0.0f, Cluster_Grid_Z - 1);\n"
+                "   uint2 cluster = light_clusters[(cluster_z * Cluster_Grid_Y + cluster_y) * Cluster_Grid_X + cluster_x];\n"
+                "   for (uint index = 0; index < cluster.y; ++index) {\n"
+                "       Light light = lights[light_indices[cluster.x + index]];\n"
+                "#if HAS_POINT && HAS_SPOT\n"
+                "       bool spot = (light.type == LightType_Spotlight);\n"
+                "#else\n"
+                "       bool spot = (HAS_SPOT != 0);\n"
+                "#endif\n"
+                "       shaded = saturate(shaded + shade_local(light, vs, lit_colour, spot));\n"
                 "   }\n"
+                "#endif\n"
                 "   shaded += unlit_colour;\n"
                 "\n"
                 "\n" 
@@ -980,212 +1450,213 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
                 "    return (result);\n"
                 "}\n"
                 "\n"
-                "float4 ssaa_ps(Downsample_VS_Result input) : SV_Target {\n"
-                "    uint width, height;"
-                "    high_res_texture.GetDimensions(width, height);\n"
-                "    float2 offset = float2(1.0f / (float)width, 1.0f / (float)height);\n"
-                "    float4 colour0 = high_res_texture.Sample(high_res_sampler, input.uv - offset);\n"
-                "    float4 colour1 = high_res_texture.Sample(high_res_sampler, input.uv + float2(offset.x, -offset.y));\n"
-                "    float4 colour2 = high_res_texture.Sample(high_res_sampler, input.uv + offset);\n"
-                "    float4 colour3 = high_res_texture.Sample(high_res_sampler, input.uv + float2(-offset.x, offset.y));\n"
-                
-                "    float4 colour4 = high_res_texture.Sample(high_res_sampler, input.uv - offset * 2);\n"
-                "    float4 colour5 = high_res_texture.Sample(high_res_sampler, input.uv + 2 * float2(offset.x, -offset.y));\n"
-                "    float4 colour6 = high_res_texture.Sample(high_res_sampler, input.uv + 2 * offset);\n"
-                "    float4 colour7 = high_res_texture.Sample(high_res_sampler, input.uv + 2 * float2(-offset.x, offset.y));\n"
-                
-                "    float4 colour8 = high_res_texture.Sample(high_res_sampler, input.uv - offset * 3);\n"
-                "    float4 colour9 = high_res_texture.Sample(high_res_sampler, input.uv + 3 * float2(offset.x, -offset.y));\n"
-                "    float4 colour10 = high_res_texture.Sample(high_res_sampler, input.uv + 3 * offset);\n"
-                "    float4 colour11 = high_res_texture.Sample(high_res_sampler, input.uv + 3 * float2(-offset.x, offset.y));\n"
-                "    colour0.xyz *= colour0.xyz;\n"
-                "    colour1.xyz *= colour1.xyz;\n"
-                "    colour2.xyz *= colour2.xyz;\n"
-                "    colour3.xyz *= colour3.xyz;\n"
-                
-                "    colour4.xyz *= colour4.xyz;\n"
-                "    colour5.xyz *= colour5.xyz;\n"
-                "    colour6.xyz *= colour6.xyz;\n"
-                "    colour7.xyz *= colour7.xyz;\n"
-                
-                "    colour8.xyz *= colour8.xyz;\n"
-                "    colour9.xyz *= colour9.xyz;\n"
-                "    colour10.xyz *= colour10.xyz;\n"
-                "    colour11.xyz *= colour11.xyz;\n"
-                "    return (colour0 + colour1 + colour2 + colour3 + colour4 + colour5 + colour6 + colour7) * (1.0f / 8.0f);\n"
-                //"    return (colour0 + colour1 + colour2 + colour3 + colour4 + colour5 + colour6 + colour7 + colour8 + colour9 + colour10 + colour11) * (1.0f / 12.0f);\n"
-                //"    return (colour0 + colour1 + colour2 + colour3) * (1.0f / 4.0f);\n"
+                "// D3D11_Downsample_Constants\n"
+                "cbuffer Downsample_Constants : register(b2) {\n"
+                "    // 1 / the whole texture's size\n"
+                "    float2 source_texel_size;\n"
+                "    // rendered size / destination size\n"
+                "    float2 source_ratio;\n"
+                "    // last texel centre inside the rendered rectangle, in uv, so taps never read stale pixels past it\n"
+                "    float2 source_uv_max;\n"
+                "    uint2 source_max_texel;\n"
+                "    uint2 destination_size;\n"
+                "    float2 __unused_c;\n"
+                "};\n"
+                "\n"
+                "#if !defined(DOWNSAMPLE_FILTER)\n"
+                "#define DOWNSAMPLE_FILTER 1\n"
+                "#endif\n"
+                "\n"
+                "// downsample_kernel, see s_downsample.h\n"
+                "float downsample_kernel(float x) {\n"
+                "    float distance = abs(x);\n"
+                "#if DOWNSAMPLE_FILTER == 0\n"
+                "    return distance < 1.0f ? 1.0f : (distance == 1.0f ? 0.5f : 0.0f);\n"
+                "#elif DOWNSAMPLE_FILTER == 1\n"
+                "    return max(1.0f - 0.5f * distance, 0.0f);\n"
+                "#else\n"
+                "    float pi_x = 3.14159f * distance;\n"
+                "    return distance < 1e-5f ? 1.0f : (distance < 2.0f ? 2.0f * sin(pi_x) * sin(0.5f * pi_x) / (pi_x * pi_x) : 0.0f);\n"
+                "#endif\n"
+                "}\n"
+                "\n"
+                "// downsample_axis: the 4 texels around destination pixel index along one axis, weights normalized\n"
+                "float4 downsample_axis(float ratio, float index, out float first) {\n"
+                "    float centre = (index + 0.5f) * ratio;\n"
+                "    float kernel_scale = 0.5f * max(ratio, 1.0f);\n"
+                "    first = floor(centre - 0.5f) - 1.0f;\n"
+                "    float4 distance = (first + float4(0.5f, 1.5f, 2.5f, 3.5f)) - centre;\n"
+                "    float4 weights;\n"
+                "    [unroll] for (uint tap = 0; tap < 4; ++tap) {\n"
+                "        weights[tap] = downsample_kernel(distance[tap] / kernel_scale);\n"
+                "    }\n"
+                "    float sum = dot(weights, 1.0f);\n"
+                "    return(sum != 0.0f ? weights / sum : 0.0f);\n"
+                "}\n"
+                "\n"
+                "// Linear colour of destination pixel. high_res_texture is read through an _SRGB view, so\n"
+                "// every fetch is already decoded and bilinear taps blend in linear light.\n"
+                "float4 downsample(uint2 destination) {\n"
+                "    float2 first;\n"
+                "    float4 weights_x = downsample_axis(source_ratio.x, (float)destination.x, first.x);\n"
+                "    float4 weights_y = downsample_axis(source_ratio.y, (float)destination.y, first.y);\n"
+                "    float4 result = 0.0f;\n"
+                "#if DOWNSAMPLE_FILTER == 2\n"
+                "    // negative lobes, every texel on its own\n"
+                "    [unroll] for (uint y = 0; y < 4; ++y) {\n"
+                "        [unroll] for (uint x = 0; x < 4; ++x) {\n"
+                "            int2 texel = clamp(int2(first) + int2(x, y), 0, int2(source_max_texel));\n"
+                "            result += weights_x[x] * weights_y[y] * high_res_texture.Load(int3(texel, 0));\n"
+                "        }\n"
+                "    }\n"
+                "#else\n"
+                "    // pairs of texels collapse into one bilinear fetch, 4 fetches for the 4x4\n"
+                "    float2 pair_weight_x = weights_x.xz + weights_x.yw;\n"
+                "    float2 pair_weight_y = weights_y.xz + weights_y.yw;\n"
+                "    float2 position_x = first.x + float2(0.5f, 2.5f) + (pair_weight_x > 0.0f ? weights_x.yw / pair_weight_x : 0.0f);\n"
+                "    float2 position_y = first.y + float2(0.5f, 2.5f) + (pair_weight_y > 0.0f ? weights_y.yw / pair_weight_y : 0.0f);\n"
+                "    [unroll] for (uint y = 0; y < 2; ++y) {\n"
+                "        [unroll] for (uint x = 0; x < 2; ++x) {\n"
+                "            float2 uv = min(float2(position_x[x], position_y[y]) * source_texel_size, source_uv_max);\n"
+                "            result += pair_weight_x[x] * pair_weight_y[y] * high_res_texture.SampleLevel(high_res_sampler, uv, 0);\n"
+                "        }\n"
+                "    }\n"
+                "#endif\n"
+                "    return(result);\n"
+                "}\n"
+                "\n"
+                "// the render target view is _SRGB, it encodes what this returns\n"
+                "float4 downsample_ps(Downsample_VS_Result input) : SV_Target {\n"
+                "    return(downsample((uint2)input.position.xy));\n"
+                "}\n"
+                "\n"
+                "// downsample_srgb_encode\n"
+                "float3 srgb_encode(float3 value) {\n"
+                "    value = saturate(value);\n"
+                "    return(value <= 0.0031308f ? value * 12.92f : 1.055f * pow(value, 1.0f / 2.4f) - 0.055f);\n"
                 "}\n"
+                "\n"
+                "// UNORM, UAVs can't be _SRGB, so the encode is done here\n"
+                "RWTexture2D<float4> resolve_output : register(u0);\n"
+                "\n"
+                "[numthreads(8, 8, 1)]\n"
+                "void downsample_cs(uint3 thread_id : SV_DispatchThreadID) {\n"
+                "    if (all(thread_id.xy < destination_size)) {\n"
+                "        float4 colour = downsample(thread_id.xy);\n"
+                "        resolve_output[thread_id.xy] = float4(srgb_encode(colour.rgb), saturate(colour.a));\n"
+                "    }\n"
+                "}\n"
+
 				;
             
 			OutputDebugStringA(hlsl_code);
             
-			ID3DBlob *d3d_bytecode = null;
-			ID3DBlob *d3d_error = null;
-			h_result = D3DCompile(hlsl_code, sizeof(hlsl_code), null, null,
-								  D3D_COMPILE_STANDARD_FILE_INCLUDE, "vs_main", "vs_5_0",
-								  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION |
-								  D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR | D3DCOMPILE_ENABLE_STRICTNESS |
-								  D3DCOMPILE_WARNINGS_ARE_ERRORS, 0,
-								  &d3d_bytecode, &d3d_error);
-            
-			if (h_result != S_OK) {
-				os_message_box(str8("Vertex Shader Compilation Error"),
-							   str8_make(ID3D10Blob_GetBufferPointer(d3d_error),
-                                         ID3D10Blob_GetBufferSize(d3d_error)));
-				ExitProcess(1);
-			}
-            
-			h_result = ID3D11Device1_CreateVertexShader(d3d11_state.main_device, ID3D10Blob_GetBufferPointer(d3d_bytecode),
-														ID3D10Blob_GetBufferSize(d3d_bytecode), null, &my_vertex_shader);
-            
-			if (h_result != S_OK) {
-				os_message_box(str8("Error"), str8("Failed to create Vertex Shader"));
-				ExitProcess(1);
-			}
-            
-			D3D11_INPUT_ELEMENT_DESC per_vertex_ia[] = {
-				{ "Vertex", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-				{ "Normal", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+			// The source is the same every run unless the HLSL above changed, so keep the bytecode
+			// around on disk instead of paying for D3DCompile on every start-up.
+			Shader_Cache shader_cache;
+			shader_cache_open(&shader_cache, str8("shaders.cache"));
+			String_Const_U8 hlsl_source = str8_make((char *)hlsl_code, sizeof(hlsl_code));
+            
+			// indexed by vertex format, Mesh_Vertex, Vertex_Oct16 and Vertex_Oct8
+			D3D11_INPUT_ELEMENT_DESC per_vertex_ia[VertexFormat_Count][2] = {
+				{
+					{ "Vertex", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+					{ "Normal", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+				},
+				{
+					{ "Vertex", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+					{ "Normal", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+				},
+				{
+					{ "Vertex", 0, DXGI_FORMAT_R16G16B16A16_SINT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+				},
 			};
-            
-			h_result = ID3D11Device1_CreateInputLayout(d3d11_state.main_device, per_vertex_ia, 
-													   array_count(per_vertex_ia), ID3D10Blob_GetBufferPointer(d3d_bytecode),
-													   ID3D10Blob_GetBufferSize(d3d_bytecode), &per_vertex_input_layout);
-			if (h_result != S_OK) {
-				os_message_box(str8("Error"), str8("Failed to create Per-Vertex Input Layout"));
-				ExitProcess(1);
-			}
-            
-			ID3D10Blob_Release(d3d_bytecode);
-            
-			h_result = D3DCompile(hlsl_code, sizeof(hlsl_code), null, null,
-								  D3D_COMPILE_STANDARD_FILE_INCLUDE, "ps_gooch_main", "ps_5_0",
-								  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION |
-								  D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR | D3DCOMPILE_ENABLE_STRICTNESS |
-								  D3DCOMPILE_WARNINGS_ARE_ERRORS, 0,
-								  &d3d_bytecode, &d3d_error);
-            
-			if (h_result != S_OK) {
-				os_message_box(str8("Pixel Shader Compilation Error"), str8_make(ID3D10Blob_GetBufferPointer(d3d_error), ID3D10Blob_GetBufferSize(d3d_error)));
-				ExitProcess(1);
+			UINT per_vertex_ia_counts[VertexFormat_Count] = { 2, 2, 1 };
+            
+			Shader_Blob bytecode;
+			for (u32 format = 0; format < VertexFormat_Count; ++format) {
+				bytecode = d3d11_compile_shader(&shader_cache, hlsl_source, "vs_main", "vs_5_0",
+												vertex_format_defines[format], d3d11_shader_flags);
+				h_result = ID3D11Device1_CreateVertexShader(d3d11_state.main_device, bytecode.data, bytecode.size,
+															null, &my_vertex_shaders[format]);
+				
+				if (h_result != S_OK) {
+					os_message_box(str8("Error"), str8("Failed to create Vertex Shader"));
+					ExitProcess(1);
+				}
+				
+				h_result = ID3D11Device1_CreateInputLayout(d3d11_state.main_device, per_vertex_ia[format], 
+														   per_vertex_ia_counts[format], bytecode.data,
+														   bytecode.size, &per_vertex_input_layouts[format]);
+				if (h_result != S_OK) {
+					os_message_box(str8("Error"), str8("Failed to create Per-Vertex Input Layout"));
+					ExitProcess(1);
+				}
 			}
             
             // The idea of Gooch Shading is to compare the surface normal to the light's location. If the normal points towards the light,
             // a warmer tone is used for the surface. Else if it points away, a cooler tone is used. Angles in between interpolate between these tones.
-			h_result = ID3D11Device1_CreatePixelShader(d3d11_state.main_device, ID3D10Blob_GetBufferPointer(d3d_bytecode),
-													   ID3D10Blob_GetBufferSize(d3d_bytecode), null, &my_gooch_pixel_shader);
+			bytecode = d3d11_compile_shader(&shader_cache, hlsl_source, "ps_gooch_main", "ps_5_0", null, d3d11_shader_flags);
+			h_result = ID3D11Device1_CreatePixelShader(d3d11_state.main_device, bytecode.data, bytecode.size,
+													   null, &my_gooch_pixel_shader);
             
 			if (h_result != S_OK) {
 				os_message_box(str8("Error"), str8("Failed to create Pixel Shader"));
 				ExitProcess(1);
 			}
             
-			ID3D10Blob_Release(d3d_bytecode);
-            
-            h_result = D3DCompile(hlsl_code, sizeof(hlsl_code), null, null,
-								  D3D_COMPILE_STANDARD_FILE_INCLUDE, "ps_test_shading_model", "ps_5_0",
-								  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION |
-								  D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR | D3DCOMPILE_ENABLE_STRICTNESS |
-								  D3DCOMPILE_WARNINGS_ARE_ERRORS, 0,
-								  &d3d_bytecode, &d3d_error);
-            
-			if (h_result != S_OK) {
-				os_message_box(str8("Pixel Shader Compilation Error"), str8_make(ID3D10Blob_GetBufferPointer(d3d_error), ID3D10Blob_GetBufferSize(d3d_error)));
-				ExitProcess(1);
-			}
-            
-            h_result = ID3D11Device1_CreatePixelShader(d3d11_state.main_device, ID3D10Blob_GetBufferPointer(d3d_bytecode),
-													   ID3D10Blob_GetBufferSize(d3d_bytecode), null, &my_test_pixel_shader);
-            
-			if (h_result != S_OK) {
-				os_message_box(str8("Error"), str8("Failed to create Pixel Shader"));
-				ExitProcess(1);
+			for (u32 permutation = 0; permutation < shading_permutation_count; ++permutation) {
+				bytecode = d3d11_compile_shader(&shader_cache, hlsl_source, "ps_test_shading_model", "ps_5_0",
+												shading_permutations[permutation].defines, d3d11_shader_flags);
+				h_result = ID3D11Device1_CreatePixelShader(d3d11_state.main_device, bytecode.data, bytecode.size,
+														   null, &my_test_pixel_shaders[permutation]);
+                
+				if (h_result != S_OK) {
+					os_message_box(str8("Error"), str8("Failed to create Pixel Shader"));
+					ExitProcess(1);
+				}
 			}
             
-			ID3D10Blob_Release(d3d_bytecode);
-            
             // downsampling shaders
-            h_result = D3DCompile(hlsl_code, sizeof(hlsl_code), null, null,
-								  D3D_COMPILE_STANDARD_FILE_INCLUDE, "pass_through_vs", "vs_5_0",
-								  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION |
-								  D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR | D3DCOMPILE_ENABLE_STRICTNESS |
-								  D3DCOMPILE_WARNINGS_ARE_ERRORS, 0,
-								  &d3d_bytecode, &d3d_error);
-            
-			if (h_result != S_OK) {
-				os_message_box(str8("Vertex Shader Compilation Error"),
-							   str8_make(ID3D10Blob_GetBufferPointer(d3d_error),
-                                         ID3D10Blob_GetBufferSize(d3d_error)));
-				ExitProcess(1);
-			}
-            
-			h_result = ID3D11Device1_CreateVertexShader(d3d11_state.main_device, ID3D10Blob_GetBufferPointer(d3d_bytecode),
-														ID3D10Blob_GetBufferSize(d3d_bytecode), null, &downsample_vertex_shader);
+			bytecode = d3d11_compile_shader(&shader_cache, hlsl_source, "pass_through_vs", "vs_5_0", null, d3d11_shader_flags);
+			h_result = ID3D11Device1_CreateVertexShader(d3d11_state.main_device, bytecode.data, bytecode.size,
+														null, &downsample_vertex_shader);
             
 			if (h_result != S_OK) {
 				os_message_box(str8("Error"), str8("Failed to create Vertex Shader"));
 				ExitProcess(1);
 			}
             
-            
-			ID3D10Blob_Release(d3d_bytecode);
-            
-            h_result = D3DCompile(hlsl_code, sizeof(hlsl_code), null, null,
-								  D3D_COMPILE_STANDARD_FILE_INCLUDE, "ssaa_ps", "ps_5_0",
-								  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION |
-								  D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR | D3DCOMPILE_ENABLE_STRICTNESS |
-								  D3DCOMPILE_WARNINGS_ARE_ERRORS, 0,
-								  &d3d_bytecode, &d3d_error);
-            
-			if (h_result != S_OK) {
-				os_message_box(str8("Pixel Shader Compilation Error"), str8_make(ID3D10Blob_GetBufferPointer(d3d_error), ID3D10Blob_GetBufferSize(d3d_error)));
-				ExitProcess(1);
-			}
-            
-            h_result = ID3D11Device1_CreatePixelShader(d3d11_state.main_device, ID3D10Blob_GetBufferPointer(d3d_bytecode),
-													   ID3D10Blob_GetBufferSize(d3d_bytecode), null, &downsample_pixel_shader);
-            
-            
-			if (h_result != S_OK) {
-				os_message_box(str8("Error"), str8("Failed to create Pixel Shader"));
-				ExitProcess(1);
+			for (u32 filter = 0; filter < DownsampleFilter_Count; ++filter) {
+				bytecode = d3d11_compile_shader(&shader_cache, hlsl_source, "downsample_ps", "ps_5_0",
+												downsample_filter_defines[filter], d3d11_shader_flags);
+				h_result = ID3D11Device1_CreatePixelShader(d3d11_state.main_device, bytecode.data, bytecode.size,
+														   null, &downsample_pixel_shaders[filter]);
+                
+				if (h_result != S_OK) {
+					os_message_box(str8("Error"), str8("Failed to create Pixel Shader"));
+					ExitProcess(1);
+				}
+                
+				bytecode = d3d11_compile_shader(&shader_cache, hlsl_source, "downsample_cs", "cs_5_0",
+												downsample_filter_defines[filter], d3d11_shader_flags);
+				h_result = ID3D11Device1_CreateComputeShader(d3d11_state.main_device, bytecode.data, bytecode.size,
+															 null, &downsample_compute_shaders[filter]);
+                
+				if (h_result != S_OK) {
+					os_message_box(str8("Error"), str8("Failed to create Compute Shader"));
+					ExitProcess(1);
+				}
 			}
             
-			ID3D10Blob_Release(d3d_bytecode);
+			// a failed write only costs the next start-up a recompile
+			shader_cache_write(&shader_cache);
+			shader_cache_close(&shader_cache);
 		}
         
-		{
-			D3D11_BUFFER_DESC model_instance_desc = { 0 };
-			model_instance_desc.ByteWidth = (UINT)(r3d_buffer.capacity * sizeof(Model_Instance));
-			model_instance_desc.Usage = D3D11_USAGE_DYNAMIC;
-            model_instance_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-            model_instance_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-            model_instance_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-            model_instance_desc.StructureByteStride = sizeof(Model_Instance);
-            
-			HRESULT h_result = ID3D11Device1_CreateBuffer(d3d11_state.main_device, &model_instance_desc,
-														  null, &model_instance_buffer);
-            
-			if (h_result != S_OK) {
-				os_message_box(str8("Error"), str8("Failed to create Model Instance Buffer"));
-				ExitProcess(1);
-			}
-			
-			D3D11_SHADER_RESOURCE_VIEW_DESC model_instance_srv_desc = { 0 };
-			model_instance_srv_desc.Format = DXGI_FORMAT_UNKNOWN;
-			model_instance_srv_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
-			model_instance_srv_desc.Buffer.NumElements = (UINT)r3d_buffer.capacity;
-			model_instance_srv_desc.Buffer.ElementWidth = sizeof(Model_Instance);
-			h_result = ID3D11Device1_CreateShaderResourceView(d3d11_state.main_device,
-															  (ID3D11Resource *)model_instance_buffer,
-															  &model_instance_srv_desc,
-															  &model_instance_srv);
-			if (h_result != S_OK) {
-				os_message_box(str8("Error"), str8("Failed to create Model Instance SRV"));
-				ExitProcess(1);
-			}
-		}
+		d3d11_reserve_structured_buffer(&d3d11_state, &instance_buffer, scene->buffer.capacity);
+		d3d11_reserve_structured_buffer(&d3d11_state, &visible_buffer, scene->buffer.capacity);
+        
         
 		{
 			D3D11_BUFFER_DESC constant_desc = { 0 };
@@ -1215,152 +1686,168 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 				os_message_box(str8("Error"), str8("Failed to create Constant Buffer"));
 				ExitProcess(1);
 			}
+            
+            constant_desc.ByteWidth = sizeof(D3D11_Downsample_Constants);
+			h_result = ID3D11Device1_CreateBuffer(d3d11_state.main_device,
+                                                  &constant_desc, null,
+                                                  &downsample_constant_buffer);
+            
+			if (h_result != S_OK) {
+				os_message_box(str8("Error"), str8("Failed to create Constant Buffer"));
+				ExitProcess(1);
+			}
+            
+            constant_desc.ByteWidth = sizeof(D3D11_Draw_Constants);
+			h_result = ID3D11Device1_CreateBuffer(d3d11_state.main_device,
+                                                  &constant_desc, null,
+                                                  &draw_constant_buffer);
+            
+			if (h_result != S_OK) {
+				os_message_box(str8("Error"), str8("Failed to create Constant Buffer"));
+				ExitProcess(1);
+			}
 		}
         
-		// Ok, so rotations in R^3 (esp. camera)
-		// We discuss Euler Angles, namely, pitch, yaw, and roll.
-		// Euler angles are a mechanism for creating a rotation through a sequence
-		// of three simpler rotations called pitch, yaw, and roll. 
-		// Pitching rotates an object around the x-axis.
-		// 	- pointing up or down (yes guesture)
-		// Yawing rotates an object around the xz-plane or around the y-axis.
-		// 	- turning left or right (no guesture)
-		// Rolling rotates an object around the xy-plane or around the z-axis.
-		//	- tilting your head left and right.
-		//
-		//	Rotation matrices are orthonormal. Thus its inverse is its transpose.
-		//
-		//	We now derive the camera basis. We use pitch and yaw and radius r (sphere coords).
-		//	1. Suppose you're at the origin. Look straight ahead towards the x-axis.
-		//	2. The y-axis points from your feet to your head. Point your right-arm up the y-axis.
-		//	3. Rotate your body counterclockwise by the angle yaw (azimuth).
-		//	4. Rotate your right-arm downward by angle pitch (zenith)
-		//	5. Displace by the distance r.
-		//	Now we convert from sphere coords to cartesian coords.
-		v3f camera_p = v3f_make(0.0f, 0.0f, 0.0f);
-		f32 camera_theta = 90.0f; // nod yes; Rotate around x.
-		f32 camera_phi = 90.0f; // no; rotate around y
+        // The offscreen target is allocated at 2x the window, the old fixed SSAA factor. The scene
+        // is drawn into as much of it as the GPU budget allows, between 0.5x and 2x. The budget
+        // follows the refresh rate of the display the swap chain is on.
+        D3D11_GPU_Timer gpu_timer;
+        d3d11_gpu_timer_init(&d3d11_state, &gpu_timer);
+        Dynamic_Resolution dynamic_resolution;
+        dynamic_resolution_init(&dynamic_resolution, dynamic_resolution_budget_ms(d3d11_refresh_hz(&d3d11_state)), 0.5f, 2.0f);
+        
+        // the game steps at game_update_hz whatever the display runs at, frames draw in between
+        Frame_Clock frame_clock;
+        frame_clock_init(&frame_clock, os_time_ticks_per_second(), game_update_hz, game_max_steps_per_frame);
+        u64 last_frame_ticks = os_time_ticks();
+        
+        // left/right cycles the resolve filter, up/down switches between the pixel and compute shader,
+        // P starts a profile capture and, pressed again, writes it to profile.json
+        u32 downsample_filter = DownsampleFilter_Tent;
+        b32 downsample_with_compute = False;
         
 		{
 			POINT new_cursor;
 			new_cursor.x = os_window.client_width / 2;
 			new_cursor.y = os_window.client_height / 2;
-			ClientToScreen(os_window.handle, &new_cursor);
+			ClientToScreen((HWND)os_window.handle, &new_cursor);
 			SetCursorPos(new_cursor.x, new_cursor.y);
 		}
         
         
         ID3D11ShaderResourceView* null_srv = null;
-        f32 game_dt_step = 1.0f / 60.0f;
-		f32 rot_accum = 0.0f;
 		while (!(os_input.flags & OSInput_Flag_Quit)) {
+            // until the display has taken the last frame, rather than blocking in Present with this
+            // frame's input already read
+            profile_begin("wait for swap chain");
+            WaitForSingleObjectEx(d3d11_state.frame_latency_waitable, 1000, TRUE);
+            profile_end();
+            
+            profile_begin("frame");
+            arena_clear(&frame_arena);
 			os_fill_events(&os_input, &os_window);
             
 			if (os_input_released(&os_input, OSInput_Key_Escape)) {
 				os_input.flags |= OSInput_Flag_Quit;
 			}
             
-			f32 mouse_sensitivity = 0.1f;
-			camera_theta += os_input.mouse_displace_y * mouse_sensitivity;
-			camera_phi -= os_input.mouse_displace_x * mouse_sensitivity;
-			
-			if (camera_theta > 145.0f) {
-				camera_theta = 145.0f;
-			} else if (camera_theta < 45.0f) {
-				camera_theta = 45.0f;
-			}
-            
-			if (camera_phi >= 360.0f) {
-				camera_phi = 0.0f;
-			} else if (camera_phi <= -360.0f) {
-				camera_phi = 0.0f;
-			}
-            
-			f32 theta = radians(camera_theta);
-			f32 phi = radians(camera_phi);
-			f32 cosine_theta = cosf(theta);
-			f32 cosine_phi = cosf(phi);
-			f32 sine_theta = sinf(theta);
-			f32 sine_phi = sinf(phi);
-            
-			v3f camera_forward;
-			camera_forward.x = cosine_phi * sine_theta;
-			camera_forward.y = cosine_theta;
-			camera_forward.z = sine_theta * sine_phi;
-			v3f_norm(&camera_forward);
-            
-			v3f temp_up = v3f_make(0.0f, 1.0f, 0.0f);
-			v3f camera_right = v3f_cross(temp_up, camera_forward);
-			v3f_norm(&camera_right);
-			v3f camera_up = v3f_cross(camera_forward, camera_right);
-			v3f_norm(&camera_up);
+            if (os_input_pressed(&os_input, OSInput_Key_Right)) {
+                downsample_filter = (downsample_filter + 1) % DownsampleFilter_Count;
+            }
+            if (os_input_pressed(&os_input, OSInput_Key_Left)) {
+                downsample_filter = (downsample_filter + DownsampleFilter_Count - 1) % DownsampleFilter_Count;
+            }
+            if (os_input_pressed(&os_input, OSInput_Key_Up) || os_input_pressed(&os_input, OSInput_Key_Down)) {
+                downsample_with_compute = !downsample_with_compute;
+            }
+            if (os_input_pressed(&os_input, OSInput_Key_V)) {
+                vertex_format = (vertex_format + 1) % VertexFormat_Count;
+            }
+            if (os_input_pressed(&os_input, OSInput_Key_P)) {
+                if (!profiler.capturing) {
+                    profile_capture_begin();
+                } else {
+                    profile_capture_end();
+                    if (!profile_write_chrome_trace(&frame_arena, str8("profile.json"))) {
+                        os_message_box(str8("Error"), str8("Failed to write profile.json"));
+                    }
+                    
+                    u32 zone_count;
+                    Profile_Stats *zones = profile_stats(&frame_arena, &zone_count);
+                    for (u32 zone = 0; zone < zone_count; ++zone) {
+                        char line[128];
+                        snprintf(line, sizeof(line), "%-20s us: p50 %9.1f, p99 %9.1f, max %9.1f\n", zones[zone].name,
+                                 zones[zone].p50_us, zones[zone].p99_us, zones[zone].max_us);
+                        OutputDebugStringA(line);
+                    }
+                    
+                    // last frame's binds, over the immediate and every deferred context
+                    u64 state_issued = immediate_context.cache.frame_issued;
+                    u64 state_filtered = immediate_context.cache.frame_filtered;
+                    for (u32 worker = 0; worker < deferred_count; ++worker) {
+                        state_issued += deferred_contexts[worker].cache.frame_issued;
+                        state_filtered += deferred_contexts[worker].cache.frame_filtered;
+                    }
+                    char line[128];
+                    snprintf(line, sizeof(line), "state cache: %llu binds made, %llu dropped as redundant\n",
+                             (unsigned long long)state_issued, (unsigned long long)state_filtered);
+                    OutputDebugStringA(line);
+                    
+                    // last frame's cull
+                    snprintf(line, sizeof(line), "cull: %llu tested, %llu visible, %llu culled\n",
+                             (unsigned long long)cull_stats.tested, (unsigned long long)cull_stats.visible,
+                             (unsigned long long)cull_stats.culled);
+                    OutputDebugStringA(line);
+                }
+            }
             
-			f32 move_speed = 0.1f;
-			if (os_input_held(&os_input, OSInput_Key_W)) {
-				camera_p = v3f_add(v3f_scale(camera_forward, move_speed), camera_p);
-			}
-			
-			if (os_input_held(&os_input, OSInput_Key_S)) {
-				camera_p = v3f_sub(camera_p, v3f_scale(camera_forward, move_speed));
-			}
-			
-			if (os_input_held(&os_input, OSInput_Key_A)) {
-				camera_p = v3f_sub(camera_p, v3f_scale(camera_right, move_speed));
-			}
-			
-			if (os_input_held(&os_input, OSInput_Key_D)) {
-				camera_p = v3f_add(camera_p, v3f_scale(camera_right, move_speed));
-			}
+            f32 gpu_milliseconds;
+            if (d3d11_gpu_timer_read(&d3d11_state, &gpu_timer, &gpu_milliseconds)) {
+                dynamic_resolution_update(&dynamic_resolution, gpu_milliseconds);
+            }
             
-			if (os_input_held(&os_input, OSInput_Key_Shift)) {
-				camera_p = v3f_sub(camera_p, v3f_scale(camera_up, move_speed));
-			}
-			
-			if (os_input_held(&os_input, OSInput_Key_Space)) {
-				camera_p = v3f_add(camera_p, v3f_scale(camera_up, move_speed));
-			}
+            D3D11_TEXTURE2D_DESC offscreen_desc;
+            ID3D11Texture2D_GetDesc(d3d11_state.offscreen_back_buffer, &offscreen_desc);
+            u32 render_width, render_height;
+            dynamic_resolution_size(dynamic_resolution.scale, os_window.client_width, os_window.client_height,
+                                    offscreen_desc.Width, offscreen_desc.Height, &render_width, &render_height);
             
 			D3D11_VIEWPORT viewport;
-			viewport.Width = (f32)os_window.client_width * 2;
-			viewport.Height = (f32)os_window.client_height * 2;
+			viewport.Width = (f32)render_width;
+			viewport.Height = (f32)render_height;
 			viewport.MinDepth = 0;
 			viewport.MaxDepth = 1;
 			viewport.TopLeftX = 0;
 			viewport.TopLeftY = 0;
 			
-            r3d_add_instance(&r3d_buffer, v3f_make(0.0f, 0.0f, 8.0f),
-                             quat_make_rotate_around_axis(rot_accum, v3f_make(1.0f, 0.0f, 0.0f)),
-                             v3f_make(6.0f, 6.0f, 6.0f),
-                             v4f_make(0.0f, 0.5f, 0.8f, 1.0f));
-            
-            r3d_add_instance(&r3d_buffer, v3f_make(6.0f, 0.0f, 4.0f),
-                             quat_make_rotate_around_axis(rot_accum * -1.0f, v3f_make(0.0f, 0.5f, 1.0f)),
-                             v3f_make(1.0f, 1.0f, 1.0f),
-                             v4f_make(0.6f, 0.5f, 0.0f, 1.0f));
-            //quat x = quat_make_rotate_around_axis(rot_accum, v3f_make(1.0f, 0.0f, 0.0f));
-            //quat y = quat_make_rotate_around_axis(rot_accum * 2.0f, v3f_make(0.0f, 1.0f, 0.0f));
-            //quat z = quat_make_rotate_around_axis(-rot_accum * 0.5f, v3f_make(0.0f, 0.0f, 1.0f));
-            
-			rot_accum += game_dt_step;
+            u64 frame_ticks = os_time_ticks();
+            u32 step_count = frame_clock_advance(&frame_clock, frame_ticks - last_frame_ticks);
+            last_frame_ticks = frame_ticks;
+            game_update(&game, &os_input, step_count, frame_clock_alpha(&frame_clock),
+                        (f32)os_window.client_height / (f32)os_window.client_width);
+            
+            profile_begin("light clusters");
+            Light_Clusters light_clusters;
+            light_clusters_build(&light_clusters, &job_system, &frame_arena, &game.light_view, game.lights, game.light_count);
+            profile_end();
+            
+            profile_begin("upload");
+            Light_Constants light_constants;
+            light_clusters_constants(&light_clusters, &light_constants, render_width, render_height);
+            u32 shading_permutation = shading_permutation_select(&light_clusters);
+            d3d11_upload_structured_buffer(&d3d11_state, &light_buffer, light_clusters.packed, game.light_count);
+            d3d11_upload_structured_buffer(&d3d11_state, &light_cluster_buffer, light_clusters.clusters, light_cluster_count);
+            d3d11_upload_structured_buffer(&d3d11_state, &light_index_buffer, light_clusters.indices, light_clusters.index_count);
             
 			D3D11_MAPPED_SUBRESOURCE mapped_subresource;
 			switch (ID3D11DeviceContext_Map(d3d11_state.base_device_context,
                                             (ID3D11Resource *)constant_buffer, 0, D3D11_MAP_WRITE_DISCARD,
                                             0, &mapped_subresource)) {
 				case S_OK: {
-					f32 aspect = viewport.Height / viewport.Width;
-                    m44 pers = m44_perspective_lh_z01(radians(66.2f), aspect, 1.0f, 100.0f);
-                    D3D11_Constants *constants = ((D3D11_Constants *)mapped_subresource.pData);
-                    
-					constants->perspective = pers;
-					constants->world_to_camera.rows[0] = v4f_make(camera_right.x, camera_up.x, camera_forward.x, 0.0f);
-					constants->world_to_camera.rows[1] = v4f_make(camera_right.y, camera_up.y, camera_forward.y, 0.0f);
-					constants->world_to_camera.rows[2] = v4f_make(camera_right.z, camera_up.z, camera_forward.z, 0.0f);
-					constants->world_to_camera.rows[3].x = -v3f_dot(camera_right, camera_p);
-					constants->world_to_camera.rows[3].y = -v3f_dot(camera_up, camera_p);
-					constants->world_to_camera.rows[3].z = -v3f_dot(camera_forward, camera_p);
-					constants->world_to_camera.rows[3].w = 1;
-                    constants->camera_p = camera_p;
+                    D3D11_Constants *constants = (D3D11_Constants *)mapped_subresource.pData;
+                    *constants = game.constants;
+                    constants->position_scale = instance_vertex_streams[vertex_format].position_scale;
+                    constants->position_offset = instance_vertex_streams[vertex_format].position_offset;
 					ID3D11DeviceContext_Unmap(d3d11_state.base_device_context, (ID3D11Resource *)constant_buffer, 0);
 				} break;
 			}
@@ -1369,55 +1856,115 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
                                             (ID3D11Resource *)light_constant_buffer, 0, D3D11_MAP_WRITE_DISCARD,
                                             0, &mapped_subresource)) {
                 case S_OK: {
-                    v3f size = v3f_make(0.2f, 0.2f, 0.2f);
-                    v4f colour = v4f_make(1.0f, 1.0f, 1.0f, 1.0f);
-                    
-                    Light_Constants *constants = (Light_Constants *)mapped_subresource.pData;
-                    Light light;
-                    light.type = LightType_Spotlight;
-                    light.p = v3f_make(0.0f, 0.0f, -1.0f);
-                    light.reference_distance = 8.0f;
-                    light.max_distance = 50.0f;
-                    light.min_distance = 1.0f;
-                    light.direction = v3f_make(0.0f, 0.0f, 1.0f);
-                    light.colour = v4f_make(0.5f, 0.3f, 1.0f, 1.0f);
-                    light.inner_angle = 15.0f;
-                    light.max_angle = 35.0f;
-                    light.enabled = True;
-                    constants->light[0] = light;
-                    r3d_add_instance(&r3d_buffer, light.p, quat_identity(), size, colour);
-                    
-                    light.p = v3f_make(16.0f, 4.0f, -4.0f);
-                    light.reference_distance = 24.0f;
-                    light.max_distance = 100.0f;
-                    light.direction = v3f_make(-1.0f, 0.0f, 1.0f);
-                    light.colour = v4f_make(1.0f, 1.0f, 1.0f, 1.0f);
-                    constants->light[1] = light;
-                    r3d_add_instance(&r3d_buffer, light.p, quat_identity(), size, colour);
-                    
-                    light.type = LightType_Point;
-                    light.p = v3f_make(sinf(rot_accum) * 10.0f, cosf(rot_accum) * 10.0f, 0.0f);
-                    light.reference_distance = 16.0f;
-                    light.max_distance = 100.0f;
-                    light.colour = v4f_make(0.0f, 1.0f, 0.0f, 1.0f);
-                    constants->light[2] = light;
-                    
-                    r3d_add_instance(&r3d_buffer, light.p, quat_identity(), size, colour);
-                    constants->camera_p = camera_p;
+                    *((Light_Constants *)mapped_subresource.pData) = light_constants;
 					ID3D11DeviceContext_Unmap(d3d11_state.base_device_context, (ID3D11Resource *)light_constant_buffer, 0);
                 } break;
             }
+            
+            D3D11_Downsample_Constants downsample_constants = { 0 };
+            D3D11_TEXTURE2D_DESC backbuffer_desc = { 0 };
+            ID3D11Texture2D_GetDesc(d3d11_state.back_buffer, &backbuffer_desc);
+            downsample_constants.source_texel_size[0] = 1.0f / (f32)offscreen_desc.Width;
+            downsample_constants.source_texel_size[1] = 1.0f / (f32)offscreen_desc.Height;
+            downsample_constants.source_ratio[0] = (f32)render_width / (f32)backbuffer_desc.Width;
+            downsample_constants.source_ratio[1] = (f32)render_height / (f32)backbuffer_desc.Height;
+            downsample_constants.source_max_texel[0] = render_width - 1;
+            downsample_constants.source_max_texel[1] = render_height - 1;
+            downsample_constants.destination_size[0] = backbuffer_desc.Width;
+            downsample_constants.destination_size[1] = backbuffer_desc.Height;
+            downsample_constants.source_uv_max[0] = ((f32)render_width - 0.5f) / (f32)offscreen_desc.Width;
+            downsample_constants.source_uv_max[1] = ((f32)render_height - 0.5f) / (f32)offscreen_desc.Height;
+            switch (ID3D11DeviceContext_Map(d3d11_state.base_device_context,
+                                            (ID3D11Resource *)downsample_constant_buffer, 0, D3D11_MAP_WRITE_DISCARD,
+                                            0, &mapped_subresource)) {
+                case S_OK: {
+                    *((D3D11_Downsample_Constants *)mapped_subresource.pData) = downsample_constants;
+					ID3D11DeviceContext_Unmap(d3d11_state.base_device_context, (ID3D11Resource *)downsample_constant_buffer, 0);
+                } break;
+            }
+            profile_end();
 			
-			switch (ID3D11DeviceContext_Map(d3d11_state.base_device_context,
-											(ID3D11Resource *)model_instance_buffer, 0, D3D11_MAP_WRITE_DISCARD,
-											0, &mapped_subresource)) {
-				case S_OK: {
-					memory_copy(mapped_subresource.pData, r3d_buffer.instances, sizeof(Model_Instance) * r3d_buffer.count);
-					ID3D11DeviceContext_Unmap(d3d11_state.base_device_context, (ID3D11Resource *)model_instance_buffer, 0);
-				} break;
-			}
+            // only the slots that changed since last frame are packed and uploaded
+            profile_begin("instances");
+            if (d3d11_reserve_structured_buffer(&d3d11_state, &instance_buffer, scene->buffer.count)) {
+                r3d_dirty_clear(&scene->dirty);
+                r3d_dirty_add(&scene->dirty, 0, scene->buffer.count);
+            }
+            
+            for (u32 range_index = 0; range_index < scene->dirty.count; ++range_index) {
+                R3D_Range range = scene->dirty.ranges[range_index];
+                u64 range_count = range.one_past_last - range.first;
+                R3D_Packed_Instance *packed = arena_push_array(&frame_arena, R3D_Packed_Instance, range_count);
+                r3d_pack_instances_parallel(&job_system, packed, &scene->buffer, range.first, range_count);
+                
+                // The runtime copies the range into its own staging memory, so packed can go
+                // straight back to the frame arena.
+                D3D11_BOX box = { 0 };
+                box.left = (UINT)(range.first * sizeof(R3D_Packed_Instance));
+                box.right = (UINT)(range.one_past_last * sizeof(R3D_Packed_Instance));
+                box.bottom = 1;
+                box.back = 1;
+                ID3D11DeviceContext_UpdateSubresource(d3d11_state.base_device_context,
+                                                      (ID3D11Resource *)instance_buffer.buffer, 0, &box,
+                                                      packed, 0, 0);
+            }
+            r3d_dirty_clear(&scene->dirty);
+            profile_end();
+            
+            // only what survives the frustum is drawn, through a list of slot indices
+            profile_begin("cull");
+            Frustum frustum = frustum_from_view_projection(game.view_projection);
+            u32 *visible_instances = arena_push_array(&frame_arena, u32, scene->buffer.count);
+            u64 visible_count = r3d_cull_parallel(&job_system, &frame_arena, &scene->buffer, &frustum, game.mesh_radius,
+                                                  visible_instances, &cull_stats);
+            visible_count = r3d_scene_filter_alive(scene, visible_instances, visible_count);
+            profile_end();
+            
+            // sorted into batches in place, so the list below is uploaded already in draw order
+            profile_begin("key, sort and batch");
+            Mesh_LOD_View lod_view = mesh_lod_view(game.view_projection, render_height, 1.0f);
+            u64 *keys = arena_push_array(&frame_arena, u64, visible_count);
+            batch_keys_parallel(&job_system, &scene->buffer, game.mesh_lods, &lod_view, visible_instances, visible_count, keys);
+            profile_begin("sort");
+            batch_sort_parallel(&job_system, &frame_arena, keys, visible_instances, visible_count);
+            profile_end();
+            u32 batch_count;
+            Batch *batches = batch_build(&frame_arena, keys, visible_count, &batch_count);
+            profile_end();
+            
+            profile_begin("record commands");
+            render_queue_reset(&render_queue);
+            render_record_batches_parallel(&job_system, &render_queue, &game, batches, batch_count);
+            u64 command_count;
+            Render_Command *commands = render_queue_sort(&render_queue, &job_system, &frame_arena, &command_count);
+            profile_end();
+            
+            profile_begin("upload visible");
+            b32 visible_changed = d3d11_reserve_structured_buffer(&d3d11_state, &visible_buffer, visible_count);
+            if (!visible_changed) {
+                visible_changed = (visible_count != uploaded_visible_count) ||
+                    (memory_compare(visible_instances, uploaded_visible, visible_count * sizeof(u32)) != 0);
+            }
+            if (visible_changed) {
+                arena_clear(&uploaded_visible_arena);
+                arena_push_array(&uploaded_visible_arena, u32, visible_count);
+                memory_copy(uploaded_visible, visible_instances, visible_count * sizeof(u32));
+                uploaded_visible_count = visible_count;
+                
+                switch (ID3D11DeviceContext_Map(d3d11_state.base_device_context,
+                                                (ID3D11Resource *)visible_buffer.buffer, 0, D3D11_MAP_WRITE_DISCARD,
+                                                0, &mapped_subresource)) {
+                    case S_OK: {
+                        memory_copy(mapped_subresource.pData, visible_instances, visible_count * sizeof(u32));
+                        ID3D11DeviceContext_Unmap(d3d11_state.base_device_context, (ID3D11Resource *)visible_buffer.buffer, 0);
+                    } break;
+                }
+            }
+            profile_end();
+            
             // render scene
-            D3D11_TEXTURE2D_DESC backbuffer_desc = { 0 };
+            profile_begin("scene");
+            d3d11_gpu_timer_begin(&d3d11_state, &gpu_timer);
 			f32 colour[] = { 0.0f, 0.0f, 0.0f, 1.0f };
 			ID3D11DeviceContext_ClearRenderTargetView(d3d11_state.base_device_context,
 													  d3d11_state.offscreen_back_buffer_rtv,
@@ -1428,90 +1975,92 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 													  d3d11_state.depth_buffer_view,
 													  D3D11_CLEAR_DEPTH, 1.0f, 0);
             
-			ID3D11DeviceContext_IASetPrimitiveTopology(d3d11_state.base_device_context,
-                                                       D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-            
-			UINT stride = 6 * sizeof(f32);
-			UINT offsets = 0;
-			ID3D11DeviceContext_IASetVertexBuffers(d3d11_state.base_device_context, 0, 1,
-												   &cube_vertex_buffer, &stride, &offsets);
-            
-			ID3D11DeviceContext_IASetInputLayout(d3d11_state.base_device_context, per_vertex_input_layout);
-            
-			ID3D11DeviceContext_VSSetShader(d3d11_state.base_device_context,
-											my_vertex_shader,
-											null, 0);
-            
-			ID3D11DeviceContext_VSSetShaderResources(d3d11_state.base_device_context, 0,
-													 1, &model_instance_srv);
-            
-			ID3D11DeviceContext_VSSetConstantBuffers(d3d11_state.base_device_context,
-													 0, 1, &constant_buffer);
-            
-            
-            ID3D11Texture2D_GetDesc(d3d11_state.offscreen_back_buffer, &backbuffer_desc);
-            viewport.Width = (FLOAT)backbuffer_desc.Width;
-			viewport.Height = (FLOAT)backbuffer_desc.Height;
-			ID3D11DeviceContext_RSSetViewports(d3d11_state.base_device_context, 1, &viewport);
-			ID3D11DeviceContext_RSSetState(d3d11_state.base_device_context,
-										   (ID3D11RasterizerState *)d3d11_state.fill_cull_raster);
-            
-            ID3D11DeviceContext_PSSetConstantBuffers(d3d11_state.base_device_context,
-                                                     1, 1, &light_constant_buffer);
-            
-			ID3D11DeviceContext_PSSetShader(d3d11_state.base_device_context,
-											my_test_pixel_shader,
-											null, 0);
-            
-			ID3D11DeviceContext_OMSetDepthStencilState(d3d11_state.base_device_context,
-													   d3d11_state.depth_buffer_state, 0);
-            
-			ID3D11DeviceContext_OMSetRenderTargets(d3d11_state.base_device_context, 1,
-												   &(d3d11_state.offscreen_back_buffer_rtv),
-                                                   //&d3d11_state.back_buffer_as_rtv,
-												   d3d11_state.depth_buffer_view);
-            
-			ID3D11DeviceContext_OMSetBlendState(d3d11_state.base_device_context,
-											    null, null, 0xffffffff);
-            
-			ID3D11DeviceContext_DrawInstanced(d3d11_state.base_device_context,
-											  36, (UINT)r3d_buffer.count, 0, 0);
-            
-            ID3D11DeviceContext_OMSetRenderTargets(d3d11_state.base_device_context, 0, null, null);
-            
-            // SSAA pass
-			ID3D11DeviceContext_VSSetShader(d3d11_state.base_device_context,
-											downsample_vertex_shader,
-											null, 0);
-            
-			ID3D11DeviceContext_PSSetShader(d3d11_state.base_device_context,
-											downsample_pixel_shader,
-											null, 0);
-            
-            ID3D11DeviceContext_PSSetShaderResources(d3d11_state.base_device_context, 1, 1, 
-                                                     &d3d11_state.offscreen_back_buffer_srv);
-            
-            ID3D11DeviceContext_PSSetSamplers(d3d11_state.base_device_context, 0, 1,
-                                              &d3d11_state.sampler_for_high_res_buffer);
-            ID3D11DeviceContext_RSSetViewports(d3d11_state.base_device_context, 1, &viewport);
-            
-            ID3D11Texture2D_GetDesc(d3d11_state.back_buffer, &backbuffer_desc);
-            viewport.Width = (FLOAT)backbuffer_desc.Width;
-			viewport.Height = (FLOAT)backbuffer_desc.Height;
-            ID3D11DeviceContext_RSSetViewports(d3d11_state.base_device_context, 1, &viewport);
-            
-			ID3D11DeviceContext_OMSetDepthStencilState(d3d11_state.base_device_context, null, 0);
-            ID3D11DeviceContext_OMSetRenderTargets(d3d11_state.base_device_context, 1,
-                                                   &d3d11_state.back_buffer_as_rtv,
-												   null);
-            
-			ID3D11DeviceContext_IASetPrimitiveTopology(d3d11_state.base_device_context,
-                                                       D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-            
-            ID3D11DeviceContext_Draw(d3d11_state.base_device_context, 4, 0);
+            D3D11_Scene_Pass scene_pass = { 0 };
+            scene_pass.rtv = d3d11_state.offscreen_back_buffer_rtv;
+            scene_pass.dsv = d3d11_state.depth_buffer_view;
+            scene_pass.depth_state = d3d11_state.depth_buffer_state;
+            scene_pass.raster = (ID3D11RasterizerState *)d3d11_state.fill_cull_raster;
+            scene_pass.viewport = viewport;
+            scene_pass.vertex_buffer = instance_vertex_buffers[vertex_format];
+            scene_pass.stride = instance_vertex_streams[vertex_format].stride;
+            scene_pass.index_buffer = instance_index_buffer;
+            scene_pass.input_layout = per_vertex_input_layouts[vertex_format];
+            scene_pass.vertex_shader = my_vertex_shaders[vertex_format];
+            scene_pass.instance_srv = instance_buffer.srv;
+            scene_pass.visible_srv = visible_buffer.srv;
+            scene_pass.constant_buffer = constant_buffer;
+            scene_pass.light_constant_buffer = light_constant_buffer;
+            scene_pass.draw_constant_buffer = draw_constant_buffer;
+            scene_pass.light_srvs[0] = light_buffer.srv;
+            scene_pass.light_srvs[1] = light_cluster_buffer.srv;
+            scene_pass.light_srvs[2] = light_index_buffer.srv;
+            scene_pass.pixel_shaders[GameShader_Lit] = my_test_pixel_shaders[shading_permutation];
+            scene_pass.pixel_shaders[GameShader_Gooch] = my_gooch_pixel_shader;
+            
+            // one draw per command; a slice of them per deferred context, executed here in slice
+            // order so the sorted order holds, or all of them straight onto the immediate context
+            if (deferred_count && (command_count >= d3d11_deferred_min_commands)) {
+                for (u32 worker = 0; worker < deferred_count; ++worker) {
+                    deferred_states[worker].pass = &scene_pass;
+                }
+                render_replay_parallel(&job_system, deferred_backends, deferred_count, commands, command_count);
+                for (u32 worker = 0; worker < deferred_count; ++worker) {
+                    // executing without restoring leaves the immediate context in its default state,
+                    // the resolve below sets everything it uses and the cache forgets it all
+                    ID3D11DeviceContext_ExecuteCommandList(d3d11_state.base_device_context,
+                                                           deferred_states[worker].command_list, FALSE);
+                    ID3D11CommandList_Release(deferred_states[worker].command_list);
+                    deferred_states[worker].command_list = null;
+                }
+                state_cache_invalidate(&immediate_context.cache);
+            } else {
+                immediate_state.pass = &scene_pass;
+                render_replay(&immediate_backend, commands, command_count);
+            }
             
-            ID3D11DeviceContext_PSSetShaderResources(d3d11_state.base_device_context, 1, 1, 
-                                                     &null_srv);
+            d3d11_gpu_timer_zone(&d3d11_state, &gpu_timer, "gpu scene");
+            profile_end();
+            
+            // resolve the render target to the window
+            profile_begin("resolve");
+            if (downsample_with_compute) {
+                d3d11_set_compute_shader(&immediate_context, downsample_compute_shaders[downsample_filter]);
+                d3d11_set_cs_resources(&immediate_context, 1, 1, &d3d11_state.offscreen_back_buffer_srv);
+                d3d11_set_cs_samplers(&immediate_context, 0, 1, &d3d11_state.sampler_for_high_res_buffer);
+                d3d11_set_cs_constant_buffers(&immediate_context, 2, 1, &downsample_constant_buffer);
+                d3d11_set_cs_unordered_access(&immediate_context, 0, 1, &d3d11_state.resolve_uav);
+                
+                ID3D11DeviceContext_Dispatch(d3d11_state.base_device_context,
+                                             (backbuffer_desc.Width + 7) / 8, (backbuffer_desc.Height + 7) / 8, 1);
+                
+                ID3D11UnorderedAccessView *null_uav = null;
+                d3d11_set_cs_unordered_access(&immediate_context, 0, 1, &null_uav);
+                d3d11_set_cs_resources(&immediate_context, 1, 1, &null_srv);
+                ID3D11DeviceContext_CopyResource(d3d11_state.base_device_context,
+                                                 (ID3D11Resource *)d3d11_state.back_buffer,
+                                                 (ID3D11Resource *)d3d11_state.resolve_texture);
+            } else {
+				d3d11_set_vertex_shader(&immediate_context, downsample_vertex_shader);
+				d3d11_set_pixel_shader(&immediate_context, downsample_pixel_shaders[downsample_filter]);
+                d3d11_set_ps_resources(&immediate_context, 1, 1, &d3d11_state.offscreen_back_buffer_srv);
+                d3d11_set_ps_samplers(&immediate_context, 0, 1, &d3d11_state.sampler_for_high_res_buffer);
+                d3d11_set_ps_constant_buffers(&immediate_context, 2, 1, &downsample_constant_buffer);
+            
+                viewport.Width = (FLOAT)backbuffer_desc.Width;
+				viewport.Height = (FLOAT)backbuffer_desc.Height;
+                d3d11_set_viewport(&immediate_context, &viewport);
+            
+				d3d11_set_depth_stencil(&immediate_context, null, 0);
+                d3d11_set_render_target(&immediate_context, d3d11_state.back_buffer_as_rtv, null);
+				d3d11_set_topology(&immediate_context, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+            
+                ID3D11DeviceContext_Draw(d3d11_state.base_device_context, 4, 0);
+            
+                d3d11_set_ps_resources(&immediate_context, 1, 1, &null_srv);
+            }
+            d3d11_gpu_timer_zone(&d3d11_state, &gpu_timer, "gpu resolve");
+            d3d11_gpu_timer_end(&d3d11_state, &gpu_timer);
+            profile_end();
 #if 0
             D3D11_TEXTURE2D_DESC backbuffer_desc = { 0 };
             ID3D11Texture2D_GetDesc(d3d11_state.back_buffer, &backbuffer_desc);
@@ -1519,9 +2068,21 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
                                                    (ID3D11Resource *)d3d11_state.offscreen_back_buffer, 0, 
                                                    backbuffer_desc.Format);
 #endif
+            profile_begin("present");
 			IDXGISwapChain1_Present(d3d11_state.swap_chain, 1, 0);
-			r3d_buffer.count = 0;
+            // the flip model takes the back buffer off the pipeline
+            state_cache_forget(&immediate_context.cache, StateSlot_RenderTargets, 1);
+            state_cache_frame_end(&immediate_context.cache);
+            for (u32 worker = 0; worker < deferred_count; ++worker) {
+                state_cache_frame_end(&deferred_contexts[worker].cache);
+            }
+            profile_end();
+            
+            profile_end();
+            profile_frame_end();
 		}
+		
+		os_destroy_window(&os_window);
 	}
     
 	ExitProcess(0);
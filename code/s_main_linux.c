@@ -0,0 +1,445 @@
+// Headless Linux entry. Runs the CPU side of the frame (input, camera, instances, lights,
+// dirty-range packing and culling) plus the software rasterizer for a number of frames and
+// reports timings.
+//
+// usage: s_headless [frame_count] [extra_instance_count] [last_frame.ppm] [extra_light_count] [ssaa_filter]
+//                   [mesh.pack] [vertex_format] [trace.json] [frame_hz]
+//
+// With ssaa_filter (box, tent or lanczos) the scene is rendered at twice the window size and resolved
+// with downsample_reference, the golden output for the D3D11 downsample shaders. With mesh.pack,
+// written by s_mesh_tool, the two named cubes draw its first mesh and the scattered instances take
+// turns on all of them. With vertex_format (float, oct16 or oct8) meshes are drawn the way vs_main
+// decodes that format. "-" skips an argument. Every frame the visible instances are keyed, sorted
+// and batched as in s_batch.h, one draw per batch. The batches are also recorded, sorted and replayed
+// as render commands (s_render_command.h) onto null backends, a slice per worker as the D3D11
+// backend does with deferred contexts, which checks every draw the device would get and, binding
+// through a state cache (s_state_cache.h), that no bind it dropped was needed. Timings come
+// from the profiler zones, see s_profile.h; with trace.json every frame is captured and written out
+// as a Chrome trace. Frames are frame_hz apart, 60 by default, on a made-up clock rather than the
+// real one: the game steps at game_update_hz whatever frame_hz is, and runs replay the same steps
+// every time.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+
+#include "s_base.h"
+#include "s_os.h"
+#include "s_profile.h"
+#include "s_simd.h"
+#include "s_math.h"
+#include "s_job.h"
+#include "s_r3d.h"
+#include "s_cull.h"
+#include "s_light.h"
+#include "s_mesh.h"
+#include "s_mesh_lod.h"
+#include "s_mesh_pack.h"
+#include "s_batch.h"
+#include "s_frame_clock.h"
+#include "s_game.h"
+#include "s_state_cache.h"
+#include "s_render_command.h"
+#include "s_shader_cache.h"
+#include "s_shading_permutation.h"
+#include "s_dynamic_resolution.h"
+#include "s_downsample.h"
+#include "s_vertex_format.h"
+#include "s_soft_raster.h"
+
+#include "s_base.c"
+#include "s_os.c"
+#include "s_os_linux.c"
+#include "s_profile.c"
+#include "s_simd.c"
+#include "s_math.c"
+#include "s_job.c"
+#include "s_r3d.c"
+#include "s_cull.c"
+#include "s_light.c"
+#include "s_mesh.c"
+#include "s_mesh_lod.c"
+#include "s_mesh_pack.c"
+#include "s_batch.c"
+#include "s_frame_clock.c"
+#include "s_game.c"
+#include "s_state_cache.c"
+#include "s_render_command.c"
+#include "s_shader_cache.c"
+#include "s_shading_permutation.c"
+#include "s_dynamic_resolution.c"
+#include "s_downsample.c"
+#include "s_vertex_format.c"
+#include "s_soft_raster.c"
+
+// Walk forward, strafe while looking around, then fly up. Same every run.
+global OS_Input_Event headless_script[] = {
+    { 0, OSInput_Key_W, True, 0, 0 },
+    { 60, OSInput_Key_Count, False, 40, 0 },
+    { 120, OSInput_Key_W, False, 0, 0 },
+    { 120, OSInput_Key_D, True, 0, 0 },
+    { 150, OSInput_Key_Count, False, -80, 10 },
+    { 240, OSInput_Key_D, False, 0, 0 },
+    { 240, OSInput_Key_Space, True, 0, 0 },
+    { 300, OSInput_Key_Space, False, 0, 0 },
+};
+
+int
+main(int argc, char **argv) {
+    u64 frame_count = 600;
+    u64 extra_instance_count = 100000;
+    if (argc > 1) {
+        frame_count = strtoull(argv[1], null, 10);
+    }
+    if (argc > 2) {
+        extra_instance_count = strtoull(argv[2], null, 10);
+    }
+    char *image_path = ((argc > 3) && (strcmp(argv[3], "-") != 0)) ? argv[3] : null;
+    u32 extra_light_count = 256;
+    if (argc > 4) {
+        extra_light_count = (u32)strtoul(argv[4], null, 10);
+    }
+    u32 ssaa_filter = DownsampleFilter_Count;
+    if ((argc > 5) && (strcmp(argv[5], "-") != 0)) {
+        for (u32 filter = 0; filter < DownsampleFilter_Count; ++filter) {
+            if (strcmp(argv[5], downsample_filter_names[filter]) == 0) {
+                ssaa_filter = filter;
+            }
+        }
+        if (ssaa_filter == DownsampleFilter_Count) {
+            fprintf(stderr, "unknown ssaa_filter %s, expected box, tent or lanczos\n", argv[5]);
+            return(1);
+        }
+    }
+    b32 ssaa = ssaa_filter != DownsampleFilter_Count;
+    u32 ssaa_factor = ssaa ? 2 : 1;
+    char *trace_path = ((argc > 8) && (strcmp(argv[8], "-") != 0)) ? argv[8] : null;
+    u32 frame_hz = 60;
+    if (argc > 9) {
+        frame_hz = (u32)strtoul(argv[9], null, 10);
+        if (!frame_hz) {
+            fprintf(stderr, "frame_hz has to be at least 1\n");
+            return(1);
+        }
+    }
+
+    profile_init();
+
+    OS_Window os_window = os_create_window(str8("RTR"), 1280, 720);
+    OS_Input os_input = { 0 };
+    os_set_input_script(headless_script, array_count(headless_script));
+
+    Job_System job_system;
+    job_system_init(&job_system, os_cpu_count());
+
+    Game_State game;
+    game_init(&game);
+    Mesh_Pack mesh_pack = { 0 };
+    if ((argc > 6) && (strcmp(argv[6], "-") != 0)) {
+        if (!mesh_pack_open(&mesh_pack, str8_make(argv[6], strlen(argv[6]))) || !mesh_pack.mesh_count) {
+            fprintf(stderr, "couldn't open mesh pack %s\n", argv[6]);
+            return(1);
+        }
+        u64 lod_start = os_time_microseconds();
+        game_add_mesh_pack(&game, &mesh_pack);
+        printf("lod chains built in %llu us\n", (unsigned long long)(os_time_microseconds() - lod_start));
+    }
+    for (u32 mesh = 0; mesh < game.mesh_count; ++mesh) {
+        Mesh_LOD_Chain *lods = game.mesh_lods + mesh;
+        for (u32 level = 0; level < lods->level_count; ++level) {
+            printf("mesh %u lod %u: %u triangles, %u vertices, error %f\n", mesh, level, lods->index_count[level] / 3,
+                   lods->vertex_count[level], lods->error[level]);
+        }
+    }
+    Arena vertex_arena = { 0 };
+    if ((argc > 7) && (strcmp(argv[7], "-") != 0)) {
+        u32 vertex_format = vertex_format_from_name(argv[7]);
+        if (vertex_format == VertexFormat_Count) {
+            fprintf(stderr, "unknown vertex_format %s, expected float, oct16 or oct8\n", argv[7]);
+            return(1);
+        }
+        // the indices are shared, only the vertices go through the format; every mesh and level at
+        // once, as the D3D11 backend does
+        vertex_arena = arena_reserve((u64)game.geometry.vertex_count * sizeof(Mesh_Vertex) * 2 + 64);
+        Vertex_Stream stream = vertex_encode(&vertex_arena, &game.geometry, vertex_format);
+        Mesh_Vertex *decoded = arena_push_array(&vertex_arena, Mesh_Vertex, stream.vertex_count);
+        vertex_decode(&stream, decoded);
+        game.geometry.vertices = decoded;
+        Shader_Define *define = vertex_format_defines[vertex_format];
+        printf("vertex format %s (%s=%s): %u bytes/vertex, %llu bytes for %u vertices\n",
+               vertex_format_names[vertex_format], define->name, define->value, stream.stride,
+               (unsigned long long)stream.stride * stream.vertex_count, stream.vertex_count);
+    }
+    game_add_scatter(&game, extra_instance_count, 50.0f, 1);
+    game_add_light_scatter(&game, extra_light_count, 50.0f, 2);
+    R3D_Scene *scene = &game.scene;
+
+    // stands in for the GPU instance buffer so uploads cost what they would on a device
+    Arena gpu_arena = arena_reserve(scene->buffer.max_capacity * sizeof(R3D_Packed_Instance));
+    R3D_Packed_Instance *gpu_instances = (R3D_Packed_Instance *)gpu_arena.base;
+    u64 gpu_capacity = 0;
+
+    Soft_Renderer soft_renderer;
+    soft_init(&soft_renderer, job_system.worker_count);
+    Soft_Target target;
+    target.width = os_window.client_width * ssaa_factor;
+    target.height = os_window.client_height * ssaa_factor;
+    u64 target_pixel_count = (u64)target.width * target.height;
+    Arena target_arena = arena_reserve(target_pixel_count * (sizeof(f32) + sizeof(u32)) + kilobytes(4));
+    target.colour = ssaa ? arena_push_array(&target_arena, u32, target_pixel_count) : os_window.pixels;
+    target.depth = arena_push_array(&target_arena, f32, target_pixel_count);
+    
+    Downsample_Image ssaa_source = { target.colour, target.width, target.height, target.width };
+    Downsample_Image window_image = { os_window.pixels, os_window.client_width, os_window.client_height,
+        os_window.client_width };
+
+    Arena frame_arena = arena_reserve(gigabytes(1));
+    Render_Queue render_queue;
+    render_queue_init(&render_queue, job_system.worker_count);
+    Arena null_arena = arena_reserve(job_system.worker_count * (sizeof(Render_Backend) + sizeof(Render_Null_Backend)) +
+                                     kilobytes(4));
+    Render_Backend *null_backends = arena_push_array(&null_arena, Render_Backend, job_system.worker_count);
+    Render_Null_Backend *null_states = arena_push_array(&null_arena, Render_Null_Backend, job_system.worker_count);
+    for (u32 worker = 0; worker < job_system.worker_count; ++worker) {
+        render_null_backend_init(null_states + worker, GameShader_Count, game.geometry.index_count,
+                                 game.geometry.vertex_count, 0);
+        null_backends[worker] = render_null_backend(null_states + worker);
+    }
+    Render_Null_Backend null_total = { 0 };
+    u64 batch_total = 0;
+    u64 lod_instance_total[mesh_lod_max] = { 0 };
+    u64 resolve_fetches = 0;
+    u64 cluster_index_total = 0;
+    // frames per shading permutation the D3D11 backend would have picked
+    u64 permutation_frames[shading_permutation_count] = { 0 };
+    Cull_Stats cull_stats = { 0 };
+    u64 uploaded_bytes = 0;
+    u64 visible_total = 0;
+
+    // the made-up clock ticks once a frame, so frame_hz needn't divide anything evenly
+    Frame_Clock frame_clock;
+    frame_clock_init(&frame_clock, frame_hz, game_update_hz, game_max_steps_per_frame);
+
+    if (trace_path) {
+        profile_capture_begin();
+    }
+    u64 run_start = os_time_microseconds();
+    for (u64 frame = 0; frame < frame_count; ++frame) {
+        profile_begin("frame");
+        arena_clear(&frame_arena);
+        os_fill_events(&os_input, &os_window);
+
+        // the D3D11 backend renders at twice the client size
+        u32 step_count = frame_clock_advance(&frame_clock, 1);
+        game_update(&game, &os_input, step_count, frame_clock_alpha(&frame_clock),
+                    (f32)os_window.client_height / (f32)os_window.client_width);
+
+        if (scene->buffer.count > gpu_capacity) {
+            u64 grow = scene->buffer.capacity - gpu_capacity;
+            if (!arena_push(&gpu_arena, grow * sizeof(R3D_Packed_Instance), 1)) {
+                os_fatal_error(str8("Out of headless instance memory"));
+            }
+            gpu_capacity = scene->buffer.capacity;
+        }
+
+        profile_begin("pack");
+        for (u32 range_index = 0; range_index < scene->dirty.count; ++range_index) {
+            R3D_Range range = scene->dirty.ranges[range_index];
+            u64 range_count = range.one_past_last - range.first;
+            r3d_pack_instances_parallel(&job_system, gpu_instances + range.first, &scene->buffer, range.first, range_count);
+            uploaded_bytes += range_count * sizeof(R3D_Packed_Instance);
+        }
+        r3d_dirty_clear(&scene->dirty);
+        profile_end();
+
+        profile_begin("cull");
+        Frustum frustum = frustum_from_view_projection(game.view_projection);
+        u32 *visible_instances = arena_push_array(&frame_arena, u32, scene->buffer.count);
+        u64 visible_count = r3d_cull_parallel(&job_system, &frame_arena, &scene->buffer, &frustum, game.mesh_radius,
+                                              visible_instances, &cull_stats);
+        visible_count = r3d_scene_filter_alive(scene, visible_instances, visible_count);
+        visible_total += visible_count;
+        profile_end();
+
+        profile_begin("key, sort and batch");
+        Mesh_LOD_View lod_view = mesh_lod_view(game.view_projection, target.height, 1.0f);
+        u64 *keys = arena_push_array(&frame_arena, u64, visible_count);
+        batch_keys_parallel(&job_system, &scene->buffer, game.mesh_lods, &lod_view, visible_instances, visible_count, keys);
+        profile_begin("sort");
+        batch_sort_parallel(&job_system, &frame_arena, keys, visible_instances, visible_count);
+        profile_end();
+        u32 batch_count;
+        Batch *batches = batch_build(&frame_arena, keys, visible_count, &batch_count);
+        Soft_Draw *draws = arena_push_array(&frame_arena, Soft_Draw, batch_count);
+        Mesh *draw_meshes = arena_push_array(&frame_arena, Mesh, batch_count);
+        for (u32 batch_index = 0; batch_index < batch_count; ++batch_index) {
+            Batch *batch = batches + batch_index;
+            draw_meshes[batch_index] = game_mesh_level(&game, batch->mesh, batch->level);
+            draws[batch_index].mesh = draw_meshes + batch_index;
+            draws[batch_index].visible = visible_instances + batch->first;
+            draws[batch_index].visible_count = batch->count;
+            lod_instance_total[batch->level] += batch->count;
+        }
+        profile_end();
+        batch_total += batch_count;
+
+        profile_begin("record commands");
+        render_queue_reset(&render_queue);
+        render_record_batches_parallel(&job_system, &render_queue, &game, batches, batch_count);
+        profile_end();
+        profile_begin("sort commands");
+        u64 command_count;
+        Render_Command *commands = render_queue_sort(&render_queue, &job_system, &frame_arena, &command_count);
+        profile_end();
+        profile_begin("replay commands");
+        for (u32 worker = 0; worker < job_system.worker_count; ++worker) {
+            null_states[worker].instance_count = (u32)visible_count;
+        }
+        render_replay_parallel(&job_system, null_backends, job_system.worker_count, commands, command_count);
+        for (u32 worker = 0; worker < job_system.worker_count; ++worker) {
+            render_null_backend_frame_end(null_states + worker);
+        }
+        profile_end();
+
+        profile_begin("light clusters");
+        Light_Clusters clusters;
+        light_clusters_build(&clusters, &job_system, &frame_arena, &game.light_view, game.lights, game.light_count);
+        profile_end();
+        cluster_index_total += clusters.index_count;
+        ++permutation_frames[shading_permutation_select(&clusters)];
+        
+        // the D3D11 backend draws at up to 2x and downsamples; the CPU target is 1x unless ssaa_filter is given
+        profile_begin("soft render");
+        soft_target_clear(&target, v4f_make(0.0f, 0.0f, 0.0f, 1.0f), 1.0f);
+        soft_render(&soft_renderer, &job_system, &frame_arena, &target, draws, batch_count,
+                    &scene->buffer, &game.constants, &clusters);
+        profile_end();
+
+        if (ssaa) {
+            profile_begin("resolve");
+            resolve_fetches = downsample_reference(ssaa_filter, &ssaa_source, &window_image);
+            profile_end();
+        }
+
+        profile_end();
+        profile_frame_end();
+    }
+    u64 run_time = os_time_microseconds() - run_start;
+    profile_capture_end();
+
+    if (frame_count) {
+        printf("frames %llu, instances %llu, workers %u, avg frame %.1f us\n", (unsigned long long)frame_count,
+               (unsigned long long)scene->alive_count, job_system.worker_count, (f64)run_time / (f64)frame_count);
+        // per frame, summed over every worker for the zones jobs open
+        u32 zone_count;
+        Profile_Stats *zones = profile_stats(&frame_arena, &zone_count);
+        for (u32 zone = 0; zone < zone_count; ++zone) {
+            printf("%-20s us: p50 %9.1f, p99 %9.1f, max %9.1f\n", zones[zone].name, zones[zone].p50_us,
+                   zones[zone].p99_us, zones[zone].max_us);
+        }
+        printf("%llu steps at %u Hz over %llu frames at %u Hz, %llu dropped\n",
+               (unsigned long long)frame_clock.step_count, game_update_hz, (unsigned long long)frame_count, frame_hz,
+               (unsigned long long)frame_clock.dropped_steps);
+        printf("light clusters: %u lights, avg %.1f indices\n", game.light_count,
+               (f64)cluster_index_total / (f64)frame_count);
+        printf("soft render: %ux%u\n", target.width, target.height);
+        printf("visible avg %.1f, uploaded %llu bytes total\n", (f64)visible_total / (f64)frame_count,
+               (unsigned long long)uploaded_bytes);
+        printf("avg %.1f batches\n", (f64)batch_total / (f64)frame_count);
+        for (u32 worker = 0; worker < job_system.worker_count; ++worker) {
+            render_null_backend_add(&null_total, null_states + worker);
+        }
+        printf("commands: %llu draws over %llu slices, %llu shader and %llu instance base changes, %llu instances, "
+               "%llu errors\n", (unsigned long long)null_total.draws, (unsigned long long)null_total.slices,
+               (unsigned long long)null_total.shader_changes, (unsigned long long)null_total.instance_base_changes,
+               (unsigned long long)null_total.instances, (unsigned long long)null_total.errors);
+        printf("state cache: %llu binds made, %llu dropped as redundant\n",
+               (unsigned long long)null_total.state_issued, (unsigned long long)null_total.state_filtered);
+        for (u32 level = 0; level < mesh_lod_max; ++level) {
+            if (lod_instance_total[level]) {
+                printf("lod %u: avg %.1f instances\n", level, (f64)lod_instance_total[level] / (f64)frame_count);
+            }
+        }
+        for (u32 permutation = 0; permutation < shading_permutation_count; ++permutation) {
+            if (permutation_frames[permutation]) {
+                Shader_Define *defines = shading_permutations[permutation].defines;
+                printf("shading permutation %u (%s=%s %s=%s %s=%s): %llu frames\n", permutation,
+                       defines[0].name, defines[0].value, defines[1].name, defines[1].value,
+                       defines[2].name, defines[2].value, (unsigned long long)permutation_frames[permutation]);
+            }
+        }
+        
+        if (ssaa) {
+            Shader_Define *define = downsample_filter_defines[ssaa_filter];
+            printf("resolve %s, %s=%s, %ux%u -> %ux%u\n", downsample_filter_names[ssaa_filter], define->name,
+                   define->value, target.width, target.height, window_image.width, window_image.height);
+            
+            // the last frame again the way the shaders fetch it, against the reference
+            u64 window_pixel_count = (u64)window_image.width * window_image.height;
+            arena_clear(&frame_arena);
+            Downsample_Image shader_image = window_image;
+            shader_image.pixels = arena_push_array(&frame_arena, u32, window_pixel_count);
+            u64 shader_fetches = downsample_fetches(ssaa_filter, &ssaa_source, &shader_image);
+            u32 max_difference = 0;
+            for (u64 index = 0; index < window_pixel_count; ++index) {
+                for (u32 shift = 0; shift < 32; shift += 8) {
+                    s32 a = (s32)((window_image.pixels[index] >> shift) & 0xFF);
+                    s32 b = (s32)((shader_image.pixels[index] >> shift) & 0xFF);
+                    u32 difference = (u32)(a > b ? a - b : b - a);
+                    max_difference = difference > max_difference ? difference : max_difference;
+                }
+            }
+            printf("resolve fetches per pixel: reference %.1f, shader %.1f, max channel difference %u\n",
+                   (f64)resolve_fetches / (f64)window_pixel_count, (f64)shader_fetches / (f64)window_pixel_count,
+                   max_difference);
+        }
+    }
+
+    if (trace_path) {
+        arena_clear(&frame_arena);
+        if (profile_write_chrome_trace(&frame_arena, str8_make(trace_path, strlen(trace_path)))) {
+            printf("trace: %llu events written to %s\n", (unsigned long long)profiler.capture_count, trace_path);
+        } else {
+            fprintf(stderr, "couldn't write the trace to %s\n", trace_path);
+        }
+    }
+
+    if (image_path) {
+        // binary PPM: header, then RGB triples
+        u64 pixel_count = (u64)window_image.width * window_image.height;
+        char header[64];
+        int header_size = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", window_image.width, window_image.height);
+        arena_clear(&frame_arena);
+        u8 *image = arena_push_array(&frame_arena, u8, header_size + pixel_count * 3);
+        memory_copy(image, header, header_size);
+        u8 *rgb = image + header_size;
+        for (u64 index = 0; index < pixel_count; ++index) {
+            u32 pixel = window_image.pixels[index];
+            rgb[index * 3 + 0] = (u8)(pixel & 0xFF);
+            rgb[index * 3 + 1] = (u8)((pixel >> 8) & 0xFF);
+            rgb[index * 3 + 2] = (u8)((pixel >> 16) & 0xFF);
+        }
+        if (!os_write_entire_file(str8_make(image_path, strlen(image_path)), image, header_size + pixel_count * 3)) {
+            os_message_box(str8("Error"), str8("Failed to write the image"));
+        }
+    }
+
+    render_queue_release(&render_queue);
+    arena_release(&vertex_arena);
+    mesh_pack_close(&mesh_pack);
+    soft_release(&soft_renderer);
+    job_system_release(&job_system);
+    os_destroy_window(&os_window);
+    return(0);
+}
@@ -1,3 +1,63 @@
+// Lane paths are kept only where s_math_test.c's benchmark shows them winning: the v3f kernels and
+// the v4f ones other than add lose more to the set/store round trip than the one instruction saves,
+// so they stay scalar. A kernel with a lane path keeps its scalar body as <kernel>_scalar, which the
+// #else branch calls; that is the reference the lanes are checked against, and what S_SIMD_SCALAR
+// builds run. Newer kernels (batches, m44s) are written once against f32x4, whose scalar backend
+// is the reference for those.
+function f32x4
+v3f_to_f32x4(v3f a) {
+	f32x4 result = f32x4_set(a.x, a.y, a.z, 0.0f);
+	return(result);
+}
+
+function v3f
+f32x4_to_v3f(f32x4 a) {
+	f32 e[4];
+	f32x4_store(e, a);
+	v3f result = v3f_make(e[0], e[1], e[2]);
+	return(result);
+}
+
+function f32x4
+v4f_to_f32x4(v4f a) {
+	f32x4 result = f32x4_load(a.v);
+	return(result);
+}
+
+function v4f
+f32x4_to_v4f(f32x4 a) {
+	v4f result;
+	f32x4_store(result.v, a);
+	return(result);
+}
+
+// a.yzx * b.zxy - a.zxy * b.yzx, w stays 0
+function f32x4
+f32x4_cross3(f32x4 a, f32x4 b) {
+	f32x4 a_yzx = f32x4_swizzle(a, 1, 2, 0, 3);
+	f32x4 b_yzx = f32x4_swizzle(b, 1, 2, 0, 3);
+	f32x4 a_zxy = f32x4_swizzle(a, 2, 0, 1, 3);
+	f32x4 b_zxy = f32x4_swizzle(b, 2, 0, 1, 3);
+	f32x4 result = f32x4_sub(f32x4_mul(a_yzx, b_zxy), f32x4_mul(a_zxy, b_yzx));
+	return(result);
+}
+
+// Hamilton product with lanes laid out as (s, i, j, k)
+function f32x4
+f32x4_quat_mul(f32x4 a, f32x4 b) {
+	f32x4 result = f32x4_mul(f32x4_splat(a, 0), b);
+	result = f32x4_madd(f32x4_splat(a, 1),
+						f32x4_mul(f32x4_swizzle(b, 1, 0, 3, 2), f32x4_set(-1.0f, 1.0f, -1.0f, 1.0f)),
+						result);
+	result = f32x4_madd(f32x4_splat(a, 2),
+						f32x4_mul(f32x4_swizzle(b, 2, 3, 0, 1), f32x4_set(-1.0f, 1.0f, 1.0f, -1.0f)),
+						result);
+	result = f32x4_madd(f32x4_splat(a, 3),
+						f32x4_mul(f32x4_swizzle(b, 3, 2, 1, 0), f32x4_set(-1.0f, -1.0f, 1.0f, 1.0f)),
+						result);
+	return(result);
+}
+
 function f32
 radians(f32 x) {
 	f32 result = x * 0.01745329251f;
@@ -73,6 +133,52 @@ v4f_make(f32 x, f32 y, f32 z, f32 w) {
 	return(result);
 }
 
+function v4f
+v4f_add_scalar(v4f a, v4f b) {
+	v4f result;
+	result.x = a.x + b.x;
+	result.y = a.y + b.y;
+	result.z = a.z + b.z;
+	result.w = a.w + b.w;
+	return(result);
+}
+
+function v4f
+v4f_add(v4f a, v4f b) {
+#if defined(S_SIMD_ANY)
+	v4f result = f32x4_to_v4f(f32x4_add(v4f_to_f32x4(a), v4f_to_f32x4(b)));
+#else
+	v4f result = v4f_add_scalar(a, b);
+#endif
+	return(result);
+}
+
+function v4f
+v4f_sub(v4f a, v4f b) {
+	v4f result;
+	result.x = a.x - b.x;
+	result.y = a.y - b.y;
+	result.z = a.z - b.z;
+	result.w = a.w - b.w;
+	return(result);
+}
+
+function v4f
+v4f_scale(v4f a, f32 s) {
+	v4f result;
+	result.x = a.x * s;
+	result.y = a.y * s;
+	result.z = a.z * s;
+	result.w = a.w * s;
+	return(result);
+}
+
+function f32
+v4f_dot(v4f a, v4f b) {
+	f32 result = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	return(result);
+}
+
 function quat
 quat_make(f32 s, f32 i, f32 j, f32 k) {
 	quat result;
@@ -87,7 +193,7 @@ function quat
 quat_identity(void) {
     quat result;
     result.real = 1.0f;
-    result.i = result.j = result.j = 0.0f;
+    result.i = result.j = result.k = 0.0f;
     return(result);
 }
 
@@ -121,7 +227,7 @@ quat_mag(quat a) {
 }
 
 function void
-quat_norm(quat *a) {
+quat_norm_scalar(quat *a) {
 	f32 imag = 1.0f / quat_mag(*a);
 	a->x *= imag;
 	a->y *= imag;
@@ -129,8 +235,19 @@ quat_norm(quat *a) {
 	a->w *= imag;
 }
 
+function void
+quat_norm(quat *a) {
+#if defined(S_SIMD_ANY)
+	f32x4 q = v4f_to_f32x4(*a);
+	f32x4 imag = f32x4_div(f32x4_set1(1.0f), f32x4_sqrt(f32x4_hsum(f32x4_mul(q, q))));
+	*a = f32x4_to_v4f(f32x4_mul(q, imag));
+#else
+	quat_norm_scalar(a);
+#endif
+}
+
 function quat
-quat_mul(quat a, quat b) {
+quat_mul_scalar(quat a, quat b) {
 	quat result;
 	result.real = a.real * b.real - v3f_dot(a.imaginary, b.imaginary);
 
@@ -140,6 +257,16 @@ quat_mul(quat a, quat b) {
 	return(result);
 }
 
+function quat
+quat_mul(quat a, quat b) {
+#if defined(S_SIMD_ANY)
+	quat result = f32x4_to_v4f(f32x4_quat_mul(v4f_to_f32x4(a), v4f_to_f32x4(b)));
+#else
+	quat result = quat_mul_scalar(a, b);
+#endif
+	return(result);
+}
+
 function quat
 quat_inv(quat a) {
 	quat result;
@@ -161,11 +288,125 @@ quat_make_rotate_around_axis(f32 angle_radians, v3f axis) {
 	return(result);
 }
 
+// assumes unit quaternion!
+// q * p * q^-1 expands to p + 2s(v x p) + 2v x (v x p), with v the imaginary part.
+// That is two crosses instead of two full quat_muls.
+function v3f
+quat_rot_v3f_scalar(quat orient, v3f p) {
+	v3f t = v3f_scale(v3f_cross(orient.imaginary, p), 2.0f);
+	v3f result = v3f_add(v3f_add(p, v3f_scale(t, orient.real)), v3f_cross(orient.imaginary, t));
+	return(result);
+}
+
 function v3f
 quat_rot_v3f(quat orient, v3f p) {
-	quat quatp = quat_make(0.0f, p.x, p.y, p.z);
+#if defined(S_SIMD_ANY)
+	f32x4 imaginary = v3f_to_f32x4(orient.imaginary);
+	f32x4 point = v3f_to_f32x4(p);
+	f32x4 t = f32x4_cross3(imaginary, point);
+	t = f32x4_add(t, t);
+	f32x4 result = f32x4_madd(f32x4_set1(orient.real), t, point);
+	result = f32x4_add(result, f32x4_cross3(imaginary, t));
+	return f32x4_to_v3f(result);
+#else
+	return quat_rot_v3f_scalar(orient, p);
+#endif
+}
+
+function v3f_x4
+v3f_x4_make(f32x4 x, f32x4 y, f32x4 z) {
+	v3f_x4 result;
+	result.x = x;
+	result.y = y;
+	result.z = z;
+	return(result);
+}
+
+function quat_x4
+quat_x4_splat(quat q) {
+	quat_x4 result;
+	result.s = f32x4_set1(q.s);
+	result.i = f32x4_set1(q.i);
+	result.j = f32x4_set1(q.j);
+	result.k = f32x4_set1(q.k);
+	return(result);
+}
+
+// Same expansion as quat_rot_v3f, four points (or four orientations) per call.
+function v3f_x4
+quat_rot_v3f_x4(quat_x4 q, v3f_x4 p) {
+	f32x4 two = f32x4_set1(2.0f);
+	f32x4 tx = f32x4_mul(two, f32x4_sub(f32x4_mul(q.j, p.z), f32x4_mul(q.k, p.y)));
+	f32x4 ty = f32x4_mul(two, f32x4_sub(f32x4_mul(q.k, p.x), f32x4_mul(q.i, p.z)));
+	f32x4 tz = f32x4_mul(two, f32x4_sub(f32x4_mul(q.i, p.y), f32x4_mul(q.j, p.x)));
+	
+	v3f_x4 result;
+	result.x = f32x4_add(f32x4_madd(q.s, tx, p.x), f32x4_sub(f32x4_mul(q.j, tz), f32x4_mul(q.k, ty)));
+	result.y = f32x4_add(f32x4_madd(q.s, ty, p.y), f32x4_sub(f32x4_mul(q.k, tx), f32x4_mul(q.i, tz)));
+	result.z = f32x4_add(f32x4_madd(q.s, tz, p.z), f32x4_sub(f32x4_mul(q.i, ty), f32x4_mul(q.j, tx)));
+	return(result);
+}
+
+// Loads four packed v3fs (12 floats) into SoA lanes without reading past src[3].
+function v3f_x4
+v3f_x4_load_aos(v3f *src) {
+	f32x4 r0 = f32x4_load(src[0].v);
+	f32x4 r1 = f32x4_load(src[1].v);
+	f32x4 r2 = f32x4_load(src[2].v);
+	f32x4 r3 = f32x4_swizzle(f32x4_load(src[3].v - 1), 1, 2, 3, 0);
+	f32x4_transpose(r0, r1, r2, r3);
+	
+	v3f_x4 result = v3f_x4_make(r0, r1, r2);
+	return(result);
+}
+
+// Inverse of v3f_x4_load_aos, writes exactly 12 floats.
+function void
+v3f_x4_store_aos(v3f *dst, v3f_x4 a) {
+	f32x4 r0 = a.x;
+	f32x4 r1 = a.y;
+	f32x4 r2 = a.z;
+	f32x4 r3 = f32x4_zero();
+	f32x4_transpose(r0, r1, r2, r3);
+	
+	// the first three stores spill one float into the next point, which is rewritten right after
+	f32x4_store(dst[0].v, r0);
+	f32x4_store(dst[1].v, r1);
+	f32x4_store(dst[2].v, r2);
+	f32x4 lane0 = f32x4_set(-1.0f, 0.0f, 0.0f, 0.0f);
+	lane0 = f32x4_cmp_lt(lane0, f32x4_zero());
+	f32x4 last = f32x4_select(lane0, f32x4_splat(r2, 2), f32x4_swizzle(r3, 3, 0, 1, 2));
+	f32x4_store(dst[3].v - 1, last);
+}
+
+// out[i] = quat_rot_v3f(orient, in[i]) * scale + translate, the same order vs_main uses.
+// in and out may be the same buffer.
+function void
+v3f_transform_array(v3f *out, v3f *in, u64 count, quat orient, v3f scale, v3f translate) {
+	u64 index = 0;
+	
+	quat_x4 q = quat_x4_splat(orient);
+	v3f_x4 scale_x4 = v3f_x4_make(f32x4_set1(scale.x), f32x4_set1(scale.y), f32x4_set1(scale.z));
+	v3f_x4 translate_x4 = v3f_x4_make(f32x4_set1(translate.x), f32x4_set1(translate.y), f32x4_set1(translate.z));
+	for (; index + 4 <= count; index += 4) {
+		v3f_x4 p = quat_rot_v3f_x4(q, v3f_x4_load_aos(in + index));
+		p.x = f32x4_madd(p.x, scale_x4.x, translate_x4.x);
+		p.y = f32x4_madd(p.y, scale_x4.y, translate_x4.y);
+		p.z = f32x4_madd(p.z, scale_x4.z, translate_x4.z);
+		v3f_x4_store_aos(out + index, p);
+	}
 	
-	return quat_mul(quat_mul(orient, quatp), quat_conj(orient)).imaginary;
+	for (; index < count; ++index) {
+		v3f p = quat_rot_v3f(orient, in[index]);
+		out[index] = v3f_make(p.x * scale.x + translate.x,
+							  p.y * scale.y + translate.y,
+							  p.z * scale.z + translate.z);
+	}
+}
+
+function void
+quat_rot_v3f_array(v3f *out, v3f *in, u64 count, quat orient) {
+	v3f_transform_array(out, in, count, orient, v3f_make(1.0f, 1.0f, 1.0f), v3f_make(0.0f, 0.0f, 0.0f));
 }
 
 function m44
@@ -189,3 +430,234 @@ m44_perspective_lh_z01(f32 fov_radians, f32 aspect_h_over_w, f32 near_plane, f32
 
 	return(result);
 }
+
+// Row-vector convention, same as the constants we upload: result = v * m.
+function v4f
+m44_mul_v4f_scalar(m44 m, v4f v) {
+	v4f result;
+	for (u32 column = 0; column < 4; ++column) {
+		result.v[column] = v.x * m.m[0][column] + v.y * m.m[1][column] +
+			v.z * m.m[2][column] + v.w * m.m[3][column];
+	}
+	return(result);
+}
+
+function v4f
+m44_mul_v4f(m44 m, v4f v) {
+#if defined(S_SIMD_ANY)
+	f32x4 result = f32x4_mul(f32x4_set1(v.x), v4f_to_f32x4(m.rows[0]));
+	result = f32x4_madd(f32x4_set1(v.y), v4f_to_f32x4(m.rows[1]), result);
+	result = f32x4_madd(f32x4_set1(v.z), v4f_to_f32x4(m.rows[2]), result);
+	result = f32x4_madd(f32x4_set1(v.w), v4f_to_f32x4(m.rows[3]), result);
+	return f32x4_to_v4f(result);
+#else
+	return m44_mul_v4f_scalar(m, v);
+#endif
+}
+
+function m44
+m44_identity(void) {
+	m44 result = { 0 };
+	result.m[0][0] = 1.0f;
+	result.m[1][1] = 1.0f;
+	result.m[2][2] = 1.0f;
+	result.m[3][3] = 1.0f;
+	return(result);
+}
+
+// a then b: v * m44_mul(a, b) == (v * a) * b
+function m44
+m44_mul(m44 a, m44 b) {
+	f32x4 b0 = v4f_to_f32x4(b.rows[0]);
+	f32x4 b1 = v4f_to_f32x4(b.rows[1]);
+	f32x4 b2 = v4f_to_f32x4(b.rows[2]);
+	f32x4 b3 = v4f_to_f32x4(b.rows[3]);
+	
+	m44 result;
+	for (u32 row = 0; row < 4; ++row) {
+		f32x4 r = v4f_to_f32x4(a.rows[row]);
+		f32x4 sum = f32x4_mul(f32x4_splat(r, 0), b0);
+		sum = f32x4_madd(f32x4_splat(r, 1), b1, sum);
+		sum = f32x4_madd(f32x4_splat(r, 2), b2, sum);
+		sum = f32x4_madd(f32x4_splat(r, 3), b3, sum);
+		result.rows[row] = f32x4_to_v4f(sum);
+	}
+	return(result);
+}
+
+function m44
+m44_transpose(m44 a) {
+	f32x4 r0 = v4f_to_f32x4(a.rows[0]);
+	f32x4 r1 = v4f_to_f32x4(a.rows[1]);
+	f32x4 r2 = v4f_to_f32x4(a.rows[2]);
+	f32x4 r3 = v4f_to_f32x4(a.rows[3]);
+	f32x4_transpose(r0, r1, r2, r3);
+	
+	m44 result;
+	result.rows[0] = f32x4_to_v4f(r0);
+	result.rows[1] = f32x4_to_v4f(r1);
+	result.rows[2] = f32x4_to_v4f(r2);
+	result.rows[3] = f32x4_to_v4f(r3);
+	return(result);
+}
+
+// For rotation/scale/translation matrices (last column 0, 0, 0, 1).
+// With rows a, b, c the 3x3 inverse has columns (b x c, c x a, a x b) / (a . (b x c)).
+function m44
+m44_inverse_affine(m44 a) {
+	f32x4 r0 = v3f_to_f32x4(a.rows[0].xyz);
+	f32x4 r1 = v3f_to_f32x4(a.rows[1].xyz);
+	f32x4 r2 = v3f_to_f32x4(a.rows[2].xyz);
+	
+	f32x4 c0 = f32x4_cross3(r1, r2);
+	f32x4 c1 = f32x4_cross3(r2, r0);
+	f32x4 c2 = f32x4_cross3(r0, r1);
+	f32x4 inv_det = f32x4_div(f32x4_set1(1.0f), f32x4_hsum(f32x4_mul(r0, c0)));
+	c0 = f32x4_mul(c0, inv_det);
+	c1 = f32x4_mul(c1, inv_det);
+	c2 = f32x4_mul(c2, inv_det);
+	
+	f32x4 c3 = f32x4_zero();
+	f32x4_transpose(c0, c1, c2, c3);
+	
+	// translation row is -t * inverse(3x3)
+	f32x4 t = v4f_to_f32x4(a.rows[3]);
+	f32x4 inv_t = f32x4_mul(f32x4_splat(t, 0), c0);
+	inv_t = f32x4_madd(f32x4_splat(t, 1), c1, inv_t);
+	inv_t = f32x4_madd(f32x4_splat(t, 2), c2, inv_t);
+	inv_t = f32x4_sub(f32x4_set(0.0f, 0.0f, 0.0f, 1.0f), inv_t);
+	
+	m44 result;
+	result.rows[0] = f32x4_to_v4f(c0);
+	result.rows[1] = f32x4_to_v4f(c1);
+	result.rows[2] = f32x4_to_v4f(c2);
+	result.rows[3] = f32x4_to_v4f(inv_t);
+	return(result);
+}
+
+// 2x2 helpers for m44_inverse; a 2x2 matrix is packed row-major in one f32x4.
+function f32x4
+m22_mul(f32x4 a, f32x4 b) {
+	f32x4 result = f32x4_madd(a, f32x4_swizzle(b, 0, 3, 0, 3),
+							  f32x4_mul(f32x4_swizzle(a, 1, 0, 3, 2), f32x4_swizzle(b, 2, 1, 2, 1)));
+	return(result);
+}
+
+// adjugate(a) * b
+function f32x4
+m22_adj_mul(f32x4 a, f32x4 b) {
+	f32x4 result = f32x4_sub(f32x4_mul(f32x4_swizzle(a, 3, 3, 0, 0), b),
+							 f32x4_mul(f32x4_swizzle(a, 1, 1, 2, 2), f32x4_swizzle(b, 2, 3, 0, 1)));
+	return(result);
+}
+
+// a * adjugate(b)
+function f32x4
+m22_mul_adj(f32x4 a, f32x4 b) {
+	f32x4 result = f32x4_sub(f32x4_mul(a, f32x4_swizzle(b, 3, 0, 3, 0)),
+							 f32x4_mul(f32x4_swizzle(a, 1, 0, 3, 2), f32x4_swizzle(b, 2, 1, 2, 1)));
+	return(result);
+}
+
+// General inverse by 2x2 blocks [A B; C D], see
+// https://lxjk.github.io/2017/09/03/Fast-4x4-Matrix-Inverse-with-SSE-SIMD-Explained.html
+// Singular matrices give inf/nan, the caller is expected to know better.
+function m44
+m44_inverse(m44 a) {
+	f32x4 r0 = v4f_to_f32x4(a.rows[0]);
+	f32x4 r1 = v4f_to_f32x4(a.rows[1]);
+	f32x4 r2 = v4f_to_f32x4(a.rows[2]);
+	f32x4 r3 = v4f_to_f32x4(a.rows[3]);
+	
+	f32x4 block_a = f32x4_move_lh(r0, r1);
+	f32x4 block_b = f32x4_move_hl(r1, r0);
+	f32x4 block_c = f32x4_move_lh(r2, r3);
+	f32x4 block_d = f32x4_move_hl(r3, r2);
+	
+	// (|A|, |B|, |C|, |D|)
+	f32x4 det_sub = f32x4_sub(f32x4_mul(f32x4_shuffle(r0, r2, 0, 2, 0, 2), f32x4_shuffle(r1, r3, 1, 3, 1, 3)),
+							  f32x4_mul(f32x4_shuffle(r0, r2, 1, 3, 1, 3), f32x4_shuffle(r1, r3, 0, 2, 0, 2)));
+	f32x4 det_a = f32x4_splat(det_sub, 0);
+	f32x4 det_b = f32x4_splat(det_sub, 1);
+	f32x4 det_c = f32x4_splat(det_sub, 2);
+	f32x4 det_d = f32x4_splat(det_sub, 3);
+	
+	f32x4 d_c = m22_adj_mul(block_d, block_c);
+	f32x4 a_b = m22_adj_mul(block_a, block_b);
+	f32x4 x = f32x4_sub(f32x4_mul(det_d, block_a), m22_mul(block_b, d_c));
+	f32x4 w = f32x4_sub(f32x4_mul(det_a, block_d), m22_mul(block_c, a_b));
+	f32x4 y = f32x4_sub(f32x4_mul(det_b, block_c), m22_mul_adj(block_d, a_b));
+	f32x4 z = f32x4_sub(f32x4_mul(det_c, block_b), m22_mul_adj(block_a, d_c));
+	
+	// |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+	f32x4 det = f32x4_add(f32x4_mul(det_a, det_d), f32x4_mul(det_b, det_c));
+	det = f32x4_sub(det, f32x4_hsum(f32x4_mul(a_b, f32x4_swizzle(d_c, 0, 2, 1, 3))));
+	
+	f32x4 inv_det = f32x4_div(f32x4_set(1.0f, -1.0f, -1.0f, 1.0f), det);
+	x = f32x4_mul(x, inv_det);
+	y = f32x4_mul(y, inv_det);
+	z = f32x4_mul(z, inv_det);
+	w = f32x4_mul(w, inv_det);
+	
+	m44 result;
+	result.rows[0] = f32x4_to_v4f(f32x4_shuffle(x, y, 3, 1, 3, 1));
+	result.rows[1] = f32x4_to_v4f(f32x4_shuffle(x, y, 2, 0, 2, 0));
+	result.rows[2] = f32x4_to_v4f(f32x4_shuffle(z, w, 3, 1, 3, 1));
+	result.rows[3] = f32x4_to_v4f(f32x4_shuffle(z, w, 2, 0, 2, 0));
+	return(result);
+}
+
+// World to camera for a left-handed camera at eye looking at target.
+// Same basis WinMain used to build by hand: right = up x forward, up = forward x right.
+function m44
+m44_look_at_lh(v3f eye, v3f target, v3f up) {
+	v3f forward = v3f_sub(target, eye);
+	v3f_norm(&forward);
+	v3f right = v3f_cross(up, forward);
+	v3f_norm(&right);
+	v3f camera_up = v3f_cross(forward, right);
+	v3f_norm(&camera_up);
+	
+	m44 result;
+	result.rows[0] = v4f_make(right.x, camera_up.x, forward.x, 0.0f);
+	result.rows[1] = v4f_make(right.y, camera_up.y, forward.y, 0.0f);
+	result.rows[2] = v4f_make(right.z, camera_up.z, forward.z, 0.0f);
+	result.rows[3] = v4f_make(-v3f_dot(right, eye), -v3f_dot(camera_up, eye), -v3f_dot(forward, eye), 1.0f);
+	return(result);
+}
+
+// Rotate, then scale along world axes, then translate. This is the order vs_main places instances in,
+// so it is not a textbook TRS when the scale is non-uniform.
+function m44
+m44_from_quat_trs(v3f translate, quat orient, v3f scale) {
+	v3f axes[3] = {
+		quat_rot_v3f(orient, v3f_make(1.0f, 0.0f, 0.0f)),
+		quat_rot_v3f(orient, v3f_make(0.0f, 1.0f, 0.0f)),
+		quat_rot_v3f(orient, v3f_make(0.0f, 0.0f, 1.0f)),
+	};
+	
+	m44 result;
+	for (u32 row = 0; row < 3; ++row) {
+		result.rows[row] = v4f_make(axes[row].x * scale.x, axes[row].y * scale.y, axes[row].z * scale.z, 0.0f);
+	}
+	result.rows[3] = v4f_make(translate.x, translate.y, translate.z, 1.0f);
+	return(result);
+}
+
+// out[i] = in[i] * m. in and out may be the same buffer.
+function void
+m44_mul_v4f_array(m44 m, v4f *out, v4f *in, u64 count) {
+	f32x4 m0 = v4f_to_f32x4(m.rows[0]);
+	f32x4 m1 = v4f_to_f32x4(m.rows[1]);
+	f32x4 m2 = v4f_to_f32x4(m.rows[2]);
+	f32x4 m3 = v4f_to_f32x4(m.rows[3]);
+	
+	for (u64 index = 0; index < count; ++index) {
+		f32x4 v = f32x4_load(in[index].v);
+		f32x4 result = f32x4_mul(f32x4_splat(v, 0), m0);
+		result = f32x4_madd(f32x4_splat(v, 1), m1, result);
+		result = f32x4_madd(f32x4_splat(v, 2), m2, result);
+		result = f32x4_madd(f32x4_splat(v, 3), m3, result);
+		f32x4_store(out[index].v, result);
+	}
+}
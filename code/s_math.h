@@ -40,6 +40,15 @@ typedef union {
 
 typedef v4f quat;
 
+// Four v3fs / quats in SoA form, one per lane. Used by the batch kernels.
+typedef struct {
+	f32x4 x, y, z;
+} v3f_x4;
+
+typedef struct {
+	f32x4 s, i, j, k;
+} quat_x4;
+
 #define pi_f32 3.14159f
 #define pi_half_f32 (pi_f32*0.5f)
 function f32 radians(f32 x);
@@ -55,6 +64,12 @@ function void v3f_norm(v3f *a);
 
 // V4s
 function v4f v4f_make(f32 x, f32 y, f32 z, f32 w);
+function v4f v4f_add(v4f a, v4f b);
+function v4f v4f_sub(v4f a, v4f b);
+function v4f v4f_scale(v4f a, f32 s);
+function f32 v4f_dot(v4f a, v4f b);
+
+// Quats
 function quat quat_make(f32 s, f32 i, f32 j, f32 k);
 function quat quat_identity(void);
 function quat quat_add(quat a, quat b);
@@ -65,7 +80,37 @@ function void quat_norm(quat *a);
 function quat quat_mul(quat a, quat b);
 function quat quat_inv(quat a);
 function quat quat_make_rotate_around_axis(f32 angle_radians, v3f axis);
+function v3f quat_rot_v3f(quat orient, v3f p);
+
+// Batches
+function v3f_x4 v3f_x4_make(f32x4 x, f32x4 y, f32x4 z);
+function quat_x4 quat_x4_splat(quat q);
+function v3f_x4 quat_rot_v3f_x4(quat_x4 q, v3f_x4 p);
+function v3f_x4 v3f_x4_load_aos(v3f *src);
+function void v3f_x4_store_aos(v3f *dst, v3f_x4 a);
+function void v3f_transform_array(v3f *out, v3f *in, u64 count, quat orient, v3f scale, v3f translate);
+function void quat_rot_v3f_array(v3f *out, v3f *in, u64 count, quat orient);
+
+// M44s
+// Row-vector convention throughout (v' = v * m), matching how the constants are packed for HLSL.
+function m44 m44_identity(void);
+function m44 m44_mul(m44 a, m44 b);
+function m44 m44_transpose(m44 a);
+function m44 m44_inverse(m44 a);
+function m44 m44_inverse_affine(m44 a);
+function m44 m44_look_at_lh(v3f eye, v3f target, v3f up);
+function m44 m44_from_quat_trs(v3f translate, quat orient, v3f scale);
+function v4f m44_mul_v4f(m44 m, v4f v);
+function void m44_mul_v4f_array(m44 m, v4f *out, v4f *in, u64 count);
 
 function m44 m44_perspective_lh_z01(f32 fov_radians, f32 aspect_h_over_w, f32 near_plane, f32 far_plane);
 
+// Scalar references of the kernels above that have a lane path, what S_SIMD_SCALAR builds run and
+// what s_math_test.c checks the lanes against.
+function v4f v4f_add_scalar(v4f a, v4f b);
+function void quat_norm_scalar(quat *a);
+function quat quat_mul_scalar(quat a, quat b);
+function v3f quat_rot_v3f_scalar(quat orient, v3f p);
+function v4f m44_mul_v4f_scalar(m44 m, v4f v);
+
 #endif
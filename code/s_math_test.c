@@ -0,0 +1,408 @@
+// Every kernel with a lane path against its _scalar reference, and both timed.
+
+#define math_test_count 100000
+#define math_bench_count 4096
+#define math_bench_rounds 2000
+
+// Within max_ulps, or within a few epsilons of scale for results that cancel down near zero,
+// where ulps say nothing about how far off the inputs put them.
+function b32
+math_close(f32 lane, f32 scalar, u32 max_ulps, f32 scale) {
+    f32 difference = fabsf(lane - scalar);
+    b32 result = (test_ulps(lane, scalar) <= max_ulps) || (difference <= 4.0f * FLT_EPSILON * scale);
+    return(result);
+}
+
+// Highest ulps seen per kernel and how many results only passed on the absolute bound, reported so
+// a tolerance that's far too loose shows up.
+typedef struct {
+    char *name;
+    u32 max_ulps;
+    u32 worst;
+    u64 near_zero;
+    u64 failures;
+} Math_Kernel_Check;
+
+function void
+math_kernel_check(Math_Kernel_Check *check, f32 lane, f32 scalar, f32 scale) {
+    u32 ulps = test_ulps(lane, scalar);
+    check->worst = ulps > check->worst ? ulps : check->worst;
+    check->near_zero += ulps > check->max_ulps;
+    if (!math_close(lane, scalar, check->max_ulps, scale)) {
+        if (!check->failures) {
+            test_check(False, "%s: lane %.9g, scalar %.9g, %u ulps", check->name, lane, scalar, ulps);
+        }
+        ++check->failures;
+    }
+}
+
+function void
+math_kernel_report(Math_Kernel_Check *check) {
+    test_check(!check->failures, "%s: %llu of %u results out of tolerance", check->name,
+               (unsigned long long)check->failures, math_test_count);
+    printf("  %-16s worst %u ulps, %llu past %u near zero\n", check->name, check->worst,
+           (unsigned long long)(check->near_zero - check->failures), check->max_ulps);
+}
+
+function void
+test_math_kernels(void) {
+    Test_Random random = test_random_make(1);
+    // add, the rotation and the m44 row sums round the same operations in the same order, unless
+    // FMA fuses them, and then sums that cancel are only close in absolute terms; norm sums its
+    // squares in another order, and quat_mul's terms cancel
+    Math_Kernel_Check add = { "v4f_add", 0, 0, 0, 0 };
+    Math_Kernel_Check norm = { "quat_norm", 4, 0, 0, 0 };
+    Math_Kernel_Check mul = { "quat_mul", 4, 0, 0, 0 };
+    Math_Kernel_Check rot = { "quat_rot_v3f", 2, 0, 0, 0 };
+    Math_Kernel_Check transform = { "m44_mul_v4f", 2, 0, 0, 0 };
+#if !defined(S_SIMD_FMA)
+    rot.max_ulps = 0;
+    transform.max_ulps = 0;
+#endif
+
+    for (u32 index = 0; index < math_test_count; ++index) {
+        v4f a = test_random_v4f(&random, -100.0f, 100.0f);
+        v4f b = test_random_v4f(&random, -100.0f, 100.0f);
+        v4f lane = v4f_add(a, b);
+        v4f scalar = v4f_add_scalar(a, b);
+        for (u32 axis = 0; axis < 4; ++axis) {
+            math_kernel_check(&add, lane.v[axis], scalar.v[axis], 0.0f);
+        }
+
+        lane = a;
+        scalar = a;
+        quat_norm(&lane);
+        quat_norm_scalar(&scalar);
+        for (u32 axis = 0; axis < 4; ++axis) {
+            math_kernel_check(&norm, lane.v[axis], scalar.v[axis], 0.0f);
+        }
+
+        quat qa = test_random_quat(&random);
+        quat qb = test_random_quat(&random);
+        lane = quat_mul(qa, qb);
+        scalar = quat_mul_scalar(qa, qb);
+        for (u32 axis = 0; axis < 4; ++axis) {
+            math_kernel_check(&mul, lane.v[axis], scalar.v[axis], 1.0f);
+        }
+
+        v3f p = test_random_v3f(&random, -100.0f, 100.0f);
+        v3f lane3 = quat_rot_v3f(qa, p);
+        v3f scalar3 = quat_rot_v3f_scalar(qa, p);
+        for (u32 axis = 0; axis < 3; ++axis) {
+            math_kernel_check(&rot, lane3.v[axis], scalar3.v[axis], sqrtf(v3f_dot(p, p)));
+        }
+
+        m44 m;
+        for (u32 row = 0; row < 4; ++row) {
+            m.rows[row] = test_random_v4f(&random, -4.0f, 4.0f);
+        }
+        lane = m44_mul_v4f(m, a);
+        scalar = m44_mul_v4f_scalar(m, a);
+        for (u32 axis = 0; axis < 4; ++axis) {
+            math_kernel_check(&transform, lane.v[axis], scalar.v[axis], 16.0f * sqrtf(v4f_dot(a, a)));
+        }
+    }
+
+    Math_Kernel_Check *checks[] = { &add, &norm, &mul, &rot, &transform };
+    for (u32 check = 0; check < array_count(checks); ++check) {
+        math_kernel_report(checks[check]);
+    }
+}
+
+// v3f_transform_array against one quat_rot_v3f per point, over a count that leaves a tail.
+function void
+test_math_transform_array(void) {
+    Test_Random random = test_random_make(3);
+    u64 count = 1027;
+    v3f *in = (v3f *)malloc(count * sizeof(v3f));
+    v3f *out = (v3f *)malloc(count * sizeof(v3f));
+    for (u64 index = 0; index < count; ++index) {
+        in[index] = test_random_v3f(&random, -10.0f, 10.0f);
+    }
+    quat orient = test_random_quat(&random);
+    v3f scale = test_random_v3f(&random, 0.1f, 4.0f);
+    v3f translate = test_random_v3f(&random, -100.0f, 100.0f);
+
+    v3f_transform_array(out, in, count, orient, scale, translate);
+    f32 worst = 0.0f;
+    for (u64 index = 0; index < count; ++index) {
+        v3f expected = quat_rot_v3f(orient, in[index]);
+        for (u32 axis = 0; axis < 3; ++axis) {
+            f32 difference = fabsf(out[index].v[axis] - (expected.v[axis] * scale.v[axis] + translate.v[axis]));
+            worst = difference > worst ? difference : worst;
+        }
+    }
+    // |p| * scale + |translate| is at most ~250, a few of its ulps
+    test_check(worst <= 1e-4f, "v3f_transform_array: off the per-point loop by %g", worst);
+
+    // in place
+    v3f_transform_array(in, in, count, orient, scale, translate);
+    test_check(memory_compare(in, out, count * sizeof(v3f)) == 0, "v3f_transform_array: in place differs");
+    free(in);
+    free(out);
+}
+
+// Gauss-Jordan with partial pivoting in double, the reference the f32 inverses are held to.
+function b32
+math_inverse_f64(f64 out[4][4], m44 m) {
+    f64 a[4][8];
+    for (u32 row = 0; row < 4; ++row) {
+        for (u32 column = 0; column < 4; ++column) {
+            a[row][column] = m.m[row][column];
+            a[row][column + 4] = row == column ? 1.0 : 0.0;
+        }
+    }
+    for (u32 column = 0; column < 4; ++column) {
+        u32 pivot = column;
+        for (u32 row = column + 1; row < 4; ++row) {
+            if (fabs(a[row][column]) > fabs(a[pivot][column])) {
+                pivot = row;
+            }
+        }
+        if (a[pivot][column] == 0.0) {
+            return(False);
+        }
+        for (u32 k = 0; k < 8; ++k) {
+            f64 t = a[column][k];
+            a[column][k] = a[pivot][k];
+            a[pivot][k] = t;
+        }
+        f64 inv_pivot = 1.0 / a[column][column];
+        for (u32 k = 0; k < 8; ++k) {
+            a[column][k] *= inv_pivot;
+        }
+        for (u32 row = 0; row < 4; ++row) {
+            if (row != column) {
+                f64 factor = a[row][column];
+                for (u32 k = 0; k < 8; ++k) {
+                    a[row][k] -= factor * a[column][k];
+                }
+            }
+        }
+    }
+    for (u32 row = 0; row < 4; ++row) {
+        for (u32 column = 0; column < 4; ++column) {
+            out[row][column] = a[row][column + 4];
+        }
+    }
+    return(True);
+}
+
+// Largest absolute row sum, the infinity norm.
+function f64
+math_norm_f64(f64 m[4][4]) {
+    f64 result = 0.0;
+    for (u32 row = 0; row < 4; ++row) {
+        f64 sum = 0.0;
+        for (u32 column = 0; column < 4; ++column) {
+            sum += fabs(m[row][column]);
+        }
+        result = sum > result ? sum : result;
+    }
+    return(result);
+}
+
+// Relative error of an f32 inverse against the double one, in units of the condition number times
+// f32 epsilon: an inverse that's as good as the input allows stays a small constant whatever the
+// matrix.
+function f64
+math_inverse_error(m44 m, m44 inverse) {
+    f64 reference[4][4];
+    f64 m_f64[4][4];
+    f64 result = 1e30;
+    if (math_inverse_f64(reference, m)) {
+        f64 error = 0.0;
+        for (u32 row = 0; row < 4; ++row) {
+            for (u32 column = 0; column < 4; ++column) {
+                m_f64[row][column] = m.m[row][column];
+                f64 difference = fabs((f64)inverse.m[row][column] - reference[row][column]);
+                error = difference > error ? difference : error;
+            }
+        }
+        f64 reference_norm = math_norm_f64(reference);
+        f64 condition = math_norm_f64(m_f64) * reference_norm;
+        result = error / (reference_norm * condition * FLT_EPSILON);
+    }
+    return(result);
+}
+
+function m44
+math_random_affine(Test_Random *random) {
+    m44 result = m44_from_quat_trs(test_random_v3f(random, -100.0f, 100.0f), test_random_quat(random),
+                                   test_random_v3f(random, 0.05f, 20.0f));
+    return(result);
+}
+
+function void
+test_math_matrices(void) {
+    Test_Random random = test_random_make(6);
+    f64 worst_inverse = 0.0;
+    f64 worst_affine = 0.0;
+    f64 worst_product = 0.0;
+    b32 transpose_exact = True;
+    b32 in_place_same = True;
+    u32 matrix_count = 20000;
+    for (u32 index = 0; index < matrix_count; ++index) {
+        // a general matrix, and the kinds the renderer inverts: camera * projection and world
+        m44 m;
+        for (u32 row = 0; row < 4; ++row) {
+            m.rows[row] = test_random_v4f(&random, -10.0f, 10.0f);
+        }
+        m44 camera = m44_look_at_lh(test_random_v3f(&random, -50.0f, 50.0f), test_random_v3f(&random, -1.0f, 1.0f),
+                                    v3f_make(0.0f, 1.0f, 0.0f));
+        m44 projection = m44_perspective_lh_z01(radians(test_random_f32(&random, 30.0f, 100.0f)),
+                                                test_random_f32(&random, 0.5f, 2.0f), 0.1f, 1000.0f);
+        m44 view_projection = m44_mul(camera, projection);
+        m44 affine = math_random_affine(&random);
+
+        m44 general[] = { m, view_projection, affine };
+        for (u32 which = 0; which < array_count(general); ++which) {
+            f64 error = math_inverse_error(general[which], m44_inverse(general[which]));
+            worst_inverse = error > worst_inverse ? error : worst_inverse;
+        }
+        f64 error = math_inverse_error(affine, m44_inverse_affine(affine));
+        worst_affine = error > worst_affine ? error : worst_affine;
+        error = math_inverse_error(camera, m44_inverse_affine(camera));
+        worst_affine = error > worst_affine ? error : worst_affine;
+
+        m44 transposed = m44_transpose(m);
+        for (u32 row = 0; row < 4; ++row) {
+            for (u32 column = 0; column < 4; ++column) {
+                transpose_exact = transpose_exact && (transposed.m[row][column] == m.m[column][row]);
+            }
+        }
+
+        // m44_mul_v4f_array against the double product, relative to the sum of the magnitudes it
+        // rounds, over a count with in-place use
+        v4f points[7];
+        v4f out[7];
+        for (u32 point = 0; point < array_count(points); ++point) {
+            points[point] = test_random_v4f(&random, -100.0f, 100.0f);
+        }
+        m44_mul_v4f_array(m, out, points, array_count(points));
+        for (u32 point = 0; point < array_count(points); ++point) {
+            for (u32 column = 0; column < 4; ++column) {
+                f64 expected = 0.0;
+                f64 magnitude = 0.0;
+                for (u32 k = 0; k < 4; ++k) {
+                    expected += (f64)points[point].v[k] * (f64)m.m[k][column];
+                    magnitude += fabs((f64)points[point].v[k] * (f64)m.m[k][column]);
+                }
+                error = fabs((f64)out[point].v[column] - expected) / (magnitude * FLT_EPSILON);
+                worst_product = error > worst_product ? error : worst_product;
+            }
+        }
+        m44_mul_v4f_array(m, points, points, array_count(points));
+        in_place_same = in_place_same && (memory_compare(points, out, sizeof(out)) == 0);
+    }
+
+    test_check(transpose_exact, "m44_transpose: not an exact transpose");
+    test_check(in_place_same, "m44_mul_v4f_array: in place differs");
+    // four roundings into the sum
+    test_check(worst_product <= 4.0, "m44_mul_v4f_array: %g eps of the magnitudes off", worst_product);
+    // measured about 0.25 and 0.15, the bound leaves room for other compilers' contractions
+    test_check(worst_inverse <= 8.0, "m44_inverse: %g cond * eps off", worst_inverse);
+    test_check(worst_affine <= 8.0, "m44_inverse_affine: %g cond * eps off", worst_affine);
+    printf("  inverse %.2f, inverse_affine %.2f cond * eps, mul_v4f_array %.2f eps off at worst\n",
+           worst_inverse, worst_affine, worst_product);
+}
+
+function void
+test_math(void) {
+    test_math_kernels();
+    test_math_transform_array();
+    test_math_matrices();
+}
+
+// out[i] = kernel(a[i], b[i]) over math_bench_count inputs, math_bench_rounds times, so the
+// inputs stay in L1 and what's timed is the kernel and the loop around it.
+#define math_bench_binary(name, out, kernel, a, b) do {\
+        u64 _begin = os_time_ticks();\
+        for (u32 _round = 0; _round < math_bench_rounds; ++_round) {\
+            for (u32 _index = 0; _index < math_bench_count; ++_index) {\
+                (out)[_index] = kernel((a)[_index], (b)[_index]);\
+            }\
+            math_bench_sink += *(f32 *)((out) + (_round % math_bench_count));\
+        }\
+        bench_report(name, (u64)math_bench_rounds * math_bench_count, os_time_ticks() - _begin);\
+    } while (0)
+
+#define math_bench_unary(name, type, kernel, in, scratch) do {\
+        u64 _begin = os_time_ticks();\
+        for (u32 _round = 0; _round < math_bench_rounds; ++_round) {\
+            memory_copy((scratch), (in), math_bench_count * sizeof(type));\
+            for (u32 _index = 0; _index < math_bench_count; ++_index) {\
+                kernel((scratch) + _index);\
+            }\
+            math_bench_sink += *(f32 *)((scratch) + (_round % math_bench_count));\
+        }\
+        bench_report(name, (u64)math_bench_rounds * math_bench_count, os_time_ticks() - _begin);\
+    } while (0)
+
+// keeps the results alive
+global volatile f32 math_bench_sink;
+
+function void
+bench_math(void) {
+    Test_Random random = test_random_make(2);
+    v3f *points = (v3f *)malloc(math_bench_count * sizeof(v3f));
+    v3f *points_out = (v3f *)malloc(math_bench_count * sizeof(v3f));
+    v4f *a = (v4f *)malloc(math_bench_count * sizeof(v4f));
+    v4f *b = (v4f *)malloc(math_bench_count * sizeof(v4f));
+    v4f *out = (v4f *)malloc(math_bench_count * sizeof(v4f));
+    m44 *matrices = (m44 *)malloc(math_bench_count * sizeof(m44));
+    for (u32 index = 0; index < math_bench_count; ++index) {
+        points[index] = test_random_v3f(&random, -100.0f, 100.0f);
+        a[index] = test_random_quat(&random);
+        b[index] = test_random_quat(&random);
+        for (u32 row = 0; row < 4; ++row) {
+            matrices[index].rows[row] = test_random_v4f(&random, -4.0f, 4.0f);
+        }
+    }
+
+    math_bench_binary("v4f_add lane", out, v4f_add, a, b);
+    math_bench_binary("v4f_add scalar", out, v4f_add_scalar, a, b);
+    math_bench_unary("quat_norm lane", quat, quat_norm, a, out);
+    math_bench_unary("quat_norm scalar", quat, quat_norm_scalar, a, out);
+    math_bench_binary("quat_mul lane", out, quat_mul, a, b);
+    math_bench_binary("quat_mul scalar", out, quat_mul_scalar, a, b);
+    math_bench_binary("quat_rot_v3f lane", points_out, quat_rot_v3f, a, points);
+    math_bench_binary("quat_rot_v3f scalar", points_out, quat_rot_v3f_scalar, a, points);
+    math_bench_binary("m44_mul_v4f lane", out, m44_mul_v4f, matrices, a);
+    math_bench_binary("m44_mul_v4f scalar", out, m44_mul_v4f_scalar, matrices, a);
+
+    free(points);
+    free(points_out);
+
+    // v3f_transform_array against the per-point loop it replaces, on a million points
+    u64 transform_count = 1 << 20;
+    v3f *in = (v3f *)malloc(transform_count * sizeof(v3f));
+    v3f *transformed = (v3f *)malloc(transform_count * sizeof(v3f));
+    for (u64 index = 0; index < transform_count; ++index) {
+        in[index] = test_random_v3f(&random, -10.0f, 10.0f);
+    }
+    quat orient = test_random_quat(&random);
+    v3f scale = v3f_make(2.0f, 3.0f, 4.0f);
+    v3f translate = v3f_make(1.0f, -1.0f, 0.5f);
+    for (u32 round = 0; round < 4; ++round) {
+        u64 begin = os_time_ticks();
+        v3f_transform_array(transformed, in, transform_count, orient, scale, translate);
+        bench_report("v3f_transform_array", transform_count, os_time_ticks() - begin);
+
+        begin = os_time_ticks();
+        for (u64 index = 0; index < transform_count; ++index) {
+            v3f p = quat_rot_v3f(orient, in[index]);
+            transformed[index] = v3f_make(p.x * scale.x + translate.x, p.y * scale.y + translate.y,
+                                          p.z * scale.z + translate.z);
+        }
+        bench_report("quat_rot_v3f per point", transform_count, os_time_ticks() - begin);
+    }
+    math_bench_sink += transformed[transform_count / 2].x;
+    free(in);
+    free(transformed);
+
+    free(a);
+    free(b);
+    free(out);
+    free(matrices);
+}
@@ -0,0 +1,465 @@
+function u32
+mesh_hash_vertex(Mesh_Vertex *vertex) {
+    // FNV-1a over the bits, welding is by exact equality
+    u8 *bytes = (u8 *)vertex;
+    u32 result = 2166136261u;
+    for (u32 index = 0; index < sizeof(Mesh_Vertex); ++index) {
+        result = (result ^ bytes[index]) * 16777619u;
+    }
+    return(result);
+}
+
+function Mesh
+mesh_weld(Arena *arena, Arena *scratch, Mesh_Vertex *soup, u32 soup_count) {
+    u64 scratch_pos = scratch->pos;
+    Mesh result = { 0 };
+    soup_count -= soup_count % 3;
+
+    // open addressing, at most half full
+    u32 table_size = 16;
+    while (table_size < soup_count * 2) {
+        table_size <<= 1;
+    }
+    u32 *table = arena_push_array(scratch, u32, table_size);
+    memset(table, 0xFF, table_size * sizeof(u32));
+    u32 *remap = arena_push_array(scratch, u32, soup_count);
+    // the first soup vertex of every unique one
+    u32 *first = arena_push_array(scratch, u32, soup_count);
+
+    for (u32 index = 0; index < soup_count; ++index) {
+        u32 slot = mesh_hash_vertex(soup + index) & (table_size - 1);
+        while ((table[slot] != ~0u) &&
+               (memory_compare(soup + first[table[slot]], soup + index, sizeof(Mesh_Vertex)) != 0)) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (table[slot] == ~0u) {
+            table[slot] = result.vertex_count;
+            first[result.vertex_count++] = index;
+        }
+        remap[index] = table[slot];
+    }
+
+    result.vertices = arena_push_array(arena, Mesh_Vertex, result.vertex_count);
+    result.indices = arena_push_array(arena, u32, soup_count);
+    result.index_count = soup_count;
+    f32 radius_sq = 0.0f;
+    for (u32 vertex = 0; vertex < result.vertex_count; ++vertex) {
+        result.vertices[vertex] = soup[first[vertex]];
+        f32 distance_sq = v3f_dot(result.vertices[vertex].p, result.vertices[vertex].p);
+        radius_sq = distance_sq > radius_sq ? distance_sq : radius_sq;
+    }
+    result.radius = sqrtf(radius_sq);
+    memory_copy(result.indices, remap, soup_count * sizeof(u32));
+
+    arena_pop_to(scratch, scratch_pos);
+    return(result);
+}
+
+//
+// Forsyth
+//
+
+// Per vertex, the triangles still to be emitted are adjacency[offset, offset + live).
+typedef struct {
+    u32 *offset;
+    u32 *live;
+    u32 *adjacency;
+} Mesh_Adjacency;
+
+function Mesh_Adjacency
+mesh_adjacency(Arena *scratch, u32 *indices, u32 index_count, u32 vertex_count) {
+    Mesh_Adjacency result;
+    result.offset = arena_push_array(scratch, u32, vertex_count);
+    result.live = arena_push_array(scratch, u32, vertex_count);
+    result.adjacency = arena_push_array(scratch, u32, index_count);
+
+    for (u32 index = 0; index < index_count; ++index) {
+        ++result.live[indices[index]];
+    }
+    u32 sum = 0;
+    for (u32 vertex = 0; vertex < vertex_count; ++vertex) {
+        result.offset[vertex] = sum;
+        sum += result.live[vertex];
+        result.live[vertex] = 0;
+    }
+    for (u32 index = 0; index < index_count; ++index) {
+        u32 vertex = indices[index];
+        result.adjacency[result.offset[vertex] + result.live[vertex]++] = index / 3;
+    }
+    return(result);
+}
+
+#define mesh_forsyth_valence_max 32
+
+typedef struct {
+    f32 position[mesh_forsyth_cache_size + 1];
+    f32 valence[mesh_forsyth_valence_max];
+} Mesh_Forsyth_Scores;
+
+// The constants from the paper, a vertex's score by cache position (the last slot being "not
+// cached") and by how many triangles it still has.
+function void
+mesh_forsyth_scores(Mesh_Forsyth_Scores *scores) {
+    for (u32 position = 0; position <= mesh_forsyth_cache_size; ++position) {
+        f32 score = 0.0f;
+        if (position < 3) {
+            // the last triangle's vertices, deliberately below the next ones so strips don't win
+            score = 0.75f;
+        } else if (position < mesh_forsyth_cache_size) {
+            f32 scale = 1.0f / (f32)(mesh_forsyth_cache_size - 3);
+            score = powf(1.0f - (f32)(position - 3) * scale, 1.5f);
+        }
+        scores->position[position] = score;
+    }
+    scores->valence[0] = 0.0f;
+    for (u32 valence = 1; valence < mesh_forsyth_valence_max; ++valence) {
+        scores->valence[valence] = 2.0f / sqrtf((f32)valence);
+    }
+}
+
+function f32
+mesh_forsyth_vertex_score(Mesh_Forsyth_Scores *scores, u32 cache_position, u32 live) {
+    f32 result = -1.0f;
+    if (live) {
+        u32 valence = live < mesh_forsyth_valence_max ? live : mesh_forsyth_valence_max - 1;
+        result = scores->position[cache_position] + scores->valence[valence];
+    }
+    return(result);
+}
+
+function void
+mesh_optimize_vertex_cache(Arena *scratch, u32 *indices, u32 index_count, u32 vertex_count) {
+    u64 scratch_pos = scratch->pos;
+    u32 triangle_count = index_count / 3;
+    Mesh_Forsyth_Scores scores;
+    mesh_forsyth_scores(&scores);
+    Mesh_Adjacency adjacency = mesh_adjacency(scratch, indices, triangle_count * 3, vertex_count);
+
+    u32 *cache_position = arena_push_array(scratch, u32, vertex_count);
+    f32 *vertex_score = arena_push_array(scratch, f32, vertex_count);
+    u8 *emitted = arena_push_array(scratch, u8, triangle_count);
+    u32 *output = arena_push_array(scratch, u32, triangle_count * 3);
+
+    for (u32 vertex = 0; vertex < vertex_count; ++vertex) {
+        cache_position[vertex] = mesh_forsyth_cache_size;
+        vertex_score[vertex] = mesh_forsyth_vertex_score(&scores, mesh_forsyth_cache_size, adjacency.live[vertex]);
+    }
+    u32 best = ~0u;
+    f32 best_score = -1.0f;
+    for (u32 triangle = 0; triangle < triangle_count; ++triangle) {
+        u32 *corners = indices + triangle * 3;
+        f32 score = vertex_score[corners[0]] + vertex_score[corners[1]] + vertex_score[corners[2]];
+        if (score > best_score) {
+            best_score = score;
+            best = triangle;
+        }
+    }
+
+    // room for the whole cache plus the 3 vertices pushed in front of it
+    u32 cache[mesh_forsyth_cache_size + 3];
+    u32 cache_count = 0;
+    u32 cursor = 0;
+    for (u32 output_triangle = 0; output_triangle < triangle_count; ++output_triangle) {
+        if (best == ~0u) {
+            // nothing around the cache is left, continue with the first triangle not emitted yet
+            while (emitted[cursor]) {
+                ++cursor;
+            }
+            best = cursor;
+        }
+
+        u32 *corners = indices + best * 3;
+        memory_copy(output + output_triangle * 3, corners, 3 * sizeof(u32));
+        emitted[best] = 1;
+
+        u32 new_cache[mesh_forsyth_cache_size + 3];
+        u32 new_count = 0;
+        for (u32 corner = 0; corner < 3; ++corner) {
+            u32 vertex = corners[corner];
+            u32 *triangles = adjacency.adjacency + adjacency.offset[vertex];
+            u32 live = adjacency.live[vertex];
+            for (u32 index = 0; index < live; ++index) {
+                if (triangles[index] == best) {
+                    triangles[index] = triangles[live - 1];
+                    triangles[live - 1] = best;
+                    break;
+                }
+            }
+            --adjacency.live[vertex];
+            // degenerate triangles name a vertex twice
+            b32 duplicate = False;
+            for (u32 index = 0; index < new_count; ++index) {
+                duplicate |= new_cache[index] == vertex;
+            }
+            if (!duplicate) {
+                new_cache[new_count++] = vertex;
+            }
+        }
+        for (u32 index = 0; index < cache_count; ++index) {
+            u32 vertex = cache[index];
+            if ((vertex != corners[0]) && (vertex != corners[1]) && (vertex != corners[2])) {
+                new_cache[new_count++] = vertex;
+            }
+        }
+
+        // everything that fell out of the cache loses its position score
+        for (u32 index = mesh_forsyth_cache_size; index < new_count; ++index) {
+            u32 vertex = new_cache[index];
+            cache_position[vertex] = mesh_forsyth_cache_size;
+            vertex_score[vertex] = mesh_forsyth_vertex_score(&scores, mesh_forsyth_cache_size, adjacency.live[vertex]);
+        }
+        cache_count = new_count < mesh_forsyth_cache_size ? new_count : mesh_forsyth_cache_size;
+        for (u32 index = 0; index < cache_count; ++index) {
+            u32 vertex = new_cache[index];
+            cache[index] = vertex;
+            cache_position[vertex] = index;
+            vertex_score[vertex] = mesh_forsyth_vertex_score(&scores, index, adjacency.live[vertex]);
+        }
+
+        // only triangles touching the cache changed, the best next one is among them
+        best = ~0u;
+        best_score = -1.0f;
+        for (u32 index = 0; index < cache_count; ++index) {
+            u32 vertex = cache[index];
+            u32 *triangles = adjacency.adjacency + adjacency.offset[vertex];
+            for (u32 live_index = 0; live_index < adjacency.live[vertex]; ++live_index) {
+                u32 triangle = triangles[live_index];
+                u32 *triangle_corners = indices + triangle * 3;
+                f32 score = vertex_score[triangle_corners[0]] + vertex_score[triangle_corners[1]] +
+                    vertex_score[triangle_corners[2]];
+                if (score > best_score) {
+                    best_score = score;
+                    best = triangle;
+                }
+            }
+        }
+    }
+
+    memory_copy(indices, output, triangle_count * 3 * sizeof(u32));
+    arena_pop_to(scratch, scratch_pos);
+}
+
+//
+// Overdraw
+//
+
+// A FIFO cache by timestamps: a vertex is cached when it was transformed less than cache_size
+// misses ago. Moving *timestamp on by more than cache_size empties it.
+function u32
+mesh_fifo_triangle(u32 *corners, u32 *cache_time, u32 *timestamp, u32 cache_size) {
+    u32 result = 0;
+    for (u32 corner = 0; corner < 3; ++corner) {
+        u32 vertex = corners[corner];
+        if (*timestamp - cache_time[vertex] > cache_size) {
+            cache_time[vertex] = (*timestamp)++;
+            ++result;
+        }
+    }
+    return(result);
+}
+
+typedef struct {
+    f32 key;
+    u32 cluster;
+} Mesh_Cluster_Key;
+
+function int
+mesh_compare_cluster_keys(const void *a, const void *b) {
+    Mesh_Cluster_Key *x = (Mesh_Cluster_Key *)a;
+    Mesh_Cluster_Key *y = (Mesh_Cluster_Key *)b;
+    // outward facing first, the original order breaks ties so the sort is stable
+    int result = (x->key < y->key) - (x->key > y->key);
+    if (result == 0) {
+        result = (x->cluster > y->cluster) - (x->cluster < y->cluster);
+    }
+    return(result);
+}
+
+function void
+mesh_optimize_overdraw(Arena *scratch, u32 *indices, u32 index_count, Mesh_Vertex *vertices,
+                       u32 vertex_count, f32 threshold) {
+    u64 scratch_pos = scratch->pos;
+    u32 triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    u32 *cache_time = arena_push_array(scratch, u32, vertex_count);
+    u32 timestamp = mesh_fifo_cache_size + 1;
+    // the first triangle of every cluster, then triangle_count
+    u32 *hard = arena_push_array(scratch, u32, triangle_count + 1);
+    u32 hard_count = 0;
+
+    // hard boundaries: where the cache-ordered list restarts, all three vertices missing
+    for (u32 triangle = 0; triangle < triangle_count; ++triangle) {
+        u32 misses = mesh_fifo_triangle(indices + triangle * 3, cache_time, &timestamp, mesh_fifo_cache_size);
+        if ((triangle == 0) || (misses == 3)) {
+            hard[hard_count++] = triangle;
+        }
+    }
+    hard[hard_count] = triangle_count;
+
+    // soft boundaries: inside each hard cluster, cut as soon as the ACMR from the last cut, with
+    // an empty cache, is no worse than threshold times the whole cluster's
+    u32 *clusters = arena_push_array(scratch, u32, triangle_count + 1);
+    u32 cluster_count = 0;
+    for (u32 hard_index = 0; hard_index < hard_count; ++hard_index) {
+        u32 start = hard[hard_index];
+        u32 end = hard[hard_index + 1];
+
+        timestamp += mesh_fifo_cache_size + 1;
+        u32 cluster_misses = 0;
+        for (u32 triangle = start; triangle < end; ++triangle) {
+            cluster_misses += mesh_fifo_triangle(indices + triangle * 3, cache_time, &timestamp, mesh_fifo_cache_size);
+        }
+        f32 cluster_threshold = threshold * (f32)cluster_misses / (f32)(end - start);
+
+        timestamp += mesh_fifo_cache_size + 1;
+        u32 running_misses = 0;
+        u32 running_triangles = 0;
+        clusters[cluster_count++] = start;
+        for (u32 triangle = start; triangle < end; ++triangle) {
+            running_misses += mesh_fifo_triangle(indices + triangle * 3, cache_time, &timestamp, mesh_fifo_cache_size);
+            ++running_triangles;
+            if (((f32)running_misses <= cluster_threshold * (f32)running_triangles) && (triangle + 1 < end)) {
+                clusters[cluster_count++] = triangle + 1;
+                timestamp += mesh_fifo_cache_size + 1;
+                running_misses = 0;
+                running_triangles = 0;
+            }
+        }
+    }
+    clusters[cluster_count] = triangle_count;
+
+    v3f mesh_centroid = v3f_make(0.0f, 0.0f, 0.0f);
+    for (u32 vertex = 0; vertex < vertex_count; ++vertex) {
+        mesh_centroid = v3f_add(mesh_centroid, vertices[vertex].p);
+    }
+    mesh_centroid = v3f_scale(mesh_centroid, 1.0f / (f32)(vertex_count ? vertex_count : 1));
+
+    // how much a cluster faces away from the middle: its area-weighted centroid against its
+    // average normal
+    Mesh_Cluster_Key *keys = arena_push_array(scratch, Mesh_Cluster_Key, cluster_count);
+    for (u32 cluster = 0; cluster < cluster_count; ++cluster) {
+        v3f centroid = v3f_make(0.0f, 0.0f, 0.0f);
+        v3f normal = v3f_make(0.0f, 0.0f, 0.0f);
+        f32 area = 0.0f;
+        for (u32 triangle = clusters[cluster]; triangle < clusters[cluster + 1]; ++triangle) {
+            v3f p0 = vertices[indices[triangle * 3 + 0]].p;
+            v3f p1 = vertices[indices[triangle * 3 + 1]].p;
+            v3f p2 = vertices[indices[triangle * 3 + 2]].p;
+            // twice the area, along the face normal
+            v3f cross = v3f_cross(v3f_sub(p1, p0), v3f_sub(p2, p0));
+            f32 triangle_area = sqrtf(v3f_dot(cross, cross));
+            centroid = v3f_add(centroid, v3f_scale(v3f_add(v3f_add(p0, p1), p2), triangle_area / 3.0f));
+            normal = v3f_add(normal, cross);
+            area += triangle_area;
+        }
+
+        f32 normal_length = sqrtf(v3f_dot(normal, normal));
+        keys[cluster].cluster = cluster;
+        keys[cluster].key = 0.0f;
+        if ((area > 0.0f) && (normal_length > 0.0f)) {
+            v3f outward = v3f_sub(v3f_scale(centroid, 1.0f / area), mesh_centroid);
+            keys[cluster].key = v3f_dot(outward, normal) / normal_length;
+        }
+    }
+    qsort(keys, cluster_count, sizeof(Mesh_Cluster_Key), mesh_compare_cluster_keys);
+
+    u32 *output = arena_push_array(scratch, u32, triangle_count * 3);
+    u32 written = 0;
+    for (u32 key = 0; key < cluster_count; ++key) {
+        u32 cluster = keys[key].cluster;
+        u32 count = (clusters[cluster + 1] - clusters[cluster]) * 3;
+        memory_copy(output + written, indices + clusters[cluster] * 3, count * sizeof(u32));
+        written += count;
+    }
+    memory_copy(indices, output, triangle_count * 3 * sizeof(u32));
+    arena_pop_to(scratch, scratch_pos);
+}
+
+function void
+mesh_optimize_vertex_fetch(Arena *scratch, Mesh *mesh) {
+    u64 scratch_pos = scratch->pos;
+    u32 *remap = arena_push_array(scratch, u32, mesh->vertex_count);
+    memset(remap, 0xFF, mesh->vertex_count * sizeof(u32));
+    Mesh_Vertex *vertices = arena_push_array(scratch, Mesh_Vertex, mesh->vertex_count);
+
+    u32 count = 0;
+    for (u32 index = 0; index < mesh->index_count; ++index) {
+        u32 vertex = mesh->indices[index];
+        if (remap[vertex] == ~0u) {
+            vertices[count] = mesh->vertices[vertex];
+            remap[vertex] = count++;
+        }
+        mesh->indices[index] = remap[vertex];
+    }
+
+    memory_copy(mesh->vertices, vertices, count * sizeof(Mesh_Vertex));
+    mesh->vertex_count = count;
+    arena_pop_to(scratch, scratch_pos);
+}
+
+function void
+mesh_optimize(Arena *scratch, Mesh *mesh) {
+    mesh_optimize_vertex_cache(scratch, mesh->indices, mesh->index_count, mesh->vertex_count);
+    mesh_optimize_overdraw(scratch, mesh->indices, mesh->index_count, mesh->vertices, mesh->vertex_count,
+                           mesh_overdraw_threshold);
+    mesh_optimize_vertex_fetch(scratch, mesh);
+}
+
+function Mesh
+mesh_build(Arena *arena, Arena *scratch, Mesh_Vertex *soup, u32 soup_count) {
+    Mesh result = mesh_weld(arena, scratch, soup, soup_count);
+    mesh_optimize(scratch, &result);
+    return(result);
+}
+
+function Mesh_Stats
+mesh_analyze(Arena *scratch, Mesh *mesh, u32 cache_size) {
+    u64 scratch_pos = scratch->pos;
+    Mesh_Stats result = { 0 };
+    result.triangle_count = mesh->index_count / 3;
+
+    u32 *cache_time = arena_push_array(scratch, u32, mesh->vertex_count);
+    u32 timestamp = cache_size + 1;
+    u8 *referenced = arena_push_array(scratch, u8, mesh->vertex_count);
+    u64 line_count = ((u64)mesh->vertex_count * sizeof(Mesh_Vertex) + mesh_fetch_line_size - 1) / mesh_fetch_line_size;
+    u32 *line_time = arena_push_array(scratch, u32, line_count);
+    u32 line_timestamp = mesh_fetch_line_count + 1;
+    u64 fetched_lines = 0;
+
+    for (u32 triangle = 0; triangle < result.triangle_count; ++triangle) {
+        u32 *corners = mesh->indices + triangle * 3;
+        for (u32 corner = 0; corner < 3; ++corner) {
+            u32 vertex = corners[corner];
+            if (!referenced[vertex]) {
+                referenced[vertex] = 1;
+                ++result.vertex_count;
+            }
+            if (timestamp - cache_time[vertex] > cache_size) {
+                cache_time[vertex] = timestamp++;
+                ++result.transformed;
+
+                // only what gets transformed is fetched
+                u64 first_line = ((u64)vertex * sizeof(Mesh_Vertex)) / mesh_fetch_line_size;
+                u64 last_line = ((u64)vertex * sizeof(Mesh_Vertex) + sizeof(Mesh_Vertex) - 1) / mesh_fetch_line_size;
+                for (u64 line = first_line; line <= last_line; ++line) {
+                    if (line_timestamp - line_time[line] > mesh_fetch_line_count) {
+                        line_time[line] = line_timestamp++;
+                        ++fetched_lines;
+                    }
+                }
+            }
+        }
+    }
+
+    if (result.triangle_count) {
+        result.acmr = (f32)result.transformed / (f32)result.triangle_count;
+        result.atvr = (f32)result.transformed / (f32)result.vertex_count;
+        result.overfetch = (f32)(fetched_lines * mesh_fetch_line_size) /
+            (f32)((u64)result.vertex_count * sizeof(Mesh_Vertex));
+    }
+    arena_pop_to(scratch, scratch_pos);
+    return(result);
+}
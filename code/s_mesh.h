@@ -0,0 +1,74 @@
+#if !defined(S_MESH_H)
+#define S_MESH_H
+
+// Indexed triangle lists, built from triangle soups: identical vertices are welded into one, then
+// the order of triangles and vertices is tuned for the GPU:
+// 1. mesh_optimize_vertex_cache: Tom Forsyth's "Linear-Speed Vertex Cache Optimisation". Greedily
+//    emits the triangle whose vertices score best, scores favouring vertices recently used (an LRU
+//    model of the post-transform cache) and vertices with few triangles left.
+// 2. mesh_optimize_overdraw: Sander, Nehab and Barczak's "Fast Triangle Reordering for Vertex
+//    Locality and Reduced Overdraw". Cuts the cache-ordered list into clusters wherever that
+//    doesn't cost more than threshold times the ACMR, then draws the clusters facing out from the
+//    centre of the mesh first, so they tend to occlude the rest.
+// 3. mesh_optimize_vertex_fetch: renumbers vertices in the order the indices first use them, so
+//    fetches walk the vertex buffer forward.
+//
+// Triangles keep their winding; only the order of triangles and vertex numbering change.
+
+// Matches per_vertex_input_layout and game_cube_vertices: position then normal.
+typedef struct {
+    v3f p;
+    v3f normal;
+} Mesh_Vertex;
+
+typedef struct {
+    Mesh_Vertex *vertices;
+    u32 vertex_count;
+    // triangle list
+    u32 *indices;
+    u32 index_count;
+    // of the bounding sphere around the local origin, what culling tests instances with
+    f32 radius;
+} Mesh;
+
+typedef struct {
+    u32 triangle_count;
+    // vertices the indices reference at least once
+    u32 vertex_count;
+    // post-transform cache misses, i.e. vertex shader invocations
+    u32 transformed;
+    // transformed per triangle, 3 is no reuse at all and a large regular grid approaches 0.5
+    f32 acmr;
+    // transformed per referenced vertex, 1 is ideal
+    f32 atvr;
+    // bytes pulled in through mesh_fetch_line_size lines per referenced vertex byte, 1 is ideal
+    f32 overfetch;
+} Mesh_Stats;
+
+// FIFO, about what the hardware of the D3D11 era has. Used by the stats and the overdraw clustering.
+#define mesh_fifo_cache_size 16
+// Forsyth's scoring model assumes a bigger LRU cache, which also does well on FIFO hardware.
+#define mesh_forsyth_cache_size 32
+#define mesh_fetch_line_size 64
+#define mesh_fetch_line_count 64
+// The ACMR the overdraw clustering may give up, as a factor.
+#define mesh_overdraw_threshold 1.05f
+
+// Welds soup_count vertices, every 3 a triangle, by exact bit equality. Result arrays are pushed
+// to arena, scratch is used for the hash table and returned as it was.
+function Mesh mesh_weld(Arena *arena, Arena *scratch, Mesh_Vertex *soup, u32 soup_count);
+function void mesh_optimize_vertex_cache(Arena *scratch, u32 *indices, u32 index_count, u32 vertex_count);
+function void mesh_optimize_overdraw(Arena *scratch, u32 *indices, u32 index_count, Mesh_Vertex *vertices,
+                                     u32 vertex_count, f32 threshold);
+// Reorders mesh->vertices and rewrites the indices in place. Vertices nothing references are
+// dropped, mesh->vertex_count is updated.
+function void mesh_optimize_vertex_fetch(Arena *scratch, Mesh *mesh);
+// All three in order.
+function void mesh_optimize(Arena *scratch, Mesh *mesh);
+// mesh_weld then mesh_optimize.
+function Mesh mesh_build(Arena *arena, Arena *scratch, Mesh_Vertex *soup, u32 soup_count);
+
+// Simulates a FIFO post-transform cache of cache_size and the vertex fetch lines.
+function Mesh_Stats mesh_analyze(Arena *scratch, Mesh *mesh, u32 cache_size);
+
+#endif
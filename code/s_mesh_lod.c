@@ -0,0 +1,490 @@
+//
+// Quadrics
+//
+
+// The symmetric 4x4 matrix of a sum of squared plane distances, upper triangle:
+// xx xy xz xw yy yz yw zz zw ww. f64 since the sums get large next to what they're compared to.
+typedef struct {
+    f64 q[10];
+} Mesh_Quadric;
+
+function void
+mesh_quadric_add_plane(Mesh_Quadric *quadric, v3f n, f32 d, f32 weight) {
+    f64 a = n.x, b = n.y, c = n.z, w = d;
+    quadric->q[0] += weight * a * a;
+    quadric->q[1] += weight * a * b;
+    quadric->q[2] += weight * a * c;
+    quadric->q[3] += weight * a * w;
+    quadric->q[4] += weight * b * b;
+    quadric->q[5] += weight * b * c;
+    quadric->q[6] += weight * b * w;
+    quadric->q[7] += weight * c * c;
+    quadric->q[8] += weight * c * w;
+    quadric->q[9] += weight * w * w;
+}
+
+function void
+mesh_quadric_add(Mesh_Quadric *a, Mesh_Quadric *b) {
+    for (u32 index = 0; index < array_count(a->q); ++index) {
+        a->q[index] += b->q[index];
+    }
+}
+
+function f64
+mesh_quadric_error(Mesh_Quadric *quadric, v3f p) {
+    f64 *q = quadric->q;
+    f64 x = p.x, y = p.y, z = p.z;
+    f64 result = q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x +
+        q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y +
+        q[7] * z * z + 2.0 * q[8] * z + q[9];
+    return(result > 0.0 ? result : 0.0);
+}
+
+//
+// Simplification
+//
+
+enum {
+    MeshLODVertex_Manifold,
+    MeshLODVertex_Border,
+    // shares its position with another vertex, or sits on a non-manifold edge
+    MeshLODVertex_Locked,
+};
+
+// directed edges, key = from << 32 | to
+typedef struct {
+    u64 *keys;
+    u32 *counts;
+    u32 mask;
+    u32 shift;
+} Mesh_Edge_Table;
+
+function u32 *
+mesh_edge_count(Mesh_Edge_Table *table, u32 from, u32 to, b32 insert) {
+    u64 key = ((u64)from << 32) | to;
+    // the top bits of the product, the only ones both halves of the key reach
+    u32 slot = (u32)((key * 0x9E3779B97F4A7C15ull) >> table->shift);
+    while ((table->keys[slot] != ~0ull) && (table->keys[slot] != key)) {
+        slot = (slot + 1) & table->mask;
+    }
+    u32 *result = null;
+    if (table->keys[slot] == key) {
+        result = table->counts + slot;
+    } else if (insert) {
+        table->keys[slot] = key;
+        result = table->counts + slot;
+    }
+    return(result);
+}
+
+function u32
+mesh_edge_lookup(Mesh_Edge_Table *table, u32 from, u32 to) {
+    u32 *count = mesh_edge_count(table, from, to, False);
+    u32 result = count ? *count : 0;
+    return(result);
+}
+
+typedef struct {
+    f32 cost;
+    u32 from;
+    u32 to;
+} Mesh_Collapse;
+
+function int
+mesh_compare_collapses(const void *a, const void *b) {
+    f32 x = ((const Mesh_Collapse *)a)->cost;
+    f32 y = ((const Mesh_Collapse *)b)->cost;
+    int result = (x > y) - (x < y);
+    return(result);
+}
+
+function u32
+mesh_hash_position(v3f p) {
+    u8 *bytes = (u8 *)&p;
+    u32 result = 2166136261u;
+    for (u32 index = 0; index < sizeof(v3f); ++index) {
+        result = (result ^ bytes[index]) * 16777619u;
+    }
+    return(result);
+}
+
+function v3f
+mesh_triangle_normal(v3f a, v3f b, v3f c) {
+    v3f result = v3f_cross(v3f_sub(b, a), v3f_sub(c, a));
+    return(result);
+}
+
+#define mesh_lod_neighbour_max 64
+
+// Gathers the other vertices of vertex's triangles, false if there are too many to check.
+function b32
+mesh_lod_neighbours(Mesh_Adjacency *adjacency, u32 *indices, u32 vertex, u32 *neighbours, u32 *count) {
+    *count = 0;
+    for (u32 entry = 0; entry < adjacency->live[vertex]; ++entry) {
+        u32 *corners = indices + adjacency->adjacency[adjacency->offset[vertex] + entry] * 3;
+        for (u32 corner = 0; corner < 3; ++corner) {
+            u32 other = corners[corner];
+            b32 known = other == vertex;
+            for (u32 index = 0; index < *count && !known; ++index) {
+                known = neighbours[index] == other;
+            }
+            if (!known) {
+                if (*count == mesh_lod_neighbour_max) {
+                    return(False);
+                }
+                neighbours[(*count)++] = other;
+            }
+        }
+    }
+    return(True);
+}
+
+// Moving from onto to must not flip or squash any triangle that survives and must not pinch the
+// surface: the only vertices both ends see are the far corners of the triangles being removed.
+// *removed is how many triangles the collapse takes out.
+function b32
+mesh_lod_collapse_ok(Mesh_Adjacency *adjacency, u32 *indices, Mesh_Vertex *vertices, u32 from, u32 to, u32 *removed) {
+    v3f target = vertices[to].p;
+    *removed = 0;
+    for (u32 entry = 0; entry < adjacency->live[from]; ++entry) {
+        u32 *corners = indices + adjacency->adjacency[adjacency->offset[from] + entry] * 3;
+        if ((corners[0] == to) || (corners[1] == to) || (corners[2] == to)) {
+            ++*removed;
+            continue;
+        }
+        v3f p[3];
+        v3f moved[3];
+        for (u32 corner = 0; corner < 3; ++corner) {
+            p[corner] = vertices[corners[corner]].p;
+            moved[corner] = corners[corner] == from ? target : p[corner];
+        }
+        v3f before = mesh_triangle_normal(p[0], p[1], p[2]);
+        v3f after = mesh_triangle_normal(moved[0], moved[1], moved[2]);
+        f32 turn = v3f_dot(before, after);
+        if ((v3f_dot(before, before) > 0.0f) &&
+            (turn <= mesh_lod_max_turn_cos * sqrtf(v3f_dot(before, before) * v3f_dot(after, after)))) {
+            return(False);
+        }
+    }
+
+    u32 from_neighbours[mesh_lod_neighbour_max];
+    u32 to_neighbours[mesh_lod_neighbour_max];
+    u32 from_count, to_count;
+    if (!mesh_lod_neighbours(adjacency, indices, from, from_neighbours, &from_count) ||
+        !mesh_lod_neighbours(adjacency, indices, to, to_neighbours, &to_count)) {
+        return(False);
+    }
+    u32 common = 0;
+    for (u32 a = 0; a < from_count; ++a) {
+        for (u32 b = 0; b < to_count; ++b) {
+            common += (from_neighbours[a] == to_neighbours[b]) && (from_neighbours[a] != to) ? 1 : 0;
+        }
+    }
+    b32 result = (*removed > 0) && (common <= *removed);
+    return(result);
+}
+
+function Mesh
+mesh_simplify(Arena *arena, Arena *scratch, Mesh *mesh, u32 target_index_count, f32 *error) {
+    u64 scratch_pos = scratch->pos;
+    u32 vertex_count = mesh->vertex_count;
+    Mesh_Vertex *vertices = mesh->vertices;
+    u32 index_count = mesh->index_count - mesh->index_count % 3;
+    u32 *indices = arena_push_array(scratch, u32, index_count);
+    memory_copy(indices, mesh->indices, index_count * sizeof(u32));
+
+    // canonical[v] is the first vertex at v's position
+    u32 table_size = 16;
+    while (table_size < vertex_count * 2) {
+        table_size <<= 1;
+    }
+    u32 *table = arena_push_array(scratch, u32, table_size);
+    memset(table, 0xFF, table_size * sizeof(u32));
+    u32 *canonical = arena_push_array(scratch, u32, vertex_count);
+    u8 *shared = arena_push_array(scratch, u8, vertex_count);
+    for (u32 vertex = 0; vertex < vertex_count; ++vertex) {
+        u32 slot = mesh_hash_position(vertices[vertex].p) & (table_size - 1);
+        while ((table[slot] != ~0u) &&
+               (memory_compare(&vertices[table[slot]].p, &vertices[vertex].p, sizeof(v3f)) != 0)) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (table[slot] == ~0u) {
+            table[slot] = vertex;
+            canonical[vertex] = vertex;
+        } else {
+            canonical[vertex] = table[slot];
+            shared[vertex] = True;
+            shared[table[slot]] = True;
+        }
+    }
+
+    Mesh_Quadric *quadrics = arena_push_array(scratch, Mesh_Quadric, vertex_count);
+    for (u32 index = 0; index < index_count; index += 3) {
+        u32 c[3] = { canonical[indices[index]], canonical[indices[index + 1]], canonical[indices[index + 2]] };
+        v3f n = mesh_triangle_normal(vertices[c[0]].p, vertices[c[1]].p, vertices[c[2]].p);
+        f32 length = sqrtf(v3f_dot(n, n));
+        if (length > 0.0f) {
+            n = v3f_scale(n, 1.0f / length);
+            f32 d = -v3f_dot(n, vertices[c[0]].p);
+            for (u32 corner = 0; corner < 3; ++corner) {
+                mesh_quadric_add_plane(quadrics + c[corner], n, d, 1.0f);
+            }
+        }
+    }
+
+    u32 edge_table_max = 16;
+    while (edge_table_max < index_count * 2) {
+        edge_table_max <<= 1;
+    }
+    Mesh_Edge_Table edges;
+    edges.keys = arena_push_array(scratch, u64, edge_table_max);
+    edges.counts = arena_push_array(scratch, u32, edge_table_max);
+    u8 *kind = arena_push_array(scratch, u8, vertex_count);
+    u8 *pass_locked = arena_push_array(scratch, u8, vertex_count);
+    u32 *remap = arena_push_array(scratch, u32, vertex_count);
+    Mesh_Collapse *collapses = arena_push_array(scratch, Mesh_Collapse, index_count);
+
+    f64 max_cost = 0.0;
+    for (b32 first_pass = True; index_count > target_index_count; first_pass = False) {
+        // directed edges between canonical vertices, then what kind of vertex each is; the table
+        // shrinks with the mesh so later passes stay in cache
+        u32 edge_table_size = 16;
+        edges.shift = 64 - 4;
+        while (edge_table_size < index_count * 2) {
+            edge_table_size <<= 1;
+            --edges.shift;
+        }
+        edges.mask = edge_table_size - 1;
+        memset(edges.keys, 0xFF, edge_table_size * sizeof(u64));
+        memset(edges.counts, 0, edge_table_size * sizeof(u32));
+        for (u32 index = 0; index < index_count; ++index) {
+            u32 from = canonical[indices[index]];
+            u32 to = canonical[indices[index - index % 3 + (index + 1) % 3]];
+            ++*mesh_edge_count(&edges, from, to, True);
+        }
+        for (u32 vertex = 0; vertex < vertex_count; ++vertex) {
+            kind[vertex] = shared[vertex] ? MeshLODVertex_Locked : MeshLODVertex_Manifold;
+        }
+        for (u32 index = 0; index < index_count; ++index) {
+            u32 from = canonical[indices[index]];
+            u32 to = canonical[indices[index - index % 3 + (index + 1) % 3]];
+            if (mesh_edge_lookup(&edges, from, to) > 1) {
+                kind[from] = MeshLODVertex_Locked;
+                kind[to] = MeshLODVertex_Locked;
+            } else if (mesh_edge_lookup(&edges, to, from) == 0) {
+                kind[from] = kind[from] == MeshLODVertex_Locked ? MeshLODVertex_Locked : MeshLODVertex_Border;
+                kind[to] = kind[to] == MeshLODVertex_Locked ? MeshLODVertex_Locked : MeshLODVertex_Border;
+                if (first_pass) {
+                    // a plane through the border edge, standing up from the face
+                    u32 *corners = indices + index - index % 3;
+                    v3f face = mesh_triangle_normal(vertices[corners[0]].p, vertices[corners[1]].p, vertices[corners[2]].p);
+                    v3f n = v3f_cross(v3f_sub(vertices[to].p, vertices[from].p), face);
+                    f32 length = sqrtf(v3f_dot(n, n));
+                    if (length > 0.0f) {
+                        n = v3f_scale(n, 1.0f / length);
+                        f32 d = -v3f_dot(n, vertices[from].p);
+                        mesh_quadric_add_plane(quadrics + from, n, d, mesh_lod_border_weight);
+                        mesh_quadric_add_plane(quadrics + to, n, d, mesh_lod_border_weight);
+                    }
+                }
+            }
+        }
+
+        // every edge once, in the cheaper direction it may collapse
+        u32 collapse_count = 0;
+        for (u32 index = 0; index < index_count; ++index) {
+            u32 a = canonical[indices[index]];
+            u32 b = canonical[indices[index - index % 3 + (index + 1) % 3]];
+            b32 border = mesh_edge_lookup(&edges, b, a) == 0;
+            if ((a == b) || (!border && (a > b))) {
+                continue;
+            }
+            Mesh_Quadric sum = quadrics[a];
+            mesh_quadric_add(&sum, quadrics + b);
+            f64 best = -1.0;
+            for (u32 direction = 0; direction < 2; ++direction) {
+                u32 from = direction ? b : a;
+                u32 to = direction ? a : b;
+                b32 movable = (kind[from] != MeshLODVertex_Locked) && (kind[to] != MeshLODVertex_Locked) &&
+                    ((kind[from] == MeshLODVertex_Manifold) || (border && (kind[to] == MeshLODVertex_Border)));
+                if (movable) {
+                    f64 cost = mesh_quadric_error(&sum, vertices[to].p);
+                    if ((best < 0.0) || (cost < best)) {
+                        best = cost;
+                        collapses[collapse_count].cost = (f32)cost;
+                        collapses[collapse_count].from = from;
+                        collapses[collapse_count].to = to;
+                    }
+                }
+            }
+            collapse_count += best >= 0.0 ? 1 : 0;
+        }
+        if (!collapse_count) {
+            break;
+        }
+        qsort(collapses, collapse_count, sizeof(Mesh_Collapse), mesh_compare_collapses);
+
+        // Locked and seam vertices never move, so everything that does is its own canonical vertex
+        // and the adjacency can be by vertex.
+        u64 pass_pos = scratch->pos;
+        Mesh_Adjacency adjacency = mesh_adjacency(scratch, indices, index_count, vertex_count);
+        memset(pass_locked, 0, vertex_count * sizeof(u8));
+        for (u32 vertex = 0; vertex < vertex_count; ++vertex) {
+            remap[vertex] = vertex;
+        }
+        u32 needed = (index_count - target_index_count) / 3;
+        u32 removed_total = 0;
+        u32 collapsed = 0;
+        for (u32 collapse_index = 0; (collapse_index < collapse_count) && (removed_total < needed); ++collapse_index) {
+            Mesh_Collapse *collapse = collapses + collapse_index;
+            u32 removed;
+            if (pass_locked[collapse->from] || pass_locked[collapse->to] ||
+                !mesh_lod_collapse_ok(&adjacency, indices, vertices, collapse->from, collapse->to, &removed)) {
+                continue;
+            }
+            remap[collapse->from] = collapse->to;
+            mesh_quadric_add(quadrics + collapse->to, quadrics + collapse->from);
+            max_cost = collapse->cost > max_cost ? collapse->cost : max_cost;
+            // everything around the collapse is stale until the next pass
+            for (u32 entry = 0; entry < adjacency.live[collapse->from]; ++entry) {
+                u32 *corners = indices + adjacency.adjacency[adjacency.offset[collapse->from] + entry] * 3;
+                for (u32 corner = 0; corner < 3; ++corner) {
+                    pass_locked[canonical[corners[corner]]] = True;
+                }
+            }
+            removed_total += removed;
+            ++collapsed;
+        }
+        arena_pop_to(scratch, pass_pos);
+        if (!collapsed) {
+            break;
+        }
+
+        u32 kept = 0;
+        for (u32 index = 0; index < index_count; index += 3) {
+            u32 a = remap[indices[index]];
+            u32 b = remap[indices[index + 1]];
+            u32 c = remap[indices[index + 2]];
+            if ((a != b) && (b != c) && (c != a)) {
+                indices[kept++] = a;
+                indices[kept++] = b;
+                indices[kept++] = c;
+            }
+        }
+        index_count = kept;
+    }
+
+    Mesh result = { 0 };
+    result.vertices = arena_push_array(arena, Mesh_Vertex, vertex_count);
+    result.vertex_count = vertex_count;
+    result.indices = arena_push_array(arena, u32, index_count);
+    result.index_count = index_count;
+    result.radius = mesh->radius;
+    memory_copy(result.vertices, vertices, vertex_count * sizeof(Mesh_Vertex));
+    memory_copy(result.indices, indices, index_count * sizeof(u32));
+    arena_pop_to(scratch, scratch_pos);
+
+    // drops the vertices nothing uses any more
+    mesh_optimize(scratch, &result);
+    *error = (f32)sqrt(max_cost);
+    return(result);
+}
+
+//
+// Chains
+//
+
+function Mesh_LOD_Chain
+mesh_lod_build(Arena *arena, Arena *scratch, Mesh *mesh) {
+    Mesh_LOD_Chain result = { 0 };
+    // every level's copy before the vertex fetch pass trims it, a bit under twice the mesh
+    Arena levels_arena = arena_reserve(((u64)mesh->vertex_count * sizeof(Mesh_Vertex) +
+                                        (u64)mesh->index_count * sizeof(u32)) * 3 + megabytes(1));
+    Mesh levels[mesh_lod_max];
+    levels[0] = *mesh;
+    result.level_count = 1;
+    for (u32 level = 1; level < mesh_lod_max; ++level) {
+        Mesh *previous = levels + level - 1;
+        u32 target_index_count = (u32)((f32)(previous->index_count / 3) * mesh_lod_reduction) * 3;
+        f32 error;
+        Mesh next = mesh_simplify(&levels_arena, scratch, previous, target_index_count, &error);
+        if ((f32)next.index_count > (f32)previous->index_count * mesh_lod_min_reduction) {
+            break;
+        }
+        levels[level] = next;
+        // each level is simplified from the previous, so their errors add up
+        result.error[level] = result.error[level - 1] + error;
+        ++result.level_count;
+    }
+
+    u32 total_vertex_count = 0;
+    u32 total_index_count = 0;
+    for (u32 level = 0; level < result.level_count; ++level) {
+        result.base_vertex[level] = total_vertex_count;
+        result.vertex_count[level] = levels[level].vertex_count;
+        result.first_index[level] = total_index_count;
+        result.index_count[level] = levels[level].index_count;
+        total_vertex_count += levels[level].vertex_count;
+        total_index_count += levels[level].index_count;
+    }
+    result.combined.vertices = arena_push_array(arena, Mesh_Vertex, total_vertex_count);
+    result.combined.vertex_count = total_vertex_count;
+    result.combined.indices = arena_push_array(arena, u32, total_index_count);
+    result.combined.index_count = total_index_count;
+    result.combined.radius = mesh->radius;
+    for (u32 level = 0; level < result.level_count; ++level) {
+        memory_copy(result.combined.vertices + result.base_vertex[level], levels[level].vertices,
+                    levels[level].vertex_count * sizeof(Mesh_Vertex));
+        memory_copy(result.combined.indices + result.first_index[level], levels[level].indices,
+                    levels[level].index_count * sizeof(u32));
+    }
+
+    arena_release(&levels_arena);
+    return(result);
+}
+
+function Mesh
+mesh_lod_level(Mesh_LOD_Chain *chain, u32 level) {
+    Mesh result;
+    result.vertices = chain->combined.vertices + chain->base_vertex[level];
+    result.vertex_count = chain->vertex_count[level];
+    result.indices = chain->combined.indices + chain->first_index[level];
+    result.index_count = chain->index_count[level];
+    result.radius = chain->combined.radius;
+    return(result);
+}
+
+//
+// Selection
+//
+
+function Mesh_LOD_View
+mesh_lod_view(m44 view_projection, u32 target_height, f32 pixel_error) {
+    // clip = v * m: column 3 is w, the view depth, and column 1's length is the y scale since the
+    // view rotation doesn't change lengths
+    Mesh_LOD_View result;
+    result.depth_plane = v4f_make(view_projection.m[0][3], view_projection.m[1][3],
+                                  view_projection.m[2][3], view_projection.m[3][3]);
+    v3f column_y = v3f_make(view_projection.m[0][1], view_projection.m[1][1], view_projection.m[2][1]);
+    result.pixels_per_unit = sqrtf(v3f_dot(column_y, column_y)) * (f32)target_height * 0.5f;
+    result.pixel_error = pixel_error;
+    return(result);
+}
+
+function u32
+mesh_lod_select(Mesh_LOD_Chain *chain, Mesh_LOD_View *view, v3f center, f32 radius, f32 scale) {
+    u32 result = 0;
+    // the sphere's nearest depth; anything reaching the camera plane gets level 0
+    f32 depth = v3f_dot(view->depth_plane.xyz, center) + view->depth_plane.w - radius;
+    if ((depth > 0.0f) && (radius > 0.0f)) {
+        f32 projected_radius = radius * view->pixels_per_unit / depth;
+        for (u32 level = chain->level_count - 1; level > 0; --level) {
+            f32 projected_error = chain->error[level] * scale / radius * projected_radius;
+            if (projected_error <= view->pixel_error) {
+                result = level;
+                break;
+            }
+        }
+    }
+    return(result);
+}
@@ -0,0 +1,71 @@
+#if !defined(S_MESH_LOD_H)
+#define S_MESH_LOD_H
+
+// Level of detail chains, built when a mesh is loaded, and picking a level per instance.
+//
+// mesh_simplify is Garland and Heckbert's "Surface Simplification Using Quadric Error Metrics"
+// with half-edge collapses: a vertex is moved onto a neighbour, so every level keeps a subset of
+// the original vertices and the vertex format's bounding box still fits. Each vertex carries the
+// sum of its faces' plane quadrics, so the cost of a collapse is the summed squared distance of
+// the new spot to every plane the merged vertices stood on.
+//
+// It runs in passes. A pass scores every edge, then collapses them cheapest first, skipping any
+// edge whose triangles an earlier collapse of the same pass touched, so all the adjacency can be
+// built once per pass. Collapses that would flip a triangle, or turn it past mesh_lod_max_turn_cos,
+// or pinch the surface (more than the edge's own triangles shared by both ends) are rejected. Vertices that share a position with
+// another (normal or attribute seams) and non-manifold ones stay put; border vertices only move
+// along the border, held there by planes through the border edges weighted by
+// mesh_lod_border_weight.
+//
+// Selection: an instance at view depth z with bounding sphere radius r covers r * pixels_per_unit / z
+// pixels of the target's height. A level whose error is e (same units as r) is then off by
+// (e / r) of that many pixels, and the coarsest level under pixel_error is drawn. The level goes
+// into the instance's sort key, see s_batch.h, so every level of every mesh is its own draw.
+
+#define mesh_lod_max 6
+// each level aims for this fraction of the previous level's triangles
+#define mesh_lod_reduction 0.5f
+// a level that can't get below this fraction of the previous one ends the chain
+#define mesh_lod_min_reduction 0.85f
+#define mesh_lod_border_weight 10.0f
+// a collapse may turn none of its triangles further than acos of this, about 75 degrees; anything
+// short of a flip lets a few triangles fold over on the coarser levels of a sphere
+#define mesh_lod_max_turn_cos 0.25f
+
+typedef struct {
+    // every level's vertices and indices back to back, one vertex and one index buffer for all;
+    // a level's indices are relative to its base_vertex
+    Mesh combined;
+    u32 level_count;
+    u32 base_vertex[mesh_lod_max];
+    u32 vertex_count[mesh_lod_max];
+    u32 first_index[mesh_lod_max];
+    u32 index_count[mesh_lod_max];
+    // how far the level's surface may be from level 0's, in local units, 0 for level 0
+    f32 error[mesh_lod_max];
+} Mesh_LOD_Chain;
+
+// Simplifies towards target_index_count, stopping early when no edge can collapse. The result is
+// optimized like mesh_build's and pushed to arena. *error is the square root of the costliest
+// collapse, an upper bound on how far the surface moved off any of the original planes.
+function Mesh mesh_simplify(Arena *arena, Arena *scratch, Mesh *mesh, u32 target_index_count, f32 *error);
+// Level 0 is mesh, each next level mesh_simplify of the previous.
+function Mesh_LOD_Chain mesh_lod_build(Arena *arena, Arena *scratch, Mesh *mesh);
+// A view of one level, vertices and indices into combined.
+function Mesh mesh_lod_level(Mesh_LOD_Chain *chain, u32 level);
+
+typedef struct {
+    // clip w as a plane, dot(depth_plane.xyz, p) + depth_plane.w is p's view depth
+    v4f depth_plane;
+    // pixels a unit of size covers at depth 1
+    f32 pixels_per_unit;
+    f32 pixel_error;
+} Mesh_LOD_View;
+
+// Expects the same row-vector view_projection as frustum_from_view_projection, with a perspective
+// projection.
+function Mesh_LOD_View mesh_lod_view(m44 view_projection, u32 target_height, f32 pixel_error);
+// radius is the instance's bounding sphere in world units, scale the instance's largest scale axis.
+function u32 mesh_lod_select(Mesh_LOD_Chain *chain, Mesh_LOD_View *view, v3f center, f32 radius, f32 scale);
+
+#endif
@@ -0,0 +1,279 @@
+// Level of detail: every level of a chain is a valid mesh, far enough below the one before it to
+// be worth keeping, with an error that only grows. Simplifying a closed mesh leaves it closed, a
+// mesh whose every vertex sits on a seam can't be simplified at all, and selection goes from
+// level 0 at the camera to the coarsest level far away, never back.
+
+// The sphere without the triangles the poles squash to nothing, so every edge has two sides.
+function Mesh
+mesh_lod_test_sphere(Arena *arena, Arena *scratch, u32 stacks, u32 slices) {
+    u32 soup_count;
+    Mesh_Vertex *soup = mesh_test_sphere_soup(scratch, stacks, slices, &soup_count);
+    u32 kept = 0;
+    for (u32 triangle = 0; triangle < soup_count / 3; ++triangle) {
+        Mesh_Vertex *corners = soup + triangle * 3;
+        b32 degenerate = False;
+        for (u32 corner = 0; corner < 3; ++corner) {
+            degenerate = degenerate ||
+                (memory_compare(&corners[corner].p, &corners[(corner + 1) % 3].p, sizeof(v3f)) == 0);
+        }
+        if (!degenerate) {
+            memory_copy(soup + kept, corners, 3 * sizeof(Mesh_Vertex));
+            kept += 3;
+        }
+    }
+    Mesh result = mesh_build(arena, scratch, soup, kept);
+    return(result);
+}
+
+function int
+mesh_lod_test_compare_u64(const void *a, const void *b) {
+    u64 x = *(const u64 *)a;
+    u64 y = *(const u64 *)b;
+    int result = (x > y) - (x < y);
+    return(result);
+}
+
+// Directed edges with no edge running the other way, or used by more than one triangle, where a
+// collapse pinched the surface. 0 for a closed manifold, consistently wound.
+function u32
+mesh_lod_test_open_edges(Arena *scratch, Mesh *mesh) {
+    u64 scratch_pos = scratch->pos;
+    u64 *edges = arena_push_array(scratch, u64, mesh->index_count);
+    for (u32 index = 0; index < mesh->index_count; ++index) {
+        u32 from = mesh->indices[index];
+        u32 to = mesh->indices[index - index % 3 + (index + 1) % 3];
+        edges[index] = ((u64)from << 32) | to;
+    }
+    qsort(edges, mesh->index_count, sizeof(u64), mesh_lod_test_compare_u64);
+    u32 result = 0;
+    for (u32 index = 0; index < mesh->index_count; ++index) {
+        u64 reverse = (edges[index] << 32) | (edges[index] >> 32);
+        b32 repeated = (index > 0) && (edges[index] == edges[index - 1]);
+        result += repeated || !bsearch(&reverse, edges, mesh->index_count, sizeof(u64), mesh_lod_test_compare_u64);
+    }
+    arena_pop_to(scratch, scratch_pos);
+    return(result);
+}
+
+// Triangles that face the origin, for convex meshes around it, where every level's vertices are
+// still on the hull and a triangle facing in means the surface folded over.
+function u32
+mesh_lod_test_inward_triangles(Mesh *mesh) {
+    u32 result = 0;
+    for (u32 index = 0; index + 2 < mesh->index_count; index += 3) {
+        v3f a = mesh->vertices[mesh->indices[index + 0]].p;
+        v3f b = mesh->vertices[mesh->indices[index + 1]].p;
+        v3f c = mesh->vertices[mesh->indices[index + 2]].p;
+        // clockwise seen from outside in a left-handed space, so the triple product is positive
+        result += v3f_dot(a, v3f_cross(b, c)) <= 0.0f;
+    }
+    return(result);
+}
+
+// What every chain has to be, whatever the mesh.
+function void
+mesh_lod_test_chain(char *name, Mesh_LOD_Chain *chain, Mesh *mesh) {
+    test_check((chain->level_count >= 1) && (chain->level_count <= mesh_lod_max), "%s: %u levels", name,
+               chain->level_count);
+    test_check((chain->index_count[0] == mesh->index_count) && (chain->vertex_count[0] == mesh->vertex_count) &&
+               (chain->error[0] == 0.0f), "%s: level 0 isn't the mesh", name);
+    for (u32 level = 0; level < chain->level_count; ++level) {
+        Mesh level_mesh = mesh_lod_level(chain, level);
+        b32 in_combined = ((u64)chain->base_vertex[level] + level_mesh.vertex_count <= chain->combined.vertex_count) &&
+            ((u64)chain->first_index[level] + level_mesh.index_count <= chain->combined.index_count);
+        u32 out_of_range = 0;
+        for (u32 index = 0; in_combined && (index < level_mesh.index_count); ++index) {
+            out_of_range += level_mesh.indices[index] >= level_mesh.vertex_count;
+        }
+        test_check(in_combined && !out_of_range && !(level_mesh.index_count % 3),
+                   "%s, level %u: %u of %u indices past %u vertices", name, level, out_of_range, level_mesh.index_count,
+                   level_mesh.vertex_count);
+        if (level > 0) {
+            f32 limit = (f32)chain->index_count[level - 1] * mesh_lod_min_reduction;
+            test_check((f32)level_mesh.index_count <= limit, "%s, level %u: %u indices, level %u had %u", name, level,
+                       level_mesh.index_count, level - 1, chain->index_count[level - 1]);
+            test_check(chain->error[level] >= chain->error[level - 1], "%s, level %u: error %g after %g", name, level,
+                       chain->error[level], chain->error[level - 1]);
+        }
+        // only the mesh's own vertices, moved onto each other
+        if (in_combined && !out_of_range && (level > 0)) {
+            u32 moved = 0;
+            for (u32 vertex = 0; vertex < level_mesh.vertex_count; ++vertex) {
+                b32 found = False;
+                for (u32 original = 0; !found && (original < mesh->vertex_count); ++original) {
+                    found = memory_compare(level_mesh.vertices + vertex, mesh->vertices + original,
+                                           sizeof(Mesh_Vertex)) == 0;
+                }
+                moved += !found;
+            }
+            test_check(!moved, "%s, level %u: %u vertices that level 0 doesn't have", name, level, moved);
+        }
+    }
+}
+
+function void
+test_mesh_lod(void) {
+    Arena arena = arena_reserve(megabytes(256));
+    Arena scratch = arena_reserve(megabytes(256));
+
+    // a closed sphere stays closed, manifold and unfolded all the way down
+    Mesh sphere = mesh_lod_test_sphere(&arena, &scratch, 24, 48);
+    arena_clear(&scratch);
+    test_check(!mesh_lod_test_open_edges(&scratch, &sphere), "the test sphere isn't closed");
+    Mesh_LOD_Chain chain = mesh_lod_build(&arena, &scratch, &sphere);
+    mesh_lod_test_chain("sphere", &chain, &sphere);
+    test_check(chain.level_count >= 4, "a sphere of %u triangles only made %u levels", sphere.index_count / 3,
+               chain.level_count);
+    for (u32 level = 0; level < chain.level_count; ++level) {
+        Mesh level_mesh = mesh_lod_level(&chain, level);
+        u32 open = mesh_lod_test_open_edges(&scratch, &level_mesh);
+        u32 inward = mesh_lod_test_inward_triangles(&level_mesh);
+        test_check(!open && !inward, "sphere, level %u: %u border or pinched edges, %u triangles facing in", level,
+                   open, inward);
+    }
+
+    // Bumpy, so the quadrics of neighbouring vertices disagree. Steep triangles may turn to face
+    // the origin without folding anything, so only closedness is checked.
+    {
+        Mesh bumpy = mesh_lod_test_sphere(&arena, &scratch, 32, 64);
+        arena_clear(&scratch);
+        for (u32 vertex = 0; vertex < bumpy.vertex_count; ++vertex) {
+            v3f p = bumpy.vertices[vertex].p;
+            f32 bump = 1.0f + 0.25f * sinf(5.0f * p.x) * sinf(4.0f * p.y) * sinf(3.0f * p.z + 1.0f);
+            bumpy.vertices[vertex].p = v3f_scale(p, bump);
+        }
+        Mesh_LOD_Chain bumpy_chain = mesh_lod_build(&arena, &scratch, &bumpy);
+        mesh_lod_test_chain("bumpy sphere", &bumpy_chain, &bumpy);
+        for (u32 level = 0; level < bumpy_chain.level_count; ++level) {
+            Mesh level_mesh = mesh_lod_level(&bumpy_chain, level);
+            u32 open = mesh_lod_test_open_edges(&scratch, &level_mesh);
+            test_check(!open, "bumpy sphere, level %u: %u border or pinched edges", level, open);
+        }
+    }
+
+    // A cube with a normal per face: every corner is three vertices at one position, all locked,
+    // so nothing can collapse and the chain is the cube alone.
+    {
+        Mesh_Vertex soup[36];
+        u32 soup_count = 0;
+        for (u32 face = 0; face < 6; ++face) {
+            u32 axis = face >> 1;
+            v3f normal = v3f_make(0.0f, 0.0f, 0.0f);
+            normal.v[axis] = (face & 1) ? 1.0f : -1.0f;
+            v3f corners[4];
+            for (u32 corner = 0; corner < 4; ++corner) {
+                v3f p = normal;
+                p.v[(axis + 1) % 3] = (corner & 1) ? 1.0f : -1.0f;
+                p.v[(axis + 2) % 3] = (corner & 2) ? 1.0f : -1.0f;
+                corners[corner] = p;
+            }
+            u32 order[6] = { 0, 1, 3, 3, 2, 0 };
+            for (u32 corner = 0; corner < 6; ++corner) {
+                soup[soup_count].p = corners[order[corner]];
+                soup[soup_count].normal = normal;
+                ++soup_count;
+            }
+        }
+        Mesh cube = mesh_build(&arena, &scratch, soup, soup_count);
+        Mesh_LOD_Chain cube_chain = mesh_lod_build(&arena, &scratch, &cube);
+        mesh_lod_test_chain("cube", &cube_chain, &cube);
+        test_check(cube_chain.level_count == 1, "a seam-locked cube made %u levels", cube_chain.level_count);
+        f32 error;
+        Mesh simplified = mesh_simplify(&arena, &scratch, &cube, 0, &error);
+        test_check((simplified.index_count == cube.index_count) && (error == 0.0f),
+                   "simplifying a seam-locked cube left %u of %u indices, error %g", simplified.index_count,
+                   cube.index_count, error);
+    }
+
+    // Selection for the sphere, scaled up 10 times, walking away from a camera at the origin
+    // looking down +z. Levels only get coarser with distance.
+    {
+        m44 view_projection = m44_mul(m44_look_at_lh(v3f_make(0.0f, 0.0f, 0.0f), v3f_make(0.0f, 0.0f, 1.0f),
+                                                     v3f_make(0.0f, 1.0f, 0.0f)),
+                                      m44_perspective_lh_z01(radians(60.0f), 9.0f / 16.0f, 0.1f, 10000.0f));
+        Mesh_LOD_View view = mesh_lod_view(view_projection, 1080, 1.0f);
+        f32 scale = 10.0f;
+        f32 radius = sphere.radius * scale;
+        u32 near_level = mesh_lod_select(&chain, &view, v3f_make(0.0f, 0.0f, radius * 0.5f), radius, scale);
+        test_check(near_level == 0, "the camera inside the sphere picked level %u", near_level);
+        near_level = mesh_lod_select(&chain, &view, v3f_make(0.0f, 0.0f, radius * 1.5f), radius, scale);
+        test_check(near_level == 0, "the sphere filling the view picked level %u", near_level);
+        // projected, the coarsest level's error is error * scale * pixels_per_unit / depth pixels
+        f32 far = 2.0f * chain.error[chain.level_count - 1] * scale * view.pixels_per_unit / view.pixel_error + radius;
+        u32 far_level = mesh_lod_select(&chain, &view, v3f_make(0.0f, 0.0f, far), radius, scale);
+        test_check(far_level == chain.level_count - 1, "the sphere far away picked level %u of %u", far_level,
+                   chain.level_count);
+
+        u32 previous = 0;
+        b32 monotonic = True;
+        u32 seen = 0;
+        for (f32 distance = radius * 1.5f; distance < far; distance *= 1.01f) {
+            u32 level = mesh_lod_select(&chain, &view, v3f_make(0.0f, 0.0f, distance), radius, scale);
+            monotonic = monotonic && (level >= previous);
+            seen |= 1u << level;
+            previous = level;
+        }
+        test_check(monotonic, "a level got finer further away");
+        test_check(seen == (1u << chain.level_count) - 1, "walking away only picked levels 0x%x of %u", seen, chain.level_count);
+
+        // errors are in local units, so a smaller instance reaches coarse levels sooner
+        u32 unscaled = mesh_lod_select(&chain, &view, v3f_make(0.0f, 0.0f, 200.0f), sphere.radius, 1.0f);
+        u32 scaled = mesh_lod_select(&chain, &view, v3f_make(0.0f, 0.0f, 200.0f), radius, scale);
+        test_check(unscaled >= scaled, "at the same distance the small sphere picked %u, the big one %u", unscaled,
+                   scaled);
+    }
+
+    arena_release(&scratch);
+    arena_release(&arena);
+}
+
+function void
+bench_mesh_lod(void) {
+    Arena arena = arena_reserve(gigabytes(1));
+    Arena scratch = arena_reserve(gigabytes(1));
+    Mesh sphere = mesh_lod_test_sphere(&arena, &scratch, 256, 512);
+    arena_clear(&scratch);
+
+    u64 arena_pos = arena.pos;
+    u64 best = ~0ull;
+    Mesh_LOD_Chain chain = { 0 };
+    for (u32 round = 0; round < 3; ++round) {
+        arena_pop_to(&arena, arena_pos);
+        u64 begin = os_time_ticks();
+        chain = mesh_lod_build(&arena, &scratch, &sphere);
+        u64 ticks = os_time_ticks() - begin;
+        best = ticks < best ? ticks : best;
+        arena_clear(&scratch);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "mesh_lod_build, %u levels, per triangle", chain.level_count);
+    bench_report(name, sphere.index_count / 3, best);
+
+    // instances scattered in front of the camera, as a frame's worth of selection would see them
+    m44 view_projection = m44_mul(m44_look_at_lh(v3f_make(0.0f, 0.0f, 0.0f), v3f_make(0.0f, 0.0f, 1.0f),
+                                                 v3f_make(0.0f, 1.0f, 0.0f)),
+                                  m44_perspective_lh_z01(radians(60.0f), 9.0f / 16.0f, 0.1f, 10000.0f));
+    Mesh_LOD_View view = mesh_lod_view(view_projection, 1080, 1.0f);
+    u32 count = 1000000;
+    v3f *centers = arena_push_array(&arena, v3f, count);
+    Test_Random random = test_random_make(200);
+    for (u32 index = 0; index < count; ++index) {
+        centers[index] = v3f_make(test_random_f32(&random, -500.0f, 500.0f), test_random_f32(&random, -50.0f, 50.0f),
+                                  test_random_f32(&random, 1.0f, 2000.0f));
+    }
+    best = ~0ull;
+    u64 sum = 0;
+    for (u32 round = 0; round < 5; ++round) {
+        u64 begin = os_time_ticks();
+        for (u32 index = 0; index < count; ++index) {
+            sum += mesh_lod_select(&chain, &view, centers[index], 2.0f, 2.0f);
+        }
+        u64 ticks = os_time_ticks() - begin;
+        best = ticks < best ? ticks : best;
+    }
+    bench_report("mesh_lod_select", count, best);
+    printf("  mean level %.2f\n", (f64)sum / (5.0 * count));
+
+    arena_release(&scratch);
+    arena_release(&arena);
+}
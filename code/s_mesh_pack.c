@@ -0,0 +1,145 @@
+function b32
+mesh_pack_write(Arena *scratch, String_Const_U8 path, char **names, Mesh *meshes, u32 mesh_count) {
+    u64 scratch_pos = scratch->pos;
+    b32 result = False;
+
+    u64 table_end = align_pow2(sizeof(Mesh_Pack_Header) + (u64)mesh_count * sizeof(Mesh_Pack_Entry), 16);
+    u64 file_size = table_end;
+    for (u32 mesh_index = 0; mesh_index < mesh_count; ++mesh_index) {
+        file_size += align_pow2((u64)meshes[mesh_index].vertex_count * sizeof(Mesh_Vertex), 16);
+        file_size += align_pow2((u64)meshes[mesh_index].index_count * sizeof(u32), 16);
+    }
+
+    u8 *file = (u8 *)arena_push(scratch, file_size, 16);
+    if (file) {
+        Mesh_Pack_Header *header = (Mesh_Pack_Header *)file;
+        header->magic = mesh_pack_magic;
+        header->version = mesh_pack_version;
+        header->mesh_count = mesh_count;
+        header->file_size = file_size;
+
+        Mesh_Pack_Entry *entries = (Mesh_Pack_Entry *)(header + 1);
+        u64 offset = table_end;
+        for (u32 mesh_index = 0; mesh_index < mesh_count; ++mesh_index) {
+            Mesh *mesh = meshes + mesh_index;
+            Mesh_Pack_Entry *entry = entries + mesh_index;
+            u64 name_length = strlen(names[mesh_index]);
+            name_length = name_length < mesh_pack_name_size - 1 ? name_length : mesh_pack_name_size - 1;
+            memory_copy(entry->name, names[mesh_index], name_length);
+            entry->vertex_count = mesh->vertex_count;
+            entry->index_count = mesh->index_count;
+            entry->radius = mesh->radius;
+
+            entry->vertex_offset = offset;
+            memory_copy(file + offset, mesh->vertices, (u64)mesh->vertex_count * sizeof(Mesh_Vertex));
+            offset += align_pow2((u64)mesh->vertex_count * sizeof(Mesh_Vertex), 16);
+            entry->index_offset = offset;
+            memory_copy(file + offset, mesh->indices, (u64)mesh->index_count * sizeof(u32));
+            offset += align_pow2((u64)mesh->index_count * sizeof(u32), 16);
+        }
+
+        result = os_write_entire_file(path, file, file_size);
+    }
+
+    arena_pop_to(scratch, scratch_pos);
+    return(result);
+}
+
+function b32
+mesh_pack_validate(OS_File_Map *map) {
+    if (map->size < sizeof(Mesh_Pack_Header)) {
+        return(False);
+    }
+
+    Mesh_Pack_Header *header = (Mesh_Pack_Header *)map->data;
+    if ((header->magic != mesh_pack_magic) ||
+        (header->version != mesh_pack_version) ||
+        (header->file_size != map->size)) {
+        return(False);
+    }
+
+    u64 table_end = sizeof(Mesh_Pack_Header) + (u64)header->mesh_count * sizeof(Mesh_Pack_Entry);
+    if (table_end > map->size) {
+        return(False);
+    }
+
+    Mesh_Pack_Entry *entries = (Mesh_Pack_Entry *)(header + 1);
+    for (u32 mesh_index = 0; mesh_index < header->mesh_count; ++mesh_index) {
+        Mesh_Pack_Entry *entry = entries + mesh_index;
+        u64 vertex_size = (u64)entry->vertex_count * sizeof(Mesh_Vertex);
+        u64 index_size = (u64)entry->index_count * sizeof(u32);
+        if ((entry->vertex_offset < table_end) || (entry->vertex_offset > map->size) ||
+            (vertex_size > map->size - entry->vertex_offset) ||
+            (entry->index_offset < table_end) || (entry->index_offset > map->size) ||
+            (index_size > map->size - entry->index_offset) ||
+            (entry->vertex_offset & 15) || (entry->index_offset & 15) ||
+            (entry->name[mesh_pack_name_size - 1] != 0) || (entry->index_count % 3)) {
+            return(False);
+        }
+
+        // the rasterizer and LOD building index vertices[] with these as they are
+        u32 *indices = (u32 *)((u8 *)map->data + entry->index_offset);
+        u32 max_index = 0;
+        for (u32 index = 0; index < entry->index_count; ++index) {
+            max_index = indices[index] > max_index ? indices[index] : max_index;
+        }
+        if (entry->index_count && (max_index >= entry->vertex_count)) {
+            return(False);
+        }
+    }
+
+    return(True);
+}
+
+function b32
+mesh_pack_open(Mesh_Pack *pack, String_Const_U8 path) {
+    Mesh_Pack zero = { 0 };
+    *pack = zero;
+
+    pack->map = os_map_file(path);
+    if (pack->map.data) {
+        if (mesh_pack_validate(&pack->map)) {
+            Mesh_Pack_Header *header = (Mesh_Pack_Header *)pack->map.data;
+            pack->entries = (Mesh_Pack_Entry *)(header + 1);
+            pack->mesh_count = header->mesh_count;
+        } else {
+            os_unmap_file(&pack->map);
+        }
+    }
+
+    b32 result = pack->map.data != null;
+    return(result);
+}
+
+function u32
+mesh_pack_find(Mesh_Pack *pack, char *name) {
+    u32 result = ~0u;
+    for (u32 mesh_index = 0; mesh_index < pack->mesh_count; ++mesh_index) {
+        if (strcmp(pack->entries[mesh_index].name, name) == 0) {
+            result = mesh_index;
+            break;
+        }
+    }
+    return(result);
+}
+
+function Mesh
+mesh_pack_get(Mesh_Pack *pack, u32 index) {
+    Mesh result = { 0 };
+    if (index < pack->mesh_count) {
+        Mesh_Pack_Entry *entry = pack->entries + index;
+        result.vertices = (Mesh_Vertex *)((u8 *)pack->map.data + entry->vertex_offset);
+        result.vertex_count = entry->vertex_count;
+        result.indices = (u32 *)((u8 *)pack->map.data + entry->index_offset);
+        result.index_count = entry->index_count;
+        result.radius = entry->radius;
+    }
+    return(result);
+}
+
+function void
+mesh_pack_close(Mesh_Pack *pack) {
+    os_unmap_file(&pack->map);
+    Mesh_Pack zero = { 0 };
+    *pack = zero;
+}
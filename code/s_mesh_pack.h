@@ -0,0 +1,51 @@
+#if !defined(S_MESH_PACK_H)
+#define S_MESH_PACK_H
+
+// Meshes after mesh_build, stored exactly as the GPU buffers want them, so loading is mapping the
+// file and pointing CreateBuffer (or the soft rasterizer) at it:
+//   Mesh_Pack_Header
+//   Mesh_Pack_Entry[mesh_count]
+//   per mesh: Mesh_Vertex[vertex_count], then u32 indices[index_count], each 16-byte aligned
+// Opening checks the header, that every range lies inside the file, and that every mesh is whole
+// triangles whose indices are all below its vertex_count. Vertices are used as they are.
+
+#define mesh_pack_magic 0x314b504d // "MPK1"
+#define mesh_pack_version 1
+#define mesh_pack_name_size 48
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 mesh_count;
+    u32 __unused_a;
+    u64 file_size;
+} Mesh_Pack_Header;
+
+typedef struct {
+    // null-terminated
+    char name[mesh_pack_name_size];
+    u64 vertex_offset;
+    u64 index_offset;
+    u32 vertex_count;
+    u32 index_count;
+    f32 radius;
+    u32 __unused_a;
+} Mesh_Pack_Entry;
+
+typedef struct {
+    OS_File_Map map;
+    Mesh_Pack_Entry *entries;
+    u32 mesh_count;
+} Mesh_Pack;
+
+// Names longer than mesh_pack_name_size - 1 are cut.
+function b32 mesh_pack_write(Arena *scratch, String_Const_U8 path, char **names, Mesh *meshes, u32 mesh_count);
+// False when the file is missing or doesn't check out.
+function b32 mesh_pack_open(Mesh_Pack *pack, String_Const_U8 path);
+// ~0u when there's no such mesh.
+function u32 mesh_pack_find(Mesh_Pack *pack, char *name);
+// Points into the mapping, valid until mesh_pack_close.
+function Mesh mesh_pack_get(Mesh_Pack *pack, u32 index);
+function void mesh_pack_close(Mesh_Pack *pack);
+
+#endif
@@ -0,0 +1,114 @@
+// Mesh packs: what mesh_pack_write writes comes back from mesh_pack_open as it went in, and packs
+// that are broken, in their ranges or in the index values everything downstream trusts, don't
+// open at all.
+
+function void
+test_mesh_pack(void) {
+    Arena arena = arena_reserve(megabytes(64));
+    char path_z[64];
+    snprintf(path_z, sizeof(path_z), "/tmp/s_test_mesh_%d.pack", (int)getpid());
+    String_Const_U8 path = str8_make(path_z, strlen(path_z));
+
+    // a quad, an empty mesh and a strip of triangles over random vertices
+    Test_Random random = test_random_make(180);
+    Mesh meshes[3] = { 0 };
+    char *names[3] = { "quad", "empty", "a name far too long to fit in the forty-eight bytes of an entry" };
+    Mesh_Vertex quad_vertices[4];
+    u32 quad_indices[6] = { 0, 1, 2, 2, 3, 0 };
+    for (u32 vertex = 0; vertex < 4; ++vertex) {
+        quad_vertices[vertex].p = v3f_make((f32)(vertex & 1), (f32)(vertex >> 1), 0.0f);
+        quad_vertices[vertex].normal = v3f_make(0.0f, 0.0f, -1.0f);
+    }
+    meshes[0].vertices = quad_vertices;
+    meshes[0].vertex_count = 4;
+    meshes[0].indices = quad_indices;
+    meshes[0].index_count = 6;
+    meshes[0].radius = 1.5f;
+    meshes[2].vertex_count = 101;
+    meshes[2].index_count = 99 * 3;
+    meshes[2].vertices = arena_push_array(&arena, Mesh_Vertex, meshes[2].vertex_count);
+    meshes[2].indices = arena_push_array(&arena, u32, meshes[2].index_count);
+    for (u32 vertex = 0; vertex < meshes[2].vertex_count; ++vertex) {
+        meshes[2].vertices[vertex].p = test_random_v3f(&random, -1.0f, 1.0f);
+        meshes[2].vertices[vertex].normal = test_random_v3f(&random, -1.0f, 1.0f);
+    }
+    for (u32 index = 0; index < meshes[2].index_count; ++index) {
+        meshes[2].indices[index] = index / 3 + index % 3;
+    }
+    meshes[2].radius = 2.0f;
+
+    b32 written = mesh_pack_write(&arena, path, names, meshes, array_count(meshes));
+    test_check(written, "couldn't write %s", path_z);
+    Mesh_Pack pack;
+    if (test_check(written && mesh_pack_open(&pack, path), "couldn't open what was written")) {
+        test_check(pack.mesh_count == 3, "%u meshes came back", pack.mesh_count);
+        for (u32 mesh_index = 0; mesh_index < array_count(meshes) && (pack.mesh_count == 3); ++mesh_index) {
+            Mesh mesh = mesh_pack_get(&pack, mesh_index);
+            Mesh *original = meshes + mesh_index;
+            b32 same = (mesh.vertex_count == original->vertex_count) && (mesh.index_count == original->index_count) &&
+                (mesh.radius == original->radius);
+            same = same && (!mesh.vertex_count ||
+                            (memory_compare(mesh.vertices, original->vertices, mesh.vertex_count * sizeof(Mesh_Vertex)) == 0));
+            same = same && (!mesh.index_count ||
+                            (memory_compare(mesh.indices, original->indices, mesh.index_count * sizeof(u32)) == 0));
+            test_check(same, "mesh %u came back different", mesh_index);
+        }
+        test_check((mesh_pack_find(&pack, "quad") == 0) && (mesh_pack_find(&pack, "empty") == 1) &&
+                   (mesh_pack_find(&pack, "missing") == ~0u), "mesh_pack_find");
+        test_check(strlen(pack.entries[2].name) == mesh_pack_name_size - 1, "a long name wasn't cut");
+        Mesh none = mesh_pack_get(&pack, 3);
+        test_check(!none.vertices && !none.indices, "mesh_pack_get past the end gave a mesh");
+        mesh_pack_close(&pack);
+    }
+
+    // every way of breaking it, each on a fresh copy of the good file
+    OS_File_Map map = os_map_file(path);
+    u64 size = map.size;
+    u8 *good = (u8 *)arena_push(&arena, size, 16);
+    u8 *file = (u8 *)arena_push(&arena, size, 16);
+    if (map.data) {
+        memory_copy(good, map.data, size);
+    }
+    os_unmap_file(&map);
+
+    Mesh_Pack_Header *header = (Mesh_Pack_Header *)file;
+    Mesh_Pack_Entry *entries = (Mesh_Pack_Entry *)(header + 1);
+    char *breakages[] = {
+        "index one past the vertices", "index 0xFFFFFFFF", "bad index in the last triangle", "index_count not whole triangles",
+        "index_count 1", "magic", "version", "file_size", "truncated", "vertex range past the end",
+        "index range past the end", "vertex offset inside the table", "index offset unaligned", "name not terminated",
+        "mesh_count past the file",
+    };
+    for (u32 breakage = 0; breakage < array_count(breakages); ++breakage) {
+        memory_copy(file, good, size);
+        u64 write_size = size;
+        u32 *quad = (u32 *)(file + entries[0].index_offset);
+        u32 *strip = (u32 *)(file + entries[2].index_offset);
+        switch (breakage) {
+            case 0: quad[4] = 4; break;
+            case 1: quad[0] = 0xFFFFFFFF; break;
+            case 2: strip[entries[2].index_count - 1] = entries[2].vertex_count; break;
+            case 3: entries[2].index_count -= 2; break;
+            case 4: entries[0].index_count = 1; break;
+            case 5: header->magic ^= 1; break;
+            case 6: header->version += 1; break;
+            case 7: header->file_size += 16; break;
+            case 8: write_size -= 16; break;
+            case 9: entries[2].vertex_count = 0x10000000; break;
+            case 10: entries[2].index_offset = size - 16; break;
+            case 11: entries[0].vertex_offset = 16; break;
+            case 12: entries[2].index_offset += 4; break;
+            case 13: memset(entries[1].name, 'x', mesh_pack_name_size); break;
+            case 14: header->mesh_count = 0x01000000; break;
+        }
+        os_write_entire_file(path, file, write_size);
+        b32 opened = mesh_pack_open(&pack, path);
+        test_check(!opened, "a pack with a broken %s opened", breakages[breakage]);
+        if (opened) {
+            mesh_pack_close(&pack);
+        }
+    }
+
+    unlink(path_z);
+    arena_release(&arena);
+}
@@ -0,0 +1,282 @@
+// Meshes: welding counts what it should on soups whose answer is known, and no optimizer changes
+// what's drawn. After every step the mesh's triangles, as vertex values with their winding, are
+// the soup's, and its indices stay below vertex_count. The optimizers have to earn their keep on a
+// shuffled grid too.
+
+// Same as the mesh tool's: size x size quads in the xz plane, facing up, row by row.
+function Mesh_Vertex *
+mesh_test_grid_soup(Arena *arena, u32 size, u32 *soup_count) {
+    *soup_count = size * size * 6;
+    Mesh_Vertex *result = arena_push_array(arena, Mesh_Vertex, *soup_count);
+    Mesh_Vertex *out = result;
+    for (u32 z = 0; z < size; ++z) {
+        for (u32 x = 0; x < size; ++x) {
+            v3f p00 = v3f_make((f32)x, 0.0f, (f32)z);
+            v3f p10 = v3f_make((f32)(x + 1), 0.0f, (f32)z);
+            v3f p01 = v3f_make((f32)x, 0.0f, (f32)(z + 1));
+            v3f p11 = v3f_make((f32)(x + 1), 0.0f, (f32)(z + 1));
+            v3f corners[6] = { p00, p01, p11, p11, p10, p00 };
+            for (u32 corner = 0; corner < 6; ++corner) {
+                out->p = corners[corner];
+                out->normal = v3f_make(0.0f, 1.0f, 0.0f);
+                ++out;
+            }
+        }
+    }
+    return(result);
+}
+
+// Same as the mesh tool's: a closed UV sphere of radius 1 with smooth normals, clockwise from
+// outside. The seam and the poles use exact values, so they weld, +0 at the poles rather than the
+// -0 that 0 * cos gives in half the slices.
+function Mesh_Vertex *
+mesh_test_sphere_soup(Arena *arena, u32 stacks, u32 slices, u32 *soup_count) {
+    *soup_count = stacks * slices * 6;
+    Mesh_Vertex *result = arena_push_array(arena, Mesh_Vertex, *soup_count);
+    Mesh_Vertex *out = result;
+    for (u32 stack = 0; stack < stacks; ++stack) {
+        for (u32 slice = 0; slice < slices; ++slice) {
+            v3f p[4];
+            for (u32 corner = 0; corner < 4; ++corner) {
+                u32 s = stack + (corner >> 1);
+                u32 l = (slice + (corner & 1)) % slices;
+                f32 theta = pi_f32 * (f32)s / (f32)stacks;
+                f32 phi = 2.0f * pi_f32 * (f32)l / (f32)slices;
+                f32 ring = (s == 0 || s == stacks) ? 0.0f : sinf(theta);
+                f32 y = s == 0 ? 1.0f : (s == stacks ? -1.0f : cosf(theta));
+                p[corner] = v3f_make(ring * cosf(phi), y, ring * sinf(phi));
+                if (ring == 0.0f) {
+                    p[corner].x = 0.0f;
+                    p[corner].z = 0.0f;
+                }
+            }
+            v3f corners[6] = { p[0], p[1], p[3], p[3], p[2], p[0] };
+            for (u32 corner = 0; corner < 6; ++corner) {
+                out->p = corners[corner];
+                out->normal = corners[corner];
+                ++out;
+            }
+        }
+    }
+    return(result);
+}
+
+function void
+mesh_test_shuffle_triangles(Mesh_Vertex *soup, u32 soup_count, u64 seed) {
+    Test_Random random = test_random_make(seed);
+    for (u32 triangle = soup_count / 3; triangle > 1; --triangle) {
+        u32 other = test_random_u32(&random) % triangle;
+        for (u32 corner = 0; corner < 3; ++corner) {
+            Mesh_Vertex swap = soup[(triangle - 1) * 3 + corner];
+            soup[(triangle - 1) * 3 + corner] = soup[other * 3 + corner];
+            soup[other * 3 + corner] = swap;
+        }
+    }
+}
+
+function int
+mesh_test_compare_triangles(const void *a, const void *b) {
+    int result = memcmp(a, b, 3 * sizeof(Mesh_Vertex));
+    return(result);
+}
+
+// Every triangle rotated to start at its smallest corner, which keeps the winding, then sorted.
+function void
+mesh_test_canonical(Mesh_Vertex *triangles, u32 triangle_count) {
+    for (u32 triangle = 0; triangle < triangle_count; ++triangle) {
+        Mesh_Vertex *corners = triangles + triangle * 3;
+        u32 first = 0;
+        for (u32 corner = 1; corner < 3; ++corner) {
+            if (memcmp(corners + corner, corners + first, sizeof(Mesh_Vertex)) < 0) {
+                first = corner;
+            }
+        }
+        Mesh_Vertex rotated[3] = { corners[first], corners[(first + 1) % 3], corners[(first + 2) % 3] };
+        memory_copy(corners, rotated, sizeof(rotated));
+    }
+    qsort(triangles, triangle_count, 3 * sizeof(Mesh_Vertex), mesh_test_compare_triangles);
+}
+
+// soup must already be canonical. Checks the indices first, the triangles are only looked up if
+// they're all in range. scratch is returned as it was.
+function void
+mesh_test_check_mesh(Arena *scratch, char *name, char *step, Mesh *mesh, Mesh_Vertex *soup, u32 soup_count) {
+    u64 scratch_pos = scratch->pos;
+    u32 out_of_range = 0;
+    for (u32 index = 0; index < mesh->index_count; ++index) {
+        out_of_range += mesh->indices[index] >= mesh->vertex_count;
+    }
+    b32 valid = test_check(!out_of_range && (mesh->index_count == soup_count),
+                           "%s after %s: %u of %u indices past %u vertices, %u in the soup", name, step, out_of_range,
+                           mesh->index_count, mesh->vertex_count, soup_count);
+    if (valid) {
+        Mesh_Vertex *triangles = arena_push_array(scratch, Mesh_Vertex, mesh->index_count);
+        for (u32 index = 0; index < mesh->index_count; ++index) {
+            triangles[index] = mesh->vertices[mesh->indices[index]];
+        }
+        mesh_test_canonical(triangles, mesh->index_count / 3);
+        test_check(memory_compare(triangles, soup, soup_count * sizeof(Mesh_Vertex)) == 0,
+                   "%s after %s: the triangles aren't the soup's", name, step);
+    }
+    arena_pop_to(scratch, scratch_pos);
+}
+
+// Every step of mesh_build in turn, each checked against the soup. Returns the final mesh.
+function Mesh
+mesh_test_build(Arena *arena, Arena *scratch, char *name, Mesh_Vertex *soup, u32 soup_count) {
+    Mesh_Vertex *canonical = arena_push_array(scratch, Mesh_Vertex, soup_count);
+    memory_copy(canonical, soup, soup_count * sizeof(Mesh_Vertex));
+    mesh_test_canonical(canonical, soup_count / 3);
+
+    Mesh mesh = mesh_weld(arena, scratch, soup, soup_count);
+    mesh_test_check_mesh(scratch, name, "mesh_weld", &mesh, canonical, soup_count);
+    mesh_optimize_vertex_cache(scratch, mesh.indices, mesh.index_count, mesh.vertex_count);
+    mesh_test_check_mesh(scratch, name, "mesh_optimize_vertex_cache", &mesh, canonical, soup_count);
+    mesh_optimize_overdraw(scratch, mesh.indices, mesh.index_count, mesh.vertices, mesh.vertex_count,
+                           mesh_overdraw_threshold);
+    mesh_test_check_mesh(scratch, name, "mesh_optimize_overdraw", &mesh, canonical, soup_count);
+    mesh_optimize_vertex_fetch(scratch, &mesh);
+    mesh_test_check_mesh(scratch, name, "mesh_optimize_vertex_fetch", &mesh, canonical, soup_count);
+    return(mesh);
+}
+
+function void
+test_mesh(void) {
+    Arena arena = arena_reserve(megabytes(256));
+    Arena scratch = arena_reserve(megabytes(256));
+
+    // a grid welds to its (size + 1)^2 corners
+    {
+        u32 soup_count;
+        Mesh_Vertex *soup = mesh_test_grid_soup(&arena, 8, &soup_count);
+        Mesh mesh = mesh_test_build(&arena, &scratch, "grid", soup, soup_count);
+        test_check(mesh.vertex_count == 81, "an 8x8 grid welded to %u vertices, expected 81", mesh.vertex_count);
+        test_check(fabsf(mesh.radius - sqrtf(128.0f)) < 1e-5f, "grid radius %g", mesh.radius);
+    }
+
+    // a sphere welds its seam and its poles: (stacks - 1) rings of slices and 2 poles
+    {
+        u32 soup_count;
+        Mesh_Vertex *soup = mesh_test_sphere_soup(&arena, 12, 24, &soup_count);
+        Mesh mesh = mesh_test_build(&arena, &scratch, "sphere", soup, soup_count);
+        test_check(mesh.vertex_count == 11 * 24 + 2, "a 12x24 sphere welded to %u vertices, expected %u",
+                   mesh.vertex_count, 11 * 24 + 2);
+    }
+
+    // A cube with a normal per face keeps its corners apart: a differing normal or -0 is a
+    // different vertex, as the bits are compared.
+    {
+        Mesh_Vertex soup[36 + 6];
+        u32 soup_count = 0;
+        for (u32 face = 0; face < 6; ++face) {
+            u32 axis = face >> 1;
+            f32 side = (face & 1) ? 1.0f : -1.0f;
+            v3f normal = v3f_make(0.0f, 0.0f, 0.0f);
+            normal.v[axis] = side;
+            v3f corners[4];
+            for (u32 corner = 0; corner < 4; ++corner) {
+                v3f p = normal;
+                p.v[(axis + 1) % 3] = (corner & 1) ? 1.0f : -1.0f;
+                p.v[(axis + 2) % 3] = (corner & 2) ? 1.0f : -1.0f;
+                corners[corner] = p;
+            }
+            u32 order[6] = { 0, 1, 3, 3, 2, 0 };
+            for (u32 corner = 0; corner < 6; ++corner) {
+                soup[soup_count].p = corners[order[corner]];
+                soup[soup_count].normal = normal;
+                ++soup_count;
+            }
+        }
+        Mesh cube = mesh_test_build(&arena, &scratch, "cube", soup, soup_count);
+        test_check(cube.vertex_count == 24, "a flat shaded cube welded to %u vertices, expected 24", cube.vertex_count);
+
+        // The first face again, moved and flattened onto y = 0 with every other corner at -0. Its
+        // four corners become two positions, each with a y of both signs: 4 vertices, not 2.
+        for (u32 corner = 0; corner < 6; ++corner) {
+            soup[soup_count] = soup[corner];
+            soup[soup_count].p.x += 3.0f;
+            soup[soup_count].p.y = 0.0f;
+            if (corner & 1) {
+                soup[soup_count].p.y = -0.0f;
+            }
+            ++soup_count;
+        }
+        Mesh signed_zero = mesh_weld(&arena, &scratch, soup, soup_count);
+        u32 expected = 24 + 4;
+        test_check(signed_zero.vertex_count == expected, "-0 welded with 0: %u vertices, expected %u",
+                   signed_zero.vertex_count, expected);
+    }
+
+    // Shuffled, a grid is about as bad as it gets for the cache. Forsyth has to win most of that
+    // back, the overdraw clusters may only give up mesh_overdraw_threshold of it, and renumbering
+    // doesn't change which corners hit the cache but does walk the buffer forward.
+    {
+        u32 soup_count;
+        Mesh_Vertex *soup = mesh_test_grid_soup(&arena, 64, &soup_count);
+        mesh_test_shuffle_triangles(soup, soup_count, 170);
+        Mesh mesh = mesh_weld(&arena, &scratch, soup, soup_count);
+        Mesh_Stats welded = mesh_analyze(&scratch, &mesh, mesh_fifo_cache_size);
+        mesh_optimize_vertex_cache(&scratch, mesh.indices, mesh.index_count, mesh.vertex_count);
+        Mesh_Stats cached = mesh_analyze(&scratch, &mesh, mesh_fifo_cache_size);
+        mesh_optimize_overdraw(&scratch, mesh.indices, mesh.index_count, mesh.vertices, mesh.vertex_count,
+                               mesh_overdraw_threshold);
+        Mesh_Stats clustered = mesh_analyze(&scratch, &mesh, mesh_fifo_cache_size);
+        mesh_optimize_vertex_fetch(&scratch, &mesh);
+        Mesh_Stats fetched = mesh_analyze(&scratch, &mesh, mesh_fifo_cache_size);
+
+        test_check((welded.acmr > 2.0f) && (cached.acmr < 0.8f), "shuffled grid ACMR %.3f, after the vertex cache %.3f",
+                   welded.acmr, cached.acmr);
+        test_check(clustered.acmr <= cached.acmr * mesh_overdraw_threshold + 1e-4f,
+                   "the overdraw clusters took ACMR from %.3f to %.3f", cached.acmr, clustered.acmr);
+        test_check(fetched.transformed == clustered.transformed, "renumbering vertices changed the cache misses, %u to %u",
+                   clustered.transformed, fetched.transformed);
+        test_check(fetched.overfetch < clustered.overfetch,
+                   "overfetch %.3f after renumbering, %.3f before", fetched.overfetch, clustered.overfetch);
+
+        // first uses come in vertex order
+        u32 next = 0;
+        b32 ordered = True;
+        for (u32 index = 0; index < mesh.index_count; ++index) {
+            if (mesh.indices[index] == next) {
+                ++next;
+            } else {
+                ordered = ordered && (mesh.indices[index] < next);
+            }
+        }
+        test_check(ordered && (next == mesh.vertex_count), "vertices aren't numbered by first use");
+    }
+
+    // vertices nothing references are dropped by the renumbering
+    {
+        Mesh_Vertex vertices[5] = { 0 };
+        for (u32 vertex = 0; vertex < 5; ++vertex) {
+            vertices[vertex].p = v3f_make((f32)vertex, 0.0f, 0.0f);
+        }
+        u32 indices[6] = { 4, 2, 0, 0, 2, 3 };
+        Mesh mesh = { 0 };
+        mesh.vertices = vertices;
+        mesh.vertex_count = 5;
+        mesh.indices = indices;
+        mesh.index_count = 6;
+        mesh_optimize_vertex_fetch(&scratch, &mesh);
+        u32 expected_indices[6] = { 0, 1, 2, 2, 1, 3 };
+        f32 expected_x[4] = { 4.0f, 2.0f, 0.0f, 3.0f };
+        b32 same = (mesh.vertex_count == 4) && (memory_compare(indices, expected_indices, sizeof(indices)) == 0);
+        for (u32 vertex = 0; same && (vertex < 4); ++vertex) {
+            same = vertices[vertex].p.x == expected_x[vertex];
+        }
+        test_check(same, "renumbering 5 vertices with one unused gave %u vertices", mesh.vertex_count);
+    }
+
+    // shuffled soups through every step, triangles checked after each
+    for (u32 seed = 0; seed < 4; ++seed) {
+        u32 soup_count;
+        Mesh_Vertex *soup = mesh_test_sphere_soup(&arena, 16 + seed * 8, 32 + seed * 4, &soup_count);
+        mesh_test_shuffle_triangles(soup, soup_count, 171 + seed);
+        mesh_test_build(&arena, &scratch, "shuffled sphere", soup, soup_count);
+        arena_clear(&scratch);
+    }
+
+    arena_release(&scratch);
+    arena_release(&arena);
+}
@@ -0,0 +1,447 @@
+// Mesh tool, Linux.
+//
+// usage: s_mesh_tool [grid_size]
+//            Synthetic meshes through every mesh_build step, reporting what each does to the
+//            post-transform cache and vertex fetch.
+//        s_mesh_tool sphere out.obj [size]
+//            Writes a UV sphere as OBJ, something to feed the others.
+//        s_mesh_tool pack out.pack in.obj...
+//            Parses, builds and packs. s_headless and the D3D11 build draw the first mesh.
+//        s_mesh_tool load in.obj in.pack [runs]
+//            Load throughput of both paths: parsing the OBJ versus mapping the pack and copying it
+//            out the way CreateBuffer would.
+//        s_mesh_tool quantize in.pack
+//            Encodes the pack's meshes in every vertex format and fails if a decoded position or
+//            normal is further off than the format's error bound.
+//        s_mesh_tool lod [in.pack] [sphere_size]
+//            Builds the LOD chain of a sphere and of the pack's meshes, reporting every level's
+//            triangles, error and post-transform cache and how long the chain took.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+
+#include "s_base.h"
+#include "s_os.h"
+#include "s_simd.h"
+#include "s_math.h"
+#include "s_job.h"
+#include "s_mesh.h"
+#include "s_mesh_lod.h"
+#include "s_mesh_pack.h"
+#include "s_obj.h"
+#include "s_shader_cache.h"
+#include "s_vertex_format.h"
+
+#include "s_base.c"
+#include "s_os.c"
+#include "s_os_linux.c"
+#include "s_simd.c"
+#include "s_math.c"
+#include "s_job.c"
+#include "s_mesh.c"
+#include "s_mesh_lod.c"
+#include "s_mesh_pack.c"
+#include "s_obj.c"
+#include "s_shader_cache.c"
+#include "s_vertex_format.c"
+
+function u32
+tool_random(u32 *state) {
+    // xorshift, like game_add_scatter
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return(*state);
+}
+
+// Triangles in a random order, the way an exporter that doesn't care might write them.
+function void
+tool_shuffle_triangles(Mesh_Vertex *soup, u32 soup_count, u32 seed) {
+    u32 state = seed;
+    for (u32 triangle = soup_count / 3; triangle > 1; --triangle) {
+        u32 other = tool_random(&state) % triangle;
+        for (u32 corner = 0; corner < 3; ++corner) {
+            Mesh_Vertex swap = soup[(triangle - 1) * 3 + corner];
+            soup[(triangle - 1) * 3 + corner] = soup[other * 3 + corner];
+            soup[other * 3 + corner] = swap;
+        }
+    }
+}
+
+// size x size quads in the xz plane, row by row.
+function Mesh_Vertex *
+tool_grid_soup(Arena *arena, u32 size, u32 *soup_count) {
+    *soup_count = size * size * 6;
+    Mesh_Vertex *result = arena_push_array(arena, Mesh_Vertex, *soup_count);
+    Mesh_Vertex *out = result;
+    v3f up = v3f_make(0.0f, 1.0f, 0.0f);
+    for (u32 z = 0; z < size; ++z) {
+        for (u32 x = 0; x < size; ++x) {
+            v3f p00 = v3f_make((f32)x, 0.0f, (f32)z);
+            v3f p10 = v3f_make((f32)(x + 1), 0.0f, (f32)z);
+            v3f p01 = v3f_make((f32)x, 0.0f, (f32)(z + 1));
+            v3f p11 = v3f_make((f32)(x + 1), 0.0f, (f32)(z + 1));
+            v3f corners[6] = { p00, p01, p11, p11, p10, p00 };
+            for (u32 corner = 0; corner < 6; ++corner) {
+                out->p = corners[corner];
+                out->normal = up;
+                ++out;
+            }
+        }
+    }
+    return(result);
+}
+
+// A UV sphere of radius 1, smooth normals.
+function Mesh_Vertex *
+tool_sphere_soup(Arena *arena, u32 stacks, u32 slices, u32 *soup_count) {
+    *soup_count = stacks * slices * 6;
+    Mesh_Vertex *result = arena_push_array(arena, Mesh_Vertex, *soup_count);
+    Mesh_Vertex *out = result;
+    for (u32 stack = 0; stack < stacks; ++stack) {
+        for (u32 slice = 0; slice < slices; ++slice) {
+            v3f p[4];
+            for (u32 corner = 0; corner < 4; ++corner) {
+                // the seam and the poles use exact values, so they weld
+                u32 s = stack + (corner >> 1);
+                u32 l = (slice + (corner & 1)) % slices;
+                f32 theta = pi_f32 * (f32)s / (f32)stacks;
+                f32 phi = 2.0f * pi_f32 * (f32)l / (f32)slices;
+                f32 ring = (s == 0 || s == stacks) ? 0.0f : sinf(theta);
+                f32 y = s == 0 ? 1.0f : (s == stacks ? -1.0f : cosf(theta));
+                p[corner] = v3f_make(ring * cosf(phi), y, ring * sinf(phi));
+                // 0 * cos is -0 in half the slices, which wouldn't weld with 0
+                if (ring == 0.0f) {
+                    p[corner].x = 0.0f;
+                    p[corner].z = 0.0f;
+                }
+            }
+            v3f corners[6] = { p[0], p[1], p[3], p[3], p[2], p[0] };
+            for (u32 corner = 0; corner < 6; ++corner) {
+                out->p = corners[corner];
+                out->normal = corners[corner];
+                ++out;
+            }
+        }
+    }
+    return(result);
+}
+
+function void
+tool_print_stats(char *step, Arena *scratch, Mesh *mesh, u64 microseconds) {
+    Mesh_Stats stats = mesh_analyze(scratch, mesh, mesh_fifo_cache_size);
+    printf("  %-13s ACMR %.3f  ATVR %.3f  overfetch %.2f  %8.2f ms\n", step, stats.acmr, stats.atvr, stats.overfetch,
+           (f64)microseconds / 1000.0);
+}
+
+function void
+tool_report(char *name, Arena *arena, Arena *scratch, Mesh_Vertex *soup, u32 soup_count) {
+    u64 start = os_time_microseconds();
+    Mesh mesh = mesh_weld(arena, scratch, soup, soup_count);
+    u64 weld_time = os_time_microseconds() - start;
+    printf("%s: %u triangles, %u soup vertices welded to %u\n", name, mesh.index_count / 3, soup_count,
+           mesh.vertex_count);
+    tool_print_stats("welded", scratch, &mesh, weld_time);
+
+    start = os_time_microseconds();
+    mesh_optimize_vertex_cache(scratch, mesh.indices, mesh.index_count, mesh.vertex_count);
+    tool_print_stats("vertex cache", scratch, &mesh, os_time_microseconds() - start);
+
+    start = os_time_microseconds();
+    mesh_optimize_overdraw(scratch, mesh.indices, mesh.index_count, mesh.vertices, mesh.vertex_count,
+                           mesh_overdraw_threshold);
+    tool_print_stats("overdraw", scratch, &mesh, os_time_microseconds() - start);
+
+    start = os_time_microseconds();
+    mesh_optimize_vertex_fetch(scratch, &mesh);
+    tool_print_stats("vertex fetch", scratch, &mesh, os_time_microseconds() - start);
+}
+
+function int
+tool_compare_u64(const void *a, const void *b) {
+    u64 x = *(const u64 *)a;
+    u64 y = *(const u64 *)b;
+    int result = (x > y) - (x < y);
+    return(result);
+}
+
+function String_Const_U8
+tool_str8(char *string) {
+    String_Const_U8 result = str8_make(string, strlen(string));
+    return(result);
+}
+
+// The same sphere as tool_sphere_soup, in OBJ's right-handed space.
+function b32
+tool_write_sphere_obj(Arena *arena, char *path, u32 stacks, u32 slices) {
+    u64 arena_pos = arena->pos;
+    // generous per line
+    u64 capacity = ((u64)(stacks + 1) * slices * 2 + (u64)stacks * slices * 2) * 96 + 64;
+    char *text = (char *)arena_push(arena, capacity, 16);
+    u64 size = 0;
+    size += (u64)snprintf(text + size, capacity - size, "# UV sphere, %u stacks, %u slices\n", stacks, slices);
+    for (u32 stack = 0; stack <= stacks; ++stack) {
+        for (u32 slice = 0; slice < slices; ++slice) {
+            f32 theta = pi_f32 * (f32)stack / (f32)stacks;
+            f32 phi = 2.0f * pi_f32 * (f32)slice / (f32)slices;
+            f32 ring = (stack == 0 || stack == stacks) ? 0.0f : sinf(theta);
+            f32 y = stack == 0 ? 1.0f : (stack == stacks ? -1.0f : cosf(theta));
+            v3f p = v3f_make(ring * cosf(phi), y, -ring * sinf(phi));
+            // written as -0.000000 otherwise, see tool_sphere_soup
+            if (ring == 0.0f) {
+                p.x = 0.0f;
+                p.z = 0.0f;
+            }
+            size += (u64)snprintf(text + size, capacity - size, "v %.6f %.6f %.6f\nvn %.6f %.6f %.6f\n",
+                                  p.x, p.y, p.z, p.x, p.y, p.z);
+        }
+    }
+    for (u32 stack = 0; stack < stacks; ++stack) {
+        for (u32 slice = 0; slice < slices; ++slice) {
+            // 1-based, corners as in tool_sphere_soup but the other way round: z is mirrored, so
+            // OBJ's counter-clockwise is tool_sphere_soup's order reversed
+            u32 p[4];
+            for (u32 corner = 0; corner < 4; ++corner) {
+                p[corner] = (stack + (corner >> 1)) * slices + (slice + (corner & 1)) % slices + 1;
+            }
+            size += (u64)snprintf(text + size, capacity - size, "f %u//%u %u//%u %u//%u\nf %u//%u %u//%u %u//%u\n",
+                                  p[0], p[0], p[3], p[3], p[1], p[1], p[0], p[0], p[2], p[2], p[3], p[3]);
+        }
+    }
+    b32 result = os_write_entire_file(tool_str8(path), text, size);
+    arena_pop_to(arena, arena_pos);
+    return(result);
+}
+
+// The file's name without directories or extension.
+function char *
+tool_mesh_name(Arena *arena, char *path) {
+    char *start = strrchr(path, '/');
+    start = start ? start + 1 : path;
+    char *dot = strrchr(start, '.');
+    u64 length = dot ? (u64)(dot - start) : strlen(start);
+    char *result = (char *)arena_push(arena, length + 1, 1);
+    memory_copy(result, start, length);
+    return(result);
+}
+
+function int
+tool_pack(Arena *arena, Arena *scratch, Job_System *jobs, char *pack_path, char **obj_paths, u32 obj_count) {
+    Mesh *meshes = arena_push_array(arena, Mesh, obj_count);
+    char **names = arena_push_array(arena, char *, obj_count);
+    for (u32 obj_index = 0; obj_index < obj_count; ++obj_index) {
+        OS_File_Map map = os_map_file(tool_str8(obj_paths[obj_index]));
+        if (!map.data) {
+            fprintf(stderr, "couldn't read %s\n", obj_paths[obj_index]);
+            return(1);
+        }
+        u64 start = os_time_microseconds();
+        Obj_Mesh obj = obj_parse(scratch, arena, jobs, (u8 *)map.data, map.size);
+        u64 parse_time = os_time_microseconds() - start;
+        start = os_time_microseconds();
+        meshes[obj_index] = mesh_build(arena, scratch, obj.soup, obj.soup_count);
+        u64 build_time = os_time_microseconds() - start;
+        arena_clear(scratch);
+        os_unmap_file(&map);
+
+        names[obj_index] = tool_mesh_name(arena, obj_paths[obj_index]);
+        Mesh_Stats stats = mesh_analyze(scratch, meshes + obj_index, mesh_fifo_cache_size);
+        printf("%s: %u triangles (%u dropped), %u vertices, radius %.3f, ACMR %.3f, parse %.2f ms, build %.2f ms\n",
+               names[obj_index], stats.triangle_count, obj.dropped_triangle_count, meshes[obj_index].vertex_count,
+               meshes[obj_index].radius, stats.acmr, (f64)parse_time / 1000.0, (f64)build_time / 1000.0);
+    }
+
+    if (!mesh_pack_write(scratch, tool_str8(pack_path), names, meshes, obj_count)) {
+        fprintf(stderr, "couldn't write %s\n", pack_path);
+        return(1);
+    }
+    return(0);
+}
+
+function f64
+tool_megabytes_per_second(u64 bytes, u64 microseconds) {
+    f64 result = microseconds ? ((f64)bytes / (1024.0 * 1024.0)) / ((f64)microseconds / 1000000.0) : 0.0;
+    return(result);
+}
+
+function int
+tool_load(Arena *arena, Arena *scratch, char *obj_path, char *pack_path, u32 runs) {
+    u64 *times = arena_push_array(arena, u64, runs);
+    u32 worker_counts[2] = { 1, os_cpu_count() };
+    u64 obj_size = 0;
+    for (u32 worker_index = 0; worker_index < array_count(worker_counts); ++worker_index) {
+        Job_System jobs;
+        job_system_init(&jobs, worker_counts[worker_index]);
+        u32 soup_count = 0;
+        for (u32 run = 0; run < runs; ++run) {
+            u64 start = os_time_microseconds();
+            OS_File_Map map = os_map_file(tool_str8(obj_path));
+            if (!map.data) {
+                fprintf(stderr, "couldn't read %s\n", obj_path);
+                return(1);
+            }
+            Obj_Mesh obj = obj_parse(scratch, arena, &jobs, (u8 *)map.data, map.size);
+            obj_size = map.size;
+            soup_count = obj.soup_count;
+            os_unmap_file(&map);
+            times[run] = os_time_microseconds() - start;
+            arena_clear(scratch);
+        }
+        job_system_release(&jobs);
+        qsort(times, runs, sizeof(u64), tool_compare_u64);
+        printf("obj parse, %u workers: %.2f MB in %.2f ms, %.1f MB/s (%u triangles)\n", worker_counts[worker_index],
+               (f64)obj_size / (1024.0 * 1024.0), (f64)times[runs / 2] / 1000.0,
+               tool_megabytes_per_second(obj_size, times[runs / 2]), soup_count / 3);
+    }
+
+    // stands in for the copy CreateBuffer makes
+    u64 pack_size = 0;
+    u32 mesh_count = 0;
+    for (u32 run = 0; run < runs; ++run) {
+        u64 start = os_time_microseconds();
+        Mesh_Pack pack;
+        if (!mesh_pack_open(&pack, tool_str8(pack_path))) {
+            fprintf(stderr, "couldn't open %s\n", pack_path);
+            return(1);
+        }
+        for (u32 mesh_index = 0; mesh_index < pack.mesh_count; ++mesh_index) {
+            Mesh mesh = mesh_pack_get(&pack, mesh_index);
+            u64 vertex_size = (u64)mesh.vertex_count * sizeof(Mesh_Vertex);
+            u64 index_size = (u64)mesh.index_count * sizeof(u32);
+            u8 *upload = (u8 *)arena_push(scratch, vertex_size + index_size, 16);
+            memory_copy(upload, mesh.vertices, vertex_size);
+            memory_copy(upload + vertex_size, mesh.indices, index_size);
+        }
+        pack_size = pack.map.size;
+        mesh_count = pack.mesh_count;
+        mesh_pack_close(&pack);
+        times[run] = os_time_microseconds() - start;
+        arena_clear(scratch);
+    }
+    qsort(times, runs, sizeof(u64), tool_compare_u64);
+    printf("pack map and copy: %.2f MB in %.2f ms, %.1f MB/s (%u meshes)\n", (f64)pack_size / (1024.0 * 1024.0),
+           (f64)times[runs / 2] / 1000.0, tool_megabytes_per_second(pack_size, times[runs / 2]), mesh_count);
+    return(0);
+}
+
+// 1 if a decoded mesh is outside the bounds. The bounds themselves are checked by s_test, over
+// random normals and the octahedral map's seams; this is for meshes that come from elsewhere.
+function int
+tool_quantize_mesh(char *name, Arena *scratch, Mesh *mesh) {
+    int result = 0;
+    u64 scratch_pos = scratch->pos;
+    for (u32 format = 0; format < VertexFormat_Count; ++format) {
+        Vertex_Stream stream = vertex_encode(scratch, mesh, format);
+        Vertex_Error error = vertex_measure_error(scratch, &stream, mesh);
+        f32 normal_bound = vertex_normal_error_bound(format);
+        b32 pass = error.position_ratio <= 1.0f && error.normal_error <= normal_bound;
+        printf("%s, %-5s (%s=%s): %2u bytes/vertex, position error %.3f of bound, normal error %.5f deg (bound %.5f)%s\n",
+               name, vertex_format_names[format], vertex_format_defines[format][0].name,
+               vertex_format_defines[format][0].value, stream.stride, error.position_ratio,
+               error.normal_error * (180.0f / pi_f32), normal_bound * (180.0f / pi_f32), pass ? "" : " FAIL");
+        result |= !pass;
+    }
+    arena_pop_to(scratch, scratch_pos);
+    return(result);
+}
+
+function void
+tool_lod(char *name, Arena *arena, Arena *scratch, Mesh *mesh) {
+    u64 arena_pos = arena->pos;
+    u64 start = os_time_microseconds();
+    Mesh_LOD_Chain chain = mesh_lod_build(arena, scratch, mesh);
+    u64 build_time = os_time_microseconds() - start;
+    printf("%s: %u levels in %.2f ms, %u vertices and %u indices in all\n", name, chain.level_count,
+           (f64)build_time / 1000.0, chain.combined.vertex_count, chain.combined.index_count);
+    for (u32 level = 0; level < chain.level_count; ++level) {
+        Mesh level_mesh = mesh_lod_level(&chain, level);
+        Mesh_Stats stats = mesh_analyze(scratch, &level_mesh, mesh_fifo_cache_size);
+        printf("  lod %u: %8u triangles %8u vertices  error %.6f (%.4f of radius)  ACMR %.3f\n", level,
+               level_mesh.index_count / 3, level_mesh.vertex_count, chain.error[level],
+               mesh->radius > 0.0f ? chain.error[level] / mesh->radius : 0.0f, stats.acmr);
+    }
+    arena_clear(scratch);
+    arena_pop_to(arena, arena_pos);
+}
+
+int
+main(int argc, char **argv) {
+    Arena arena = arena_reserve(gigabytes(4));
+    Arena scratch = arena_reserve(gigabytes(4));
+    int result = 0;
+
+    if ((argc > 2) && (strcmp(argv[1], "sphere") == 0)) {
+        u32 size = argc > 3 ? (u32)strtoul(argv[3], null, 10) : 256;
+        if (!tool_write_sphere_obj(&arena, argv[2], size / 2, size)) {
+            fprintf(stderr, "couldn't write %s\n", argv[2]);
+            result = 1;
+        }
+    } else if ((argc > 3) && (strcmp(argv[1], "pack") == 0)) {
+        Job_System jobs;
+        job_system_init(&jobs, os_cpu_count());
+        result = tool_pack(&arena, &scratch, &jobs, argv[2], argv + 3, (u32)(argc - 3));
+        job_system_release(&jobs);
+    } else if ((argc > 3) && (strcmp(argv[1], "load") == 0)) {
+        u32 runs = argc > 4 ? (u32)strtoul(argv[4], null, 10) : 9;
+        result = tool_load(&arena, &scratch, argv[2], argv[3], runs ? runs : 1);
+    } else if ((argc > 2) && (strcmp(argv[1], "quantize") == 0)) {
+        Mesh_Pack pack;
+        if (mesh_pack_open(&pack, tool_str8(argv[2]))) {
+            for (u32 mesh_index = 0; mesh_index < pack.mesh_count; ++mesh_index) {
+                Mesh mesh = mesh_pack_get(&pack, mesh_index);
+                result |= tool_quantize_mesh(pack.entries[mesh_index].name, &scratch, &mesh);
+            }
+            mesh_pack_close(&pack);
+        } else {
+            fprintf(stderr, "couldn't open %s\n", argv[2]);
+            result = 1;
+        }
+    } else if ((argc > 1) && (strcmp(argv[1], "lod") == 0)) {
+        u32 size = argc > 3 ? (u32)strtoul(argv[3], null, 10) : 256;
+        u32 soup_count;
+        Mesh_Vertex *soup = tool_sphere_soup(&arena, size / 2, size, &soup_count);
+        Mesh sphere = mesh_build(&arena, &scratch, soup, soup_count);
+        arena_clear(&scratch);
+        tool_lod("sphere", &arena, &scratch, &sphere);
+        if ((argc > 2) && (strcmp(argv[2], "-") != 0)) {
+            Mesh_Pack pack;
+            if (mesh_pack_open(&pack, tool_str8(argv[2]))) {
+                for (u32 mesh_index = 0; mesh_index < pack.mesh_count; ++mesh_index) {
+                    Mesh mesh = mesh_pack_get(&pack, mesh_index);
+                    tool_lod(pack.entries[mesh_index].name, &arena, &scratch, &mesh);
+                }
+                mesh_pack_close(&pack);
+            } else {
+                fprintf(stderr, "couldn't open %s\n", argv[2]);
+                result = 1;
+            }
+        }
+    } else {
+        u32 grid_size = argc > 1 ? (u32)strtoul(argv[1], null, 10) : 256;
+        u32 soup_count;
+        Mesh_Vertex *soup = tool_grid_soup(&arena, grid_size, &soup_count);
+        tool_report("grid, row order", &arena, &scratch, soup, soup_count);
+        tool_shuffle_triangles(soup, soup_count, 1);
+        tool_report("grid, shuffled", &arena, &scratch, soup, soup_count);
+
+        soup = tool_sphere_soup(&arena, grid_size / 2, grid_size, &soup_count);
+        tool_shuffle_triangles(soup, soup_count, 2);
+        tool_report("sphere, shuffled", &arena, &scratch, soup, soup_count);
+    }
+
+    arena_release(&scratch);
+    arena_release(&arena);
+    return(result);
+}
@@ -0,0 +1,401 @@
+typedef struct {
+    u32 position;
+    // ~0u when the corner has none, ~1u when it names one that doesn't resolve
+    u32 normal;
+} Obj_Corner;
+
+typedef struct {
+    u8 *text;
+    u64 chunk_count;
+    // chunk_count + 1 offsets, every chunk starts at the beginning of a line
+    u64 *chunk_start;
+    // per chunk: what the first pass counted, then where the chunk's output starts
+    u32 *position_base;
+    u32 *normal_base;
+    u32 *triangle_base;
+
+    u32 position_count;
+    u32 normal_count;
+    u32 triangle_count;
+    v3f *positions;
+    v3f *normals;
+    Obj_Corner *corners;
+
+    Mesh_Vertex *soup;
+    // one per triangle, whether its corners all exist
+    u8 *valid;
+    volatile u64 dropped;
+} Obj_Parse;
+
+global f64 obj_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+function b32
+obj_is_blank(u8 c) {
+    b32 result = (c == ' ') || (c == '\t') || (c == '\r');
+    return(result);
+}
+
+function b32
+obj_is_digit(u8 c) {
+    b32 result = (u8)(c - '0') < 10;
+    return(result);
+}
+
+// From fast_float / simdjson: whether the 8 bytes (little endian) are all '0'..'9', and their value.
+function b32
+obj_is_eight_digits(u64 value) {
+    b32 result = ((value & 0xF0F0F0F0F0F0F0F0ull) |
+                  (((value + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+    return(result);
+}
+
+function u32
+obj_eight_digits(u64 value) {
+    value -= 0x3030303030303030ull;
+    // pairs, then quads, then the eight
+    value = (value * 10) + (value >> 8);
+    value = (((value & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+             (((value >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    return((u32)value);
+}
+
+function u8 *
+obj_parse_digits(u8 *at, u8 *end, u64 *mantissa, u32 *digit_count) {
+    // wraps past 19 digits, obj_parse_f32 doesn't use the mantissa then
+    while ((end - at) >= 8) {
+        u64 eight;
+        memory_copy(&eight, at, 8);
+        if (!obj_is_eight_digits(eight)) {
+            break;
+        }
+        *mantissa = *mantissa * 100000000ull + obj_eight_digits(eight);
+        *digit_count += 8;
+        at += 8;
+    }
+    while ((at < end) && obj_is_digit(*at)) {
+        *mantissa = *mantissa * 10 + (u64)(*at - '0');
+        ++*digit_count;
+        ++at;
+    }
+    return(at);
+}
+
+function f32
+obj_parse_f32(u8 **at, u8 *end) {
+    u8 *start = *at;
+    u8 *cursor = start;
+    b32 negative = False;
+    if ((cursor < end) && ((*cursor == '-') || (*cursor == '+'))) {
+        negative = *cursor == '-';
+        ++cursor;
+    }
+
+    u64 mantissa = 0;
+    u32 digit_count = 0;
+    cursor = obj_parse_digits(cursor, end, &mantissa, &digit_count);
+    s32 exponent = 0;
+    if ((cursor < end) && (*cursor == '.')) {
+        u32 integer_digits = digit_count;
+        cursor = obj_parse_digits(cursor + 1, end, &mantissa, &digit_count);
+        exponent -= (s32)(digit_count - integer_digits);
+    }
+    if ((cursor < end) && ((*cursor == 'e') || (*cursor == 'E'))) {
+        u8 *exponent_at = cursor + 1;
+        b32 negative_exponent = False;
+        if ((exponent_at < end) && ((*exponent_at == '-') || (*exponent_at == '+'))) {
+            negative_exponent = *exponent_at == '-';
+            ++exponent_at;
+        }
+        if ((exponent_at < end) && obj_is_digit(*exponent_at)) {
+            s32 value = 0;
+            for (; (exponent_at < end) && obj_is_digit(*exponent_at); ++exponent_at) {
+                if (value < 100000) {
+                    value = value * 10 + (*exponent_at - '0');
+                }
+            }
+            exponent += negative_exponent ? -value : value;
+            cursor = exponent_at;
+        }
+    }
+    *at = cursor;
+
+    f32 result = 0.0f;
+    if ((digit_count <= 19) && (mantissa <= (1ull << 53)) && (exponent >= -22) && (exponent <= 22)) {
+        // both exact in an f64, so this rounds once (Clinger's fast path), then once more to f32
+        f64 value = (f64)mantissa;
+        value = exponent < 0 ? value / obj_powers_of_ten[-exponent] : value * obj_powers_of_ten[exponent];
+        result = (f32)value;
+    } else {
+        // too many digits or a big exponent, rare enough to leave to the C library
+        char buffer[64];
+        u64 length = (u64)(cursor - start);
+        length = length < sizeof(buffer) - 1 ? length : sizeof(buffer) - 1;
+        memory_copy(buffer, start, length);
+        buffer[length] = 0;
+        result = strtof(buffer, null);
+        negative = False;
+    }
+    result = negative ? -result : result;
+    return(result);
+}
+
+function s64
+obj_parse_s64(u8 **at, u8 *end) {
+    u8 *cursor = *at;
+    b32 negative = False;
+    if ((cursor < end) && ((*cursor == '-') || (*cursor == '+'))) {
+        negative = *cursor == '-';
+        ++cursor;
+    }
+    s64 result = 0;
+    for (; (cursor < end) && obj_is_digit(*cursor); ++cursor) {
+        if (result < ((s64)1 << 40)) {
+            result = result * 10 + (*cursor - '0');
+        }
+    }
+    *at = cursor;
+    return(negative ? -result : result);
+}
+
+// 1-based or negative (counting back from the current count) to 0-based, ~0u if it's neither.
+function u32
+obj_resolve_index(s64 index, u32 count) {
+    u32 result = ~0u;
+    if (index > 0) {
+        result = index <= 0xFFFFFFFFll ? (u32)(index - 1) : ~0u;
+    } else if ((index < 0) && (-index <= (s64)count)) {
+        result = (u32)((s64)count + index);
+    }
+    return(result);
+}
+
+function v3f
+obj_parse_v3f(u8 *at, u8 *end) {
+    v3f result;
+    for (u32 axis = 0; axis < 3; ++axis) {
+        while ((at < end) && obj_is_blank(*at)) {
+            ++at;
+        }
+        result.v[axis] = obj_parse_f32(&at, end);
+    }
+    // right-handed to left-handed
+    result.z = -result.z;
+    return(result);
+}
+
+// Both passes walk lines the same way; the first only counts, so its corner tokens aren't parsed.
+function void
+obj_chunk(Obj_Parse *parse, u64 chunk, b32 store) {
+    u8 *at = parse->text + parse->chunk_start[chunk];
+    u8 *end = parse->text + parse->chunk_start[chunk + 1];
+    u32 position_base = store ? parse->position_base[chunk] : 0;
+    u32 normal_base = store ? parse->normal_base[chunk] : 0;
+    u32 triangle_base = store ? parse->triangle_base[chunk] : 0;
+    u32 positions = 0;
+    u32 normals = 0;
+    u32 triangles = 0;
+
+    while (at < end) {
+        while ((at < end) && obj_is_blank(*at)) {
+            ++at;
+        }
+        u8 *line_end = (u8 *)memchr(at, '\n', (u64)(end - at));
+        line_end = line_end ? line_end : end;
+        u64 length = (u64)(line_end - at);
+
+        if ((length >= 2) && (at[0] == 'v') && obj_is_blank(at[1])) {
+            if (store) {
+                parse->positions[position_base + positions] = obj_parse_v3f(at + 2, line_end);
+            }
+            ++positions;
+        } else if ((length >= 3) && (at[0] == 'v') && (at[1] == 'n') && obj_is_blank(at[2])) {
+            if (store) {
+                parse->normals[normal_base + normals] = obj_parse_v3f(at + 3, line_end);
+            }
+            ++normals;
+        } else if ((length >= 2) && (at[0] == 'f') && obj_is_blank(at[1])) {
+            u8 *cursor = at + 2;
+            u32 corner_count = 0;
+            Obj_Corner first = { 0 };
+            Obj_Corner previous = { 0 };
+            for (;;) {
+                while ((cursor < line_end) && obj_is_blank(*cursor)) {
+                    ++cursor;
+                }
+                if (cursor == line_end) {
+                    break;
+                }
+
+                // v, v/vt, v//vn or v/vt/vn
+                Obj_Corner corner = { ~0u, ~0u };
+                if (store) {
+                    u8 *token = cursor;
+                    corner.position = obj_resolve_index(obj_parse_s64(&token, line_end), position_base + positions);
+                    if ((token < line_end) && (*token == '/')) {
+                        ++token;
+                        obj_parse_s64(&token, line_end);
+                        if ((token < line_end) && (*token == '/')) {
+                            ++token;
+                            corner.normal = obj_resolve_index(obj_parse_s64(&token, line_end), normal_base + normals);
+                            // a bad normal drops the face like a bad position, it isn't a missing one
+                            corner.normal = (corner.normal == ~0u) ? ~1u : corner.normal;
+                        }
+                    }
+                }
+                while ((cursor < line_end) && !obj_is_blank(*cursor)) {
+                    ++cursor;
+                }
+
+                ++corner_count;
+                if (corner_count == 1) {
+                    first = corner;
+                } else if (corner_count >= 3) {
+                    if (store) {
+                        Obj_Corner *out = parse->corners + (u64)(triangle_base + triangles) * 3;
+                        // negating z mirrors the face, so the fan turns the other way round
+                        out[0] = first;
+                        out[1] = corner;
+                        out[2] = previous;
+                    }
+                    ++triangles;
+                }
+                previous = corner;
+            }
+        }
+
+        at = line_end + 1;
+    }
+
+    if (!store) {
+        parse->position_base[chunk] = positions;
+        parse->normal_base[chunk] = normals;
+        parse->triangle_base[chunk] = triangles;
+    }
+}
+
+function void
+obj_count_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    for (u64 chunk = begin; chunk < end; ++chunk) {
+        obj_chunk((Obj_Parse *)data, chunk, False);
+    }
+}
+
+function void
+obj_store_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    for (u64 chunk = begin; chunk < end; ++chunk) {
+        obj_chunk((Obj_Parse *)data, chunk, True);
+    }
+}
+
+function void
+obj_assemble_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Obj_Parse *parse = (Obj_Parse *)data;
+    u64 dropped = 0;
+    for (u64 triangle = begin; triangle < end; ++triangle) {
+        Obj_Corner *corners = parse->corners + triangle * 3;
+        Mesh_Vertex *out = parse->soup + triangle * 3;
+
+        b32 valid = True;
+        for (u32 corner = 0; corner < 3; ++corner) {
+            valid &= corners[corner].position < parse->position_count;
+            valid &= (corners[corner].normal == ~0u) || (corners[corner].normal < parse->normal_count);
+        }
+        parse->valid[triangle] = (u8)valid;
+        if (!valid) {
+            ++dropped;
+            continue;
+        }
+
+        for (u32 corner = 0; corner < 3; ++corner) {
+            out[corner].p = parse->positions[corners[corner].position];
+        }
+        // clockwise in our space, so this points out of the front face
+        v3f face_normal = v3f_cross(v3f_sub(out[1].p, out[0].p), v3f_sub(out[2].p, out[0].p));
+        f32 length_sq = v3f_dot(face_normal, face_normal);
+        if (length_sq > 0.0f) {
+            face_normal = v3f_scale(face_normal, 1.0f / sqrtf(length_sq));
+        }
+        for (u32 corner = 0; corner < 3; ++corner) {
+            u32 normal = corners[corner].normal;
+            out[corner].normal = normal == ~0u ? face_normal : parse->normals[normal];
+        }
+    }
+    if (dropped) {
+        atomic_add_u64(&parse->dropped, dropped);
+    }
+}
+
+function Obj_Mesh
+obj_parse(Arena *arena, Arena *scratch, Job_System *jobs, u8 *text, u64 size) {
+    u64 scratch_pos = scratch->pos;
+    Obj_Mesh result = { 0 };
+    Obj_Parse parse = { 0 };
+    parse.text = text;
+
+    parse.chunk_count = (size + obj_chunk_size - 1) / obj_chunk_size;
+    parse.chunk_count = parse.chunk_count ? parse.chunk_count : 1;
+    parse.chunk_start = arena_push_array(scratch, u64, parse.chunk_count + 1);
+    parse.position_base = arena_push_array(scratch, u32, parse.chunk_count);
+    parse.normal_base = arena_push_array(scratch, u32, parse.chunk_count);
+    parse.triangle_base = arena_push_array(scratch, u32, parse.chunk_count);
+    for (u64 chunk = 1; chunk < parse.chunk_count; ++chunk) {
+        // just past the next line end, and never behind the previous chunk when lines are long
+        u64 start = (size / parse.chunk_count) * chunk;
+        start = start > parse.chunk_start[chunk - 1] ? start : parse.chunk_start[chunk - 1];
+        u8 *line_end = (u8 *)memchr(text + start, '\n', size - start);
+        parse.chunk_start[chunk] = line_end ? (u64)(line_end - text) + 1 : size;
+    }
+    parse.chunk_start[parse.chunk_count] = size;
+
+    Job_Fence fence = { 0 };
+    job_parallel_for(jobs, &fence, parse.chunk_count, 1, obj_count_job, &parse);
+    job_wait(jobs, &fence);
+
+    for (u64 chunk = 0; chunk < parse.chunk_count; ++chunk) {
+        u32 positions = parse.position_base[chunk];
+        u32 normals = parse.normal_base[chunk];
+        u32 triangles = parse.triangle_base[chunk];
+        parse.position_base[chunk] = parse.position_count;
+        parse.normal_base[chunk] = parse.normal_count;
+        parse.triangle_base[chunk] = parse.triangle_count;
+        parse.position_count += positions;
+        parse.normal_count += normals;
+        parse.triangle_count += triangles;
+    }
+
+    parse.positions = arena_push_array(scratch, v3f, parse.position_count);
+    parse.normals = arena_push_array(scratch, v3f, parse.normal_count);
+    parse.corners = arena_push_array(scratch, Obj_Corner, (u64)parse.triangle_count * 3);
+    parse.valid = arena_push_array(scratch, u8, parse.triangle_count);
+    parse.soup = arena_push_array(arena, Mesh_Vertex, (u64)parse.triangle_count * 3);
+
+    job_parallel_for(jobs, &fence, parse.chunk_count, 1, obj_store_job, &parse);
+    job_wait(jobs, &fence);
+    job_parallel_for(jobs, &fence, parse.triangle_count, 16384, obj_assemble_job, &parse);
+    job_wait(jobs, &fence);
+
+    result.soup = parse.soup;
+    result.soup_count = parse.triangle_count * 3;
+    result.position_count = parse.position_count;
+    result.normal_count = parse.normal_count;
+    result.dropped_triangle_count = (u32)parse.dropped;
+    if (parse.dropped) {
+        u32 kept = 0;
+        for (u32 triangle = 0; triangle < parse.triangle_count; ++triangle) {
+            if (parse.valid[triangle]) {
+                memmove(result.soup + (u64)kept * 3, result.soup + (u64)triangle * 3, 3 * sizeof(Mesh_Vertex));
+                ++kept;
+            }
+        }
+        result.soup_count = kept * 3;
+    }
+
+    arena_pop_to(scratch, scratch_pos);
+    return(result);
+}
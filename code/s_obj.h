@@ -0,0 +1,33 @@
+#if !defined(S_OBJ_H)
+#define S_OBJ_H
+
+// Wavefront OBJ text to a triangle soup for mesh_build. Reads v, vn and f: polygons are fanned into
+// triangles and negative (relative) indices work. Everything else (vt, groups, materials, ...) is
+// skipped. Corners without a normal get the face's.
+//
+// OBJ is right-handed with counter-clockwise front faces, we're left-handed with clockwise ones.
+// Negating z converts positions and normals, but it's a reflection and reverses the winding with
+// it, so every triangle of a fan is emitted as (first, corner, previous) to turn it back.
+//
+// The text is cut into chunks at line ends, one job each. A first pass counts what every chunk
+// holds, prefix sums tell each chunk where its output goes and a second pass parses into place.
+// Faces may name vertices from any chunk, so the soup is put together in a third pass.
+
+#define obj_chunk_size kilobytes(256)
+
+typedef struct {
+    Mesh_Vertex *soup;
+    u32 soup_count;
+    u32 position_count;
+    u32 normal_count;
+    // faces naming a position or normal that doesn't exist, left out of the soup
+    u32 dropped_triangle_count;
+} Obj_Mesh;
+
+// soup is pushed to arena, scratch holds the intermediate arrays and is returned as it was.
+function Obj_Mesh obj_parse(Arena *arena, Arena *scratch, Job_System *jobs, u8 *text, u64 size);
+
+// A decimal float, e.g. -1.25e-3, advancing *at. Eight digits at a time where there are that many.
+function f32 obj_parse_f32(u8 **at, u8 *end);
+
+#endif
@@ -0,0 +1,298 @@
+// OBJ parsing: winding and normals of standard right-handed counter-clockwise files, fans,
+// negative indices and faces that name what doesn't exist, checked on small files written out
+// by hand, then a file big enough to be cut into chunks. obj_parse_f32 is held to strtof, bit
+// for bit and character for character.
+
+function Obj_Mesh
+obj_test_parse(Arena *arena, Arena *scratch, Job_System *jobs, char *text) {
+    Obj_Mesh result = obj_parse(arena, scratch, jobs, (u8 *)text, strlen(text));
+    return(result);
+}
+
+function b32
+obj_test_same_v3f(v3f a, v3f b) {
+    b32 result = (a.x == b.x) && (a.y == b.y) && (a.z == b.z);
+    return(result);
+}
+
+// Out of the front face, as our clockwise winding has it.
+function v3f
+obj_test_face_normal(Mesh_Vertex *triangle) {
+    v3f result = v3f_cross(v3f_sub(triangle[1].p, triangle[0].p), v3f_sub(triangle[2].p, triangle[0].p));
+    f32 length = sqrtf(v3f_dot(result, result));
+    result = length > 0.0f ? v3f_scale(result, 1.0f / length) : result;
+    return(result);
+}
+
+// Whether triangle is positions[a], [b], [c] of an OBJ's positions, in that order, with z mirrored.
+function b32
+obj_test_triangle_is(Mesh_Vertex *triangle, v3f *positions, u32 a, u32 b, u32 c) {
+    u32 corners[3] = { a, b, c };
+    b32 result = True;
+    for (u32 corner = 0; corner < 3; ++corner) {
+        v3f p = positions[corners[corner]];
+        result = result && obj_test_same_v3f(triangle[corner].p, v3f_make(p.x, p.y, -p.z));
+    }
+    return(result);
+}
+
+function void
+test_obj_parse_f32(void) {
+    char *strings[] = {
+        "0", "-0", "+1.5", ".5", "5.", "1e", "1e+", "1.5E-3", "-7.5e-7", "0.1", "16777217", "16777219",
+        "00000000001.25", "3.4028235e38", "3.4028236e38", "1e39", "1.17549435e-38", "1.4e-45", "1e-50",
+        "123456789012345678901234", "0.000000000000000000000000000000000000000000001",
+        "9007199254740993", "1234567.125e-22", "1234567.125e-23", "12345678.87654321", "2.5 7",
+    };
+    u64 wrong = 0;
+    for (u32 index = 0; index < array_count(strings); ++index) {
+        u8 *at = (u8 *)strings[index];
+        f32 parsed = obj_parse_f32(&at, (u8 *)strings[index] + strlen(strings[index]));
+        char *expected_end;
+        f32 expected = strtof(strings[index], &expected_end);
+        b32 same = (memory_compare(&parsed, &expected, sizeof(f32)) == 0) && ((char *)at == expected_end);
+        test_check(same, "\"%s\" parsed as %.9g (%u characters), strtof gives %.9g (%u)", strings[index], parsed,
+                   (u32)((char *)at - strings[index]), expected, (u32)(expected_end - strings[index]));
+        wrong += !same;
+    }
+
+    // every finite float printed the ways exporters print them
+    Test_Random random = test_random_make(18);
+    char *formats[] = { "%.9g", "%.6f", "%e", "%.3f" };
+    u64 parsed_count = 0;
+    wrong = 0;
+    for (u32 iteration = 0; iteration < 200000; ++iteration) {
+        u32 bits = test_random_u32(&random);
+        // mostly the magnitudes meshes have
+        if (iteration & 1) {
+            bits = (bits & 0x807FFFFF) | ((u32)(120 + test_random_u32(&random) % 20) << 23);
+        }
+        f32 value;
+        memory_copy(&value, &bits, sizeof(f32));
+        if (!isfinite(value)) {
+            continue;
+        }
+        for (u32 format = 0; format < array_count(formats); ++format) {
+            char text[512];
+            snprintf(text, sizeof(text), formats[format], (f64)value);
+            u8 *at = (u8 *)text;
+            f32 parsed = obj_parse_f32(&at, (u8 *)text + strlen(text));
+            char *expected_end;
+            f32 expected = strtof(text, &expected_end);
+            b32 same = (memory_compare(&parsed, &expected, sizeof(f32)) == 0) && ((char *)at == expected_end);
+            if (!same && !wrong) {
+                test_check(False, "\"%s\" parsed as %.9g, strtof gives %.9g", text, parsed, expected);
+            }
+            wrong += !same;
+            ++parsed_count;
+        }
+    }
+    test_check(!wrong, "%llu of %llu printed floats parsed differently from strtof", (unsigned long long)wrong,
+               (unsigned long long)parsed_count);
+}
+
+function void
+test_obj(void) {
+    Arena arena = arena_reserve(megabytes(256));
+    Arena scratch = arena_reserve(megabytes(256));
+    Job_System jobs;
+    job_system_init(&jobs, 4);
+
+    test_obj_parse_f32();
+
+    // A counter-clockwise triangle facing +z in OBJ faces -z here, so the normal given for it and
+    // the normal worked out from its corners must agree.
+    {
+        char *text =
+            "v 0 0 0\n"
+            "v 1 0 0\n"
+            "v 0 1 0\n"
+            "vn 0 0 1\n"
+            "f 1//1 2//1 3//1\n"
+            "f 1 2 3\n";
+        v3f positions[3] = { v3f_make(0.0f, 0.0f, 0.0f), v3f_make(1.0f, 0.0f, 0.0f), v3f_make(0.0f, 1.0f, 0.0f) };
+        Obj_Mesh obj = obj_test_parse(&arena, &scratch, &jobs, text);
+        if (test_check(obj.soup_count == 6, "one triangle twice gave %u corners", obj.soup_count)) {
+            v3f expected = v3f_make(0.0f, 0.0f, -1.0f);
+            v3f face = obj_test_face_normal(obj.soup);
+            test_check(obj_test_same_v3f(face, expected), "a counter-clockwise triangle faces (%f, %f, %f)",
+                       face.x, face.y, face.z);
+            for (u32 corner = 0; corner < 6; ++corner) {
+                test_check(obj_test_same_v3f(obj.soup[corner].normal, expected), "corner %u has normal (%f, %f, %f)",
+                           corner, obj.soup[corner].normal.x, obj.soup[corner].normal.y, obj.soup[corner].normal.z);
+            }
+            test_check(obj_test_triangle_is(obj.soup, positions, 0, 2, 1) &&
+                       obj_test_triangle_is(obj.soup + 3, positions, 0, 2, 1), "the triangle's corners aren't turned round");
+        }
+        arena_clear(&arena);
+    }
+
+    // A closed octahedron written counter-clockwise from outside with outward normals: every face
+    // faces out and agrees with its normals.
+    {
+        char text[4096];
+        u64 size = 0;
+        v3f axes[6] = {
+            v3f_make(1, 0, 0), v3f_make(-1, 0, 0), v3f_make(0, 1, 0), v3f_make(0, -1, 0), v3f_make(0, 0, 1), v3f_make(0, 0, -1),
+        };
+        for (u32 vertex = 0; vertex < 6; ++vertex) {
+            size += (u64)snprintf(text + size, sizeof(text) - size, "v %g %g %g\nvn %g %g %g\n", axes[vertex].x,
+                                  axes[vertex].y, axes[vertex].z, axes[vertex].x, axes[vertex].y, axes[vertex].z);
+        }
+        for (u32 octant = 0; octant < 8; ++octant) {
+            u32 x = 1 + (octant & 1);
+            u32 y = 3 + ((octant >> 1) & 1);
+            u32 z = 5 + ((octant >> 2) & 1);
+            // (x, y, z) is counter-clockwise from outside when an even number of them are negative
+            b32 flip = ((octant & 1) + ((octant >> 1) & 1) + ((octant >> 2) & 1)) & 1;
+            if (flip) {
+                size += (u64)snprintf(text + size, sizeof(text) - size, "f %u//%u %u//%u %u//%u\n", x, x, z, z, y, y);
+            } else {
+                size += (u64)snprintf(text + size, sizeof(text) - size, "f %u//%u %u//%u %u//%u\n", x, x, y, y, z, z);
+            }
+        }
+        Obj_Mesh obj = obj_test_parse(&arena, &scratch, &jobs, text);
+        u64 inward = 0;
+        for (u32 triangle = 0; (triangle < 8) && (obj.soup_count == 24); ++triangle) {
+            Mesh_Vertex *corners = obj.soup + triangle * 3;
+            v3f face = obj_test_face_normal(corners);
+            v3f centre = v3f_add(v3f_add(corners[0].p, corners[1].p), corners[2].p);
+            inward += v3f_dot(face, centre) <= 0.0f;
+            for (u32 corner = 0; corner < 3; ++corner) {
+                inward += v3f_dot(face, corners[corner].normal) <= 0.0f;
+            }
+        }
+        test_check((obj.soup_count == 24) && !inward, "octahedron: %u corners, %llu faces or normals point in",
+                   obj.soup_count, (unsigned long long)inward);
+        arena_clear(&arena);
+    }
+
+    // Fans, every way of writing a corner, and things that aren't v, vn or f.
+    {
+        char *text =
+            "# a pentagon\n"
+            "o pentagon\n"
+            "v 0 0 0\n"
+            "v 2 0 0.5\n"
+            "v 3 2 1\n"
+            "v 1 3 1.5\n"
+            "v -1 2 2\n"
+            "vt 0.5 0.5\n"
+            "vn 0 0 1\n"
+            "s off\n"
+            "f 1 2 3 4 5\n"
+            "f 1/1 2/1 3/1 4/1\n"
+            "\tf  1/1/1   2/1/1 3/1/1  \r\n"
+            "f 1//1 2//1\n";
+        v3f positions[5] = { v3f_make(0, 0, 0), v3f_make(2, 0, 0.5f), v3f_make(3, 2, 1), v3f_make(1, 3, 1.5f), v3f_make(-1, 2, 2) };
+        Obj_Mesh obj = obj_test_parse(&arena, &scratch, &jobs, text);
+        b32 right = (obj.soup_count == 18) && (obj.position_count == 5) && (obj.normal_count == 1) &&
+            !obj.dropped_triangle_count;
+        right = right && obj_test_triangle_is(obj.soup + 0, positions, 0, 2, 1);
+        right = right && obj_test_triangle_is(obj.soup + 3, positions, 0, 3, 2);
+        right = right && obj_test_triangle_is(obj.soup + 6, positions, 0, 4, 3);
+        right = right && obj_test_triangle_is(obj.soup + 9, positions, 0, 2, 1);
+        right = right && obj_test_triangle_is(obj.soup + 12, positions, 0, 3, 2);
+        right = right && obj_test_triangle_is(obj.soup + 15, positions, 0, 2, 1);
+        test_check(right, "fans: %u corners, %u positions, %u normals, %u dropped", obj.soup_count, obj.position_count,
+                   obj.normal_count, obj.dropped_triangle_count);
+        if (obj.soup_count == 18) {
+            test_check(obj_test_same_v3f(obj.soup[15].normal, v3f_make(0.0f, 0.0f, -1.0f)), "the last face lost its normal");
+        }
+        arena_clear(&arena);
+    }
+
+    // Negative indices count back from what's been read so far, for positions and normals alike.
+    {
+        char *text =
+            "v 0 0 0\n"
+            "v 1 0 0\n"
+            "v 0 1 0\n"
+            "vn 1 0 0\n"
+            "vn 0 1 0\n"
+            "f -3//-1 -2//-2 -1//-1\n"
+            "v 1 1 0\n"
+            "vn 0 0 1\n"
+            "f -4 -2 -1\n"
+            "f 1//-1 -3//1 4//-2\n";
+        v3f positions[4] = { v3f_make(0, 0, 0), v3f_make(1, 0, 0), v3f_make(0, 1, 0), v3f_make(1, 1, 0) };
+        Obj_Mesh obj = obj_test_parse(&arena, &scratch, &jobs, text);
+        b32 right = (obj.soup_count == 9) && !obj.dropped_triangle_count;
+        right = right && obj_test_triangle_is(obj.soup + 0, positions, 0, 2, 1);
+        right = right && obj_test_same_v3f(obj.soup[0].normal, v3f_make(0, 1, 0)) &&
+            obj_test_same_v3f(obj.soup[1].normal, v3f_make(0, 1, 0)) && obj_test_same_v3f(obj.soup[2].normal, v3f_make(1, 0, 0));
+        right = right && obj_test_triangle_is(obj.soup + 3, positions, 0, 3, 2);
+        right = right && obj_test_triangle_is(obj.soup + 6, positions, 0, 3, 1);
+        right = right && obj_test_same_v3f(obj.soup[6].normal, v3f_make(0, 0, -1)) &&
+            obj_test_same_v3f(obj.soup[7].normal, v3f_make(0, 1, 0)) && obj_test_same_v3f(obj.soup[8].normal, v3f_make(1, 0, 0));
+        test_check(right, "negative indices: %u corners, %u dropped", obj.soup_count, obj.dropped_triangle_count);
+        arena_clear(&arena);
+    }
+
+    // Faces naming a position or normal that doesn't exist are dropped, one fan triangle at a time,
+    // and the rest keep their order.
+    {
+        char *text =
+            "v 0 0 0\n"
+            "v 1 0 0\n"
+            "v 0 1 0\n"
+            "v 1 1 0\n"
+            "vn 0 0 1\n"
+            "f 1 2 3\n"
+            "f 1 2 9\n"
+            "f 0 1 2\n"
+            "f -5 1 2\n"
+            "f 1//2 2//1 3//1\n"
+            "f 1//0 2//1 3//1\n"
+            "f 2 4 3\n"
+            "f 1 2 3 99 4\n"
+            "f 1 2 4\n";
+        v3f positions[4] = { v3f_make(0, 0, 0), v3f_make(1, 0, 0), v3f_make(0, 1, 0), v3f_make(1, 1, 0) };
+        Obj_Mesh obj = obj_test_parse(&arena, &scratch, &jobs, text);
+        b32 right = (obj.soup_count == 12) && (obj.dropped_triangle_count == 7);
+        right = right && obj_test_triangle_is(obj.soup + 0, positions, 0, 2, 1);
+        right = right && obj_test_triangle_is(obj.soup + 3, positions, 1, 2, 3);
+        right = right && obj_test_triangle_is(obj.soup + 6, positions, 0, 2, 1);
+        right = right && obj_test_triangle_is(obj.soup + 9, positions, 0, 3, 1);
+        test_check(right, "bad faces: %u corners, %u dropped, expected 12 and 7", obj.soup_count, obj.dropped_triangle_count);
+        arena_clear(&arena);
+    }
+
+    // Big enough for several chunks, quads naming their corners backwards from the end, so faces
+    // near a chunk's start reach into the chunk before.
+    {
+        u32 quad_count = 40000;
+        u64 capacity = (u64)quad_count * 160;
+        char *text = (char *)arena_push(&scratch, capacity, 16);
+        u64 size = 0;
+        for (u32 quad = 0; quad < quad_count; ++quad) {
+            f32 x = (f32)(quad % 200);
+            f32 y = (f32)(quad / 200) * 0.5f;
+            size += (u64)snprintf(text + size, capacity - size,
+                                  "v %.2f %.2f %.2f\nv %.2f %.2f %.2f\nv %.2f %.2f %.2f\nv %.2f %.2f %.2f\nf -4 -3 -2 -1\n",
+                                  x, y, 0.25f, x + 1.0f, y, 0.25f, x + 1.0f, y + 0.5f, -0.75f, x, y + 0.5f, -0.75f);
+        }
+        test_check(size > 4 * obj_chunk_size, "the big file is only %llu bytes", (unsigned long long)size);
+        Obj_Mesh obj = obj_parse(&arena, &scratch, &jobs, (u8 *)text, size);
+        u64 wrong = 0;
+        for (u32 quad = 0; (quad < quad_count) && (obj.soup_count == quad_count * 6); ++quad) {
+            f32 x = (f32)(quad % 200);
+            f32 y = (f32)(quad / 200) * 0.5f;
+            v3f positions[4] = {
+                v3f_make(x, y, 0.25f), v3f_make(x + 1.0f, y, 0.25f), v3f_make(x + 1.0f, y + 0.5f, -0.75f), v3f_make(x, y + 0.5f, -0.75f),
+            };
+            wrong += !obj_test_triangle_is(obj.soup + quad * 6, positions, 0, 2, 1);
+            wrong += !obj_test_triangle_is(obj.soup + quad * 6 + 3, positions, 0, 3, 2);
+        }
+        test_check((obj.soup_count == quad_count * 6) && (obj.position_count == quad_count * 4) && !wrong,
+                   "%u quads in %llu chunks: %u corners, %llu triangles wrong", quad_count,
+                   (unsigned long long)((size + obj_chunk_size - 1) / obj_chunk_size), obj.soup_count,
+                   (unsigned long long)wrong);
+        arena_clear(&arena);
+        arena_clear(&scratch);
+    }
+
+    job_system_release(&jobs);
+    arena_release(&scratch);
+    arena_release(&arena);
+}
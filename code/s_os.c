@@ -0,0 +1,19 @@
+// Shared by every backend.
+
+function b32
+os_input_pressed(OS_Input *input, OS_Input_Key key) {
+	b32 result = (input->key_input[key] & OSInput_Interact_Pressed) != 0;
+	return(result);
+}
+
+function b32
+os_input_released(OS_Input *input, OS_Input_Key key) {
+	b32 result = (input->key_input[key] & OSInput_Interact_Released) != 0;
+	return(result);
+}
+
+function b32
+os_input_held(OS_Input *input, OS_Input_Key key) {
+	b32 result = (input->key_input[key] & OSInput_Interact_Held) != 0;
+	return(result);
+}
@@ -0,0 +1,129 @@
+#if !defined(S_OS_H)
+#define S_OS_H
+
+// Platform layer. s_os_win32.c / s_os_linux.c implement this, the unity build includes exactly one.
+
+// Virtual memory. Reserve hands out address space only; pages become usable (and zeroed) once committed.
+function u64 os_memory_page_size(void);
+function void *os_memory_reserve(u64 size);
+function b32 os_memory_commit(void *ptr, u64 size);
+function void os_memory_decommit(void *ptr, u64 size);
+function void os_memory_release(void *ptr, u64 size);
+
+// Threads
+typedef void OS_Thread_Func(void *data);
+
+typedef struct {
+	void *handle;
+} OS_Thread;
+
+// Counting semaphore, used to park idle workers.
+typedef struct {
+	void *handle;
+} OS_Semaphore;
+
+function u32 os_cpu_count(void);
+function OS_Thread os_thread_create(OS_Thread_Func *func, void *data);
+function void os_thread_join(OS_Thread thread);
+function void os_thread_yield(void);
+function OS_Semaphore os_semaphore_create(u32 initial_count);
+function void os_semaphore_signal(OS_Semaphore semaphore, u32 count);
+function void os_semaphore_wait(OS_Semaphore semaphore);
+function void os_semaphore_destroy(OS_Semaphore semaphore);
+
+// Window and input
+typedef struct {
+	u32 client_width;
+	u32 client_height;
+	b32 resized_this_frame;
+	b32 is_focus;
+	// HWND on win32, null when headless
+	void *handle;
+	// headless backends render here instead, client_width * client_height RGBA8
+	u32 *pixels;
+} OS_Window;
+
+typedef u8 OS_Input_Flags;
+enum {
+	OSInput_Flag_Quit = (1 << 0),
+};
+
+typedef u16 OS_Input_Interact_Flags;
+enum {
+	OSInput_Interact_Pressed = (1 << 1),
+	OSInput_Interact_Released = (1 << 2),
+	OSInput_Interact_Held = (1 << 3),
+};
+
+typedef u16 OS_Input_Key;
+enum {
+	OSInput_Key_Shift,
+	OSInput_Key_Space,
+	OSInput_Key_Escape,
+	OSInput_Key_W,
+	OSInput_Key_A,
+	OSInput_Key_S,
+	OSInput_Key_D,
+	OSInput_Key_Up,
+	OSInput_Key_Down,
+	OSInput_Key_Left,
+	OSInput_Key_Right,
+	OSInput_Key_V,
+	OSInput_Key_P,
+	OSInput_Key_Count,
+};
+
+typedef struct {
+	OS_Input_Flags flags;
+	OS_Input_Interact_Flags key_input[OSInput_Key_Count];
+	
+	s32 mouse_displace_x, mouse_displace_y;
+} OS_Input;
+
+function s32 os_message_box(String_Const_U8 title, String_Const_U8 message);
+function OS_Window os_create_window(String_Const_U8 name, u32 width, u32 height);
+function void os_destroy_window(OS_Window *window);
+// Once per frame: clears last frame's pressed/released and gathers new events.
+function void os_fill_events(OS_Input *input, OS_Window *window);
+function b32 os_input_pressed(OS_Input *input, OS_Input_Key key);
+function b32 os_input_released(OS_Input *input, OS_Input_Key key);
+function b32 os_input_held(OS_Input *input, OS_Input_Key key);
+
+// Monotonic, for timing frames.
+function u64 os_time_microseconds(void);
+// The same clock at its own resolution (QueryPerformanceCounter, clock_gettime), cheap enough to
+// read around every profile zone.
+function u64 os_time_ticks(void);
+function u64 os_time_ticks_per_second(void);
+
+// Headless backends replay this instead of reading devices. Events are sorted by frame, the
+// first os_fill_events is frame 0.
+typedef struct {
+	u64 frame;
+	OS_Input_Key key;
+	b32 down;
+	s32 mouse_displace_x;
+	s32 mouse_displace_y;
+} OS_Input_Event;
+
+#if !defined(_WIN32)
+function void os_set_input_script(OS_Input_Event *events, u64 count);
+#endif
+
+// Creates or truncates path. False if the file couldn't be opened or fully written.
+function b32 os_write_entire_file(String_Const_U8 path, void *data, u64 size);
+
+// A read-only view of a whole file. data is null when the file couldn't be opened, or is empty.
+typedef struct {
+	void *data;
+	u64 size;
+	void *handle;
+} OS_File_Map;
+
+function OS_File_Map os_map_file(String_Const_U8 path);
+function void os_unmap_file(OS_File_Map *map);
+
+// Reports and terminates. For states we can't continue from, e.g. out of reserved address space.
+function void os_fatal_error(String_Const_U8 message);
+
+#endif
@@ -0,0 +1,262 @@
+function u64
+os_memory_page_size(void) {
+	u64 result = (u64)sysconf(_SC_PAGESIZE);
+	return(result);
+}
+
+function void *
+os_memory_reserve(u64 size) {
+	void *result = mmap(null, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (result == MAP_FAILED) {
+		result = null;
+	}
+	return(result);
+}
+
+function b32
+os_memory_commit(void *ptr, u64 size) {
+	b32 result = mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+	return(result);
+}
+
+function void
+os_memory_decommit(void *ptr, u64 size) {
+	// hand the pages back but keep the range reserved, like MEM_DECOMMIT
+	madvise(ptr, size, MADV_DONTNEED);
+	mprotect(ptr, size, PROT_NONE);
+}
+
+function void
+os_memory_release(void *ptr, u64 size) {
+	munmap(ptr, size);
+}
+
+function u32
+os_cpu_count(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	u32 result = count > 0 ? (u32)count : 1;
+	return(result);
+}
+
+typedef struct {
+	OS_Thread_Func *func;
+	void *data;
+} LNX_Thread_Start;
+
+function void *
+lnx_thread_proc(void *param) {
+	LNX_Thread_Start start = *(LNX_Thread_Start *)param;
+	free(param);
+	start.func(start.data);
+	return(null);
+}
+
+function OS_Thread
+os_thread_create(OS_Thread_Func *func, void *data) {
+	LNX_Thread_Start *start = malloc(sizeof(LNX_Thread_Start));
+	start->func = func;
+	start->data = data;
+	
+	pthread_t thread;
+	if (pthread_create(&thread, null, lnx_thread_proc, start) != 0) {
+		os_fatal_error(str8("Failed to create thread"));
+	}
+	
+	OS_Thread result;
+	result.handle = (void *)thread;
+	return(result);
+}
+
+function void
+os_thread_join(OS_Thread thread) {
+	pthread_join((pthread_t)thread.handle, null);
+}
+
+function void
+os_thread_yield(void) {
+	sched_yield();
+}
+
+function OS_Semaphore
+os_semaphore_create(u32 initial_count) {
+	sem_t *semaphore = malloc(sizeof(sem_t));
+	sem_init(semaphore, 0, initial_count);
+	
+	OS_Semaphore result;
+	result.handle = semaphore;
+	return(result);
+}
+
+function void
+os_semaphore_signal(OS_Semaphore semaphore, u32 count) {
+	for (u32 index = 0; index < count; ++index) {
+		sem_post((sem_t *)semaphore.handle);
+	}
+}
+
+function void
+os_semaphore_wait(OS_Semaphore semaphore) {
+	while (sem_wait((sem_t *)semaphore.handle) != 0) {
+		// EINTR, try again
+	}
+}
+
+function void
+os_semaphore_destroy(OS_Semaphore semaphore) {
+	sem_destroy((sem_t *)semaphore.handle);
+	free(semaphore.handle);
+}
+
+// Headless: no window system. The "window" is an RGBA8 buffer and input comes from a script.
+typedef struct {
+	OS_Input_Event *events;
+	u64 count;
+	u64 cursor;
+	u64 frame;
+} LNX_Input_Script;
+
+global LNX_Input_Script lnx_input_script;
+
+function void
+os_set_input_script(OS_Input_Event *events, u64 count) {
+	LNX_Input_Script zero = { 0 };
+	lnx_input_script = zero;
+	lnx_input_script.events = events;
+	lnx_input_script.count = count;
+}
+
+function s32
+os_message_box(String_Const_U8 title, String_Const_U8 message) {
+	fprintf(stderr, "%.*s: %.*s\n", (int)title.char_count, (char *)title.str,
+	        (int)message.char_count, (char *)message.str);
+	return(0);
+}
+
+function OS_Window
+os_create_window(String_Const_U8 name, u32 width, u32 height) {
+	unused(name);
+	
+	OS_Window result;
+	result.client_width = width;
+	result.client_height = height;
+	result.resized_this_frame = False;
+	result.is_focus = True;
+	result.handle = null;
+	result.pixels = (u32 *)calloc((u64)width * height, sizeof(u32));
+	if (!result.pixels) {
+		os_fatal_error(str8("Failed to allocate the offscreen target"));
+	}
+	return(result);
+}
+
+function void
+os_destroy_window(OS_Window *window) {
+	free(window->pixels);
+	window->pixels = null;
+}
+
+function void
+os_fill_events(OS_Input *input, OS_Window *window) {
+	for (u64 key_index = 0; key_index < array_count(input->key_input); ++key_index) {
+		input->key_input[key_index] &= ~(OSInput_Interact_Pressed | OSInput_Interact_Released);
+	}
+	window->resized_this_frame = False;
+	input->mouse_displace_x = 0;
+	input->mouse_displace_y = 0;
+	
+	LNX_Input_Script *script = &lnx_input_script;
+	while ((script->cursor < script->count) && (script->events[script->cursor].frame <= script->frame)) {
+		OS_Input_Event *event = script->events + script->cursor++;
+		if (event->key < OSInput_Key_Count) {
+			if (event->down) {
+				input->key_input[event->key] |= (OSInput_Interact_Pressed | OSInput_Interact_Held);
+			} else {
+				input->key_input[event->key] |= (OSInput_Interact_Released);
+				input->key_input[event->key] &= ~(OSInput_Interact_Held);
+			}
+		}
+		input->mouse_displace_x += event->mouse_displace_x;
+		input->mouse_displace_y += event->mouse_displace_y;
+	}
+	++script->frame;
+}
+
+function u64
+os_time_microseconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	u64 result = (u64)now.tv_sec * 1000000 + (u64)now.tv_nsec / 1000;
+	return(result);
+}
+
+function u64
+os_time_ticks(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	u64 result = (u64)now.tv_sec * 1000000000 + (u64)now.tv_nsec;
+	return(result);
+}
+
+function u64
+os_time_ticks_per_second(void) {
+	return(1000000000);
+}
+
+function b32
+os_write_entire_file(String_Const_U8 path, void *data, u64 size) {
+	char path_z[4096];
+	if (path.char_count >= sizeof(path_z)) {
+		return(False);
+	}
+	memory_copy(path_z, path.str, path.char_count);
+	path_z[path.char_count] = 0;
+	
+	b32 result = False;
+	FILE *file = fopen(path_z, "wb");
+	if (file) {
+		result = fwrite(data, 1, size, file) == size;
+		result = (fclose(file) == 0) && result;
+	}
+	return(result);
+}
+
+function OS_File_Map
+os_map_file(String_Const_U8 path) {
+	OS_File_Map result = { 0 };
+	char path_z[4096];
+	if (path.char_count >= sizeof(path_z)) {
+		return(result);
+	}
+	memory_copy(path_z, path.str, path.char_count);
+	path_z[path.char_count] = 0;
+	
+	int fd = open(path_z, O_RDONLY);
+	if (fd >= 0) {
+		struct stat file_stat;
+		if ((fstat(fd, &file_stat) == 0) && (file_stat.st_size > 0)) {
+			void *data = mmap(null, (u64)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED) {
+				result.data = data;
+				result.size = (u64)file_stat.st_size;
+			}
+		}
+		// the mapping keeps the file alive on its own
+		close(fd);
+	}
+	return(result);
+}
+
+function void
+os_unmap_file(OS_File_Map *map) {
+	if (map->data) {
+		munmap(map->data, map->size);
+	}
+	OS_File_Map zero = { 0 };
+	*map = zero;
+}
+
+function void
+os_fatal_error(String_Const_U8 message) {
+	fprintf(stderr, "Fatal Error: %.*s\n", (int)message.char_count, (char *)message.str);
+	exit(1);
+}
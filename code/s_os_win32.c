@@ -0,0 +1,419 @@
+function u64
+os_memory_page_size(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return(info.dwPageSize);
+}
+
+function void *
+os_memory_reserve(u64 size) {
+	void *result = VirtualAlloc(null, size, MEM_RESERVE, PAGE_NOACCESS);
+	return(result);
+}
+
+function b32
+os_memory_commit(void *ptr, u64 size) {
+	b32 result = VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != null;
+	return(result);
+}
+
+function void
+os_memory_decommit(void *ptr, u64 size) {
+	VirtualFree(ptr, size, MEM_DECOMMIT);
+}
+
+function void
+os_memory_release(void *ptr, u64 size) {
+	unused(size);
+	VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+function u32
+os_cpu_count(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return(info.dwNumberOfProcessors);
+}
+
+typedef struct {
+	OS_Thread_Func *func;
+	void *data;
+} W32_Thread_Start;
+
+function DWORD WINAPI
+w32_thread_proc(LPVOID param) {
+	W32_Thread_Start start = *(W32_Thread_Start *)param;
+	HeapFree(GetProcessHeap(), 0, param);
+	start.func(start.data);
+	return(0);
+}
+
+function OS_Thread
+os_thread_create(OS_Thread_Func *func, void *data) {
+	W32_Thread_Start *start = HeapAlloc(GetProcessHeap(), HEAP_GENERATE_EXCEPTIONS, sizeof(W32_Thread_Start));
+	start->func = func;
+	start->data = data;
+	
+	OS_Thread result;
+	result.handle = CreateThread(null, 0, w32_thread_proc, start, 0, null);
+	if (!result.handle) {
+		os_fatal_error(str8("Failed to create thread"));
+	}
+	return(result);
+}
+
+function void
+os_thread_join(OS_Thread thread) {
+	WaitForSingleObject(thread.handle, INFINITE);
+	CloseHandle(thread.handle);
+}
+
+function void
+os_thread_yield(void) {
+	SwitchToThread();
+}
+
+function OS_Semaphore
+os_semaphore_create(u32 initial_count) {
+	OS_Semaphore result;
+	result.handle = CreateSemaphoreA(null, initial_count, 0x7fffffff, null);
+	return(result);
+}
+
+function void
+os_semaphore_signal(OS_Semaphore semaphore, u32 count) {
+	ReleaseSemaphore(semaphore.handle, count, null);
+}
+
+function void
+os_semaphore_wait(OS_Semaphore semaphore) {
+	WaitForSingleObject(semaphore.handle, INFINITE);
+}
+
+function void
+os_semaphore_destroy(OS_Semaphore semaphore) {
+	CloseHandle(semaphore.handle);
+}
+
+function s32
+os_message_box(String_Const_U8 title, String_Const_U8 message) {
+	s32 result = MessageBoxA(null, (char *)(message.str),
+							 (char *)(title.str),
+							 MB_OK);
+	return(result);
+}
+
+function OS_Window
+os_create_window(String_Const_U8 name, u32 width, u32 height) {
+	OS_Window result;
+    
+	RECT window_rect;
+	window_rect.left = 0;
+	window_rect.top = 0;
+	window_rect.right = width;
+	window_rect.bottom = height;
+	AdjustWindowRect(&window_rect, WS_OVERLAPPEDWINDOW, FALSE);
+    
+	HWND window_handle = CreateWindowA("my_window_class",
+									   (char *)name.str, WS_OVERLAPPEDWINDOW,
+                                       0, 0, window_rect.right - window_rect.left,
+                                       window_rect.bottom - window_rect.top, null,
+                                       null, GetModuleHandleA(null), null);
+    
+	if (!IsWindow(window_handle)) {
+		os_message_box(str8("Error"), str8("Failed To Create Window"));
+		ExitProcess(1);
+	}
+    
+	ShowWindow(window_handle, SW_SHOW);
+    
+	result.client_width = width;
+	result.client_height = height;
+	result.resized_this_frame = False;
+	result.handle = window_handle;
+	result.is_focus = True;
+	result.pixels = null;
+	return(result);
+}
+
+function void
+os_destroy_window(OS_Window *window) {
+	// closing the window already destroyed it
+	if (IsWindow((HWND)window->handle)) {
+		DestroyWindow((HWND)window->handle);
+	}
+	window->handle = null;
+}
+
+function LRESULT __stdcall
+w32_window_proc(HWND window, UINT message, 
+				WPARAM wparam, LPARAM lparam) {
+	LRESULT result = 0;
+    
+	OS_Window *os_window = (OS_Window *)GetWindowLongPtrA(window, GWLP_USERDATA);
+	switch (message) {
+		case WM_CLOSE: {
+			DestroyWindow(window);
+		} break;
+        
+		case WM_SIZE: {
+			if (os_window) {
+				u32 new_width = (u32)LOWORD(lparam);
+				u32 new_height = (u32)HIWORD(lparam);
+                
+				os_window->client_width = new_width;
+				os_window->client_height = new_height;
+				os_window->resized_this_frame = False;
+			}
+		} break;
+        
+        case WM_KILLFOCUS: {
+            if (os_window) {
+                os_window->is_focus = False;
+            }
+        } break;
+        
+        case WM_SETFOCUS: {
+            if (os_window) {
+                os_window->is_focus = True;
+            }
+        } break;
+        
+		case WM_DESTROY: {
+			PostQuitMessage(0);
+		} break;
+        
+		default: {
+			return DefWindowProc(window, message, wparam, lparam);
+		} break;
+	}
+    
+	return(result);
+}
+
+function OS_Input_Key
+w32_map_wparam_to_input_key(WPARAM wparam) {
+	OS_Input_Key result;
+    
+	switch (wparam) {
+		case VK_SHIFT: {
+			result = OSInput_Key_Shift;
+		} break;
+        
+		case VK_SPACE: {
+			result = OSInput_Key_Space;
+		} break;
+        
+		case VK_ESCAPE: {
+			result = OSInput_Key_Escape;
+		} break;
+        
+		case 'W': {
+			result = OSInput_Key_W;
+		} break;
+		
+		case 'A': {
+			result = OSInput_Key_A;
+		} break;
+        
+		case 'S': {
+			result = OSInput_Key_S;
+		} break;
+		
+		case 'D': {
+			result = OSInput_Key_D;
+		} break;
+        
+		case VK_UP: {
+			result = OSInput_Key_Up;
+		} break;
+		
+		case VK_DOWN: {
+			result = OSInput_Key_Down;
+		} break;
+		
+		case VK_LEFT: {
+			result = OSInput_Key_Left;
+		} break;
+        
+		case VK_RIGHT: {
+			result = OSInput_Key_Right;
+		} break;
+        
+		case 'V': {
+			result = OSInput_Key_V;
+		} break;
+        
+		case 'P': {
+			result = OSInput_Key_P;
+		} break;
+		
+		default: {
+			result = OSInput_Key_Count;
+		} break;
+	}
+    
+	return(result);
+}
+
+function void
+os_fill_events(OS_Input *input, OS_Window *window) {
+	for (u64 key_index = 0; key_index < array_count(input->key_input); ++key_index) {
+		input->key_input[key_index] &= ~(OSInput_Interact_Pressed | OSInput_Interact_Released);
+	}
+    
+	window->resized_this_frame = False;
+	SetWindowLongPtrA((HWND)window->handle, GWLP_USERDATA, (LONG_PTR)window);
+    
+	MSG message;
+	while (PeekMessageA(&message, null, 0, 0, PM_REMOVE) != 0) {
+		switch (message.message) {
+			case WM_QUIT: {
+				input->flags |= OSInput_Flag_Quit;
+			} break;
+			
+			case WM_KEYDOWN: {
+				OS_Input_Key key = w32_map_wparam_to_input_key(message.wParam);
+				if (key != OSInput_Key_Count) {
+					input->key_input[key] |= (OSInput_Interact_Pressed | OSInput_Interact_Held);
+				}
+			} break;
+			
+			case WM_KEYUP: {
+				OS_Input_Key key = w32_map_wparam_to_input_key(message.wParam);
+				if (key != OSInput_Key_Count) {
+					input->key_input[key] |= (OSInput_Interact_Released);
+					input->key_input[key] &= ~(OSInput_Interact_Held);
+				}
+			} break;
+            
+			default: {
+				TranslateMessage(&message);
+				DispatchMessage(&message);
+			} break;
+		}
+	}
+    
+    if (window->is_focus) {
+        POINT cursor_p;
+        GetCursorPos(&cursor_p);
+        ScreenToClient((HWND)window->handle, &cursor_p);
+        
+        input->mouse_displace_x = cursor_p.x - (window->client_width / 2);
+        input->mouse_displace_y = cursor_p.y - (window->client_height / 2);
+        
+        POINT new_cursor;
+        new_cursor.x = window->client_width / 2;
+        new_cursor.y = window->client_height / 2;
+        ClientToScreen((HWND)window->handle, &new_cursor);
+        SetCursorPos(new_cursor.x, new_cursor.y);
+        
+        SetCursor(null);
+    }
+}
+
+function u64
+os_time_microseconds(void) {
+	local LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	u64 result = (u64)((counter.QuadPart / frequency.QuadPart) * 1000000 +
+	                   ((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+	return(result);
+}
+
+function u64
+os_time_ticks(void) {
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	u64 result = (u64)counter.QuadPart;
+	return(result);
+}
+
+function u64
+os_time_ticks_per_second(void) {
+	local LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	u64 result = (u64)frequency.QuadPart;
+	return(result);
+}
+
+function b32
+os_write_entire_file(String_Const_U8 path, void *data, u64 size) {
+	char path_z[MAX_PATH];
+	if (path.char_count >= sizeof(path_z)) {
+		return(False);
+	}
+	memory_copy(path_z, path.str, path.char_count);
+	path_z[path.char_count] = 0;
+	
+	b32 result = False;
+	HANDLE file = CreateFileA(path_z, GENERIC_WRITE, 0, null, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, null);
+	if (file != INVALID_HANDLE_VALUE) {
+		result = True;
+		u8 *at = (u8 *)data;
+		while (result && size) {
+			DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+			DWORD written = 0;
+			result = WriteFile(file, at, chunk, &written, null) && (written == chunk);
+			at += written;
+			size -= written;
+		}
+		CloseHandle(file);
+	}
+	return(result);
+}
+
+function OS_File_Map
+os_map_file(String_Const_U8 path) {
+	OS_File_Map result = { 0 };
+	char path_z[MAX_PATH];
+	if (path.char_count >= sizeof(path_z)) {
+		return(result);
+	}
+	memory_copy(path_z, path.str, path.char_count);
+	path_z[path.char_count] = 0;
+	
+	HANDLE file = CreateFileA(path_z, GENERIC_READ, FILE_SHARE_READ, null, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, null);
+	if (file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER file_size;
+		if (GetFileSizeEx(file, &file_size) && (file_size.QuadPart > 0)) {
+			HANDLE mapping = CreateFileMappingA(file, null, PAGE_READONLY, 0, 0, null);
+			if (mapping) {
+				void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				if (data) {
+					result.data = data;
+					result.size = (u64)file_size.QuadPart;
+					result.handle = mapping;
+				} else {
+					CloseHandle(mapping);
+				}
+			}
+		}
+		// the mapping keeps the file open on its own
+		CloseHandle(file);
+	}
+	return(result);
+}
+
+function void
+os_unmap_file(OS_File_Map *map) {
+	if (map->data) {
+		UnmapViewOfFile(map->data);
+		CloseHandle(map->handle);
+	}
+	OS_File_Map zero = { 0 };
+	*map = zero;
+}
+
+function void
+os_fatal_error(String_Const_U8 message) {
+	MessageBoxA(null, (char *)message.str, "Fatal Error", MB_OK);
+	ExitProcess(1);
+}
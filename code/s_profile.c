@@ -0,0 +1,250 @@
+global Profiler profiler;
+per_thread Profile_Thread *profile_thread;
+
+// The calling thread's ring, made on first use. Null once profile_thread_max threads have one,
+// their zones are then ignored.
+function Profile_Thread *
+profile_get_thread(void) {
+    Profile_Thread *result = profile_thread;
+    if (!result) {
+        u64 index = atomic_add_u64(&profiler.thread_count, 1) - 1;
+        if (index < profile_thread_max) {
+            result = (Profile_Thread *)os_memory_reserve(sizeof(Profile_Thread));
+            if (!result || !os_memory_commit(result, sizeof(Profile_Thread))) {
+                os_fatal_error(str8("Out of memory for the profiler"));
+            }
+            result->index = (u32)index;
+            // profile_frame_end may look at the slot as soon as the count moves
+            memory_fence();
+            profiler.threads[index] = result;
+            profile_thread = result;
+        }
+    }
+    return(result);
+}
+
+function void
+profile_init(void) {
+    profiler.ticks_per_second = os_time_ticks_per_second();
+    profiler.start = os_time_ticks();
+    profiler.capture_arena = arena_reserve(gigabytes(4));
+    profiler.capture = (Profile_Event *)profiler.capture_arena.base;
+
+    profiler.gpu = (Profile_Thread *)os_memory_reserve(sizeof(Profile_Thread));
+    if (!profiler.gpu || !os_memory_commit(profiler.gpu, sizeof(Profile_Thread))) {
+        os_fatal_error(str8("Out of memory for the profiler"));
+    }
+    profiler.gpu->index = profile_thread_max;
+    // the calling thread is the main thread, ring 0
+    profile_get_thread();
+}
+
+function void
+profile_push_event(Profile_Thread *thread, char *name, u64 begin, u64 end, u32 depth) {
+    u64 write = thread->write;
+    if (write - atomic_load_u64(&thread->read) >= profile_ring_capacity) {
+        ++thread->dropped;
+        return;
+    }
+    Profile_Event *event = thread->events + (write & (profile_ring_capacity - 1));
+    event->name = name;
+    event->begin = begin;
+    event->end = end;
+    event->depth = depth;
+    event->thread = thread->index;
+    // the event is written before the consumer can see it
+    atomic_store_u64(&thread->write, write + 1);
+}
+
+function void
+profile_begin(char *name) {
+    Profile_Thread *thread = profile_get_thread();
+    if (thread) {
+        if (thread->depth < profile_depth_max) {
+            thread->open_names[thread->depth] = name;
+            thread->open_begins[thread->depth] = os_time_ticks();
+        }
+        ++thread->depth;
+    }
+}
+
+function void
+profile_end(void) {
+    Profile_Thread *thread = profile_thread;
+    if (thread && thread->depth) {
+        u64 end = os_time_ticks();
+        --thread->depth;
+        if (thread->depth < profile_depth_max) {
+            profile_push_event(thread, thread->open_names[thread->depth], thread->open_begins[thread->depth], end,
+                               thread->depth);
+        }
+    }
+}
+
+function void
+profile_gpu_zone(char *name, u64 begin, u64 end) {
+    profile_push_event(profiler.gpu, name, begin, end, 0);
+}
+
+function Profile_Zone *
+profile_zone_find(char *name) {
+    u64 hash = ((u64)name * 0x9E3779B97F4A7C15ull) >> 32;
+    for (u32 probe = 0; probe < profile_zone_max; ++probe) {
+        u32 slot = (u32)(hash + probe) & (profile_zone_max - 1);
+        Profile_Zone *zone = profiler.zones + slot;
+        if (zone->name == name) {
+            return(zone);
+        }
+        if (!zone->name) {
+            zone->name = name;
+            profiler.zone_order[profiler.zone_count++] = slot;
+            return(zone);
+        }
+    }
+    return(null);
+}
+
+function void
+profile_drain(Profile_Thread *thread) {
+    u64 write = atomic_load_u64(&thread->write);
+    for (u64 index = thread->read; index < write; ++index) {
+        Profile_Event *event = thread->events + (index & (profile_ring_capacity - 1));
+        Profile_Zone *zone = profile_zone_find(event->name);
+        if (zone) {
+            zone->frame_ticks += event->end - event->begin;
+            ++zone->frame_calls;
+        }
+        if (profiler.capturing) {
+            Profile_Event *captured = (Profile_Event *)arena_push(&profiler.capture_arena, sizeof(Profile_Event), 8);
+            if (captured) {
+                *captured = *event;
+                ++profiler.capture_count;
+            } else {
+                profiler.capturing = False;
+            }
+        }
+    }
+    atomic_store_u64(&thread->read, write);
+}
+
+function void
+profile_frame_end(void) {
+    u64 thread_count = atomic_load_u64(&profiler.thread_count);
+    thread_count = thread_count < profile_thread_max ? thread_count : profile_thread_max;
+    for (u64 index = 0; index < thread_count; ++index) {
+        // registered but not published yet, its events wait for the next frame
+        Profile_Thread *thread = profiler.threads[index];
+        if (thread) {
+            profile_drain(thread);
+        }
+    }
+    profile_drain(profiler.gpu);
+
+    for (u32 order = 0; order < profiler.zone_count; ++order) {
+        Profile_Zone *zone = profiler.zones + profiler.zone_order[order];
+        if (zone->frame_calls) {
+            zone->history[zone->history_count % profile_history_frames] = zone->frame_ticks;
+            ++zone->history_count;
+            zone->frame_ticks = 0;
+            zone->frame_calls = 0;
+        }
+    }
+    ++profiler.frame_index;
+}
+
+function void
+profile_capture_begin(void) {
+    arena_clear(&profiler.capture_arena);
+    profiler.capture_count = 0;
+    profiler.capturing = True;
+}
+
+function void
+profile_capture_end(void) {
+    profiler.capturing = False;
+}
+
+function f64
+profile_ticks_to_us(u64 ticks) {
+    f64 result = (f64)ticks * 1000000.0 / (f64)profiler.ticks_per_second;
+    return(result);
+}
+
+function b32
+profile_write_chrome_trace(Arena *scratch, String_Const_U8 path) {
+    u64 scratch_pos = scratch->pos;
+    // every line fits in this, names are short literals
+    u64 line_max = 256;
+    // two metadata lines a track, threads and the GPU
+    u64 line_count = profiler.capture_count + (profile_thread_max + 1) * 2;
+    char *json = arena_push_array(scratch, char, line_count * line_max + 64);
+    if (!json) {
+        return(False);
+    }
+
+    u64 size = (u64)snprintf(json, 64, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    b32 first = True;
+    u64 thread_count = atomic_load_u64(&profiler.thread_count);
+    thread_count = thread_count < profile_thread_max ? thread_count : profile_thread_max;
+    for (u64 thread = 0; thread <= thread_count; ++thread) {
+        // the GPU track sits after the threads
+        u32 tid = thread == thread_count ? profile_thread_max : (u32)thread;
+        char name[32];
+        if (tid == profile_thread_max) {
+            snprintf(name, sizeof(name), "GPU");
+        } else if (tid == 0) {
+            snprintf(name, sizeof(name), "main");
+        } else {
+            snprintf(name, sizeof(name), "thread %u", tid);
+        }
+        size += (u64)snprintf(json + size, line_max,
+                              "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                              first ? "" : ",\n", tid, name);
+        size += (u64)snprintf(json + size, line_max,
+                              ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"sort_index\":%u}}",
+                              tid, tid);
+        first = False;
+    }
+    for (u64 index = 0; index < profiler.capture_count; ++index) {
+        Profile_Event *event = profiler.capture + index;
+        size += (u64)snprintf(json + size, line_max,
+                              ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                              event->name, event->thread, profile_ticks_to_us(event->begin - profiler.start),
+                              profile_ticks_to_us(event->end - event->begin));
+    }
+    size += (u64)snprintf(json + size, 64, "\n]}\n");
+
+    b32 result = os_write_entire_file(path, json, size);
+    arena_pop_to(scratch, scratch_pos);
+    return(result);
+}
+
+function int
+profile_compare_u64(const void *a, const void *b) {
+    u64 x = *(const u64 *)a;
+    u64 y = *(const u64 *)b;
+    int result = (x > y) - (x < y);
+    return(result);
+}
+
+function Profile_Stats *
+profile_stats(Arena *arena, u32 *count) {
+    *count = profiler.zone_count;
+    Profile_Stats *result = arena_push_array(arena, Profile_Stats, profiler.zone_count);
+    u64 *sorted = arena_push_array(arena, u64, profile_history_frames);
+    for (u32 order = 0; order < profiler.zone_count; ++order) {
+        Profile_Zone *zone = profiler.zones + profiler.zone_order[order];
+        Profile_Stats *stats = result + order;
+        u64 frames = zone->history_count < profile_history_frames ? zone->history_count : profile_history_frames;
+        stats->name = zone->name;
+        stats->frames = frames;
+        if (frames) {
+            memory_copy(sorted, zone->history, frames * sizeof(u64));
+            qsort(sorted, frames, sizeof(u64), profile_compare_u64);
+            stats->p50_us = profile_ticks_to_us(sorted[frames / 2]);
+            stats->p99_us = profile_ticks_to_us(sorted[(frames * 99) / 100]);
+            stats->max_us = profile_ticks_to_us(sorted[frames - 1]);
+        }
+    }
+    return(result);
+}
@@ -0,0 +1,105 @@
+#if !defined(S_PROFILE_H)
+#define S_PROFILE_H
+
+// Scoped-zone frame profiler. profile_begin / profile_end bracket a zone on whichever thread runs
+// them, zones nest, and each finished zone goes into its thread's ring. A thread gets its ring the
+// first time it opens a zone, so job workers need no setup. Every ring has one producer and one
+// consumer: the owning thread writes, profile_frame_end on the main thread drains them all. It
+// adds each zone's time to that zone's total for the frame, the rolling history profile_stats
+// reads, and while capturing keeps the events themselves for profile_write_chrome_trace.
+//
+// GPU zones arrive already finished, from timestamp queries read back frames later, through
+// profile_gpu_zone and get a track of their own.
+//
+// Times are os_time_ticks. Zones are told apart by the name pointer, so names are string literals,
+// and a GPU zone needs a different name from the CPU work that records it.
+
+#define profile_thread_max 64
+// power of two, events a thread can finish between two profile_frame_end
+#define profile_ring_capacity (1 << 16)
+#define profile_depth_max 32
+// power of two
+#define profile_zone_max 256
+#define profile_history_frames 1024
+
+typedef struct {
+    char *name;
+    u64 begin;
+    u64 end;
+    u32 depth;
+    u32 thread;
+} Profile_Event;
+
+typedef struct {
+    // only the owning thread moves write, only profile_frame_end moves read
+    volatile u64 write;
+    u8 __pad_a[56];
+    volatile u64 read;
+    u8 __pad_b[56];
+    // finished while the ring was full
+    volatile u64 dropped;
+    u32 index;
+    u32 depth;
+    char *open_names[profile_depth_max];
+    u64 open_begins[profile_depth_max];
+    Profile_Event events[profile_ring_capacity];
+} Profile_Thread;
+
+typedef struct {
+    char *name;
+    // summed over every thread and call since the last profile_frame_end
+    u64 frame_ticks;
+    u32 frame_calls;
+    // frame totals for the frames the zone ran in, history_count % profile_history_frames is next
+    u64 history_count;
+    u64 history[profile_history_frames];
+} Profile_Zone;
+
+typedef struct {
+    char *name;
+    // frames in the window
+    u64 frames;
+    f64 p50_us;
+    f64 p99_us;
+    f64 max_us;
+} Profile_Stats;
+
+typedef struct {
+    u64 ticks_per_second;
+    u64 start;
+
+    volatile u64 thread_count;
+    Profile_Thread *volatile threads[profile_thread_max];
+    Profile_Thread *gpu;
+
+    // open addressing on the name pointer; zone_order is first-seen order, for reporting
+    Profile_Zone zones[profile_zone_max];
+    u32 zone_order[profile_zone_max];
+    u32 zone_count;
+    u64 frame_index;
+
+    b32 capturing;
+    Arena capture_arena;
+    Profile_Event *capture;
+    u64 capture_count;
+} Profiler;
+
+function void profile_init(void);
+function void profile_begin(char *name);
+function void profile_end(void);
+// begin and end are os_time_ticks, converted from GPU time by the caller. Main thread only.
+function void profile_gpu_zone(char *name, u64 begin, u64 end);
+// Main thread, once a frame.
+function void profile_frame_end(void);
+
+// Events drained while capturing are kept, from the frame capture starts on.
+function void profile_capture_begin(void);
+function void profile_capture_end(void);
+// The captured events as Chrome trace JSON, for chrome://tracing or ui.perfetto.dev.
+function b32 profile_write_chrome_trace(Arena *scratch, String_Const_U8 path);
+
+// p50 / p99 / max of every zone's frame totals over the last profile_history_frames frames it ran
+// in, in first-seen order, pushed to arena.
+function Profile_Stats *profile_stats(Arena *arena, u32 *count);
+
+#endif
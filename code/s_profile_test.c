@@ -0,0 +1,367 @@
+// Profiler: zones finished on job workers all reach profile_frame_end, on the track of the thread
+// that ran them; a full ring counts what it drops instead of overwriting; profile_stats picks the
+// percentiles it should out of a known history; and the Chrome trace parses as JSON. The profiler
+// is one global every other test's job workers have been taking rings from, so this runs on a
+// fresh one and puts the old one back after.
+
+#define profile_test_job_count 64
+
+global Profiler profile_test_saved;
+// zones are told apart by the name pointer, so each job gets its own
+global char profile_test_names[profile_test_job_count][16];
+
+typedef struct {
+    u32 threads[profile_test_job_count];
+    // a job the main thread picks up in job_wait nests inside the zone it has open
+    u32 depths[profile_test_job_count];
+    // jobs that have started, the first few wait for each other so several workers take part
+    volatile u64 started;
+    u32 gather;
+} Profile_Test_Jobs;
+
+function void
+profile_test_spin(u64 ticks) {
+    u64 start = os_time_ticks();
+    while (os_time_ticks() - start < ticks) {
+    }
+}
+
+function void
+profile_test_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Profile_Test_Jobs *jobs = (Profile_Test_Jobs *)data;
+    u64 second = os_time_ticks_per_second();
+    for (u64 index = begin; index < end; ++index) {
+        profile_begin(profile_test_names[index]);
+        if (atomic_add_u64(&jobs->started, 1) <= jobs->gather) {
+            u64 start = os_time_ticks();
+            while ((atomic_load_u64(&jobs->started) < jobs->gather) && (os_time_ticks() - start < second)) {
+            }
+        }
+        profile_begin("profile test inner");
+        profile_test_spin(second / 50000);
+        profile_end();
+        profile_end();
+        jobs->threads[index] = profile_thread->index;
+        jobs->depths[index] = profile_thread->depth;
+    }
+}
+
+// Just enough of a JSON parser to say whether text is one well-formed value.
+typedef struct {
+    u8 *at;
+    u8 *end;
+} Profile_Test_Json;
+
+function void
+profile_test_json_space(Profile_Test_Json *json) {
+    while ((json->at < json->end) && ((*json->at == ' ') || (*json->at == '\n') || (*json->at == '\r') ||
+                                      (*json->at == '\t'))) {
+        ++json->at;
+    }
+}
+
+function b32
+profile_test_json_literal(Profile_Test_Json *json, char *literal) {
+    u64 length = strlen(literal);
+    b32 result = ((u64)(json->end - json->at) >= length) && (memory_compare(json->at, literal, length) == 0);
+    json->at += result ? length : 0;
+    return(result);
+}
+
+function b32
+profile_test_json_digits(Profile_Test_Json *json) {
+    u8 *start = json->at;
+    while ((json->at < json->end) && (*json->at >= '0') && (*json->at <= '9')) {
+        ++json->at;
+    }
+    b32 result = json->at > start;
+    return(result);
+}
+
+function b32
+profile_test_json_string(Profile_Test_Json *json) {
+    if (!profile_test_json_literal(json, "\"")) {
+        return(False);
+    }
+    while (json->at < json->end) {
+        u8 c = *json->at++;
+        if (c == '"') {
+            return(True);
+        }
+        if (c < 0x20) {
+            return(False);
+        }
+        if (c == '\\') {
+            if ((json->at == json->end) || !strchr("\"\\/bfnrtu", *json->at)) {
+                return(False);
+            }
+            ++json->at;
+        }
+    }
+    return(False);
+}
+
+function b32
+profile_test_json_value(Profile_Test_Json *json) {
+    profile_test_json_space(json);
+    if (json->at == json->end) {
+        return(False);
+    }
+    b32 result = False;
+    u8 c = *json->at;
+    if ((c == '{') || (c == '[')) {
+        u8 close = c == '{' ? '}' : ']';
+        ++json->at;
+        profile_test_json_space(json);
+        if ((json->at < json->end) && (*json->at == close)) {
+            ++json->at;
+            return(True);
+        }
+        for (;;) {
+            if (c == '{') {
+                profile_test_json_space(json);
+                if (!profile_test_json_string(json)) {
+                    return(False);
+                }
+                profile_test_json_space(json);
+                if (!profile_test_json_literal(json, ":")) {
+                    return(False);
+                }
+            }
+            if (!profile_test_json_value(json)) {
+                return(False);
+            }
+            profile_test_json_space(json);
+            if (json->at == json->end) {
+                return(False);
+            }
+            u8 next = *json->at++;
+            if (next == close) {
+                return(True);
+            }
+            if (next != ',') {
+                return(False);
+            }
+        }
+    } else if (c == '"') {
+        result = profile_test_json_string(json);
+    } else if ((c == '-') || ((c >= '0') && (c <= '9'))) {
+        profile_test_json_literal(json, "-");
+        result = profile_test_json_digits(json);
+        if (result && profile_test_json_literal(json, ".")) {
+            result = profile_test_json_digits(json);
+        }
+        if (result && (profile_test_json_literal(json, "e") || profile_test_json_literal(json, "E"))) {
+            if (!profile_test_json_literal(json, "+")) {
+                profile_test_json_literal(json, "-");
+            }
+            result = profile_test_json_digits(json);
+        }
+    } else {
+        result = profile_test_json_literal(json, "true") || profile_test_json_literal(json, "false") ||
+            profile_test_json_literal(json, "null");
+    }
+    return(result);
+}
+
+function u64
+profile_test_count_substring(u8 *text, u64 size, char *substring) {
+    u64 length = strlen(substring);
+    u64 result = 0;
+    for (u64 at = 0; at + length <= size; ++at) {
+        result += memory_compare(text + at, substring, length) == 0;
+    }
+    return(result);
+}
+
+function Profile_Stats *
+profile_test_find_stats(Profile_Stats *stats, u32 count, char *name) {
+    Profile_Stats *result = null;
+    for (u32 index = 0; index < count; ++index) {
+        result = stats[index].name == name ? stats + index : result;
+    }
+    return(result);
+}
+
+function f64
+profile_test_us(u64 ticks) {
+    f64 result = (f64)ticks * 1000000.0 / (f64)os_time_ticks_per_second();
+    return(result);
+}
+
+function void
+test_profile(void) {
+    profile_test_saved = profiler;
+    Profile_Thread *saved_thread = profile_thread;
+    memset(&profiler, 0, sizeof(profiler));
+    profile_thread = null;
+    profile_init();
+    Arena arena = arena_reserve(megabytes(64));
+
+    // Zones from the workers of a job system, captured, and the GPU zone the main thread adds.
+    u64 gpu_begin = os_time_ticks();
+    {
+        u32 worker_count = 4;
+        Job_System jobs;
+        job_system_init(&jobs, worker_count);
+        Profile_Test_Jobs test = { 0 };
+        test.gather = worker_count;
+        for (u32 index = 0; index < profile_test_job_count; ++index) {
+            snprintf(profile_test_names[index], sizeof(profile_test_names[index]), "job %u", index);
+        }
+
+        profile_capture_begin();
+        profile_begin("profile test frame");
+        Job_Fence fence = { 0 };
+        job_parallel_for(&jobs, &fence, profile_test_job_count, 1, profile_test_job, &test);
+        job_wait(&jobs, &fence);
+        profile_end();
+        profile_gpu_zone("profile test gpu", gpu_begin, gpu_begin + os_time_ticks_per_second() / 1000);
+        job_system_release(&jobs);
+        profile_frame_end();
+        profile_capture_end();
+
+        // every job's zone once, on its thread's track, with its time in its zone's history
+        u32 seen[profile_test_job_count] = { 0 };
+        u32 wrong_thread = 0;
+        u32 wrong_total = 0;
+        u32 inner = 0;
+        u64 threads_seen = 0;
+        for (u64 index = 0; index < profiler.capture_count; ++index) {
+            Profile_Event *event = profiler.capture + index;
+            if ((event->name >= profile_test_names[0]) && (event->name <= profile_test_names[profile_test_job_count - 1])) {
+                u32 job = (u32)((event->name - profile_test_names[0]) / sizeof(profile_test_names[0]));
+                ++seen[job];
+                wrong_thread += (event->thread != test.threads[job]) || (event->depth != test.depths[job]);
+                Profile_Zone *zone = profile_zone_find(event->name);
+                wrong_total += (zone->history_count != 1) || (zone->history[0] != event->end - event->begin);
+                threads_seen |= 1ull << event->thread;
+            } else if (strcmp(event->name, "profile test inner") == 0) {
+                inner += event->depth >= 1;
+            }
+        }
+        u32 missing = 0;
+        for (u32 job = 0; job < profile_test_job_count; ++job) {
+            missing += seen[job] != 1;
+        }
+        u32 thread_count = 0;
+        for (u32 thread = 0; thread < 64; ++thread) {
+            thread_count += (threads_seen >> thread) & 1;
+        }
+        test_check(!missing && !wrong_thread && !wrong_total && (inner == profile_test_job_count),
+                   "job zones: %u missing, %u on the wrong track, %u with the wrong total, %u inner of %u", missing,
+                   wrong_thread, wrong_total, inner, profile_test_job_count);
+        test_check(thread_count == worker_count, "job zones came from %u threads of %u", thread_count, worker_count);
+        test_check(profiler.capture_count == profile_test_job_count * 2 + 2, "%llu events captured, expected %u",
+                   (unsigned long long)profiler.capture_count, profile_test_job_count * 2 + 2);
+    }
+
+    // The trace of that capture: one JSON value, an X event for every captured one, and a track
+    // named for every thread plus the GPU.
+    {
+        char path_z[64];
+        snprintf(path_z, sizeof(path_z), "/tmp/s_test_profile_%d.json", (int)getpid());
+        String_Const_U8 path = str8_make(path_z, strlen(path_z));
+        b32 written = profile_write_chrome_trace(&arena, path);
+        OS_File_Map map = os_map_file(path);
+        if (test_check(written && map.data, "the trace wasn't written")) {
+            Profile_Test_Json json = { (u8 *)map.data, (u8 *)map.data + map.size };
+            b32 parsed = profile_test_json_value(&json);
+            profile_test_json_space(&json);
+            test_check(parsed && (json.at == json.end), "the trace isn't JSON, stopped at byte %llu of %llu",
+                       (unsigned long long)(json.at - (u8 *)map.data), (unsigned long long)map.size);
+            u64 events = profile_test_count_substring((u8 *)map.data, map.size, "\"ph\":\"X\"");
+            u64 names = profile_test_count_substring((u8 *)map.data, map.size, "\"name\":\"thread_name\"");
+            u64 gpu = profile_test_count_substring((u8 *)map.data, map.size, "\"args\":{\"name\":\"GPU\"}");
+            u64 thread_count = atomic_load_u64(&profiler.thread_count);
+            test_check((events == profiler.capture_count) && (names == thread_count + 1) && (gpu == 1),
+                       "the trace has %llu events of %llu, %llu track names for %llu threads and the GPU",
+                       (unsigned long long)events, (unsigned long long)profiler.capture_count,
+                       (unsigned long long)names, (unsigned long long)thread_count);
+            os_unmap_file(&map);
+        }
+        unlink(path_z);
+    }
+
+    // A ring takes profile_ring_capacity events between drains. The rest are counted, not written
+    // over the ones waiting, and once drained it takes events again.
+    {
+        Profile_Thread *thread = profile_thread;
+        u64 dropped = thread->dropped;
+        u64 extra = 100;
+        for (u64 index = 0; index < profile_ring_capacity + extra; ++index) {
+            profile_begin("profile test overflow");
+            profile_end();
+        }
+        test_check((thread->dropped - dropped == extra) && (thread->write - thread->read == profile_ring_capacity),
+                   "a full ring dropped %llu of %llu extra events and holds %llu",
+                   (unsigned long long)(thread->dropped - dropped), (unsigned long long)extra,
+                   (unsigned long long)(thread->write - thread->read));
+        profile_frame_end();
+        Profile_Zone *zone = profile_zone_find("profile test overflow");
+        test_check((zone->history_count == 1) && (thread->write == thread->read), "the full ring wasn't drained");
+        dropped = thread->dropped;
+        profile_begin("profile test overflow");
+        profile_end();
+        test_check((thread->dropped == dropped) && (thread->write - thread->read == 1),
+                   "a drained ring dropped an event");
+        profile_frame_end();
+    }
+
+    // Stats, from GPU zones whose times are given. "profile test shuffled" runs 1100 frames: 76
+    // slow ones the history has forgotten by the end, then 1 to 1024 thousand ticks in a random
+    // order, so its sorted history holds (n + 1) thousand at n. "profile test twice" runs twice in
+    // every other frame and reports the sum of each pair.
+    {
+        u64 *totals = arena_push_array(&arena, u64, profile_history_frames);
+        for (u32 index = 0; index < profile_history_frames; ++index) {
+            totals[index] = (u64)(index + 1) * 1000;
+        }
+        Test_Random random = test_random_make(220);
+        for (u32 index = profile_history_frames - 1; index > 0; --index) {
+            u32 other = test_random_u32(&random) % (index + 1);
+            u64 swap = totals[index];
+            totals[index] = totals[other];
+            totals[other] = swap;
+        }
+
+        u64 forgotten = 76;
+        for (u64 frame = 0; frame < forgotten + profile_history_frames; ++frame) {
+            u64 total = frame < forgotten ? 1000000000 : totals[frame - forgotten];
+            profile_gpu_zone("profile test shuffled", gpu_begin, gpu_begin + total);
+            if (frame & 1) {
+                profile_gpu_zone("profile test twice", gpu_begin, gpu_begin + 500);
+                profile_gpu_zone("profile test twice", gpu_begin + 500, gpu_begin + 750);
+            }
+            profile_frame_end();
+        }
+
+        u32 count;
+        Profile_Stats *stats = profile_stats(&arena, &count);
+        Profile_Stats *shuffled = profile_test_find_stats(stats, count, "profile test shuffled");
+        Profile_Stats *twice = profile_test_find_stats(stats, count, "profile test twice");
+        // sorted[1024 / 2] and sorted[1024 * 99 / 100], then the last
+        if (test_check(shuffled && twice, "stats are missing a zone")) {
+            test_check((shuffled->frames == profile_history_frames) && (shuffled->p50_us == profile_test_us(513000)) &&
+                       (shuffled->p99_us == profile_test_us(1014000)) && (shuffled->max_us == profile_test_us(1024000)),
+                       "shuffled: %llu frames, p50 %g p99 %g max %g us", (unsigned long long)shuffled->frames,
+                       shuffled->p50_us, shuffled->p99_us, shuffled->max_us);
+            u64 twice_frames = (forgotten + profile_history_frames) / 2;
+            test_check((twice->frames == twice_frames) && (twice->p50_us == profile_test_us(750)) &&
+                       (twice->p99_us == profile_test_us(750)) && (twice->max_us == profile_test_us(750)),
+                       "twice: %llu frames, p50 %g p99 %g max %g us", (unsigned long long)twice->frames, twice->p50_us,
+                       twice->p99_us, twice->max_us);
+        }
+    }
+
+    arena_release(&arena);
+    u64 thread_count = atomic_load_u64(&profiler.thread_count);
+    for (u64 index = 0; index < thread_count; ++index) {
+        os_memory_release(profiler.threads[index], sizeof(Profile_Thread));
+    }
+    os_memory_release(profiler.gpu, sizeof(Profile_Thread));
+    arena_release(&profiler.capture_arena);
+    profiler = profile_test_saved;
+    profile_thread = saved_thread;
+}
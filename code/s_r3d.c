@@ -0,0 +1,616 @@
+function void
+r3d_init(R3D_Buffer *buffer, u64 max_capacity, R3D_Layout layout) {
+    R3D_Buffer zero = { 0 };
+    *buffer = zero;
+    buffer->layout = layout;
+    buffer->max_capacity = (max_capacity + 3) & ~3ull;
+    
+    switch (layout) {
+        case R3D_Layout_AoS: {
+            buffer->storage[0] = arena_reserve(buffer->max_capacity * sizeof(Model_Instance));
+            buffer->instances = (Model_Instance *)buffer->storage[0].base;
+        } break;
+        
+        case R3D_Layout_SoA: {
+            for (u32 stream = 0; stream < r3d_soa_stream_count; ++stream) {
+                buffer->storage[stream] = arena_reserve(buffer->max_capacity * sizeof(f32));
+            }
+            
+            for (u32 c = 0; c < 3; ++c) {
+                buffer->position[c] = (f32 *)buffer->storage[0 + c].base;
+            }
+            for (u32 c = 0; c < 4; ++c) {
+                buffer->orient[c] = (f32 *)buffer->storage[3 + c].base;
+            }
+            for (u32 c = 0; c < 3; ++c) {
+                buffer->scale[c] = (f32 *)buffer->storage[7 + c].base;
+            }
+            for (u32 c = 0; c < 4; ++c) {
+                buffer->colour[c] = (f32 *)buffer->storage[10 + c].base;
+            }
+        } break;
+    }
+    buffer->tag_storage = arena_reserve(buffer->max_capacity * sizeof(R3D_Tag));
+    buffer->tags = (R3D_Tag *)buffer->tag_storage.base;
+    
+    u64 initial_capacity = r3d_initial_capacity;
+    if (initial_capacity > buffer->max_capacity) {
+        initial_capacity = buffer->max_capacity;
+    }
+    
+    if (!r3d_reserve(buffer, initial_capacity)) {
+        os_fatal_error(str8("Failed to reserve instance memory"));
+    }
+}
+
+function void
+r3d_release(R3D_Buffer *buffer) {
+    for (u32 stream = 0; stream < r3d_soa_stream_count; ++stream) {
+        arena_release(buffer->storage + stream);
+    }
+    arena_release(&buffer->tag_storage);
+    
+    R3D_Buffer zero = { 0 };
+    *buffer = zero;
+}
+
+function b32
+r3d_reserve(R3D_Buffer *buffer, u64 capacity) {
+    b32 result = True;
+    if (capacity > buffer->capacity) {
+        // grow geometrically so a steady stream of r3d_add_instance costs O(log n) commits
+        u64 new_capacity = buffer->capacity * 2;
+        if (new_capacity < capacity) {
+            new_capacity = capacity;
+        }
+        new_capacity = (new_capacity + 3) & ~3ull;
+        if (new_capacity > buffer->max_capacity) {
+            new_capacity = buffer->max_capacity;
+        }
+        
+        if (new_capacity < capacity) {
+            result = False;
+        } else {
+            u64 grow = new_capacity - buffer->capacity;
+            u64 element_size = (buffer->layout == R3D_Layout_AoS) ? sizeof(Model_Instance) : sizeof(f32);
+            u32 stream_count = (buffer->layout == R3D_Layout_AoS) ? 1 : r3d_soa_stream_count;
+            for (u32 stream = 0; stream < stream_count && result; ++stream) {
+                result = arena_push(buffer->storage + stream, grow * element_size, 1) != null;
+            }
+            result = result && (arena_push(&buffer->tag_storage, grow * sizeof(R3D_Tag), 1) != null);
+            
+            if (result) {
+                buffer->capacity = new_capacity;
+            } else {
+                // a commit can fail partway through the streams, so put back the ones that grew:
+                // every stream has to keep covering exactly capacity instances
+                for (u32 stream = 0; stream < stream_count; ++stream) {
+                    arena_pop_to(buffer->storage + stream, buffer->capacity * element_size);
+                }
+                arena_pop_to(&buffer->tag_storage, buffer->capacity * sizeof(R3D_Tag));
+            }
+        }
+    }
+    return(result);
+}
+
+function void
+r3d_set_tag(R3D_Buffer *buffer, u64 index, R3D_Tag tag) {
+    buffer->tags[index] = tag;
+}
+
+function Model_Instance
+r3d_get_instance(R3D_Buffer *buffer, u64 index) {
+    Model_Instance result;
+    if (buffer->layout == R3D_Layout_AoS) {
+        result = buffer->instances[index];
+    } else {
+        result.position = v3f_make(buffer->position[0][index], buffer->position[1][index], buffer->position[2][index]);
+        result.orient = quat_make(buffer->orient[0][index], buffer->orient[1][index],
+                                  buffer->orient[2][index], buffer->orient[3][index]);
+        result.scale = v3f_make(buffer->scale[0][index], buffer->scale[1][index], buffer->scale[2][index]);
+        result.colour = v4f_make(buffer->colour[0][index], buffer->colour[1][index],
+                                 buffer->colour[2][index], buffer->colour[3][index]);
+    }
+    return(result);
+}
+
+function void
+r3d_set_instance(R3D_Buffer *buffer, u64 index, Model_Instance *instance) {
+    if (buffer->layout == R3D_Layout_AoS) {
+        buffer->instances[index] = *instance;
+    } else {
+        for (u32 c = 0; c < 3; ++c) {
+            buffer->position[c][index] = instance->position.v[c];
+        }
+        for (u32 c = 0; c < 4; ++c) {
+            buffer->orient[c][index] = instance->orient.v[c];
+        }
+        for (u32 c = 0; c < 3; ++c) {
+            buffer->scale[c][index] = instance->scale.v[c];
+        }
+        for (u32 c = 0; c < 4; ++c) {
+            buffer->colour[c][index] = instance->colour.v[c];
+        }
+    }
+}
+
+function u64
+r3d_add_instance(R3D_Buffer *buffer, v3f p, quat orient, v3f scale, v4f colour) {
+    if (buffer->count == buffer->capacity) {
+        if (!r3d_reserve(buffer, buffer->count + 1)) {
+            os_fatal_error(str8("R3D_Buffer ran out of reserved instances"));
+        }
+    }
+    
+    Model_Instance model;
+    model.position = p;
+    model.orient = orient;
+    model.scale = scale;
+    model.colour = colour;
+    
+    u64 result = buffer->count++;
+    r3d_set_instance(buffer, result, &model);
+    return(result);
+}
+
+// Gathers instances [index, index + 4) into SoA lanes. For AoS every f32x4_load reads 16 bytes
+// that stay inside the instance (position runs into orient, scale into colour); SoA is a plain load.
+function void
+r3d_load_instances_x4(R3D_Buffer *buffer, u64 index, v3f_x4 *position, quat_x4 *orient, v3f_x4 *scale) {
+    if (buffer->layout == R3D_Layout_SoA) {
+        *position = v3f_x4_make(f32x4_load(buffer->position[0] + index),
+                                f32x4_load(buffer->position[1] + index),
+                                f32x4_load(buffer->position[2] + index));
+        orient->s = f32x4_load(buffer->orient[0] + index);
+        orient->i = f32x4_load(buffer->orient[1] + index);
+        orient->j = f32x4_load(buffer->orient[2] + index);
+        orient->k = f32x4_load(buffer->orient[3] + index);
+        *scale = v3f_x4_make(f32x4_load(buffer->scale[0] + index),
+                             f32x4_load(buffer->scale[1] + index),
+                             f32x4_load(buffer->scale[2] + index));
+        return;
+    }
+    
+    Model_Instance *instances = buffer->instances + index;
+    f32x4 p0 = f32x4_load(instances[0].position.v);
+    f32x4 p1 = f32x4_load(instances[1].position.v);
+    f32x4 p2 = f32x4_load(instances[2].position.v);
+    f32x4 p3 = f32x4_load(instances[3].position.v);
+    f32x4_transpose(p0, p1, p2, p3);
+    *position = v3f_x4_make(p0, p1, p2);
+    
+    f32x4 q0 = f32x4_load(instances[0].orient.v);
+    f32x4 q1 = f32x4_load(instances[1].orient.v);
+    f32x4 q2 = f32x4_load(instances[2].orient.v);
+    f32x4 q3 = f32x4_load(instances[3].orient.v);
+    f32x4_transpose(q0, q1, q2, q3);
+    orient->s = q0;
+    orient->i = q1;
+    orient->j = q2;
+    orient->k = q3;
+    
+    f32x4 s0 = f32x4_load(instances[0].scale.v);
+    f32x4 s1 = f32x4_load(instances[1].scale.v);
+    f32x4 s2 = f32x4_load(instances[2].scale.v);
+    f32x4 s3 = f32x4_load(instances[3].scale.v);
+    f32x4_transpose(s0, s1, s2, s3);
+    *scale = v3f_x4_make(s0, s1, s2);
+}
+
+function void
+r3d_transform_point_per_instance(v3f *out, R3D_Buffer *buffer, u64 first, u64 count, v3f local_p) {
+    u64 index = 0;
+    
+    v3f_x4 local_x4 = v3f_x4_make(f32x4_set1(local_p.x), f32x4_set1(local_p.y), f32x4_set1(local_p.z));
+    for (; index + 4 <= count; index += 4) {
+        v3f_x4 position, scale;
+        quat_x4 orient;
+        r3d_load_instances_x4(buffer, first + index, &position, &orient, &scale);
+        
+        v3f_x4 p = quat_rot_v3f_x4(orient, local_x4);
+        p.x = f32x4_madd(p.x, scale.x, position.x);
+        p.y = f32x4_madd(p.y, scale.y, position.y);
+        p.z = f32x4_madd(p.z, scale.z, position.z);
+        v3f_x4_store_aos(out + index, p);
+    }
+    
+    for (; index < count; ++index) {
+        Model_Instance instance = r3d_get_instance(buffer, first + index);
+        v3f p = quat_rot_v3f(instance.orient, local_p);
+        out[index] = v3f_make(p.x * instance.scale.x + instance.position.x,
+                              p.y * instance.scale.y + instance.position.y,
+                              p.z * instance.scale.z + instance.position.z);
+    }
+}
+
+// Four-wide m44_from_quat_trs. Row r of the world matrix is the rotated basis axis e_r, scaled per
+// world axis like vs_main does, so it falls straight out of the rotation-matrix form of the quat.
+function void
+r3d_world_matrices(m44 *out, R3D_Buffer *buffer, u64 first, u64 count) {
+    u64 index = 0;
+    
+    f32x4 one = f32x4_set1(1.0f);
+    f32x4 two = f32x4_set1(2.0f);
+    f32x4 zero = f32x4_zero();
+    for (; index + 4 <= count; index += 4) {
+        v3f_x4 position, scale;
+        quat_x4 q;
+        r3d_load_instances_x4(buffer, first + index, &position, &q, &scale);
+        
+        f32x4 ii = f32x4_mul(q.i, q.i);
+        f32x4 jj = f32x4_mul(q.j, q.j);
+        f32x4 kk = f32x4_mul(q.k, q.k);
+        f32x4 ij = f32x4_mul(q.i, q.j);
+        f32x4 ik = f32x4_mul(q.i, q.k);
+        f32x4 jk = f32x4_mul(q.j, q.k);
+        f32x4 si = f32x4_mul(q.s, q.i);
+        f32x4 sj = f32x4_mul(q.s, q.j);
+        f32x4 sk = f32x4_mul(q.s, q.k);
+        
+        f32x4 rows[4][4];
+        rows[0][0] = f32x4_mul(f32x4_sub(one, f32x4_mul(two, f32x4_add(jj, kk))), scale.x);
+        rows[0][1] = f32x4_mul(f32x4_mul(two, f32x4_add(ij, sk)), scale.y);
+        rows[0][2] = f32x4_mul(f32x4_mul(two, f32x4_sub(ik, sj)), scale.z);
+        rows[0][3] = zero;
+        
+        rows[1][0] = f32x4_mul(f32x4_mul(two, f32x4_sub(ij, sk)), scale.x);
+        rows[1][1] = f32x4_mul(f32x4_sub(one, f32x4_mul(two, f32x4_add(ii, kk))), scale.y);
+        rows[1][2] = f32x4_mul(f32x4_mul(two, f32x4_add(jk, si)), scale.z);
+        rows[1][3] = zero;
+        
+        rows[2][0] = f32x4_mul(f32x4_mul(two, f32x4_add(ik, sj)), scale.x);
+        rows[2][1] = f32x4_mul(f32x4_mul(two, f32x4_sub(jk, si)), scale.y);
+        rows[2][2] = f32x4_mul(f32x4_sub(one, f32x4_mul(two, f32x4_add(ii, jj))), scale.z);
+        rows[2][3] = zero;
+        
+        rows[3][0] = position.x;
+        rows[3][1] = position.y;
+        rows[3][2] = position.z;
+        rows[3][3] = one;
+        
+        // each rows[r] holds row r of four matrices, one matrix per lane
+        for (u32 row = 0; row < 4; ++row) {
+            f32x4 m0 = rows[row][0];
+            f32x4 m1 = rows[row][1];
+            f32x4 m2 = rows[row][2];
+            f32x4 m3 = rows[row][3];
+            f32x4_transpose(m0, m1, m2, m3);
+            f32x4_store(out[index + 0].m[row], m0);
+            f32x4_store(out[index + 1].m[row], m1);
+            f32x4_store(out[index + 2].m[row], m2);
+            f32x4_store(out[index + 3].m[row], m3);
+        }
+    }
+    
+    for (; index < count; ++index) {
+        Model_Instance instance = r3d_get_instance(buffer, first + index);
+        out[index] = m44_from_quat_trs(instance.position, instance.orient, instance.scale);
+    }
+}
+
+#define r3d_quat_range 0.70710678f
+
+function u32
+r3d_pack_quat(quat q) {
+    u32 largest = 0;
+    for (u32 c = 1; c < 4; ++c) {
+        if (fabsf(q.v[c]) > fabsf(q.v[largest])) {
+            largest = c;
+        }
+    }
+    
+    // q and -q are the same rotation, so make the dropped component positive and rebuild it
+    // from the other three on unpack.
+    f32 sign = (q.v[largest] < 0.0f) ? -1.0f : 1.0f;
+    u32 result = largest << 30;
+    u32 shift = 20;
+    for (u32 c = 0; c < 4; ++c) {
+        if (c != largest) {
+            f32 unit = (q.v[c] * sign * (1.0f / r3d_quat_range)) * 0.5f + 0.5f;
+            unit = unit < 0.0f ? 0.0f : (unit > 1.0f ? 1.0f : unit);
+            result |= ((u32)(unit * 1023.0f + 0.5f)) << shift;
+            shift -= 10;
+        }
+    }
+    return(result);
+}
+
+function quat
+r3d_unpack_quat(u32 packed) {
+    u32 largest = packed >> 30;
+    
+    quat result;
+    f32 sum_sq = 0.0f;
+    u32 shift = 20;
+    for (u32 c = 0; c < 4; ++c) {
+        if (c != largest) {
+            f32 unit = (f32)((packed >> shift) & 1023) * (1.0f / 1023.0f);
+            result.v[c] = (unit * 2.0f - 1.0f) * r3d_quat_range;
+            sum_sq += result.v[c] * result.v[c];
+            shift -= 10;
+        }
+    }
+    result.v[largest] = sqrtf(sum_sq < 1.0f ? 1.0f - sum_sq : 0.0f);
+    return(result);
+}
+
+function u32
+r3d_pack_colour(v4f colour) {
+    u32 result = 0;
+    for (u32 c = 0; c < 4; ++c) {
+        f32 unit = colour.v[c] < 0.0f ? 0.0f : (colour.v[c] > 1.0f ? 1.0f : colour.v[c]);
+        result |= ((u32)(unit * 255.0f + 0.5f)) << (c * 8);
+    }
+    return(result);
+}
+
+function v4f
+r3d_unpack_colour(u32 packed) {
+    v4f result;
+    for (u32 c = 0; c < 4; ++c) {
+        result.v[c] = (f32)((packed >> (c * 8)) & 255) * (1.0f / 255.0f);
+    }
+    return(result);
+}
+
+function R3D_Packed_Instance
+r3d_pack_instance(Model_Instance *instance) {
+    R3D_Packed_Instance result;
+    result.position = instance->position;
+    result.orient = r3d_pack_quat(instance->orient);
+    result.scale = instance->scale;
+    result.colour = r3d_pack_colour(instance->colour);
+    return(result);
+}
+
+// dst is usually the mapped structured buffer, so it is only ever written front to back.
+function void
+r3d_pack_instances(R3D_Packed_Instance *dst, R3D_Buffer *buffer, u64 first, u64 count) {
+    for (u64 index = 0; index < count; ++index) {
+        Model_Instance instance = r3d_get_instance(buffer, first + index);
+        dst[index] = r3d_pack_instance(&instance);
+    }
+}
+
+function void
+r3d_pack_instances_indexed(R3D_Packed_Instance *dst, R3D_Buffer *buffer, u32 *indices, u64 count) {
+    for (u64 index = 0; index < count; ++index) {
+        Model_Instance instance = r3d_get_instance(buffer, indices[index]);
+        dst[index] = r3d_pack_instance(&instance);
+    }
+}
+
+typedef struct {
+    R3D_Packed_Instance *dst;
+    R3D_Buffer *buffer;
+    // null packs the contiguous run starting at first instead
+    u32 *indices;
+    u64 first;
+} R3D_Pack_Job;
+
+function void
+r3d_pack_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    R3D_Pack_Job *job = (R3D_Pack_Job *)data;
+    if (job->indices) {
+        r3d_pack_instances_indexed(job->dst + begin, job->buffer, job->indices + begin, end - begin);
+    } else {
+        r3d_pack_instances(job->dst + begin, job->buffer, job->first + begin, end - begin);
+    }
+}
+
+function void
+r3d_pack_instances_parallel(Job_System *jobs, R3D_Packed_Instance *dst, R3D_Buffer *buffer, u64 first, u64 count) {
+    R3D_Pack_Job job;
+    job.dst = dst;
+    job.buffer = buffer;
+    job.indices = null;
+    job.first = first;
+    
+    Job_Fence fence = {0};
+    job_parallel_for(jobs, &fence, count, r3d_pack_chunk_size, r3d_pack_job, &job);
+    job_wait(jobs, &fence);
+}
+
+function void
+r3d_pack_instances_indexed_parallel(Job_System *jobs, R3D_Packed_Instance *dst, R3D_Buffer *buffer, u32 *indices, u64 count) {
+    R3D_Pack_Job job;
+    job.dst = dst;
+    job.buffer = buffer;
+    job.indices = indices;
+    job.first = 0;
+    
+    Job_Fence fence = {0};
+    job_parallel_for(jobs, &fence, count, r3d_pack_chunk_size, r3d_pack_job, &job);
+    job_wait(jobs, &fence);
+}
+
+function Model_Instance
+r3d_unpack_instance(R3D_Packed_Instance *packed) {
+    Model_Instance result;
+    result.position = packed->position;
+    result.orient = r3d_unpack_quat(packed->orient);
+    result.scale = packed->scale;
+    result.colour = r3d_unpack_colour(packed->colour);
+    return(result);
+}
+
+function void
+r3d_dirty_clear(R3D_Dirty_Ranges *dirty) {
+    dirty->count = 0;
+}
+
+function void
+r3d_dirty_add(R3D_Dirty_Ranges *dirty, u64 first, u64 count) {
+    if (count == 0) {
+        return;
+    }
+    
+    R3D_Range range;
+    range.first = first;
+    range.one_past_last = first + count;
+    
+    // every range that overlaps or sits within the merge gap of the new one collapses into it
+    u32 insert = 0;
+    while ((insert < dirty->count) && (dirty->ranges[insert].one_past_last + r3d_dirty_merge_gap < range.first)) {
+        ++insert;
+    }
+    
+    u32 end = insert;
+    while ((end < dirty->count) && (dirty->ranges[end].first <= range.one_past_last + r3d_dirty_merge_gap)) {
+        if (dirty->ranges[end].first < range.first) {
+            range.first = dirty->ranges[end].first;
+        }
+        if (dirty->ranges[end].one_past_last > range.one_past_last) {
+            range.one_past_last = dirty->ranges[end].one_past_last;
+        }
+        ++end;
+    }
+    
+    u32 merged = end - insert;
+    if (merged == 0) {
+        if (dirty->count == r3d_dirty_range_max) {
+            // full, so fold the new range into its nearest neighbour instead
+            if (insert == dirty->count) {
+                dirty->ranges[insert - 1].one_past_last = range.one_past_last;
+            } else if (insert == 0) {
+                dirty->ranges[0].first = range.first;
+            } else if (range.first - dirty->ranges[insert - 1].one_past_last <
+                       dirty->ranges[insert].first - range.one_past_last) {
+                dirty->ranges[insert - 1].one_past_last = range.one_past_last;
+            } else {
+                dirty->ranges[insert].first = range.first;
+            }
+            return;
+        }
+        
+        for (u32 index = dirty->count; index > insert; --index) {
+            dirty->ranges[index] = dirty->ranges[index - 1];
+        }
+        ++dirty->count;
+    } else if (merged > 1) {
+        for (u32 index = end; index < dirty->count; ++index) {
+            dirty->ranges[index - merged + 1] = dirty->ranges[index];
+        }
+        dirty->count -= merged - 1;
+    }
+    dirty->ranges[insert] = range;
+}
+
+function u64
+r3d_dirty_slot_count(R3D_Dirty_Ranges *dirty) {
+    u64 result = 0;
+    for (u32 index = 0; index < dirty->count; ++index) {
+        result += dirty->ranges[index].one_past_last - dirty->ranges[index].first;
+    }
+    return(result);
+}
+
+function void
+r3d_scene_init(R3D_Scene *scene, u64 max_capacity, R3D_Layout layout) {
+    R3D_Scene zero = { 0 };
+    *scene = zero;
+    r3d_init(&scene->buffer, max_capacity, layout);
+    
+    // both grow a slot at a time, so they stay contiguous arrays
+    scene->generation_arena = arena_reserve(scene->buffer.max_capacity * sizeof(u32));
+    scene->generation = (u32 *)scene->generation_arena.base;
+    scene->free_arena = arena_reserve(scene->buffer.max_capacity * sizeof(u32));
+    scene->free_slots = (u32 *)scene->free_arena.base;
+}
+
+function void
+r3d_scene_release(R3D_Scene *scene) {
+    r3d_release(&scene->buffer);
+    arena_release(&scene->generation_arena);
+    arena_release(&scene->free_arena);
+    
+    R3D_Scene zero = { 0 };
+    *scene = zero;
+}
+
+function R3D_Handle
+r3d_scene_add(R3D_Scene *scene, v3f p, quat orient, v3f scale, v4f colour) {
+    R3D_Handle result;
+    if (scene->free_count) {
+        result.index = scene->free_slots[--scene->free_count];
+        arena_pop_to(&scene->free_arena, scene->free_count * sizeof(u32));
+        
+        Model_Instance model;
+        model.position = p;
+        model.orient = orient;
+        model.scale = scale;
+        model.colour = colour;
+        r3d_set_instance(&scene->buffer, result.index, &model);
+        R3D_Tag zero = { 0 };
+        r3d_set_tag(&scene->buffer, result.index, zero);
+    } else {
+        result.index = (u32)r3d_add_instance(&scene->buffer, p, orient, scale, colour);
+        if (!arena_push(&scene->generation_arena, sizeof(u32), 4)) {
+            os_fatal_error(str8("R3D_Scene ran out of reserved slots"));
+        }
+    }
+    
+    result.generation = ++scene->generation[result.index];
+    ++scene->alive_count;
+    r3d_dirty_add(&scene->dirty, result.index, 1);
+    return(result);
+}
+
+function b32
+r3d_scene_alive(R3D_Scene *scene, R3D_Handle handle) {
+    b32 result = (handle.index < scene->buffer.count) && (scene->generation[handle.index] == handle.generation);
+    return(result);
+}
+
+function void
+r3d_scene_remove(R3D_Scene *scene, R3D_Handle handle) {
+    if (r3d_scene_alive(scene, handle)) {
+        // The slot's GPU copy is left stale: it is never drawn once filtered out of the visible list.
+        ++scene->generation[handle.index];
+        arena_push(&scene->free_arena, sizeof(u32), 4);
+        scene->free_slots[scene->free_count++] = handle.index;
+        --scene->alive_count;
+    }
+}
+
+function Model_Instance
+r3d_scene_get(R3D_Scene *scene, R3D_Handle handle) {
+    s_assert(r3d_scene_alive(scene, handle), "stale R3D_Handle");
+    Model_Instance result = r3d_get_instance(&scene->buffer, handle.index);
+    return(result);
+}
+
+function void
+r3d_scene_set_tag(R3D_Scene *scene, R3D_Handle handle, R3D_Tag tag) {
+    if (r3d_scene_alive(scene, handle)) {
+        r3d_set_tag(&scene->buffer, handle.index, tag);
+    }
+}
+
+function void
+r3d_scene_set(R3D_Scene *scene, R3D_Handle handle, Model_Instance *instance) {
+    if (r3d_scene_alive(scene, handle)) {
+        Model_Instance current = r3d_get_instance(&scene->buffer, handle.index);
+        if (memory_compare(&current, instance, sizeof(Model_Instance)) != 0) {
+            r3d_set_instance(&scene->buffer, handle.index, instance);
+            r3d_dirty_add(&scene->dirty, handle.index, 1);
+        }
+    }
+}
+
+function u64
+r3d_scene_filter_alive(R3D_Scene *scene, u32 *indices, u64 count) {
+    u64 result = 0;
+    if (scene->free_count == 0) {
+        result = count;
+    } else {
+        for (u64 index = 0; index < count; ++index) {
+            if (scene->generation[indices[index]] & 1) {
+                indices[result++] = indices[index];
+            }
+        }
+    }
+    return(result);
+}
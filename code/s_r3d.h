@@ -0,0 +1,157 @@
+#if !defined(S_R3D_H)
+#define S_R3D_H
+
+typedef struct {
+	v3f position;
+	quat orient;
+	v3f scale;
+	v4f colour;
+} Model_Instance;
+
+// What actually goes into the structured buffer: 32 bytes instead of Model_Instance's 56.
+// orient is smallest-three: 2 bits for the index of the dropped (largest) component, then
+// three 10 bit fixed point components in [-1/sqrt(2), 1/sqrt(2)].
+// colour is RGBA8 unorm with r in the low byte.
+typedef struct {
+	v3f position;
+	u32 orient;
+	v3f scale;
+	u32 colour;
+} R3D_Packed_Instance;
+
+// What an instance is drawn with, the state half of its sort key in s_batch.h. Lives next to the
+// instance on the CPU only: draws carry it, the structured buffer doesn't.
+typedef struct {
+    u16 mesh;
+    u16 material;
+    u16 shader;
+    u16 __unused_a;
+} R3D_Tag;
+
+typedef u32 R3D_Layout;
+enum {
+	R3D_Layout_AoS,
+	// One f32 stream per component so four instances load straight into f32x4 lanes.
+	R3D_Layout_SoA,
+};
+
+#define r3d_soa_stream_count 14
+#define r3d_initial_capacity 1024
+
+// Every stream lives in its own arena that reserves max_capacity up front, so growing only commits
+// more pages: nothing is copied and pointers into the buffer stay valid.
+typedef struct {
+    R3D_Layout layout;
+    u64 capacity;
+    u64 max_capacity;
+    u64 count;
+    
+    // AoS only uses storage[0]
+    Arena storage[r3d_soa_stream_count];
+    // either layout, zero for new instances
+    Arena tag_storage;
+    R3D_Tag *tags;
+
+    // R3D_Layout_AoS
+    Model_Instance *instances;
+
+    // R3D_Layout_SoA, every stream is page aligned and padded to a multiple of four
+    f32 *position[3];
+    f32 *orient[4];
+    f32 *scale[3];
+    f32 *colour[4];
+} R3D_Buffer;
+
+function void r3d_init(R3D_Buffer *buffer, u64 max_capacity, R3D_Layout layout);
+function void r3d_release(R3D_Buffer *buffer);
+// Makes room for at least capacity instances. False once max_capacity is hit or memory runs out,
+// and then the buffer is left as it was.
+function b32 r3d_reserve(R3D_Buffer *buffer, u64 capacity);
+function u64 r3d_add_instance(R3D_Buffer *buffer, v3f p, quat orient, v3f scale, v4f colour);
+function Model_Instance r3d_get_instance(R3D_Buffer *buffer, u64 index);
+function void r3d_set_instance(R3D_Buffer *buffer, u64 index, Model_Instance *instance);
+function void r3d_set_tag(R3D_Buffer *buffer, u64 index, R3D_Tag tag);
+
+// Batches over [first, first + count). Both write count entries into a caller buffer.
+// out[i] = local_p placed by instance first + i, i.e. what vs_main does to a vertex.
+function void r3d_transform_point_per_instance(v3f *out, R3D_Buffer *buffer, u64 first, u64 count, v3f local_p);
+// Row-vector world matrices, so local * out[i] == vs_main's placement of local.
+function void r3d_world_matrices(m44 *out, R3D_Buffer *buffer, u64 first, u64 count);
+// Loads instances [index, index + 4) into lanes. Slots up to capacity (a multiple of four) are readable.
+function void r3d_load_instances_x4(R3D_Buffer *buffer, u64 index, v3f_x4 *position, quat_x4 *orient, v3f_x4 *scale);
+
+// Upload format
+function u32 r3d_pack_quat(quat q);
+function quat r3d_unpack_quat(u32 packed);
+function u32 r3d_pack_colour(v4f colour);
+function v4f r3d_unpack_colour(u32 packed);
+function R3D_Packed_Instance r3d_pack_instance(Model_Instance *instance);
+function void r3d_pack_instances(R3D_Packed_Instance *dst, R3D_Buffer *buffer, u64 first, u64 count);
+// Packs the instances named by indices, e.g. the survivors of r3d_cull, into dst[0, count).
+function void r3d_pack_instances_indexed(R3D_Packed_Instance *dst, R3D_Buffer *buffer, u32 *indices, u64 count);
+// The same two split across the job system. dst may be write-combined mapped memory: every job
+// writes its own contiguous run, in order.
+#define r3d_pack_chunk_size 8192
+function void r3d_pack_instances_parallel(Job_System *jobs, R3D_Packed_Instance *dst, R3D_Buffer *buffer, u64 first, u64 count);
+function void r3d_pack_instances_indexed_parallel(Job_System *jobs, R3D_Packed_Instance *dst, R3D_Buffer *buffer, u32 *indices, u64 count);
+function Model_Instance r3d_unpack_instance(R3D_Packed_Instance *packed);
+
+// Retained mode. Slots live as long as their instance; a handle's generation goes stale once the
+// slot is removed, so old handles can't touch whatever reuses it. Changes are recorded as dirty
+// slot ranges so only those need uploading.
+typedef struct {
+    u32 index;
+    u32 generation;
+} R3D_Handle;
+
+typedef struct {
+    u64 first;
+    u64 one_past_last;
+} R3D_Range;
+
+// Sorted, non-overlapping. Ranges closer than r3d_dirty_merge_gap are joined (one bigger upload
+// beats two tiny ones). Once there are r3d_dirty_range_max of them, a new range that joins none
+// is folded into whichever neighbour is nearer, stretching it over the gap between them.
+#define r3d_dirty_range_max 32
+#define r3d_dirty_merge_gap 16
+typedef struct {
+    R3D_Range ranges[r3d_dirty_range_max];
+    u32 count;
+} R3D_Dirty_Ranges;
+
+function void r3d_dirty_clear(R3D_Dirty_Ranges *dirty);
+function void r3d_dirty_add(R3D_Dirty_Ranges *dirty, u64 first, u64 count);
+// Slots covered, i.e. what an upload of every range costs in instances.
+function u64 r3d_dirty_slot_count(R3D_Dirty_Ranges *dirty);
+
+typedef struct {
+    // buffer.count is the slot high water mark, free slots included
+    R3D_Buffer buffer;
+    
+    // per slot, odd while alive
+    Arena generation_arena;
+    u32 *generation;
+    
+    // stack of free slots
+    Arena free_arena;
+    u32 *free_slots;
+    u64 free_count;
+    
+    u64 alive_count;
+    R3D_Dirty_Ranges dirty;
+} R3D_Scene;
+
+function void r3d_scene_init(R3D_Scene *scene, u64 max_capacity, R3D_Layout layout);
+function void r3d_scene_release(R3D_Scene *scene);
+function R3D_Handle r3d_scene_add(R3D_Scene *scene, v3f p, quat orient, v3f scale, v4f colour);
+function void r3d_scene_remove(R3D_Scene *scene, R3D_Handle handle);
+function b32 r3d_scene_alive(R3D_Scene *scene, R3D_Handle handle);
+function Model_Instance r3d_scene_get(R3D_Scene *scene, R3D_Handle handle);
+// Only marks the slot dirty when something actually changed, so re-setting static instances is free.
+function void r3d_scene_set(R3D_Scene *scene, R3D_Handle handle, Model_Instance *instance);
+// Tags aren't uploaded, so this never dirties the slot.
+function void r3d_scene_set_tag(R3D_Scene *scene, R3D_Handle handle, R3D_Tag tag);
+// Drops free slots from a list of slot indices (e.g. r3d_cull over scene->buffer) in place.
+function u64 r3d_scene_filter_alive(R3D_Scene *scene, u32 *indices, u64 count);
+
+#endif
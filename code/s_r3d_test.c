@@ -0,0 +1,473 @@
+// Instance buffers: the four-wide batch transforms against the per-instance math they replace.
+
+#define r3d_bench_count (1 << 20)
+
+function void
+r3d_test_fill(R3D_Buffer *buffer, Test_Random *random, u64 count) {
+    for (u64 index = 0; index < count; ++index) {
+        // one at a time, argument order isn't evaluation order
+        v3f p = test_random_v3f(random, -500.0f, 500.0f);
+        quat orient = test_random_quat(random);
+        v3f scale = test_random_v3f(random, 0.1f, 4.0f);
+        r3d_add_instance(buffer, p, orient, scale, v4f_make(1.0f, 1.0f, 1.0f, 1.0f));
+    }
+}
+
+// Both layouts, with a count that leaves a scalar tail and a first that isn't a multiple of four.
+function void
+test_r3d_batches(void) {
+    char *layout_names[] = { "AoS", "SoA" };
+    for (R3D_Layout layout = R3D_Layout_AoS; layout <= R3D_Layout_SoA; ++layout) {
+        Test_Random random = test_random_make(4);
+        R3D_Buffer buffer;
+        r3d_init(&buffer, 4096, layout);
+        r3d_test_fill(&buffer, &random, 1031);
+
+        u64 first = 3;
+        u64 count = buffer.count - first;
+        v3f local_p = v3f_make(0.5f, -0.25f, 1.0f);
+        v3f *points = (v3f *)malloc(count * sizeof(v3f));
+        m44 *matrices = (m44 *)malloc(count * sizeof(m44));
+        r3d_transform_point_per_instance(points, &buffer, first, count, local_p);
+        r3d_world_matrices(matrices, &buffer, first, count);
+
+        f32 worst_point = 0.0f;
+        f32 worst_matrix = 0.0f;
+        for (u64 index = 0; index < count; ++index) {
+            Model_Instance instance = r3d_get_instance(&buffer, first + index);
+            v3f rotated = quat_rot_v3f(instance.orient, local_p);
+            m44 expected = m44_from_quat_trs(instance.position, instance.orient, instance.scale);
+            v4f placed = m44_mul_v4f(matrices[index], v4f_make(local_p.x, local_p.y, local_p.z, 1.0f));
+            for (u32 axis = 0; axis < 3; ++axis) {
+                f32 p = rotated.v[axis] * instance.scale.v[axis] + instance.position.v[axis];
+                f32 difference = fabsf(points[index].v[axis] - p);
+                worst_point = difference > worst_point ? difference : worst_point;
+                difference = fabsf(placed.v[axis] - p);
+                worst_point = difference > worst_point ? difference : worst_point;
+            }
+            for (u32 row = 0; row < 4; ++row) {
+                for (u32 column = 0; column < 4; ++column) {
+                    f32 difference = fabsf(matrices[index].m[row][column] - expected.m[row][column]);
+                    worst_matrix = difference > worst_matrix ? difference : worst_matrix;
+                }
+            }
+        }
+        // positions reach 500, so a few of their ulps; matrix entries stay within the scale
+        test_check(worst_point <= 2e-4f, "%s r3d_transform_point_per_instance: off by %g", layout_names[layout], worst_point);
+        test_check(worst_matrix <= 4e-6f, "%s r3d_world_matrices: off by %g", layout_names[layout], worst_matrix);
+
+        free(points);
+        free(matrices);
+        r3d_release(&buffer);
+    }
+}
+
+// Angle of the rotation taking a to b, in degrees; q and -q count as the same rotation.
+function f64
+r3d_test_quat_angle(quat a, quat b) {
+    f64 dot = 0.0;
+    f64 a_sq = 0.0;
+    f64 b_sq = 0.0;
+    for (u32 c = 0; c < 4; ++c) {
+        dot += (f64)a.v[c] * (f64)b.v[c];
+        a_sq += (f64)a.v[c] * (f64)a.v[c];
+        b_sq += (f64)b.v[c] * (f64)b.v[c];
+    }
+    dot = fabs(dot) / sqrt(a_sq * b_sq);
+    dot = dot > 1.0 ? 1.0 : dot;
+    f64 result = 2.0 * acos(dot) * (180.0 / 3.14159265358979);
+    return(result);
+}
+
+// Smallest-three with 10 bits over [-1/sqrt(2), 1/sqrt(2)] rounds each stored component by at most
+// half a step, sqrt(2) / 2046 = 0.00069, so the three are off by at most sqrt(3) times that, 0.0012.
+// The rebuilt largest is at least 1/2 and the other three at most sqrt(3)/2 long, so it moves by no
+// more than sqrt(3) times theirs, 0.0021. That puts |q - q'| under 0.0024, and the angle between the
+// rotations, about 2 |q - q'| radians, under 0.28 degrees.
+#define r3d_quat_max_degrees 0.28
+
+function void
+test_r3d_pack_quat(void) {
+    Test_Random random = test_random_make(7);
+    f64 worst = 0.0;
+    b32 largest_positive = True;
+    u32 flipped = 0;
+    u32 quat_count = 1000000;
+    for (u32 index = 0; index < quat_count; ++index) {
+        quat q = test_random_quat(&random);
+        quat unpacked = r3d_unpack_quat(r3d_pack_quat(q));
+        f64 angle = r3d_test_quat_angle(q, unpacked);
+        worst = angle > worst ? angle : worst;
+
+        u32 largest = 0;
+        for (u32 c = 1; c < 4; ++c) {
+            largest = fabsf(q.v[c]) > fabsf(q.v[largest]) ? c : largest;
+        }
+        largest_positive = largest_positive && (unpacked.v[largest] >= 0.0f);
+        flipped += q.v[largest] < 0.0f;
+    }
+    test_check(worst <= r3d_quat_max_degrees, "r3d_pack_quat: %g degrees off, bound %g", worst, r3d_quat_max_degrees);
+    test_check(largest_positive, "r3d_unpack_quat: the rebuilt component came back negative");
+    // about half of uniform quats drop a negative component, so the flip really was exercised
+    test_check(flipped > quat_count / 3, "r3d_pack_quat: only %u of %u had a negative largest", flipped, quat_count);
+
+    // The flip by hand: -q comes back as q, both as the same rotation of a point and as the same
+    // packed bits, for every index the largest can sit at, and for the ties at 1/sqrt(2).
+    quat cases[] = {
+        quat_make(-0.9f, 0.1f, -0.3f, 0.2f),
+        quat_make(0.1f, -0.9f, 0.3f, -0.2f),
+        quat_make(0.3f, 0.1f, -0.9f, 0.2f),
+        quat_make(-0.2f, 0.3f, 0.1f, -0.9f),
+        quat_make(-1.0f, 0.0f, 0.0f, 0.0f),
+        quat_make(0.0f, 0.0f, 0.0f, -1.0f),
+        quat_make(-0.70710678f, 0.70710678f, 0.0f, 0.0f),
+        quat_make(0.0f, 0.0f, -0.70710678f, -0.70710678f),
+    };
+    v3f p = v3f_make(0.3f, -1.2f, 2.5f);
+    for (u32 index = 0; index < array_count(cases); ++index) {
+        quat q = cases[index];
+        quat_norm(&q);
+        quat negated = quat_make(-q.s, -q.i, -q.j, -q.k);
+        u32 packed = r3d_pack_quat(q);
+        test_check(packed == r3d_pack_quat(negated), "r3d_pack_quat: case %u packs q and -q differently", index);
+
+        quat unpacked = r3d_unpack_quat(packed);
+        f64 angle = r3d_test_quat_angle(q, unpacked);
+        test_check(angle <= r3d_quat_max_degrees, "r3d_pack_quat: case %u %g degrees off", index, angle);
+        v3f expected = quat_rot_v3f(q, p);
+        v3f rotated = quat_rot_v3f(unpacked, p);
+        for (u32 axis = 0; axis < 3; ++axis) {
+            test_check(fabsf(rotated.v[axis] - expected.v[axis]) <= 0.01f,
+                       "r3d_unpack_quat: case %u rotates axis %u to %g, not %g", index, axis,
+                       rotated.v[axis], expected.v[axis]);
+        }
+    }
+    printf("  pack_quat worst %.4f degrees, bound %.2f\n", worst, r3d_quat_max_degrees);
+}
+
+// A million instances grown from r3d_initial_capacity one add at a time, in both layouts; then
+// reserves past max_capacity and a commit failing partway through the streams, which have to leave
+// the buffer as it was.
+function void
+test_r3d_stress(void) {
+    char *layout_names[] = { "AoS", "SoA" };
+    u64 instance_count = 1000000;
+    for (R3D_Layout layout = R3D_Layout_AoS; layout <= R3D_Layout_SoA; ++layout) {
+        Test_Random random = test_random_make(8);
+        R3D_Buffer buffer;
+        r3d_init(&buffer, instance_count, layout);
+        r3d_test_fill(&buffer, &random, instance_count);
+        test_check(buffer.count == instance_count, "%s stress: count %llu", layout_names[layout],
+                   (unsigned long long)buffer.count);
+        test_check(buffer.capacity >= instance_count && buffer.capacity <= buffer.max_capacity &&
+                   (buffer.capacity % 4) == 0, "%s stress: capacity %llu", layout_names[layout],
+                   (unsigned long long)buffer.capacity);
+
+        // the same stream again, read back through the buffer
+        random = test_random_make(8);
+        b32 same = True;
+        for (u64 index = 0; index < instance_count; ++index) {
+            v3f p = test_random_v3f(&random, -500.0f, 500.0f);
+            quat orient = test_random_quat(&random);
+            v3f scale = test_random_v3f(&random, 0.1f, 4.0f);
+            Model_Instance instance = r3d_get_instance(&buffer, index);
+            same = same && (memory_compare(&instance.position, &p, sizeof(p)) == 0) &&
+                (memory_compare(&instance.orient, &orient, sizeof(orient)) == 0) &&
+                (memory_compare(&instance.scale, &scale, sizeof(scale)) == 0) &&
+                (buffer.tags[index].mesh == 0);
+        }
+        test_check(same, "%s stress: an instance didn't read back", layout_names[layout]);
+
+        test_check(r3d_reserve(&buffer, buffer.max_capacity), "%s stress: can't reserve max_capacity", layout_names[layout]);
+        test_check(!r3d_reserve(&buffer, buffer.max_capacity + 1), "%s stress: reserved past max_capacity", layout_names[layout]);
+
+        // Fake the stream in the middle running out of address space by shrinking its reservation
+        // to what it has, so the streams before it grow and have to be put back.
+        R3D_Buffer small;
+        r3d_init(&small, 1 << 16, layout);
+        u32 failing = (layout == R3D_Layout_AoS) ? 0 : r3d_soa_stream_count / 2;
+        u64 capacity = small.capacity;
+        u64 reserved = small.storage[failing].reserved;
+        small.storage[failing].reserved = small.storage[failing].pos;
+        test_check(!r3d_reserve(&small, capacity + 1), "%s stress: reserve didn't fail", layout_names[layout]);
+        small.storage[failing].reserved = reserved;
+
+        u64 element_size = (layout == R3D_Layout_AoS) ? sizeof(Model_Instance) : sizeof(f32);
+        u32 stream_count = (layout == R3D_Layout_AoS) ? 1 : r3d_soa_stream_count;
+        b32 rolled_back = small.capacity == capacity;
+        for (u32 stream = 0; stream < stream_count; ++stream) {
+            rolled_back = rolled_back && (small.storage[stream].pos == capacity * element_size);
+        }
+        rolled_back = rolled_back && (small.tag_storage.pos == capacity * sizeof(R3D_Tag));
+        test_check(rolled_back, "%s stress: a failed reserve left the streams uneven", layout_names[layout]);
+        test_check(r3d_reserve(&small, capacity + 1) && small.capacity > capacity,
+                   "%s stress: can't grow after a failed reserve", layout_names[layout]);
+
+        r3d_release(&small);
+        r3d_release(&buffer);
+    }
+}
+
+// What has to hold of dirty after every add: ranges sorted, non-empty, more than the merge gap
+// apart, starting and ending on slots that really are dirty, covering every slot in reference, and
+// r3d_dirty_slot_count adding them up. Returns the slots covered.
+function u64
+r3d_test_dirty_check(R3D_Dirty_Ranges *dirty, u8 *reference, u64 slot_count, char *what) {
+    b32 shaped = dirty->count <= r3d_dirty_range_max;
+    u64 covered = 0;
+    for (u32 index = 0; index < dirty->count && shaped; ++index) {
+        R3D_Range range = dirty->ranges[index];
+        shaped = (range.first < range.one_past_last) && (range.one_past_last <= slot_count) &&
+            reference[range.first] && reference[range.one_past_last - 1];
+        if (index > 0) {
+            shaped = shaped && (dirty->ranges[index - 1].one_past_last + r3d_dirty_merge_gap < range.first);
+        }
+        covered += range.one_past_last - range.first;
+    }
+    test_check(shaped, "%s: dirty ranges out of shape", what);
+
+    b32 all_covered = True;
+    u32 range_index = 0;
+    for (u64 slot = 0; slot < slot_count && shaped; ++slot) {
+        while ((range_index < dirty->count) && (dirty->ranges[range_index].one_past_last <= slot)) {
+            ++range_index;
+        }
+        if (reference[slot]) {
+            all_covered = all_covered && (range_index < dirty->count) && (dirty->ranges[range_index].first <= slot);
+        }
+    }
+    test_check(all_covered, "%s: a dirty slot isn't covered", what);
+    test_check(r3d_dirty_slot_count(dirty) == covered, "%s: r3d_dirty_slot_count %llu, ranges cover %llu", what,
+               (unsigned long long)r3d_dirty_slot_count(dirty), (unsigned long long)covered);
+    return(covered);
+}
+
+// r3d_dirty_add with random runs against a bitmap of every slot added, through the three ways an
+// add lands: a new range, a merge of one or more, and a fold into a neighbour once the list is full.
+function void
+test_r3d_dirty_fuzz(void) {
+    Test_Random random = test_random_make(11);
+    u64 slot_count = 1 << 14;
+    u8 *reference = (u8 *)malloc(slot_count);
+    u64 inserted = 0;
+    u64 multi_merged = 0;
+    u64 folded = 0;
+    u64 check_failures = test_state.failures;
+    for (u32 round = 0; round < 400 && test_state.failures == check_failures; ++round) {
+        R3D_Dirty_Ranges dirty;
+        r3d_dirty_clear(&dirty);
+        memset(reference, 0, slot_count);
+
+        // sparse rounds fill the list and fold, dense ones merge
+        u32 add_count = 1 + test_random_u32(&random) % 200;
+        u64 max_run = (round & 1) ? 64 : 4;
+        for (u32 add = 0; add < add_count; ++add) {
+            u64 count = test_random_u32(&random) % (max_run + 1);
+            u64 first = test_random_u32(&random) % (slot_count - count);
+            u32 before = dirty.count;
+            u64 slots_before = r3d_dirty_slot_count(&dirty);
+
+            r3d_dirty_add(&dirty, first, count);
+            memset(reference + first, 1, count);
+            u64 covered = r3d_test_dirty_check(&dirty, reference, slot_count, "r3d_dirty_add");
+            if (test_state.failures != check_failures) {
+                break;
+            }
+
+            if (count == 0) {
+                test_check(dirty.count == before && covered == slots_before, "r3d_dirty_add: an empty add changed the list");
+            } else if (dirty.count > before) {
+                ++inserted;
+            } else if (dirty.count < before) {
+                ++multi_merged;
+            } else if ((before == r3d_dirty_range_max) && (covered > slots_before)) {
+                // either the fold or a merge with one range; a fold leaves a gap of clean slots
+                // longer than the merge gap inside a range, which only the fold can make
+                for (u32 index = 0; index < dirty.count; ++index) {
+                    u64 clean_run = 0;
+                    for (u64 slot = dirty.ranges[index].first; slot < dirty.ranges[index].one_past_last; ++slot) {
+                        clean_run = reference[slot] ? 0 : clean_run + 1;
+                        if (clean_run > r3d_dirty_merge_gap) {
+                            ++folded;
+                            index = dirty.count;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    test_check(inserted && multi_merged && folded, "r3d_dirty_add fuzz: paths not all hit");
+    printf("  dirty fuzz: %llu inserts, %llu multi-merges, %llu folds\n", (unsigned long long)inserted,
+           (unsigned long long)multi_merged, (unsigned long long)folded);
+    free(reference);
+}
+
+// Random adds, removes, sets and stale-handle calls on a scene against a reference of which slots
+// are alive and which are dirty since the last upload.
+function void
+test_r3d_scene_fuzz(void) {
+    Test_Random random = test_random_make(12);
+    u64 max_slots = 4096;
+    R3D_Scene scene;
+    r3d_scene_init(&scene, max_slots, R3D_Layout_SoA);
+    R3D_Handle *handles = (R3D_Handle *)malloc(max_slots * sizeof(R3D_Handle));
+    R3D_Handle *stale = (R3D_Handle *)malloc(max_slots * sizeof(R3D_Handle));
+    u8 *alive = (u8 *)calloc(max_slots, 1);
+    u8 *dirty = (u8 *)calloc(max_slots, 1);
+    u32 *indices = (u32 *)malloc(max_slots * sizeof(u32));
+    u64 handle_count = 0;
+    u64 stale_count = 0;
+    u64 reused = 0;
+    u64 stale_rejected = 0;
+    u64 check_failures = test_state.failures;
+
+    for (u32 step = 0; step < 200000 && test_state.failures == check_failures; ++step) {
+        u32 action = test_random_u32(&random) % 16;
+        if ((action < 6) && (scene.buffer.count < max_slots || scene.free_count)) {
+            u64 high_water = scene.buffer.count;
+            b32 had_free = scene.free_count > 0;
+            R3D_Handle handle = r3d_scene_add(&scene, test_random_v3f(&random, -1.0f, 1.0f), quat_identity(),
+                                              v3f_make(1.0f, 1.0f, 1.0f), v4f_make(1.0f, 1.0f, 1.0f, 1.0f));
+            test_check(!alive[handle.index], "r3d_scene_add: slot %u handed out twice", handle.index);
+            test_check(had_free ? (handle.index < high_water && scene.buffer.count == high_water) : (handle.index == high_water),
+                       "r3d_scene_add: slot %u doesn't come off the free list", handle.index);
+            reused += had_free;
+            alive[handle.index] = True;
+            dirty[handle.index] = True;
+            handles[handle_count++] = handle;
+        } else if ((action < 10) && handle_count) {
+            u64 pick = test_random_u32(&random) % handle_count;
+            R3D_Handle handle = handles[pick];
+            r3d_scene_remove(&scene, handle);
+            alive[handle.index] = False;
+            handles[pick] = handles[--handle_count];
+            if (stale_count < max_slots) {
+                stale[stale_count++] = handle;
+            }
+        } else if ((action < 13) && handle_count) {
+            // a set that changes the instance dirties it, one that doesn't mustn't
+            R3D_Handle handle = handles[test_random_u32(&random) % handle_count];
+            Model_Instance instance = r3d_scene_get(&scene, handle);
+            b32 change = test_random_u32(&random) & 1;
+            if (change) {
+                instance.position.x += 1.0f;
+            }
+            R3D_Dirty_Ranges before = scene.dirty;
+            r3d_scene_set(&scene, handle, &instance);
+            if (change) {
+                dirty[handle.index] = True;
+            } else {
+                test_check(memory_compare(&before, &scene.dirty, sizeof(before)) == 0,
+                           "r3d_scene_set: an unchanged set dirtied slot %u", handle.index);
+            }
+        } else if ((action < 15) && stale_count) {
+            // a removed handle does nothing, even once its slot is alive again
+            R3D_Handle handle = stale[test_random_u32(&random) % stale_count];
+            test_check(!r3d_scene_alive(&scene, handle), "r3d_scene_alive: a removed handle is alive");
+            R3D_Dirty_Ranges before = scene.dirty;
+            u64 alive_before = scene.alive_count;
+            Model_Instance instance = { 0 };
+            r3d_scene_set(&scene, handle, &instance);
+            r3d_scene_remove(&scene, handle);
+            test_check((memory_compare(&before, &scene.dirty, sizeof(before)) == 0) && (alive_before == scene.alive_count) &&
+                       (alive[handle.index] == ((scene.generation[handle.index] & 1) != 0)),
+                       "stale handle to slot %u changed the scene", handle.index);
+            ++stale_rejected;
+        } else {
+            // an upload
+            r3d_dirty_clear(&scene.dirty);
+            memset(dirty, 0, max_slots);
+        }
+
+        if ((step % 97) == 0) {
+            r3d_test_dirty_check(&scene.dirty, dirty, scene.buffer.count, "scene");
+            u64 alive_count = 0;
+            for (u64 slot = 0; slot < scene.buffer.count; ++slot) {
+                indices[slot] = (u32)slot;
+                alive_count += alive[slot];
+            }
+            test_check(scene.alive_count == alive_count && scene.alive_count + scene.free_count == scene.buffer.count,
+                       "scene: %llu alive, %llu free, %llu slots", (unsigned long long)scene.alive_count,
+                       (unsigned long long)scene.free_count, (unsigned long long)scene.buffer.count);
+            u64 filtered = r3d_scene_filter_alive(&scene, indices, scene.buffer.count);
+            b32 same = filtered == alive_count;
+            for (u64 index = 0; index < filtered && same; ++index) {
+                same = alive[indices[index]];
+            }
+            test_check(same, "r3d_scene_filter_alive: kept %llu of %llu alive", (unsigned long long)filtered,
+                       (unsigned long long)alive_count);
+        }
+    }
+    test_check(reused && stale_rejected, "scene fuzz: free list or stale handles not hit");
+    printf("  scene fuzz: %llu slots reused, %llu stale handle calls\n", (unsigned long long)reused,
+           (unsigned long long)stale_rejected);
+
+    free(handles);
+    free(stale);
+    free(alive);
+    free(dirty);
+    free(indices);
+    r3d_scene_release(&scene);
+}
+
+function void
+test_r3d(void) {
+    test_r3d_batches();
+    test_r3d_pack_quat();
+    test_r3d_stress();
+    test_r3d_dirty_fuzz();
+    test_r3d_scene_fuzz();
+}
+
+global volatile f32 r3d_bench_sink;
+
+function void
+bench_r3d(void) {
+    char *layout_names[] = { "AoS", "SoA" };
+    v3f local_p = v3f_make(0.5f, -0.25f, 1.0f);
+    v3f *points = (v3f *)malloc(r3d_bench_count * sizeof(v3f));
+    m44 *matrices = (m44 *)malloc(r3d_bench_count * sizeof(m44));
+    for (R3D_Layout layout = R3D_Layout_AoS; layout <= R3D_Layout_SoA; ++layout) {
+        Test_Random random = test_random_make(5);
+        R3D_Buffer buffer;
+        r3d_init(&buffer, r3d_bench_count, layout);
+        r3d_test_fill(&buffer, &random, r3d_bench_count);
+        char name[64];
+
+        for (u32 round = 0; round < 3; ++round) {
+            u64 begin = os_time_ticks();
+            r3d_transform_point_per_instance(points, &buffer, 0, buffer.count, local_p);
+            snprintf(name, sizeof(name), "%s r3d_transform_point_per_instance", layout_names[layout]);
+            bench_report(name, buffer.count, os_time_ticks() - begin);
+
+            begin = os_time_ticks();
+            for (u64 index = 0; index < buffer.count; ++index) {
+                Model_Instance instance = r3d_get_instance(&buffer, index);
+                v3f p = quat_rot_v3f(instance.orient, local_p);
+                points[index] = v3f_make(p.x * instance.scale.x + instance.position.x,
+                                         p.y * instance.scale.y + instance.position.y,
+                                         p.z * instance.scale.z + instance.position.z);
+            }
+            snprintf(name, sizeof(name), "%s per-instance quat_rot_v3f", layout_names[layout]);
+            bench_report(name, buffer.count, os_time_ticks() - begin);
+
+            begin = os_time_ticks();
+            r3d_world_matrices(matrices, &buffer, 0, buffer.count);
+            snprintf(name, sizeof(name), "%s r3d_world_matrices", layout_names[layout]);
+            bench_report(name, buffer.count, os_time_ticks() - begin);
+
+            begin = os_time_ticks();
+            for (u64 index = 0; index < buffer.count; ++index) {
+                Model_Instance instance = r3d_get_instance(&buffer, index);
+                matrices[index] = m44_from_quat_trs(instance.position, instance.orient, instance.scale);
+            }
+            snprintf(name, sizeof(name), "%s per-instance m44_from_quat_trs", layout_names[layout]);
+            bench_report(name, buffer.count, os_time_ticks() - begin);
+        }
+        r3d_bench_sink += points[buffer.count / 2].x + matrices[buffer.count / 3].m[1][1];
+        r3d_release(&buffer);
+    }
+    free(points);
+    free(matrices);
+}
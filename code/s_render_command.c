@@ -0,0 +1,312 @@
+function void
+render_queue_init(Render_Queue *queue, u32 stream_count) {
+    Render_Queue zero = { 0 };
+    *queue = zero;
+    queue->arena = arena_reserve(kilobytes(64));
+    queue->stream_count = stream_count;
+    queue->streams = arena_push_array(&queue->arena, Render_Stream, stream_count);
+    for (u32 stream = 0; stream < stream_count; ++stream) {
+        // address space only, a stream commits what it records
+        queue->streams[stream].arena = arena_reserve(gigabytes(1));
+        queue->streams[stream].commands = (Render_Command *)queue->streams[stream].arena.base;
+    }
+}
+
+function void
+render_queue_release(Render_Queue *queue) {
+    for (u32 stream = 0; stream < queue->stream_count; ++stream) {
+        arena_release(&queue->streams[stream].arena);
+    }
+    arena_release(&queue->arena);
+}
+
+function void
+render_queue_reset(Render_Queue *queue) {
+    for (u32 stream = 0; stream < queue->stream_count; ++stream) {
+        arena_clear(&queue->streams[stream].arena);
+        queue->streams[stream].count = 0;
+    }
+}
+
+function void
+render_stream_push(Render_Stream *stream, Render_Command *command) {
+    Render_Command *slot = (Render_Command *)arena_push(&stream->arena, sizeof(Render_Command), 8);
+    if (!slot) {
+        os_fatal_error(str8("Out of render command memory"));
+    }
+    *slot = *command;
+    ++stream->count;
+}
+
+typedef struct {
+    Render_Queue *queue;
+    Game_State *game;
+    Batch *batches;
+} Render_Record_Job;
+
+function void
+render_record_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    Render_Record_Job *job = (Render_Record_Job *)data;
+    Render_Stream *stream = job->queue->streams + worker_index;
+    Mesh *geometry = &job->game->geometry;
+    for (u64 index = begin; index < end; ++index) {
+        Batch *batch = job->batches + index;
+        Mesh level = game_mesh_level(job->game, batch->mesh, batch->level);
+        Render_Command command;
+        command.key = batch->key;
+        command.shader = batch->shader;
+        command.index_count = level.index_count;
+        command.first_index = (u32)(level.indices - geometry->indices);
+        command.base_vertex = (s32)(level.vertices - geometry->vertices);
+        command.instance_base = (u32)batch->first;
+        command.instance_count = (u32)batch->count;
+        render_stream_push(stream, &command);
+    }
+}
+
+function void
+render_record_batches_parallel(Job_System *jobs, Render_Queue *queue, Game_State *game,
+                               Batch *batches, u32 batch_count) {
+    Render_Record_Job job;
+    job.queue = queue;
+    job.game = game;
+    job.batches = batches;
+    Job_Fence fence = {0};
+    job_parallel_for(jobs, &fence, batch_count, render_record_batch_size, render_record_job, &job);
+    job_wait(jobs, &fence);
+}
+
+function Render_Command *
+render_queue_sort(Render_Queue *queue, Job_System *jobs, Arena *arena, u64 *count) {
+    u64 total = 0;
+    for (u32 stream = 0; stream < queue->stream_count; ++stream) {
+        total += queue->streams[stream].count;
+    }
+    *count = total;
+
+    Render_Command *result = arena_push_array(arena, Render_Command, total);
+    u64 cursor = 0;
+    for (u32 stream = 0; stream < queue->stream_count; ++stream) {
+        Render_Stream *source = queue->streams + stream;
+        memory_copy(result + cursor, source->commands, source->count * sizeof(Render_Command));
+        cursor += source->count;
+    }
+    // streams recorded from sorted batches usually come back in order already
+    b32 sorted = True;
+    for (u64 index = 1; (index < total) && sorted; ++index) {
+        sorted = result[index - 1].key <= result[index].key;
+    }
+    if (sorted) {
+        return(result);
+    }
+
+    u64 scratch_pos = arena->pos;
+    Render_Command *gathered = arena_push_array(arena, Render_Command, total);
+    u64 *keys = arena_push_array(arena, u64, total);
+    u32 *order = arena_push_array(arena, u32, total);
+    memory_copy(gathered, result, total * sizeof(Render_Command));
+    for (u64 index = 0; index < total; ++index) {
+        keys[index] = gathered[index].key;
+        order[index] = (u32)index;
+    }
+
+    batch_sort_parallel(jobs, arena, keys, order, total);
+    for (u64 index = 0; index < total; ++index) {
+        result[index] = gathered[order[index]];
+    }
+    arena_pop_to(arena, scratch_pos);
+    return(result);
+}
+
+function void
+render_replay(Render_Backend *backend, Render_Command *commands, u64 count) {
+    backend->begin(backend->data);
+    // nothing is known about the state begin leaves
+    Render_Command *previous = null;
+    for (u64 index = 0; index < count; ++index) {
+        Render_Command *command = commands + index;
+        if (!previous || (command->shader != previous->shader)) {
+            backend->set_shader(backend->data, command->shader);
+        }
+        if (!previous || (command->instance_base != previous->instance_base)) {
+            backend->set_instance_base(backend->data, command->instance_base);
+        }
+        backend->draw(backend->data, command->index_count, command->instance_count, command->first_index,
+                      command->base_vertex);
+        previous = command;
+    }
+    backend->end(backend->data);
+}
+
+typedef struct {
+    Render_Backend *backends;
+    u32 backend_count;
+    Render_Command *commands;
+    u64 count;
+} Render_Replay_Job;
+
+function void
+render_replay_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Render_Replay_Job *job = (Render_Replay_Job *)data;
+    for (u64 slice = begin; slice < end; ++slice) {
+        u64 first = (job->count * slice) / job->backend_count;
+        u64 one_past_last = (job->count * (slice + 1)) / job->backend_count;
+        render_replay(job->backends + slice, job->commands + first, one_past_last - first);
+    }
+}
+
+function void
+render_replay_parallel(Job_System *jobs, Render_Backend *backends, u32 backend_count,
+                       Render_Command *commands, u64 count) {
+    Render_Replay_Job job;
+    job.backends = backends;
+    job.backend_count = backend_count;
+    job.commands = commands;
+    job.count = count;
+    Job_Fence fence = {0};
+    job_parallel_for(jobs, &fence, backend_count, 1, render_replay_job, &job);
+    job_wait(jobs, &fence);
+}
+
+// What d3d11_render_begin binds, one object each except the light buffers at PS t3 to t5.
+global u32 render_null_pass_slots[] = {
+    StateSlot_RenderTargets, StateSlot_DepthStencil, StateSlot_Blend, StateSlot_Viewport, StateSlot_Rasterizer,
+    StateSlot_Topology, StateSlot_VertexBuffer, StateSlot_IndexBuffer, StateSlot_InputLayout,
+    StateSlot_VertexShader, StateSlot_VSResource + 0, StateSlot_VSResource + 2,
+    StateSlot_VSConstantBuffer + 0, StateSlot_VSConstantBuffer + 3,
+    StateSlot_PSConstantBuffer + 0, StateSlot_PSConstantBuffer + 1,
+};
+#define render_null_light_slot (StateSlot_PSResource + 3)
+#define render_null_light_count 3
+
+// The made-up object a slot is bound to, never 0 so it can't pass for nothing bound.
+function u64
+render_null_handle(u32 slot) {
+    u64 result = 0x1000 + slot;
+    return(result);
+}
+
+function void
+render_null_bind(Render_Null_Backend *backend, u32 slot, u64 handle) {
+    if (state_cache_bind(&backend->cache, slot, &handle, sizeof(handle))) {
+        backend->bound[slot] = handle;
+    }
+}
+
+function void
+render_null_begin(void *data) {
+    Render_Null_Backend *backend = (Render_Null_Backend *)data;
+    ++backend->slices;
+    backend->has_shader = False;
+    backend->has_instance_base = False;
+
+    for (u32 index = 0; index < array_count(render_null_pass_slots); ++index) {
+        u32 slot = render_null_pass_slots[index];
+        render_null_bind(backend, slot, render_null_handle(slot));
+    }
+    void *lights[render_null_light_count];
+    for (u32 light = 0; light < render_null_light_count; ++light) {
+        lights[light] = (void *)render_null_handle(render_null_light_slot + light);
+    }
+    if (state_cache_bind_objects(&backend->cache, render_null_light_slot, render_null_light_count, lights)) {
+        for (u32 light = 0; light < render_null_light_count; ++light) {
+            backend->bound[render_null_light_slot + light] = (u64)lights[light];
+        }
+    }
+}
+
+function void
+render_null_set_shader(void *data, u32 shader) {
+    Render_Null_Backend *backend = (Render_Null_Backend *)data;
+    ++backend->shader_changes;
+    backend->has_shader = shader < backend->shader_count;
+    backend->shader = shader;
+    if (!backend->has_shader) {
+        ++backend->errors;
+    }
+    render_null_bind(backend, StateSlot_PixelShader, render_null_handle(StateSlot_Count + shader));
+}
+
+function void
+render_null_set_instance_base(void *data, u32 instance_base) {
+    Render_Null_Backend *backend = (Render_Null_Backend *)data;
+    ++backend->instance_base_changes;
+    backend->has_instance_base = True;
+    backend->instance_base = instance_base;
+}
+
+function void
+render_null_draw(void *data, u32 index_count, u32 instance_count, u32 first_index, s32 base_vertex) {
+    Render_Null_Backend *backend = (Render_Null_Backend *)data;
+    ++backend->draws;
+    backend->instances += instance_count;
+    backend->triangles += (u64)(index_count / 3) * instance_count;
+
+    b32 valid = backend->has_shader && backend->has_instance_base;
+    valid = valid && index_count && ((index_count % 3) == 0) && instance_count;
+    valid = valid && ((u64)first_index + index_count <= backend->index_count);
+    valid = valid && (base_vertex >= 0) && ((u32)base_vertex < backend->vertex_count);
+    valid = valid && ((u64)backend->instance_base + instance_count <= backend->instance_count);
+
+    valid = valid && (backend->bound[StateSlot_PixelShader] == render_null_handle(StateSlot_Count + backend->shader));
+    for (u32 index = 0; index < array_count(render_null_pass_slots); ++index) {
+        u32 slot = render_null_pass_slots[index];
+        valid = valid && (backend->bound[slot] == render_null_handle(slot));
+    }
+    for (u32 light = 0; light < render_null_light_count; ++light) {
+        u32 slot = render_null_light_slot + light;
+        valid = valid && (backend->bound[slot] == render_null_handle(slot));
+    }
+    if (!valid) {
+        ++backend->errors;
+    }
+}
+
+function void
+render_null_end(void *data) {
+    unused(data);
+}
+
+function void
+render_null_backend_init(Render_Null_Backend *null_backend, u32 shader_count, u32 index_count,
+                         u32 vertex_count, u32 instance_count) {
+    memset(null_backend, 0, sizeof(Render_Null_Backend));
+    null_backend->shader_count = shader_count;
+    null_backend->index_count = index_count;
+    null_backend->vertex_count = vertex_count;
+    null_backend->instance_count = instance_count;
+    state_cache_init(&null_backend->cache);
+}
+
+function Render_Backend
+render_null_backend(Render_Null_Backend *null_backend) {
+    Render_Backend result;
+    result.data = null_backend;
+    result.begin = render_null_begin;
+    result.set_shader = render_null_set_shader;
+    result.set_instance_base = render_null_set_instance_base;
+    result.draw = render_null_draw;
+    result.end = render_null_end;
+    return(result);
+}
+
+function void
+render_null_backend_add(Render_Null_Backend *to, Render_Null_Backend *from) {
+    to->slices += from->slices;
+    to->shader_changes += from->shader_changes;
+    to->instance_base_changes += from->instance_base_changes;
+    to->draws += from->draws;
+    to->instances += from->instances;
+    to->triangles += from->triangles;
+    to->errors += from->errors;
+    to->state_issued += from->state_issued;
+    to->state_filtered += from->state_filtered;
+}
+
+function void
+render_null_backend_frame_end(Render_Null_Backend *null_backend) {
+    state_cache_frame_end(&null_backend->cache);
+    null_backend->state_issued += null_backend->cache.frame_issued;
+    null_backend->state_filtered += null_backend->cache.frame_filtered;
+}
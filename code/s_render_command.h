@@ -0,0 +1,113 @@
+#if !defined(S_RENDER_COMMAND_H)
+#define S_RENDER_COMMAND_H
+
+// Draw submission as data. Threads record commands into their own stream, the streams are sorted
+// together by key, and a Render_Backend replays the result: D3D11 onto the immediate context or
+// onto deferred contexts a slice each, the null backend onto nothing but a validator and counters.
+//
+// A command is a whole draw with every piece of state it needs, not a state change, so any order
+// of them still means the same thing and sorting can't break anything. render_replay turns a run
+// of them back into the state changes that differ from the command before and the draws.
+
+// batches one recording job takes
+#define render_record_batch_size 64
+
+typedef struct {
+    // ascending; batch keys (s_batch.h) with the depth bits clear
+    u64 key;
+    // GameShader_
+    u32 shader;
+    // into the shared geometry buffers
+    u32 index_count;
+    u32 first_index;
+    s32 base_vertex;
+    // a run of the visible list
+    u32 instance_base;
+    u32 instance_count;
+} Render_Command;
+
+// One thread's commands. Only its owner pushes, so there's no locking.
+typedef struct {
+    Arena arena;
+    Render_Command *commands;
+    u64 count;
+} Render_Stream;
+
+// A stream per job worker, workers record into streams[worker_index].
+typedef struct {
+    u32 stream_count;
+    Render_Stream *streams;
+    Arena arena;
+} Render_Queue;
+
+// How replay talks to an API. Every call gets data. begin comes first on each slice and may
+// assume nothing about the state left by anything before, end comes last.
+typedef struct {
+    void *data;
+    void (*begin)(void *data);
+    void (*set_shader)(void *data, u32 shader);
+    void (*set_instance_base)(void *data, u32 instance_base);
+    void (*draw)(void *data, u32 index_count, u32 instance_count, u32 first_index, s32 base_vertex);
+    void (*end)(void *data);
+} Render_Backend;
+
+// Checks every call against the limits and counts what a replay would have sent.
+typedef struct {
+    u32 shader_count;
+    u32 index_count;
+    u32 vertex_count;
+    u32 instance_count;
+
+    u64 slices;
+    u64 shader_changes;
+    u64 instance_base_changes;
+    u64 draws;
+    u64 instances;
+    u64 triangles;
+    // calls that would have drawn garbage or faulted on a device
+    u64 errors;
+
+    b32 has_shader;
+    b32 has_instance_base;
+    u32 shader;
+    u32 instance_base;
+
+    // The stand-in context. begin and set_shader bind through cache what the D3D11 backend would,
+    // made-up handles for objects, and bound is what the context holds after the calls the cache
+    // let through. A draw where the two disagree is an error, a call the cache dropped wrongly.
+    State_Cache cache;
+    u64 bound[StateSlot_Count];
+    u64 state_issued;
+    u64 state_filtered;
+} Render_Null_Backend;
+
+function void render_queue_init(Render_Queue *queue, u32 stream_count);
+function void render_queue_release(Render_Queue *queue);
+// Empties every stream, once a frame before recording.
+function void render_queue_reset(Render_Queue *queue);
+function void render_stream_push(Render_Stream *stream, Render_Command *command);
+
+// Every batch as one command into the queue, the batches split across the job system.
+function void render_record_batches_parallel(Job_System *jobs, Render_Queue *queue, Game_State *game,
+                                             Batch *batches, u32 batch_count);
+// Every stream's commands in one array on arena, by key; equal keys stay in stream order, then in
+// the order they were pushed.
+function Render_Command *render_queue_sort(Render_Queue *queue, Job_System *jobs, Arena *arena, u64 *count);
+
+function void render_replay(Render_Backend *backend, Render_Command *commands, u64 count);
+// Splits commands into backend_count contiguous slices and replays slice i on backends[i] from a
+// job each, empty slices included. Backends that record for later, deferred contexts, are left to
+// the caller to submit in slice order.
+function void render_replay_parallel(Job_System *jobs, Render_Backend *backends, u32 backend_count,
+                                     Render_Command *commands, u64 count);
+
+// Zeroes everything but the limits, and forgets the cache.
+function void render_null_backend_init(Render_Null_Backend *null_backend, u32 shader_count, u32 index_count,
+                                       u32 vertex_count, u32 instance_count);
+function Render_Backend render_null_backend(Render_Null_Backend *null_backend);
+// Ends the cache's frame and adds its counters into state_issued and state_filtered.
+function void render_null_backend_frame_end(Render_Null_Backend *null_backend);
+// Adds the counters of from into to, the limits and the cache stay.
+function void render_null_backend_add(Render_Null_Backend *to, Render_Null_Backend *from);
+
+#endif
@@ -0,0 +1,293 @@
+// Render commands: render_queue_sort against qsort on (key, stream, push order), which is the order
+// the header promises, and replay through the null backend, whose counters have to come out at what
+// the commands ask for, with every bad command counted as an error. The benchmark records a million
+// commands from the job system, sorts them and replays them through null backends, the command
+// throughput with no API underneath.
+
+typedef struct {
+    Render_Command command;
+    u32 stream;
+    u32 push;
+} Render_Command_Test_Entry;
+
+function int
+render_command_test_compare(const void *a, const void *b) {
+    const Render_Command_Test_Entry *x = (const Render_Command_Test_Entry *)a;
+    const Render_Command_Test_Entry *y = (const Render_Command_Test_Entry *)b;
+    int result = (x->command.key > y->command.key) - (x->command.key < y->command.key);
+    if (!result) {
+        result = (x->stream > y->stream) - (x->stream < y->stream);
+    }
+    if (!result) {
+        result = (x->push > y->push) - (x->push < y->push);
+    }
+    return(result);
+}
+
+// Limits of the null backends the tests and the benchmark replay through.
+#define render_command_test_shader_count 4
+#define render_command_test_index_count 3600
+#define render_command_test_vertex_count 2400
+#define render_command_test_instance_count 100000
+
+// A command that draws fine on the test limits: a 36 index mesh out of 100, an instance run out of
+// 1000, keys from a few shaders and meshes so runs of equal keys are long.
+function Render_Command
+render_command_test_command(Test_Random *random) {
+    Render_Command result;
+    u32 shader = test_random_u32(random) % render_command_test_shader_count;
+    u32 mesh = test_random_u32(random) % 100;
+    result.key = ((u64)shader << batch_key_shader_shift) | ((u64)mesh << batch_key_mesh_shift);
+    result.shader = shader;
+    result.index_count = 36;
+    result.first_index = mesh * 36;
+    result.base_vertex = (s32)(mesh * 24);
+    result.instance_base = (test_random_u32(random) % 1000) * 100;
+    result.instance_count = 1 + test_random_u32(random) % 100;
+    return(result);
+}
+
+function void
+test_render_command(void) {
+    Arena arena = arena_reserve(megabytes(256));
+    Job_System jobs;
+    job_system_init(&jobs, 4);
+
+    // Sorting. Commands go to random streams, each tagged with its stream in instance_base and its
+    // push order in first_index, so any reordering of equal keys shows.
+    u64 max_count = 200000;
+    Render_Command_Test_Entry *entries = (Render_Command_Test_Entry *)malloc(max_count * sizeof(Render_Command_Test_Entry));
+    u32 stream_counts[] = { 1, 3, 8 };
+    u64 counts[] = { 0, 1, 2, 1000, batch_sort_chunk_size + 1, max_count };
+    for (u32 stream_index = 0; stream_index < array_count(stream_counts); ++stream_index) {
+        for (u32 count_index = 0; count_index < array_count(counts); ++count_index) {
+            for (u32 presorted = 0; presorted < 2; ++presorted) {
+                u32 stream_count = stream_counts[stream_index];
+                u64 count = counts[count_index];
+                Render_Queue queue;
+                render_queue_init(&queue, stream_count);
+                Test_Random random = test_random_make(24 + count_index);
+                u32 pushes[8] = { 0 };
+                for (u64 index = 0; index < count; ++index) {
+                    Render_Command_Test_Entry *entry = entries + index;
+                    entry->command = render_command_test_command(&random);
+                    // in order already, with streams holding consecutive runs, takes the path that only concatenates
+                    entry->stream = presorted ? (u32)((index * stream_count) / count) : test_random_u32(&random) % stream_count;
+                    if (presorted) {
+                        entry->command.key = index / 7;
+                    }
+                    entry->push = pushes[entry->stream]++;
+                    entry->command.instance_base = entry->stream;
+                    entry->command.first_index = entry->push;
+                    render_stream_push(queue.streams + entry->stream, &entry->command);
+                }
+                qsort(entries, count, sizeof(Render_Command_Test_Entry), render_command_test_compare);
+
+                u64 sorted_count = 0;
+                u64 pos = arena.pos;
+                Render_Command *sorted = render_queue_sort(&queue, &jobs, &arena, &sorted_count);
+                u64 wrong = 0;
+                for (u64 index = 0; (index < count) && (sorted_count == count); ++index) {
+                    wrong += memory_compare(sorted + index, &entries[index].command, sizeof(Render_Command)) != 0;
+                }
+                test_check((sorted_count == count) && !wrong, "%u streams, %llu commands%s: %llu sorted, %llu differ from qsort",
+                           stream_count, (unsigned long long)count, presorted ? " in order" : "",
+                           (unsigned long long)sorted_count, (unsigned long long)wrong);
+                // only the result stays on the arena
+                test_check(arena.pos - pos <= count * sizeof(Render_Command) + 8, "%u streams, %llu commands: sort left %llu bytes",
+                           stream_count, (unsigned long long)count, (unsigned long long)(arena.pos - pos));
+                arena_clear(&arena);
+
+                render_queue_reset(&queue);
+                u64 left = 0;
+                for (u32 stream = 0; stream < stream_count; ++stream) {
+                    left += queue.streams[stream].count + queue.streams[stream].arena.pos;
+                }
+                test_check(!left, "reset left commands in the streams");
+                render_queue_release(&queue);
+            }
+        }
+    }
+    free(entries);
+
+    // Replay. One backend sees every command; the parallel replay splits them over more backends
+    // than there are commands in the small cases, and the totals have to match either way.
+    u64 replay_counts[] = { 0, 1, 5, 10000 };
+    for (u32 count_index = 0; count_index < array_count(replay_counts); ++count_index) {
+        u64 count = replay_counts[count_index];
+        Test_Random random = test_random_make(240 + count_index);
+        Render_Command *commands = arena_push_array(&arena, Render_Command, count + 1);
+        u64 shader_runs = 0;
+        u64 instances = 0;
+        for (u64 index = 0; index < count; ++index) {
+            commands[index] = render_command_test_command(&random);
+            // long runs of one shader, the way sorted commands come
+            commands[index].shader = (u32)((index * render_command_test_shader_count) / count);
+            shader_runs += !index || (commands[index].shader != commands[index - 1].shader);
+            instances += commands[index].instance_count;
+        }
+
+        Render_Null_Backend single;
+        render_null_backend_init(&single, render_command_test_shader_count, render_command_test_index_count,
+                                 render_command_test_vertex_count, render_command_test_instance_count);
+        Render_Backend backend = render_null_backend(&single);
+        render_replay(&backend, commands, count);
+        test_check((single.slices == 1) && (single.draws == count) && (single.shader_changes == shader_runs) &&
+                   (single.instances == instances) && (single.triangles == instances * 12) && !single.errors,
+                   "%llu commands: %llu draws, %llu shader changes, %llu instances, %llu triangles, %llu errors",
+                   (unsigned long long)count, (unsigned long long)single.draws, (unsigned long long)single.shader_changes,
+                   (unsigned long long)single.instances, (unsigned long long)single.triangles,
+                   (unsigned long long)single.errors);
+
+        Render_Null_Backend states[6];
+        Render_Backend backends[6];
+        for (u32 index = 0; index < array_count(states); ++index) {
+            render_null_backend_init(states + index, render_command_test_shader_count, render_command_test_index_count,
+                                     render_command_test_vertex_count, render_command_test_instance_count);
+            backends[index] = render_null_backend(states + index);
+        }
+        render_replay_parallel(&jobs, backends, array_count(backends), commands, count);
+        Render_Null_Backend total;
+        render_null_backend_init(&total, 0, 0, 0, 0);
+        for (u32 index = 0; index < array_count(states); ++index) {
+            render_null_backend_add(&total, states + index);
+        }
+        test_check((total.slices == array_count(states)) && (total.draws == count) && (total.instances == instances) &&
+                   (total.triangles == instances * 12) && !total.errors,
+                   "%llu commands on 6 slices: %llu slices, %llu draws, %llu errors", (unsigned long long)count,
+                   (unsigned long long)total.slices, (unsigned long long)total.draws, (unsigned long long)total.errors);
+        arena_clear(&arena);
+    }
+
+    // every way a command can go wrong is one error
+    {
+        Test_Random random = test_random_make(2400);
+        Render_Command commands[8];
+        for (u32 index = 0; index < array_count(commands); ++index) {
+            commands[index] = render_command_test_command(&random);
+        }
+        commands[1].shader = render_command_test_shader_count;
+        commands[2].index_count = 0;
+        commands[3].index_count = 35;
+        commands[4].first_index = render_command_test_index_count - 35;
+        commands[5].base_vertex = -1;
+        commands[6].instance_count = 0;
+        commands[7].instance_base = render_command_test_instance_count - 50;
+        commands[7].instance_count = 51;
+        // the bad shader is one error for the set and one for the draw
+        u64 expected = 8;
+
+        Render_Null_Backend null_backend;
+        render_null_backend_init(&null_backend, render_command_test_shader_count, render_command_test_index_count,
+                                 render_command_test_vertex_count, render_command_test_instance_count);
+        Render_Backend backend = render_null_backend(&null_backend);
+        render_replay(&backend, commands, array_count(commands));
+        test_check(null_backend.errors == expected, "bad commands gave %llu errors, expected %llu",
+                   (unsigned long long)null_backend.errors, (unsigned long long)expected);
+    }
+
+    job_system_release(&jobs);
+    arena_release(&arena);
+}
+
+typedef struct {
+    Render_Queue *queue;
+    Render_Command *source;
+} Render_Command_Bench_Record;
+
+function void
+render_command_bench_record(void *data, u64 begin, u64 end, u32 worker_index) {
+    Render_Command_Bench_Record *record = (Render_Command_Bench_Record *)data;
+    Render_Stream *stream = record->queue->streams + worker_index;
+    for (u64 index = begin; index < end; ++index) {
+        render_stream_push(stream, record->source + index);
+    }
+}
+
+function void
+bench_render_command(void) {
+    u64 count = 1000000;
+    Render_Command *source = (Render_Command *)malloc(count * sizeof(Render_Command));
+    Test_Random random = test_random_make(99);
+    for (u64 index = 0; index < count; ++index) {
+        source[index] = render_command_test_command(&random);
+    }
+    Arena arena = arena_reserve(megabytes(256));
+
+    u32 cpu_count = os_cpu_count();
+    printf("  %u cores\n", cpu_count);
+    // doubling up to every core, and every core when that isn't a power of two
+    for (u32 worker_count = 1; ; worker_count = (worker_count * 2 < cpu_count) ? worker_count * 2 : cpu_count) {
+        Job_System jobs;
+        job_system_init(&jobs, worker_count);
+        Render_Queue queue;
+        render_queue_init(&queue, worker_count);
+        Render_Null_Backend *states = (Render_Null_Backend *)malloc(worker_count * sizeof(Render_Null_Backend));
+        Render_Backend *backends = (Render_Backend *)malloc(worker_count * sizeof(Render_Backend));
+
+        u64 best_record = ~0ull;
+        u64 best_sort = ~0ull;
+        u64 best_replay = ~0ull;
+        u64 errors = 0;
+        for (u32 round = 0; round < 5; ++round) {
+            render_queue_reset(&queue);
+            arena_clear(&arena);
+            for (u32 worker = 0; worker < worker_count; ++worker) {
+                render_null_backend_init(states + worker, render_command_test_shader_count, render_command_test_index_count,
+                                         render_command_test_vertex_count, render_command_test_instance_count);
+                backends[worker] = render_null_backend(states + worker);
+            }
+
+            u64 begin = os_time_ticks();
+            Render_Command_Bench_Record record;
+            record.queue = &queue;
+            record.source = source;
+            Job_Fence fence = {0};
+            job_parallel_for(&jobs, &fence, count, 4096, render_command_bench_record, &record);
+            job_wait(&jobs, &fence);
+            u64 recorded = os_time_ticks();
+
+            u64 sorted_count = 0;
+            Render_Command *sorted = render_queue_sort(&queue, &jobs, &arena, &sorted_count);
+            u64 sorted_at = os_time_ticks();
+
+            render_replay_parallel(&jobs, backends, worker_count, sorted, sorted_count);
+            for (u32 worker = 0; worker < worker_count; ++worker) {
+                render_null_backend_frame_end(states + worker);
+            }
+            u64 replayed = os_time_ticks();
+
+            best_record = (recorded - begin) < best_record ? (recorded - begin) : best_record;
+            best_sort = (sorted_at - recorded) < best_sort ? (sorted_at - recorded) : best_sort;
+            best_replay = (replayed - sorted_at) < best_replay ? (replayed - sorted_at) : best_replay;
+            for (u32 worker = 0; worker < worker_count; ++worker) {
+                errors += states[worker].errors;
+            }
+            errors += sorted_count != count;
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "record, %u workers", worker_count);
+        bench_report(name, count, best_record);
+        snprintf(name, sizeof(name), "sort, %u workers", worker_count);
+        bench_report(name, count, best_sort);
+        snprintf(name, sizeof(name), "null replay, %u workers", worker_count);
+        bench_report(name, count, best_replay);
+        snprintf(name, sizeof(name), "all three, %u workers", worker_count);
+        bench_report(name, count, best_record + best_sort + best_replay);
+        if (errors) {
+            printf("  %llu commands went wrong\n", (unsigned long long)errors);
+        }
+
+        free(backends);
+        free(states);
+        render_queue_release(&queue);
+        job_system_release(&jobs);
+        if (worker_count >= cpu_count) {
+            break;
+        }
+    }
+
+    arena_release(&arena);
+    free(source);
+}
@@ -0,0 +1,249 @@
+// https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
+function u64
+shader_cache_hash(u64 hash, void *data, u64 size) {
+    u8 *bytes = (u8 *)data;
+    for (u64 byte_index = 0; byte_index < size; ++byte_index) {
+        hash ^= bytes[byte_index];
+        hash *= 0x100000001b3ull;
+    }
+    return(hash);
+}
+
+function u64
+shader_cache_key(String_Const_U8 source, char *entry_point, char *profile, Shader_Define *defines, u32 flags) {
+    // the terminators keep "ab" + "c" apart from "a" + "bc"
+    u8 zero = 0;
+    u32 version = shader_cache_version;
+    u64 result = 0xcbf29ce484222325ull;
+    result = shader_cache_hash(result, source.str, source.char_count);
+    result = shader_cache_hash(result, &zero, 1);
+    result = shader_cache_hash(result, entry_point, strlen(entry_point));
+    result = shader_cache_hash(result, &zero, 1);
+    result = shader_cache_hash(result, profile, strlen(profile));
+    result = shader_cache_hash(result, &zero, 1);
+    for (Shader_Define *define = defines; define && define->name; ++define) {
+        result = shader_cache_hash(result, define->name, strlen(define->name));
+        result = shader_cache_hash(result, &zero, 1);
+        if (define->value) {
+            result = shader_cache_hash(result, define->value, strlen(define->value));
+        }
+        result = shader_cache_hash(result, &zero, 1);
+    }
+    result = shader_cache_hash(result, &flags, sizeof(flags));
+    result = shader_cache_hash(result, &version, sizeof(version));
+    return(result);
+}
+
+function b32
+shader_cache_validate(OS_File_Map *map) {
+    if (map->size < sizeof(Shader_Cache_Header)) {
+        return(False);
+    }
+
+    Shader_Cache_Header *header = (Shader_Cache_Header *)map->data;
+    if ((header->magic != shader_cache_magic) ||
+        (header->version != shader_cache_version) ||
+        (header->file_size != map->size)) {
+        return(False);
+    }
+
+    u64 table_end = sizeof(Shader_Cache_Header) + (u64)header->entry_count * sizeof(Shader_Cache_Entry);
+    if (table_end > map->size) {
+        return(False);
+    }
+
+    Shader_Cache_Entry *entries = (Shader_Cache_Entry *)(header + 1);
+    for (u32 entry_index = 0; entry_index < header->entry_count; ++entry_index) {
+        Shader_Cache_Entry *entry = entries + entry_index;
+        if ((entry->offset < table_end) || (entry->offset > map->size) ||
+            (entry->size > (map->size - entry->offset))) {
+            return(False);
+        }
+
+        // strictly increasing, the binary search relies on it
+        if (entry_index && (entries[entry_index - 1].key >= entry->key)) {
+            return(False);
+        }
+    }
+
+    return(True);
+}
+
+function void
+shader_cache_open(Shader_Cache *cache, String_Const_U8 path) {
+    Shader_Cache zero = { 0 };
+    *cache = zero;
+    cache->path = path;
+    cache->arena = arena_reserve(megabytes(64));
+
+    cache->map = os_map_file(path);
+    if (cache->map.data) {
+        if (shader_cache_validate(&cache->map)) {
+            Shader_Cache_Header *header = (Shader_Cache_Header *)cache->map.data;
+            cache->entries = (Shader_Cache_Entry *)(header + 1);
+            cache->entry_count = header->entry_count;
+            cache->used = arena_push_array(&cache->arena, b32, cache->entry_count);
+            if (!cache->used) {
+                cache->entry_count = 0;
+            }
+        } else {
+            os_unmap_file(&cache->map);
+        }
+    }
+
+    // until every entry is looked up, writing would drop the ones that weren't
+    cache->dirty = (cache->entry_count == 0);
+}
+
+function Shader_Blob
+shader_cache_find(Shader_Cache *cache, u64 key) {
+    Shader_Blob result = { 0 };
+
+    u32 low = 0;
+    u32 high = cache->entry_count;
+    while (low < high) {
+        u32 middle = low + (high - low) / 2;
+        Shader_Cache_Entry *entry = cache->entries + middle;
+        if (entry->key == key) {
+            cache->used[middle] = True;
+            result.data = (u8 *)cache->map.data + entry->offset;
+            result.size = entry->size;
+            break;
+        } else if (entry->key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (!result.size) {
+        for (u32 added_index = 0; added_index < cache->added_count; ++added_index) {
+            if (cache->added[added_index].key == key) {
+                result = cache->added[added_index].blob;
+                break;
+            }
+        }
+    }
+
+    return(result);
+}
+
+function Shader_Blob
+shader_cache_add(Shader_Cache *cache, u64 key, void *data, u64 size) {
+    Shader_Blob result = { 0 };
+    void *copy = size ? arena_push(&cache->arena, size, 16) : null;
+    if (copy) {
+        memory_copy(copy, data, size);
+        result.data = copy;
+        result.size = size;
+        if (cache->added_count < shader_cache_max_added) {
+            Shader_Cache_Added *added = cache->added + cache->added_count++;
+            added->key = key;
+            added->blob = result;
+            cache->dirty = True;
+        }
+    }
+    return(result);
+}
+
+function int
+shader_cache_compare_entries(const void *a, const void *b) {
+    u64 x = ((const Shader_Cache_Entry *)a)->key;
+    u64 y = ((const Shader_Cache_Entry *)b)->key;
+    return((x > y) - (x < y));
+}
+
+function b32
+shader_cache_write(Shader_Cache *cache) {
+    for (u32 entry_index = 0; entry_index < cache->entry_count; ++entry_index) {
+        if (!cache->used[entry_index]) {
+            cache->dirty = True;
+        }
+    }
+
+    if (!cache->dirty) {
+        return(True);
+    }
+
+    b32 result = False;
+    u64 restore_pos = cache->arena.pos;
+
+    // Every kept blob with where it comes from, then sorted. A key that was both found and
+    // added can't happen: adding only follows a miss.
+    u32 kept_count = 0;
+    u32 max_count = cache->entry_count + cache->added_count;
+    Shader_Cache_Entry *kept = arena_push_array(&cache->arena, Shader_Cache_Entry, max_count ? max_count : 1);
+    void **kept_data = arena_push_array(&cache->arena, void *, max_count ? max_count : 1);
+    if (kept && kept_data) {
+        for (u32 entry_index = 0; entry_index < cache->entry_count; ++entry_index) {
+            if (cache->used[entry_index]) {
+                kept[kept_count++] = cache->entries[entry_index];
+            }
+        }
+
+        for (u32 added_index = 0; added_index < cache->added_count; ++added_index) {
+            Shader_Cache_Entry *entry = kept + kept_count++;
+            entry->key = cache->added[added_index].key;
+            entry->size = cache->added[added_index].blob.size;
+            // index into added for now, found entries come first so the position tells them apart
+            entry->offset = added_index;
+        }
+
+        // pull the sources out before sorting, offsets get replaced below
+        for (u32 kept_index = 0; kept_index < kept_count; ++kept_index) {
+            Shader_Cache_Entry *entry = kept + kept_index;
+            if (kept_index < (kept_count - cache->added_count)) {
+                kept_data[kept_index] = (u8 *)cache->map.data + entry->offset;
+            } else {
+                kept_data[kept_index] = cache->added[entry->offset].blob.data;
+            }
+            entry->offset = (u64)kept_index;
+        }
+
+        qsort(kept, kept_count, sizeof(Shader_Cache_Entry), shader_cache_compare_entries);
+
+        u64 file_size = align_pow2(sizeof(Shader_Cache_Header) + (u64)kept_count * sizeof(Shader_Cache_Entry), 16);
+        for (u32 kept_index = 0; kept_index < kept_count; ++kept_index) {
+            file_size += align_pow2(kept[kept_index].size, 16);
+        }
+
+        u8 *file = (u8 *)arena_push(&cache->arena, file_size, 16);
+        if (file) {
+            Shader_Cache_Header *header = (Shader_Cache_Header *)file;
+            header->magic = shader_cache_magic;
+            header->version = shader_cache_version;
+            header->entry_count = kept_count;
+            header->file_size = file_size;
+
+            Shader_Cache_Entry *entries = (Shader_Cache_Entry *)(header + 1);
+            u64 offset = align_pow2(sizeof(Shader_Cache_Header) + (u64)kept_count * sizeof(Shader_Cache_Entry), 16);
+            for (u32 kept_index = 0; kept_index < kept_count; ++kept_index) {
+                Shader_Cache_Entry *entry = entries + kept_index;
+                entry->key = kept[kept_index].key;
+                entry->size = kept[kept_index].size;
+                entry->offset = offset;
+                memory_copy(file + offset, kept_data[kept[kept_index].offset], entry->size);
+                offset += align_pow2(entry->size, 16);
+            }
+
+            // Windows won't replace a file that is still mapped
+            os_unmap_file(&cache->map);
+            cache->entries = null;
+            cache->entry_count = 0;
+
+            result = os_write_entire_file(cache->path, file, file_size);
+            cache->dirty = !result;
+        }
+    }
+
+    arena_pop_to(&cache->arena, restore_pos);
+    return(result);
+}
+
+function void
+shader_cache_close(Shader_Cache *cache) {
+    os_unmap_file(&cache->map);
+    arena_release(&cache->arena);
+    Shader_Cache zero = { 0 };
+    *cache = zero;
+}
@@ -0,0 +1,84 @@
+#if !defined(S_SHADER_CACHE_H)
+#define S_SHADER_CACHE_H
+
+// Compiled shader bytecode kept on disk between runs, so that start-up doesn't pay for
+// D3DCompile when the HLSL hasn't changed. Entries are keyed by a hash of everything that goes
+// into the compile (source, entry point, profile, defines and flags), so editing a shader or switching
+// flags simply misses and recompiles; stale entries are never looked at again and are dropped
+// the next time the cache is written.
+//
+// The file is one archive, mapped read-only while the cache is open:
+//   Shader_Cache_Header
+//   Shader_Cache_Entry[entry_count], sorted by key
+//   bytecode, each blob 16-byte aligned
+// Anything that doesn't check out (magic, version, sizes, order) makes the whole file count as
+// empty rather than an error.
+
+#define shader_cache_magic 0x31434853 // "SHC1"
+#define shader_cache_version 1
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 entry_count;
+    u32 __unused_a;
+    u64 file_size;
+} Shader_Cache_Header;
+
+typedef struct {
+    u64 key;
+    u64 offset;
+    u64 size;
+} Shader_Cache_Entry;
+
+typedef struct {
+    void *data;
+    u64 size;
+} Shader_Blob;
+
+// Same layout as D3D_SHADER_MACRO. Lists end with a null name.
+typedef struct {
+    char *name;
+    char *value;
+} Shader_Define;
+
+// compiled since the cache was opened, not in the file yet
+typedef struct {
+    u64 key;
+    Shader_Blob blob;
+} Shader_Cache_Added;
+
+#define shader_cache_max_added 256
+
+typedef struct {
+    String_Const_U8 path;
+    OS_File_Map map;
+
+    Shader_Cache_Entry *entries;
+    u32 entry_count;
+    // one per entry, so a rewrite keeps only what this run still asked for
+    b32 *used;
+
+    Shader_Cache_Added added[shader_cache_max_added];
+    u32 added_count;
+
+    // used flags and added bytecode, remembered or not
+    Arena arena;
+    b32 dirty;
+} Shader_Cache;
+
+// defines may be null
+function u64 shader_cache_key(String_Const_U8 source, char *entry_point, char *profile, Shader_Define *defines, u32 flags);
+function void shader_cache_open(Shader_Cache *cache, String_Const_U8 path);
+// Looks in the file and then in what was added. Blobs from the file point into the mapping and
+// stay valid until shader_cache_write or close, added ones until close. size is zero on a miss.
+function Shader_Blob shader_cache_find(Shader_Cache *cache, u64 key);
+// Copies data and returns the copy, which stays valid until close. Full caches still hand back a
+// copy, they just stop remembering it. size is zero only when the arena is out of memory.
+function Shader_Blob shader_cache_add(Shader_Cache *cache, u64 key, void *data, u64 size);
+// Rewrites the file when something was added or went unused. Unmaps the old file first, so found
+// blobs are gone afterwards.
+function b32 shader_cache_write(Shader_Cache *cache);
+function void shader_cache_close(Shader_Cache *cache);
+
+#endif
@@ -0,0 +1,270 @@
+// Shader cache: keys change with everything that goes into a compile, blobs come back byte for
+// byte across a write and reopen, unused entries get pruned, and files that don't check out open
+// as empty caches that write a good file again.
+
+// Bytecode stand-in, different for every key and size.
+function void
+shader_cache_test_fill(u8 *bytes, u64 size, u64 key) {
+    Test_Random random = test_random_make(key);
+    for (u64 byte_index = 0; byte_index < size; ++byte_index) {
+        bytes[byte_index] = (u8)test_random_u32(&random);
+    }
+}
+
+function b32
+shader_cache_test_blob_is(Shader_Blob blob, u64 size, u64 key) {
+    u8 expected[4096];
+    b32 result = False;
+    if ((blob.size == size) && (size <= sizeof(expected))) {
+        shader_cache_test_fill(expected, size, key);
+        result = memory_compare(blob.data, expected, size) == 0;
+    }
+    return(result);
+}
+
+// Whole file as it is on disk, malloc'd. size is zero when it can't be read.
+function Shader_Blob
+shader_cache_test_read(String_Const_U8 path) {
+    Shader_Blob result = { 0 };
+    OS_File_Map map = os_map_file(path);
+    if (map.data) {
+        result.data = malloc(map.size);
+        result.size = map.size;
+        memory_copy(result.data, map.data, map.size);
+        os_unmap_file(&map);
+    }
+    return(result);
+}
+
+// A cache of key_count blobs with keys first_key + 3 * i and sizes 1 + (i * 37) % 700.
+function void
+shader_cache_test_write_keys(String_Const_U8 path, u64 first_key, u32 key_count) {
+    u8 bytes[4096];
+    Shader_Cache cache;
+    shader_cache_open(&cache, path);
+    for (u32 key_index = 0; key_index < key_count; ++key_index) {
+        u64 key = first_key + 3 * key_index;
+        u64 size = 1 + (key_index * 37) % 700;
+        shader_cache_test_fill(bytes, size, key);
+        shader_cache_add(&cache, key, bytes, size);
+    }
+    shader_cache_write(&cache);
+    shader_cache_close(&cache);
+}
+
+function void
+test_shader_cache(void) {
+    // keys
+    {
+        String_Const_U8 source = str8("float4 ps(float4 p : SV_Position) : SV_Target { return p; }");
+        Shader_Define defines_a[] = { { "A", "1" }, { "B", "0" }, { null, null } };
+        Shader_Define defines_b[] = { { "A", "1" }, { "B", "1" }, { null, null } };
+        Shader_Define defines_c[] = { { "B", "0" }, { "A", "1" }, { null, null } };
+        Shader_Define defines_d[] = { { "A", null }, { null, null } };
+        Shader_Define defines_e[] = { { "A", "" }, { null, null } };
+        Shader_Define defines_f[] = { { "AB", null }, { null, null } };
+        Shader_Define defines_g[] = { { "A", "B" }, { null, null } };
+        Shader_Define defines_none[] = { { null, null } };
+
+        u64 base = shader_cache_key(source, "ps", "ps_5_0", defines_a, 1);
+        test_check(base == shader_cache_key(source, "ps", "ps_5_0", defines_a, 1), "key isn't deterministic");
+        u64 changed[] = {
+            shader_cache_key(str8("float4 ps(float4 p : SV_Position) : SV_Target { return -p; }"), "ps", "ps_5_0", defines_a, 1),
+            shader_cache_key(source, "ps_main", "ps_5_0", defines_a, 1),
+            shader_cache_key(source, "ps", "ps_4_0", defines_a, 1),
+            shader_cache_key(source, "ps", "ps_5_0", defines_b, 1),
+            shader_cache_key(source, "ps", "ps_5_0", defines_c, 1),
+            shader_cache_key(source, "ps", "ps_5_0", null, 1),
+            shader_cache_key(source, "ps", "ps_5_0", defines_a, 0),
+            shader_cache_key(source, "ps", "ps_5_0", defines_a, 1u << 31),
+        };
+        for (u32 index = 0; index < array_count(changed); ++index) {
+            test_check(changed[index] != base, "key %u doesn't change with its input", index);
+            for (u32 other = 0; other < index; ++other) {
+                test_check(changed[index] != changed[other], "keys %u and %u collide", other, index);
+            }
+        }
+        test_check(shader_cache_key(source, "ps", "ps_5_0", null, 1) ==
+                   shader_cache_key(source, "ps", "ps_5_0", defines_none, 1), "null and empty define lists differ");
+        // where one string ends and the next starts matters
+        test_check(shader_cache_key(str8("ab"), "c", "ps_5_0", null, 0) != shader_cache_key(str8("a"), "bc", "ps_5_0", null, 0),
+                   "source and entry point run together");
+        test_check(shader_cache_key(source, "ps", "ps_5_0", defines_f, 0) != shader_cache_key(source, "ps", "ps_5_0", defines_g, 0),
+                   "define name and value run together");
+        test_check(shader_cache_key(source, "ps", "ps_5_0", defines_d, 0) == shader_cache_key(source, "ps", "ps_5_0", defines_e, 0),
+                   "a null define value should hash like an empty one, D3D treats them the same");
+    }
+
+    char path_z[256];
+    snprintf(path_z, sizeof(path_z), "/tmp/s_test_shader_%d.cache", (int)getpid());
+    String_Const_U8 path = str8_make(path_z, strlen(path_z));
+    unlink(path_z);
+    u8 bytes[4096];
+
+    // round trip
+    {
+        u32 key_count = 100;
+        Shader_Cache cache;
+        shader_cache_open(&cache, path);
+        test_check(cache.entry_count == 0, "a missing file should open empty");
+        test_check(!shader_cache_find(&cache, 7).size, "empty cache finds something");
+        for (u32 key_index = 0; key_index < key_count; ++key_index) {
+            // added out of key order, the file has to sort them
+            u64 key = (u64)(key_index * 7919 % key_count) * 0x9E3779B97F4A7C15ull;
+            u64 size = 1 + (key_index * 53) % 3000;
+            shader_cache_test_fill(bytes, size, key);
+            Shader_Blob added = shader_cache_add(&cache, key, bytes, size);
+            test_check(shader_cache_test_blob_is(added, size, key), "add doesn't return a copy of the data");
+            test_check(shader_cache_test_blob_is(shader_cache_find(&cache, key), size, key), "added blob not found");
+        }
+        test_check(shader_cache_write(&cache), "write failed");
+        shader_cache_close(&cache);
+
+        shader_cache_open(&cache, path);
+        test_check(cache.entry_count == key_count, "reopened with %u entries, wrote %u", cache.entry_count, key_count);
+        for (u32 key_index = 0; key_index < key_count; ++key_index) {
+            u64 key = (u64)(key_index * 7919 % key_count) * 0x9E3779B97F4A7C15ull;
+            u64 size = 1 + (key_index * 53) % 3000;
+            Shader_Blob blob = shader_cache_find(&cache, key);
+            test_check(shader_cache_test_blob_is(blob, size, key), "key %u doesn't come back from the file", key_index);
+            test_check(((u64)blob.data & 15) == 0, "blob from the file isn't 16 byte aligned");
+        }
+        test_check(!shader_cache_find(&cache, 1).size, "unknown key found in the file");
+
+        // everything was used and nothing added, so nothing to rewrite
+        Shader_Blob before = shader_cache_test_read(path);
+        test_check(!cache.dirty, "cache dirty after finding every entry");
+        test_check(shader_cache_write(&cache), "clean write failed");
+        shader_cache_close(&cache);
+        Shader_Blob after = shader_cache_test_read(path);
+        test_check((before.size == after.size) && (memory_compare(before.data, after.data, before.size) == 0),
+                   "clean cache rewrote the file");
+        free(before.data);
+        free(after.data);
+    }
+
+    // pruning: only what this run found or added survives
+    {
+        unlink(path_z);
+        shader_cache_test_write_keys(path, 1000, 40);
+
+        Shader_Cache cache;
+        shader_cache_open(&cache, path);
+        for (u32 key_index = 0; key_index < 40; key_index += 2) {
+            shader_cache_find(&cache, 1000 + 3 * key_index);
+        }
+        test_check(!cache.dirty, "finding entries shouldn't dirty the cache");
+        for (u32 key_index = 0; key_index < 5; ++key_index) {
+            u64 key = 5000 + key_index;
+            shader_cache_test_fill(bytes, 100 + key_index, key);
+            shader_cache_add(&cache, key, bytes, 100 + key_index);
+        }
+        test_check(shader_cache_write(&cache), "pruning write failed");
+        shader_cache_close(&cache);
+
+        shader_cache_open(&cache, path);
+        test_check(cache.entry_count == 25, "pruned cache has %u entries, expected 25", cache.entry_count);
+        for (u32 key_index = 0; key_index < 40; ++key_index) {
+            u64 key = 1000 + 3 * key_index;
+            Shader_Blob blob = shader_cache_find(&cache, key);
+            if (key_index & 1) {
+                test_check(!blob.size, "unused key %u survived the rewrite", key_index);
+            } else {
+                test_check(shader_cache_test_blob_is(blob, 1 + (key_index * 37) % 700, key), "used key %u lost", key_index);
+            }
+        }
+        for (u32 key_index = 0; key_index < 5; ++key_index) {
+            u64 key = 5000 + key_index;
+            test_check(shader_cache_test_blob_is(shader_cache_find(&cache, key), 100 + key_index, key),
+                       "added key %u lost", key_index);
+        }
+        shader_cache_close(&cache);
+
+        // nothing looked up drops everything
+        shader_cache_open(&cache, path);
+        test_check(shader_cache_write(&cache), "empty rewrite failed");
+        shader_cache_close(&cache);
+        shader_cache_open(&cache, path);
+        test_check(cache.entry_count == 0, "unused entries survived a rewrite");
+        shader_cache_close(&cache);
+    }
+
+    // a full cache hands out copies it won't remember
+    {
+        unlink(path_z);
+        Shader_Cache cache;
+        shader_cache_open(&cache, path);
+        u32 key_count = shader_cache_max_added + 10;
+        b32 all_returned = True;
+        for (u32 key_index = 0; key_index < key_count; ++key_index) {
+            shader_cache_test_fill(bytes, 64, key_index);
+            Shader_Blob added = shader_cache_add(&cache, key_index, bytes, 64);
+            all_returned = all_returned && shader_cache_test_blob_is(added, 64, key_index);
+        }
+        test_check(all_returned, "full cache didn't return a copy");
+        test_check(!shader_cache_find(&cache, shader_cache_max_added).size, "full cache remembered a blob");
+        test_check(shader_cache_write(&cache), "full cache write failed");
+        shader_cache_close(&cache);
+        shader_cache_open(&cache, path);
+        test_check(cache.entry_count == shader_cache_max_added, "full cache wrote %u entries", cache.entry_count);
+        shader_cache_close(&cache);
+    }
+
+    // corrupt files open empty and get replaced by a good one
+    {
+        unlink(path_z);
+        shader_cache_test_write_keys(path, 10, 8);
+        Shader_Blob good = shader_cache_test_read(path);
+        Shader_Cache_Header *header = (Shader_Cache_Header *)good.data;
+        Shader_Cache_Entry *entries = (Shader_Cache_Entry *)(header + 1);
+        test_check(good.size && (header->entry_count == 8), "couldn't write the file to corrupt");
+
+        char *corruption_names[] = {
+            "empty", "truncated header", "truncated table", "truncated blob", "magic", "version", "file_size",
+            "entry_count", "offset into the table", "offset past the end", "size past the end", "keys out of order",
+            "duplicate key",
+        };
+        for (u32 corruption = 0; corruption < array_count(corruption_names); ++corruption) {
+            u8 *file = (u8 *)malloc(good.size);
+            memory_copy(file, good.data, good.size);
+            Shader_Cache_Header *bad = (Shader_Cache_Header *)file;
+            Shader_Cache_Entry *bad_entries = (Shader_Cache_Entry *)(bad + 1);
+            u64 size = good.size;
+            switch (corruption) {
+                case 0: { size = 0; } break;
+                case 1: { size = sizeof(Shader_Cache_Header) - 1; } break;
+                case 2: { size = sizeof(Shader_Cache_Header) + sizeof(Shader_Cache_Entry) * 3; bad->file_size = size; } break;
+                case 3: { size = entries[7].offset + entries[7].size - 1; bad->file_size = size; } break;
+                case 4: { bad->magic ^= 1; } break;
+                case 5: { bad->version += 1; } break;
+                case 6: { bad->file_size += 16; } break;
+                case 7: { bad->entry_count = 0x10000000; } break;
+                case 8: { bad_entries[2].offset = sizeof(Shader_Cache_Header); } break;
+                case 9: { bad_entries[5].offset = good.size + 1; } break;
+                case 10: { bad_entries[7].size = good.size; } break;
+                case 11: { bad_entries[3].key = entries[5].key; } break;
+                case 12: { bad_entries[4].key = entries[3].key; } break;
+            }
+            os_write_entire_file(path, file, size);
+            free(file);
+
+            Shader_Cache cache;
+            shader_cache_open(&cache, path);
+            test_check(cache.entry_count == 0, "%s: corrupt file opened with %u entries",
+                       corruption_names[corruption], cache.entry_count);
+            test_check(!shader_cache_find(&cache, 10).size, "%s: found a blob in a corrupt file", corruption_names[corruption]);
+            shader_cache_test_fill(bytes, 50, 77);
+            shader_cache_add(&cache, 77, bytes, 50);
+            test_check(shader_cache_write(&cache), "%s: rewrite failed", corruption_names[corruption]);
+            shader_cache_close(&cache);
+
+            shader_cache_open(&cache, path);
+            test_check((cache.entry_count == 1) && shader_cache_test_blob_is(shader_cache_find(&cache, 77), 50, 77),
+                       "%s: rewrite isn't a good file", corruption_names[corruption]);
+            shader_cache_close(&cache);
+        }
+        free(good.data);
+    }
+
+    unlink(path_z);
+}
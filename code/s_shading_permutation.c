@@ -0,0 +1,32 @@
+#define shading_permutation_row(slot,directional,point,spot) \
+    { (slot) * 4 + (point) * 2 + (spot), \
+      { { "NUM_DIRECTIONAL", directional }, { "HAS_POINT", stringify(point) }, { "HAS_SPOT", stringify(spot) }, { 0, 0 } } }
+#define shading_permutation_rows(slot,directional) \
+    shading_permutation_row(slot, directional, 0, 0), shading_permutation_row(slot, directional, 0, 1), \
+    shading_permutation_row(slot, directional, 1, 0), shading_permutation_row(slot, directional, 1, 1)
+
+global Shading_Permutation shading_permutations[shading_permutation_count] = {
+    shading_permutation_rows(0, "0"),
+    shading_permutation_rows(1, "1"),
+    shading_permutation_rows(2, "2"),
+    shading_permutation_rows(3, "3"),
+    shading_permutation_rows(4, "4"),
+    shading_permutation_rows(5, "-1"),
+};
+
+function u32
+shading_permutation_key(u32 directional_count, b32 has_point, b32 has_spot) {
+    u32 directional_slot = directional_count;
+    if (directional_slot > shading_permutation_max_directional) {
+        directional_slot = shading_permutation_max_directional + 1;
+    }
+    u32 result = directional_slot * 4 + (has_point ? 2 : 0) + (has_spot ? 1 : 0);
+    return(result);
+}
+
+function u32
+shading_permutation_select(Light_Clusters *clusters) {
+    u32 result = shading_permutation_key(clusters->directional_count, clusters->point_count != 0,
+                                         clusters->spot_count != 0);
+    return(result);
+}
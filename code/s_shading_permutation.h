@@ -0,0 +1,32 @@
+#if !defined(S_SHADING_PERMUTATION_H)
+#define S_SHADING_PERMUTATION_H
+
+// ps_test_shading_model is compiled once per combination of what the lights need, picked with
+// #defines so the shader has no loop or branch for lights that aren't there:
+//   NUM_DIRECTIONAL  directional lights, the loop is unrolled; -1 loops over directional_count
+//   HAS_POINT        some cluster list can hold a point light
+//   HAS_SPOT         some cluster list can hold a spotlight
+// Without either, the pixel never looks at its cluster. With just one, the list is walked without
+// checking light.type.
+//
+// Keys are dense, key = directional_slot * 4 + HAS_POINT * 2 + HAS_SPOT, where directional_slot
+// is NUM_DIRECTIONAL or shading_permutation_max_directional + 1 for the loop. So the key is also
+// the index into shading_permutations.
+
+#define shading_permutation_max_directional 4
+#define shading_permutation_count ((shading_permutation_max_directional + 2) * 4)
+#define shading_permutation_max_defines 4
+
+typedef struct {
+    u32 key;
+    // null-terminated, ready for D3DCompile
+    Shader_Define defines[shading_permutation_max_defines];
+} Shading_Permutation;
+
+global Shading_Permutation shading_permutations[shading_permutation_count];
+
+function u32 shading_permutation_key(u32 directional_count, b32 has_point, b32 has_spot);
+// The smallest variant that still shades every light the clusters hold.
+function u32 shading_permutation_select(Light_Clusters *clusters);
+
+#endif
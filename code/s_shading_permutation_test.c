@@ -0,0 +1,143 @@
+// Shading permutations: every row's defines read back to the key it sits under, and
+// shading_permutation_select picks the smallest variant that still covers what the clusters hold.
+
+function void
+test_shading_permutation(void) {
+    // each row's defines, read back, key to the row's own index
+    for (u32 index = 0; index < shading_permutation_count; ++index) {
+        Shading_Permutation *permutation = shading_permutations + index;
+        Shader_Define *defines = permutation->defines;
+        test_check(permutation->key == index, "row %u holds key %u", index, permutation->key);
+        if (!test_check((strcmp(defines[0].name, "NUM_DIRECTIONAL") == 0) && (strcmp(defines[1].name, "HAS_POINT") == 0) &&
+                        (strcmp(defines[2].name, "HAS_SPOT") == 0) && !defines[3].name, "row %u: defines out of shape", index)) {
+            continue;
+        }
+
+        int directional = atoi(defines[0].value);
+        int point = atoi(defines[1].value);
+        int spot = atoi(defines[2].value);
+        test_check((directional >= -1) && (directional <= shading_permutation_max_directional) &&
+                   ((point == 0) || (point == 1)) && ((spot == 0) || (spot == 1)),
+                   "row %u: NUM_DIRECTIONAL %s, HAS_POINT %s, HAS_SPOT %s", index,
+                   defines[0].value, defines[1].value, defines[2].value);
+
+        // the loop variant stands for every count past the unrolled ones
+        u32 counts[] = { (u32)directional, shading_permutation_max_directional + 1, 100, 0xFFFFFFFF };
+        u32 count_total = (directional < 0) ? array_count(counts) : 1;
+        for (u32 count_index = (directional < 0) ? 1 : 0; count_index < count_total; ++count_index) {
+            u32 key = shading_permutation_key(counts[count_index], point, spot);
+            test_check(key == permutation->key, "row %u: %u directional, point %d, spot %d keys to %u",
+                       index, counts[count_index], point, spot, key);
+        }
+    }
+
+    // keys are dense and every combination has one row
+    u8 seen[shading_permutation_count] = { 0 };
+    for (u32 directional = 0; directional <= shading_permutation_max_directional + 1; ++directional) {
+        for (u32 flags = 0; flags < 4; ++flags) {
+            u32 key = shading_permutation_key(directional, (flags & 2) != 0, (flags & 1) != 0);
+            if (test_check(key < shading_permutation_count, "key %u out of range", key)) {
+                test_check(!seen[key], "key %u for two combinations", key);
+                seen[key] = True;
+            }
+        }
+    }
+
+    // counts set by hand
+    struct {
+        u32 directional_count;
+        u32 point_count;
+        u32 spot_count;
+        char *num_directional;
+        char *has_point;
+        char *has_spot;
+    } cases[] = {
+        { 0, 0, 0, "0", "0", "0" },
+        { 1, 0, 0, "1", "0", "0" },
+        { 0, 7, 0, "0", "1", "0" },
+        { 0, 0, 3, "0", "0", "1" },
+        { 2, 1, 1, "2", "1", "1" },
+        { 4, 0, 9, "4", "0", "1" },
+        { 5, 1, 0, "-1", "1", "0" },
+        { 1000, 1000, 1000, "-1", "1", "1" },
+    };
+    for (u32 case_index = 0; case_index < array_count(cases); ++case_index) {
+        Light_Clusters clusters = { 0 };
+        clusters.directional_count = cases[case_index].directional_count;
+        clusters.point_count = cases[case_index].point_count;
+        clusters.spot_count = cases[case_index].spot_count;
+        u32 key = shading_permutation_select(&clusters);
+        if (test_check(key < shading_permutation_count, "case %u: key %u out of range", case_index, key)) {
+            Shader_Define *defines = shading_permutations[key].defines;
+            test_check((strcmp(defines[0].value, cases[case_index].num_directional) == 0) &&
+                       (strcmp(defines[1].value, cases[case_index].has_point) == 0) &&
+                       (strcmp(defines[2].value, cases[case_index].has_spot) == 0),
+                       "case %u: selected NUM_DIRECTIONAL %s, HAS_POINT %s, HAS_SPOT %s", case_index,
+                       defines[0].value, defines[1].value, defines[2].value);
+        }
+    }
+
+    // Real binning: the selected variant covers every light type in every list, and drops the
+    // flag for a type that only has lights nowhere near the view.
+    Job_System jobs;
+    job_system_init(&jobs, 2);
+    Arena arena = arena_reserve(megabytes(16));
+    m44 pers = m44_perspective_lh_z01(radians(66.2f), 9.0f / 16.0f, 1.0f, 100.0f);
+    Light_View view;
+    view.camera_p = v3f_make(0.0f, 0.0f, 0.0f);
+    view.camera_forward = v3f_make(0.0f, 0.0f, 1.0f);
+    view.world_to_camera = m44_look_at_lh(view.camera_p, view.camera_forward, v3f_make(0.0f, 1.0f, 0.0f));
+    view.projection_x = pers.m[0][0];
+    view.projection_y = pers.m[1][1];
+    view.near_plane = 1.0f;
+    view.far_plane = 100.0f;
+
+    Light lights[8];
+    for (u32 light_index = 0; light_index < array_count(lights); ++light_index) {
+        Light light = { 0 };
+        light.type = LightType_Directional;
+        light.direction = v3f_make(0.0f, -1.0f, 1.0f);
+        light.reference_distance = 4.0f;
+        light.max_distance = 10.0f;
+        light.min_distance = 1.0f;
+        light.inner_angle = 15.0f;
+        light.max_angle = 30.0f;
+        light.colour = v4f_make(1.0f, 1.0f, 1.0f, 1.0f);
+        light.enabled = True;
+        lights[light_index] = light;
+    }
+    // a spot in front of the camera, a point far behind it, a disabled point in front, and
+    // directional lights of which one is disabled
+    lights[0].type = LightType_Spotlight;
+    lights[0].p = v3f_make(0.0f, 0.0f, 20.0f);
+    lights[0].direction = v3f_make(0.0f, 0.0f, 1.0f);
+    lights[1].type = LightType_Point;
+    lights[1].p = v3f_make(0.0f, 0.0f, -500.0f);
+    lights[2].type = LightType_Point;
+    lights[2].p = v3f_make(0.0f, 0.0f, 20.0f);
+    lights[2].enabled = False;
+    lights[3].enabled = False;
+
+    Light_Clusters clusters;
+    light_clusters_build(&clusters, &jobs, &arena, &view, lights, array_count(lights));
+    u32 key = shading_permutation_select(&clusters);
+    test_check(key == shading_permutation_key(4, False, True), "binned scene selected key %u", key);
+
+    Shader_Define *defines = shading_permutations[key].defines;
+    b32 has_point = strcmp(defines[1].value, "1") == 0;
+    b32 has_spot = strcmp(defines[2].value, "1") == 0;
+    u64 uncovered = 0;
+    for (u32 cluster_index = 0; cluster_index < light_cluster_count; ++cluster_index) {
+        Light_Cluster *cluster = clusters.clusters + cluster_index;
+        for (u32 entry = 0; entry < cluster->count; ++entry) {
+            u32 type = lights[clusters.indices[cluster->offset + entry]].type;
+            uncovered += ((type == LightType_Point) && !has_point) || ((type == LightType_Spotlight) && !has_spot);
+        }
+    }
+    test_check(!uncovered, "selected variant misses %llu binned lights", (unsigned long long)uncovered);
+    test_check(atoi(defines[0].value) == (int)clusters.directional_count,
+               "NUM_DIRECTIONAL %s for %u directional lights", defines[0].value, clusters.directional_count);
+
+    arena_release(&arena);
+    job_system_release(&jobs);
+}
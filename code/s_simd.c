@@ -0,0 +1,438 @@
+#if defined(S_SIMD_SSE)
+
+function f32x4
+f32x4_set(f32 x, f32 y, f32 z, f32 w) {
+	f32x4 result = _mm_setr_ps(x, y, z, w);
+	return(result);
+}
+
+function f32x4
+f32x4_set1(f32 a) {
+	f32x4 result = _mm_set1_ps(a);
+	return(result);
+}
+
+function f32x4
+f32x4_zero(void) {
+	f32x4 result = _mm_setzero_ps();
+	return(result);
+}
+
+function f32x4
+f32x4_load(f32 *src) {
+	f32x4 result = _mm_loadu_ps(src);
+	return(result);
+}
+
+function void
+f32x4_store(f32 *dst, f32x4 a) {
+	_mm_storeu_ps(dst, a);
+}
+
+function f32
+f32x4_first(f32x4 a) {
+	f32 result = _mm_cvtss_f32(a);
+	return(result);
+}
+
+function f32x4
+f32x4_add(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_add_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_sub(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_sub_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_mul(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_mul_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_div(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_div_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_madd(f32x4 a, f32x4 b, f32x4 c) {
+#if defined(S_SIMD_FMA)
+	f32x4 result = _mm_fmadd_ps(a, b, c);
+#else
+	f32x4 result = _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+	return(result);
+}
+
+function f32x4
+f32x4_min(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_min_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_max(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_max_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_sqrt(f32x4 a) {
+	f32x4 result = _mm_sqrt_ps(a);
+	return(result);
+}
+
+function f32x4
+f32x4_cmp_lt(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_cmplt_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_cmp_le(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_cmple_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_and(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_and_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_or(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_or_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_select(f32x4 mask, f32x4 when_true, f32x4 when_false) {
+	f32x4 result = _mm_or_ps(_mm_and_ps(mask, when_true), _mm_andnot_ps(mask, when_false));
+	return(result);
+}
+
+function u32
+f32x4_mask(f32x4 mask) {
+	u32 result = (u32)_mm_movemask_ps(mask);
+	return(result);
+}
+
+function f32x4
+f32x4_unpack_lo(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_unpacklo_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_unpack_hi(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_unpackhi_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_move_lh(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_movelh_ps(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_move_hl(f32x4 a, f32x4 b) {
+	f32x4 result = _mm_movehl_ps(a, b);
+	return(result);
+}
+
+#elif defined(S_SIMD_NEON)
+
+function f32x4
+f32x4_set(f32 x, f32 y, f32 z, f32 w) {
+	f32 e[4] = { x, y, z, w };
+	f32x4 result = vld1q_f32(e);
+	return(result);
+}
+
+function f32x4
+f32x4_set1(f32 a) {
+	f32x4 result = vdupq_n_f32(a);
+	return(result);
+}
+
+function f32x4
+f32x4_zero(void) {
+	f32x4 result = vdupq_n_f32(0.0f);
+	return(result);
+}
+
+function f32x4
+f32x4_load(f32 *src) {
+	f32x4 result = vld1q_f32(src);
+	return(result);
+}
+
+function void
+f32x4_store(f32 *dst, f32x4 a) {
+	vst1q_f32(dst, a);
+}
+
+function f32
+f32x4_first(f32x4 a) {
+	f32 result = vgetq_lane_f32(a, 0);
+	return(result);
+}
+
+function f32x4
+f32x4_add(f32x4 a, f32x4 b) {
+	f32x4 result = vaddq_f32(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_sub(f32x4 a, f32x4 b) {
+	f32x4 result = vsubq_f32(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_mul(f32x4 a, f32x4 b) {
+	f32x4 result = vmulq_f32(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_div(f32x4 a, f32x4 b) {
+	f32x4 result = vdivq_f32(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_madd(f32x4 a, f32x4 b, f32x4 c) {
+	f32x4 result = vfmaq_f32(c, a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_min(f32x4 a, f32x4 b) {
+	f32x4 result = vminq_f32(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_max(f32x4 a, f32x4 b) {
+	f32x4 result = vmaxq_f32(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_sqrt(f32x4 a) {
+	f32x4 result = vsqrtq_f32(a);
+	return(result);
+}
+
+function f32x4
+f32x4_cmp_lt(f32x4 a, f32x4 b) {
+	f32x4 result = vreinterpretq_f32_u32(vcltq_f32(a, b));
+	return(result);
+}
+
+function f32x4
+f32x4_cmp_le(f32x4 a, f32x4 b) {
+	f32x4 result = vreinterpretq_f32_u32(vcleq_f32(a, b));
+	return(result);
+}
+
+function f32x4
+f32x4_and(f32x4 a, f32x4 b) {
+	f32x4 result = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+	return(result);
+}
+
+function f32x4
+f32x4_or(f32x4 a, f32x4 b) {
+	f32x4 result = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+	return(result);
+}
+
+function f32x4
+f32x4_select(f32x4 mask, f32x4 when_true, f32x4 when_false) {
+	f32x4 result = vbslq_f32(vreinterpretq_u32_f32(mask), when_true, when_false);
+	return(result);
+}
+
+function u32
+f32x4_mask(f32x4 mask) {
+	u32 e[4];
+	vst1q_u32(e, vshrq_n_u32(vreinterpretq_u32_f32(mask), 31));
+	u32 result = e[0] | (e[1] << 1) | (e[2] << 2) | (e[3] << 3);
+	return(result);
+}
+
+function f32x4
+f32x4_unpack_lo(f32x4 a, f32x4 b) {
+	f32x4 result = vzip1q_f32(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_unpack_hi(f32x4 a, f32x4 b) {
+	f32x4 result = vzip2q_f32(a, b);
+	return(result);
+}
+
+function f32x4
+f32x4_move_lh(f32x4 a, f32x4 b) {
+	f32x4 result = vcombine_f32(vget_low_f32(a), vget_low_f32(b));
+	return(result);
+}
+
+function f32x4
+f32x4_move_hl(f32x4 a, f32x4 b) {
+	f32x4 result = vcombine_f32(vget_high_f32(b), vget_high_f32(a));
+	return(result);
+}
+
+#else
+
+function f32x4
+f32x4_set(f32 x, f32 y, f32 z, f32 w) {
+	f32x4 result;
+	result.e[0] = x;
+	result.e[1] = y;
+	result.e[2] = z;
+	result.e[3] = w;
+	return(result);
+}
+
+function f32x4
+f32x4_set1(f32 a) {
+	f32x4 result = f32x4_set(a, a, a, a);
+	return(result);
+}
+
+function f32x4
+f32x4_zero(void) {
+	f32x4 result = f32x4_set(0.0f, 0.0f, 0.0f, 0.0f);
+	return(result);
+}
+
+function f32x4
+f32x4_load(f32 *src) {
+	f32x4 result = f32x4_set(src[0], src[1], src[2], src[3]);
+	return(result);
+}
+
+function void
+f32x4_store(f32 *dst, f32x4 a) {
+	dst[0] = a.e[0];
+	dst[1] = a.e[1];
+	dst[2] = a.e[2];
+	dst[3] = a.e[3];
+}
+
+function f32
+f32x4_first(f32x4 a) {
+	return(a.e[0]);
+}
+
+#define f32x4_lanewise(expr) \
+	f32x4 result;\
+	for (u32 lane = 0; lane < 4; ++lane) {\
+		result.e[lane] = (expr);\
+	}\
+	return(result)
+
+function f32x4 f32x4_add(f32x4 a, f32x4 b) { f32x4_lanewise(a.e[lane] + b.e[lane]); }
+function f32x4 f32x4_sub(f32x4 a, f32x4 b) { f32x4_lanewise(a.e[lane] - b.e[lane]); }
+function f32x4 f32x4_mul(f32x4 a, f32x4 b) { f32x4_lanewise(a.e[lane] * b.e[lane]); }
+function f32x4 f32x4_div(f32x4 a, f32x4 b) { f32x4_lanewise(a.e[lane] / b.e[lane]); }
+function f32x4 f32x4_madd(f32x4 a, f32x4 b, f32x4 c) { f32x4_lanewise(a.e[lane] * b.e[lane] + c.e[lane]); }
+function f32x4 f32x4_min(f32x4 a, f32x4 b) { f32x4_lanewise(a.e[lane] < b.e[lane] ? a.e[lane] : b.e[lane]); }
+function f32x4 f32x4_max(f32x4 a, f32x4 b) { f32x4_lanewise(a.e[lane] > b.e[lane] ? a.e[lane] : b.e[lane]); }
+function f32x4 f32x4_sqrt(f32x4 a) { f32x4_lanewise(sqrtf(a.e[lane])); }
+
+function f32
+f32_from_bits(u32 bits) {
+	f32 result;
+	memory_copy(&result, &bits, sizeof(result));
+	return(result);
+}
+
+function u32
+f32_to_bits(f32 a) {
+	u32 result;
+	memory_copy(&result, &a, sizeof(result));
+	return(result);
+}
+
+function f32x4 f32x4_cmp_lt(f32x4 a, f32x4 b) { f32x4_lanewise(f32_from_bits(a.e[lane] < b.e[lane] ? 0xffffffff : 0)); }
+function f32x4 f32x4_cmp_le(f32x4 a, f32x4 b) { f32x4_lanewise(f32_from_bits(a.e[lane] <= b.e[lane] ? 0xffffffff : 0)); }
+function f32x4 f32x4_and(f32x4 a, f32x4 b) { f32x4_lanewise(f32_from_bits(f32_to_bits(a.e[lane]) & f32_to_bits(b.e[lane]))); }
+function f32x4 f32x4_or(f32x4 a, f32x4 b) { f32x4_lanewise(f32_from_bits(f32_to_bits(a.e[lane]) | f32_to_bits(b.e[lane]))); }
+function f32x4 f32x4_select(f32x4 mask, f32x4 when_true, f32x4 when_false) {
+	f32x4_lanewise(f32_to_bits(mask.e[lane]) ? when_true.e[lane] : when_false.e[lane]);
+}
+
+function u32
+f32x4_mask(f32x4 mask) {
+	u32 result = 0;
+	for (u32 lane = 0; lane < 4; ++lane) {
+		result |= (f32_to_bits(mask.e[lane]) >> 31) << lane;
+	}
+	return(result);
+}
+
+function f32x4
+f32x4_unpack_lo(f32x4 a, f32x4 b) {
+	f32x4 result = f32x4_set(a.e[0], b.e[0], a.e[1], b.e[1]);
+	return(result);
+}
+
+function f32x4
+f32x4_unpack_hi(f32x4 a, f32x4 b) {
+	f32x4 result = f32x4_set(a.e[2], b.e[2], a.e[3], b.e[3]);
+	return(result);
+}
+
+function f32x4
+f32x4_move_lh(f32x4 a, f32x4 b) {
+	f32x4 result = f32x4_set(a.e[0], a.e[1], b.e[0], b.e[1]);
+	return(result);
+}
+
+function f32x4
+f32x4_move_hl(f32x4 a, f32x4 b) {
+	f32x4 result = f32x4_set(b.e[2], b.e[3], a.e[2], a.e[3]);
+	return(result);
+}
+
+#undef f32x4_lanewise
+
+#endif
+
+function f32x4
+f32x4_swizzle_(f32x4 a, u32 i0, u32 i1, u32 i2, u32 i3) {
+	f32 e[4];
+	f32x4_store(e, a);
+	f32x4 result = f32x4_set(e[i0], e[i1], e[i2], e[i3]);
+	return(result);
+}
+
+function f32x4
+f32x4_shuffle_(f32x4 a, f32x4 b, u32 i0, u32 i1, u32 i2, u32 i3) {
+	f32 ea[4], eb[4];
+	f32x4_store(ea, a);
+	f32x4_store(eb, b);
+	f32x4 result = f32x4_set(ea[i0], ea[i1], eb[i2], eb[i3]);
+	return(result);
+}
+
+function f32x4
+f32x4_hsum(f32x4 a) {
+	f32x4 pairs = f32x4_add(a, f32x4_swizzle(a, 2, 3, 0, 1));
+	f32x4 result = f32x4_add(pairs, f32x4_swizzle(pairs, 1, 0, 3, 2));
+	return(result);
+}
@@ -0,0 +1,97 @@
+#if !defined(S_SIMD_H)
+#define S_SIMD_H
+
+// The lane backend is picked at compile time. SSE2 is always there on x64 (MSVC and GCC/Clang),
+// AVX2 only adds FMA to the 4-wide ops, and NEON is used on ARM64.
+// Define S_SIMD_SCALAR to force the plain C reference path on any target.
+#if !defined(S_SIMD_SCALAR)
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define S_SIMD_SSE 1
+#include <immintrin.h>
+#if defined(__AVX2__) || defined(__FMA__)
+#define S_SIMD_FMA 1
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define S_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(S_SIMD_SSE) || defined(S_SIMD_NEON)
+#define S_SIMD_ANY 1
+#endif
+
+#if defined(S_SIMD_SSE)
+typedef __m128 f32x4;
+#elif defined(S_SIMD_NEON)
+typedef float32x4_t f32x4;
+#else
+typedef struct {
+	f32 e[4];
+} f32x4;
+#endif
+
+function f32x4 f32x4_set(f32 x, f32 y, f32 z, f32 w);
+function f32x4 f32x4_set1(f32 a);
+function f32x4 f32x4_zero(void);
+function f32x4 f32x4_load(f32 *src);
+function void f32x4_store(f32 *dst, f32x4 a);
+function f32 f32x4_first(f32x4 a);
+
+function f32x4 f32x4_add(f32x4 a, f32x4 b);
+function f32x4 f32x4_sub(f32x4 a, f32x4 b);
+function f32x4 f32x4_mul(f32x4 a, f32x4 b);
+function f32x4 f32x4_div(f32x4 a, f32x4 b);
+// a * b + c
+function f32x4 f32x4_madd(f32x4 a, f32x4 b, f32x4 c);
+function f32x4 f32x4_min(f32x4 a, f32x4 b);
+function f32x4 f32x4_max(f32x4 a, f32x4 b);
+function f32x4 f32x4_sqrt(f32x4 a);
+
+// Comparisons yield all-ones / all-zero lanes, consumed by f32x4_select and f32x4_mask.
+function f32x4 f32x4_cmp_lt(f32x4 a, f32x4 b);
+function f32x4 f32x4_cmp_le(f32x4 a, f32x4 b);
+function f32x4 f32x4_and(f32x4 a, f32x4 b);
+function f32x4 f32x4_or(f32x4 a, f32x4 b);
+function f32x4 f32x4_select(f32x4 mask, f32x4 when_true, f32x4 when_false);
+// one bit per lane, lane 0 in bit 0
+function u32 f32x4_mask(f32x4 mask);
+
+// broadcasts the sum of all four lanes
+function f32x4 f32x4_hsum(f32x4 a);
+
+// (a0, b0, a1, b1) / (a2, b2, a3, b3)
+function f32x4 f32x4_unpack_lo(f32x4 a, f32x4 b);
+function f32x4 f32x4_unpack_hi(f32x4 a, f32x4 b);
+// (a0, a1, b0, b1) / (b2, b3, a2, a3)
+function f32x4 f32x4_move_lh(f32x4 a, f32x4 b);
+function f32x4 f32x4_move_hl(f32x4 a, f32x4 b);
+// (a[i0], a[i1], a[i2], a[i3])
+function f32x4 f32x4_swizzle_(f32x4 a, u32 i0, u32 i1, u32 i2, u32 i3);
+// (a[i0], a[i1], b[i2], b[i3])
+function f32x4 f32x4_shuffle_(f32x4 a, f32x4 b, u32 i0, u32 i1, u32 i2, u32 i3);
+
+// Swizzle indices must be compile-time constants.
+#if defined(S_SIMD_SSE)
+#define f32x4_swizzle(a,i0,i1,i2,i3) _mm_shuffle_ps((a), (a), _MM_SHUFFLE(i3,i2,i1,i0))
+#define f32x4_shuffle(a,b,i0,i1,i2,i3) _mm_shuffle_ps((a), (b), _MM_SHUFFLE(i3,i2,i1,i0))
+#else
+#define f32x4_swizzle(a,i0,i1,i2,i3) f32x4_swizzle_(a,i0,i1,i2,i3)
+#define f32x4_shuffle(a,b,i0,i1,i2,i3) f32x4_shuffle_(a,b,i0,i1,i2,i3)
+#endif
+// a[i] in every lane
+#define f32x4_splat(a,i) f32x4_swizzle(a,i,i,i,i)
+
+// Rows in, columns out.
+#define f32x4_transpose(r0,r1,r2,r3) do {\
+		f32x4 _t0 = f32x4_unpack_lo((r0),(r1));\
+		f32x4 _t1 = f32x4_unpack_lo((r2),(r3));\
+		f32x4 _t2 = f32x4_unpack_hi((r0),(r1));\
+		f32x4 _t3 = f32x4_unpack_hi((r2),(r3));\
+		(r0) = f32x4_move_lh(_t0,_t1);\
+		(r1) = f32x4_move_hl(_t1,_t0);\
+		(r2) = f32x4_move_lh(_t2,_t3);\
+		(r3) = f32x4_move_hl(_t3,_t2);\
+	} while (0)
+
+#endif
@@ -0,0 +1,623 @@
+typedef struct {
+    v4f clip;
+    v3f pos_world;
+    v3f normal;
+} Soft_Vertex;
+
+typedef struct {
+    // 8 bit subpixel fixed point, y down
+    s64 x[3];
+    s64 y[3];
+    // twice the signed area in the same units, > 0 for front faces
+    s64 area;
+    f32 z[3];
+    f32 inv_w[3];
+    v3f pos_world[3];
+    v3f normal[3];
+    v4f colour;
+    // pixel bounds clamped to the target, max exclusive
+    s32 min_x;
+    s32 min_y;
+    s32 max_x;
+    s32 max_y;
+} Soft_Triangle;
+
+typedef struct {
+    Soft_Renderer *renderer;
+    Soft_Target *target;
+    Soft_Draw *draws;
+    // draws[d]'s instances are [draw_first[d], draw_first[d + 1]) of all of them
+    u64 *draw_first;
+    R3D_Buffer *instances;
+    D3D11_Constants *constants;
+    Light_Clusters *clusters;
+    // as the GPU gets them, but with cluster_x_scale and cluster_y_scale for this target
+    Light_Constants light_constants;
+
+    u32 tiles_x;
+    u32 tiles_y;
+    u32 tile_count;
+
+    // per chunk of soft_instances_per_job instances
+    Soft_Triangle **chunk_triangles;
+    u64 *chunk_triangle_count;
+    // [chunk * tile_count + tile]: triangle counts after set up, then write cursors into bins
+    u32 *chunk_tile_cursor;
+
+    // bins[tile_first[t], tile_first[t + 1]) is tile t's triangles in submission order
+    u32 *tile_first;
+    Soft_Triangle **bins;
+} Soft_Frame;
+
+function void
+soft_init(Soft_Renderer *renderer, u32 worker_count) {
+    renderer->worker_count = worker_count;
+    renderer->arena = arena_reserve(kilobytes(64));
+    renderer->triangle_arenas = arena_push_array(&renderer->arena, Arena, worker_count);
+    for (u32 index = 0; index < worker_count; ++index) {
+        renderer->triangle_arenas[index] = arena_reserve(gigabytes(4));
+    }
+}
+
+function void
+soft_release(Soft_Renderer *renderer) {
+    for (u32 index = 0; index < renderer->worker_count; ++index) {
+        arena_release(renderer->triangle_arenas + index);
+    }
+    arena_release(&renderer->arena);
+}
+
+function u32
+soft_pack_colour(f32 r, f32 g, f32 b, f32 a) {
+    // UNORM conversion: saturate, then round to nearest
+    f32 c[4] = { r, g, b, a };
+    u32 result = 0;
+    for (u32 index = 0; index < 4; ++index) {
+        f32 v = c[index] < 0.0f ? 0.0f : (c[index] > 1.0f ? 1.0f : c[index]);
+        result |= ((u32)(v * 255.0f + 0.5f)) << (index * 8);
+    }
+    return(result);
+}
+
+function void
+soft_target_clear(Soft_Target *target, v4f colour, f32 depth) {
+    u32 packed = soft_pack_colour(colour.r, colour.g, colour.b, colour.a);
+    u64 count = (u64)target->width * target->height;
+    for (u64 index = 0; index < count; ++index) {
+        target->colour[index] = packed;
+        target->depth[index] = depth;
+    }
+}
+
+// Inside when >= 0. Plane 0 is D3D's near plane, the rest are the guard band.
+function f32
+soft_clip_distance(v4f clip, u32 plane) {
+    f32 result = 0.0f;
+    switch (plane) {
+        case 0: result = clip.z; break;
+        case 1: result = soft_guard_band * clip.w - clip.x; break;
+        case 2: result = soft_guard_band * clip.w + clip.x; break;
+        case 3: result = soft_guard_band * clip.w - clip.y; break;
+        case 4: result = soft_guard_band * clip.w + clip.y; break;
+    }
+    return(result);
+}
+
+function Soft_Vertex
+soft_lerp_vertex(Soft_Vertex *a, Soft_Vertex *b, f32 t) {
+    Soft_Vertex result;
+    result.clip = v4f_add(a->clip, v4f_scale(v4f_sub(b->clip, a->clip), t));
+    result.pos_world = v3f_add(a->pos_world, v3f_scale(v3f_sub(b->pos_world, a->pos_world), t));
+    result.normal = v3f_add(a->normal, v3f_scale(v3f_sub(b->normal, a->normal), t));
+    return(result);
+}
+
+// Sutherland-Hodgman against every plane. Each plane adds at most one vertex, so 3 + 5 fit in 8.
+function u32
+soft_clip_triangle(Soft_Vertex *polygon, Soft_Vertex *scratch) {
+    u32 count = 3;
+    Soft_Vertex *in = polygon;
+    Soft_Vertex *out = scratch;
+    for (u32 plane = 0; (plane < 5) && count; ++plane) {
+        u32 out_count = 0;
+        for (u32 index = 0; index < count; ++index) {
+            Soft_Vertex *a = in + index;
+            Soft_Vertex *b = in + ((index + 1) % count);
+            f32 da = soft_clip_distance(a->clip, plane);
+            f32 db = soft_clip_distance(b->clip, plane);
+            if (da >= 0.0f) {
+                out[out_count++] = *a;
+            }
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                out[out_count++] = soft_lerp_vertex(a, b, da / (da - db));
+            }
+        }
+
+        Soft_Vertex *swap = in;
+        in = out;
+        out = swap;
+        count = out_count;
+    }
+
+    if (in != polygon) {
+        for (u32 index = 0; index < count; ++index) {
+            polygon[index] = in[index];
+        }
+    }
+    return(count);
+}
+
+// Viewport transform and the back face test. False when nothing is left to draw.
+function b32
+soft_setup_triangle(Soft_Triangle *triangle, Soft_Target *target, Soft_Vertex *a, Soft_Vertex *b, Soft_Vertex *c, v4f colour) {
+    Soft_Vertex *v[3] = { a, b, c };
+    for (u32 index = 0; index < 3; ++index) {
+        f32 inv_w = 1.0f / v[index]->clip.w;
+        f32 screen_x = (v[index]->clip.x * inv_w * 0.5f + 0.5f) * (f32)target->width;
+        f32 screen_y = (0.5f - v[index]->clip.y * inv_w * 0.5f) * (f32)target->height;
+        triangle->x[index] = (s64)floorf(screen_x * 256.0f + 0.5f);
+        triangle->y[index] = (s64)floorf(screen_y * 256.0f + 0.5f);
+        triangle->z[index] = v[index]->clip.z * inv_w;
+        triangle->inv_w[index] = inv_w;
+        triangle->pos_world[index] = v[index]->pos_world;
+        triangle->normal[index] = v[index]->normal;
+    }
+    triangle->colour = colour;
+
+    // clockwise on screen (y down) is front facing, as with FrontCounterClockwise = FALSE
+    triangle->area = (triangle->x[1] - triangle->x[0]) * (triangle->y[2] - triangle->y[0]) -
+        (triangle->y[1] - triangle->y[0]) * (triangle->x[2] - triangle->x[0]);
+    if (triangle->area <= 0) {
+        return(False);
+    }
+
+    s64 min_x = triangle->x[0], max_x = triangle->x[0];
+    s64 min_y = triangle->y[0], max_y = triangle->y[0];
+    for (u32 index = 1; index < 3; ++index) {
+        min_x = triangle->x[index] < min_x ? triangle->x[index] : min_x;
+        max_x = triangle->x[index] > max_x ? triangle->x[index] : max_x;
+        min_y = triangle->y[index] < min_y ? triangle->y[index] : min_y;
+        max_y = triangle->y[index] > max_y ? triangle->y[index] : max_y;
+    }
+
+    s64 px0 = min_x >> 8;
+    s64 py0 = min_y >> 8;
+    s64 px1 = (max_x >> 8) + 1;
+    s64 py1 = (max_y >> 8) + 1;
+    triangle->min_x = (s32)(px0 < 0 ? 0 : px0);
+    triangle->min_y = (s32)(py0 < 0 ? 0 : py0);
+    triangle->max_x = (s32)(px1 > target->width ? target->width : px1);
+    triangle->max_y = (s32)(py1 > target->height ? target->height : py1);
+
+    b32 result = (triangle->min_x < triangle->max_x) && (triangle->min_y < triangle->max_y);
+    return(result);
+}
+
+// vs_main for a chunk of instances, then clipping, set up and counting tile coverage.
+function void
+soft_setup_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    profile_begin("soft setup");
+    Soft_Frame *frame = (Soft_Frame *)data;
+    Arena *arena = frame->renderer->triangle_arenas + worker_index;
+    u64 chunk = begin / soft_instances_per_job;
+    u32 *tile_counts = frame->chunk_tile_cursor + chunk * frame->tile_count;
+    m44 view_projection = frame->constants->view_projection;
+
+    Soft_Triangle *first = null;
+    u64 triangle_count = 0;
+    u32 draw = 0;
+    for (u64 visible_index = begin; visible_index < end; ++visible_index) {
+        while (visible_index >= frame->draw_first[draw + 1]) {
+            ++draw;
+        }
+        Mesh *mesh = frame->draws[draw].mesh;
+        u32 instance_index = frame->draws[draw].visible[visible_index - frame->draw_first[draw]];
+        Model_Instance source = r3d_get_instance(frame->instances, instance_index);
+        R3D_Packed_Instance packed = r3d_pack_instance(&source);
+        Model_Instance instance = r3d_unpack_instance(&packed);
+
+        for (u32 index = 0; index + 3 <= mesh->index_count; index += 3) {
+            Soft_Vertex polygon[8];
+            Soft_Vertex scratch[8];
+            for (u32 corner = 0; corner < 3; ++corner) {
+                Mesh_Vertex *src = mesh->vertices + mesh->indices[index + corner];
+                v3f local_p = src->p;
+                v3f local_n = src->normal;
+
+                v3f world = quat_rot_v3f(instance.orient, local_p);
+                world = v3f_make(world.x * instance.scale.x, world.y * instance.scale.y, world.z * instance.scale.z);
+                world = v3f_add(world, instance.position);
+
+                v3f normal = quat_rot_v3f(instance.orient, local_n);
+                normal = v3f_make(normal.x * instance.scale.x, normal.y * instance.scale.y, normal.z * instance.scale.z);
+                v3f_norm(&normal);
+
+                polygon[corner].clip = m44_mul_v4f(view_projection, v4f_make(world.x, world.y, world.z, 1.0f));
+                polygon[corner].pos_world = world;
+                polygon[corner].normal = normal;
+            }
+
+            u32 count = soft_clip_triangle(polygon, scratch);
+            for (u32 fan = 1; fan + 1 < count; ++fan) {
+                Soft_Triangle triangle;
+                if (!soft_setup_triangle(&triangle, frame->target, polygon, polygon + fan, polygon + fan + 1,
+                                         instance.colour)) {
+                    continue;
+                }
+
+                Soft_Triangle *stored = (Soft_Triangle *)arena_push(arena, sizeof(Soft_Triangle), 8);
+                if (!stored) {
+                    os_fatal_error(str8("Software rasterizer ran out of triangle memory"));
+                }
+                *stored = triangle;
+                if (!first) {
+                    first = stored;
+                }
+                ++triangle_count;
+
+                u32 tx0 = (u32)triangle.min_x / soft_tile_size;
+                u32 tx1 = (u32)(triangle.max_x - 1) / soft_tile_size;
+                u32 ty0 = (u32)triangle.min_y / soft_tile_size;
+                u32 ty1 = (u32)(triangle.max_y - 1) / soft_tile_size;
+                for (u32 ty = ty0; ty <= ty1; ++ty) {
+                    for (u32 tx = tx0; tx <= tx1; ++tx) {
+                        ++tile_counts[ty * frame->tiles_x + tx];
+                    }
+                }
+            }
+        }
+    }
+
+    frame->chunk_triangles[chunk] = first;
+    frame->chunk_triangle_count[chunk] = triangle_count;
+    profile_end();
+}
+
+function void
+soft_bin_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(end);
+    unused(worker_index);
+    Soft_Frame *frame = (Soft_Frame *)data;
+    u64 chunk = begin / soft_instances_per_job;
+    u32 *cursor = frame->chunk_tile_cursor + chunk * frame->tile_count;
+    profile_begin("soft bin");
+
+    Soft_Triangle *triangles = frame->chunk_triangles[chunk];
+    for (u64 index = 0; index < frame->chunk_triangle_count[chunk]; ++index) {
+        Soft_Triangle *triangle = triangles + index;
+        u32 tx0 = (u32)triangle->min_x / soft_tile_size;
+        u32 tx1 = (u32)(triangle->max_x - 1) / soft_tile_size;
+        u32 ty0 = (u32)triangle->min_y / soft_tile_size;
+        u32 ty1 = (u32)(triangle->max_y - 1) / soft_tile_size;
+        for (u32 ty = ty0; ty <= ty1; ++ty) {
+            for (u32 tx = tx0; tx <= tx1; ++tx) {
+                frame->bins[cursor[ty * frame->tiles_x + tx]++] = triangle;
+            }
+        }
+    }
+    profile_end();
+}
+
+function f32x4
+soft_pow_x4(f32x4 a, f32 e) {
+    f32 lanes[4];
+    f32x4_store(lanes, a);
+    for (u32 lane = 0; lane < 4; ++lane) {
+        lanes[lane] = powf(lanes[lane], e);
+    }
+    return f32x4_load(lanes);
+}
+
+function f32x4
+soft_saturate_x4(f32x4 a) {
+    f32x4 result = f32x4_min(f32x4_max(a, f32x4_zero()), f32x4_set1(1.0f));
+    return(result);
+}
+
+// One light's term of ps_test_shading_model for four pixels, added into shaded. Lanes outside
+// mask add zero, which leaves them as they were since shaded is already saturated.
+function void
+soft_shade_light_x4(Light_Packed *light, v3f_x4 pos_world, v3f_x4 normal, f32x4 mask, f32x4 *lit, f32x4 *shaded) {
+    f32x4 zero = f32x4_zero();
+    f32x4 one = f32x4_set1(1.0f);
+    f32x4 contribution;
+    if (light->type == LightType_Directional) {
+        f32x4 cosine = f32x4_mul(f32x4_set1(-light->direction.x), normal.x);
+        cosine = f32x4_madd(f32x4_set1(-light->direction.y), normal.y, cosine);
+        cosine = f32x4_madd(f32x4_set1(-light->direction.z), normal.z, cosine);
+        contribution = f32x4_max(cosine, zero);
+    } else {
+        f32x4 to_x = f32x4_sub(f32x4_set1(light->p.x), pos_world.x);
+        f32x4 to_y = f32x4_sub(f32x4_set1(light->p.y), pos_world.y);
+        f32x4 to_z = f32x4_sub(f32x4_set1(light->p.z), pos_world.z);
+        f32x4 distance_sq = f32x4_madd(to_x, to_x, f32x4_madd(to_y, to_y, f32x4_mul(to_z, to_z)));
+        f32x4 inv_distance = f32x4_div(one, f32x4_sqrt(distance_sq));
+        to_x = f32x4_mul(to_x, inv_distance);
+        to_y = f32x4_mul(to_y, inv_distance);
+        to_z = f32x4_mul(to_z, inv_distance);
+
+        // windowing, then CryEngine's attenuation, see Light_Packed
+        f32x4 window = f32x4_mul(distance_sq, distance_sq);
+        window = soft_saturate_x4(f32x4_sub(one, f32x4_mul(window, f32x4_set1(light->inv_max_distance4))));
+        window = f32x4_mul(window, window);
+        f32x4 falloff = f32x4_min(f32x4_mul(inv_distance, inv_distance), f32x4_set1(light->inv_min_distance_sq));
+        f32x4 attenuation = f32x4_mul(f32x4_mul(f32x4_set1(light->reference_distance_sq), falloff), window);
+
+        f32x4 cosine = f32x4_mul(to_x, normal.x);
+        cosine = f32x4_madd(to_y, normal.y, cosine);
+        cosine = f32x4_madd(to_z, normal.z, cosine);
+        contribution = f32x4_mul(f32x4_max(cosine, zero), attenuation);
+
+        if (light->type != LightType_Point) {
+            f32x4 c = f32x4_mul(f32x4_set1(-light->direction.x), to_x);
+            c = f32x4_madd(f32x4_set1(-light->direction.y), to_y, c);
+            c = f32x4_madd(f32x4_set1(-light->direction.z), to_z, c);
+            f32x4 t = soft_saturate_x4(f32x4_madd(c, f32x4_set1(light->spot_scale), f32x4_set1(light->spot_offset)));
+            f32x4 spot = f32x4_mul(f32x4_mul(t, t), f32x4_sub(f32x4_set1(3.0f), f32x4_add(t, t)));
+            contribution = f32x4_mul(contribution, spot);
+        }
+    }
+    contribution = f32x4_and(contribution, mask);
+
+    for (u32 c = 0; c < 3; ++c) {
+        f32x4 light_colour = f32x4_set1(light->colour.v[c]);
+        shaded[c] = soft_saturate_x4(f32x4_madd(f32x4_mul(contribution, light_colour), lit[c], shaded[c]));
+    }
+}
+
+// ps_test_shading_model for the lanes in lane_mask, each walking its own cluster's list after the
+// directional lights. Returns the colour before gamma, per channel.
+function void
+soft_shade_x4(Soft_Frame *frame, v4f colour, v3f_x4 pos_world, v3f_x4 normal, u32 *cluster, u32 lane_mask, f32x4 *out) {
+    Light_Clusters *clusters = frame->clusters;
+    f32x4 zero = f32x4_zero();
+    f32x4 lit[3];
+    f32x4 shaded[3];
+    for (u32 c = 0; c < 3; ++c) {
+        lit[c] = f32x4_set1(colour.v[c]);
+        shaded[c] = zero;
+    }
+
+    f32x4 all_lanes = f32x4_cmp_le(zero, zero);
+    for (u32 index = 0; index < clusters->directional_count; ++index) {
+        soft_shade_light_x4(clusters->packed + clusters->indices[index], pos_world, normal, all_lanes, lit, shaded);
+    }
+
+    u32 remaining = lane_mask;
+    while (remaining) {
+        u32 first = 0;
+        while (!(remaining & (1u << first))) {
+            ++first;
+        }
+
+        // every lane in the same cluster walks the list together
+        u32 cluster_index = cluster[first];
+        f32 group[4];
+        for (u32 lane = 0; lane < 4; ++lane) {
+            b32 in_group = (remaining & (1u << lane)) && (cluster[lane] == cluster_index);
+            group[lane] = in_group ? 1.0f : 0.0f;
+            remaining &= in_group ? ~(1u << lane) : ~0u;
+        }
+        f32x4 mask = f32x4_cmp_lt(zero, f32x4_load(group));
+
+        Light_Cluster *range = clusters->clusters + cluster_index;
+        for (u32 index = range->offset; index < range->offset + range->count; ++index) {
+            soft_shade_light_x4(clusters->packed + clusters->indices[index], pos_world, normal, mask, lit, shaded);
+        }
+    }
+
+    for (u32 c = 0; c < 3; ++c) {
+        out[c] = soft_pow_x4(f32x4_madd(f32x4_set1(0.05f), lit[c], shaded[c]), 2.2f);
+    }
+}
+
+function void
+soft_raster_job(void *data, u64 begin, u64 end, u32 worker_index) {
+    unused(worker_index);
+    Soft_Frame *frame = (Soft_Frame *)data;
+    Soft_Target *target = frame->target;
+    profile_begin("soft raster");
+
+    for (u64 tile = begin; tile < end; ++tile) {
+        s32 tile_x0 = (s32)((tile % frame->tiles_x) * soft_tile_size);
+        s32 tile_y0 = (s32)((tile / frame->tiles_x) * soft_tile_size);
+        s32 tile_x1 = tile_x0 + soft_tile_size;
+        s32 tile_y1 = tile_y0 + soft_tile_size;
+        tile_x1 = tile_x1 > (s32)target->width ? (s32)target->width : tile_x1;
+        tile_y1 = tile_y1 > (s32)target->height ? (s32)target->height : tile_y1;
+
+        for (u32 bin = frame->tile_first[tile]; bin < frame->tile_first[tile + 1]; ++bin) {
+            Soft_Triangle *triangle = frame->bins[bin];
+            s32 x0 = triangle->min_x > tile_x0 ? triangle->min_x : tile_x0;
+            s32 y0 = triangle->min_y > tile_y0 ? triangle->min_y : tile_y0;
+            s32 x1 = triangle->max_x < tile_x1 ? triangle->max_x : tile_x1;
+            s32 y1 = triangle->max_y < tile_y1 ? triangle->max_y : tile_y1;
+            x0 &= ~3;
+
+            // Edge i is opposite vertex i. Top-left rule: pixels exactly on an edge belong to
+            // the triangle only for top edges (flat, going right) and left edges (going up).
+            s64 edge_dx[3], edge_dy[3], edge_x[3], edge_y[3], bias[3];
+            for (u32 i = 0; i < 3; ++i) {
+                u32 a = (i + 1) % 3;
+                u32 b = (i + 2) % 3;
+                edge_dx[i] = triangle->x[b] - triangle->x[a];
+                edge_dy[i] = triangle->y[b] - triangle->y[a];
+                edge_x[i] = triangle->x[a];
+                edge_y[i] = triangle->y[a];
+                b32 top_left = ((edge_dy[i] == 0) && (edge_dx[i] > 0)) || (edge_dy[i] < 0);
+                bias[i] = top_left ? 0 : -1;
+            }
+
+            // edge values at the first pixel centre of the first row, stepped from there
+            s64 row_edge[3], step_x[3], step_y[3];
+            for (u32 i = 0; i < 3; ++i) {
+                s64 sample_x = ((s64)x0 << 8) + 128;
+                s64 sample_y = ((s64)y0 << 8) + 128;
+                row_edge[i] = edge_dx[i] * (sample_y - edge_y[i]) - edge_dy[i] * (sample_x - edge_x[i]);
+                step_x[i] = -edge_dy[i] * 256;
+                step_y[i] = edge_dx[i] * 256;
+            }
+
+            f32x4 inv_area = f32x4_set1(1.0f / (f32)triangle->area);
+            for (s32 y = y0; y < y1; ++y) {
+                s64 edge[3] = { row_edge[0], row_edge[1], row_edge[2] };
+                for (s32 x = x0; x < x1; x += 4) {
+                    f32 weight[3][4];
+                    f32 covered[4];
+                    u32 coverage = 0;
+                    for (u32 lane = 0; lane < 4; ++lane) {
+                        b32 inside = ((x + (s32)lane) >= tile_x0) && ((x + (s32)lane) < x1);
+                        for (u32 i = 0; i < 3; ++i) {
+                            s64 e = edge[i] + step_x[i] * lane;
+                            inside = inside && (e + bias[i] >= 0);
+                            weight[i][lane] = (f32)e;
+                        }
+                        covered[lane] = inside ? 1.0f : 0.0f;
+                        coverage |= inside << lane;
+                    }
+                    for (u32 i = 0; i < 3; ++i) {
+                        edge[i] += step_x[i] * 4;
+                    }
+                    if (!coverage) {
+                        continue;
+                    }
+
+                    f32x4 b0 = f32x4_mul(f32x4_load(weight[0]), inv_area);
+                    f32x4 b1 = f32x4_mul(f32x4_load(weight[1]), inv_area);
+                    f32x4 b2 = f32x4_mul(f32x4_load(weight[2]), inv_area);
+
+                    u64 pixel = (u64)y * target->width + (u64)x;
+                    f32x4 z = f32x4_mul(b0, f32x4_set1(triangle->z[0]));
+                    z = f32x4_madd(b1, f32x4_set1(triangle->z[1]), z);
+                    z = f32x4_madd(b2, f32x4_set1(triangle->z[2]), z);
+                    f32x4 old_z = f32x4_load(target->depth + pixel);
+                    f32x4 pass = f32x4_and(f32x4_cmp_lt(z, old_z), f32x4_cmp_lt(f32x4_zero(), f32x4_load(covered)));
+                    u32 pass_mask = f32x4_mask(pass);
+                    if (!pass_mask) {
+                        continue;
+                    }
+                    f32x4_store(target->depth + pixel, f32x4_select(pass, z, old_z));
+
+                    // perspective correct attributes
+                    f32x4 w0 = f32x4_mul(b0, f32x4_set1(triangle->inv_w[0]));
+                    f32x4 w1 = f32x4_mul(b1, f32x4_set1(triangle->inv_w[1]));
+                    f32x4 w2 = f32x4_mul(b2, f32x4_set1(triangle->inv_w[2]));
+                    f32x4 inv_sum = f32x4_div(f32x4_set1(1.0f), f32x4_add(w0, f32x4_add(w1, w2)));
+                    w0 = f32x4_mul(w0, inv_sum);
+                    w1 = f32x4_mul(w1, inv_sum);
+                    w2 = f32x4_mul(w2, inv_sum);
+
+                    f32x4 attribute[6];
+                    for (u32 c = 0; c < 3; ++c) {
+                        attribute[c] = f32x4_mul(w0, f32x4_set1(triangle->pos_world[0].v[c]));
+                        attribute[c] = f32x4_madd(w1, f32x4_set1(triangle->pos_world[1].v[c]), attribute[c]);
+                        attribute[c] = f32x4_madd(w2, f32x4_set1(triangle->pos_world[2].v[c]), attribute[c]);
+                        attribute[3 + c] = f32x4_mul(w0, f32x4_set1(triangle->normal[0].v[c]));
+                        attribute[3 + c] = f32x4_madd(w1, f32x4_set1(triangle->normal[1].v[c]), attribute[3 + c]);
+                        attribute[3 + c] = f32x4_madd(w2, f32x4_set1(triangle->normal[2].v[c]), attribute[3 + c]);
+                    }
+
+                    // the cluster lookup ps_test_shading_model does from SV_Position and pos_world
+                    f32 pos_x[4], pos_y[4], pos_z[4];
+                    f32x4_store(pos_x, attribute[0]);
+                    f32x4_store(pos_y, attribute[1]);
+                    f32x4_store(pos_z, attribute[2]);
+                    Light_Constants *light_constants = &frame->light_constants;
+                    u32 cluster[4];
+                    for (u32 lane = 0; lane < 4; ++lane) {
+                        u32 tile_x = (u32)(((f32)(x + (s32)lane) + 0.5f) * light_constants->cluster_x_scale);
+                        u32 tile_y = (u32)(((f32)y + 0.5f) * light_constants->cluster_y_scale);
+                        tile_x = tile_x < light_cluster_grid_x ? tile_x : light_cluster_grid_x - 1;
+                        tile_y = tile_y < light_cluster_grid_y ? tile_y : light_cluster_grid_y - 1;
+                        v3f to_p = v3f_sub(v3f_make(pos_x[lane], pos_y[lane], pos_z[lane]), light_constants->camera_p);
+                        u32 slice = light_cluster_slice(frame->clusters, v3f_dot(to_p, light_constants->camera_forward));
+                        cluster[lane] = (slice * light_cluster_grid_y + tile_y) * light_cluster_grid_x + tile_x;
+                    }
+
+                    f32x4 shaded[3];
+                    soft_shade_x4(frame, triangle->colour,
+                                  v3f_x4_make(attribute[0], attribute[1], attribute[2]),
+                                  v3f_x4_make(attribute[3], attribute[4], attribute[5]), cluster, pass_mask, shaded);
+
+                    f32 r[4], g[4], b[4];
+                    f32x4_store(r, shaded[0]);
+                    f32x4_store(g, shaded[1]);
+                    f32x4_store(b, shaded[2]);
+                    for (u32 lane = 0; lane < 4; ++lane) {
+                        if (pass_mask & (1u << lane)) {
+                            target->colour[pixel + lane] = soft_pack_colour(r[lane], g[lane], b[lane], triangle->colour.a);
+                        }
+                    }
+                }
+                for (u32 i = 0; i < 3; ++i) {
+                    row_edge[i] += step_y[i];
+                }
+            }
+        }
+    }
+    profile_end();
+}
+
+function void
+soft_render(Soft_Renderer *renderer, Job_System *jobs, Arena *scratch, Soft_Target *target,
+            Soft_Draw *draws, u32 draw_count, R3D_Buffer *instances,
+            D3D11_Constants *constants, Light_Clusters *clusters) {
+    s_assert((target->width % 4) == 0, "soft target width must be a multiple of four");
+    u64 scratch_pos = scratch->pos;
+    for (u32 index = 0; index < renderer->worker_count; ++index) {
+        arena_clear(renderer->triangle_arenas + index);
+    }
+
+    Soft_Frame frame;
+    frame.renderer = renderer;
+    frame.target = target;
+    frame.draws = draws;
+    frame.draw_first = arena_push_array(scratch, u64, draw_count + 1);
+    for (u32 draw = 0; draw < draw_count; ++draw) {
+        frame.draw_first[draw + 1] = frame.draw_first[draw] + draws[draw].visible_count;
+    }
+    u64 visible_count = frame.draw_first[draw_count];
+    frame.instances = instances;
+    frame.constants = constants;
+    frame.clusters = clusters;
+    light_clusters_constants(clusters, &frame.light_constants, target->width, target->height);
+    frame.tiles_x = (target->width + soft_tile_size - 1) / soft_tile_size;
+    frame.tiles_y = (target->height + soft_tile_size - 1) / soft_tile_size;
+    frame.tile_count = frame.tiles_x * frame.tiles_y;
+
+    u64 chunk_count = (visible_count + soft_instances_per_job - 1) / soft_instances_per_job;
+    frame.chunk_triangles = arena_push_array(scratch, Soft_Triangle *, chunk_count);
+    frame.chunk_triangle_count = arena_push_array(scratch, u64, chunk_count);
+    frame.chunk_tile_cursor = arena_push_array(scratch, u32, chunk_count * frame.tile_count);
+    frame.tile_first = arena_push_array(scratch, u32, frame.tile_count + 1);
+
+    Job_Fence fence = { 0 };
+    job_parallel_for(jobs, &fence, visible_count, soft_instances_per_job, soft_setup_job, &frame);
+    job_wait(jobs, &fence);
+
+    // Tile by tile, each chunk's count becomes its write cursor. Chunks stay in order inside a
+    // tile, which keeps equal-depth ties resolved the way the GPU would.
+    u32 running = 0;
+    for (u32 tile = 0; tile < frame.tile_count; ++tile) {
+        frame.tile_first[tile] = running;
+        for (u64 chunk = 0; chunk < chunk_count; ++chunk) {
+            u32 *cursor = frame.chunk_tile_cursor + chunk * frame.tile_count + tile;
+            u32 count = *cursor;
+            *cursor = running;
+            running += count;
+        }
+    }
+    frame.tile_first[frame.tile_count] = running;
+
+    frame.bins = arena_push_array(scratch, Soft_Triangle *, running);
+    if (running && !frame.bins) {
+        os_fatal_error(str8("Software rasterizer ran out of bin memory"));
+    }
+    job_parallel_for(jobs, &fence, visible_count, soft_instances_per_job, soft_bin_job, &frame);
+    job_wait(jobs, &fence);
+
+    job_parallel_for(jobs, &fence, frame.tile_count, 4, soft_raster_job, &frame);
+    job_wait(jobs, &fence);
+
+    arena_pop_to(scratch, scratch_pos);
+}
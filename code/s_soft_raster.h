@@ -0,0 +1,51 @@
+#if !defined(S_SOFT_RASTER_H)
+#define S_SOFT_RASTER_H
+
+// CPU reference for the D3D11 path: vs_main + ps_test_shading_model over the same vertex layout,
+// instances and constants. Follows D3D11's rules where they show in the output: 8 bit subpixel
+// precision, pixel centres at .5, the top-left fill rule, clockwise front faces with back faces
+// culled, depth LESS, and near plane clipping at z = 0.
+//
+// Triangles are set up per chunk of instances, binned into screen tiles and then every tile is
+// rasterized and shaded by one job, four pixels at a time in f32x4 lanes. Bins keep submission
+// order, so the output doesn't depend on the worker count.
+
+typedef struct {
+    // width must be a multiple of four
+    u32 width;
+    u32 height;
+    // RGBA8 with r in the low byte, i.e. DXGI_FORMAT_R8G8B8A8_UNORM
+    u32 *colour;
+    f32 *depth;
+} Soft_Target;
+
+#define soft_tile_size 32
+#define soft_instances_per_job 256
+// Clip-space x and y are clipped to +-soft_guard_band * w; what's left is scissored per tile.
+#define soft_guard_band 16.0f
+
+typedef struct {
+    u32 worker_count;
+    // one per worker, set-up triangles land in the arena of whoever ran the chunk
+    Arena *triangle_arenas;
+    Arena arena;
+} Soft_Renderer;
+
+// What one DrawIndexedInstanced draws: mesh for each instance named by visible.
+typedef struct {
+    Mesh *mesh;
+    u32 *visible;
+    u64 visible_count;
+} Soft_Draw;
+
+function void soft_init(Soft_Renderer *renderer, u32 worker_count);
+function void soft_release(Soft_Renderer *renderer);
+function void soft_target_clear(Soft_Target *target, v4f colour, f32 depth);
+// Runs the draws in order, e.g. one per LOD level over the output of r3d_cull. Instances go
+// through r3d_pack_instance first so they see the same quantized orientation and colour as the
+// GPU. Pixels walk clusters the way the pixel shader does.
+function void soft_render(Soft_Renderer *renderer, Job_System *jobs, Arena *scratch, Soft_Target *target,
+                          Soft_Draw *draws, u32 draw_count, R3D_Buffer *instances,
+                          D3D11_Constants *constants, Light_Clusters *clusters);
+
+#endif
@@ -0,0 +1,384 @@
+// Software rasterizer: the D3D11 rules it claims, checked pixel by pixel. Triangles are placed in
+// screen space through an identity view_projection, so their corners land exactly where the test
+// says. Triangles sharing an edge cover every pixel along it exactly once (the top-left rule),
+// back faces draw nothing, and geometry crossing or behind the near plane is clipped rather than
+// projected through w <= 0. Then a lit scene of a few thousand instances has to come out the same
+// bit for bit at any worker count.
+
+#define soft_test_size 128
+
+typedef struct {
+    Soft_Renderer renderer;
+    Job_System jobs;
+    Arena scratch;
+    Soft_Target target;
+    R3D_Buffer instances;
+    D3D11_Constants constants;
+    Light_Clusters clusters;
+    // per pixel, how many of the triangles drawn since soft_test_reset covered it
+    u8 *coverage;
+} Soft_Test;
+
+// Packing can't represent a zero component, so an identity orientation comes back turned by a
+// fraction of a degree. This turns it back, close enough for the subpixel snap to put every
+// corner where the test placed it.
+function m44
+soft_test_unturn(void) {
+    quat back = quat_conj(r3d_unpack_quat(r3d_pack_quat(quat_identity())));
+    m44 result = m44_identity();
+    for (u32 row = 0; row < 3; ++row) {
+        v3f axis = v3f_make(row == 0 ? 1.0f : 0.0f, row == 1 ? 1.0f : 0.0f, row == 2 ? 1.0f : 0.0f);
+        v3f turned = quat_rot_v3f(back, axis);
+        for (u32 column = 0; column < 3; ++column) {
+            result.m[row][column] = turned.v[column];
+        }
+    }
+    return(result);
+}
+
+function void
+soft_test_init(Soft_Test *test, u32 worker_count, u32 width, u32 height) {
+    job_system_init(&test->jobs, worker_count);
+    soft_init(&test->renderer, worker_count);
+    test->scratch = arena_reserve(gigabytes(1));
+    test->target.width = width;
+    test->target.height = height;
+    test->target.colour = (u32 *)malloc((u64)width * height * sizeof(u32));
+    test->target.depth = (f32 *)malloc((u64)width * height * sizeof(f32));
+    test->coverage = (u8 *)calloc((u64)width * height, 1);
+    r3d_init(&test->instances, 1 << 16, R3D_Layout_AoS);
+    memset(&test->constants, 0, sizeof(test->constants));
+    test->constants.view_projection = soft_test_unturn();
+}
+
+function void
+soft_test_release(Soft_Test *test) {
+    r3d_release(&test->instances);
+    free(test->coverage);
+    free(test->target.depth);
+    free(test->target.colour);
+    arena_release(&test->scratch);
+    soft_release(&test->renderer);
+    job_system_release(&test->jobs);
+}
+
+// Clusters for a camera at camera_p looking down +z, the way game_update fills Light_View.
+function void
+soft_test_clusters(Soft_Test *test, v3f camera_p, m44 projection, Light *lights, u32 light_count) {
+    Light_View view;
+    view.camera_p = camera_p;
+    view.camera_forward = v3f_make(0.0f, 0.0f, 1.0f);
+    view.world_to_camera = m44_look_at_lh(camera_p, v3f_add(camera_p, view.camera_forward), v3f_make(0.0f, 1.0f, 0.0f));
+    view.projection_x = projection.m[0][0];
+    view.projection_y = projection.m[1][1];
+    view.near_plane = 0.1f;
+    view.far_plane = 1000.0f;
+    light_clusters_build(&test->clusters, &test->jobs, &test->scratch, &view, lights, light_count);
+}
+
+// Draws mesh once per instance in test->instances, into a cleared target, and counts what it covered.
+function u32
+soft_test_draw(Soft_Test *test, Mesh *mesh) {
+    u64 scratch_pos = test->scratch.pos;
+    u32 *visible = arena_push_array(&test->scratch, u32, test->instances.count);
+    for (u32 index = 0; index < test->instances.count; ++index) {
+        visible[index] = index;
+    }
+    Soft_Draw draw = { mesh, visible, test->instances.count };
+    soft_target_clear(&test->target, v4f_make(0.0f, 0.0f, 0.0f, 1.0f), 1.0f);
+    soft_render(&test->renderer, &test->jobs, &test->scratch, &test->target, &draw, 1, &test->instances,
+                &test->constants, &test->clusters);
+    arena_pop_to(&test->scratch, scratch_pos);
+
+    u32 result = 0;
+    for (u64 pixel = 0; pixel < (u64)test->target.width * test->target.height; ++pixel) {
+        b32 covered = test->target.depth[pixel] < 1.0f;
+        test->coverage[pixel] += covered;
+        result += covered;
+    }
+    return(result);
+}
+
+// A corner at screen position (x, y), y down, at depth z. For a soft_test_size target and
+// coordinates in 1/256ths the NDC values are exact, so the corner lands on its subpixel.
+function Mesh_Vertex
+soft_test_corner(f32 x, f32 y, f32 z) {
+    Mesh_Vertex result;
+    result.p = v3f_make(x * (2.0f / soft_test_size) - 1.0f, 1.0f - y * (2.0f / soft_test_size), z);
+    result.normal = v3f_make(0.0f, 0.0f, -1.0f);
+    return(result);
+}
+
+// One triangle, drawn alone. corners are (x, y) pairs.
+function u32
+soft_test_triangle(Soft_Test *test, f32 *corners, f32 z) {
+    Mesh_Vertex vertices[3];
+    u32 indices[3] = { 0, 1, 2 };
+    for (u32 corner = 0; corner < 3; ++corner) {
+        vertices[corner] = soft_test_corner(corners[corner * 2], corners[corner * 2 + 1], z);
+    }
+    Mesh mesh = { vertices, 3, indices, 3, 2.0f };
+    u32 result = soft_test_draw(test, &mesh);
+    return(result);
+}
+
+// Twice the signed area of a, b, p in 1/256ths, the rasterizer's edge function; > 0 inside a
+// clockwise polygon on a y down screen.
+function s64
+soft_test_edge(f32 *a, f32 *b, s64 px, s64 py) {
+    s64 ax = (s64)(a[0] * 256.0f), ay = (s64)(a[1] * 256.0f);
+    s64 bx = (s64)(b[0] * 256.0f), by = (s64)(b[1] * 256.0f);
+    s64 result = (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+    return(result);
+}
+
+function void
+test_soft_raster(void) {
+    Soft_Test test;
+    soft_test_init(&test, 4, soft_test_size, soft_test_size);
+    r3d_add_instance(&test.instances, v3f_make(0.0f, 0.0f, 0.0f), quat_identity(), v3f_make(1.0f, 1.0f, 1.0f),
+                     v4f_make(1.0f, 1.0f, 1.0f, 1.0f));
+    soft_test_clusters(&test, v3f_make(0.0f, 0.0f, -1.0f), m44_identity(), null, 0);
+    u64 pixel_count = (u64)soft_test_size * soft_test_size;
+
+    // A square from pixel centre (4.5, 4.5) to (27.5, 27.5), cut along its diagonal, which runs
+    // through pixel centres. Left and top edges are in, right and bottom out: 23 x 23 pixels, each
+    // covered once.
+    {
+        f32 a[6] = { 4.5f, 4.5f, 27.5f, 4.5f, 27.5f, 27.5f };
+        f32 b[6] = { 4.5f, 4.5f, 27.5f, 27.5f, 4.5f, 27.5f };
+        memset(test.coverage, 0, pixel_count);
+        u32 covered = soft_test_triangle(&test, a, 0.5f) + soft_test_triangle(&test, b, 0.5f);
+        u32 wrong = 0;
+        for (u32 y = 0; y < soft_test_size; ++y) {
+            for (u32 x = 0; x < soft_test_size; ++x) {
+                u32 expected = (x >= 4) && (x < 27) && (y >= 4) && (y < 27);
+                wrong += test.coverage[y * soft_test_size + x] != expected;
+            }
+        }
+        test_check(!wrong && (covered == 23 * 23), "split square: %u pixels covered, %u wrong", covered, wrong);
+
+        // the same two, counter-clockwise, are back faces
+        f32 a_back[6] = { a[0], a[1], a[4], a[5], a[2], a[3] };
+        f32 b_back[6] = { b[0], b[1], b[4], b[5], b[2], b[3] };
+        covered = soft_test_triangle(&test, a_back, 0.5f) + soft_test_triangle(&test, b_back, 0.5f);
+        test_check(!covered, "back facing square covered %u pixels", covered);
+    }
+
+    // Fans around a point, convex, half of them with corners on the half pixel grid, where pixel
+    // centres land exactly on edges, and half anywhere on the subpixel grid. No pixel is covered
+    // twice, and every pixel centre inside the fan is covered once; the ones on its outline depend
+    // on the rule too, and aren't counted.
+    {
+        Test_Random random = test_random_make(100);
+        u32 twice = 0;
+        u32 missed = 0;
+        for (u32 fan = 0; fan < 64; ++fan) {
+            f32 grid = (fan & 1) ? 256.0f : 2.0f;
+            u32 corner_count = 3 + test_random_u32(&random) % 10;
+            f32 centre[2] = { test_random_f32(&random, 40.0f, 88.0f), test_random_f32(&random, 40.0f, 88.0f) };
+            centre[0] = floorf(centre[0] * grid) / grid;
+            centre[1] = floorf(centre[1] * grid) / grid;
+            f32 outline[13][2];
+            for (u32 corner = 0; corner < corner_count; ++corner) {
+                // increasing angles on a y down screen go clockwise
+                f32 angle = (2.0f * pi_f32 * ((f32)corner + test_random_f32(&random, 0.1f, 0.9f))) / (f32)corner_count;
+                f32 radius = test_random_f32(&random, 8.0f, 36.0f);
+                outline[corner][0] = floorf((centre[0] + cosf(angle) * radius) * grid) / grid;
+                outline[corner][1] = floorf((centre[1] + sinf(angle) * radius) * grid) / grid;
+            }
+
+            memset(test.coverage, 0, pixel_count);
+            for (u32 corner = 0; corner < corner_count; ++corner) {
+                f32 *next = outline[(corner + 1) % corner_count];
+                f32 triangle[6] = { centre[0], centre[1], outline[corner][0], outline[corner][1], next[0], next[1] };
+                soft_test_triangle(&test, triangle, 0.5f);
+            }
+            for (u32 y = 0; y < soft_test_size; ++y) {
+                for (u32 x = 0; x < soft_test_size; ++x) {
+                    u8 count = test.coverage[y * soft_test_size + x];
+                    twice += count > 1;
+                    // snapping can leave the outline slightly concave, so test against each
+                    // triangle's outer edge and the two spokes, inside one triangle is inside
+                    s64 px = (s64)x * 256 + 128;
+                    s64 py = (s64)y * 256 + 128;
+                    b32 inside = False;
+                    b32 on_outline = False;
+                    for (u32 corner = 0; corner < corner_count; ++corner) {
+                        f32 *next = outline[(corner + 1) % corner_count];
+                        s64 outer = soft_test_edge(outline[corner], next, px, py);
+                        s64 spoke_in = soft_test_edge(centre, outline[corner], px, py);
+                        s64 spoke_out = soft_test_edge(next, centre, px, py);
+                        inside = inside || ((outer > 0) && (spoke_in >= 0) && (spoke_out >= 0));
+                        on_outline = on_outline || ((outer == 0) && (spoke_in >= 0) && (spoke_out >= 0));
+                    }
+                    if (inside && !on_outline) {
+                        missed += count == 0;
+                    }
+                }
+            }
+        }
+        test_check(!twice && !missed, "fans: %u pixels covered twice, %u inside missed", twice, missed);
+    }
+
+    // Near plane clipping with w = 1: z runs from -0.5 at x = 8 to 1.5 at x = 120, crossing 0 at
+    // x = 36. Only the part with z >= 0 is drawn, and none of it gets a negative depth.
+    {
+        Mesh_Vertex vertices[3] = {
+            soft_test_corner(8.0f, 8.0f, -0.5f),
+            soft_test_corner(120.0f, 8.0f, 1.5f),
+            soft_test_corner(8.0f, 120.0f, -0.5f),
+        };
+        // the third corner is left of the crossing too, so the clip line is the column x = 36
+        u32 indices[3] = { 0, 1, 2 };
+        Mesh mesh = { vertices, 3, indices, 3, 2.0f };
+        memset(test.coverage, 0, pixel_count);
+        soft_test_draw(&test, &mesh);
+        u32 behind = 0;
+        u32 negative = 0;
+        u32 covered = 0;
+        for (u32 y = 0; y < soft_test_size; ++y) {
+            for (u32 x = 0; x < soft_test_size; ++x) {
+                u64 pixel = (u64)y * soft_test_size + x;
+                if (test.coverage[pixel]) {
+                    ++covered;
+                    behind += x < 35;
+                    negative += test.target.depth[pixel] < 0.0f;
+                }
+            }
+        }
+        test_check(covered && !behind && !negative, "clipped at z = 0: %u pixels, %u left of the clip, %u negative depths",
+                   covered, behind, negative);
+
+        // entirely behind, nothing
+        for (u32 corner = 0; corner < 3; ++corner) {
+            vertices[corner].p.z = -0.25f;
+        }
+        covered = soft_test_draw(&test, &mesh);
+        test_check(!covered, "a triangle behind the near plane covered %u pixels", covered);
+    }
+
+    // A ground plane under a perspective camera, running from behind it to 60 units ahead. Its
+    // corners behind the camera have w < 0 and land anywhere if projected without clipping. The
+    // horizon is the middle row, the far edge a couple of rows below it: everything from there
+    // down is ground, nothing above the middle is.
+    {
+        v3f camera_p = v3f_make(0.0f, 1.0f, 0.0f);
+        m44 projection = m44_perspective_lh_z01(radians(60.0f), 1.0f, 0.1f, 1000.0f);
+        test.constants.view_projection = m44_mul(m44_mul(soft_test_unturn(), m44_look_at_lh(camera_p, v3f_add(camera_p, v3f_make(0.0f, 0.0f, 1.0f)),
+                                                                v3f_make(0.0f, 1.0f, 0.0f))), projection);
+        Mesh_Vertex vertices[4];
+        f32 corners[4][2] = { { -200.0f, -20.0f }, { -200.0f, 60.0f }, { 200.0f, 60.0f }, { 200.0f, -20.0f } };
+        for (u32 corner = 0; corner < 4; ++corner) {
+            vertices[corner].p = v3f_make(corners[corner][0], 0.0f, corners[corner][1]);
+            vertices[corner].normal = v3f_make(0.0f, 1.0f, 0.0f);
+        }
+        u32 indices[6] = { 0, 1, 2, 2, 3, 0 };
+        Mesh mesh = { vertices, 4, indices, 6, 300.0f };
+        memset(test.coverage, 0, pixel_count);
+        soft_test_draw(&test, &mesh);
+        // the far edge at z = 60 is 1 / 60 / tan(30 degrees) of the half height below the middle
+        u32 far_row = soft_test_size / 2 + (u32)ceilf((1.0f / 60.0f) / tanf(radians(30.0f)) * soft_test_size * 0.5f) + 1;
+        u32 above = 0;
+        u32 missed = 0;
+        u32 bad_depth = 0;
+        for (u32 y = 0; y < soft_test_size; ++y) {
+            for (u32 x = 0; x < soft_test_size; ++x) {
+                u64 pixel = (u64)y * soft_test_size + x;
+                above += (y < soft_test_size / 2) && test.coverage[pixel];
+                missed += (y >= far_row) && !test.coverage[pixel];
+                bad_depth += test.coverage[pixel] && ((test.target.depth[pixel] < 0.0f) || (test.target.depth[pixel] > 1.0f));
+            }
+        }
+        test_check(!above && !missed && !bad_depth,
+                   "ground through the camera: %u pixels above the horizon, %u missed below row %u, %u bad depths",
+                   above, missed, far_row, bad_depth);
+        test.constants.view_projection = soft_test_unturn();
+    }
+
+    soft_test_release(&test);
+
+    // The same lit scene at 1, 3 and 8 workers: instances spread over many chunks, two meshes in
+    // two draws, and pairs of coincident instances in different colours whose ties are decided by
+    // submission order.
+    {
+        Arena arena = arena_reserve(megabytes(64));
+        Arena scratch = arena_reserve(megabytes(64));
+        Mesh sphere = mesh_lod_test_sphere(&arena, &scratch, 8, 16);
+        u32 soup_count;
+        Mesh_Vertex *soup = mesh_test_grid_soup(&scratch, 4, &soup_count);
+        Mesh grid = mesh_build(&arena, &scratch, soup, soup_count);
+        arena_release(&scratch);
+
+        u32 instance_count = 3000;
+        Light lights[64];
+        Test_Random light_random = test_random_make(102);
+        light_test_scatter(&light_random, lights, array_count(lights), 20.0f);
+        v3f camera_p = v3f_make(0.0f, 2.0f, -30.0f);
+        m44 projection = m44_perspective_lh_z01(radians(70.0f), 3.0f / 4.0f, 0.1f, 1000.0f);
+        m44 view_projection = m44_mul(m44_look_at_lh(camera_p, v3f_add(camera_p, v3f_make(0.0f, 0.0f, 1.0f)),
+                                                     v3f_make(0.0f, 1.0f, 0.0f)), projection);
+
+        u32 worker_counts[3] = { 1, 3, 8 };
+        u32 *colour[3];
+        f32 *depth[3];
+        u32 width = 256;
+        u32 height = 192;
+        for (u32 run = 0; run < array_count(worker_counts); ++run) {
+            Soft_Test scene;
+            soft_test_init(&scene, worker_counts[run], width, height);
+            scene.constants.view_projection = view_projection;
+            Test_Random random = test_random_make(101);
+            for (u32 index = 0; index < instance_count; ++index) {
+                v3f p = test_random_v3f(&random, -20.0f, 20.0f);
+                quat orient = test_random_quat(&random);
+                v3f scale = test_random_v3f(&random, 0.3f, 1.5f);
+                v4f instance_colour = test_random_v4f(&random, 0.0f, 1.0f);
+                r3d_add_instance(&scene.instances, p, orient, scale, instance_colour);
+                if ((index % 7) == 0) {
+                    r3d_add_instance(&scene.instances, p, orient, scale, v4f_make(1.0f, 0.0f, 0.0f, 1.0f));
+                }
+            }
+            soft_test_clusters(&scene, camera_p, projection, lights, array_count(lights));
+
+            u64 count = scene.instances.count;
+            u32 *visible = arena_push_array(&scene.scratch, u32, count);
+            for (u32 index = 0; index < count; ++index) {
+                visible[index] = index;
+            }
+            Soft_Draw draws[2] = {
+                { &sphere, visible, count / 2 },
+                { &grid, visible + count / 2, count - count / 2 },
+            };
+            soft_target_clear(&scene.target, v4f_make(0.1f, 0.2f, 0.3f, 1.0f), 1.0f);
+            soft_render(&scene.renderer, &scene.jobs, &scene.scratch, &scene.target, draws, array_count(draws),
+                        &scene.instances, &scene.constants, &scene.clusters);
+
+            colour[run] = arena_push_array(&arena, u32, (u64)width * height);
+            depth[run] = arena_push_array(&arena, f32, (u64)width * height);
+            memory_copy(colour[run], scene.target.colour, (u64)width * height * sizeof(u32));
+            memory_copy(depth[run], scene.target.depth, (u64)width * height * sizeof(f32));
+            soft_test_release(&scene);
+        }
+
+        u32 covered = 0;
+        u32 colours = 0;
+        for (u64 pixel = 0; pixel < (u64)width * height; ++pixel) {
+            covered += depth[0][pixel] < 1.0f;
+            colours += (pixel > 0) && (colour[0][pixel] != colour[0][pixel - 1]);
+        }
+        test_check((covered > width * height / 4) && (colours > 1000),
+                   "the scene is too plain to compare: %u pixels covered, %u colour changes", covered, colours);
+        for (u32 run = 1; run < array_count(worker_counts); ++run) {
+            u32 colour_diffs = 0;
+            u32 depth_diffs = 0;
+            for (u64 pixel = 0; pixel < (u64)width * height; ++pixel) {
+                colour_diffs += colour[run][pixel] != colour[0][pixel];
+                depth_diffs += memory_compare(depth[run] + pixel, depth[0] + pixel, sizeof(f32)) != 0;
+            }
+            test_check(!colour_diffs && !depth_diffs, "%u workers: %u colours and %u depths differ from 1 worker",
+                       worker_counts[run], colour_diffs, depth_diffs);
+        }
+        arena_release(&arena);
+    }
+}
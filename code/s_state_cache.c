@@ -0,0 +1,65 @@
+function void
+state_cache_init(State_Cache *cache) {
+    memset(cache, 0, sizeof(State_Cache));
+}
+
+function void
+state_cache_invalidate(State_Cache *cache) {
+    memset(cache->known, 0, sizeof(cache->known));
+}
+
+function void
+state_cache_forget(State_Cache *cache, u32 first_slot, u32 slot_count) {
+    for (u32 slot = first_slot; (slot < first_slot + slot_count) && (slot < StateSlot_Count); ++slot) {
+        cache->known[slot] = False;
+    }
+}
+
+// Stores value into slot, True when it wasn't there already. Counts nothing.
+function b32
+state_cache_update(State_Cache *cache, u32 slot, void *value, u32 size) {
+    u8 padded[state_cache_value_max] = { 0 };
+    memory_copy(padded, value, size);
+    b32 result = !cache->known[slot] || (memory_compare(cache->values[slot], padded, state_cache_value_max) != 0);
+    if (result) {
+        memory_copy(cache->values[slot], padded, state_cache_value_max);
+        cache->known[slot] = True;
+    }
+    return(result);
+}
+
+function b32
+state_cache_bind(State_Cache *cache, u32 slot, void *value, u32 size) {
+    s_assert((slot < StateSlot_Count) && (size <= state_cache_value_max), "state cache slot out of range");
+    b32 result = state_cache_update(cache, slot, value, size);
+    if (result) {
+        ++cache->issued;
+    } else {
+        ++cache->filtered;
+    }
+    return(result);
+}
+
+function b32
+state_cache_bind_objects(State_Cache *cache, u32 first_slot, u32 count, void **objects) {
+    s_assert(first_slot + count <= StateSlot_Count, "state cache slot out of range");
+    b32 result = False;
+    for (u32 index = 0; index < count; ++index) {
+        // every slot is updated, not just up to the first that differs
+        result |= state_cache_update(cache, first_slot + index, objects + index, sizeof(void *));
+    }
+    if (result) {
+        ++cache->issued;
+    } else {
+        ++cache->filtered;
+    }
+    return(result);
+}
+
+function void
+state_cache_frame_end(State_Cache *cache) {
+    cache->frame_issued = cache->issued;
+    cache->frame_filtered = cache->filtered;
+    cache->issued = 0;
+    cache->filtered = 0;
+}
@@ -0,0 +1,79 @@
+#if !defined(S_STATE_CACHE_H)
+#define S_STATE_CACHE_H
+
+// What is bound on one context, slot by slot, so a bind of what's already there can be dropped
+// before it reaches the API. Knows nothing about D3D11: a slot holds up to state_cache_value_max
+// bytes, an object pointer or a small struct like a viewport, and the caller makes the real call
+// only when state_cache_bind says the value changed. The headless build runs it against the null
+// render backend as a stand-in context, see render_null_begin.
+//
+// Anything that changes a context's state behind the cache, ClearState, ExecuteCommandList or
+// FinishCommandList without restoring, Present unbinding the back buffer, has to be followed by
+// state_cache_invalidate or state_cache_forget, or the next bind may be dropped wrongly.
+
+#define state_cache_value_max 32
+// registers of each stage the cache follows, binds past these always go through
+#define state_cache_constant_buffer_count 4
+#define state_cache_resource_count 8
+#define state_cache_sampler_count 2
+#define state_cache_unordered_access_count 1
+
+enum {
+    StateSlot_InputLayout,
+    StateSlot_Topology,
+    // input slot 0 only
+    StateSlot_VertexBuffer,
+    StateSlot_IndexBuffer,
+    StateSlot_VertexShader,
+    StateSlot_PixelShader,
+    StateSlot_ComputeShader,
+    StateSlot_Rasterizer,
+    StateSlot_DepthStencil,
+    StateSlot_Blend,
+    // viewport 0 only
+    StateSlot_Viewport,
+    // colour target 0 and depth together, the way OMSetRenderTargets sets them
+    StateSlot_RenderTargets,
+
+    // a run of slots each, StateSlot_VSConstantBuffer + register
+    StateSlot_VSConstantBuffer,
+    StateSlot_PSConstantBuffer = StateSlot_VSConstantBuffer + state_cache_constant_buffer_count,
+    StateSlot_CSConstantBuffer = StateSlot_PSConstantBuffer + state_cache_constant_buffer_count,
+    StateSlot_VSResource = StateSlot_CSConstantBuffer + state_cache_constant_buffer_count,
+    StateSlot_PSResource = StateSlot_VSResource + state_cache_resource_count,
+    StateSlot_CSResource = StateSlot_PSResource + state_cache_resource_count,
+    StateSlot_PSSampler = StateSlot_CSResource + state_cache_resource_count,
+    StateSlot_CSSampler = StateSlot_PSSampler + state_cache_sampler_count,
+    StateSlot_CSUnorderedAccess = StateSlot_CSSampler + state_cache_sampler_count,
+
+    StateSlot_Count = StateSlot_CSUnorderedAccess + state_cache_unordered_access_count
+};
+
+typedef struct {
+    // zero padded past the size bound, so values compare whole
+    u8 values[StateSlot_Count][state_cache_value_max];
+    b32 known[StateSlot_Count];
+
+    // calls made and dropped this frame, and the totals of the last finished frame
+    u64 issued;
+    u64 filtered;
+    u64 frame_issued;
+    u64 frame_filtered;
+} State_Cache;
+
+function void state_cache_init(State_Cache *cache);
+// Nothing is known afterwards, the next bind of every slot goes through.
+function void state_cache_invalidate(State_Cache *cache);
+function void state_cache_forget(State_Cache *cache, u32 first_slot, u32 slot_count);
+
+// True when slot doesn't hold value yet: the caller makes the call and the cache holds value
+// from then on. False counts a dropped call.
+function b32 state_cache_bind(State_Cache *cache, u32 slot, void *value, u32 size);
+// One call that sets objects[0, count) into the count slots from first_slot, the way the
+// *SetShaderResources family does. Goes through when any of them differs.
+function b32 state_cache_bind_objects(State_Cache *cache, u32 first_slot, u32 count, void **objects);
+
+// Moves this frame's counters into frame_issued and frame_filtered.
+function void state_cache_frame_end(State_Cache *cache);
+
+#endif
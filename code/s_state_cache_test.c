@@ -0,0 +1,218 @@
+// State cache: binds straight into a cache, where what goes through and what's dropped is known
+// call by call, then the cache inside the null render backend, which checks every draw against the
+// made-up context the cache let calls through to. Contexts changed behind the cache, and a cache
+// that drops a bind it shouldn't, have to show up there as errors.
+
+// The shape of a D3D11_VIEWPORT.
+typedef struct {
+    f32 x;
+    f32 y;
+    f32 width;
+    f32 height;
+    f32 min_depth;
+    f32 max_depth;
+} State_Cache_Test_Viewport;
+
+function void
+test_state_cache(void) {
+    // single slots
+    {
+        State_Cache cache;
+        state_cache_init(&cache);
+        u64 shader = 0x1234;
+        test_check(state_cache_bind(&cache, StateSlot_PixelShader, &shader, sizeof(shader)), "first bind dropped");
+        test_check(!state_cache_bind(&cache, StateSlot_PixelShader, &shader, sizeof(shader)), "same bind went through");
+        u64 other = 0x5678;
+        test_check(state_cache_bind(&cache, StateSlot_PixelShader, &other, sizeof(other)), "changed bind dropped");
+        // nothing bound is a value like any other
+        u64 nothing = 0;
+        test_check(state_cache_bind(&cache, StateSlot_PixelShader, &nothing, sizeof(nothing)) &&
+                   !state_cache_bind(&cache, StateSlot_PixelShader, &nothing, sizeof(nothing)), "unbinding isn't cached");
+        // slots are independent
+        test_check(state_cache_bind(&cache, StateSlot_VertexShader, &nothing, sizeof(nothing)), "a slot nothing was bound to dropped 0");
+        // a shorter value is padded with zeroes, so it matches the same value stored wider
+        u32 topology = 4;
+        u64 topology_wide = 4;
+        state_cache_bind(&cache, StateSlot_Topology, &topology, sizeof(topology));
+        test_check(!state_cache_bind(&cache, StateSlot_Topology, &topology_wide, sizeof(topology_wide)), "padding compared");
+
+        state_cache_frame_end(&cache);
+        test_check((cache.frame_issued == 5) && (cache.frame_filtered == 3) && !cache.issued && !cache.filtered,
+                   "frame counted %llu issued and %llu filtered", (unsigned long long)cache.frame_issued,
+                   (unsigned long long)cache.frame_filtered);
+    }
+
+    // viewport values, every field counts
+    {
+        State_Cache cache;
+        state_cache_init(&cache);
+        State_Cache_Test_Viewport viewport = { 0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 1.0f };
+        test_check(state_cache_bind(&cache, StateSlot_Viewport, &viewport, sizeof(viewport)), "first viewport dropped");
+        State_Cache_Test_Viewport same = viewport;
+        test_check(!state_cache_bind(&cache, StateSlot_Viewport, &same, sizeof(same)), "same viewport went through");
+        for (u32 field = 0; field < 6; ++field) {
+            State_Cache_Test_Viewport changed = viewport;
+            ((f32 *)&changed)[field] += 0.5f;
+            test_check(state_cache_bind(&cache, StateSlot_Viewport, &changed, sizeof(changed)),
+                       "viewport field %u changed and was dropped", field);
+            test_check(state_cache_bind(&cache, StateSlot_Viewport, &viewport, sizeof(viewport)),
+                       "viewport field %u changed back and was dropped", field);
+        }
+        // the cache compares bytes, so -0 is a change; a wasted call, never a dropped one
+        State_Cache_Test_Viewport negative_zero = viewport;
+        negative_zero.x = -0.0f;
+        test_check(state_cache_bind(&cache, StateSlot_Viewport, &negative_zero, sizeof(negative_zero)), "-0 viewport dropped");
+    }
+
+    // range binds, the *SetShaderResources way
+    {
+        State_Cache cache;
+        state_cache_init(&cache);
+        void *objects[4] = { (void *)0x10, (void *)0x20, (void *)0x30, (void *)0x40 };
+        u32 first = StateSlot_PSResource + 2;
+        test_check(state_cache_bind_objects(&cache, first, 3, objects), "first range dropped");
+        test_check(!state_cache_bind_objects(&cache, first, 3, objects), "same range went through");
+        // the middle of a range already bound is dropped too
+        test_check(!state_cache_bind_objects(&cache, first + 1, 2, objects + 1), "sub-range of a bound range went through");
+        // one slot of three differs
+        objects[2] = (void *)0x31;
+        test_check(state_cache_bind_objects(&cache, first, 3, objects), "range with its last slot changed dropped");
+        // a range reaching past what's known goes through, and the known part is taken too
+        test_check(state_cache_bind_objects(&cache, first + 1, 3, objects + 1), "range past the known slots dropped");
+        test_check(!state_cache_bind_objects(&cache, first, 4, objects), "the four slots just bound went through again");
+        // every slot of a range that went through is stored, not just up to the first changed one
+        objects[0] = (void *)0x11;
+        objects[3] = (void *)0x41;
+        state_cache_bind_objects(&cache, first, 4, objects);
+        test_check(!state_cache_bind_objects(&cache, first + 3, 1, objects + 3), "the last slot of a range wasn't stored");
+        // ranges and single binds see the same slots
+        u64 single = (u64)objects[1];
+        test_check(!state_cache_bind(&cache, first + 1, &single, sizeof(single)), "single bind of a range slot went through");
+        // a range counts as one call
+        state_cache_frame_end(&cache);
+        test_check((cache.frame_issued == 4) && (cache.frame_filtered == 5), "ranges counted %llu issued and %llu filtered",
+                   (unsigned long long)cache.frame_issued, (unsigned long long)cache.frame_filtered);
+    }
+
+    // forget and invalidate
+    {
+        State_Cache cache;
+        state_cache_init(&cache);
+        for (u32 slot = 0; slot < StateSlot_Count; ++slot) {
+            u64 value = 0x100 + slot;
+            state_cache_bind(&cache, slot, &value, sizeof(value));
+        }
+        state_cache_forget(&cache, StateSlot_PSResource + 1, 3);
+        u64 through = 0;
+        u64 wrong = 0;
+        for (u32 slot = 0; slot < StateSlot_Count; ++slot) {
+            u64 value = 0x100 + slot;
+            b32 went = state_cache_bind(&cache, slot, &value, sizeof(value));
+            through += went;
+            wrong += went != ((slot >= StateSlot_PSResource + 1) && (slot < StateSlot_PSResource + 4));
+        }
+        test_check(!wrong && (through == 3), "forgetting 3 slots let %llu binds through, %llu of the wrong slots",
+                   (unsigned long long)through, (unsigned long long)wrong);
+
+        // past the end stops at the last slot
+        state_cache_forget(&cache, StateSlot_Count - 1, 100);
+        state_cache_forget(&cache, StateSlot_Count + 5, 1);
+        u64 last = 0x100 + StateSlot_Count - 1;
+        test_check(state_cache_bind(&cache, StateSlot_Count - 1, &last, sizeof(last)), "the last slot wasn't forgotten");
+
+        state_cache_invalidate(&cache);
+        through = 0;
+        for (u32 slot = 0; slot < StateSlot_Count; ++slot) {
+            u64 value = 0x100 + slot;
+            through += state_cache_bind(&cache, slot, &value, sizeof(value));
+        }
+        test_check(through == StateSlot_Count, "after invalidate only %llu of %u binds went through",
+                   (unsigned long long)through, StateSlot_Count);
+        // invalidate keeps the counters
+        test_check(cache.issued == StateSlot_Count * 2 + 3 + 1, "invalidate lost the counters, %llu issued",
+                   (unsigned long long)cache.issued);
+    }
+
+    // In the null backend. A slice binds the pass's 16 slots and the light range, 17 calls, then a
+    // pixel shader per run. The second slice on the same backend needs none of the pass binds.
+    {
+        Render_Command commands[5];
+        u32 shaders[5] = { 0, 0, 1, 1, 2 };
+        for (u32 index = 0; index < array_count(commands); ++index) {
+            Render_Command command = { 0 };
+            command.shader = shaders[index];
+            command.index_count = 36;
+            command.instance_count = 1;
+            commands[index] = command;
+        }
+        u64 pass_calls = array_count(render_null_pass_slots) + 1;
+
+        Render_Null_Backend null_backend;
+        render_null_backend_init(&null_backend, 4, 36, 24, 1);
+        Render_Backend backend = render_null_backend(&null_backend);
+        render_replay(&backend, commands, array_count(commands));
+        render_null_backend_frame_end(&null_backend);
+        test_check(!null_backend.errors && (null_backend.state_issued == pass_calls + 3) && !null_backend.state_filtered,
+                   "first slice: %llu errors, %llu issued, %llu filtered", (unsigned long long)null_backend.errors,
+                   (unsigned long long)null_backend.state_issued, (unsigned long long)null_backend.state_filtered);
+
+        render_replay(&backend, commands, array_count(commands));
+        render_null_backend_frame_end(&null_backend);
+        test_check(!null_backend.errors && (null_backend.cache.frame_issued == 3) &&
+                   (null_backend.cache.frame_filtered == pass_calls),
+                   "second slice: %llu errors, %llu issued, %llu filtered", (unsigned long long)null_backend.errors,
+                   (unsigned long long)null_backend.cache.frame_issued, (unsigned long long)null_backend.cache.frame_filtered);
+
+        // Forgetting the light range makes exactly that call again.
+        state_cache_forget(&null_backend.cache, render_null_light_slot, render_null_light_count);
+        render_replay(&backend, commands, array_count(commands));
+        render_null_backend_frame_end(&null_backend);
+        test_check(!null_backend.errors && (null_backend.cache.frame_issued == 4) &&
+                   (null_backend.cache.frame_filtered == pass_calls - 1),
+                   "after forgetting the lights: %llu errors, %llu issued", (unsigned long long)null_backend.errors,
+                   (unsigned long long)null_backend.cache.frame_issued);
+
+        // The context cleared behind the cache, like ClearState or ExecuteCommandList: without an
+        // invalidate the binds are dropped and every draw is an error...
+        memset(null_backend.bound, 0, sizeof(null_backend.bound));
+        render_replay(&backend, commands, array_count(commands));
+        test_check(null_backend.errors == array_count(commands), "a cleared context gave %llu errors, expected %llu",
+                   (unsigned long long)null_backend.errors, (unsigned long long)array_count(commands));
+
+        // ...and with one, everything is bound again and draws clean.
+        null_backend.errors = 0;
+        memset(null_backend.bound, 0, sizeof(null_backend.bound));
+        state_cache_invalidate(&null_backend.cache);
+        render_replay(&backend, commands, array_count(commands));
+        test_check(!null_backend.errors, "invalidating after a cleared context left %llu errors",
+                   (unsigned long long)null_backend.errors);
+    }
+
+    // A deliberately broken cache: it claims the pixel shader the first command needs is bound when
+    // the context still holds the last one, so the set_shader is dropped wrongly. Only the draws
+    // with that shader are errors; the next run's bind goes through and fixes the context.
+    {
+        Render_Command commands[4];
+        u32 shaders[4] = { 0, 0, 1, 1 };
+        for (u32 index = 0; index < array_count(commands); ++index) {
+            Render_Command command = { 0 };
+            command.shader = shaders[index];
+            command.index_count = 36;
+            command.instance_count = 1;
+            commands[index] = command;
+        }
+
+        Render_Null_Backend null_backend;
+        render_null_backend_init(&null_backend, 4, 36, 24, 1);
+        Render_Backend backend = render_null_backend(&null_backend);
+        // leaves shader 1 bound
+        render_replay(&backend, commands, array_count(commands));
+        test_check(!null_backend.errors, "the working cache gave %llu errors", (unsigned long long)null_backend.errors);
+
+        u64 lie = render_null_handle(StateSlot_Count + 0);
+        state_cache_update(&null_backend.cache, StateSlot_PixelShader, &lie, sizeof(lie));
+        render_replay(&backend, commands, array_count(commands));
+        test_check(null_backend.errors == 2, "the broken cache gave %llu errors, expected 2",
+                   (unsigned long long)null_backend.errors);
+    }
+}
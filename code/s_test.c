@@ -0,0 +1,101 @@
+global Test_State test_state;
+
+function b32
+test_check_(b32 passed, char *file, int line, char *format, ...) {
+    ++test_state.checks;
+    if (!passed) {
+        ++test_state.failures;
+        fprintf(stderr, "%s:%d: ", file, line);
+        va_list args;
+        va_start(args, format);
+        vfprintf(stderr, format, args);
+        va_end(args);
+        fprintf(stderr, "\n");
+    }
+    return(passed);
+}
+
+function Test_Random
+test_random_make(u64 seed) {
+    Test_Random result;
+    // xorshift never leaves 0
+    result.state = (seed * 0x9E3779B97F4A7C15ull) | 1;
+    return(result);
+}
+
+function u32
+test_random_u32(Test_Random *random) {
+    // xorshift64*
+    u64 x = random->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    random->state = x;
+    u32 result = (u32)((x * 0x2545F4914F6CDD1Dull) >> 32);
+    return(result);
+}
+
+function f32
+test_random_f32(Test_Random *random, f32 low, f32 high) {
+    f32 unit = (f32)(test_random_u32(random) >> 8) / 16777216.0f;
+    f32 result = low + (high - low) * unit;
+    return(result);
+}
+
+function v3f
+test_random_v3f(Test_Random *random, f32 low, f32 high) {
+    v3f result;
+    result.x = test_random_f32(random, low, high);
+    result.y = test_random_f32(random, low, high);
+    result.z = test_random_f32(random, low, high);
+    return(result);
+}
+
+function v4f
+test_random_v4f(Test_Random *random, f32 low, f32 high) {
+    v4f result;
+    result.x = test_random_f32(random, low, high);
+    result.y = test_random_f32(random, low, high);
+    result.z = test_random_f32(random, low, high);
+    result.w = test_random_f32(random, low, high);
+    return(result);
+}
+
+function quat
+test_random_quat(Test_Random *random) {
+    // Shoemake's subgroup algorithm
+    f32 u0 = test_random_f32(random, 0.0f, 1.0f);
+    f32 u1 = test_random_f32(random, 0.0f, 2.0f * 3.14159265f);
+    f32 u2 = test_random_f32(random, 0.0f, 2.0f * 3.14159265f);
+    f32 a = sqrtf(1.0f - u0);
+    f32 b = sqrtf(u0);
+    quat result = quat_make(a * cosf(u1), a * sinf(u1), b * sinf(u2), b * cosf(u2));
+    return(result);
+}
+
+function u32
+test_ulps(f32 a, f32 b) {
+    if ((a != a) || (b != b)) {
+        return(0xFFFFFFFF);
+    }
+    if (a == b) {
+        return(0);
+    }
+    s32 ia, ib;
+    memory_copy(&ia, &a, sizeof(ia));
+    memory_copy(&ib, &b, sizeof(ib));
+    // onto one monotonic line, -0 and +0 both at 0
+    ia = ia < 0 ? (s32)(0x80000000u - (u32)ia) : ia;
+    ib = ib < 0 ? (s32)(0x80000000u - (u32)ib) : ib;
+    s64 difference = (s64)ia - (s64)ib;
+    difference = difference < 0 ? -difference : difference;
+    u32 result = difference > 0xFFFFFFFEll ? 0xFFFFFFFE : (u32)difference;
+    return(result);
+}
+
+function void
+bench_report(char *name, u64 op_count, u64 ticks) {
+    f64 ns = (f64)ticks * 1e9 / (f64)os_time_ticks_per_second();
+    printf("  %-40s %10.2f ns/op (%llu ops, %.1f ms)\n", name, ns / (f64)(op_count ? op_count : 1),
+           (unsigned long long)op_count, ns / 1e6);
+}
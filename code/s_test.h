@@ -0,0 +1,46 @@
+#if !defined(S_TEST_H)
+#define S_TEST_H
+
+// Checks and timing for s_test_linux.c. A failed check prints where and what and the run carries
+// on, so one run reports every failure; the exit code says whether there were any. Inputs come from
+// Test_Random with fixed seeds, so a failure comes back on every run.
+
+typedef struct {
+    u64 checks;
+    u64 failures;
+} Test_State;
+
+typedef struct {
+    u64 state;
+} Test_Random;
+
+typedef void Test_Function(void);
+
+typedef struct {
+    char *name;
+    Test_Function *test;
+    // null when there's nothing worth timing
+    Test_Function *bench;
+} Test_Entry;
+
+#define test_check(cond, ...) test_check_((cond) ? True : False, __FILE__, __LINE__, __VA_ARGS__)
+// True when passed, so a check can guard what would crash after it failed.
+function b32 test_check_(b32 passed, char *file, int line, char *format, ...);
+
+function Test_Random test_random_make(u64 seed);
+function u32 test_random_u32(Test_Random *random);
+// [low, high)
+function f32 test_random_f32(Test_Random *random, f32 low, f32 high);
+function v3f test_random_v3f(Test_Random *random, f32 low, f32 high);
+function v4f test_random_v4f(Test_Random *random, f32 low, f32 high);
+// uniform over rotations
+function quat test_random_quat(Test_Random *random);
+
+// Units in the last place between two floats, counted across zero; 0 when equal, 0xFFFFFFFF when
+// either is nan.
+function u32 test_ulps(f32 a, f32 b);
+
+// ns per op of ticks over op_count, printed as one line under name.
+function void bench_report(char *name, u64 op_count, u64 ticks);
+
+#endif
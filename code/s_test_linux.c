@@ -0,0 +1,154 @@
+// Headless test and benchmark entry. Each module with tests has an s_<module>_test.c defining
+// test_<module> and, where timing is worth having, bench_<module>; both go in test_entries.
+//
+// usage: s_test                 runs every test, exits 1 when a check failed
+//        s_test bench [name]    runs the benchmarks, or only name's
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+
+#include "s_base.h"
+#include "s_os.h"
+#include "s_profile.h"
+#include "s_simd.h"
+#include "s_math.h"
+#include "s_job.h"
+#include "s_r3d.h"
+#include "s_cull.h"
+#include "s_light.h"
+#include "s_mesh.h"
+#include "s_mesh_lod.h"
+#include "s_mesh_pack.h"
+#include "s_obj.h"
+#include "s_batch.h"
+#include "s_frame_clock.h"
+#include "s_game.h"
+#include "s_state_cache.h"
+#include "s_render_command.h"
+#include "s_shader_cache.h"
+#include "s_shading_permutation.h"
+#include "s_dynamic_resolution.h"
+#include "s_downsample.h"
+#include "s_vertex_format.h"
+#include "s_soft_raster.h"
+#include "s_test.h"
+
+#include "s_base.c"
+#include "s_os.c"
+#include "s_os_linux.c"
+#include "s_profile.c"
+#include "s_simd.c"
+#include "s_math.c"
+#include "s_job.c"
+#include "s_r3d.c"
+#include "s_cull.c"
+#include "s_light.c"
+#include "s_mesh.c"
+#include "s_mesh_lod.c"
+#include "s_mesh_pack.c"
+#include "s_obj.c"
+#include "s_batch.c"
+#include "s_frame_clock.c"
+#include "s_game.c"
+#include "s_state_cache.c"
+#include "s_render_command.c"
+#include "s_shader_cache.c"
+#include "s_shading_permutation.c"
+#include "s_dynamic_resolution.c"
+#include "s_downsample.c"
+#include "s_vertex_format.c"
+#include "s_soft_raster.c"
+#include "s_test.c"
+
+#include "s_math_test.c"
+#include "s_r3d_test.c"
+#include "s_cull_test.c"
+#include "s_job_test.c"
+#include "s_light_test.c"
+#include "s_shader_cache_test.c"
+#include "s_shading_permutation_test.c"
+#include "s_dynamic_resolution_test.c"
+#include "s_downsample_test.c"
+#include "s_batch_test.c"
+#include "s_frame_clock_test.c"
+#include "s_render_command_test.c"
+#include "s_state_cache_test.c"
+#include "s_obj_test.c"
+#include "s_mesh_pack_test.c"
+#include "s_vertex_format_test.c"
+#include "s_mesh_test.c"
+#include "s_mesh_lod_test.c"
+#include "s_soft_raster_test.c"
+#include "s_profile_test.c"
+
+global Test_Entry test_entries[] = {
+    { "math", test_math, bench_math },
+    { "r3d", test_r3d, bench_r3d },
+    { "cull", test_cull, null },
+    { "job", test_job, bench_job },
+    { "light", test_light, null },
+    { "shader_cache", test_shader_cache, null },
+    { "shading_permutation", test_shading_permutation, null },
+    { "dynamic_resolution", test_dynamic_resolution, null },
+    { "downsample", test_downsample, null },
+    { "batch", test_batch, bench_batch },
+    { "frame_clock", test_frame_clock, null },
+    { "render_command", test_render_command, bench_render_command },
+    { "state_cache", test_state_cache, null },
+    { "obj", test_obj, null },
+    { "mesh_pack", test_mesh_pack, null },
+    { "vertex_format", test_vertex_format, null },
+    { "mesh", test_mesh, null },
+    { "mesh_lod", test_mesh_lod, bench_mesh_lod },
+    { "soft_raster", test_soft_raster, null },
+    { "profile", test_profile, null },
+};
+
+int
+main(int argc, char **argv) {
+    b32 bench = (argc > 1) && (strcmp(argv[1], "bench") == 0);
+    char *only = (bench && (argc > 2)) ? argv[2] : null;
+    if ((argc > 1) && !bench) {
+        fprintf(stderr, "usage: s_test [bench [name]]\n");
+        return(1);
+    }
+
+    profile_init();
+    for (u32 entry_index = 0; entry_index < array_count(test_entries); ++entry_index) {
+        Test_Entry *entry = test_entries + entry_index;
+        if (only && (strcmp(only, entry->name) != 0)) {
+            continue;
+        }
+        if (bench) {
+            if (entry->bench) {
+                printf("bench %s\n", entry->name);
+                entry->bench();
+            }
+        } else {
+            u64 failures = test_state.failures;
+            printf("test %s\n", entry->name);
+            entry->test();
+            printf("  %s\n", (test_state.failures == failures) ? "ok" : "FAILED");
+        }
+    }
+
+    if (!bench) {
+        printf("%llu checks, %llu failed\n", (unsigned long long)test_state.checks,
+               (unsigned long long)test_state.failures);
+    }
+    int result = test_state.failures ? 1 : 0;
+    return(result);
+}
@@ -0,0 +1,271 @@
+// indexed by format, the values match the enum
+
+global Shader_Define vertex_format_defines[VertexFormat_Count][2] = {
+    { { "VERTEX_FORMAT", "0" }, { 0, 0 } },
+    { { "VERTEX_FORMAT", "1" }, { 0, 0 } },
+    { { "VERTEX_FORMAT", "2" }, { 0, 0 } },
+};
+
+global char *vertex_format_names[VertexFormat_Count] = {
+    "float", "oct16", "oct8",
+};
+
+global u32 vertex_format_strides[VertexFormat_Count] = {
+    sizeof(Mesh_Vertex), sizeof(Vertex_Oct16), sizeof(Vertex_Oct8),
+};
+
+function u32
+vertex_format_from_name(char *name) {
+    u32 result = VertexFormat_Count;
+    for (u32 format = 0; format < VertexFormat_Count; ++format) {
+        if (strcmp(name, vertex_format_names[format]) == 0) {
+            result = format;
+            break;
+        }
+    }
+    return(result);
+}
+
+// D3D's SNORM conversion: the most negative value is -1 as well, so the encoder never makes it.
+function s32
+vertex_snorm_encode(f32 value, s32 max) {
+    if (value > 1.0f) value = 1.0f;
+    if (value < -1.0f) value = -1.0f;
+    s32 result = (s32)floorf(value * (f32)max + 0.5f);
+    return(result);
+}
+
+function f32
+vertex_snorm_decode(s32 value, s32 max) {
+    f32 result = (f32)value * (1.0f / (f32)max);
+    if (result < -1.0f) result = -1.0f;
+    return(result);
+}
+
+// 0 counts as positive, both here and in the shader
+function f32
+vertex_sign(f32 x) {
+    f32 result = x >= 0.0f ? 1.0f : -1.0f;
+    return(result);
+}
+
+function v3f
+vertex_oct_decode(s32 x, s32 y, u32 bits) {
+    s32 max = (1 << (bits - 1)) - 1;
+    v3f result;
+    result.x = vertex_snorm_decode(x, max);
+    result.y = vertex_snorm_decode(y, max);
+    result.z = 1.0f - fabsf(result.x) - fabsf(result.y);
+    // unfold the lower half, same as n.xy += n.xy >= 0 ? -t : t in vs_main
+    f32 t = result.z < 0.0f ? -result.z : 0.0f;
+    result.x += result.x >= 0.0f ? -t : t;
+    result.y += result.y >= 0.0f ? -t : t;
+    return(result);
+}
+
+function void
+vertex_oct_encode(v3f normal, u32 bits, s32 *x, s32 *y) {
+    s32 max = (1 << (bits - 1)) - 1;
+    f32 l1 = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    f32 px = l1 > 0.0f ? normal.x / l1 : 0.0f;
+    f32 py = l1 > 0.0f ? normal.y / l1 : 0.0f;
+    if (normal.z < 0.0f) {
+        f32 fx = (1.0f - fabsf(py)) * vertex_sign(px);
+        f32 fy = (1.0f - fabsf(px)) * vertex_sign(py);
+        px = fx;
+        py = fy;
+    }
+
+    // the nearest grid point isn't always the closest after decoding, try all four around it
+    s32 base_x = (s32)floorf(px * (f32)max);
+    s32 base_y = (s32)floorf(py * (f32)max);
+    // compared by distance between the unit vectors, at 16 bits the cosines all round to 1
+    f32 best_distance_sq = FLT_MAX;
+    *x = 0;
+    *y = 0;
+    for (u32 corner = 0; corner < 4; ++corner) {
+        s32 cx = base_x + (s32)(corner & 1);
+        s32 cy = base_y + (s32)(corner >> 1);
+        if (cx > max) cx = max;
+        if (cx < -max) cx = -max;
+        if (cy > max) cy = max;
+        if (cy < -max) cy = -max;
+        v3f decoded = vertex_oct_decode(cx, cy, bits);
+        v3f error = v3f_sub(v3f_scale(decoded, 1.0f / sqrtf(v3f_dot(decoded, decoded))), normal);
+        f32 distance_sq = v3f_dot(error, error);
+        if (distance_sq < best_distance_sq) {
+            best_distance_sq = distance_sq;
+            *x = cx;
+            *y = cy;
+        }
+    }
+}
+
+function Vertex_Stream
+vertex_encode(Arena *arena, Mesh *mesh, u32 format) {
+    Vertex_Stream result = { 0 };
+    result.format = format;
+    result.stride = vertex_format_strides[format];
+    result.vertex_count = mesh->vertex_count;
+    result.vertices = arena_push(arena, (u64)result.stride * mesh->vertex_count, 16);
+
+    v3f min = v3f_make(0.0f, 0.0f, 0.0f);
+    v3f max = v3f_make(0.0f, 0.0f, 0.0f);
+    for (u32 vertex_index = 0; vertex_index < mesh->vertex_count; ++vertex_index) {
+        v3f p = mesh->vertices[vertex_index].p;
+        if (vertex_index == 0) {
+            min = p;
+            max = p;
+        }
+        min = v3f_make(p.x < min.x ? p.x : min.x, p.y < min.y ? p.y : min.y, p.z < min.z ? p.z : min.z);
+        max = v3f_make(p.x > max.x ? p.x : max.x, p.y > max.y ? p.y : max.y, p.z > max.z ? p.z : max.z);
+    }
+    result.position_offset = v3f_scale(v3f_add(min, max), 0.5f);
+    result.position_scale = v3f_scale(v3f_sub(max, min), 0.5f);
+    // a flat axis would divide by 0, any scale decodes it to the offset
+    for (u32 axis = 0; axis < 3; ++axis) {
+        if (result.position_scale.v[axis] <= 0.0f) {
+            result.position_scale.v[axis] = 1.0f;
+        }
+    }
+    if (format == VertexFormat_Float) {
+        result.position_offset = v3f_make(0.0f, 0.0f, 0.0f);
+        result.position_scale = v3f_make(1.0f, 1.0f, 1.0f);
+    }
+
+    for (u32 vertex_index = 0; vertex_index < mesh->vertex_count; ++vertex_index) {
+        Mesh_Vertex *src = mesh->vertices + vertex_index;
+        s32 p[3];
+        for (u32 axis = 0; axis < 3; ++axis) {
+            f32 unit = (src->p.v[axis] - result.position_offset.v[axis]) / result.position_scale.v[axis];
+            p[axis] = vertex_snorm_encode(unit, 32767);
+        }
+        v3f normal = src->normal;
+        f32 length = sqrtf(v3f_dot(normal, normal));
+        normal = length > 0.0f ? v3f_scale(normal, 1.0f / length) : v3f_make(0.0f, 0.0f, 1.0f);
+
+        switch (format) {
+            case VertexFormat_Float: {
+                ((Mesh_Vertex *)result.vertices)[vertex_index] = *src;
+            } break;
+
+            case VertexFormat_Oct16: {
+                Vertex_Oct16 *dst = (Vertex_Oct16 *)result.vertices + vertex_index;
+                s32 nx, ny;
+                vertex_oct_encode(normal, 16, &nx, &ny);
+                dst->p[0] = (s16)p[0];
+                dst->p[1] = (s16)p[1];
+                dst->p[2] = (s16)p[2];
+                dst->p[3] = 0;
+                dst->n[0] = (s16)nx;
+                dst->n[1] = (s16)ny;
+            } break;
+
+            case VertexFormat_Oct8: {
+                Vertex_Oct8 *dst = (Vertex_Oct8 *)result.vertices + vertex_index;
+                s32 nx, ny;
+                vertex_oct_encode(normal, 8, &nx, &ny);
+                dst->p[0] = (s16)p[0];
+                dst->p[1] = (s16)p[1];
+                dst->p[2] = (s16)p[2];
+                dst->n = (s16)(u16)(((u32)nx << 8) | ((u32)ny & 255));
+            } break;
+        }
+    }
+    return(result);
+}
+
+function void
+vertex_decode(Vertex_Stream *stream, Mesh_Vertex *out) {
+    for (u32 vertex_index = 0; vertex_index < stream->vertex_count; ++vertex_index) {
+        s32 p[3] = { 0 };
+        v3f normal = { 0 };
+        switch (stream->format) {
+            case VertexFormat_Float: {
+                out[vertex_index] = ((Mesh_Vertex *)stream->vertices)[vertex_index];
+                normal = out[vertex_index].normal;
+            } break;
+
+            case VertexFormat_Oct16: {
+                Vertex_Oct16 *src = (Vertex_Oct16 *)stream->vertices + vertex_index;
+                p[0] = src->p[0];
+                p[1] = src->p[1];
+                p[2] = src->p[2];
+                normal = vertex_oct_decode(src->n[0], src->n[1], 16);
+            } break;
+
+            case VertexFormat_Oct8: {
+                Vertex_Oct8 *src = (Vertex_Oct8 *)stream->vertices + vertex_index;
+                p[0] = src->p[0];
+                p[1] = src->p[1];
+                p[2] = src->p[2];
+                // arithmetic shifts sign-extend each byte, as the shader does on the int
+                s32 n = src->n;
+                normal = vertex_oct_decode(n >> 8, (s32)((u32)n << 24) >> 24, 8);
+            } break;
+        }
+
+        if (stream->format != VertexFormat_Float) {
+            for (u32 axis = 0; axis < 3; ++axis) {
+                out[vertex_index].p.v[axis] = vertex_snorm_decode(p[axis], 32767) * stream->position_scale.v[axis] +
+                    stream->position_offset.v[axis];
+            }
+        }
+        f32 length = sqrtf(v3f_dot(normal, normal));
+        out[vertex_index].normal = length > 0.0f ? v3f_scale(normal, 1.0f / length) : normal;
+    }
+}
+
+function v3f
+vertex_position_error_bound(Vertex_Stream *stream) {
+    v3f result = v3f_make(0.0f, 0.0f, 0.0f);
+    if (stream->format != VertexFormat_Float) {
+        // half a step from rounding, plus a few ulps for the decode's multiply-add
+        for (u32 axis = 0; axis < 3; ++axis) {
+            f32 scale = stream->position_scale.v[axis];
+            result.v[axis] = scale * (0.5f / 32767.0f) + (fabsf(stream->position_offset.v[axis]) + scale) * 4.0f * FLT_EPSILON;
+        }
+    }
+    return(result);
+}
+
+function f32
+vertex_normal_error_bound(u32 format) {
+    // The nearest grid point is at most sqrt(2) / 2 steps away and the precise encoder only does
+    // better. Decoding, (x, y, 1 - |x| - |y|) moves at most sqrt(3) times as far as (x, y) does,
+    // and is at least 1 / sqrt(3) long, so the angle moves at most 3 times the distance.
+    f32 result = 1e-6f;
+    if (format != VertexFormat_Float) {
+        s32 max = format == VertexFormat_Oct16 ? 32767 : 127;
+        result += 3.0f * 0.70710678f / (f32)max;
+    }
+    return(result);
+}
+
+function f32
+vertex_angle(v3f a, v3f b) {
+    v3f c = v3f_cross(a, b);
+    f32 result = atan2f(sqrtf(v3f_dot(c, c)), v3f_dot(a, b));
+    return(result);
+}
+
+function Vertex_Error
+vertex_measure_error(Arena *scratch, Vertex_Stream *stream, Mesh *mesh) {
+    Vertex_Error result = { 0 };
+    u64 scratch_pos = scratch->pos;
+    Mesh_Vertex *decoded = arena_push_array(scratch, Mesh_Vertex, stream->vertex_count);
+    vertex_decode(stream, decoded);
+    v3f bound = vertex_position_error_bound(stream);
+    for (u32 vertex_index = 0; vertex_index < stream->vertex_count; ++vertex_index) {
+        for (u32 axis = 0; axis < 3; ++axis) {
+            f32 error = fabsf(decoded[vertex_index].p.v[axis] - mesh->vertices[vertex_index].p.v[axis]);
+            // a bound of 0 is lossless, any error at all is past it
+            f32 ratio = bound.v[axis] > 0.0f ? error / bound.v[axis] : (error > 0.0f ? 2.0f : 0.0f);
+            result.position_ratio = ratio > result.position_ratio ? ratio : result.position_ratio;
+        }
+        f32 angle = vertex_angle(decoded[vertex_index].normal, mesh->vertices[vertex_index].normal);
+        result.normal_error = angle > result.normal_error ? angle : result.normal_error;
+    }
+    arena_pop_to(scratch, scratch_pos);
+    return(result);
+}
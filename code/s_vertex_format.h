@@ -0,0 +1,86 @@
+#if !defined(S_VERTEX_FORMAT_H)
+#define S_VERTEX_FORMAT_H
+
+// Compressed copies of a Mesh's vertices for the vertex buffer. Mesh_Vertex is two float3s, 24
+// bytes, and the vertex shader normalizes the normal anyway, so most of that is wasted:
+//   VertexFormat_Float  24 bytes, Mesh_Vertex as is
+//   VertexFormat_Oct16  12 bytes, position snorm16 x4 (w unused), normal octahedral snorm16 x2
+//   VertexFormat_Oct8    8 bytes, position snorm16 x3, normal octahedral snorm8 x2 in the 4th short
+//
+// Positions are snorm against the mesh's bounding box: local = snorm * position_scale +
+// position_offset, the box's half size and centre. Normals use the octahedral map from Cigolle
+// et al., "A Survey of Efficient Representations for Independent Unit Vectors": the sphere is
+// projected onto the octahedron |x| + |y| + |z| = 1, the lower half folded over the upper, and
+// the result flattened to the square [-1, 1]^2. The encoder tries the four neighbouring grid
+// points and keeps the closest, their "precise" variant.
+//
+// vs_main is compiled once per format with VERTEX_FORMAT set to the enum's value.
+// VertexFormat_Oct8 is read as R16G16B16A16_SINT and decoded by hand, since no DXGI format splits
+// a short into two bytes. vertex_decode does exactly what the shader does, so the soft rasterizer
+// can draw what the GPU would see.
+
+enum {
+    VertexFormat_Float,
+    VertexFormat_Oct16,
+    VertexFormat_Oct8,
+    VertexFormat_Count
+};
+
+typedef struct {
+    s16 p[4];
+    s16 n[2];
+} Vertex_Oct16;
+
+typedef struct {
+    s16 p[3];
+    // octahedral x in the high byte, y in the low byte
+    s16 n;
+} Vertex_Oct8;
+
+typedef struct {
+    u32 format;
+    u32 stride;
+    void *vertices;
+    u32 vertex_count;
+    // identity for VertexFormat_Float, which stores positions as they are
+    v3f position_scale;
+    v3f position_offset;
+} Vertex_Stream;
+
+// indexed by format, the values match the enum
+global Shader_Define vertex_format_defines[VertexFormat_Count][2];
+global char *vertex_format_names[VertexFormat_Count];
+global u32 vertex_format_strides[VertexFormat_Count];
+
+// VertexFormat_Count if name isn't one of vertex_format_names.
+function u32 vertex_format_from_name(char *name);
+
+// bits includes the sign, 16 or 8. Results are in [-(2^(bits-1) - 1), 2^(bits-1) - 1].
+function void vertex_oct_encode(v3f normal, u32 bits, s32 *x, s32 *y);
+// Not normalized, the vertex shader normalizes after rotating.
+function v3f vertex_oct_decode(s32 x, s32 y, u32 bits);
+
+// Encodes mesh->vertices into arena.
+function Vertex_Stream vertex_encode(Arena *arena, Mesh *mesh, u32 format);
+// Back to Mesh_Vertex the way vs_main decodes, out holds stream->vertex_count. Normals are
+// normalized.
+function void vertex_decode(Vertex_Stream *stream, Mesh_Vertex *out);
+
+// Largest error vertex_decode may have per position axis, in local units.
+function v3f vertex_position_error_bound(Vertex_Stream *stream);
+// Largest angle, in radians, between a unit normal and its decoded self.
+function f32 vertex_normal_error_bound(u32 format);
+
+typedef struct {
+    // largest position error over vertex_position_error_bound on any axis, past 1 is out of bounds
+    f32 position_ratio;
+    // largest angle, in radians, between a vertex's normal and its decoded one
+    f32 normal_error;
+} Vertex_Error;
+
+// The angle between two vectors, in radians. atan2 stays accurate where acos of the dot doesn't.
+function f32 vertex_angle(v3f a, v3f b);
+// Decodes stream, encoded from mesh, and measures it against mesh. scratch is returned as it was.
+function Vertex_Error vertex_measure_error(Arena *scratch, Vertex_Stream *stream, Mesh *mesh);
+
+#endif
@@ -0,0 +1,153 @@
+// Vertex formats: the tables agree with the enum the shader is compiled against, and every format
+// decodes within its own error bounds. Normals are tried straight through the octahedral map, at
+// random and where it has its seams: the axes and diagonals, the fold edge |x| + |y| = 1 where z
+// changes sign, and just either side of it. Positions go through whole meshes, far from the
+// origin, tiny, and with flat axes.
+
+global f32 vertex_format_test_offsets[][3] = {
+    { 0.0f, 0.0f, 0.0f },
+    { 1000.0f, -250.0f, 4096.0f },
+    { -0.001f, 0.002f, 0.0f },
+};
+
+function void
+vertex_format_test_normal(u32 format, v3f normal, f32 *worst) {
+    u32 bits = format == VertexFormat_Oct16 ? 16 : 8;
+    s32 max = (1 << (bits - 1)) - 1;
+    s32 x, y;
+    vertex_oct_encode(normal, bits, &x, &y);
+    if (test_check((x >= -max) && (x <= max) && (y >= -max) && (y <= max), "%s encoded (%g, %g, %g) to (%d, %d)",
+                   vertex_format_names[format], normal.x, normal.y, normal.z, x, y)) {
+        f32 angle = vertex_angle(vertex_oct_decode(x, y, bits), normal);
+        *worst = angle > *worst ? angle : *worst;
+    }
+}
+
+function void
+test_vertex_format(void) {
+    // the tables, and the defines vs_main is compiled with
+    for (u32 format = 0; format < VertexFormat_Count; ++format) {
+        char value[16];
+        snprintf(value, sizeof(value), "%u", format);
+        Shader_Define *define = vertex_format_defines[format];
+        test_check((strcmp(define[0].name, "VERTEX_FORMAT") == 0) && (strcmp(define[0].value, value) == 0) &&
+                   !define[1].name && !define[1].value, "format %u is compiled with %s=%s", format, define[0].name,
+                   define[0].value);
+        test_check(vertex_format_from_name(vertex_format_names[format]) == format, "%s doesn't name format %u",
+                   vertex_format_names[format], format);
+    }
+    test_check(vertex_format_from_name("oct") == VertexFormat_Count, "an unknown name found a format");
+    test_check((vertex_format_strides[VertexFormat_Float] == 24) && (vertex_format_strides[VertexFormat_Oct16] == 12) &&
+               (vertex_format_strides[VertexFormat_Oct8] == 8), "strides %u, %u, %u",
+               vertex_format_strides[VertexFormat_Float], vertex_format_strides[VertexFormat_Oct16],
+               vertex_format_strides[VertexFormat_Oct8]);
+
+    // normals
+    for (u32 format = VertexFormat_Oct16; format < VertexFormat_Count; ++format) {
+        Test_Random random = test_random_make(190 + format);
+        f32 bound = vertex_normal_error_bound(format);
+
+        f32 worst = 0.0f;
+        for (u32 normal_index = 0; normal_index < 200000; ++normal_index) {
+            v3f normal;
+            do {
+                normal = test_random_v3f(&random, -1.0f, 1.0f);
+            } while ((v3f_dot(normal, normal) > 1.0f) || (v3f_dot(normal, normal) < 1e-4f));
+            v3f_norm(&normal);
+            vertex_format_test_normal(format, normal, &worst);
+        }
+        test_check(worst <= bound, "%s random normals are off by up to %g, the bound is %g", vertex_format_names[format],
+                   worst, bound);
+
+        // axes, diagonals and the octants' edges
+        worst = 0.0f;
+        for (s32 x = -2; x <= 2; ++x) {
+            for (s32 y = -2; y <= 2; ++y) {
+                for (s32 z = -2; z <= 2; ++z) {
+                    if (x || y || z) {
+                        v3f normal = v3f_make((f32)x, (f32)y, (f32)z);
+                        v3f_norm(&normal);
+                        vertex_format_test_normal(format, normal, &worst);
+                    }
+                }
+            }
+        }
+        test_check(worst <= bound, "%s axes and diagonals are off by up to %g, the bound is %g",
+                   vertex_format_names[format], worst, bound);
+
+        // The fold: on the equator the two halves of the map meet, so the encoder may land on
+        // either side, and a z of either sign just off it folds or doesn't.
+        worst = 0.0f;
+        f32 z_values[] = { 0.0f, -0.0f, 1e-7f, -1e-7f, 1e-4f, -1e-4f, 1.0f / 127.0f, -1.0f / 127.0f };
+        for (u32 normal_index = 0; normal_index < 20000; ++normal_index) {
+            f32 angle = test_random_f32(&random, -pi_f32, pi_f32);
+            if (normal_index < 64) {
+                angle = (f32)normal_index * (pi_f32 / 32.0f);
+            }
+            f32 z = z_values[normal_index % array_count(z_values)];
+            f32 r = sqrtf(1.0f - z * z);
+            vertex_format_test_normal(format, v3f_make(cosf(angle) * r, sinf(angle) * r, z), &worst);
+        }
+        test_check(worst <= bound, "%s normals around the fold are off by up to %g, the bound is %g",
+                   vertex_format_names[format], worst, bound);
+    }
+
+    // whole meshes, positions and normals through vertex_encode and vertex_decode
+    Arena arena = arena_reserve(megabytes(64));
+    Test_Random random = test_random_make(195);
+    for (u32 offset_index = 0; offset_index < array_count(vertex_format_test_offsets); ++offset_index) {
+        // sizes from huge to tiny, the last with a flat y
+        f32 sizes[] = { 5000.0f, 1.0f, 0.001f, 2.0f };
+        for (u32 size_index = 0; size_index < array_count(sizes); ++size_index) {
+            Mesh mesh = { 0 };
+            mesh.vertex_count = 1000;
+            mesh.vertices = arena_push_array(&arena, Mesh_Vertex, mesh.vertex_count);
+            f32 *offset_xyz = vertex_format_test_offsets[offset_index];
+            v3f offset = v3f_make(offset_xyz[0], offset_xyz[1], offset_xyz[2]);
+            for (u32 vertex_index = 0; vertex_index < mesh.vertex_count; ++vertex_index) {
+                v3f p = test_random_v3f(&random, -sizes[size_index], sizes[size_index]);
+                if (size_index == 3) {
+                    p.y = 0.25f;
+                }
+                mesh.vertices[vertex_index].p = v3f_add(offset, p);
+                // not unit length, vertex_encode normalizes
+                mesh.vertices[vertex_index].normal = test_random_v3f(&random, -3.0f, 3.0f);
+            }
+            for (u32 format = 0; format < VertexFormat_Count; ++format) {
+                Vertex_Stream stream = vertex_encode(&arena, &mesh, format);
+                Vertex_Error error = vertex_measure_error(&arena, &stream, &mesh);
+                test_check((stream.stride == vertex_format_strides[format]) && (stream.vertex_count == mesh.vertex_count),
+                           "%s stream of %u vertices, %u bytes apart", vertex_format_names[format], stream.vertex_count,
+                           stream.stride);
+                test_check(error.position_ratio <= 1.0f, "%s positions at offset %u, size %g are off by %g of the bound",
+                           vertex_format_names[format], offset_index, sizes[size_index], error.position_ratio);
+                test_check(error.normal_error <= vertex_normal_error_bound(format),
+                           "%s normals through a mesh are off by %g, the bound is %g", vertex_format_names[format],
+                           error.normal_error, vertex_normal_error_bound(format));
+                if (format == VertexFormat_Float) {
+                    test_check(error.position_ratio == 0.0f, "float positions changed");
+                }
+            }
+            arena_clear(&arena);
+        }
+    }
+
+    // a single vertex is flat on every axis and comes back exactly
+    {
+        Mesh_Vertex vertex = { 0 };
+        vertex.p = v3f_make(3.5f, -7.25f, 1e6f);
+        vertex.normal = v3f_make(0.0f, 0.0f, -1.0f);
+        Mesh mesh = { 0 };
+        mesh.vertices = &vertex;
+        mesh.vertex_count = 1;
+        for (u32 format = 0; format < VertexFormat_Count; ++format) {
+            Vertex_Stream stream = vertex_encode(&arena, &mesh, format);
+            Mesh_Vertex decoded;
+            vertex_decode(&stream, &decoded);
+            test_check((decoded.p.x == vertex.p.x) && (decoded.p.y == vertex.p.y) && (decoded.p.z == vertex.p.z) &&
+                       (decoded.normal.z == -1.0f), "%s single vertex came back (%g, %g, %g) normal z %g",
+                       vertex_format_names[format], decoded.p.x, decoded.p.y, decoded.p.z, decoded.normal.z);
+        }
+    }
+    arena_release(&arena);
+}